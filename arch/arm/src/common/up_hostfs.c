@@ -240,6 +240,11 @@ int host_ftruncate(int fd, off_t length)
   return -ENOSYS;
 }
 
+int host_fadvise(int fd, off_t offset, off_t len, int advice)
+{
+  return -ENOSYS;
+}
+
 void *host_opendir(const char *name)
 {
   return NULL;
@@ -273,6 +273,48 @@ int host_ftruncate(int fd, off_t length)
   return ftruncate(fd, length);
 }
 
+/****************************************************************************
+ * Name: host_fadvise
+ ****************************************************************************/
+
+int host_fadvise(int fd, off_t offset, off_t len, int advice)
+{
+  int mapadvice;
+
+  /* Perform advice mapping */
+
+  switch (advice)
+    {
+      case NUTTX_POSIX_FADV_RANDOM:
+        mapadvice = POSIX_FADV_RANDOM;
+        break;
+
+      case NUTTX_POSIX_FADV_SEQUENTIAL:
+        mapadvice = POSIX_FADV_SEQUENTIAL;
+        break;
+
+      case NUTTX_POSIX_FADV_WILLNEED:
+        mapadvice = POSIX_FADV_WILLNEED;
+        break;
+
+      case NUTTX_POSIX_FADV_DONTNEED:
+        mapadvice = POSIX_FADV_DONTNEED;
+        break;
+
+      case NUTTX_POSIX_FADV_NOREUSE:
+        mapadvice = POSIX_FADV_NOREUSE;
+        break;
+
+      default:
+        mapadvice = POSIX_FADV_NORMAL;
+        break;
+    }
+
+  /* posix_fadvise() returns an error number rather than setting errno */
+
+  return -posix_fadvise(fd, offset, len, mapadvice);
+}
+
 /****************************************************************************
  * Name: host_opendir
  ****************************************************************************/
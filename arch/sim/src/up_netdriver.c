@@ -68,6 +68,22 @@
 
 #define BUF ((struct eth_hdr_s *)g_sim_dev.d_buf)
 
+/* With TCP segmentation offload or receive coalescing, the packet buffer
+ * holds a TCP super-segment.
+ */
+
+#if defined(CONFIG_NET_TCP_GSO) || defined(CONFIG_NET_TCP_GRO)
+#  define SIM_PKTBUF_SIZE 16384
+#else
+#  define SIM_PKTBUF_SIZE MAX_NETDEV_PKTSIZE
+#endif
+
+/* Percentage of frames to drop for loss injection */
+
+#if defined(CONFIG_SIM_NET_LOSS) && CONFIG_SIM_NET_LOSS > 0
+#  define SIM_NET_LOSS CONFIG_SIM_NET_LOSS
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -86,12 +102,27 @@ static struct timer g_periodic_timer;
 
 /* A single packet buffer is used */
 
-static uint8_t g_pktbuf[MAX_NETDEV_PKTSIZE + CONFIG_NET_GUARDSIZE];
+static uint8_t g_pktbuf[SIM_PKTBUF_SIZE + CONFIG_NET_GUARDSIZE];
+
+#ifdef CONFIG_NET_TCP_GRO
+/* A frame read ahead while coalescing received TCP segments that could not
+ * be merged.  It is processed on the next pass.
+ */
+
+static uint8_t g_grobuf[MAX_NETDEV_PKTSIZE + CONFIG_NET_GUARDSIZE];
+static unsigned int g_grolen;
+#endif
 
 /* Ethernet peripheral state */
 
 static struct net_driver_s g_sim_dev;
 
+#ifdef SIM_NET_LOSS
+/* State of the pseudo-random generator that selects frames to drop */
+
+static uint32_t g_lossseed = 1;
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -112,6 +143,53 @@ void timer_reset(struct timer *t)
   t->start += t->interval;
 }
 
+#ifdef SIM_NET_LOSS
+static bool sim_lose(void)
+{
+  g_lossseed = g_lossseed * 1103515245 + 12345;
+  return ((g_lossseed >> 16) % 100) < SIM_NET_LOSS;
+}
+#endif
+
+static unsigned int sim_read(unsigned char *buf)
+{
+  unsigned int len = netdev_read(buf, CONFIG_NET_ETH_PKTSIZE);
+
+#ifdef SIM_NET_LOSS
+  if (len > 0 && sim_lose())
+    {
+      NETDEV_RXDROPPED(&g_sim_dev);
+      return 0;
+    }
+#endif
+
+  return len;
+}
+
+static int sim_transmit(struct net_driver_s *dev)
+{
+#ifdef SIM_NET_LOSS
+  if (sim_lose())
+    {
+      return 0;
+    }
+#endif
+
+  netdev_send(dev->d_buf, dev->d_len);
+  return 0;
+}
+
+static void sim_send(struct net_driver_s *dev)
+{
+#ifdef CONFIG_NET_TCP_GSO
+  /* Split any TCP super-segment into MSS-sized frames */
+
+  (void)tcp_gso_segment(dev, sim_transmit);
+#else
+  (void)sim_transmit(dev);
+#endif
+}
+
 static int sim_txpoll(struct net_driver_s *dev)
 {
   /* If the polling resulted in data that should be sent out on the network,
@@ -147,7 +225,7 @@ static int sim_txpoll(struct net_driver_s *dev)
           /* Send the packet */
 
           NETDEV_TXPACKETS(dev);
-          netdev_send(g_sim_dev.d_buf, g_sim_dev.d_len);
+          sim_send(dev);
           NETDEV_TXDONE(dev);
         }
     }
@@ -173,10 +251,44 @@ void netdriver_loop(void)
   (void)devif_poll(&g_sim_dev, sim_txpoll);
   net_unlock();
 
-  /* netdev_read will return 0 on a timeout event and >0 on a data received event */
+#ifdef CONFIG_NET_TCP_GRO
+  /* Process any frame that was read ahead on the previous pass first */
 
-  g_sim_dev.d_len = netdev_read((FAR unsigned char *)g_sim_dev.d_buf,
-                                CONFIG_NET_ETH_PKTSIZE);
+  if (g_grolen > 0)
+    {
+      memcpy(g_sim_dev.d_buf, g_grobuf, g_grolen);
+      g_sim_dev.d_len = g_grolen;
+      g_grolen        = 0;
+    }
+  else
+#endif
+    {
+      /* netdev_read will return 0 on a timeout event and >0 on a data
+       * received event
+       */
+
+      g_sim_dev.d_len = sim_read((FAR unsigned char *)g_sim_dev.d_buf);
+    }
+
+#ifdef CONFIG_NET_TCP_GRO
+  /* Read ahead and merge any following, in-order segments of the same TCP
+   * flow so that they are passed to the network as one packet.  Only
+   * frames that are already waiting are read; netdev_read() would wait
+   * for one otherwise.
+   */
+
+  while (g_sim_dev.d_len > 0 && netdev_avail())
+    {
+      g_grolen = sim_read(g_grobuf);
+      if (g_grolen == 0 ||
+          tcp_gro_merge(&g_sim_dev, g_grobuf, g_grolen) < 0)
+        {
+          break;
+        }
+
+      g_grolen = 0;
+    }
+#endif
 
   /* Disable preemption through to the following so that it behaves a little more
    * like an interrupt (otherwise, the following logic gets pre-empted an behaves
@@ -242,7 +354,7 @@ void netdriver_loop(void)
 
                   /* And send the packet */
 
-                  netdev_send(g_sim_dev.d_buf, g_sim_dev.d_len);
+                  sim_send(&g_sim_dev);
                 }
             }
           else
@@ -281,7 +393,7 @@ void netdriver_loop(void)
 
                   /* And send the packet */
 
-                  netdev_send(g_sim_dev.d_buf, g_sim_dev.d_len);
+                  sim_send(&g_sim_dev);
                 }
             }
           else
@@ -350,6 +462,9 @@ int netdriver_init(void)
   /* Set callbacks */
 
   g_sim_dev.d_buf    = g_pktbuf;         /* Single packet buffer */
+#if defined(CONFIG_NET_TCP_GSO) || defined(CONFIG_NET_TCP_GRO)
+  g_sim_dev.d_gsosize = SIM_PKTBUF_SIZE;  /* TCP super-segments */
+#endif
   g_sim_dev.d_ifup   = netdriver_ifup;
   g_sim_dev.d_ifdown = netdriver_ifdown;
 
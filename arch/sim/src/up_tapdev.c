@@ -240,6 +240,27 @@ void tapdev_init(void)
   up_setmacaddr();
 }
 
+int tapdev_avail(void)
+{
+  fd_set                fdset;
+  struct timeval        tv;
+
+  if (gtapdevfd < 0)
+    {
+      return 0;
+    }
+
+  /* Poll without waiting */
+
+  tv.tv_sec  = 0;
+  tv.tv_usec = 0;
+
+  FD_ZERO(&fdset);
+  FD_SET(gtapdevfd, &fdset);
+
+  return select(gtapdevfd + 1, &fdset, NULL, NULL, &tv) > 0;
+}
+
 unsigned int tapdev_read(unsigned char *buf, unsigned int buflen)
 {
   fd_set                fdset;
@@ -48,6 +48,7 @@
 
 #include <nuttx/arch.h>
 #include <nuttx/kmalloc.h>
+#include <nuttx/fs/fs.h>
 #include <nuttx/mm/mm.h>
 #include <nuttx/mm/shm.h>
 #include <nuttx/binfmt/binfmt.h>
@@ -126,7 +127,7 @@ static void exec_ctors(FAR void *arg)
  *
  ****************************************************************************/
 
-int exec_module(FAR const struct binary_s *binp)
+int exec_module(FAR struct binary_s *binp)
 {
   FAR struct task_tcb_s *tcb;
 #if defined(CONFIG_ARCH_ADDRENV) && defined(CONFIG_BUILD_KERNEL)
@@ -240,6 +241,20 @@ int exec_module(FAR const struct binary_s *binp)
   up_initial_state(&tcb->cmn);
 #endif
 
+#if defined(CONFIG_FS_RAMMAP) && defined(HAVE_TASK_GROUP)
+  /* If the program image was copied into RAM by mmap(), then the copy must
+   * persist for as long as the new task runs, not as long as the task that
+   * loaded it.  It is then unmapped when the new task group exits, not by
+   * unload_module().
+   */
+
+  if (binp->mapped != NULL &&
+      rammap_reparent(binp->mapped, tcb->cmn.group) >= 0)
+    {
+      binp->reparented = true;
+    }
+#endif
+
 #ifdef CONFIG_ARCH_ADDRENV
   /* Assign the address environment to the new task group */
 
@@ -169,9 +169,15 @@ int unload_module(FAR struct binary_s *binp)
 
       binfmt_freeargv(binp);
 
-      /* Unmap mapped address spaces */
+      /* Unmap mapped address spaces.  A mapping that was handed to the
+       * new task group by exec_module() is released when that group exits.
+       */
 
+#if defined(CONFIG_FS_RAMMAP) && defined(HAVE_TASK_GROUP)
+      if (binp->mapped && !binp->reparented)
+#else
       if (binp->mapped)
+#endif
         {
           binfo("Unmapping address space: %p\n", binp->mapped);
 
@@ -0,0 +1,142 @@
+/****************************************************************************
+ * drivers/blkmerge.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <nuttx/drivers/blkmerge.h>
+
+#ifdef CONFIG_DRVR_BLKMERGE
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: blkmerge_overlaps
+ *
+ * Description:
+ *   Return true if the run holds any block in the range startblock through
+ *   startblock + nblocks - 1.
+ *
+ ****************************************************************************/
+
+bool blkmerge_overlaps(FAR const struct blk_run_s *run, off_t startblock,
+                       size_t nblocks)
+{
+  return run->nblocks > 0 && nblocks > 0 &&
+         startblock < run->startblock + (off_t)run->nblocks &&
+         run->startblock < startblock + (off_t)nblocks;
+}
+
+/****************************************************************************
+ * Name: blkmerge_add
+ *
+ * Description:
+ *   Elevator merge of a write request into a run.  The new blocks are
+ *   accepted if the run is empty or if they are adjacent to (back or front
+ *   merge) or overlap the blocks already in the run, and the combined
+ *   range still fits in maxblocks.  Newer data replaces older data where
+ *   the ranges overlap.
+ *
+ ****************************************************************************/
+
+bool blkmerge_add(FAR struct blk_run_s *run, size_t blocksize,
+                  size_t maxblocks, off_t startblock, size_t nblocks,
+                  FAR const uint8_t *src)
+{
+  off_t newstart;
+  off_t newend;
+  off_t runend;
+  off_t end;
+
+  if (nblocks == 0 || nblocks > maxblocks)
+    {
+      return false;
+    }
+
+  if (run->nblocks == 0)
+    {
+      /* The run is empty.  Just start a new run of blocks */
+
+      memcpy(run->data, src, nblocks * blocksize);
+      run->startblock = startblock;
+      run->nblocks    = nblocks;
+      return true;
+    }
+
+  /* The union of the two ranges must be contiguous and must fit */
+
+  runend = run->startblock + (off_t)run->nblocks;
+  end    = startblock + (off_t)nblocks;
+
+  if (startblock > runend || end < run->startblock)
+    {
+      return false;
+    }
+
+  newstart = startblock < run->startblock ? startblock : run->startblock;
+  newend   = end > runend ? end : runend;
+
+  if ((size_t)(newend - newstart) > maxblocks)
+    {
+      return false;
+    }
+
+  /* For a front merge, move the staged blocks up to make room */
+
+  if (startblock < run->startblock)
+    {
+      memmove(run->data + (run->startblock - startblock) * blocksize,
+              run->data, run->nblocks * blocksize);
+    }
+
+  memcpy(run->data + (startblock - newstart) * blocksize, src,
+         nblocks * blocksize);
+
+  run->startblock = newstart;
+  run->nblocks    = newend - newstart;
+  return true;
+}
+
+#endif /* CONFIG_DRVR_BLKMERGE */
@@ -0,0 +1,759 @@
+/****************************************************************************
+ * drivers/cowdisk.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <semaphore.h>
+#include <assert.h>
+#include <debug.h>
+#include <errno.h>
+
+#include <nuttx/kmalloc.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
+#include <nuttx/drivers/cowdisk.h>
+
+#ifdef CONFIG_COWDISK
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_COWDISK_NBUCKETS
+#  define CONFIG_COWDISK_NBUCKETS 64
+#endif
+
+#ifndef CONFIG_COWDISK_NSNAPSHOTS
+#  define CONFIG_COWDISK_NSNAPSHOTS 4
+#endif
+
+#define COW_HASH(s) ((s) % CONFIG_COWDISK_NBUCKETS)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One sector written to the device.  Each is in a hash bucket list, where
+ * newer versions of the same sector always come first, and in the list of
+ * sectors written at the same snapshot level.
+ */
+
+struct cow_block_s
+{
+  FAR struct cow_block_s *cb_hnext; /* Next block in the hash bucket */
+  FAR struct cow_block_s *cb_lnext; /* Next block of the same level */
+  size_t   cb_sector;               /* Sector number */
+  uint8_t  cb_level;                /* Snapshot level when written */
+  uint8_t  cb_data[1];              /* Sector data (actual size is sectsize) */
+};
+
+#define SIZEOF_COW_BLOCK_S(n) (sizeof(struct cow_block_s) - 1 + (n))
+
+struct cow_struct_s
+{
+  FAR struct inode *cd_base;        /* The underlying block driver */
+  sem_t    cd_sem;                  /* Exclusive access to the block lists */
+  size_t   cd_nsectors;             /* Number of sectors on device */
+  uint16_t cd_sectsize;             /* The size of one sector */
+  uint8_t  cd_level;                /* Current snapshot level */
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+  uint8_t  cd_crefs;                /* Open reference count */
+  bool     cd_unlinked;             /* The driver has been unlinked */
+#endif
+  uint32_t cd_nblocks;              /* Number of sectors held in memory */
+
+  /* Written sectors */
+
+  FAR struct cow_block_s *cd_hash[CONFIG_COWDISK_NBUCKETS];
+  FAR struct cow_block_s *cd_levels[CONFIG_COWDISK_NSNAPSHOTS + 1];
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static void    cow_semtake(FAR struct cow_struct_s *dev);
+#define        cow_semgive(d) nxsem_post(&(d)->cd_sem)
+
+static FAR struct cow_block_s *cow_find(FAR struct cow_struct_s *dev,
+                 size_t sector);
+static void    cow_remove(FAR struct cow_struct_s *dev,
+                 FAR struct cow_block_s *blk);
+static void    cow_freelevel(FAR struct cow_struct_s *dev, uint8_t level);
+static int     cow_discard(FAR struct cow_struct_s *dev,
+                 FAR const struct blkdiscard_s *range);
+static int     cow_rollback(FAR struct cow_struct_s *dev,
+                 unsigned long snapshot);
+
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+static void    cow_destroy(FAR struct cow_struct_s *dev);
+static int     cow_open(FAR struct inode *inode);
+static int     cow_close(FAR struct inode *inode);
+#endif
+static ssize_t cow_read(FAR struct inode *inode, FAR unsigned char *buffer,
+                 size_t start_sector, unsigned int nsectors);
+#ifdef CONFIG_FS_WRITABLE
+static ssize_t cow_write(FAR struct inode *inode,
+                 FAR const unsigned char *buffer, size_t start_sector,
+                 unsigned int nsectors);
+#endif
+static int     cow_geometry(FAR struct inode *inode,
+                 FAR struct geometry *geometry);
+static int     cow_ioctl(FAR struct inode *inode, int cmd,
+                 unsigned long arg);
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+static int     cow_unlink(FAR struct inode *inode);
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const struct block_operations g_bops =
+{
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+  cow_open,     /* open     */
+  cow_close,    /* close    */
+#else
+  0,            /* open     */
+  0,            /* close    */
+#endif
+  cow_read,     /* read     */
+#ifdef CONFIG_FS_WRITABLE
+  cow_write,    /* write    */
+#else
+  NULL,         /* write    */
+#endif
+  cow_geometry, /* geometry */
+  cow_ioctl,    /* ioctl    */
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+  cow_unlink    /* unlink   */
+#endif
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cow_semtake
+ ****************************************************************************/
+
+static void cow_semtake(FAR struct cow_struct_s *dev)
+{
+  (void)nxsem_wait_uninterruptible(&dev->cd_sem);
+}
+
+/****************************************************************************
+ * Name: cow_find
+ *
+ * Description:
+ *   Return the newest version of a written sector, or NULL if the sector
+ *   has not been written.
+ *
+ ****************************************************************************/
+
+static FAR struct cow_block_s *cow_find(FAR struct cow_struct_s *dev,
+                                        size_t sector)
+{
+  FAR struct cow_block_s *blk;
+
+  for (blk = dev->cd_hash[COW_HASH(sector)];
+       blk != NULL && blk->cb_sector != sector;
+       blk = blk->cb_hnext);
+
+  return blk;
+}
+
+/****************************************************************************
+ * Name: cow_remove
+ *
+ * Description:
+ *   Remove a block from its hash bucket.  The caller takes care of the
+ *   level list.
+ *
+ ****************************************************************************/
+
+static void cow_remove(FAR struct cow_struct_s *dev,
+                       FAR struct cow_block_s *blk)
+{
+  FAR struct cow_block_s **pprev;
+
+  for (pprev = &dev->cd_hash[COW_HASH(blk->cb_sector)];
+       *pprev != NULL && *pprev != blk;
+       pprev = &(*pprev)->cb_hnext);
+
+  DEBUGASSERT(*pprev == blk);
+  *pprev = blk->cb_hnext;
+  dev->cd_nblocks--;
+}
+
+/****************************************************************************
+ * Name: cow_freelevel
+ *
+ * Description:
+ *   Free every block written at one snapshot level.  This is the newest
+ *   level, so the blocks are always the newest versions of their sectors.
+ *
+ ****************************************************************************/
+
+static void cow_freelevel(FAR struct cow_struct_s *dev, uint8_t level)
+{
+  FAR struct cow_block_s *blk;
+  FAR struct cow_block_s *next;
+
+  for (blk = dev->cd_levels[level]; blk != NULL; blk = next)
+    {
+      next = blk->cb_lnext;
+      cow_remove(dev, blk);
+      kmm_free(blk);
+    }
+
+  dev->cd_levels[level] = NULL;
+}
+
+/****************************************************************************
+ * Name: cow_discard
+ *
+ * Description:
+ *   Free the blocks in a range of sectors that were written since the last
+ *   snapshot.  Versions kept for older snapshots cannot be freed; those
+ *   sectors read as they were at the time of the snapshot.
+ *
+ ****************************************************************************/
+
+static int cow_discard(FAR struct cow_struct_s *dev,
+                       FAR const struct blkdiscard_s *range)
+{
+  FAR struct cow_block_s **pprev;
+  FAR struct cow_block_s *blk;
+  size_t end;
+
+  if (range == NULL || range->bd_startsector >= dev->cd_nsectors ||
+      range->bd_nsectors > dev->cd_nsectors - range->bd_startsector)
+    {
+      return -EINVAL;
+    }
+
+  end   = range->bd_startsector + range->bd_nsectors;
+  pprev = &dev->cd_levels[dev->cd_level];
+
+  while ((blk = *pprev) != NULL)
+    {
+      if (blk->cb_sector >= range->bd_startsector && blk->cb_sector < end)
+        {
+          *pprev = blk->cb_lnext;
+          cow_remove(dev, blk);
+          kmm_free(blk);
+        }
+      else
+        {
+          pprev = &blk->cb_lnext;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: cow_rollback
+ *
+ * Description:
+ *   Return to the state at the time the snapshot was taken.  The snapshot
+ *   itself remains and becomes the current level again.
+ *
+ ****************************************************************************/
+
+static int cow_rollback(FAR struct cow_struct_s *dev, unsigned long snapshot)
+{
+  int level;
+
+  if (snapshot > dev->cd_level)
+    {
+      return -EINVAL;
+    }
+
+  for (level = dev->cd_level; level >= (int)snapshot; level--)
+    {
+      cow_freelevel(dev, level);
+    }
+
+  dev->cd_level = snapshot;
+  finfo("Rolled back to snapshot %lu, %lu sectors in memory\n",
+        snapshot, (unsigned long)dev->cd_nblocks);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: cow_destroy
+ *
+ * Description:
+ *   Free all resources used by the copy-on-write disk
+ *
+ ****************************************************************************/
+
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+static void cow_destroy(FAR struct cow_struct_s *dev)
+{
+  finfo("Destroying copy-on-write disk\n");
+
+  (void)cow_rollback(dev, 0);
+  (void)close_blockdriver(dev->cd_base);
+  nxsem_destroy(&dev->cd_sem);
+  kmm_free(dev);
+}
+#endif
+
+/****************************************************************************
+ * Name: cow_open
+ *
+ * Description: Open the block device
+ *
+ ****************************************************************************/
+
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+static int cow_open(FAR struct inode *inode)
+{
+  FAR struct cow_struct_s *dev;
+
+  DEBUGASSERT(inode && inode->i_private);
+  dev = (FAR struct cow_struct_s *)inode->i_private;
+
+  /* Increment the open reference count */
+
+  cow_semtake(dev);
+  dev->cd_crefs++;
+  DEBUGASSERT(dev->cd_crefs > 0);
+  cow_semgive(dev);
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: cow_close
+ *
+ * Description: close the block device
+ *
+ ****************************************************************************/
+
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+static int cow_close(FAR struct inode *inode)
+{
+  FAR struct cow_struct_s *dev;
+
+  DEBUGASSERT(inode && inode->i_private);
+  dev = (FAR struct cow_struct_s *)inode->i_private;
+
+  /* Decrement the open reference count */
+
+  cow_semtake(dev);
+  DEBUGASSERT(dev->cd_crefs > 0);
+  dev->cd_crefs--;
+
+  /* Was that the last open reference of an unlinked driver? */
+
+  if (dev->cd_crefs == 0 && dev->cd_unlinked)
+    {
+      cow_semgive(dev);
+      cow_destroy(dev);
+      return OK;
+    }
+
+  cow_semgive(dev);
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: cow_read
+ *
+ * Description:
+ *   Read the specified number of sectors.  Written sectors come from
+ *   memory, runs of unwritten sectors from the underlying device.
+ *
+ ****************************************************************************/
+
+static ssize_t cow_read(FAR struct inode *inode, unsigned char *buffer,
+                        size_t start_sector, unsigned int nsectors)
+{
+  FAR struct cow_struct_s *dev;
+  FAR struct inode *base;
+  FAR struct cow_block_s *blk;
+  unsigned int nrun;
+  unsigned int done;
+  ssize_t ret;
+
+  DEBUGASSERT(inode && inode->i_private);
+  dev  = (FAR struct cow_struct_s *)inode->i_private;
+  base = dev->cd_base;
+
+  finfo("sector: %lu nsectors: %u\n", (unsigned long)start_sector, nsectors);
+
+  if (start_sector >= dev->cd_nsectors ||
+      nsectors > dev->cd_nsectors - start_sector)
+    {
+      return -EINVAL;
+    }
+
+  cow_semtake(dev);
+
+  for (done = 0; done < nsectors; done += nrun)
+    {
+      blk = cow_find(dev, start_sector + done);
+      if (blk != NULL)
+        {
+          memcpy(buffer, blk->cb_data, dev->cd_sectsize);
+          buffer += dev->cd_sectsize;
+          nrun    = 1;
+          continue;
+        }
+
+      /* Read the run of unwritten sectors with one request */
+
+      for (nrun = 1;
+           done + nrun < nsectors &&
+           cow_find(dev, start_sector + done + nrun) == NULL;
+           nrun++);
+
+      ret = base->u.i_bops->read(base, buffer, start_sector + done, nrun);
+      if (ret != nrun)
+        {
+          cow_semgive(dev);
+          return ret < 0 ? ret : -EIO;
+        }
+
+      buffer += nrun * dev->cd_sectsize;
+    }
+
+  cow_semgive(dev);
+  return nsectors;
+}
+
+/****************************************************************************
+ * Name: cow_write
+ *
+ * Description:
+ *   Write the specified number of sectors.  A sector already written since
+ *   the last snapshot is overwritten in place; otherwise a new version is
+ *   created so that the underlying device and older snapshots are not
+ *   changed.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_WRITABLE
+static ssize_t cow_write(FAR struct inode *inode, const unsigned char *buffer,
+                         size_t start_sector, unsigned int nsectors)
+{
+  FAR struct cow_struct_s *dev;
+  FAR struct cow_block_s *blk;
+  unsigned int i;
+  size_t sector;
+
+  DEBUGASSERT(inode && inode->i_private);
+  dev = (FAR struct cow_struct_s *)inode->i_private;
+
+  finfo("sector: %lu nsectors: %u\n", (unsigned long)start_sector, nsectors);
+
+  if (start_sector >= dev->cd_nsectors ||
+      nsectors > dev->cd_nsectors - start_sector)
+    {
+      return -EFBIG;
+    }
+
+  cow_semtake(dev);
+
+  for (i = 0; i < nsectors; i++, buffer += dev->cd_sectsize)
+    {
+      sector = start_sector + i;
+      blk    = cow_find(dev, sector);
+
+      if (blk == NULL || blk->cb_level != dev->cd_level)
+        {
+          blk = (FAR struct cow_block_s *)
+            kmm_malloc(SIZEOF_COW_BLOCK_S(dev->cd_sectsize));
+          if (blk == NULL)
+            {
+              ferr("ERROR: Out of memory after %lu sectors\n",
+                   (unsigned long)dev->cd_nblocks);
+              cow_semgive(dev);
+              return i > 0 ? (ssize_t)i : -ENOMEM;
+            }
+
+          blk->cb_sector = sector;
+          blk->cb_level  = dev->cd_level;
+
+          /* The new version goes in front of any older one */
+
+          blk->cb_hnext                   = dev->cd_hash[COW_HASH(sector)];
+          dev->cd_hash[COW_HASH(sector)]  = blk;
+          blk->cb_lnext                   = dev->cd_levels[dev->cd_level];
+          dev->cd_levels[dev->cd_level]   = blk;
+          dev->cd_nblocks++;
+        }
+
+      memcpy(blk->cb_data, buffer, dev->cd_sectsize);
+    }
+
+  cow_semgive(dev);
+  return nsectors;
+}
+#endif
+
+/****************************************************************************
+ * Name: cow_geometry
+ *
+ * Description: Return device geometry
+ *
+ ****************************************************************************/
+
+static int cow_geometry(FAR struct inode *inode, struct geometry *geometry)
+{
+  FAR struct cow_struct_s *dev;
+  FAR struct inode *base;
+  int ret;
+
+  DEBUGASSERT(inode && inode->i_private);
+  if (geometry == NULL)
+    {
+      return -EINVAL;
+    }
+
+  /* The geometry is that of the underlying device, but always writable */
+
+  dev  = (FAR struct cow_struct_s *)inode->i_private;
+  base = dev->cd_base;
+
+  ret = base->u.i_bops->geometry(base, geometry);
+  if (ret >= 0)
+    {
+#ifdef CONFIG_FS_WRITABLE
+      geometry->geo_writeenabled = true;
+#endif
+      geometry->geo_nsectors     = dev->cd_nsectors;
+      geometry->geo_sectorsize   = dev->cd_sectsize;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: cow_ioctl
+ *
+ * Description:
+ *   Snapshot, rollback and discard.  Nothing is passed to the underlying
+ *   device:  BIOC_XIPBASE, in particular, would bypass the written sectors.
+ *
+ ****************************************************************************/
+
+static int cow_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
+{
+  FAR struct cow_struct_s *dev;
+  int ret;
+
+  DEBUGASSERT(inode && inode->i_private);
+  dev = (FAR struct cow_struct_s *)inode->i_private;
+
+  cow_semtake(dev);
+  switch (cmd)
+    {
+      case BIOC_SNAPSHOT:
+        if (dev->cd_level >= CONFIG_COWDISK_NSNAPSHOTS)
+          {
+            ret = -ENOSPC;
+          }
+        else
+          {
+            ret = ++dev->cd_level;
+          }
+        break;
+
+      case BIOC_ROLLBACK:
+        ret = cow_rollback(dev, arg);
+        break;
+
+      case BIOC_DISCARD:
+        ret = cow_discard(dev,
+                          (FAR const struct blkdiscard_s *)((uintptr_t)arg));
+        break;
+
+      case BIOC_FLUSH:
+        ret = OK;
+        break;
+
+      default:
+        ret = -ENOTTY;
+        break;
+    }
+
+  cow_semgive(dev);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: cow_unlink
+ *
+ * Description:
+ *   The block driver has been unlinked.
+ *
+ ****************************************************************************/
+
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+static int cow_unlink(FAR struct inode *inode)
+{
+  FAR struct cow_struct_s *dev;
+
+  DEBUGASSERT(inode && inode->i_private);
+  dev = (FAR struct cow_struct_s *)inode->i_private;
+
+  /* Release all resources now if there are no open references */
+
+  cow_semtake(dev);
+  dev->cd_unlinked = true;
+  if (dev->cd_crefs == 0)
+    {
+      cow_semgive(dev);
+      cow_destroy(dev);
+      return OK;
+    }
+
+  cow_semgive(dev);
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cowdisk_register
+ *
+ * Description:
+ *   Register a copy-on-write block device on top of an existing block
+ *   driver.  See include/nuttx/drivers/cowdisk.h.
+ *
+ ****************************************************************************/
+
+int cowdisk_register(int minor, FAR const char *basedev)
+{
+  FAR struct cow_struct_s *dev;
+  FAR struct inode *base;
+  struct geometry geo;
+  char devname[16];
+  int ret;
+
+  finfo("minor: %d basedev: %s\n", minor, basedev);
+
+  /* Sanity check */
+
+#ifdef CONFIG_DEBUG_FEATURES
+  if (minor < 0 || minor > 255 || basedev == NULL)
+    {
+      return -EINVAL;
+    }
+#endif
+
+  /* The underlying device is only read */
+
+  ret = open_blockdriver(basedev, MS_RDONLY, &base);
+  if (ret < 0)
+    {
+      ferr("ERROR: Failed to open %s: %d\n", basedev, ret);
+      return ret;
+    }
+
+  if (base->u.i_bops->read == NULL || base->u.i_bops->geometry == NULL)
+    {
+      ret = -ENODEV;
+      goto errout_with_base;
+    }
+
+  ret = base->u.i_bops->geometry(base, &geo);
+  if (ret < 0 || !geo.geo_available || geo.geo_nsectors == 0 ||
+      geo.geo_sectorsize == 0 || geo.geo_sectorsize > UINT16_MAX)
+    {
+      ret = ret < 0 ? ret : -ENODEV;
+      goto errout_with_base;
+    }
+
+  /* Allocate a copy-on-write device structure */
+
+  dev = (FAR struct cow_struct_s *)kmm_zalloc(sizeof(struct cow_struct_s));
+  if (dev == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout_with_base;
+    }
+
+  dev->cd_base     = base;
+  dev->cd_nsectors = geo.geo_nsectors;
+  dev->cd_sectsize = geo.geo_sectorsize;
+  nxsem_init(&dev->cd_sem, 0, 1);
+
+  /* Create a device name */
+
+  snprintf(devname, 16, "/dev/cow%d", minor);
+
+  /* Inode private data is a reference to the device structure */
+
+  ret = register_blockdriver(devname, &g_bops, 0, dev);
+  if (ret < 0)
+    {
+      ferr("ERROR: register_blockdriver failed: %d\n", ret);
+      nxsem_destroy(&dev->cd_sem);
+      kmm_free(dev);
+      goto errout_with_base;
+    }
+
+  return OK;
+
+errout_with_base:
+  (void)close_blockdriver(base);
+  return ret;
+}
+
+#endif /* CONFIG_COWDISK */
@@ -68,6 +68,7 @@
 
 #include "mmcsd.h"
 #include "mmcsd_sdio.h"
+#include "mmcsd_wrqueue.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -150,6 +151,12 @@ struct mmcsd_state_s
 #if defined(CONFIG_DRVR_WRITEBUFFER) || defined(CONFIG_DRVR_READAHEAD)
   struct rwbuffer_s rwbuffer;
 #endif
+
+  /* Asynchronous, double buffered write queue */
+
+#ifdef CONFIG_MMCSD_WRQUEUE
+  struct mmcsd_wrqueue_s wrqueue;
+#endif
 };
 
 /****************************************************************************
@@ -217,10 +224,14 @@ static ssize_t mmcsd_writesingle(FAR struct mmcsd_state_s *priv,
 static ssize_t mmcsd_writemultiple(FAR struct mmcsd_state_s *priv,
                  FAR const uint8_t *buffer, off_t startblock, size_t nblocks);
 #endif
-#ifdef CONFIG_DRVR_WRITEBUFFER
+#if defined(CONFIG_DRVR_WRITEBUFFER) || defined(CONFIG_MMCSD_WRQUEUE)
 static ssize_t mmcsd_flush(FAR void *dev, FAR const uint8_t *buffer,
                  off_t startblock, size_t nblocks);
 #endif
+#ifdef CONFIG_MMCSD_WRQUEUE
+static ssize_t mmcsd_wrqflush(FAR void *dev, FAR const uint8_t *buffer,
+                 off_t startblock, size_t nblocks);
+#endif
 #endif
 
 /* Block driver methods *****************************************************/
@@ -2023,7 +2034,8 @@ static ssize_t mmcsd_writemultiple(FAR struct mmcsd_state_s *priv,
  *
  ****************************************************************************/
 
-#if defined(CONFIG_FS_WRITABLE) && defined(CONFIG_DRVR_WRITEBUFFER)
+#if defined(CONFIG_FS_WRITABLE) && \
+    (defined(CONFIG_DRVR_WRITEBUFFER) || defined(CONFIG_MMCSD_WRQUEUE))
 static ssize_t mmcsd_flush(FAR void *dev, FAR const uint8_t *buffer,
                            off_t startblock, size_t nblocks)
 {
@@ -2076,6 +2088,37 @@ static ssize_t mmcsd_flush(FAR void *dev, FAR const uint8_t *buffer,
 }
 #endif
 
+/****************************************************************************
+ * Name: mmcsd_wrqflush
+ *
+ * Description:
+ *   Transfer blocks from the write queue to the card.  Unlike the write
+ *   buffer flush, this is called without exclusive access to the card.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MMCSD_WRQUEUE
+static ssize_t mmcsd_wrqflush(FAR void *dev, FAR const uint8_t *buffer,
+                              off_t startblock, size_t nblocks)
+{
+  FAR struct mmcsd_state_s *priv = (FAR struct mmcsd_state_s *)dev;
+  ssize_t ret;
+
+  mmcsd_takesem(priv);
+  if (IS_EMPTY(priv))
+    {
+      ret = -ENODEV;
+    }
+  else
+    {
+      ret = mmcsd_flush(dev, buffer, startblock, nblocks);
+    }
+
+  mmcsd_givesem(priv);
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Block Driver Methods
  ****************************************************************************/
@@ -2113,11 +2156,24 @@ static int mmcsd_open(FAR struct inode *inode)
 static int mmcsd_close(FAR struct inode *inode)
 {
   FAR struct mmcsd_state_s *priv;
+#ifdef CONFIG_MMCSD_WRQUEUE
+  int ret;
+#endif
 
   finfo("Entry\n");
   DEBUGASSERT(inode && inode->i_private);
   priv = (FAR struct mmcsd_state_s *)inode->i_private;
 
+#ifdef CONFIG_MMCSD_WRQUEUE
+  /* Write out anything still queued */
+
+  ret = wrq_sync(&priv->wrqueue, 0, 0);
+  if (ret < 0)
+    {
+      ferr("ERROR: Queued write failed: %d\n", ret);
+    }
+
+#endif
   /* Decrement the reference count on the block driver */
 
   DEBUGASSERT(priv->crefs > 0);
@@ -2153,6 +2209,20 @@ static ssize_t mmcsd_read(FAR struct inode *inode, unsigned char *buffer,
 
   if (nsectors > 0)
     {
+#ifdef CONFIG_MMCSD_WRQUEUE
+      /* Make sure that any queued writes to these sectors have reached the
+       * card.
+       */
+
+      ret = wrq_sync(&priv->wrqueue, startsector, nsectors);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      ret = nsectors;
+#endif
+
       mmcsd_takesem(priv);
 
 #if defined(CONFIG_DRVR_READAHEAD)
@@ -2215,7 +2285,7 @@ static ssize_t mmcsd_write(FAR struct inode *inode, FAR const unsigned char *buf
                            size_t startsector, unsigned int nsectors)
 {
   FAR struct mmcsd_state_s *priv;
-#if defined(CONFIG_MMCSD_MULTIBLOCK_DISABLE)
+#if defined(CONFIG_MMCSD_MULTIBLOCK_DISABLE) && !defined(CONFIG_MMCSD_WRQUEUE)
   size_t sector;
   size_t endsector;
 #endif
@@ -2227,6 +2297,23 @@ static ssize_t mmcsd_write(FAR struct inode *inode, FAR const unsigned char *buf
   finfo("sector: %lu nsectors: %u sectorsize: %u\n",
         (unsigned long)startsector, nsectors, priv->blocksize);
 
+#if defined(CONFIG_MMCSD_WRQUEUE)
+  /* Stage the data in the write queue.  The transfer to the card is
+   * performed on the low priority work queue, overlapping with the
+   * caller preparing the next write.
+   */
+
+  if (priv->blocksize == 0)
+    {
+      ret = -ENODEV;
+    }
+  else if (nsectors > 0)
+    {
+      ret = wrq_write(&priv->wrqueue, priv->blocksize, startsector,
+                      nsectors, buffer);
+    }
+
+#else
   mmcsd_takesem(priv);
 
 #if defined(CONFIG_DRVR_WRITEBUFFER)
@@ -2268,6 +2355,7 @@ static ssize_t mmcsd_write(FAR struct inode *inode, FAR const unsigned char *buf
 
 #endif
   mmcsd_givesem(priv);
+#endif /* CONFIG_MMCSD_WRQUEUE */
 
   /* On success, return the number of blocks written */
 
@@ -2350,6 +2438,18 @@ static int mmcsd_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
   DEBUGASSERT(inode && inode->i_private);
   priv  = (FAR struct mmcsd_state_s *)inode->i_private;
 
+#ifdef CONFIG_MMCSD_WRQUEUE
+  /* Write out the queued data.  This must be done without holding the
+   * card.
+   */
+
+  if (cmd == BIOC_FLUSH)
+    {
+      finfo("BIOC_FLUSH\n");
+      return wrq_sync(&priv->wrqueue, 0, 0);
+    }
+
+#endif
   /* Process the IOCTL by command */
 
   mmcsd_takesem(priv);
@@ -3187,6 +3287,12 @@ static int mmcsd_removed(FAR struct mmcsd_state_s *priv)
   priv->rca          = 0;
   priv->selblocklen  = 0;
 
+#ifdef CONFIG_MMCSD_WRQUEUE
+  /* Anything still queued was meant for the removed media */
+
+  wrq_discard(&priv->wrqueue);
+#endif
+
   /* Go back to the default 1-bit data bus. */
 
   SDIO_WIDEBUS(priv->dev, false);
@@ -3399,6 +3505,21 @@ int mmcsd_slotinitialize(int minor, FAR struct sdio_dev_s *dev)
         }
 #endif
 
+#ifdef CONFIG_MMCSD_WRQUEUE
+      /* Initialize the write queue */
+
+      priv->wrqueue.maxblocks = CONFIG_MMCSD_WRQUEUE_NBLOCKS;
+      priv->wrqueue.dev       = priv;
+      priv->wrqueue.flush     = mmcsd_wrqflush;
+
+      ret = wrq_initialize(&priv->wrqueue);
+      if (ret < 0)
+        {
+          ferr("ERROR: Write queue setup failed: %d\n", ret);
+          goto errout_with_buffers;
+        }
+#endif
+
       /* Create a MMCSD device name */
 
       snprintf(devname, 16, "/dev/mmcsd%d", minor);
@@ -3409,12 +3530,16 @@ int mmcsd_slotinitialize(int minor, FAR struct sdio_dev_s *dev)
       if (ret < 0)
         {
           ferr("ERROR: register_blockdriver failed: %d\n", ret);
-          goto errout_with_buffers;
+          goto errout_with_wrqueue;
         }
     }
   return OK;
 
+errout_with_wrqueue:
+#ifdef CONFIG_MMCSD_WRQUEUE
+  wrq_uninitialize(&priv->wrqueue);
 errout_with_buffers:
+#endif
 #if defined(CONFIG_DRVR_WRITEBUFFER) || defined(CONFIG_DRVR_READAHEAD)
   rwb_uninitialize(&priv->rwbuffer);
 errout_with_hwinit:
@@ -0,0 +1,556 @@
+/****************************************************************************
+ * drivers/mmcsd/mmcsd_wrqueue.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/kmalloc.h>
+#include <nuttx/clock.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/wqueue.h>
+
+#include "mmcsd_wrqueue.h"
+
+#ifdef CONFIG_MMCSD_WRQUEUE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_SCHED_LPWORK
+#  error "The MMC/SD write queue requires CONFIG_SCHED_LPWORK"
+#endif
+
+#ifndef CONFIG_MMCSD_WRQUEUE_DELAY
+#  define CONFIG_MMCSD_WRQUEUE_DELAY 100
+#endif
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: wrq_merge
+ *
+ * Description:
+ *   Try to merge a write into the staging buffer using the elevator merge
+ *   of blkmerge_add().
+ *
+ * Returned Value:
+ *   true if the data was merged into the buffer.
+ *
+ ****************************************************************************/
+
+static bool wrq_merge(FAR struct mmcsd_wrqueue_s *wrq,
+                      FAR struct wrq_buffer_s *buf, off_t startblock,
+                      size_t nblocks, FAR const uint8_t *src)
+{
+  if (buf->run.nblocks == 0)
+    {
+      buf->generation = wrq->generation;
+    }
+
+  return blkmerge_add(&buf->run, wrq->blocksize, wrq->maxblocks,
+                      startblock, nblocks, src);
+}
+
+/****************************************************************************
+ * Name: wrq_xferworker
+ *
+ * Description:
+ *   Transfer the submitted staging buffer to the card.  This runs on the
+ *   low priority work queue so that the writing thread can fill the other
+ *   buffer while this transfer is in progress.
+ *
+ ****************************************************************************/
+
+static void wrq_xferworker(FAR void *arg)
+{
+  FAR struct mmcsd_wrqueue_s *wrq = (FAR struct mmcsd_wrqueue_s *)arg;
+  FAR struct wrq_buffer_s *buf = &wrq->buffer[wrq->xfer];
+  ssize_t ret;
+
+  /* Data queued for media that has since been removed is just dropped */
+
+  if (buf->generation == wrq->generation)
+    {
+      ret = wrq->flush(wrq->dev, buf->run.data, buf->run.startblock,
+                       buf->run.nblocks);
+      if (ret < 0)
+        {
+          ferr("ERROR: Write of %u blocks at %lu failed: %d\n",
+               (unsigned int)buf->run.nblocks,
+               (unsigned long)buf->run.startblock, (int)ret);
+
+          /* Report the failure on the next write or sync */
+
+          wrq->result = (int)ret;
+        }
+    }
+
+  /* Give the buffer back */
+
+  buf->run.nblocks = 0;
+  nxsem_post(&wrq->xfersem);
+}
+
+/****************************************************************************
+ * Name: wrq_handoff
+ *
+ * Description:
+ *   Pass the filling buffer to the worker and start filling the other one.
+ *   The caller holds exclsem and has already taken xfersem.
+ *
+ ****************************************************************************/
+
+static void wrq_handoff(FAR struct mmcsd_wrqueue_s *wrq)
+{
+  wrq->xfer  = wrq->fill;
+  wrq->fill ^= 1;
+
+  (void)work_queue(LPWORK, &wrq->xferwork, wrq_xferworker,
+                   (FAR void *)wrq, 0);
+}
+
+/****************************************************************************
+ * Name: wrq_submit
+ *
+ * Description:
+ *   Submit the filling buffer (if it holds anything) for transfer.  This
+ *   waits until the previous transfer has released the other buffer.  The
+ *   caller holds exclsem.
+ *
+ ****************************************************************************/
+
+static int wrq_submit(FAR struct mmcsd_wrqueue_s *wrq)
+{
+  int ret;
+
+  if (wrq->buffer[wrq->fill].run.nblocks == 0)
+    {
+      return OK;
+    }
+
+  ret = nxsem_wait_uninterruptible(&wrq->xfersem);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  wrq_handoff(wrq);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: wrq_waitidle
+ *
+ * Description:
+ *   Wait until no transfer is in progress.  The caller holds exclsem so no
+ *   new transfer can be submitted.
+ *
+ ****************************************************************************/
+
+static int wrq_waitidle(FAR struct mmcsd_wrqueue_s *wrq)
+{
+  int ret;
+
+  ret = nxsem_wait_uninterruptible(&wrq->xfersem);
+  if (ret >= 0)
+    {
+      nxsem_post(&wrq->xfersem);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: wrq_idleworker
+ *
+ * Description:
+ *   Submit a partially filled buffer after a period with no write
+ *   activity.  This must not block:  The transfer worker may be queued
+ *   behind it on the same work queue.
+ *
+ ****************************************************************************/
+
+static void wrq_idleworker(FAR void *arg)
+{
+  FAR struct mmcsd_wrqueue_s *wrq = (FAR struct mmcsd_wrqueue_s *)arg;
+
+  /* If a writer is active, it will restart the delay when it is done */
+
+  if (nxsem_trywait(&wrq->exclsem) < 0)
+    {
+      return;
+    }
+
+  if (wrq->buffer[wrq->fill].run.nblocks > 0)
+    {
+      if (nxsem_trywait(&wrq->xfersem) < 0)
+        {
+          /* The other buffer is still busy.  Try again later. */
+
+          (void)work_queue(LPWORK, &wrq->idlework, wrq_idleworker,
+                           (FAR void *)wrq,
+                           MSEC2TICK(CONFIG_MMCSD_WRQUEUE_DELAY));
+        }
+      else
+        {
+          wrq_handoff(wrq);
+        }
+    }
+
+  nxsem_post(&wrq->exclsem);
+}
+
+/****************************************************************************
+ * Name: wrq_setup
+ *
+ * Description:
+ *   (Re-)allocate the staging buffers for a new block size.  The block size
+ *   only changes when different media is inserted; anything still queued
+ *   for the old media has already been discarded.
+ *
+ ****************************************************************************/
+
+static int wrq_setup(FAR struct mmcsd_wrqueue_s *wrq, uint16_t blocksize)
+{
+  size_t allocsize = (size_t)wrq->maxblocks * blocksize;
+  int ret;
+  int i;
+
+  ret = nxsem_wait_uninterruptible(&wrq->xfersem);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      if (wrq->buffer[i].run.data != NULL)
+        {
+          kmm_free(wrq->buffer[i].run.data);
+        }
+
+      wrq->buffer[i].run.data    = (FAR uint8_t *)kmm_malloc(allocsize);
+      wrq->buffer[i].run.nblocks = 0;
+    }
+
+  if (wrq->buffer[0].run.data == NULL ||
+      wrq->buffer[1].run.data == NULL)
+    {
+      ferr("ERROR: Failed to allocate write queue buffers\n");
+      wrq->blocksize = 0;
+      ret = -ENOMEM;
+    }
+  else
+    {
+      wrq->blocksize = blocksize;
+    }
+
+  nxsem_post(&wrq->xfersem);
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: wrq_initialize
+ *
+ * Description:
+ *   Initialize the write queue.  The staging buffers are allocated on the
+ *   first write, when the block size of the media is known.
+ *
+ ****************************************************************************/
+
+int wrq_initialize(FAR struct mmcsd_wrqueue_s *wrq)
+{
+  DEBUGASSERT(wrq != NULL && wrq->flush != NULL && wrq->maxblocks > 0);
+
+  nxsem_init(&wrq->exclsem, 0, 1);
+  nxsem_init(&wrq->xfersem, 0, 1);
+
+  memset(&wrq->xferwork, 0, sizeof(struct work_s));
+  memset(&wrq->idlework, 0, sizeof(struct work_s));
+  memset(wrq->buffer, 0, sizeof(wrq->buffer));
+
+  wrq->blocksize  = 0;
+  wrq->generation = 0;
+  wrq->fill       = 0;
+  wrq->xfer       = 1;
+  wrq->result     = OK;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: wrq_uninitialize
+ *
+ * Description:
+ *   Drain the write queue and release its resources.
+ *
+ ****************************************************************************/
+
+void wrq_uninitialize(FAR struct mmcsd_wrqueue_s *wrq)
+{
+  int i;
+
+  (void)work_cancel(LPWORK, &wrq->idlework);
+  (void)wrq_sync(wrq, 0, 0);
+
+  for (i = 0; i < 2; i++)
+    {
+      if (wrq->buffer[i].run.data != NULL)
+        {
+          kmm_free(wrq->buffer[i].run.data);
+          wrq->buffer[i].run.data = NULL;
+        }
+    }
+
+  nxsem_destroy(&wrq->exclsem);
+  nxsem_destroy(&wrq->xfersem);
+}
+
+/****************************************************************************
+ * Name: wrq_write
+ *
+ * Description:
+ *   Queue blocks for writing.  The data is copied into the filling buffer,
+ *   merging with the blocks already there when possible.  When the buffer
+ *   is full or a write cannot be merged, the buffer is handed to the
+ *   worker and the other buffer becomes the filling buffer.  Writes larger
+ *   than a staging buffer are written directly after draining the queue.
+ *
+ * Returned Value:
+ *   The number of blocks accepted or a negated errno value.  Errors from
+ *   earlier, asynchronous transfers are returned here.
+ *
+ ****************************************************************************/
+
+ssize_t wrq_write(FAR struct mmcsd_wrqueue_s *wrq, uint16_t blocksize,
+                  off_t startblock, size_t nblocks,
+                  FAR const uint8_t *buffer)
+{
+  FAR struct wrq_buffer_s *fill;
+  bool pending = false;
+  ssize_t ret;
+
+  DEBUGASSERT(wrq != NULL && buffer != NULL && blocksize > 0);
+
+  ret = nxsem_wait_uninterruptible(&wrq->exclsem);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Report any failure of an earlier transfer */
+
+  if (wrq->result < 0)
+    {
+      ret = wrq->result;
+      wrq->result = OK;
+      goto errout_with_lock;
+    }
+
+  if (blocksize != wrq->blocksize)
+    {
+      ret = wrq_setup(wrq, blocksize);
+      if (ret < 0)
+        {
+          goto errout_with_lock;
+        }
+    }
+
+  /* Don't merge with data queued for media that has been removed */
+
+  fill = &wrq->buffer[wrq->fill];
+  if (fill->generation != wrq->generation)
+    {
+      fill->run.nblocks = 0;
+    }
+
+  if (nblocks > wrq->maxblocks)
+    {
+      /* Too large to stage.  Drain the queue, then write directly from the
+       * caller's buffer.
+       */
+
+      ret = wrq_submit(wrq);
+      if (ret >= 0)
+        {
+          ret = nxsem_wait_uninterruptible(&wrq->xfersem);
+        }
+
+      if (ret >= 0)
+        {
+          ret = wrq->flush(wrq->dev, buffer, startblock, nblocks);
+          nxsem_post(&wrq->xfersem);
+        }
+    }
+  else
+    {
+      if (!wrq_merge(wrq, fill, startblock, nblocks, buffer))
+        {
+          /* Not contiguous with the queued blocks.  Start the transfer of
+           * what we have and begin a new run in the other buffer.
+           */
+
+          ret = wrq_submit(wrq);
+          if (ret < 0)
+            {
+              goto errout_with_lock;
+            }
+
+          fill = &wrq->buffer[wrq->fill];
+          (void)wrq_merge(wrq, fill, startblock, nblocks, buffer);
+        }
+
+      /* Start the transfer as soon as the buffer is full */
+
+      if (fill->run.nblocks >= wrq->maxblocks)
+        {
+          ret = wrq_submit(wrq);
+          if (ret < 0)
+            {
+              goto errout_with_lock;
+            }
+        }
+
+      pending = wrq->buffer[wrq->fill].run.nblocks > 0;
+      ret     = nblocks;
+    }
+
+  nxsem_post(&wrq->exclsem);
+
+  /* Restart the delay before a partially filled buffer is submitted */
+
+  if (pending)
+    {
+      (void)work_queue(LPWORK, &wrq->idlework, wrq_idleworker,
+                       (FAR void *)wrq,
+                       MSEC2TICK(CONFIG_MMCSD_WRQUEUE_DELAY));
+    }
+
+  return ret;
+
+errout_with_lock:
+  nxsem_post(&wrq->exclsem);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: wrq_sync
+ *
+ * Description:
+ *   Make sure that any queued data for the range startblock through
+ *   startblock + nblocks - 1 has been written to the card.  This is used
+ *   before reading so that reads always return the newest data.  If
+ *   nblocks is zero, the whole queue is drained and any error from an
+ *   earlier transfer is returned.
+ *
+ ****************************************************************************/
+
+int wrq_sync(FAR struct mmcsd_wrqueue_s *wrq, off_t startblock,
+             size_t nblocks)
+{
+  FAR struct wrq_buffer_s *fill;
+  FAR struct wrq_buffer_s *xfer;
+  int ret;
+
+  DEBUGASSERT(wrq != NULL);
+
+  ret = nxsem_wait_uninterruptible(&wrq->exclsem);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  fill = &wrq->buffer[wrq->fill];
+  xfer = &wrq->buffer[wrq->xfer];
+
+  if (nblocks == 0 ||
+      blkmerge_overlaps(&fill->run, startblock, nblocks))
+    {
+      ret = wrq_submit(wrq);
+      if (ret >= 0)
+        {
+          ret = wrq_waitidle(wrq);
+        }
+    }
+  else if (blkmerge_overlaps(&xfer->run, startblock, nblocks))
+    {
+      ret = wrq_waitidle(wrq);
+    }
+
+  if (ret >= 0 && nblocks == 0)
+    {
+      ret = wrq->result;
+      wrq->result = OK;
+    }
+
+  nxsem_post(&wrq->exclsem);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: wrq_discard
+ *
+ * Description:
+ *   Discard everything queued for the current media.  This may be called
+ *   with the card locked, so it does not wait for anything:  It just starts
+ *   a new generation and the stale buffers are dropped when they are next
+ *   touched.
+ *
+ ****************************************************************************/
+
+void wrq_discard(FAR struct mmcsd_wrqueue_s *wrq)
+{
+  wrq->generation++;
+}
+
+#endif /* CONFIG_MMCSD_WRQUEUE */
@@ -0,0 +1,147 @@
+/****************************************************************************
+ * drivers/mmcsd/mmcsd_wrqueue.h
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __DRIVERS_MMCSD_MMCSD_WRQUEUE_H
+#define __DRIVERS_MMCSD_MMCSD_WRQUEUE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <semaphore.h>
+
+#include <nuttx/wqueue.h>
+#include <nuttx/drivers/blkmerge.h>
+
+#ifdef CONFIG_MMCSD_WRQUEUE
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Transfer callout.  This must be provided by the block driver.  It is
+ * called from the low priority work queue (or from the writing thread
+ * for writes that are too large to be queued) and must obtain exclusive
+ * access to the card by itself.
+ */
+
+typedef ssize_t (*wrqflush_t)(FAR void *dev, FAR const uint8_t *buffer,
+                              off_t startblock, size_t nblocks);
+
+/* One staging buffer.  There are two of these:  One is filled and merged
+ * by the writing threads while the other is being transferred to the card
+ * by the worker.
+ */
+
+struct wrq_buffer_s
+{
+  struct blk_run_s run;          /* Up to maxblocks staged blocks */
+  uint16_t      generation;      /* Queue generation when filled */
+};
+
+/* This structure holds the state of the write queue.  It is declared
+ * within the block driver state structure and initialized like:
+ *
+ *  ... [Setup maxblocks, dev, flush] ...
+ *  ret = wrq_initialize(&priv->wrqueue);
+ */
+
+struct mmcsd_wrqueue_s
+{
+  /********************************************************************/
+  /* These values must be provided by the user prior to calling
+   * wrq_initialize()
+   */
+
+  uint16_t      maxblocks;       /* Blocks in each staging buffer */
+  FAR void     *dev;             /* Device state passed to the callout */
+  wrqflush_t    flush;           /* Callout to transfer blocks to the card */
+
+  /********************************************************************/
+  /* The user should never modify any of the remaining fields */
+
+  sem_t         exclsem;         /* Exclusive access to the filling buffer */
+  sem_t         xfersem;         /* Held while a buffer is owned by the worker */
+  struct work_s xferwork;        /* Transfers the submitted buffer */
+  struct work_s idlework;        /* Submits a partial buffer after a delay */
+  struct wrq_buffer_s buffer[2]; /* The staging buffers */
+  uint16_t      blocksize;       /* Block size the buffers were sized for */
+  uint16_t      generation;      /* Incremented when queued data is discarded */
+  uint8_t       fill;            /* Index of the buffer being filled */
+  uint8_t       xfer;            /* Index of the buffer being transferred */
+  int           result;          /* Deferred error from the last transfer */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/* Initialization */
+
+int wrq_initialize(FAR struct mmcsd_wrqueue_s *wrq);
+void wrq_uninitialize(FAR struct mmcsd_wrqueue_s *wrq);
+
+/* Queued writes */
+
+ssize_t wrq_write(FAR struct mmcsd_wrqueue_s *wrq, uint16_t blocksize,
+                  off_t startblock, size_t nblocks,
+                  FAR const uint8_t *buffer);
+
+/* Synchronization with the card */
+
+int wrq_sync(FAR struct mmcsd_wrqueue_s *wrq, off_t startblock,
+             size_t nblocks);
+void wrq_discard(FAR struct mmcsd_wrqueue_s *wrq);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_MMCSD_WRQUEUE */
+#endif /* __DRIVERS_MMCSD_MMCSD_WRQUEUE_H */
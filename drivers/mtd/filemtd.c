@@ -569,6 +569,13 @@ FAR struct mtd_dev_s *blockmtd_initialize(FAR const char *path, size_t offset,
 #endif
   priv->mtd.ioctl  = filemtd_ioctl;
   priv->mtd.name   = "filemtd";
+#ifdef CONFIG_MTD_BATCH
+  /* File accesses are synchronous.  Batches are performed before
+   * submit() returns.
+   */
+
+  priv->mtd.submit = mtd_batch_execute;
+#endif
   priv->offset     = offset;
   priv->nblocks    = nblocks;
 
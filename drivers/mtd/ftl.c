@@ -57,88 +57,1360 @@
 #include <nuttx/mtd/mtd.h>
 #include <nuttx/drivers/rwbuffer.h>
 
+#ifdef CONFIG_FTL_LOGSTRUCT
+#  include <stddef.h>
+#  include <crc32.h>
+#  include <nuttx/clock.h>
+#  include <nuttx/semaphore.h>
+#  include <nuttx/wqueue.h>
+#endif
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Check if read/write buffer support is needed */
+
+#if defined(CONFIG_FTL_READAHEAD) || defined(CONFIG_FTL_WRITEBUFFER)
+#  define FTL_HAVE_RWBUFFER 1
+#endif
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+#  ifndef CONFIG_FTL_LOG_NCACHE
+#    define CONFIG_FTL_LOG_NCACHE 8
+#  endif
+
+#  ifndef CONFIG_FTL_LOG_SPARE
+#    define CONFIG_FTL_LOG_SPARE 10
+#  endif
+
+#  ifndef CONFIG_FTL_LOG_GCTHRESH
+#    define CONFIG_FTL_LOG_GCTHRESH 4
+#  endif
+
+#  ifndef CONFIG_FTL_LOG_WEARTHRESH
+#    define CONFIG_FTL_LOG_WEARTHRESH 64
+#  endif
+
+#  ifndef CONFIG_FTL_LOG_FLUSHDELAY
+#    define CONFIG_FTL_LOG_FLUSHDELAY 500
+#  endif
+
+/* Log headers */
+
+#  define FTL_LOG_SEGMAGIC 0x53475446  /* "FTGS" segment header */
+#  define FTL_LOG_RECMAGIC 0x52475446  /* "FTGR" record header */
+
+/* Unmapped sector, unknown erase block */
+
+#  define FTL_LOG_UNMAPPED 0xffffffff
+
+/* The garbage collector needs at least this many spare erase blocks */
+
+#  define FTL_LOG_MINSPARE 3
+
+/* Erase block states */
+
+#  define FTL_LOG_FREE     0           /* Erased */
+#  define FTL_LOG_USED     1           /* Holds a segment */
+
+/* Size of a record header with n sectors */
+
+#  define SIZEOF_FTL_LOGREC_S(n) \
+    (sizeof(struct ftl_logrec_s) + ((n) - 1) * sizeof(uint32_t))
+#endif
+
+/* The maximum length of the device name paths is the maximum length of a
+ * name plus 5 for the the length of "/dev/" and a NUL terminator.
+ */
+
+#define DEV_NAME_MAX    (NAME_MAX + 5)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+/* The first page of each erase block that holds data is a segment header */
+
+begin_packed_struct struct ftl_logseg_s
+{
+  uint32_t magic;                /* FTL_LOG_SEGMAGIC */
+  uint32_t seq;                  /* Order in which segments were written */
+  uint32_t erasecnt;             /* Number of erasures of the erase block */
+  uint32_t crc;                  /* CRC32 of the fields above */
+} end_packed_struct;
+
+/* The segment header is followed by records, each of which is a header
+ * page followed by the data pages of nsectors sectors.
+ */
+
+begin_packed_struct struct ftl_logrec_s
+{
+  uint32_t magic;                /* FTL_LOG_RECMAGIC */
+  uint16_t nsectors;             /* Number of data pages that follow */
+  uint16_t reserved;
+  uint32_t datacrc;              /* CRC32 of the data pages */
+  uint32_t crc;                  /* CRC32 of the header (crc == 0) */
+  uint32_t sector[1];            /* Logical sector of each data page */
+} end_packed_struct;
+
+/* Write-back cache entry */
+
+struct ftl_logcache_s
+{
+  uint32_t sector;               /* Logical sector or FTL_LOG_UNMAPPED */
+  bool     dirty;                /* Not yet written to the log */
+};
+
+/* Used to sort the segments at mount time */
+
+struct ftl_logsort_s
+{
+  uint32_t seq;
+  uint32_t eblock;
+};
+#endif
+
+struct ftl_struct_s
+{
+  FAR struct mtd_dev_s *mtd;     /* Contained MTD interface */
+  struct mtd_geometry_s geo;     /* Device geometry */
+#ifdef FTL_HAVE_RWBUFFER
+  struct rwbuffer_s     rwb;     /* Read-ahead/write buffer support */
+#endif
+  uint16_t              blkper;  /* R/W blocks per erase block */
+  uint16_t              refs;    /* Number of references */
+  bool                  unlinked;/* The driver has been unlinked */
+#ifdef CONFIG_FS_WRITABLE
+  FAR uint8_t          *eblock;  /* One, in-memory erase block */
+#endif
+#ifdef CONFIG_FTL_LOGSTRUCT
+  sem_t                 exclsem;   /* Exclusive access to the log */
+  uint32_t              nsectors;  /* Number of logical sectors */
+  uint16_t              maxrec;    /* Max sectors per record */
+  uint16_t              nfree;     /* Number of free erase blocks */
+  uint16_t              gcthresh;  /* Free erase blocks kept by the worker */
+  uint32_t              seq;       /* Last segment sequence number */
+  uint32_t              openblk;   /* Erase block being written or
+                                    * FTL_LOG_UNMAPPED */
+  uint16_t              wrptr;     /* Next page in openblk */
+  uint16_t              cnext;     /* Next cache entry to replace */
+  uint32_t              nwritten;  /* Pages written (statistics) */
+  uint32_t              nerased;   /* Erase blocks reclaimed (statistics) */
+  FAR uint32_t         *map;       /* Sector -> page mapping table */
+  FAR uint16_t         *valid;     /* Valid pages per erase block */
+  FAR uint32_t         *erasecnt;  /* Erase count per erase block */
+  FAR uint8_t          *state;     /* State of each erase block */
+  FAR uint8_t          *page;      /* One page for headers */
+  FAR uint8_t          *cdata;     /* Write-back cache data */
+  FAR uint32_t         *gcsectors; /* Sectors copied by the GC */
+  FAR uint8_t         **bufs;      /* Data of the sectors copied by the GC */
+  struct ftl_logcache_s cache[CONFIG_FTL_LOG_NCACHE];
+  uint32_t              csectors[CONFIG_FTL_LOG_NCACHE];
+  FAR uint8_t          *cbufs[CONFIG_FTL_LOG_NCACHE];
+#ifdef CONFIG_SCHED_LPWORK
+  struct work_s         work;      /* Background flush and GC */
+  sem_t                 donesem;   /* Posted when a closed worker exits */
+  bool                  busy;      /* work is queued or running */
+  bool                  closing;   /* The log is being uninitialized */
+#endif
+#endif
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int     ftl_open(FAR struct inode *inode);
+static int     ftl_close(FAR struct inode *inode);
+#ifndef CONFIG_FTL_LOGSTRUCT
+static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
+                 off_t startblock, size_t nblocks);
+#endif
+static ssize_t ftl_read(FAR struct inode *inode, unsigned char *buffer,
+                 size_t start_sector, unsigned int nsectors);
+#ifdef CONFIG_FS_WRITABLE
+#ifndef CONFIG_FTL_LOGSTRUCT
+static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
+                 off_t startblock, size_t nblocks);
+#endif
+static ssize_t ftl_write(FAR struct inode *inode, const unsigned char *buffer,
+                 size_t start_sector, unsigned int nsectors);
+#endif
+static int     ftl_geometry(FAR struct inode *inode, struct geometry *geometry);
+static int     ftl_ioctl(FAR struct inode *inode, int cmd, unsigned long arg);
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+static int     ftl_unlink(FAR struct inode *inode);
+#endif
+#ifdef CONFIG_FTL_LOGSTRUCT
+static int     ftl_log_gc(FAR struct ftl_struct_s *dev, bool wear);
+static int     ftl_log_cachefind(FAR struct ftl_struct_s *dev,
+                 uint32_t sector);
+static int     ftl_log_cachevictim(FAR struct ftl_struct_s *dev);
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const struct block_operations g_bops =
+{
+  ftl_open,     /* open     */
+  ftl_close,    /* close    */
+  ftl_read,     /* read     */
+#ifdef CONFIG_FS_WRITABLE
+  ftl_write,    /* write    */
+#else
+  NULL,         /* write    */
+#endif
+  ftl_geometry, /* geometry */
+  ftl_ioctl     /* ioctl    */
+#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
+  , ftl_unlink  /* unlink   */
+#endif
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ftl_log_remap
+ *
+ * Description:
+ *   Record that a logical sector now lives in a new physical page (or in
+ *   none for FTL_LOG_UNMAPPED) and update the counts of valid pages of the
+ *   old and new erase blocks.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+static void ftl_log_remap(FAR struct ftl_struct_s *dev, uint32_t sector,
+                          uint32_t page)
+{
+  uint32_t old;
+
+  if (sector >= dev->nsectors)
+    {
+      return;
+    }
+
+  old = dev->map[sector];
+  if (old != FTL_LOG_UNMAPPED)
+    {
+      DEBUGASSERT(dev->valid[old / dev->blkper] > 0);
+      dev->valid[old / dev->blkper]--;
+    }
+
+  dev->map[sector] = page;
+  if (page != FTL_LOG_UNMAPPED)
+    {
+      dev->valid[page / dev->blkper]++;
+    }
+}
+
+/****************************************************************************
+ * Name: ftl_log_readrec
+ *
+ * Description:
+ *   Read the record header at a page of an erase block into dev->page and
+ *   check it.
+ *
+ * Returned Value:
+ *   A reference to the record header in dev->page or NULL if there is no
+ *   valid record at the page.
+ *
+ ****************************************************************************/
+
+static FAR struct ftl_logrec_s *
+ftl_log_readrec(FAR struct ftl_struct_s *dev, uint32_t eblock, uint16_t pgndx)
+{
+  FAR struct ftl_logrec_s *rec = (FAR struct ftl_logrec_s *)dev->page;
+  uint32_t crc;
+  ssize_t nread;
+
+  nread = MTD_BREAD(dev->mtd, eblock * dev->blkper + pgndx, 1, dev->page);
+  if (nread != 1 || rec->magic != FTL_LOG_RECMAGIC ||
+      rec->nsectors == 0 || rec->nsectors > dev->maxrec ||
+      pgndx + 1 + rec->nsectors > dev->blkper)
+    {
+      return NULL;
+    }
+
+  crc      = rec->crc;
+  rec->crc = 0;
+  if (crc32(dev->page, SIZEOF_FTL_LOGREC_S(rec->nsectors)) != crc)
+    {
+      return NULL;
+    }
+
+  rec->crc = crc;
+  return rec;
+}
+
+/****************************************************************************
+ * Name: ftl_log_freepages
+ *
+ * Description:
+ *   Return the number of pages that can still be written:  Those of the
+ *   free erase blocks and those left in the open segment.  A garbage
+ *   collector pass made progress only if this grew.
+ *
+ ****************************************************************************/
+
+static uint32_t ftl_log_freepages(FAR struct ftl_struct_s *dev)
+{
+  uint32_t npages = (uint32_t)dev->nfree * dev->blkper;
+
+  if (dev->openblk != FTL_LOG_UNMAPPED)
+    {
+      npages += dev->blkper - dev->wrptr;
+    }
+
+  return npages;
+}
+
+/****************************************************************************
+ * Name: ftl_log_newseg
+ *
+ * Description:
+ *   Start writing a new segment in the free erase block with the lowest
+ *   erase count.  One free erase block is held back for the garbage
+ *   collector; ordinary writes run the garbage collector first when only
+ *   that one is left.
+ *
+ ****************************************************************************/
+
+static int ftl_log_newseg(FAR struct ftl_struct_s *dev, bool gc)
+{
+  FAR struct ftl_logseg_s *seg = (FAR struct ftl_logseg_s *)dev->page;
+  uint32_t eblock;
+  uint32_t best;
+  uint32_t npages;
+  int ret;
+
+  /* Make room if this is not the garbage collector itself.  Give up when a
+   * pass does not free any space.
+   */
+
+  while (!gc && dev->nfree <= 1)
+    {
+      npages = ftl_log_freepages(dev);
+      ret    = ftl_log_gc(dev, false);
+      if (ret >= 0 && ftl_log_freepages(dev) <= npages)
+        {
+          ret = -ENOSPC;
+        }
+
+      if (ret < 0)
+        {
+          ferr("ERROR: No free erase block: %d\n", ret);
+          return ret;
+        }
+    }
+
+  if (dev->nfree == 0)
+    {
+      return -ENOSPC;
+    }
+
+  /* Pick the free erase block with the fewest erasures */
+
+  best = FTL_LOG_UNMAPPED;
+  for (eblock = 0; eblock < dev->geo.neraseblocks; eblock++)
+    {
+      if (dev->state[eblock] == FTL_LOG_FREE &&
+          (best == FTL_LOG_UNMAPPED ||
+           dev->erasecnt[eblock] < dev->erasecnt[best]))
+        {
+          best = eblock;
+        }
+    }
+
+  DEBUGASSERT(best != FTL_LOG_UNMAPPED);
+
+  /* Write the segment header into the first page */
+
+  memset(dev->page, 0xff, dev->geo.blocksize);
+  seg->magic    = FTL_LOG_SEGMAGIC;
+  seg->seq      = ++dev->seq;
+  seg->erasecnt = dev->erasecnt[best];
+  seg->crc      = crc32(dev->page, offsetof(struct ftl_logseg_s, crc));
+
+  dev->state[best] = FTL_LOG_USED;
+  dev->valid[best] = 0;
+  dev->nfree--;
+
+  if (MTD_BWRITE(dev->mtd, best * dev->blkper, 1, dev->page) != 1)
+    {
+      ferr("ERROR: Write segment header to erase block %lu failed\n",
+           (unsigned long)best);
+
+      /* The erase block holds no data and will be reclaimed */
+
+      dev->openblk = FTL_LOG_UNMAPPED;
+      return -EIO;
+    }
+
+  dev->openblk = best;
+  dev->wrptr   = 1;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_writerec
+ *
+ * Description:
+ *   Append sectors to the log.  Each record consists of a header page
+ *   holding the list of logical sectors and a CRC of the data followed by
+ *   the data pages.  The pages are always programmed in order.
+ *
+ ****************************************************************************/
+
+static int ftl_log_writerec(FAR struct ftl_struct_s *dev,
+                            FAR const uint32_t *sectors,
+                            FAR uint8_t * const *bufs, int n, bool gc)
+{
+  FAR struct ftl_logrec_s *rec = (FAR struct ftl_logrec_s *)dev->page;
+  uint32_t page;
+  int nrec;
+  int ret;
+  int i;
+
+  while (n > 0)
+    {
+      /* Is there room for a header and at least one data page? */
+
+      if (dev->openblk == FTL_LOG_UNMAPPED || dev->wrptr + 2 > dev->blkper)
+        {
+          ret = ftl_log_newseg(dev, gc);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+
+      nrec = dev->blkper - dev->wrptr - 1;
+      if (nrec > dev->maxrec)
+        {
+          nrec = dev->maxrec;
+        }
+
+      if (nrec > n)
+        {
+          nrec = n;
+        }
+
+      /* Build the record header */
+
+      memset(dev->page, 0xff, dev->geo.blocksize);
+      rec->magic    = FTL_LOG_RECMAGIC;
+      rec->nsectors = nrec;
+      rec->datacrc  = 0;
+
+      for (i = 0; i < nrec; i++)
+        {
+          rec->sector[i] = sectors[i];
+          rec->datacrc   = crc32part(bufs[i], dev->geo.blocksize,
+                                     rec->datacrc);
+        }
+
+      rec->crc = 0;
+      rec->crc = crc32(dev->page, SIZEOF_FTL_LOGREC_S(nrec));
+
+      /* Write the header and then the data */
+
+      page = dev->openblk * dev->blkper + dev->wrptr;
+      if (MTD_BWRITE(dev->mtd, page, 1, dev->page) != 1)
+        {
+          goto errout_with_segment;
+        }
+
+      for (i = 0; i < nrec; i++)
+        {
+          if (MTD_BWRITE(dev->mtd, page + 1 + i, 1, bufs[i]) != 1)
+            {
+              goto errout_with_segment;
+            }
+        }
+
+      dev->nwritten += nrec + 1;
+
+      /* The sectors now live in the new pages */
+
+      for (i = 0; i < nrec; i++)
+        {
+          ftl_log_remap(dev, sectors[i], page + 1 + i);
+        }
+
+      dev->wrptr += nrec + 1;
+      sectors    += nrec;
+      bufs       += nrec;
+      n          -= nrec;
+    }
+
+  return OK;
+
+errout_with_segment:
+
+  /* Never append after a failed write.  The incomplete record is the last
+   * one in the segment and fails its data CRC at the next mount.
+   */
+
+  ferr("ERROR: Write to page %lu failed\n", (unsigned long)page);
+  dev->openblk = FTL_LOG_UNMAPPED;
+  return -EIO;
+}
+
+/****************************************************************************
+ * Name: ftl_log_gc
+ *
+ * Description:
+ *   Reclaim one erase block:  Copy its valid pages to the head of the log
+ *   and erase it.  Normally the block with the fewest valid pages is
+ *   chosen.  For wear levelling, the block with the fewest erasures is
+ *   chosen instead if it lags too far behind the most worn block; this
+ *   moves static data out of rarely erased blocks.
+ *
+ ****************************************************************************/
+
+static int ftl_log_gc(FAR struct ftl_struct_s *dev, bool wear)
+{
+  FAR struct ftl_logrec_s *rec;
+  FAR uint8_t *buffer;
+  uint32_t eblock;
+  uint32_t victim = FTL_LOG_UNMAPPED;
+  uint32_t coldest = FTL_LOG_UNMAPPED;
+  uint32_t maxerase = 0;
+  uint32_t page;
+  uint16_t pgndx;
+  int ncopy = 0;
+  int ret;
+  int i;
+
+  for (eblock = 0; eblock < dev->geo.neraseblocks; eblock++)
+    {
+      if (dev->erasecnt[eblock] > maxerase)
+        {
+          maxerase = dev->erasecnt[eblock];
+        }
+
+      if (dev->state[eblock] != FTL_LOG_USED || eblock == dev->openblk)
+        {
+          continue;
+        }
+
+      if (victim == FTL_LOG_UNMAPPED ||
+          dev->valid[eblock] < dev->valid[victim])
+        {
+          victim = eblock;
+        }
+
+      if (coldest == FTL_LOG_UNMAPPED ||
+          dev->erasecnt[eblock] < dev->erasecnt[coldest])
+        {
+          coldest = eblock;
+        }
+    }
+
+  if (wear)
+    {
+      /* Reclaiming any other erase block now would only copy data that
+       * may soon become invalid.
+       */
+
+      if (coldest == FTL_LOG_UNMAPPED ||
+          maxerase - dev->erasecnt[coldest] <= CONFIG_FTL_LOG_WEARTHRESH)
+        {
+          return OK;
+        }
+
+      victim = coldest;
+    }
+  else if (victim == FTL_LOG_UNMAPPED ||
+           dev->valid[victim] + 2 >= dev->blkper)
+    {
+      /* Nothing can be gained */
+
+      return -ENOSPC;
+    }
+
+  finfo("Reclaim erase block %lu: valid=%u erasecnt=%lu\n",
+        (unsigned long)victim, dev->valid[victim],
+        (unsigned long)dev->erasecnt[victim]);
+
+  /* Gather the valid pages.  They always fit into one erase block
+   * buffer.
+   */
+
+  for (pgndx = 1; dev->valid[victim] > 0 && pgndx < dev->blkper; )
+    {
+      rec = ftl_log_readrec(dev, victim, pgndx);
+      if (rec == NULL)
+        {
+          break;
+        }
+
+      for (i = 0; i < rec->nsectors; i++)
+        {
+          page = victim * dev->blkper + pgndx + 1 + i;
+          if (rec->sector[i] < dev->nsectors &&
+              dev->map[rec->sector[i]] == page)
+            {
+              DEBUGASSERT(ncopy < dev->blkper);
+              buffer = dev->eblock + ncopy * dev->geo.blocksize;
+
+              if (MTD_BREAD(dev->mtd, page, 1, buffer) != 1)
+                {
+                  ferr("ERROR: Read page %lu failed\n", (unsigned long)page);
+                  return -EIO;
+                }
+
+              dev->gcsectors[ncopy] = rec->sector[i];
+              dev->bufs[ncopy]      = buffer;
+              ncopy++;
+            }
+        }
+
+      pgndx += rec->nsectors + 1;
+    }
+
+  /* Copy them to the head of the log */
+
+  if (ncopy > 0)
+    {
+      ret = ftl_log_writerec(dev, dev->gcsectors, dev->bufs, ncopy, true);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  DEBUGASSERT(dev->valid[victim] == 0);
+
+  /* And erase the block */
+
+  ret = MTD_ERASE(dev->mtd, victim, 1);
+  if (ret < 0)
+    {
+      ferr("ERROR: Erase block=%lu failed: %d\n", (unsigned long)victim, ret);
+      return ret;
+    }
+
+  dev->erasecnt[victim]++;
+  dev->state[victim] = FTL_LOG_FREE;
+  dev->nfree++;
+  dev->nerased++;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_flush
+ *
+ * Description:
+ *   Write all dirty sectors in the write-back cache to the log as one
+ *   record (or more if they do not fit into one).
+ *
+ ****************************************************************************/
+
+static int ftl_log_flush(FAR struct ftl_struct_s *dev)
+{
+  int ndirty = 0;
+  int ret;
+  int i;
+
+  for (i = 0; i < CONFIG_FTL_LOG_NCACHE; i++)
+    {
+      if (dev->cache[i].dirty)
+        {
+          dev->csectors[ndirty] = dev->cache[i].sector;
+          dev->cbufs[ndirty]    = dev->cdata + i * dev->geo.blocksize;
+          ndirty++;
+        }
+    }
+
+  if (ndirty == 0)
+    {
+      return OK;
+    }
+
+  ret = ftl_log_writerec(dev, dev->csectors, dev->cbufs, ndirty, false);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  for (i = 0; i < CONFIG_FTL_LOG_NCACHE; i++)
+    {
+      dev->cache[i].dirty = false;
+    }
+
+  finfo("Flushed %d sectors: written=%lu pages, erased=%lu blocks\n",
+        ndirty, (unsigned long)dev->nwritten, (unsigned long)dev->nerased);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_worker
+ *
+ * Description:
+ *   Runs on the low priority work queue some time after a write:  Flush
+ *   the write-back cache and reclaim erase blocks until enough are free,
+ *   then perform one wear levelling step if needed.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_LPWORK
+static void ftl_log_worker(FAR void *arg)
+{
+  FAR struct ftl_struct_s *dev = (FAR struct ftl_struct_s *)arg;
+  uint32_t npages;
+
+  (void)nxsem_wait_uninterruptible(&dev->exclsem);
+  dev->busy = false;
+
+  /* ftl_log_uninitialize() waits for us before it frees the device */
+
+  if (dev->closing)
+    {
+      nxsem_post(&dev->exclsem);
+      nxsem_post(&dev->donesem);
+      return;
+    }
+
+  (void)ftl_log_flush(dev);
+  while (dev->nfree < dev->gcthresh)
+    {
+      npages = ftl_log_freepages(dev);
+      if (ftl_log_gc(dev, false) < 0 || ftl_log_freepages(dev) <= npages)
+        {
+          break;
+        }
+    }
+
+  if (dev->nfree > 1)
+    {
+      (void)ftl_log_gc(dev, true);
+    }
+
+  nxsem_post(&dev->exclsem);
+}
+#endif
+
+/****************************************************************************
+ * Name: ftl_log_read
+ *
+ * Description:
+ *   Read sectors from the write-back cache or through the mapping table.
+ *   Sectors that were never written read as erased.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_log_read(FAR struct ftl_struct_s *dev,
+                            FAR uint8_t *buffer, size_t start_sector,
+                            unsigned int nsectors)
+{
+  uint32_t sector;
+  uint32_t page;
+  unsigned int nrun;
+  unsigned int i;
+  ssize_t nread;
+  int ndx;
+
+  if (start_sector >= dev->nsectors)
+    {
+      return -EINVAL;
+    }
+
+  if (start_sector + nsectors > dev->nsectors)
+    {
+      nsectors = dev->nsectors - start_sector;
+    }
+
+  (void)nxsem_wait_uninterruptible(&dev->exclsem);
+
+  for (i = 0; i < nsectors; i += nrun)
+    {
+      sector = start_sector + i;
+      nrun   = 1;
+
+      ndx = ftl_log_cachefind(dev, sector);
+      if (ndx >= 0)
+        {
+          memcpy(buffer, dev->cdata + ndx * dev->geo.blocksize,
+                 dev->geo.blocksize);
+        }
+      else if ((page = dev->map[sector]) == FTL_LOG_UNMAPPED)
+        {
+          memset(buffer, 0xff, dev->geo.blocksize);
+        }
+      else
+        {
+          /* Read as many physically contiguous sectors as possible */
+
+          while (i + nrun < nsectors &&
+                 dev->map[sector + nrun] == page + nrun &&
+                 ftl_log_cachefind(dev, sector + nrun) < 0)
+            {
+              nrun++;
+            }
+
+          nread = MTD_BREAD(dev->mtd, page, nrun, buffer);
+          if (nread != nrun)
+            {
+              ferr("ERROR: Read %u pages at %lu failed: %d\n",
+                   nrun, (unsigned long)page, (int)nread);
+              nxsem_post(&dev->exclsem);
+              return nread < 0 ? nread : -EIO;
+            }
+        }
+
+      buffer += nrun * dev->geo.blocksize;
+    }
+
+  nxsem_post(&dev->exclsem);
+  return nsectors;
+}
+
+/****************************************************************************
+ * Name: ftl_log_write
+ *
+ * Description:
+ *   Write sectors into the write-back cache.  The cache is written to the
+ *   log when it is full, on BIOC_FLUSH, on close, and (with the low
+ *   priority work queue) CONFIG_FTL_LOG_FLUSHDELAY milliseconds after a
+ *   write.
+ *
+ ****************************************************************************/
+
+static ssize_t ftl_log_write(FAR struct ftl_struct_s *dev,
+                             FAR const uint8_t *buffer, size_t start_sector,
+                             unsigned int nsectors)
+{
+  uint32_t sector;
+  unsigned int i;
+  int ndx;
+  int ret;
+
+  if (start_sector + nsectors > dev->nsectors)
+    {
+      return -EINVAL;
+    }
+
+  (void)nxsem_wait_uninterruptible(&dev->exclsem);
+
+  for (i = 0; i < nsectors; i++)
+    {
+      sector = start_sector + i;
+      ndx    = ftl_log_cachefind(dev, sector);
+      if (ndx < 0)
+        {
+          /* Take a clean or empty entry, flushing the cache if there is
+           * none.
+           */
+
+          ndx = ftl_log_cachevictim(dev);
+          if (ndx < 0)
+            {
+              ret = ftl_log_flush(dev);
+              if (ret < 0)
+                {
+                  nxsem_post(&dev->exclsem);
+                  return i > 0 ? (ssize_t)i : ret;
+                }
+
+              ndx = ftl_log_cachevictim(dev);
+              DEBUGASSERT(ndx >= 0);
+            }
+
+          dev->cache[ndx].sector = sector;
+        }
+
+      memcpy(dev->cdata + ndx * dev->geo.blocksize, buffer,
+             dev->geo.blocksize);
+      dev->cache[ndx].dirty = true;
+      buffer += dev->geo.blocksize;
+    }
+
+#ifdef CONFIG_SCHED_LPWORK
+  /* Flush later on the worker thread */
+
+  if (!dev->closing && work_available(&dev->work) &&
+      work_queue(LPWORK, &dev->work, ftl_log_worker, dev,
+                 MSEC2TICK(CONFIG_FTL_LOG_FLUSHDELAY)) >= 0)
+    {
+      dev->busy = true;
+    }
+#endif
+
+  nxsem_post(&dev->exclsem);
+  return nsectors;
+}
+
+/****************************************************************************
+ * Name: ftl_log_discard
+ *
+ * Description:
+ *   Forget the contents of a range of sectors (BIOC_DISCARD).  Their pages
+ *   are no longer copied by the garbage collector and the sectors read as
+ *   erased.  Nothing is written to the log, so an older version of a
+ *   sector may reappear after the next mount.
+ *
+ ****************************************************************************/
+
+static int ftl_log_discard(FAR struct ftl_struct_s *dev,
+                           FAR const struct blkdiscard_s *range)
+{
+  uint32_t sector;
+  uint32_t end;
+  int ndx;
+
+  if (range == NULL || range->bd_startsector >= dev->nsectors ||
+      range->bd_nsectors > dev->nsectors - range->bd_startsector)
+    {
+      return -EINVAL;
+    }
+
+  end = range->bd_startsector + range->bd_nsectors;
+
+  (void)nxsem_wait_uninterruptible(&dev->exclsem);
+
+  for (sector = range->bd_startsector; sector < end; sector++)
+    {
+      ndx = ftl_log_cachefind(dev, sector);
+      if (ndx >= 0)
+        {
+          dev->cache[ndx].sector = FTL_LOG_UNMAPPED;
+          dev->cache[ndx].dirty  = false;
+        }
+
+      if (dev->map[sector] != FTL_LOG_UNMAPPED)
+        {
+          ftl_log_remap(dev, sector, FTL_LOG_UNMAPPED);
+        }
+    }
+
+  nxsem_post(&dev->exclsem);
+  return OK;
+}
+
 /****************************************************************************
- * Pre-processor Definitions
+ * Name: ftl_log_cachefind
+ *
+ * Description:
+ *   Return the write-back cache entry holding a sector or -1.
+ *
  ****************************************************************************/
 
-/* Check if read/write buffer support is needed */
+static int ftl_log_cachefind(FAR struct ftl_struct_s *dev, uint32_t sector)
+{
+  int i;
 
-#if defined(CONFIG_FTL_READAHEAD) || defined(CONFIG_FTL_WRITEBUFFER)
-#  define FTL_HAVE_RWBUFFER 1
-#endif
+  for (i = 0; i < CONFIG_FTL_LOG_NCACHE; i++)
+    {
+      if (dev->cache[i].sector == sector)
+        {
+          return i;
+        }
+    }
 
-/* The maximum length of the device name paths is the maximum length of a
- * name plus 5 for the the length of "/dev/" and a NUL terminator.
- */
+  return -1;
+}
 
-#define DEV_NAME_MAX    (NAME_MAX + 5)
+/****************************************************************************
+ * Name: ftl_log_cachevictim
+ *
+ * Description:
+ *   Return a write-back cache entry that may be reused (round robin over
+ *   the entries that are not dirty) or -1 if all are dirty.
+ *
+ ****************************************************************************/
+
+static int ftl_log_cachevictim(FAR struct ftl_struct_s *dev)
+{
+  int ndx;
+  int i;
+
+  for (i = 0; i < CONFIG_FTL_LOG_NCACHE; i++)
+    {
+      ndx = dev->cnext;
+      dev->cnext = (dev->cnext + 1) % CONFIG_FTL_LOG_NCACHE;
+
+      if (!dev->cache[ndx].dirty)
+        {
+          return ndx;
+        }
+    }
+
+  return -1;
+}
 
 /****************************************************************************
- * Private Types
+ * Name: ftl_log_scan
+ *
+ * Description:
+ *   Replay the records of one segment into the mapping table.  The data
+ *   of the last record is checked against its CRC because a write may have
+ *   been interrupted there; all earlier records are known to be complete.
+ *
  ****************************************************************************/
 
-struct ftl_struct_s
+static void ftl_log_scan(FAR struct ftl_struct_s *dev, uint32_t eblock)
 {
-  FAR struct mtd_dev_s *mtd;     /* Contained MTD interface */
-  struct mtd_geometry_s geo;     /* Device geometry */
-#ifdef FTL_HAVE_RWBUFFER
-  struct rwbuffer_s     rwb;     /* Read-ahead/write buffer support */
-#endif
-  uint16_t              blkper;  /* R/W blocks per erase block */
-  uint16_t              refs;    /* Number of references */
-  bool                  unlinked;/* The driver has been unlinked */
-#ifdef CONFIG_FS_WRITABLE
-  FAR uint8_t          *eblock;  /* One, in-memory erase block */
-#endif
-};
+  FAR struct ftl_logrec_s *rec;
+  uint32_t page;
+  uint32_t crc;
+  uint16_t last = 0;
+  uint16_t pgndx;
+  uint16_t end;
+  int i;
+
+  /* Find the last record */
+
+  for (pgndx = 1; pgndx < dev->blkper; pgndx += rec->nsectors + 1)
+    {
+      rec = ftl_log_readrec(dev, eblock, pgndx);
+      if (rec == NULL)
+        {
+          break;
+        }
+
+      last = pgndx;
+    }
+
+  if (last == 0)
+    {
+      return;
+    }
+
+  /* Check its data */
+
+  rec  = ftl_log_readrec(dev, eblock, last);
+  DEBUGASSERT(rec != NULL);
+  page = eblock * dev->blkper + last + 1;
+
+  if (MTD_BREAD(dev->mtd, page, rec->nsectors, dev->eblock) !=
+      rec->nsectors)
+    {
+      end = last;
+    }
+  else
+    {
+      crc = crc32(dev->eblock, rec->nsectors * dev->geo.blocksize);
+      end = crc == rec->datacrc ? last + 1 : last;
+    }
+
+  /* Replay the complete records */
+
+  for (pgndx = 1; pgndx < end; pgndx += rec->nsectors + 1)
+    {
+      rec = ftl_log_readrec(dev, eblock, pgndx);
+      DEBUGASSERT(rec != NULL);
+
+      for (i = 0; i < rec->nsectors; i++)
+        {
+          ftl_log_remap(dev, rec->sector[i],
+                        eblock * dev->blkper + pgndx + 1 + i);
+        }
+    }
+}
 
 /****************************************************************************
- * Private Function Prototypes
+ * Name: ftl_log_seqcompare
  ****************************************************************************/
 
-static int     ftl_open(FAR struct inode *inode);
-static int     ftl_close(FAR struct inode *inode);
-static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
-                 off_t startblock, size_t nblocks);
-static ssize_t ftl_read(FAR struct inode *inode, unsigned char *buffer,
-                 size_t start_sector, unsigned int nsectors);
-#ifdef CONFIG_FS_WRITABLE
-static ssize_t ftl_flush(FAR void *priv, FAR const uint8_t *buffer,
-                 off_t startblock, size_t nblocks);
-static ssize_t ftl_write(FAR struct inode *inode, const unsigned char *buffer,
-                 size_t start_sector, unsigned int nsectors);
-#endif
-static int     ftl_geometry(FAR struct inode *inode, struct geometry *geometry);
-static int     ftl_ioctl(FAR struct inode *inode, int cmd, unsigned long arg);
-#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
-static int     ftl_unlink(FAR struct inode *inode);
-#endif
+static int ftl_log_seqcompare(FAR const void *a, FAR const void *b)
+{
+  uint32_t seqa = ((FAR const struct ftl_logsort_s *)a)->seq;
+  uint32_t seqb = ((FAR const struct ftl_logsort_s *)b)->seq;
+
+  return seqa < seqb ? -1 : seqa > seqb ? 1 : 0;
+}
 
 /****************************************************************************
- * Private Data
+ * Name: ftl_log_erased
+ *
+ * Description:
+ *   Return true if every page of an erase block reads as erased.  An
+ *   interrupted erase or segment header write may leave a block whose first
+ *   page looks erased while later pages are not.
+ *
  ****************************************************************************/
 
-static const struct block_operations g_bops =
+static bool ftl_log_erased(FAR struct ftl_struct_s *dev, uint32_t eblock)
 {
-  ftl_open,     /* open     */
-  ftl_close,    /* close    */
-  ftl_read,     /* read     */
-#ifdef CONFIG_FS_WRITABLE
-  ftl_write,    /* write    */
-#else
-  NULL,         /* write    */
-#endif
-  ftl_geometry, /* geometry */
-  ftl_ioctl     /* ioctl    */
-#ifndef CONFIG_DISABLE_PSEUDOFS_OPERATIONS
-  , ftl_unlink  /* unlink   */
+  size_t i;
+
+  if (MTD_BREAD(dev->mtd, eblock * dev->blkper, dev->blkper, dev->eblock) !=
+      dev->blkper)
+    {
+      return false;
+    }
+
+  for (i = 0; i < dev->geo.erasesize && dev->eblock[i] == 0xff; i++);
+  return i >= dev->geo.erasesize;
+}
+
+/****************************************************************************
+ * Name: ftl_log_mount
+ *
+ * Description:
+ *   Rebuild the mapping table, the valid page counts and the erase counts
+ *   from the segment and record headers on the FLASH.  Segments are
+ *   replayed in the order that they were written.  Erase blocks without a
+ *   valid segment header are erased.
+ *
+ ****************************************************************************/
+
+static int ftl_log_mount(FAR struct ftl_struct_s *dev)
+{
+  FAR struct ftl_logseg_s *seg = (FAR struct ftl_logseg_s *)dev->page;
+  FAR struct ftl_logsort_s *segs;
+  uint64_t erasesum = 0;
+  uint32_t nsegs = 0;
+  uint32_t nunknown = 0;
+  uint32_t eblock;
+  uint32_t i;
+  int ret;
+
+  segs = (FAR struct ftl_logsort_s *)
+    kmm_malloc(dev->geo.neraseblocks * sizeof(struct ftl_logsort_s));
+  if (segs == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (eblock = 0; eblock < dev->geo.neraseblocks; eblock++)
+    {
+      if (MTD_BREAD(dev->mtd, eblock * dev->blkper, 1, dev->page) == 1 &&
+          seg->magic == FTL_LOG_SEGMAGIC &&
+          seg->crc == crc32(dev->page, offsetof(struct ftl_logseg_s, crc)))
+        {
+          dev->state[eblock]    = FTL_LOG_USED;
+          dev->erasecnt[eblock] = seg->erasecnt;
+          erasesum             += seg->erasecnt;
+
+          segs[nsegs].seq       = seg->seq;
+          segs[nsegs].eblock    = eblock;
+          nsegs++;
+
+          if (seg->seq > dev->seq)
+            {
+              dev->seq = seg->seq;
+            }
+
+          continue;
+        }
+
+      /* Not a segment.  The erase count is not known.  Unless the whole
+       * block is erased, erase it before it is used for a segment.
+       */
+
+      if (!ftl_log_erased(dev, eblock))
+        {
+          ret = MTD_ERASE(dev->mtd, eblock, 1);
+          if (ret < 0)
+            {
+              ferr("ERROR: Erase block=%lu failed: %d\n",
+                   (unsigned long)eblock, ret);
+              kmm_free(segs);
+              return ret;
+            }
+        }
+
+      dev->state[eblock]    = FTL_LOG_FREE;
+      dev->erasecnt[eblock] = FTL_LOG_UNMAPPED;
+      dev->nfree++;
+      nunknown++;
+    }
+
+  /* Give the erase blocks with unknown erase counts the average count */
+
+  for (eblock = 0; nunknown > 0 && eblock < dev->geo.neraseblocks; eblock++)
+    {
+      if (dev->erasecnt[eblock] == FTL_LOG_UNMAPPED)
+        {
+          dev->erasecnt[eblock] = nsegs > 0 ? erasesum / nsegs : 0;
+        }
+    }
+
+  /* Replay the segments in the order that they were written.  Writing
+   * resumes in a new segment.
+   */
+
+  qsort(segs, nsegs, sizeof(struct ftl_logsort_s), ftl_log_seqcompare);
+  for (i = 0; i < nsegs; i++)
+    {
+      ftl_log_scan(dev, segs[i].eblock);
+    }
+
+  kmm_free(segs);
+  dev->openblk = FTL_LOG_UNMAPPED;
+
+  finfo("%lu segments, %u free erase blocks\n",
+        (unsigned long)nsegs, dev->nfree);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ftl_log_uninitialize
+ *
+ * Description:
+ *   Stop the background worker, flush the write-back cache and free the
+ *   resources of the log.
+ *
+ ****************************************************************************/
+
+static void ftl_log_uninitialize(FAR struct ftl_struct_s *dev)
+{
+  (void)nxsem_wait_uninterruptible(&dev->exclsem);
+
+#ifdef CONFIG_SCHED_LPWORK
+  /* A worker that has already been started cannot be cancelled.  It may
+   * be waiting for exclsem:  Let it run and wait until it has exited.
+   */
+
+  dev->closing = true;
+  if (work_cancel(LPWORK, &dev->work) >= 0)
+    {
+      dev->busy = false;
+    }
+
+  if (dev->busy)
+    {
+      nxsem_post(&dev->exclsem);
+      (void)nxsem_wait_uninterruptible(&dev->donesem);
+      (void)nxsem_wait_uninterruptible(&dev->exclsem);
+    }
+
+  nxsem_destroy(&dev->donesem);
 #endif
-};
+
+  if (dev->map != NULL)
+    {
+      (void)ftl_log_flush(dev);
+    }
+
+  nxsem_post(&dev->exclsem);
+  nxsem_destroy(&dev->exclsem);
+
+  kmm_free(dev->map);
+  kmm_free(dev->valid);
+  kmm_free(dev->erasecnt);
+  kmm_free(dev->state);
+  kmm_free(dev->page);
+  kmm_free(dev->cdata);
+  kmm_free(dev->gcsectors);
+  kmm_free(dev->bufs);
+  kmm_free(dev->eblock);
+  dev->eblock = NULL;
+}
 
 /****************************************************************************
- * Private Functions
+ * Name: ftl_log_initialize
+ *
+ * Description:
+ *   Allocate the resources of the log and mount it.  The exported capacity
+ *   leaves CONFIG_FTL_LOG_SPARE percent of the erase blocks (but at least
+ *   FTL_LOG_MINSPARE) unused and fills every other erase block only so far
+ *   that the garbage collector can always make progress:  When it copies
+ *   the valid sectors of an erase block, they may be split across two
+ *   segments and into records of at most maxrec sectors.  Reclaiming the
+ *   erase block still frees a page if it holds no more than
+ *   blkper - 4 - blkper / maxrec valid sectors.  With no more sectors than
+ *   that per erase block on average, there always is such an erase block.
+ *
  ****************************************************************************/
 
+static int ftl_log_initialize(FAR struct ftl_struct_s *dev)
+{
+  uint32_t neblocks = dev->geo.neraseblocks;
+  uint32_t nspare;
+  uint32_t i;
+  int nper = 0;
+  int ret;
+
+  nxsem_init(&dev->exclsem, 0, 1);
+#ifdef CONFIG_SCHED_LPWORK
+  nxsem_init(&dev->donesem, 0, 0);
+  nxsem_setprotocol(&dev->donesem, SEM_PRIO_NONE);
+#endif
+
+  nspare = (uint32_t)((uint64_t)neblocks * CONFIG_FTL_LOG_SPARE / 100);
+  if (nspare < FTL_LOG_MINSPARE)
+    {
+      nspare = FTL_LOG_MINSPARE;
+    }
+
+  if (dev->geo.blocksize >= SIZEOF_FTL_LOGREC_S(1))
+    {
+      dev->maxrec = (dev->geo.blocksize - SIZEOF_FTL_LOGREC_S(0)) /
+                    sizeof(uint32_t);
+      nper        = dev->blkper - 4 - dev->blkper / dev->maxrec;
+    }
+
+  if (nper < 1 || neblocks <= nspare)
+    {
+      ferr("ERROR: Geometry not supported by the log\n");
+      return -EINVAL;
+    }
+
+  dev->nsectors = (neblocks - nspare) * nper;
+
+  /* Keeping more erase blocks free than there are spare ones would mean
+   * copying nearly full erase blocks over and over again.
+   */
+
+  dev->gcthresh = CONFIG_FTL_LOG_GCTHRESH < nspare ?
+                  CONFIG_FTL_LOG_GCTHRESH : nspare - 1;
+
+  dev->map       = (FAR uint32_t *)kmm_malloc(dev->nsectors * sizeof(uint32_t));
+  dev->valid     = (FAR uint16_t *)kmm_zalloc(neblocks * sizeof(uint16_t));
+  dev->erasecnt  = (FAR uint32_t *)kmm_zalloc(neblocks * sizeof(uint32_t));
+  dev->state     = (FAR uint8_t *)kmm_zalloc(neblocks);
+  dev->page      = (FAR uint8_t *)kmm_malloc(dev->geo.blocksize);
+  dev->cdata     = (FAR uint8_t *)
+                   kmm_malloc(CONFIG_FTL_LOG_NCACHE * dev->geo.blocksize);
+  dev->gcsectors = (FAR uint32_t *)
+                   kmm_malloc(dev->blkper * sizeof(uint32_t));
+  dev->bufs      = (FAR uint8_t **)
+                   kmm_malloc(dev->blkper * sizeof(FAR uint8_t *));
+  dev->eblock    = (FAR uint8_t *)kmm_malloc(dev->geo.erasesize);
+
+  if (dev->map == NULL || dev->valid == NULL || dev->erasecnt == NULL ||
+      dev->state == NULL || dev->page == NULL || dev->cdata == NULL ||
+      dev->gcsectors == NULL || dev->bufs == NULL || dev->eblock == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  for (i = 0; i < dev->nsectors; i++)
+    {
+      dev->map[i] = FTL_LOG_UNMAPPED;
+    }
+
+  for (i = 0; i < CONFIG_FTL_LOG_NCACHE; i++)
+    {
+      dev->cache[i].sector = FTL_LOG_UNMAPPED;
+      dev->cache[i].dirty  = false;
+    }
+
+  ret = ftl_log_mount(dev);
+  if (ret >= 0)
+    {
+      return OK;
+    }
+
+errout:
+  kmm_free(dev->map);
+  dev->map = NULL;
+  ftl_log_uninitialize(dev);
+  return ret;
+}
+#endif /* CONFIG_FTL_LOGSTRUCT */
+
 /****************************************************************************
  * Name: ftl_open
  *
@@ -174,12 +1446,20 @@ static int ftl_close(FAR struct inode *inode)
 #ifdef CONFIG_FTL_WRITEBUFFER
   rwb_flush(&dev->rwb);
 #endif
+#ifdef CONFIG_FTL_LOGSTRUCT
+  (void)nxsem_wait_uninterruptible(&dev->exclsem);
+  (void)ftl_log_flush(dev);
+  nxsem_post(&dev->exclsem);
+#endif
 
   if (--dev->refs == 0 && dev->unlinked)
     {
 #ifdef FTL_HAVE_RWBUFFER
       rwb_uninitialize(&dev->rwb);
 #endif
+#ifdef CONFIG_FTL_LOGSTRUCT
+      ftl_log_uninitialize(dev);
+#endif
 #ifdef CONFIG_FS_WRITABLE
       if (dev->eblock)
         {
@@ -199,6 +1479,7 @@ static int ftl_close(FAR struct inode *inode)
  *
  ****************************************************************************/
 
+#ifndef CONFIG_FTL_LOGSTRUCT
 static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
                           off_t startblock, size_t nblocks)
 {
@@ -216,6 +1497,7 @@ static ssize_t ftl_reload(FAR void *priv, FAR uint8_t *buffer,
 
   return nread;
 }
+#endif
 
 /****************************************************************************
  * Name: ftl_read
@@ -234,7 +1516,9 @@ static ssize_t ftl_read(FAR struct inode *inode, unsigned char *buffer,
   DEBUGASSERT(inode && inode->i_private);
 
   dev = (FAR struct ftl_struct_s *)inode->i_private;
-#ifdef FTL_HAVE_RWBUFFER
+#if defined(CONFIG_FTL_LOGSTRUCT)
+  return ftl_log_read(dev, buffer, start_sector, nsectors);
+#elif defined(FTL_HAVE_RWBUFFER)
   return rwb_read(&dev->rwb, start_sector, nsectors, buffer);
 #else
   return ftl_reload(dev, buffer, start_sector, nsectors);
@@ -248,7 +1532,7 @@ static ssize_t ftl_read(FAR struct inode *inode, unsigned char *buffer,
  *
  ****************************************************************************/
 
-#ifdef CONFIG_FS_WRITABLE
+#if defined(CONFIG_FS_WRITABLE) && !defined(CONFIG_FTL_LOGSTRUCT)
 static int ftl_alloc_eblock(FAR struct ftl_struct_s *dev)
 {
   if (dev->eblock == NULL)
@@ -461,7 +1745,9 @@ static ssize_t ftl_write(FAR struct inode *inode, const unsigned char *buffer,
 
   DEBUGASSERT(inode && inode->i_private);
   dev = (struct ftl_struct_s *)inode->i_private;
-#ifdef FTL_HAVE_RWBUFFER
+#if defined(CONFIG_FTL_LOGSTRUCT)
+  return ftl_log_write(dev, buffer, start_sector, nsectors);
+#elif defined(FTL_HAVE_RWBUFFER)
   return rwb_write(&dev->rwb, start_sector, nsectors, buffer);
 #else
   return ftl_flush(dev, buffer, start_sector, nsectors);
@@ -493,7 +1779,11 @@ static int ftl_geometry(FAR struct inode *inode, struct geometry *geometry)
 #else
       geometry->geo_writeenabled  = false;
 #endif
+#ifdef CONFIG_FTL_LOGSTRUCT
+      geometry->geo_nsectors      = dev->nsectors;
+#else
       geometry->geo_nsectors      = dev->geo.neraseblocks * dev->blkper;
+#endif
       geometry->geo_sectorsize    = dev->geo.blocksize;
 
       finfo("available: true mediachanged: false writeenabled: %s\n",
@@ -554,6 +1844,20 @@ static int ftl_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
       return rwb_flush(&dev->rwb);
     }
 #endif
+#ifdef CONFIG_FTL_LOGSTRUCT
+  else if (cmd == BIOC_FLUSH)
+    {
+      (void)nxsem_wait_uninterruptible(&dev->exclsem);
+      ret = ftl_log_flush(dev);
+      nxsem_post(&dev->exclsem);
+      return ret;
+    }
+  else if (cmd == BIOC_DISCARD)
+    {
+      return ftl_log_discard(dev,
+                             (FAR const struct blkdiscard_s *)((uintptr_t)arg));
+    }
+#endif
 
   /* No other block driver ioctl commmands are not recognized by this
    * driver.  Other possible MTD driver ioctl commands are passed through
@@ -590,6 +1894,9 @@ static int ftl_unlink(FAR struct inode *inode)
 #ifdef FTL_HAVE_RWBUFFER
       rwb_uninitialize(&dev->rwb);
 #endif
+#ifdef CONFIG_FTL_LOGSTRUCT
+      ftl_log_uninitialize(dev);
+#endif
 #ifdef CONFIG_FS_WRITABLE
       if (dev->eblock)
         {
@@ -684,6 +1991,18 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd)
         }
 #endif
 
+      /* Build the sector map of the log */
+
+#ifdef CONFIG_FTL_LOGSTRUCT
+      ret = ftl_log_initialize(dev);
+      if (ret < 0)
+        {
+          ferr("ERROR: ftl_log_initialize failed: %d\n", ret);
+          kmm_free(dev);
+          return ret;
+        }
+#endif
+
       /* Inode private data is a reference to the FTL device structure */
 
       ret = register_blockdriver(path, &g_bops, 0, dev);
@@ -692,6 +2011,9 @@ int ftl_initialize_by_path(FAR const char *path, FAR struct mtd_dev_s *mtd)
           ferr("ERROR: register_blockdriver failed: %d\n", -ret);
 #ifdef FTL_HAVE_RWBUFFER
           rwb_uninitialize(&dev->rwb);
+#endif
+#ifdef CONFIG_FTL_LOGSTRUCT
+          ftl_log_uninitialize(dev);
 #endif
           kmm_free(dev);
         }
@@ -49,8 +49,10 @@
 #include <errno.h>
 #include <debug.h>
 
+#include <nuttx/irq.h>
 #include <nuttx/kmalloc.h>
 #include <nuttx/signal.h>
+#include <nuttx/wqueue.h>
 #include <nuttx/fs/ioctl.h>
 #include <nuttx/spi/spi.h>
 #include <nuttx/mtd/mtd.h>
@@ -242,6 +244,12 @@ struct m25p_dev_s
 #ifdef CONFIG_M25P_SUBSECTOR_ERASE
   uint8_t  subsectorshift;   /* 0, 12 or 13 (4K or 8K) */
 #endif
+#ifdef CONFIG_M25P_ASYNC
+  struct work_s work;        /* Performs batches of requests */
+  FAR struct mtd_batch_s *head; /* Queue of pending batches */
+  FAR struct mtd_batch_s *tail;
+  bool busy;                /* True while the worker is queued or running */
+#endif
 };
 
 /************************************************************************************
@@ -274,6 +282,10 @@ static ssize_t m25p_write(FAR struct mtd_dev_s *dev, off_t offset, size_t nbytes
                          FAR const uint8_t *buffer);
 #endif
 static int m25p_ioctl(FAR struct mtd_dev_s *dev, int cmd, unsigned long arg);
+#ifdef CONFIG_M25P_ASYNC
+static void m25p_worker(FAR void *arg);
+static int m25p_submit(FAR struct mtd_dev_s *dev, FAR struct mtd_batch_s *batch);
+#endif
 
 /************************************************************************************
  * Private Data
@@ -1022,6 +1034,111 @@ static int m25p_ioctl(FAR struct mtd_dev_s *dev, int cmd, unsigned long arg)
   return ret;
 }
 
+/************************************************************************************
+ * Name: m25p_worker
+ *
+ * Description:
+ *   Perform the pending batches of requests on the low priority work queue.  The
+ *   wait for a page program or an erase to complete is done at the beginning of
+ *   the next operation, so the last operation of a batch is still in progress
+ *   when the batch completes.
+ *
+ ************************************************************************************/
+
+#ifdef CONFIG_M25P_ASYNC
+static void m25p_worker(FAR void *arg)
+{
+  FAR struct m25p_dev_s *priv = (FAR struct m25p_dev_s *)arg;
+  FAR struct mtd_batch_s *batch;
+  irqstate_t flags;
+
+  for (; ; )
+    {
+      /* Remove the next batch from the queue.  The worker stays busy until
+       * it finds the queue empty, so that m25p_submit() does not start a
+       * second worker that would run batches in parallel and out of order.
+       */
+
+      flags = enter_critical_section();
+      batch = priv->head;
+      if (batch != NULL)
+        {
+          priv->head = batch->flink;
+          if (priv->head == NULL)
+            {
+              priv->tail = NULL;
+            }
+        }
+      else
+        {
+          priv->busy = false;
+        }
+
+      leave_critical_section(flags);
+
+      if (batch == NULL)
+        {
+          break;
+        }
+
+      /* Perform the requests and notify the caller */
+
+      (void)mtd_batch_execute(&priv->mtd, batch);
+    }
+}
+
+/************************************************************************************
+ * Name: m25p_submit
+ ************************************************************************************/
+
+static int m25p_submit(FAR struct mtd_dev_s *dev, FAR struct mtd_batch_s *batch)
+{
+  FAR struct m25p_dev_s *priv = (FAR struct m25p_dev_s *)dev;
+  irqstate_t flags;
+  int ret = OK;
+
+  finfo("batch: %p nreqs: %d\n", batch, batch->nreqs);
+
+  /* Add the batch to the end of the queue.  Start the worker if it is not
+   * busy; otherwise, the worker will find the batch when it has finished the
+   * earlier ones.
+   */
+
+  batch->flink = NULL;
+
+  flags = enter_critical_section();
+  if (priv->tail == NULL)
+    {
+      priv->head = batch;
+    }
+  else
+    {
+      priv->tail->flink = batch;
+    }
+
+  priv->tail = batch;
+
+  if (!priv->busy)
+    {
+      ret = work_queue(LPWORK, &priv->work, m25p_worker, priv, 0);
+      if (ret < 0)
+        {
+          /* The queue was empty because the worker was not busy */
+
+          priv->head = NULL;
+          priv->tail = NULL;
+        }
+      else
+        {
+          priv->busy = true;
+        }
+    }
+
+  leave_critical_section(flags);
+  return ret;
+}
+#endif
+
 /************************************************************************************
  * Public Functions
  ************************************************************************************/
@@ -1066,6 +1183,11 @@ FAR struct mtd_dev_s *m25p_initialize(FAR struct spi_dev_s *dev)
 #endif
       priv->mtd.ioctl  = m25p_ioctl;
       priv->mtd.name   = "m25px";
+#if defined(CONFIG_M25P_ASYNC)
+      priv->mtd.submit = m25p_submit;
+#elif defined(CONFIG_MTD_BATCH)
+      priv->mtd.submit = mtd_batch_execute;
+#endif
       priv->dev        = dev;
 
       /* Deselect the FLASH */
@@ -0,0 +1,167 @@
+/****************************************************************************
+ * drivers/mtd/mtd_batch.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <errno.h>
+#include <assert.h>
+#include <debug.h>
+
+#include <nuttx/semaphore.h>
+#include <nuttx/mtd/mtd.h>
+
+#ifdef CONFIG_MTD_BATCH
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mtd_batch_wakeup
+ *
+ * Description:
+ *   Batch completion callback of mtd_batch_wait().
+ *
+ ****************************************************************************/
+
+static void mtd_batch_wakeup(FAR struct mtd_batch_s *batch)
+{
+  (void)nxsem_post((FAR sem_t *)batch->arg);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: mtd_batch_execute
+ *
+ * Description:
+ *   Perform a batch of MTD requests synchronously using the erase(),
+ *   bread() and bwrite() methods of the MTD device, then call the batch
+ *   callback.
+ *
+ ****************************************************************************/
+
+int mtd_batch_execute(FAR struct mtd_dev_s *dev, FAR struct mtd_batch_s *batch)
+{
+  FAR struct mtd_request_s *req;
+  ssize_t ret = OK;
+
+  DEBUGASSERT(dev != NULL && batch != NULL);
+
+  for (batch->ndone = 0; batch->ndone < batch->nreqs; batch->ndone++)
+    {
+      req = &batch->reqs[batch->ndone];
+
+      switch (req->op)
+        {
+          case MTD_REQ_READ:
+            ret = MTD_BREAD(dev, req->startblock, req->nblocks, req->buffer);
+            break;
+
+          case MTD_REQ_WRITE:
+            ret = MTD_BWRITE(dev, req->startblock, req->nblocks,
+                             req->buffer);
+            break;
+
+          case MTD_REQ_ERASE:
+            ret = MTD_ERASE(dev, req->startblock, req->nblocks);
+            break;
+
+          default:
+            ret = -EINVAL;
+            break;
+        }
+
+      if (ret >= 0 && ret != (ssize_t)req->nblocks)
+        {
+          ret = -EIO;
+        }
+
+      if (ret < 0)
+        {
+          ferr("ERROR: Request %d (op %d, block %ld) failed: %d\n",
+               batch->ndone, req->op, (long)req->startblock, (int)ret);
+          break;
+        }
+    }
+
+  batch->result = ret < 0 ? (int)ret : OK;
+  if (batch->callback != NULL)
+    {
+      batch->callback(batch);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: mtd_batch_wait
+ *
+ * Description:
+ *   Submit a batch of MTD requests and wait for it to complete.
+ *
+ ****************************************************************************/
+
+int mtd_batch_wait(FAR struct mtd_dev_s *dev, FAR struct mtd_batch_s *batch)
+{
+  sem_t waitsem;
+  int ret;
+
+  (void)nxsem_init(&waitsem, 0, 0);
+  (void)nxsem_setprotocol(&waitsem, SEM_PRIO_NONE);
+
+  batch->callback = mtd_batch_wakeup;
+  batch->arg      = &waitsem;
+
+  ret = MTD_SUBMIT(dev, batch);
+  if (ret >= 0)
+    {
+      nxsem_wait_uninterruptible(&waitsem);
+      ret = batch->result;
+    }
+
+  nxsem_destroy(&waitsem);
+  return ret;
+}
+
+#endif /* CONFIG_MTD_BATCH */
@@ -99,6 +99,22 @@ struct mtd_partition_s
 #endif
 };
 
+/* A batch translated for the parent MTD driver.  The caller's batch and
+ * requests are not modified.
+ */
+
+#ifdef CONFIG_MTD_BATCH
+struct part_batch_s
+{
+  struct mtd_batch_s batch;       /* The batch passed to the parent */
+  FAR struct mtd_batch_s *orig;   /* The caller's batch */
+  struct mtd_request_s reqs[1];   /* Translated copies of the requests */
+};
+
+#define SIZEOF_PART_BATCH_S(n) \
+  (sizeof(struct part_batch_s) + ((n) - 1) * sizeof(struct mtd_request_s))
+#endif
+
 /* This structure describes one open "file" */
 
 #if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_PROCFS_EXCLUDE_PARTITIONS)
@@ -129,6 +145,10 @@ static ssize_t part_write(FAR struct mtd_dev_s *dev, off_t offset,
 #endif
 static int     part_ioctl(FAR struct mtd_dev_s *dev, int cmd,
                   unsigned long arg);
+#ifdef CONFIG_MTD_BATCH
+static int     part_submit(FAR struct mtd_dev_s *dev,
+                  FAR struct mtd_batch_s *batch);
+#endif
 
 /* File system methods */
 
@@ -395,6 +415,125 @@ static ssize_t part_write(FAR struct mtd_dev_s *dev, off_t offset, size_t nbytes
 }
 #endif
 
+/****************************************************************************
+ * Name: part_complete
+ *
+ * Description:
+ *   Completion callback of a translated batch.  Return the result to the
+ *   caller's batch and call its callback.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_BATCH
+static void part_complete(FAR struct mtd_batch_s *batch)
+{
+  FAR struct part_batch_s *pbatch = (FAR struct part_batch_s *)batch;
+  FAR struct mtd_batch_s *orig = pbatch->orig;
+
+  orig->ndone  = batch->ndone;
+  orig->result = batch->result;
+  kmm_free(pbatch);
+
+  if (orig->callback != NULL)
+    {
+      orig->callback(orig);
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: part_submit
+ *
+ * Description:
+ *   Check that all requests of the batch lie within the partition, then
+ *   pass a copy of the batch with the partition offset added to each
+ *   request to the underlying MTD driver.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_BATCH
+static int part_submit(FAR struct mtd_dev_s *dev,
+                       FAR struct mtd_batch_s *batch)
+{
+  FAR struct mtd_partition_s *priv = (FAR struct mtd_partition_s *)dev;
+  FAR struct part_batch_s *pbatch;
+  FAR struct mtd_request_s *req;
+  off_t eoffset;
+  off_t lastblock;
+  int ret;
+  int i;
+
+  DEBUGASSERT(priv && batch);
+
+  /* Verify all requests before submitting any of them */
+
+  for (i = 0; i < batch->nreqs; i++)
+    {
+      req       = &batch->reqs[i];
+      lastblock = req->startblock + req->nblocks - 1;
+
+      if (req->op == MTD_REQ_ERASE)
+        {
+          lastblock *= priv->blkpererase;
+        }
+
+      if (req->nblocks == 0 || !part_blockcheck(priv, lastblock))
+        {
+          ferr("ERROR: Request %d beyond the end of the partition\n", i);
+          return -ENXIO;
+        }
+    }
+
+  pbatch = (FAR struct part_batch_s *)
+    kmm_malloc(SIZEOF_PART_BATCH_S(batch->nreqs));
+
+  if (pbatch == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  /* Copy the requests and add the partition offset.  Erase requests are in
+   * units of erase blocks.
+   */
+
+  memcpy(pbatch->reqs, batch->reqs,
+         batch->nreqs * sizeof(struct mtd_request_s));
+
+  eoffset = priv->firstblock / priv->blkpererase;
+  for (i = 0; i < batch->nreqs; i++)
+    {
+      req = &pbatch->reqs[i];
+      if (req->op == MTD_REQ_ERASE)
+        {
+          req->startblock += eoffset;
+        }
+      else
+        {
+          req->startblock += priv->firstblock;
+        }
+    }
+
+  pbatch->orig           = batch;
+  pbatch->batch.reqs     = pbatch->reqs;
+  pbatch->batch.nreqs    = batch->nreqs;
+  pbatch->batch.ndone    = 0;
+  pbatch->batch.result   = OK;
+  pbatch->batch.callback = part_complete;
+  pbatch->batch.arg      = priv;
+  pbatch->batch.flink    = NULL;
+
+  /* The copy is freed by part_complete() unless it is never submitted */
+
+  ret = MTD_SUBMIT(priv->parent, &pbatch->batch);
+  if (ret < 0)
+    {
+      kmm_free(pbatch);
+    }
+
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Name: part_ioctl
  ****************************************************************************/
@@ -828,6 +967,9 @@ FAR struct mtd_dev_s *mtd_partition(FAR struct mtd_dev_s *mtd, off_t firstblock,
   part->child.write  = mtd->write ? part_write : NULL;
 #endif
   part->child.name   = "part";
+#ifdef CONFIG_MTD_BATCH
+  part->child.submit = part_submit;
+#endif
 
   part->parent       = mtd;
   part->firstblock   = erasestart * blkpererase;
@@ -116,6 +116,10 @@ static ssize_t mtd_bwrite(FAR struct mtd_dev_s *dev, off_t block,
 static ssize_t mtd_read(FAR struct mtd_dev_s *dev, off_t offset, size_t nbytes,
                         FAR uint8_t *buffer);
 static int mtd_ioctl(FAR struct mtd_dev_s *dev, int cmd, unsigned long arg);
+#ifdef CONFIG_MTD_BATCH
+static int mtd_submit(FAR struct mtd_dev_s *dev,
+                      FAR struct mtd_batch_s *batch);
+#endif
 
 /************************************************************************************
  * Private Data
@@ -313,6 +317,72 @@ static int mtd_ioctl(FAR struct mtd_dev_s *dev, int cmd, unsigned long arg)
   return ret;
 }
 
+/************************************************************************************
+ * Name: mtd_submit
+ *
+ * Description:
+ *   Pass a batch of requests to the lower level MTD driver.  The requests bypass
+ *   the buffers:  Buffered write data is flushed first and buffered data for the
+ *   blocks that are written or erased is discarded.
+ *
+ ************************************************************************************/
+
+#ifdef CONFIG_MTD_BATCH
+static int mtd_submit(FAR struct mtd_dev_s *dev, FAR struct mtd_batch_s *batch)
+{
+  FAR struct mtd_rwbuffer_s *priv = (FAR struct mtd_rwbuffer_s *)dev;
+  FAR struct mtd_request_s *req;
+  off_t sector;
+  size_t nsectors;
+  int ret;
+  int i;
+
+  finfo("nreqs: %d\n", batch->nreqs);
+
+#ifdef CONFIG_DRVR_WRITEBUFFER
+  /* Make sure that reads see the buffered write data */
+
+  ret = rwb_flush(&priv->rwb);
+  if (ret < 0)
+    {
+      ferr("ERROR: rwb_flush failed: %d\n", ret);
+      return ret;
+    }
+#endif
+
+  for (i = 0; i < batch->nreqs; i++)
+    {
+      req = &batch->reqs[i];
+      if (req->op == MTD_REQ_READ)
+        {
+          continue;
+        }
+
+      /* Convert erase blocks to logical sectors */
+
+      sector   = req->startblock;
+      nsectors = req->nblocks;
+
+      if (req->op == MTD_REQ_ERASE)
+        {
+          sector   *= priv->spb;
+          nsectors *= priv->spb;
+        }
+
+      ret = rwb_invalidate(&priv->rwb, sector, nsectors);
+      if (ret < 0)
+        {
+          ferr("ERROR: rwb_invalidate failed: %d\n", ret);
+          return ret;
+        }
+    }
+
+  /* Then let the lower level MTD driver do the real work */
+
+  return MTD_SUBMIT(priv->dev, batch);
+}
+#endif
+
 /************************************************************************************
  * Public Functions
  ************************************************************************************/
@@ -372,6 +442,9 @@ FAR struct mtd_dev_s *mtd_rwb_initialize(FAR struct mtd_dev_s *mtd)
   priv->mtd.bwrite   = mtd_bwrite; /* Our MTD bwrite method */
   priv->mtd.read     = mtd_read;   /* Our MTD read method */
   priv->mtd.ioctl    = mtd_ioctl;  /* Our MTD ioctl method */
+#ifdef CONFIG_MTD_BATCH
+  priv->mtd.submit   = mtd_submit; /* Our MTD submit method */
+#endif
   priv->mtd.name     = "rwbuffer";
 
   priv->dev          = mtd;        /* The contained MTD instance */
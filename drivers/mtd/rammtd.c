@@ -470,6 +470,13 @@ FAR struct mtd_dev_s *rammtd_initialize(FAR uint8_t *start, size_t size)
 #endif
   priv->mtd.ioctl  = ram_ioctl;
   priv->mtd.name   = "rammtd";
+#ifdef CONFIG_MTD_BATCH
+  /* RAM is copied by the CPU, so there is nothing to overlap.  Batches
+   * are performed before submit() returns.
+   */
+
+  priv->mtd.submit = mtd_batch_execute;
+#endif
 
   priv->start      = start;
   priv->nblocks    = nblocks;
@@ -143,6 +143,38 @@
 #define smart_free(d, p)        kmm_free(p)
 #endif
 
+/* Fast mount checkpoint */
+
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+#  ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
+#    error "The checkpoint requires the full sector map"
+#  endif
+
+#  ifndef CONFIG_MTD_SMART_CHECKPOINT_NLOG
+#    define CONFIG_MTD_SMART_CHECKPOINT_NLOG 128
+#  endif
+
+#  define SMART_CKPT_MAGIC      0x54504b43  /* "CKPT" */
+#  define SMART_CKPT_NREGIONS   2
+#  define SMART_CKPT_HIGHWATER  (CONFIG_MTD_SMART_CHECKPOINT_NLOG * 3 / 4)
+#  define SMART_CKPT_STALE      (CONFIG_MTD_SMART_CHECKPOINT_NLOG + 1)
+
+/* Log entries must differ from the erased state */
+
+#  if CONFIG_SMARTFS_ERASEDSTATE == 0xff
+#    define SMART_CKPT_ERASED   0xffff
+#    define SMART_CKPT_INVALID  0x00000000
+#    define SMART_CKPT_ENTRY(b) ((uint16_t)(b))
+#  else
+#    define SMART_CKPT_ERASED   0x0000
+#    define SMART_CKPT_INVALID  0xffffffff
+#    define SMART_CKPT_ENTRY(b) ((uint16_t)~(b))
+#  endif
+#else
+#  define smart_ckpt_touch(d, b)
+#  define smart_ckpt_update(d, r)
+#endif
+
 #define SMART_WEAR_FULL_RELOCATE_THRESHOLD  8
 #define SMART_WEAR_REORG_THRESHOLD          14
 #define SMART_WEAR_MIN_LEVEL                5
@@ -275,6 +307,15 @@ struct smart_struct_s
   size_t                bytesalloc;
   struct smart_alloc_s  alloc[SMART_MAX_ALLOCS];   /* Array of memory allocations */
 #endif
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+  FAR uint8_t          *ckptdirty;        /* Erase blocks modified since the checkpoint */
+  FAR uint8_t          *ckptbuf;          /* One MTD block for checkpoint I/O */
+  uint32_t              ckptseq;          /* Sequence number of the newest checkpoint */
+  uint32_t              ckptlogoff;       /* Offset of the log in the region */
+  uint16_t              ckptblocks;       /* Erase blocks per checkpoint region */
+  uint16_t              ckptnlog;         /* Number of entries in the log */
+  int8_t                ckptregion;       /* Region of the newest checkpoint or -1 */
+#endif
 };
 
 #define SMART_WEARFLAGS_FORCE_REORG    0x01
@@ -356,6 +397,27 @@ typedef uint32_t crc_t;
 
 #endif
 
+/* Checkpoint header.  It is followed (in the next MTD block) by the sector
+ * map and the released and free counts of each erase block, as they are
+ * laid out in RAM, and then by a log of the erase blocks that were modified
+ * after the checkpoint was written.
+ */
+
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+struct smart_ckpt_s
+{
+  uint32_t              magic;            /* SMART_CKPT_MAGIC */
+  uint32_t              seq;              /* Incremented for each checkpoint */
+  uint32_t              crc;              /* CRC-32 of header (crc = 0) and data */
+  uint16_t              totalsectors;     /* Geometry the checkpoint was made with */
+  uint16_t              neraseblocks;
+  uint16_t              sectorsize;
+  uint16_t              freesectors;      /* Total number of free sectors */
+  uint16_t              releasesectors;   /* Total number of released sectors */
+  uint16_t              nlog;             /* Capacity of the log */
+};
+#endif
+
 
 /****************************************************************************
  * Private Function Prototypes
@@ -391,6 +453,10 @@ static int smart_relocate_static_data(FAR struct smart_struct_s *dev, uint16_t b
 static int smart_relocate_sector(FAR struct smart_struct_s *dev,
                  uint16_t oldsector, uint16_t newsector);
 
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+static void smart_ckpt_touch(FAR struct smart_struct_s *dev, uint16_t block);
+#endif
+
 #ifdef CONFIG_SMART_DEV_LOOP
 static ssize_t smart_loop_read(FAR struct file *filep, FAR char *buffer,
                  size_t buflen);
@@ -910,6 +976,7 @@ static ssize_t smart_write(FAR struct inode *inode,
           /* Erase the erase block */
 
           eraseblock = alignedblock / mtdBlksPerErase;
+          smart_ckpt_touch(dev, eraseblock);
           ret = MTD_ERASE(dev->mtd, eraseblock, 1);
           if (ret < 0)
             {
@@ -937,6 +1004,7 @@ static ssize_t smart_write(FAR struct inode *inode,
       /* Try to write to the sector. */
 
       finfo("Write MTD block %d from offset %d\n", nextblock, offset);
+      smart_ckpt_touch(dev, nextblock / mtdBlksPerErase);
       nxfrd = MTD_BWRITE(dev->mtd, nextblock, blkstowrite, &buffer[offset]);
       if (nxfrd != blkstowrite)
         {
@@ -1321,6 +1389,8 @@ static ssize_t smart_bytewrite(FAR struct smart_struct_s *dev, size_t offset,
 {
   ssize_t       ret;
 
+  smart_ckpt_touch(dev, offset / dev->geo.erasesize);
+
 #ifdef CONFIG_MTD_BYTE_WRITE
   /* Check if the underlying MTD device supports write */
 
@@ -1814,14 +1884,967 @@ static int smart_set_wear_level(FAR struct smart_struct_s *dev, uint16_t block,
         {
           smart_find_wear_minmax(dev);
 
-          if (oldlevel != dev->minwearlevel)
-              finfo("##### New min wear level = %d\n", dev->minwearlevel);
-        }
+          if (oldlevel != dev->minwearlevel)
+              finfo("##### New min wear level = %d\n", dev->minwearlevel);
+        }
+    }
+
+  return 0;
+}
+#endif
+
+/****************************************************************************
+ * Name: smart_scan_format
+ *
+ * Description:  Validate the format signature in the physical sector that
+ *               holds logical sector zero and get the format information.
+ *
+ ****************************************************************************/
+
+static int smart_scan_format(FAR struct smart_struct_s *dev, uint16_t sector)
+{
+  uint32_t  readaddress;
+  int       ret;
+#ifdef CONFIG_SMARTFS_MULTI_ROOT_DIRS
+  int       x;
+  char      devname[22];
+  FAR struct smart_multiroot_device_s *rootdirdev;
+#endif
+
+  /* Read the sector data */
+
+  readaddress = sector * dev->mtdBlksPerSector * dev->geo.blocksize;
+  ret = MTD_READ(dev->mtd, readaddress, 32, (FAR uint8_t *)dev->rwbuffer);
+  if (ret != 32)
+    {
+      ferr("ERROR: Error reading physical sector %d.\n", sector);
+      return ret < 0 ? ret : -EIO;
+    }
+
+  /* Validate the format signature */
+
+  if (dev->rwbuffer[SMART_FMT_POS1] != SMART_FMT_SIG1 ||
+      dev->rwbuffer[SMART_FMT_POS2] != SMART_FMT_SIG2 ||
+      dev->rwbuffer[SMART_FMT_POS3] != SMART_FMT_SIG3 ||
+      dev->rwbuffer[SMART_FMT_POS4] != SMART_FMT_SIG4)
+    {
+      return -ENOENT;
+    }
+
+  /* Mark the volume as formatted and set the sector size */
+
+  dev->formatstatus = SMART_FMT_STAT_FORMATTED;
+  dev->namesize = dev->rwbuffer[SMART_FMT_NAMESIZE_POS];
+  dev->formatversion = dev->rwbuffer[SMART_FMT_VERSION_POS];
+
+#ifdef CONFIG_SMARTFS_MULTI_ROOT_DIRS
+  dev->rootdirentries = dev->rwbuffer[SMART_FMT_ROOTDIRS_POS];
+
+  /* If rootdirentries is greater than 1, then we need to register
+   * additional block devices.
+   */
+
+  for (x = 1; x < dev->rootdirentries; x++)
+    {
+      if (dev->partname[0] != '\0')
+        {
+          snprintf(dev->rwbuffer, sizeof(devname), "/dev/smart%d%sd%d",
+                  dev->minor, dev->partname, x+1);
+        }
+      else
+        {
+          snprintf(devname, sizeof(devname), "/dev/smart%dd%d", dev->minor,
+                   x + 1);
+        }
+
+      /* Inode private data is a reference to a struct containing
+       * the SMART device structure and the root directory number.
+       */
+
+      rootdirdev = (struct smart_multiroot_device_s *)
+        smart_malloc(dev, sizeof(*rootdirdev), "Root Dir");
+      if (rootdirdev == NULL)
+        {
+          ferr("ERROR: Memory alloc failed\n");
+          return -ENOMEM;
+        }
+
+      /* Populate the rootdirdev */
+
+      rootdirdev->dev = dev;
+      rootdirdev->rootdirnum = x;
+      ret = register_blockdriver(dev->rwbuffer, &g_bops, 0, rootdirdev);
+
+      /* Inode private data is a reference to the SMART device structure */
+
+      ret = register_blockdriver(devname, &g_bops, 0, rootdirdev);
+    }
+#endif
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: smart_scan_sector
+ *
+ * Description:  Read the header of one physical sector and account for it
+ *               in the sector map and in the free and released counts.
+ *
+ ****************************************************************************/
+
+static int smart_scan_sector(FAR struct smart_struct_s *dev, uint16_t sector)
+{
+  int       ret;
+  uint16_t  logicalsector;
+  uint16_t  loser;
+  uint32_t  readaddress;
+  uint32_t  offset;
+  uint16_t  seq1;
+  uint16_t  seq2;
+  struct    smart_sect_header_s header;
+#ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
+  int       dupsector;
+  uint16_t  duplogsector;
+#endif
+
+  finfo("Scan sector %d\n", sector);
+
+  /* Calculate the read address for this sector */
+
+  readaddress = sector * dev->mtdBlksPerSector * dev->geo.blocksize;
+
+  /* Read the header for this sector */
+
+  ret = MTD_READ(dev->mtd, readaddress, sizeof(struct smart_sect_header_s),
+                 (FAR uint8_t *) &header);
+  if (ret != sizeof(struct smart_sect_header_s))
+    {
+      goto err_out;
+    }
+
+  /* Get the logical sector number for this physical sector */
+
+  logicalsector = *((FAR uint16_t *) header.logicalsector);
+#if CONFIG_SMARTFS_ERASEDSTATE == 0x00
+  if (logicalsector == 0)
+    {
+      logicalsector = -1;
+    }
+#endif
+
+  /* Test if this sector has been committed */
+
+  if ((header.status & SMART_STATUS_COMMITTED) ==
+          (CONFIG_SMARTFS_ERASEDSTATE & SMART_STATUS_COMMITTED))
+    {
+      return OK;
+    }
+
+  /* This block is commited, therefore not free.  Update the
+   * erase block's freecount.
+   */
+
+#ifdef CONFIG_MTD_SMART_PACK_COUNTS
+  smart_add_count(dev, dev->freecount, sector / dev->sectorsPerBlk, -1);
+#else
+  dev->freecount[sector / dev->sectorsPerBlk]--;
+#endif
+  dev->freesectors--;
+
+  /* Test if this sector has been release and if it has,
+   * update the erase block's releasecount.
+   */
+
+  if ((header.status & SMART_STATUS_RELEASED) !=
+          (CONFIG_SMARTFS_ERASEDSTATE & SMART_STATUS_RELEASED))
+    {
+      /* Keep track of the total number of released sectors and
+       * released sectors per erase block.
+       */
+
+      dev->releasesectors++;
+#ifdef CONFIG_MTD_SMART_PACK_COUNTS
+      smart_add_count(dev, dev->releasecount, sector / dev->sectorsPerBlk, 1);
+#else
+      dev->releasecount[sector / dev->sectorsPerBlk]++;
+#endif
+      return OK;
+    }
+
+  if ((header.status & SMART_STATUS_VERBITS) != SMART_STATUS_VERSION)
+    {
+      return OK;
+    }
+
+  /* Validate the logical sector number is in bounds */
+
+  if (logicalsector >= dev->totalsectors)
+    {
+      /* Error in logical sector read from the MTD device */
+
+      ferr("ERROR: Invalid logical sector %d at physical %d.\n",
+           logicalsector, sector);
+      return OK;
+    }
+
+  /* If this is logical sector zero, then read in the signature
+   * information to validate the format signature.
+   */
+
+  if (logicalsector == 0)
+    {
+      ret = smart_scan_format(dev, sector);
+      if (ret == -ENOENT)
+        {
+          /* Invalid signature on a sector claiming to be sector 0!
+           * What should we do?  Release it?
+           */
+
+          return OK;
+        }
+      else if (ret < 0)
+        {
+          goto err_out;
+        }
+    }
+
+  /* Test for duplicate logical sectors on the device */
+
+#ifndef CONFIG_MTD_SMART_MINIMIZE_RAM
+  if (dev->sMap[logicalsector] != 0xffff)
+#else
+  if (dev->sBitMap[logicalsector >> 3] & (1 << (logicalsector & 0x07)))
+#endif
+    {
+      /* Uh-oh, we found more than 1 physical sector claiming to be
+       * the same logical sector.  Use the sequence number information
+       * to resolve who wins.
+       */
+
+#if SMART_STATUS_VERSION == 1
+      if (header.status & SMART_STATUS_CRC)
+        {
+          seq2 = header.seq;
+        }
+      else
+        {
+          seq2 = *((FAR uint16_t *) &header.seq);
+        }
+#else
+      seq2 = header.seq;
+#endif
+
+      /* We must re-read the 1st physical sector to get it's seq number */
+
+#ifndef CONFIG_MTD_SMART_MINIMIZE_RAM
+      readaddress = dev->sMap[logicalsector]  * dev->mtdBlksPerSector * dev->geo.blocksize;
+#else
+      /* For minimize RAM, we have to rescan to find the 1st sector claiming to
+       * be this logical sector.
+       */
+
+      for (dupsector = 0; dupsector < sector; dupsector++)
+        {
+          /* Calculate the read address for this sector */
+
+          readaddress = dupsector * dev->mtdBlksPerSector * dev->geo.blocksize;
+
+          /* Read the header for this sector */
+
+          ret = MTD_READ(dev->mtd, readaddress, sizeof(struct smart_sect_header_s),
+                         (FAR uint8_t *) &header);
+          if (ret != sizeof(struct smart_sect_header_s))
+            {
+              goto err_out;
+            }
+
+          /* Get the logical sector number for this physical sector */
+
+          duplogsector = *((FAR uint16_t *) header.logicalsector);
+
+#if CONFIG_SMARTFS_ERASEDSTATE == 0x00
+          if (duplogsector == 0)
+            {
+              duplogsector = -1;
+            }
+#endif
+
+          /* Test if this sector has been committed */
+
+          if ((header.status & SMART_STATUS_COMMITTED) ==
+                  (CONFIG_SMARTFS_ERASEDSTATE & SMART_STATUS_COMMITTED))
+            {
+              continue;
+            }
+
+          /* Test if this sector has been release and skip it if it has */
+
+          if ((header.status & SMART_STATUS_RELEASED) !=
+                  (CONFIG_SMARTFS_ERASEDSTATE & SMART_STATUS_RELEASED))
+            {
+              continue;
+            }
+
+          if ((header.status & SMART_STATUS_VERBITS) != SMART_STATUS_VERSION)
+            {
+              continue;
+            }
+
+          /* Now compare if this logical sector matches the current sector */
+
+          if (duplogsector == logicalsector)
+            {
+              break;
+            }
+        }
+#endif
+
+      ret = MTD_READ(dev->mtd, readaddress, sizeof(struct smart_sect_header_s),
+              (FAR uint8_t *) &header);
+      if (ret != sizeof(struct smart_sect_header_s))
+        {
+          goto err_out;
+        }
+
+#if SMART_STATUS_VERSION == 1
+      if (header.status & SMART_STATUS_CRC)
+        {
+          seq1 = header.seq;
+        }
+      else
+        {
+          seq1 = *((FAR uint16_t *) &header.seq);
+        }
+#else
+      seq1 = header.seq;
+#endif
+
+      /* Now determine who wins */
+
+      if ((seq1 > 0xfff0 && seq2 < 10) || seq2 > seq1)
+        {
+          /* Seq 2 is the winner ... bigger or it wrapped */
+
+#ifndef CONFIG_MTD_SMART_MINIMIZE_RAM
+          loser = dev->sMap[logicalsector];
+          dev->sMap[logicalsector] = sector;
+#else
+          loser = dupsector;
+#endif
+        }
+      else
+        {
+          /* We keep the original mapping and seq2 is the loser */
+
+          loser = sector;
+        }
+
+      /* Now release the loser sector */
+
+      readaddress = loser  * dev->mtdBlksPerSector * dev->geo.blocksize;
+      ret = MTD_READ(dev->mtd, readaddress, sizeof(struct smart_sect_header_s),
+              (FAR uint8_t *) &header);
+      if (ret != sizeof(struct smart_sect_header_s))
+        {
+          goto err_out;
+        }
+
+#if CONFIG_SMARTFS_ERASEDSTATE == 0xff
+      header.status &= ~SMART_STATUS_RELEASED;
+#else
+      header.status |= SMART_STATUS_RELEASED;
+#endif
+      offset = readaddress + offsetof(struct smart_sect_header_s, status);
+      ret = smart_bytewrite(dev, offset, 1, &header.status);
+      if (ret < 0)
+        {
+          ferr("ERROR: Error %d releasing duplicate sector\n", -ret);
+          goto err_out;
+        }
+    }
+
+#ifndef CONFIG_MTD_SMART_MINIMIZE_RAM
+  /* Update the logical to physical sector map */
+
+  dev->sMap[logicalsector] = sector;
+#else
+  /* Mark the logical sector as used in the bitmap */
+
+  dev->sBitMap[logicalsector >> 3] |= 1 << (logicalsector & 0x07);
+
+  if (logicalsector < SMART_FIRST_ALLOC_SECTOR)
+    {
+      smart_add_sector_to_cache(dev, logicalsector, sector, __LINE__);
+    }
+#endif
+
+  return OK;
+
+err_out:
+  return ret < 0 ? ret : -EIO;
+}
+
+/****************************************************************************
+ * Name: smart_ckpt_offset
+ *
+ * Description:  Return the byte offset of a checkpoint region.  The regions
+ *               follow the erase blocks that are used for sectors.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+static off_t smart_ckpt_offset(FAR struct smart_struct_s *dev, int region)
+{
+  return (off_t)(dev->geo.neraseblocks + region * dev->ckptblocks) *
+         dev->geo.erasesize;
+}
+
+/****************************************************************************
+ * Name: smart_ckpt_program
+ *
+ * Description:  Program a few bytes of a checkpoint region.  Like
+ *               smart_bytewrite, but with a buffer of its own so that it
+ *               may be used while dev->rwbuffer holds sector data.
+ *
+ ****************************************************************************/
+
+static int smart_ckpt_program(FAR struct smart_struct_s *dev, off_t offset,
+                              FAR const uint8_t *buffer, size_t nbytes)
+{
+  off_t   block;
+  ssize_t ret;
+
+#ifdef CONFIG_MTD_BYTE_WRITE
+  if (dev->mtd->write != NULL)
+    {
+      ret = dev->mtd->write(dev->mtd, offset, nbytes, buffer);
+      return ret == nbytes ? OK : -EIO;
+    }
+#endif
+
+  /* Perform block-based read-modify-write */
+
+  block = offset / dev->geo.blocksize;
+  DEBUGASSERT(offset + nbytes <= (block + 1) * dev->geo.blocksize);
+
+  ret = MTD_BREAD(dev->mtd, block, 1, dev->ckptbuf);
+  if (ret != 1)
+    {
+      return -EIO;
+    }
+
+  memcpy(&dev->ckptbuf[offset - block * dev->geo.blocksize], buffer, nbytes);
+
+  ret = MTD_BWRITE(dev->mtd, block, 1, dev->ckptbuf);
+  return ret == 1 ? OK : -EIO;
+}
+
+/****************************************************************************
+ * Name: smart_ckpt_invalidate
+ *
+ * Description:  Make sure that no checkpoint on the device is used at the
+ *               next mount.  Both regions are invalidated because the older
+ *               checkpoint does not know about changes logged in the newer.
+ *
+ ****************************************************************************/
+
+static void smart_ckpt_invalidate(FAR struct smart_struct_s *dev)
+{
+  uint32_t magic = SMART_CKPT_INVALID;
+  int      region;
+  int      ret;
+
+  for (region = 0; region < SMART_CKPT_NREGIONS; region++)
+    {
+      ret = smart_ckpt_program(dev, smart_ckpt_offset(dev, region) +
+                               offsetof(struct smart_ckpt_s, magic),
+                               (FAR const uint8_t *)&magic, sizeof(magic));
+      if (ret < 0)
+        {
+          ferr("ERROR: Error %d invalidating checkpoint %d\n", -ret, region);
+        }
+    }
+
+  dev->ckptnlog = CONFIG_MTD_SMART_CHECKPOINT_NLOG;
+}
+
+/****************************************************************************
+ * Name: smart_ckpt_touch
+ *
+ * Description:  Called before an erase block is modified.  The first
+ *               modification of an erase block after a checkpoint was
+ *               written is recorded in the log of the checkpoint so that the
+ *               erase block is scanned at the next mount.
+ *
+ ****************************************************************************/
+
+static void smart_ckpt_touch(FAR struct smart_struct_s *dev, uint16_t block)
+{
+  uint16_t entry;
+  int      ret;
+
+  if (dev->ckptnlog >= CONFIG_MTD_SMART_CHECKPOINT_NLOG ||
+      block >= dev->geo.neraseblocks ||
+      (dev->ckptdirty[block >> 3] & (1 << (block & 0x07))) != 0)
+    {
+      /* No usable checkpoint or the erase block is already in the log */
+
+      return;
+    }
+
+  dev->ckptdirty[block >> 3] |= 1 << (block & 0x07);
+
+  entry = SMART_CKPT_ENTRY(block);
+  ret   = smart_ckpt_program(dev, smart_ckpt_offset(dev, dev->ckptregion) +
+                             dev->ckptlogoff +
+                             dev->ckptnlog * sizeof(uint16_t),
+                             (FAR const uint8_t *)&entry, sizeof(uint16_t));
+  if (ret < 0)
+    {
+      ferr("ERROR: Error %d logging erase block %d\n", -ret, block);
+      smart_ckpt_invalidate(dev);
+      return;
+    }
+
+  dev->ckptnlog++;
+}
+
+/****************************************************************************
+ * Name: smart_ckpt_write
+ *
+ * Description:  Write the sector map and the free and released counts to
+ *               the checkpoint region that does not hold the newest
+ *               checkpoint.  The header is written last, so an interrupted
+ *               write leaves the previous checkpoint (and its log) in use.
+ *               Must only be called while the RAM state matches the FLASH.
+ *
+ ****************************************************************************/
+
+static int smart_ckpt_write(FAR struct smart_struct_s *dev)
+{
+  FAR struct smart_ckpt_s *ckpt = (FAR struct smart_ckpt_s *)dev->ckptbuf;
+  FAR uint8_t *data = (FAR uint8_t *)dev->sMap;
+#ifdef CONFIG_MTD_SMART_ENABLE_CRC
+  FAR struct smart_allocsector_s *allocsect;
+#endif
+  uint32_t  datalen;
+  uint32_t  logoff;
+  uint32_t  nfull;
+  uint32_t  crc;
+  uint32_t  magic;
+  off_t     startblock;
+  ssize_t   nxfrd;
+  int       region;
+  int       ret;
+
+  if (dev->ckptblocks == 0 || dev->formatstatus != SMART_FMT_STAT_FORMATTED)
+    {
+      return OK;
+    }
+
+  /* The sector map and counts are followed by the log */
+
+  datalen = dev->totalsectors * sizeof(uint16_t) + (dev->neraseblocks << 1);
+  nfull   = datalen / dev->geo.blocksize;
+  logoff  = (nfull + 2) * dev->geo.blocksize;
+
+  if (logoff + CONFIG_MTD_SMART_CHECKPOINT_NLOG * sizeof(uint16_t) >
+      dev->ckptblocks * dev->geo.erasesize)
+    {
+      return -ENOSPC;
+    }
+
+  /* Erase the region that does not hold the newest checkpoint */
+
+  region     = dev->ckptregion == 0 ? 1 : 0;
+  startblock = smart_ckpt_offset(dev, region) / dev->geo.blocksize;
+
+  ret = MTD_ERASE(dev->mtd, dev->geo.neraseblocks + region * dev->ckptblocks,
+                  dev->ckptblocks);
+  if (ret < 0)
+    {
+      ferr("ERROR: Error %d erasing checkpoint %d\n", -ret, region);
+      return ret;
+    }
+
+  /* Write the data */
+
+  if (nfull > 0)
+    {
+      nxfrd = MTD_BWRITE(dev->mtd, startblock + 1, nfull, data);
+      if (nxfrd != nfull)
+        {
+          return -EIO;
+        }
+    }
+
+  if (datalen > nfull * dev->geo.blocksize)
+    {
+      memset(dev->ckptbuf, CONFIG_SMARTFS_ERASEDSTATE, dev->geo.blocksize);
+      memcpy(dev->ckptbuf, &data[nfull * dev->geo.blocksize],
+             datalen - nfull * dev->geo.blocksize);
+
+      nxfrd = MTD_BWRITE(dev->mtd, startblock + 1 + nfull, 1, dev->ckptbuf);
+      if (nxfrd != 1)
+        {
+          return -EIO;
+        }
+    }
+
+  /* Then the header */
+
+  memset(dev->ckptbuf, CONFIG_SMARTFS_ERASEDSTATE, dev->geo.blocksize);
+  ckpt->magic          = SMART_CKPT_MAGIC;
+  ckpt->seq            = dev->ckptseq + 1;
+  ckpt->crc            = 0;
+  ckpt->totalsectors   = dev->totalsectors;
+  ckpt->neraseblocks   = dev->neraseblocks;
+  ckpt->sectorsize     = dev->sectorsize;
+  ckpt->freesectors    = dev->freesectors;
+  ckpt->releasesectors = dev->releasesectors;
+  ckpt->nlog           = CONFIG_MTD_SMART_CHECKPOINT_NLOG;
+
+  crc       = crc32part(dev->ckptbuf, sizeof(struct smart_ckpt_s), 0);
+  ckpt->crc = crc32part(data, datalen, crc);
+
+  nxfrd = MTD_BWRITE(dev->mtd, startblock, 1, dev->ckptbuf);
+  if (nxfrd != 1)
+    {
+      return -EIO;
+    }
+
+  /* Retire the previous checkpoint.  Its log ends here, so it must not be
+   * used if the new header ever becomes unreadable.  If power fails before
+   * this, the new checkpoint is still used because it is newer.
+   */
+
+  if (dev->ckptregion >= 0)
+    {
+      magic = SMART_CKPT_INVALID;
+      ret   = smart_ckpt_program(dev, smart_ckpt_offset(dev, dev->ckptregion) +
+                                 offsetof(struct smart_ckpt_s, magic),
+                                 (FAR const uint8_t *)&magic, sizeof(magic));
+      if (ret < 0)
+        {
+          ferr("ERROR: Error %d retiring checkpoint %d\n", -ret,
+               dev->ckptregion);
+        }
+    }
+
+  /* The new checkpoint is in use.  Start with an empty log. */
+
+  dev->ckptregion = region;
+  dev->ckptseq++;
+  dev->ckptlogoff = logoff;
+  dev->ckptnlog   = 0;
+  memset(dev->ckptdirty, 0, (dev->geo.neraseblocks + 7) >> 3);
+
+#ifdef CONFIG_MTD_SMART_ENABLE_CRC
+  /* Sectors that were allocated but not yet written are only mapped in
+   * RAM.  Their erase blocks must be scanned at the next mount.
+   */
+
+  for (allocsect = dev->allocsector; allocsect; allocsect = allocsect->next)
+    {
+      smart_ckpt_touch(dev, allocsect->physical / dev->sectorsPerBlk);
+    }
+#endif
+
+  finfo("Checkpoint %lu written to region %d\n",
+        (unsigned long)dev->ckptseq, region);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: smart_ckpt_update
+ *
+ * Description:  Called after each sector operation.  Writes a new
+ *               checkpoint when the log is getting full.  If the operation
+ *               failed, the RAM state may no longer match the FLASH, so the
+ *               checkpoints are invalidated and no new checkpoint is written
+ *               before the next full scan.
+ *
+ ****************************************************************************/
+
+static void smart_ckpt_update(FAR struct smart_struct_s *dev, int result)
+{
+  int ret;
+
+  if (dev->ckptblocks == 0 || dev->ckptnlog == SMART_CKPT_STALE)
+    {
+      return;
+    }
+
+  if (result < 0 && result != -ENOSPC)
+    {
+      smart_ckpt_invalidate(dev);
+      dev->ckptnlog = SMART_CKPT_STALE;
+      return;
+    }
+
+  if (dev->ckptnlog >= SMART_CKPT_HIGHWATER)
+    {
+      ret = smart_ckpt_write(dev);
+      if (ret < 0)
+        {
+          ferr("ERROR: Error %d writing checkpoint\n", -ret);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: smart_ckpt_load
+ *
+ * Description:  Load the sector map and the free and released counts from
+ *               the newest checkpoint, then scan the erase blocks that were
+ *               modified after it was written.  On failure, the caller must
+ *               perform a full scan.
+ *
+ ****************************************************************************/
+
+static int smart_ckpt_load(FAR struct smart_struct_s *dev)
+{
+  struct    smart_ckpt_s ckpt[SMART_CKPT_NREGIONS];
+  FAR struct smart_ckpt_s *newest;
+  uint32_t  datalen;
+  uint32_t  crc;
+  uint16_t  nlog;
+  uint16_t  entry;
+  uint16_t  block;
+  uint16_t  sector;
+  uint16_t  prerelease;
+  int       region;
+  int       ret;
+  int       x;
+
+  dev->ckptregion = -1;
+  dev->ckptnlog   = CONFIG_MTD_SMART_CHECKPOINT_NLOG;
+  memset(dev->ckptdirty, 0, (dev->geo.neraseblocks + 7) >> 3);
+
+  /* Find the newest checkpoint */
+
+  for (x = 0; x < SMART_CKPT_NREGIONS; x++)
+    {
+      ret = MTD_READ(dev->mtd, smart_ckpt_offset(dev, x),
+                     sizeof(struct smart_ckpt_s), (FAR uint8_t *)&ckpt[x]);
+      if (ret == sizeof(struct smart_ckpt_s) &&
+          ckpt[x].magic == SMART_CKPT_MAGIC &&
+          (dev->ckptregion < 0 || ckpt[x].seq > ckpt[dev->ckptregion].seq))
+        {
+          dev->ckptregion = x;
+        }
+    }
+
+  if (dev->ckptregion < 0)
+    {
+      return -ENOENT;
+    }
+
+  region        = dev->ckptregion;
+  newest        = &ckpt[region];
+  dev->ckptseq  = newest->seq;
+
+  /* It must have been written with the same geometry */
+
+  if (newest->totalsectors != dev->totalsectors ||
+      newest->neraseblocks != dev->neraseblocks ||
+      newest->sectorsize != dev->sectorsize ||
+      newest->nlog != CONFIG_MTD_SMART_CHECKPOINT_NLOG)
+    {
+      ret = -EINVAL;
+      goto errout;
+    }
+
+  /* Read the sector map and counts and validate the CRC */
+
+  datalen = dev->totalsectors * sizeof(uint16_t) + (dev->neraseblocks << 1);
+  ret = MTD_READ(dev->mtd, smart_ckpt_offset(dev, region) + dev->geo.blocksize,
+                 datalen, (FAR uint8_t *)dev->sMap);
+  if (ret != datalen)
+    {
+      ret = -EIO;
+      goto errout;
+    }
+
+  crc         = newest->crc;
+  newest->crc = 0;
+  if (crc32part((FAR uint8_t *)dev->sMap, datalen,
+                crc32part((FAR uint8_t *)newest, sizeof(struct smart_ckpt_s),
+                          0)) != crc)
+    {
+      ferr("ERROR: Checkpoint %lu CRC error\n", (unsigned long)newest->seq);
+      ret = -EINVAL;
+      goto errout;
+    }
+
+  /* Read the log of erase blocks modified after the checkpoint */
+
+  dev->ckptlogoff = (datalen / dev->geo.blocksize + 2) * dev->geo.blocksize;
+  for (nlog = 0; nlog < CONFIG_MTD_SMART_CHECKPOINT_NLOG; nlog++)
+    {
+      ret = MTD_READ(dev->mtd, smart_ckpt_offset(dev, region) +
+                     dev->ckptlogoff + nlog * sizeof(uint16_t),
+                     sizeof(uint16_t), (FAR uint8_t *)&entry);
+      if (ret != sizeof(uint16_t))
+        {
+          ret = -EIO;
+          goto errout;
+        }
+
+      if (entry == SMART_CKPT_ERASED)
+        {
+          break;
+        }
+
+      block = SMART_CKPT_ENTRY(entry);
+      if (block >= dev->neraseblocks)
+        {
+          ret = -EINVAL;
+          goto errout;
+        }
+
+      dev->ckptdirty[block >> 3] |= 1 << (block & 0x07);
+    }
+
+  if (nlog >= CONFIG_MTD_SMART_CHECKPOINT_NLOG)
+    {
+      /* The log overflowed.  Changes may be missing. */
+
+      ret = -ENOSPC;
+      goto errout;
+    }
+
+  /* Forget what the checkpoint says about the modified erase blocks */
+
+  dev->freesectors    = newest->freesectors;
+  dev->releasesectors = newest->releasesectors;
+  dev->formatstatus   = SMART_FMT_STAT_NOFMT;
+
+  for (sector = 0; sector < dev->totalsectors; sector++)
+    {
+      block = dev->sMap[sector] / dev->sectorsPerBlk;
+      if (dev->sMap[sector] != 0xffff &&
+          (dev->ckptdirty[block >> 3] & (1 << (block & 0x07))) != 0)
+        {
+          dev->sMap[sector] = 0xffff;
+        }
+    }
+
+  for (block = 0; block < dev->neraseblocks; block++)
+    {
+      if ((dev->ckptdirty[block >> 3] & (1 << (block & 0x07))) != 0)
+        {
+          prerelease = (block == dev->neraseblocks - 1 &&
+                        dev->totalsectors == 65534) ? 2 : 0;
+
+          dev->freesectors    += dev->availSectPerBlk - prerelease -
+                                 dev->freecount[block];
+          dev->releasesectors -= dev->releasecount[block] - prerelease;
+          dev->freecount[block]    = dev->availSectPerBlk - prerelease;
+          dev->releasecount[block] = prerelease;
+        }
+    }
+
+  /* Get the format information if logical sector zero was not moved */
+
+  if (dev->sMap[0] != 0xffff)
+    {
+      ret = smart_scan_format(dev, dev->sMap[0]);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+    }
+
+  /* Now scan the modified erase blocks.  From here on, duplicate sectors
+   * that are released by the scan are logged like any other change.
+   */
+
+  dev->ckptnlog = nlog;
+  for (block = 0; block < dev->neraseblocks; block++)
+    {
+      if ((dev->ckptdirty[block >> 3] & (1 << (block & 0x07))) == 0)
+        {
+          continue;
+        }
+
+      for (sector = block * dev->sectorsPerBlk;
+           sector < (block + 1) * dev->sectorsPerBlk &&
+           sector < dev->totalsectors; sector++)
+        {
+          ret = smart_scan_sector(dev, sector);
+          if (ret < 0)
+            {
+              goto errout;
+            }
+        }
+    }
+
+  finfo("Checkpoint %lu loaded, %d erase blocks scanned\n",
+        (unsigned long)dev->ckptseq, nlog);
+  return OK;
+
+errout:
+
+  /* Neither checkpoint may be used after the full scan changed the FLASH */
+
+  smart_ckpt_invalidate(dev);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: smart_ckpt_initialize
+ *
+ * Description:  Reserve two checkpoint regions at the end of the device.
+ *               They are sized for the largest sector map that any sector
+ *               size could need on this device.
+ *
+ ****************************************************************************/
+
+static int smart_ckpt_initialize(FAR struct smart_struct_s *dev)
+{
+  uint32_t  maxsectors;
+  uint32_t  size;
+  uint16_t  nblocks;
+
+  maxsectors = dev->geo.neraseblocks *
+               (dev->geo.erasesize / dev->geo.blocksize);
+  if (maxsectors > 65536)
+    {
+      maxsectors = 65536;
+    }
+
+  size    = maxsectors * sizeof(uint16_t) + (dev->geo.neraseblocks << 1) +
+            3 * dev->geo.blocksize +
+            CONFIG_MTD_SMART_CHECKPOINT_NLOG * sizeof(uint16_t);
+  nblocks = (size + dev->geo.erasesize - 1) / dev->geo.erasesize;
+
+  if (SMART_CKPT_NREGIONS * nblocks > dev->geo.neraseblocks / 4)
+    {
+      fwarn("WARNING: Device too small for checkpoints\n");
+      dev->ckptblocks = 0;
+      return OK;
+    }
+
+  dev->geo.neraseblocks -= SMART_CKPT_NREGIONS * nblocks;
+  dev->ckptblocks        = nblocks;
+  dev->ckptregion        = -1;
+  dev->ckptnlog          = CONFIG_MTD_SMART_CHECKPOINT_NLOG;
+
+  dev->ckptdirty = (FAR uint8_t *)smart_zalloc(dev,
+                   (dev->geo.neraseblocks + 7) >> 3, "Checkpoint log");
+  dev->ckptbuf   = (FAR uint8_t *)smart_malloc(dev, dev->geo.blocksize,
+                   "Checkpoint buffer");
+  if (dev->ckptdirty == NULL || dev->ckptbuf == NULL)
+    {
+      ferr("ERROR: Error allocating checkpoint buffers\n");
+      return -ENOMEM;
     }
 
-  return 0;
+  finfo("Checkpoint regions: 2 x %d erase blocks\n", nblocks);
+  return OK;
 }
-#endif
+#endif /* CONFIG_MTD_SMART_CHECKPOINT */
 
 /****************************************************************************
  * Name: smart_scan
@@ -1838,22 +2861,9 @@ static int smart_scan(FAR struct smart_struct_s *dev)
   int       ret;
   uint16_t  totalsectors;
   uint16_t  sectorsize, prerelease;
-  uint16_t  logicalsector;
-  uint16_t  loser;
   uint32_t  readaddress;
   uint32_t  offset;
-  uint16_t  seq1;
-  uint16_t  seq2;
   struct    smart_sect_header_s header;
-#ifdef CONFIG_MTD_SMART_MINIMIZE_RAM
-  int       dupsector;
-  uint16_t  duplogsector;
-#endif
-#ifdef CONFIG_SMARTFS_MULTI_ROOT_DIRS
-  int       x;
-  char      devname[22];
-  FAR struct smart_multiroot_device_s *rootdirdev;
-#endif
   static const short sizetbl[8] =
   {
     CONFIG_MTD_SMART_SECTOR_SIZE,
@@ -1921,9 +2931,24 @@ static int smart_scan(FAR struct smart_struct_s *dev)
       goto err_out;
     }
 
+  totalsectors        = dev->totalsectors;
+
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+  /* Use the checkpoint if there is one.  Only fall back to reading the
+   * header of every sector if it cannot be used.
+   */
+
+  ret = smart_ckpt_load(dev);
+  if (ret >= 0)
+    {
+      goto scan_done;
+    }
+
+  finfo("No usable checkpoint (%d), scanning all sectors\n", ret);
+#endif
+
   /* Initialize the device variables */
 
-  totalsectors        = dev->totalsectors;
   dev->formatstatus   = SMART_FMT_STAT_NOFMT;
   dev->freesectors    = dev->availSectPerBlk * dev->geo.neraseblocks;
   dev->releasesectors = 0;
@@ -1967,338 +2992,24 @@ static int smart_scan(FAR struct smart_struct_s *dev)
 
   for (sector = 0; sector < totalsectors; sector++)
     {
-      finfo("Scan sector %d\n", sector);
-
-      /* Calculate the read address for this sector */
-
-      readaddress = sector * dev->mtdBlksPerSector * dev->geo.blocksize;
-
-      /* Read the header for this sector */
-
-      ret = MTD_READ(dev->mtd, readaddress, sizeof(struct smart_sect_header_s),
-                     (FAR uint8_t *) &header);
-      if (ret != sizeof(struct smart_sect_header_s))
+      ret = smart_scan_sector(dev, sector);
+      if (ret < 0)
         {
           goto err_out;
         }
+    }
 
-      /* Get the logical sector number for this physical sector */
-
-      logicalsector = *((FAR uint16_t *) header.logicalsector);
-#if CONFIG_SMARTFS_ERASEDSTATE == 0x00
-      if (logicalsector == 0)
-        {
-          logicalsector = -1;
-        }
-#endif
-
-      /* Test if this sector has been committed */
-
-      if ((header.status & SMART_STATUS_COMMITTED) ==
-              (CONFIG_SMARTFS_ERASEDSTATE & SMART_STATUS_COMMITTED))
-        {
-          continue;
-        }
-
-      /* This block is commited, therefore not free.  Update the
-       * erase block's freecount.
-       */
-
-#ifdef CONFIG_MTD_SMART_PACK_COUNTS
-      smart_add_count(dev, dev->freecount, sector / dev->sectorsPerBlk, -1);
-#else
-      dev->freecount[sector / dev->sectorsPerBlk]--;
-#endif
-      dev->freesectors--;
-
-      /* Test if this sector has been release and if it has,
-       * update the erase block's releasecount.
-       */
-
-      if ((header.status & SMART_STATUS_RELEASED) !=
-              (CONFIG_SMARTFS_ERASEDSTATE & SMART_STATUS_RELEASED))
-        {
-          /* Keep track of the total number of released sectors and
-           * released sectors per erase block.
-           */
-
-          dev->releasesectors++;
-#ifdef CONFIG_MTD_SMART_PACK_COUNTS
-          smart_add_count(dev, dev->releasecount, sector / dev->sectorsPerBlk, 1);
-#else
-          dev->releasecount[sector / dev->sectorsPerBlk]++;
-#endif
-          continue;
-        }
-
-      if ((header.status & SMART_STATUS_VERBITS) != SMART_STATUS_VERSION)
-        {
-          continue;
-        }
-
-      /* Validate the logical sector number is in bounds */
-
-      if (logicalsector >= totalsectors)
-        {
-          /* Error in logical sector read from the MTD device */
-
-          ferr("ERROR: Invalid logical sector %d at physical %d.\n",
-               logicalsector, sector);
-          continue;
-        }
-
-      /* If this is logical sector zero, then read in the signature
-       * information to validate the format signature.
-       */
-
-      if (logicalsector == 0)
-        {
-          /* Read the sector data */
-
-          ret = MTD_READ(dev->mtd, readaddress, 32,
-                         (FAR uint8_t *)dev->rwbuffer);
-          if (ret != 32)
-            {
-              ferr("ERROR: Error reading physical sector %d.\n", sector);
-              goto err_out;
-            }
-
-          /* Validate the format signature */
-
-          if (dev->rwbuffer[SMART_FMT_POS1] != SMART_FMT_SIG1 ||
-              dev->rwbuffer[SMART_FMT_POS2] != SMART_FMT_SIG2 ||
-              dev->rwbuffer[SMART_FMT_POS3] != SMART_FMT_SIG3 ||
-              dev->rwbuffer[SMART_FMT_POS4] != SMART_FMT_SIG4)
-            {
-              /* Invalid signature on a sector claiming to be sector 0!
-               * What should we do?  Release it?
-               */
-
-              continue;
-            }
-
-          /* Mark the volume as formatted and set the sector size */
-
-          dev->formatstatus = SMART_FMT_STAT_FORMATTED;
-          dev->namesize = dev->rwbuffer[SMART_FMT_NAMESIZE_POS];
-          dev->formatversion = dev->rwbuffer[SMART_FMT_VERSION_POS];
-
-#ifdef CONFIG_SMARTFS_MULTI_ROOT_DIRS
-          dev->rootdirentries = dev->rwbuffer[SMART_FMT_ROOTDIRS_POS];
-
-          /* If rootdirentries is greater than 1, then we need to register
-           * additional block devices.
-           */
-
-          for (x = 1; x < dev->rootdirentries; x++)
-            {
-              if (dev->partname[0] != '\0')
-                {
-                  snprintf(dev->rwbuffer, sizeof(devname), "/dev/smart%d%sd%d",
-                          dev->minor, dev->partname, x+1);
-                }
-              else
-                {
-                  snprintf(devname, sizeof(devname), "/dev/smart%dd%d", dev->minor,
-                           x + 1);
-                }
-
-              /* Inode private data is a reference to a struct containing
-               * the SMART device structure and the root directory number.
-               */
-
-              rootdirdev = (struct smart_multiroot_device_s *)
-                smart_malloc(dev, sizeof(*rootdirdev), "Root Dir");
-              if (rootdirdev == NULL)
-                {
-                  ferr("ERROR: Memory alloc failed\n");
-                  ret = -ENOMEM;
-                  goto err_out;
-                }
-
-              /* Populate the rootdirdev */
-
-              rootdirdev->dev = dev;
-              rootdirdev->rootdirnum = x;
-              ret = register_blockdriver(dev->rwbuffer, &g_bops, 0, rootdirdev);
-
-              /* Inode private data is a reference to the SMART device structure */
-
-              ret = register_blockdriver(devname, &g_bops, 0, rootdirdev);
-            }
-#endif
-        }
-
-      /* Test for duplicate logical sectors on the device */
-
-#ifndef CONFIG_MTD_SMART_MINIMIZE_RAM
-      if (dev->sMap[logicalsector] != 0xffff)
-#else
-      if (dev->sBitMap[logicalsector >> 3] & (1 << (logicalsector & 0x07)))
-#endif
-        {
-          /* Uh-oh, we found more than 1 physical sector claiming to be
-           * the same logical sector.  Use the sequence number information
-           * to resolve who wins.
-           */
-
-#if SMART_STATUS_VERSION == 1
-          if (header.status & SMART_STATUS_CRC)
-            {
-              seq2 = header.seq;
-            }
-          else
-            {
-              seq2 = *((FAR uint16_t *) &header.seq);
-            }
-#else
-          seq2 = header.seq;
-#endif
-
-          /* We must re-read the 1st physical sector to get it's seq number */
-
-#ifndef CONFIG_MTD_SMART_MINIMIZE_RAM
-          readaddress = dev->sMap[logicalsector]  * dev->mtdBlksPerSector * dev->geo.blocksize;
-#else
-          /* For minimize RAM, we have to rescan to find the 1st sector claiming to
-           * be this logical sector.
-           */
-
-          for (dupsector = 0; dupsector < sector; dupsector++)
-            {
-              /* Calculate the read address for this sector */
-
-              readaddress = dupsector * dev->mtdBlksPerSector * dev->geo.blocksize;
-
-              /* Read the header for this sector */
-
-              ret = MTD_READ(dev->mtd, readaddress, sizeof(struct smart_sect_header_s),
-                             (FAR uint8_t *) &header);
-              if (ret != sizeof(struct smart_sect_header_s))
-                {
-                  goto err_out;
-                }
-
-              /* Get the logical sector number for this physical sector */
-
-              duplogsector = *((FAR uint16_t *) header.logicalsector);
-
-#if CONFIG_SMARTFS_ERASEDSTATE == 0x00
-              if (duplogsector == 0)
-                {
-                  duplogsector = -1;
-                }
-#endif
-
-              /* Test if this sector has been committed */
-
-              if ((header.status & SMART_STATUS_COMMITTED) ==
-                      (CONFIG_SMARTFS_ERASEDSTATE & SMART_STATUS_COMMITTED))
-                {
-                  continue;
-                }
-
-              /* Test if this sector has been release and skip it if it has */
-
-              if ((header.status & SMART_STATUS_RELEASED) !=
-                      (CONFIG_SMARTFS_ERASEDSTATE & SMART_STATUS_RELEASED))
-                {
-                  continue;
-                }
-
-              if ((header.status & SMART_STATUS_VERBITS) != SMART_STATUS_VERSION)
-                {
-                  continue;
-                }
-
-              /* Now compare if this logical sector matches the current sector */
-
-              if (duplogsector == logicalsector)
-                {
-                  break;
-                }
-            }
-#endif
-
-          ret = MTD_READ(dev->mtd, readaddress, sizeof(struct smart_sect_header_s),
-                  (FAR uint8_t *) &header);
-          if (ret != sizeof(struct smart_sect_header_s))
-            {
-              goto err_out;
-            }
-
-#if SMART_STATUS_VERSION == 1
-          if (header.status & SMART_STATUS_CRC)
-            {
-              seq1 = header.seq;
-            }
-          else
-            {
-              seq1 = *((FAR uint16_t *) &header.seq);
-            }
-#else
-          seq1 = header.seq;
-#endif
-
-          /* Now determine who wins */
-
-          if ((seq1 > 0xfff0 && seq2 < 10) || seq2 > seq1)
-            {
-              /* Seq 2 is the winner ... bigger or it wrapped */
-
-#ifndef CONFIG_MTD_SMART_MINIMIZE_RAM
-              loser = dev->sMap[logicalsector];
-              dev->sMap[logicalsector] = sector;
-#else
-              loser = dupsector;
-#endif
-            }
-          else
-            {
-              /* We keep the original mapping and seq2 is the loser */
-
-              loser = sector;
-            }
-
-          /* Now release the loser sector */
-
-          readaddress = loser  * dev->mtdBlksPerSector * dev->geo.blocksize;
-          ret = MTD_READ(dev->mtd, readaddress, sizeof(struct smart_sect_header_s),
-                  (FAR uint8_t *) &header);
-          if (ret != sizeof(struct smart_sect_header_s))
-            {
-              goto err_out;
-            }
-
-#if CONFIG_SMARTFS_ERASEDSTATE == 0xff
-          header.status &= ~SMART_STATUS_RELEASED;
-#else
-          header.status |= SMART_STATUS_RELEASED;
-#endif
-          offset = readaddress + offsetof(struct smart_sect_header_s, status);
-          ret = smart_bytewrite(dev, offset, 1, &header.status);
-          if (ret < 0)
-            {
-              ferr("ERROR: Error %d releasing duplicate sector\n", -ret);
-              goto err_out;
-            }
-        }
-
-#ifndef CONFIG_MTD_SMART_MINIMIZE_RAM
-      /* Update the logical to physical sector map */
-
-      dev->sMap[logicalsector] = sector;
-#else
-      /* Mark the logical sector as used in the bitmap */
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+  /* Save the result so that the next mount does not need a full scan */
 
-      dev->sBitMap[logicalsector >> 3] |= 1 << (logicalsector & 0x07);
+  ret = smart_ckpt_write(dev);
+  if (ret < 0)
+    {
+      ferr("ERROR: Error %d writing checkpoint\n", -ret);
+    }
 
-      if (logicalsector < SMART_FIRST_ALLOC_SECTOR)
-        {
-          smart_add_sector_to_cache(dev, logicalsector, sector, __LINE__);
-        }
+scan_done:
 #endif
-    }
 
 #if defined (CONFIG_MTD_SMART_WEAR_LEVEL) && (SMART_STATUS_VERSION == 1)
 #ifdef CONFIG_MTD_SMART_CONVERT_WEAR_FORMAT
@@ -2519,6 +3230,7 @@ static void smart_erase_block_if_empty(FAR struct smart_struct_s *dev,
       dev->unusedsectors += freecount;
       dev->blockerases++;
 #endif
+      smart_ckpt_touch(dev, block);
       MTD_ERASE(dev->mtd, block, 1);
 
 #ifdef CONFIG_MTD_SMART_SECTOR_ERASE_DEBUG
@@ -2942,6 +3654,15 @@ static inline int smart_llformat(FAR struct smart_struct_s *dev, unsigned long a
       return ret;
     }
 
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+  /* The checkpoints were erased, too.  A new one is written when the
+   * formatted device is scanned.
+   */
+
+  dev->ckptregion = -1;
+  dev->ckptnlog   = CONFIG_MTD_SMART_CHECKPOINT_NLOG;
+#endif
+
   /* Now construct a logical sector zero header to write to the device. */
 
   sectorheader = (FAR struct smart_sect_header_s *) dev->rwbuffer;
@@ -3170,6 +3891,7 @@ static int smart_relocate_sector(FAR struct smart_struct_s *dev,
 
   /* Write the data to the new physical sector location */
 
+  smart_ckpt_touch(dev, newsector / dev->sectorsPerBlk);
   ret = MTD_BWRITE(dev->mtd, newsector * dev->mtdBlksPerSector,
                    dev->mtdBlksPerSector, (FAR uint8_t *) dev->rwbuffer);
 
@@ -3183,6 +3905,7 @@ static int smart_relocate_sector(FAR struct smart_struct_s *dev,
 
   /* Write the data to the new physical sector location */
 
+  smart_ckpt_touch(dev, newsector / dev->sectorsPerBlk);
   ret = MTD_BWRITE(dev->mtd, newsector * dev->mtdBlksPerSector,
                    dev->mtdBlksPerSector, (FAR uint8_t *) dev->rwbuffer);
 
@@ -3398,6 +4121,7 @@ static int smart_relocate_block(FAR struct smart_struct_s *dev, uint16_t block)
 
   /* Now erase the erase block */
 
+  smart_ckpt_touch(dev, block);
   MTD_ERASE(dev->mtd, block, 1);
 #if defined(CONFIG_FS_PROCFS) && !defined(CONFIG_FS_PROCFS_EXCLUDE_SMARTFS)
   dev->unusedsectors += freecount;
@@ -4186,6 +4910,7 @@ static int smart_write_alloc_sector(FAR struct smart_struct_s *dev,
 
 #ifndef CONFIG_MTD_SMART_ENABLE_CRC
   finfo("Write MTD block %d\n", physical * dev->mtdBlksPerSector);
+  smart_ckpt_touch(dev, physical / dev->sectorsPerBlk);
   ret = MTD_BWRITE(dev->mtd, physical * dev->mtdBlksPerSector, 1,
       (FAR uint8_t *) dev->rwbuffer);
   if (ret != 1)
@@ -4536,6 +5261,7 @@ static int smart_writesector(FAR struct smart_struct_s *dev,
     {
       /* Write the entire sector to the new physical location, uncommitted. */
 
+      smart_ckpt_touch(dev, physsector / dev->sectorsPerBlk);
       ret = MTD_BWRITE(dev->mtd, physsector * dev->mtdBlksPerSector,
               dev->mtdBlksPerSector, (FAR uint8_t *) dev->rwbuffer);
       if (ret != dev->mtdBlksPerSector)
@@ -4620,6 +5346,7 @@ static int smart_writesector(FAR struct smart_struct_s *dev,
 #ifdef CONFIG_MTD_SMART_ENABLE_CRC
       /* Write the entire sector to FLASH when CRC enabled */
 
+      smart_ckpt_touch(dev, physsector / dev->sectorsPerBlk);
       ret = MTD_BWRITE(dev->mtd, physsector * dev->mtdBlksPerSector,
               dev->mtdBlksPerSector, (FAR uint8_t *) dev->rwbuffer);
       if (ret != dev->mtdBlksPerSector)
@@ -5257,6 +5984,7 @@ static int smart_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
       /* Allocate a logical sector for the upper layer file system */
 
       ret = smart_allocsector(dev, arg);
+      smart_ckpt_update(dev, ret);
       goto ok_out;
 
     case BIOC_FREESECT:
@@ -5264,6 +5992,7 @@ static int smart_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
       /* Free the specified logical sector */
 
       ret = smart_freesector(dev, arg);
+      smart_ckpt_update(dev, ret);
       goto ok_out;
 
     case BIOC_WRITESECT:
@@ -5281,6 +6010,7 @@ static int smart_ioctl(FAR struct inode *inode, int cmd, unsigned long arg)
         }
 #endif
 
+      smart_ckpt_update(dev, ret);
       goto ok_out;
 #endif /* CONFIG_FS_WRITABLE */
 
@@ -5414,6 +6144,16 @@ int smart_initialize(int minor, FAR struct mtd_dev_s *mtd, FAR const char *partn
           goto errout;
         }
 
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+      /* Reserve the checkpoint regions at the end of the device */
+
+      ret = smart_ckpt_initialize(dev);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+#endif
+
       /* Set the sector size to the default for now */
 
       dev->sectorsize = 0;
@@ -5541,6 +6281,10 @@ errout:
 #ifdef CONFIG_MTD_SMART_SECTOR_ERASE_DEBUG
   smart_free(dev, dev->erasecounts);
 #endif
+#ifdef CONFIG_MTD_SMART_CHECKPOINT
+  smart_free(dev, dev->ckptdirty);
+  smart_free(dev, dev->ckptbuf);
+#endif
 #ifdef CONFIG_SMARTFS_MULTI_ROOT_DIRS
   if (rootdirdev)
     {
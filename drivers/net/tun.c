@@ -64,9 +64,11 @@
 #include <nuttx/irq.h>
 #include <nuttx/wdog.h>
 #include <nuttx/wqueue.h>
+#include <nuttx/mm/iob.h>
 #include <nuttx/net/arp.h>
 #include <nuttx/net/netdev.h>
 #include <nuttx/net/ethernet.h>
+#include <nuttx/net/tcp.h>
 #include <nuttx/net/tun.h>
 
 #if defined(CONFIG_NET) && defined(CONFIG_NET_TUN)
@@ -108,6 +110,21 @@
 
 #define TUN_WDDELAY   (1*CLK_TCK)
 
+/* With TCP segmentation offload, the TCP layer may place a super-segment
+ * of up to CONFIG_NET_TUN_GSOSEGS full sized segments in the packet
+ * buffers.  It is split into a queue of normal segments that are then
+ * read one at a time.
+ */
+
+#if defined(CONFIG_NET_TCP_GSO) && defined(CONFIG_NET_IPv4)
+#  define TUN_GSO     1
+#  define TUN_BUFSIZE (CONFIG_NET_TUN_GSOSEGS * CONFIG_NET_TUN_PKTSIZE)
+#  define TUN_GSOPENDING(p) ((p)->gso_count > 0)
+#else
+#  define TUN_BUFSIZE CONFIG_NET_TUN_PKTSIZE
+#  define TUN_GSOPENDING(p) false
+#endif
+
 /* This is a helper pointer for accessing the contents of the Ethernet header */
 
 #ifdef CONFIG_NET_ETHERNET
@@ -141,11 +158,19 @@ struct tun_device_s
 
   bool              read_wait;
 
-  uint8_t           read_buf[CONFIG_NET_TUN_PKTSIZE];
+  uint8_t           read_buf[TUN_BUFSIZE];
   size_t            read_d_len;
-  uint8_t           write_buf[CONFIG_NET_TUN_PKTSIZE];
+  uint8_t           write_buf[TUN_BUFSIZE];
   size_t            write_d_len;
 
+#ifdef TUN_GSO
+  /* Segments of a super-segment waiting to be read */
+
+  FAR struct iob_s *gso_segs[CONFIG_NET_TUN_GSOSEGS];
+  uint8_t           gso_head;
+  uint8_t           gso_count;
+#endif
+
   sem_t             waitsem;
   sem_t             read_wait_sem;
 
@@ -170,6 +195,11 @@ static void tun_unlock(FAR struct tun_device_s *priv);
 /* Common TX logic */
 
 static int  tun_fd_transmit(FAR struct tun_device_s *priv);
+#ifdef TUN_GSO
+static int  tun_gso_output(FAR struct net_driver_s *dev);
+static void tun_gso_queue(FAR struct tun_device_s *priv);
+static void tun_gso_flush(FAR struct tun_device_s *priv);
+#endif
 static int  tun_txpoll(struct net_driver_s *dev);
 #ifdef CONFIG_NET_ETHERNET
 static int  tun_txpoll_tap(struct net_driver_s *dev);
@@ -375,6 +405,112 @@ static int tun_fd_transmit(FAR struct tun_device_s *priv)
   return OK;
 }
 
+/****************************************************************************
+ * Name: tun_gso_output
+ *
+ * Description:
+ *   The output function passed to tcp_gso_segment().  Copy the segment in
+ *   d_buf to the tail of the segment queue.  A segment that cannot be
+ *   queued is dropped; TCP will retransmit it.
+ *
+ * Input Parameters:
+ *   dev - Reference to the NuttX driver state structure
+ *
+ * Returned Value:
+ *   OK on success; a negated errno on failure
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+#ifdef TUN_GSO
+static int tun_gso_output(FAR struct net_driver_s *dev)
+{
+  FAR struct tun_device_s *priv = (FAR struct tun_device_s *)dev->d_private;
+  FAR struct iob_s *iob;
+  int ndx;
+  int ret;
+
+  if (priv->gso_count >= CONFIG_NET_TUN_GSOSEGS)
+    {
+      NETDEV_TXERRORS(dev);
+      return -ENOBUFS;
+    }
+
+  iob = iob_tryalloc(false);
+  if (iob == NULL)
+    {
+      NETDEV_TXERRORS(dev);
+      return -ENOMEM;
+    }
+
+  ret = iob_trycopyin(iob, dev->d_buf, dev->d_len, 0, false);
+  if (ret < 0)
+    {
+      iob_free_chain(iob);
+      NETDEV_TXERRORS(dev);
+      return ret;
+    }
+
+  ndx = (priv->gso_head + priv->gso_count) % CONFIG_NET_TUN_GSOSEGS;
+  priv->gso_segs[ndx] = iob;
+  priv->gso_count++;
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: tun_gso_queue
+ *
+ * Description:
+ *   Split the TCP super-segment in d_buf into the segment queue.
+ *
+ * Input Parameters:
+ *   priv - Reference to the driver state structure
+ *
+ * Returned Value:
+ *   None
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+#ifdef TUN_GSO
+static void tun_gso_queue(FAR struct tun_device_s *priv)
+{
+  (void)tcp_gso_segment(&priv->dev, tun_gso_output);
+  priv->dev.d_len = 0;
+}
+#endif
+
+/****************************************************************************
+ * Name: tun_gso_flush
+ *
+ * Description:
+ *   Discard all segments in the segment queue.
+ *
+ * Input Parameters:
+ *   priv - Reference to the driver state structure
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+#ifdef TUN_GSO
+static void tun_gso_flush(FAR struct tun_device_s *priv)
+{
+  while (priv->gso_count > 0)
+    {
+      iob_free_chain(priv->gso_segs[priv->gso_head]);
+      priv->gso_head = (priv->gso_head + 1) % CONFIG_NET_TUN_GSOSEGS;
+      priv->gso_count--;
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: tun_txpoll
  *
@@ -476,7 +612,17 @@ static int tun_txpoll_tap(struct net_driver_s *dev)
         {
           /* Send the packet */
 
-          priv->read_d_len = priv->dev.d_len;
+#ifdef TUN_GSO
+          if (priv->dev.d_gsomss > 0)
+            {
+              tun_gso_queue(priv);
+            }
+          else
+#endif
+            {
+              priv->read_d_len = priv->dev.d_len;
+            }
+
           tun_fd_transmit(priv);
 
           return 1;
@@ -530,7 +676,17 @@ static int tun_txpoll_tun(struct net_driver_s *dev)
         {
           /* Send the packet */
 
-          priv->read_d_len = priv->dev.d_len;
+#ifdef TUN_GSO
+          if (priv->dev.d_gsomss > 0)
+            {
+              tun_gso_queue(priv);
+            }
+          else
+#endif
+            {
+              priv->read_d_len = priv->dev.d_len;
+            }
+
           tun_fd_transmit(priv);
 
           return 1;
@@ -643,7 +799,17 @@ static void tun_net_receive_tap(FAR struct tun_device_s *priv)
 
           /* And send the packet */
 
-          priv->write_d_len = priv->dev.d_len;
+#ifdef TUN_GSO
+          if (priv->dev.d_gsomss > 0)
+            {
+              tun_gso_queue(priv);
+            }
+          else
+#endif
+            {
+              priv->write_d_len = priv->dev.d_len;
+            }
+
           tun_fd_transmit(priv);
         }
     }
@@ -779,7 +945,17 @@ static void tun_net_receive_tun(FAR struct tun_device_s *priv)
 
   if (priv->dev.d_len > 0)
     {
-      priv->write_d_len = priv->dev.d_len;
+#ifdef TUN_GSO
+      if (priv->dev.d_gsomss > 0)
+        {
+          tun_gso_queue(priv);
+        }
+      else
+#endif
+        {
+          priv->write_d_len = priv->dev.d_len;
+        }
+
       tun_fd_transmit(priv);
     }
 }
@@ -843,7 +1019,7 @@ static void tun_poll_work(FAR void *arg)
    * the TX poll if he are unable to accept another packet for transmission.
    */
 
-  if (priv->read_d_len == 0)
+  if (priv->read_d_len == 0 && !TUN_GSOPENDING(priv))
     {
       /* If so, poll the network for new XMIT data. */
 
@@ -1000,7 +1176,7 @@ static void tun_txavail_work(FAR void *arg)
 
   /* Check if there is room to hold another network packet. */
 
-  if (priv->read_d_len != 0)
+  if (priv->read_d_len != 0 || TUN_GSOPENDING(priv))
     {
       tun_unlock(priv);
       return;
@@ -1192,6 +1368,17 @@ static int tun_dev_init(FAR struct tun_device_s *priv, FAR struct file *filep,
       return ret;
     }
 
+#ifdef TUN_GSO
+  /* Accept TCP super-segments that split into no more than
+   * CONFIG_NET_TUN_GSOSEGS segments of the full MSS.
+   */
+
+  priv->dev.d_gsosize = CONFIG_NET_TUN_GSOSEGS *
+                        (CONFIG_NET_TUN_PKTSIZE - priv->dev.d_llhdrlen -
+                         IPv4TCP_HDRLEN) +
+                        priv->dev.d_llhdrlen + IPv4TCP_HDRLEN;
+#endif
+
   priv->filep         = filep;        /* Set link to file */
   filep->f_priv       = priv;         /* Set link to TUN device */
 
@@ -1212,6 +1399,10 @@ static int tun_dev_uninit(FAR struct tun_device_s *priv)
 
   (void)netdev_unregister(&priv->dev);
 
+#ifdef TUN_GSO
+  tun_gso_flush(priv);
+#endif
+
   nxsem_destroy(&priv->waitsem);
   nxsem_destroy(&priv->read_wait_sem);
 
@@ -1343,7 +1534,7 @@ static ssize_t tun_read(FAR struct file *filep, FAR char *buffer,
       goto out;
     }
 
-  if (priv->read_d_len == 0)
+  if (priv->read_d_len == 0 && !TUN_GSOPENDING(priv))
     {
       if ((filep->f_oflags & O_NONBLOCK) != 0)
         {
@@ -1359,6 +1550,36 @@ static ssize_t tun_read(FAR struct file *filep, FAR char *buffer,
 
   net_lock();
 
+#ifdef TUN_GSO
+  /* Return the next segment of a super-segment */
+
+  if (priv->gso_count > 0)
+    {
+      FAR struct iob_s *iob = priv->gso_segs[priv->gso_head];
+
+      if (buflen < iob->io_pktlen)
+        {
+          ret = -EINVAL;
+        }
+      else
+        {
+          ret = iob_copyout((FAR uint8_t *)buffer, iob, iob->io_pktlen, 0);
+        }
+
+      iob_free_chain(iob);
+      priv->gso_head = (priv->gso_head + 1) % CONFIG_NET_TUN_GSOSEGS;
+      priv->gso_count--;
+
+      if (priv->gso_count == 0 && priv->read_d_len == 0)
+        {
+          tun_txdone(priv);
+        }
+
+      net_unlock();
+      goto out;
+    }
+#endif
+
   read_d_len = priv->read_d_len;
   if (buflen < read_d_len)
     {
@@ -1424,7 +1645,8 @@ int tun_poll(FAR struct file *filep, FAR struct pollfd *fds, bool setup)
        * So check it too.
        */
 
-      if (priv->read_d_len != 0 || priv->write_d_len != 0)
+      if (priv->read_d_len != 0 || priv->write_d_len != 0 ||
+          TUN_GSOPENDING(priv))
         {
           eventset |= (fds->events & POLLIN);
         }
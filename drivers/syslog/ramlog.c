@@ -99,6 +99,9 @@ struct ramlog_dev_s
 
 #ifdef CONFIG_RAMLOG_SYSLOG
 static int ramlog_flush(void);
+#ifdef CONFIG_SYSLOG_WRITE
+static ssize_t ramlog_syslog_write(FAR const char *buffer, size_t buflen);
+#endif
 #endif
 
 /* Helper functions */
@@ -107,7 +110,10 @@ static int ramlog_flush(void);
 static void ramlog_pollnotify(FAR struct ramlog_dev_s *priv,
                               pollevent_t eventset);
 #endif
-static ssize_t ramlog_addchar(FAR struct ramlog_dev_s *priv, char ch);
+static int     ramlog_addbyte(FAR struct ramlog_dev_s *priv, char ch);
+static int     ramlog_addchar(FAR struct ramlog_dev_s *priv, char ch);
+static ssize_t ramlog_addbuf(FAR struct ramlog_dev_s *priv,
+                             FAR const char *buffer, size_t len);
 
 /* Character driver methods */
 
@@ -129,7 +135,10 @@ static const struct syslog_channel_s g_ramlog_syslog_channel =
 {
   ramlog_putc,
   ramlog_putc,
-  ramlog_flush
+  ramlog_flush,
+#ifdef CONFIG_SYSLOG_WRITE
+  ramlog_syslog_write
+#endif
 };
 #endif
 
@@ -196,6 +205,22 @@ static int ramlog_flush(void)
 }
 #endif
 
+/****************************************************************************
+ * Name: ramlog_syslog_write
+ ****************************************************************************/
+
+#if defined(CONFIG_RAMLOG_SYSLOG) && defined(CONFIG_SYSLOG_WRITE)
+static ssize_t ramlog_syslog_write(FAR const char *buffer, size_t buflen)
+{
+  /* Add the whole buffer at once.  This keeps the output of one write
+   * contiguous in the RAMLOG (as is necessary for binary SYSLOG records).
+   * If the RAMLOG is full, only the part that was stored is reported.
+   */
+
+  return ramlog_addbuf(&g_sysdev, buffer, buflen);
+}
+#endif
+
 /****************************************************************************
  * Name: ramlog_pollnotify
  ****************************************************************************/
@@ -233,15 +258,19 @@ static void ramlog_pollnotify(FAR struct ramlog_dev_s *priv,
  * Name: ramlog_addchar
  ****************************************************************************/
 
-static int ramlog_addchar(FAR struct ramlog_dev_s *priv, char ch)
+/****************************************************************************
+ * Name: ramlog_addbyte
+ *
+ * Description:
+ *   Add one byte to the circular buffer.  The caller must have entered the
+ *   critical section.
+ *
+ ****************************************************************************/
+
+static int ramlog_addbyte(FAR struct ramlog_dev_s *priv, char ch)
 {
-  irqstate_t flags;
   size_t nexthead;
 
-  /* Disable interrupts (in case we are NOT called from interrupt handler) */
-
-  flags = enter_critical_section();
-
   /* Calculate the write index AFTER the next byte is written */
 
   nexthead = priv->rl_head + 1;
@@ -256,18 +285,94 @@ static int ramlog_addchar(FAR struct ramlog_dev_s *priv, char ch)
     {
       /* Yes... Return an indication that nothing was saved in the buffer. */
 
-      leave_critical_section(flags);
       return -EBUSY;
     }
 
-  /* No... copy the byte and re-enable interrupts */
+  /* No... copy the byte */
 
   priv->rl_buffer[priv->rl_head] = ch;
   priv->rl_head = nexthead;
-  leave_critical_section(flags);
   return OK;
 }
 
+/****************************************************************************
+ * Name: ramlog_addchar
+ ****************************************************************************/
+
+static int ramlog_addchar(FAR struct ramlog_dev_s *priv, char ch)
+{
+  irqstate_t flags;
+  int ret;
+
+  /* Disable interrupts (in case we are NOT called from interrupt handler) */
+
+  flags = enter_critical_section();
+  ret   = ramlog_addbyte(priv, ch);
+  leave_critical_section(flags);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: ramlog_addbuf
+ *
+ * Description:
+ *   Add a buffer of data to the circular buffer, entering the critical
+ *   section only once.  Returns the number of bytes from the buffer that
+ *   were added.  Data that does not fit is dropped on the floor.
+ *
+ ****************************************************************************/
+
+static ssize_t ramlog_addbuf(FAR struct ramlog_dev_s *priv,
+                             FAR const char *buffer, size_t len)
+{
+  irqstate_t flags;
+  ssize_t nwritten;
+  char ch;
+
+  /* This function may be called from an interrupt handler!  Semaphores
+   * cannot be used!
+   */
+
+  flags = enter_critical_section();
+
+  for (nwritten = 0; (size_t)nwritten < len; nwritten++)
+    {
+      /* Get the next character to output */
+
+      ch = buffer[nwritten];
+
+#ifdef CONFIG_RAMLOG_CRLF
+      /* Ignore carriage returns */
+
+      if (ch == '\r')
+        {
+          continue;
+        }
+
+      /* Pre-pend a carriage before a linefeed */
+
+      if (ch == '\n' && ramlog_addbyte(priv, '\r') < 0)
+        {
+          /* The buffer is full and nothing was saved. */
+
+          break;
+        }
+#endif
+
+      /* Then output the character */
+
+      if (ramlog_addbyte(priv, ch) < 0)
+        {
+          /* The buffer is full and nothing was saved. */
+
+          break;
+        }
+    }
+
+  leave_critical_section(flags);
+  return nwritten;
+}
+
 /****************************************************************************
  * Name: ramlog_read
  ****************************************************************************/
@@ -447,67 +552,17 @@ static ssize_t ramlog_write(FAR struct file *filep, FAR const char *buffer, size
   FAR struct inode *inode = filep->f_inode;
   FAR struct ramlog_dev_s *priv;
   ssize_t nwritten;
-  char ch;
-  int ret;
 
   /* Some sanity checking */
 
   DEBUGASSERT(inode && inode->i_private);
   priv = (FAR struct ramlog_dev_s *)inode->i_private;
 
-  /* Loop until all of the bytes have been written.  This function may be
-   * called from an interrupt handler!  Semaphores cannot be used!
-   *
-   * The write logic only needs to modify the rl_head index.  Therefore,
-   * there is a difference in the way that rl_head and rl_tail are protected:
-   * rl_tail is protected with a semaphore; rl_tail is protected by disabling
-   * interrupts.
+  /* Add all of the bytes to the circular buffer.  The data that does not
+   * fit is dropped on the floor.
    */
 
-  for (nwritten = 0; (size_t)nwritten < len; nwritten++)
-    {
-      /* Get the next character to output */
-
-      ch = buffer[nwritten];
-
-      /* Ignore carriage returns */
-
-#ifdef CONFIG_RAMLOG_CRLF
-      if (ch == '\r')
-        {
-          continue;
-        }
-
-      /* Pre-pend a carriage before a linefeed */
-
-      if (ch == '\n')
-        {
-          ret = ramlog_addchar(priv, '\r');
-          if (ret < 0)
-            {
-              /* The buffer is full and nothing was saved. Break out of the
-               * loop to return the number of bytes written up to this point.
-               * The data to be written is dropped on the floor.
-               */
-
-              break;
-            }
-        }
-#endif
-
-      /* Then output the character */
-
-      ret = ramlog_addchar(priv, ch);
-      if (ret < 0)
-        {
-          /* The buffer is full and nothing was saved. Break out of the
-           * loop to return the number of bytes written up to this point.
-           * The data to be written is dropped on the floor.
-           */
-
-          break;
-        }
-    }
+  nwritten = ramlog_addbuf(priv, buffer, len);
 
   /* Was anything written? */
 
@@ -42,7 +42,29 @@
 
 #include <nuttx/config.h>
 
+#include <sys/types.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include <time.h>
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* These are the types of the arguments packed by syslog_packargs() */
+
+enum syslog_argtype_e
+{
+  SYSLOG_ARG_NONE = 0,  /* No argument ("%%") */
+  SYSLOG_ARG_INT,       /* int (including char and short) */
+  SYSLOG_ARG_LONG,      /* long */
+  SYSLOG_ARG_LLONG,     /* long long */
+  SYSLOG_ARG_PTR,       /* void pointer ("%p") */
+  SYSLOG_ARG_DOUBLE,    /* double */
+  SYSLOG_ARG_STRING,    /* NUL-terminated string, copied */
+  SYSLOG_ARG_SKIP       /* Argument is consumed but not packed ("%n") */
+};
 
 /****************************************************************************
  * Public Data
@@ -289,6 +311,25 @@ int syslog_putc(int ch);
 
 ssize_t syslog_write(FAR const char *buffer, size_t buflen);
 
+/****************************************************************************
+ * Name: syslog_direct_write
+ *
+ * Description:
+ *   Write to the SYSLOG channel, bypassing the deferred SYSLOG buffer.  This
+ *   is used by the SYSLOG draining thread.
+ *
+ * Input Parameters:
+ *   buffer - The buffer containing the data to be output
+ *   buflen - The number of bytes in the buffer
+ *
+ * Returned Value:
+ *   On success, the number of characters written is returned.  A negated
+ *   errno value is returned on any failure.
+ *
+ ****************************************************************************/
+
+ssize_t syslog_direct_write(FAR const char *buffer, size_t buflen);
+
 /****************************************************************************
  * Name: syslog_force
  *
@@ -365,6 +406,175 @@ int syslog_dev_putc(int ch);
 int syslog_dev_flush(void);
 #endif
 
+/****************************************************************************
+ * Name: syslog_packargs
+ *
+ * Description:
+ *   Walk the format string 'fmt' and copy each of the arguments referenced
+ *   by 'ap' into 'buffer' in their raw, binary form.  String arguments are
+ *   copied.  The argument list is truncated if the buffer is too small.
+ *
+ * Input Parameters:
+ *   fmt    - The printf-style format string
+ *   ap     - The variable argument list
+ *   buffer - The buffer that will receive the packed arguments
+ *   buflen - The size of the buffer in bytes
+ *
+ * Returned Value:
+ *   The number of bytes used in 'buffer'.
+ *
+ ****************************************************************************/
+
+struct lib_outstream_s; /* Forward reference */
+
+size_t syslog_packargs(FAR const IPTR char *fmt, FAR va_list *ap,
+                       FAR uint8_t *buffer, size_t buflen);
+
+/****************************************************************************
+ * Name: syslog_unpackargs
+ *
+ * Description:
+ *   Format the message described by 'fmt' and the argument list previously
+ *   packed by syslog_packargs() to 'stream'.
+ *
+ * Input Parameters:
+ *   stream - The stream that will receive the formatted output
+ *   fmt    - The printf-style format string
+ *   args   - The packed argument list
+ *   arglen - The size of the packed argument list in bytes
+ *
+ * Returned Value:
+ *   The number of characters generated.
+ *
+ ****************************************************************************/
+
+int syslog_unpackargs(FAR struct lib_outstream_s *stream,
+                      FAR const IPTR char *fmt, FAR const uint8_t *args,
+                      size_t arglen);
+
+/****************************************************************************
+ * Name: syslog_binary
+ *
+ * Description:
+ *   Generate one binary SYSLOG record (see
+ *   include/nuttx/syslog/syslog_binary.h) and send it to the SYSLOG channel.
+ *
+ * Input Parameters:
+ *   priority - The syslog() priority
+ *   ts       - The time stamp of the message
+ *   fmt      - The format string
+ *   ap       - The variable argument list
+ *
+ * Returned Value:
+ *   The size of the binary record on success; a negated errno value is
+ *   returned on any failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSLOG_BINARY
+int syslog_binary(int priority, FAR const struct timespec *ts,
+                  FAR const IPTR char *fmt, FAR va_list *ap);
+#endif
+
+/****************************************************************************
+ * Name: syslog_deferred_initialize
+ *
+ * Description:
+ *   Start the kernel thread that drains the deferred SYSLOG buffers.  Until
+ *   this function has been called, all SYSLOG output is performed
+ *   synchronously.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned on
+ *   any failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSLOG_DEFERRED
+int syslog_deferred_initialize(void);
+#endif
+
+/****************************************************************************
+ * Name: syslog_deferred_ready
+ *
+ * Description:
+ *   Return true if SYSLOG output may be deferred.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSLOG_DEFERRED
+bool syslog_deferred_ready(void);
+#endif
+
+/****************************************************************************
+ * Name: syslog_deferred_write
+ *
+ * Description:
+ *   Add one pre-formatted message to the deferred SYSLOG buffer of the
+ *   current CPU.  This function never blocks and may be called from any
+ *   context, including interrupt handlers.
+ *
+ * Input Parameters:
+ *   buffer - The formatted message
+ *   buflen - The length of the message in bytes
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  -ENOSPC is returned if the message
+ *   was discarded because the buffer is full.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSLOG_DEFERRED
+int syslog_deferred_write(FAR const char *buffer, size_t buflen);
+#endif
+
+/****************************************************************************
+ * Name: syslog_deferred_format
+ *
+ * Description:
+ *   Add the format string pointer, the time stamp and the packed arguments
+ *   of one message to the deferred SYSLOG buffer of the current CPU.  The
+ *   message will be formatted later by the draining thread.
+ *
+ * Input Parameters:
+ *   ts  - The time stamp of the message (may be NULL)
+ *   fmt - The format string.  This must remain valid until the message is
+ *         drained.
+ *   ap  - The variable argument list
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  -ENOSPC is returned if the message
+ *   was discarded because the buffer is full.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSLOG_DEFERRED_FORMAT
+int syslog_deferred_format(FAR const struct timespec *ts,
+                           FAR const IPTR char *fmt, FAR va_list *ap);
+#endif
+
+/****************************************************************************
+ * Name: syslog_deferred_flush
+ *
+ * Description:
+ *   Output all deferred SYSLOG messages immediately using the sc_force()
+ *   method of the channel.  Used by the system crash-handling logic.
+ *
+ * Input Parameters:
+ *   channel - The SYSLOG channel to use in performing the flush operation.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSLOG_DEFERRED
+void syslog_deferred_flush(FAR const struct syslog_channel_s *channel);
+#endif
+
 #undef EXTERN
 #ifdef __cplusplus
 }
@@ -0,0 +1,178 @@
+/****************************************************************************
+ * drivers/syslog/syslog_binary.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <string.h>
+#include <syslog.h>
+#include <errno.h>
+
+#include <nuttx/syslog/syslog.h>
+#include <nuttx/syslog/syslog_binary.h>
+
+#include "syslog.h"
+
+#ifdef CONFIG_SYSLOG_BINARY
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_SYSLOG_BINARY_ARGSIZE
+#  define CONFIG_SYSLOG_BINARY_ARGSIZE 64
+#endif
+
+/* The size of the record without the packed arguments */
+
+#define SYSLOG_BINARY_OVERHEAD \
+  (SYSLOG_BINARY_HDRSIZE + sizeof(FAR void *) + SYSLOG_BINARY_CHKSIZE)
+
+/* The maximum size of the packed arguments.  The size is held in one byte
+ * and a deferred record may not exceed the deferred message size.
+ */
+
+#if CONFIG_SYSLOG_BINARY_ARGSIZE > 255
+#  define SYSLOG_BINARY_ARGMAX 255
+#else
+#  define SYSLOG_BINARY_ARGMAX CONFIG_SYSLOG_BINARY_ARGSIZE
+#endif
+
+#if defined(CONFIG_SYSLOG_DEFERRED) && \
+    (SYSLOG_BINARY_ARGMAX + 24) > CONFIG_SYSLOG_DEFERRED_MSGSIZE
+#  error CONFIG_SYSLOG_DEFERRED_MSGSIZE is too small for binary records
+#endif
+
+#ifdef CONFIG_ENDIAN_BIG
+#  define SYSLOG_BINARY_ENDIAN SYSLOG_BINARY_INFO_BIGENDIAN
+#else
+#  define SYSLOG_BINARY_ENDIAN 0
+#endif
+
+/* The target information byte is a constant */
+
+#define SYSLOG_BINARY_INFO \
+  ((SYSLOG_BINARY_LOG2(sizeof(int)) << SYSLOG_BINARY_INFO_INT_SHIFT) | \
+   (SYSLOG_BINARY_LOG2(sizeof(long)) << SYSLOG_BINARY_INFO_LONG_SHIFT) | \
+   (SYSLOG_BINARY_LOG2(sizeof(FAR void *)) << SYSLOG_BINARY_INFO_PTR_SHIFT) | \
+   SYSLOG_BINARY_ENDIAN)
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: syslog_binary
+ *
+ * Description:
+ *   Generate one binary SYSLOG record (see
+ *   include/nuttx/syslog/syslog_binary.h) and send it to the SYSLOG channel.
+ *   The message is not formatted.  If deferred SYSLOG output is enabled and
+ *   available, then the record is added to the deferred SYSLOG buffer.
+ *
+ * Input Parameters:
+ *   priority - The syslog() priority
+ *   ts       - The time stamp of the message
+ *   fmt      - The format string
+ *   ap       - The variable argument list
+ *
+ * Returned Value:
+ *   The size of the binary record on success; a negated errno value is
+ *   returned on any failure.
+ *
+ ****************************************************************************/
+
+int syslog_binary(int priority, FAR const struct timespec *ts,
+                  FAR const IPTR char *fmt, FAR va_list *ap)
+{
+  uint8_t record[SYSLOG_BINARY_OVERHEAD + SYSLOG_BINARY_ARGMAX];
+  uint32_t value;
+  uint8_t chksum;
+  size_t arglen;
+  size_t reclen;
+  size_t i;
+  int ret;
+
+  /* Pack the arguments first so that the length is known */
+
+  arglen = syslog_packargs(fmt, ap,
+                           &record[SYSLOG_BINARY_HDRSIZE + sizeof(fmt)],
+                           SYSLOG_BINARY_ARGMAX);
+
+  record[0] = SYSLOG_BINARY_SYNC;
+  record[1] = SYSLOG_BINARY_INFO;
+  record[2] = (uint8_t)priority;
+  record[3] = (uint8_t)arglen;
+
+  value = (uint32_t)ts->tv_sec;
+  memcpy(&record[4], &value, sizeof(uint32_t));
+  value = (uint32_t)(ts->tv_nsec / 1000);
+  memcpy(&record[8], &value, sizeof(uint32_t));
+  memcpy(&record[SYSLOG_BINARY_HDRSIZE], &fmt, sizeof(fmt));
+
+  /* Add the checksum so that all bytes of the record sum to zero */
+
+  reclen = SYSLOG_BINARY_OVERHEAD + arglen;
+  for (i = 0, chksum = 0; i < reclen - 1; i++)
+    {
+      chksum += record[i];
+    }
+
+  record[reclen - 1] = (uint8_t)(0 - chksum);
+
+  /* Output the record as a single write so that it is not interleaved with
+   * output from other threads.
+   */
+
+#ifdef CONFIG_SYSLOG_DEFERRED
+  if (syslog_deferred_ready())
+    {
+      ret = syslog_deferred_write((FAR const char *)record, reclen);
+    }
+  else
+#endif
+    {
+      ret = syslog_write((FAR const char *)record, reclen);
+    }
+
+  return ret < 0 ? ret : (int)reclen;
+}
+
+#endif /* CONFIG_SYSLOG_BINARY */
@@ -0,0 +1,699 @@
+/****************************************************************************
+ * drivers/syslog/syslog_deferred.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sched.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/irq.h>
+#include <nuttx/kthread.h>
+#include <nuttx/spinlock.h>
+#include <nuttx/streams.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/syslog/syslog.h>
+
+#include "syslog.h"
+
+#ifdef CONFIG_SYSLOG_DEFERRED
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+#  define SYSLOG_NCPUS CONFIG_SMP_NCPUS
+#else
+#  define SYSLOG_NCPUS 1
+#endif
+
+/* Memory barriers are only provided by arch/spinlock.h when spinlocks are
+ * supported.  Otherwise, the volatile buffer indices are sufficient.
+ */
+
+#ifndef SP_DMB
+#  define SP_DMB()
+#endif
+
+#ifndef CONFIG_SYSLOG_DEFERRED_BUFSIZE
+#  define CONFIG_SYSLOG_DEFERRED_BUFSIZE 1024
+#endif
+
+#ifndef CONFIG_SYSLOG_DEFERRED_MSGSIZE
+#  define CONFIG_SYSLOG_DEFERRED_MSGSIZE 128
+#endif
+
+#ifndef CONFIG_SYSLOG_DEFERRED_PRIORITY
+#  define CONFIG_SYSLOG_DEFERRED_PRIORITY 50
+#endif
+
+#ifndef CONFIG_SYSLOG_DEFERRED_STACKSIZE
+#  define CONFIG_SYSLOG_DEFERRED_STACKSIZE 2048
+#endif
+
+/* Each record in the circular buffer begins with a two byte length (not
+ * including the length itself) followed by a one byte record type.
+ */
+
+#define SYSLOG_DREC_LENSIZE  2
+#define SYSLOG_DREC_TEXT     0  /* Pre-formatted text follows */
+#define SYSLOG_DREC_FORMAT   1  /* Format pointer and packed arguments */
+
+/* The largest record that may be added to the circular buffer */
+
+#define SYSLOG_DREC_MAXSIZE  (CONFIG_SYSLOG_DEFERRED_MSGSIZE + 16)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* This is the per-CPU circular buffer.  Only one CPU adds records to the
+ * buffer (with its local interrupts disabled) and only the draining thread
+ * removes records from the buffer.  Neither side ever modifies the index
+ * owned by the other, so no lock is needed.
+ */
+
+struct syslog_dbuffer_s
+{
+  volatile unsigned int db_head;      /* Next byte to write (producer) */
+  volatile unsigned int db_tail;      /* Next byte to read (consumer) */
+  volatile uint32_t db_ndropped;      /* Number of messages discarded */
+  uint32_t db_nreported;              /* Number of discards reported */
+  uint8_t db_buffer[CONFIG_SYSLOG_DEFERRED_BUFSIZE];
+};
+
+/* Output from the draining thread is batched into this stream */
+
+struct syslog_dstream_s
+{
+  struct lib_outstream_s public;
+  FAR const struct syslog_channel_s *channel;
+  bool force;                         /* Use sc_force() */
+  uint16_t nbuffered;                 /* Number of bytes in buffer[] */
+  char buffer[CONFIG_SYSLOG_DEFERRED_MSGSIZE];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct syslog_dbuffer_s g_syslog_dbuffer[SYSLOG_NCPUS];
+
+/* The draining thread waits on this semaphore when there is nothing to
+ * output.  g_syslog_dwaiting is set while the thread is (about to be)
+ * waiting.
+ */
+
+static sem_t g_syslog_dsem;
+static volatile bool g_syslog_dwaiting;
+static pid_t g_syslog_dpid;
+
+/* Batched output of the draining thread */
+
+static struct syslog_dstream_s g_syslog_dstream;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: syslog_dbuffer_used
+ ****************************************************************************/
+
+static inline unsigned int syslog_dbuffer_used(unsigned int head,
+                                               unsigned int tail)
+{
+  return head >= tail ? head - tail :
+         CONFIG_SYSLOG_DEFERRED_BUFSIZE - tail + head;
+}
+
+/****************************************************************************
+ * Name: syslog_dbuffer_put
+ *
+ * Description:
+ *   Add one record to the circular buffer of the current CPU.  This never
+ *   blocks:  If there is insufficient space, the record is discarded and
+ *   counted.
+ *
+ ****************************************************************************/
+
+static int syslog_dbuffer_put(FAR const uint8_t *record, size_t reclen)
+{
+  FAR struct syslog_dbuffer_s *db;
+  irqstate_t flags;
+  unsigned int head;
+  unsigned int space;
+  uint8_t hdr[SYSLOG_DREC_LENSIZE];
+  size_t i;
+
+  /* Disable local interrupts only.  This prevents this thread from being
+   * preempted or migrated to a different CPU while it owns the CPU's
+   * buffer; it does not interfere with any other CPU.
+   */
+
+  flags = up_irq_save();
+  db    = &g_syslog_dbuffer[up_cpu_index()];
+  head  = db->db_head;
+  space = CONFIG_SYSLOG_DEFERRED_BUFSIZE - 1 -
+          syslog_dbuffer_used(head, db->db_tail);
+
+  if (reclen + SYSLOG_DREC_LENSIZE > space)
+    {
+      db->db_ndropped++;
+      up_irq_restore(flags);
+      return -ENOSPC;
+    }
+
+  hdr[0] = (uint8_t)(reclen & 0xff);
+  hdr[1] = (uint8_t)(reclen >> 8);
+
+  for (i = 0; i < SYSLOG_DREC_LENSIZE + reclen; i++)
+    {
+      db->db_buffer[head] = i < SYSLOG_DREC_LENSIZE ?
+                            hdr[i] : record[i - SYSLOG_DREC_LENSIZE];
+
+      if (++head >= CONFIG_SYSLOG_DEFERRED_BUFSIZE)
+        {
+          head = 0;
+        }
+    }
+
+  /* Make sure that the record is visible before the new head index */
+
+  SP_DMB();
+  db->db_head = head;
+  up_irq_restore(flags);
+
+  /* Wake up the draining thread if it is waiting */
+
+  SP_DMB();
+  if (g_syslog_dwaiting)
+    {
+      g_syslog_dwaiting = false;
+      (void)nxsem_post(&g_syslog_dsem);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: syslog_dbuffer_get
+ *
+ * Description:
+ *   Remove the oldest record from a circular buffer.
+ *
+ * Returned Value:
+ *   The size of the record, or zero if the buffer is empty.
+ *
+ ****************************************************************************/
+
+static size_t syslog_dbuffer_get(FAR struct syslog_dbuffer_s *db,
+                                 FAR uint8_t *record)
+{
+  unsigned int head = db->db_head;
+  unsigned int tail = db->db_tail;
+  size_t reclen;
+  size_t i;
+
+  /* Make sure that the record contents are read after the head index */
+
+  SP_DMB();
+
+  if (syslog_dbuffer_used(head, tail) < SYSLOG_DREC_LENSIZE)
+    {
+      return 0;
+    }
+
+  reclen = db->db_buffer[tail];
+  if (++tail >= CONFIG_SYSLOG_DEFERRED_BUFSIZE)
+    {
+      tail = 0;
+    }
+
+  reclen |= (size_t)db->db_buffer[tail] << 8;
+  if (++tail >= CONFIG_SYSLOG_DEFERRED_BUFSIZE)
+    {
+      tail = 0;
+    }
+
+  DEBUGASSERT(reclen <= SYSLOG_DREC_MAXSIZE);
+
+  for (i = 0; i < reclen; i++)
+    {
+      record[i] = db->db_buffer[tail];
+      if (++tail >= CONFIG_SYSLOG_DEFERRED_BUFSIZE)
+        {
+          tail = 0;
+        }
+    }
+
+  /* Release the space only after the record has been copied out */
+
+  SP_DMB();
+  db->db_tail = tail;
+  return reclen;
+}
+
+/****************************************************************************
+ * Name: syslog_dstream_flush
+ ****************************************************************************/
+
+static int syslog_dstream_flush(FAR struct lib_outstream_s *this)
+{
+  FAR struct syslog_dstream_s *stream = (FAR struct syslog_dstream_s *)this;
+  FAR const char *ptr = stream->buffer;
+  size_t remaining = stream->nbuffered;
+
+  if (stream->force)
+    {
+      while (remaining-- > 0)
+        {
+          stream->channel->sc_force(*ptr++);
+        }
+    }
+  else
+    {
+      while (remaining > 0)
+        {
+          ssize_t nwritten = syslog_direct_write(ptr, remaining);
+          if (nwritten <= 0 && nwritten != -EINTR)
+            {
+              break;
+            }
+          else if (nwritten > 0)
+            {
+              ptr       += nwritten;
+              remaining -= nwritten;
+            }
+        }
+    }
+
+  stream->nbuffered = 0;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: syslog_dstream_putc
+ ****************************************************************************/
+
+static void syslog_dstream_putc(FAR struct lib_outstream_s *this, int ch)
+{
+  FAR struct syslog_dstream_s *stream = (FAR struct syslog_dstream_s *)this;
+
+  /* Output is passed through unmodified since it may contain binary
+   * SYSLOG records.
+   */
+
+  stream->buffer[stream->nbuffered++] = ch;
+  this->nput++;
+
+  if (stream->nbuffered >= CONFIG_SYSLOG_DEFERRED_MSGSIZE)
+    {
+      syslog_dstream_flush(this);
+    }
+}
+
+/****************************************************************************
+ * Name: syslog_dstream_init
+ ****************************************************************************/
+
+static void syslog_dstream_init(FAR struct syslog_dstream_s *stream,
+                                FAR const struct syslog_channel_s *channel,
+                                bool force)
+{
+  stream->public.put   = syslog_dstream_putc;
+  stream->public.flush = syslog_dstream_flush;
+  stream->public.nput  = 0;
+  stream->channel      = channel;
+  stream->force        = force;
+  stream->nbuffered    = 0;
+}
+
+/****************************************************************************
+ * Name: syslog_drecord_output
+ *
+ * Description:
+ *   Output one deferred record to the draining stream.
+ *
+ ****************************************************************************/
+
+static void syslog_drecord_output(FAR struct lib_outstream_s *stream,
+                                  FAR const uint8_t *record, size_t reclen)
+{
+  size_t i;
+
+  if (reclen < 1)
+    {
+      return;
+    }
+
+  switch (record[0])
+    {
+      case SYSLOG_DREC_TEXT:
+        for (i = 1; i < reclen; i++)
+          {
+            stream->put(stream, record[i]);
+          }
+        break;
+
+#ifdef CONFIG_SYSLOG_DEFERRED_FORMAT
+      case SYSLOG_DREC_FORMAT:
+        {
+          FAR const IPTR char *fmt;
+          size_t offset = 1;
+
+          memcpy(&fmt, &record[offset], sizeof(fmt));
+          offset += sizeof(fmt);
+
+#ifdef CONFIG_SYSLOG_TIMESTAMP
+          {
+            uint32_t sec;
+            uint32_t usec;
+
+            memcpy(&sec, &record[offset], sizeof(uint32_t));
+            offset += sizeof(uint32_t);
+            memcpy(&usec, &record[offset], sizeof(uint32_t));
+            offset += sizeof(uint32_t);
+
+            lib_sprintf(stream, "[%5d.%06d] ", (int)sec, (int)usec);
+          }
+#endif
+
+#ifdef CONFIG_SYSLOG_PREFIX
+          lib_sprintf(stream, "%s", CONFIG_SYSLOG_PREFIX_STRING);
+#endif
+
+          (void)syslog_unpackargs(stream, fmt, &record[offset],
+                                  reclen - offset);
+        }
+        break;
+#endif
+
+      default:
+        break;
+    }
+}
+
+/****************************************************************************
+ * Name: syslog_ddrain
+ *
+ * Description:
+ *   Output and remove all records currently in all of the per-CPU buffers.
+ *
+ * Returned Value:
+ *   The number of records that were output.
+ *
+ ****************************************************************************/
+
+static int syslog_ddrain(FAR struct syslog_dstream_s *stream)
+{
+  uint8_t record[SYSLOG_DREC_MAXSIZE];
+  int nrecords = 0;
+  int cpu;
+
+  for (cpu = 0; cpu < SYSLOG_NCPUS; cpu++)
+    {
+      FAR struct syslog_dbuffer_s *db = &g_syslog_dbuffer[cpu];
+      uint32_t ndropped;
+      size_t reclen;
+
+      while ((reclen = syslog_dbuffer_get(db, record)) > 0)
+        {
+          syslog_drecord_output(&stream->public, record, reclen);
+          nrecords++;
+        }
+
+      /* Report any messages that were discarded on this CPU */
+
+      ndropped = db->db_ndropped;
+      if (ndropped != db->db_nreported)
+        {
+          lib_sprintf(&stream->public,
+                      "[syslog: %lu messages dropped on CPU%d]\n",
+                      (unsigned long)(ndropped - db->db_nreported), cpu);
+          db->db_nreported = ndropped;
+        }
+    }
+
+  syslog_dstream_flush(&stream->public);
+  return nrecords;
+}
+
+/****************************************************************************
+ * Name: syslog_dthread
+ *
+ * Description:
+ *   This is the low priority kernel thread that drains the deferred SYSLOG
+ *   buffers to the SYSLOG channel.
+ *
+ ****************************************************************************/
+
+static int syslog_dthread(int argc, char *argv[])
+{
+  for (; ; )
+    {
+      /* Output everything that has been buffered */
+
+      syslog_dstream_init(&g_syslog_dstream, g_syslog_channel, false);
+      (void)syslog_ddrain(&g_syslog_dstream);
+
+      /* Announce that we are about to wait, then check once more for any
+       * record that may have been added before the announcement was seen.
+       */
+
+      g_syslog_dwaiting = true;
+      SP_DMB();
+
+      if (syslog_ddrain(&g_syslog_dstream) == 0)
+        {
+          (void)nxsem_wait(&g_syslog_dsem);
+        }
+
+      g_syslog_dwaiting = false;
+    }
+
+  return OK; /* Not reachable */
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: syslog_deferred_initialize
+ *
+ * Description:
+ *   Start the kernel thread that drains the deferred SYSLOG buffers.  Until
+ *   this function has been called, all SYSLOG output is performed
+ *   synchronously.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned on
+ *   any failure.
+ *
+ ****************************************************************************/
+
+int syslog_deferred_initialize(void)
+{
+  pid_t pid;
+
+  if (g_syslog_dpid > 0)
+    {
+      return OK;
+    }
+
+  /* The draining thread only waits on this semaphore; it must not
+   * participate in priority inheritance.
+   */
+
+  nxsem_init(&g_syslog_dsem, 0, 0);
+  nxsem_setprotocol(&g_syslog_dsem, SEM_PRIO_NONE);
+
+  pid = kthread_create("syslogd", CONFIG_SYSLOG_DEFERRED_PRIORITY,
+                       CONFIG_SYSLOG_DEFERRED_STACKSIZE,
+                       (main_t)syslog_dthread, (FAR char * const *)NULL);
+  if (pid < 0)
+    {
+      nxsem_destroy(&g_syslog_dsem);
+      return (int)pid;
+    }
+
+  g_syslog_dpid = pid;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: syslog_deferred_ready
+ *
+ * Description:
+ *   Return true if SYSLOG output may be deferred.
+ *
+ ****************************************************************************/
+
+bool syslog_deferred_ready(void)
+{
+  return g_syslog_dpid > 0;
+}
+
+/****************************************************************************
+ * Name: syslog_deferred_write
+ *
+ * Description:
+ *   Add one pre-formatted message to the deferred SYSLOG buffer of the
+ *   current CPU.  This function never blocks and may be called from any
+ *   context, including interrupt handlers.
+ *
+ * Input Parameters:
+ *   buffer - The formatted message
+ *   buflen - The length of the message in bytes
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  -ENOSPC is returned if the message
+ *   was discarded because the buffer is full.
+ *
+ ****************************************************************************/
+
+int syslog_deferred_write(FAR const char *buffer, size_t buflen)
+{
+  uint8_t record[1 + CONFIG_SYSLOG_DEFERRED_MSGSIZE];
+
+  if (buflen > CONFIG_SYSLOG_DEFERRED_MSGSIZE)
+    {
+      buflen = CONFIG_SYSLOG_DEFERRED_MSGSIZE;
+    }
+
+  record[0] = SYSLOG_DREC_TEXT;
+  memcpy(&record[1], buffer, buflen);
+  return syslog_dbuffer_put(record, buflen + 1);
+}
+
+/****************************************************************************
+ * Name: syslog_deferred_format
+ *
+ * Description:
+ *   Add the format string pointer, the time stamp and the packed arguments
+ *   of one message to the deferred SYSLOG buffer of the current CPU.  The
+ *   message will be formatted by the draining thread.  This function never
+ *   blocks and may be called from any context, including interrupt
+ *   handlers.
+ *
+ * Input Parameters:
+ *   ts  - The time stamp of the message (may be NULL)
+ *   fmt - The format string.  This must remain valid until the message is
+ *         drained.
+ *   ap  - The variable argument list
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  -ENOSPC is returned if the message
+ *   was discarded because the buffer is full.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSLOG_DEFERRED_FORMAT
+int syslog_deferred_format(FAR const struct timespec *ts,
+                           FAR const IPTR char *fmt, FAR va_list *ap)
+{
+  uint8_t record[SYSLOG_DREC_MAXSIZE];
+  size_t offset = 0;
+
+  record[offset++] = SYSLOG_DREC_FORMAT;
+  memcpy(&record[offset], &fmt, sizeof(fmt));
+  offset += sizeof(fmt);
+
+#ifdef CONFIG_SYSLOG_TIMESTAMP
+  {
+    uint32_t sec  = 0;
+    uint32_t usec = 0;
+
+    if (ts != NULL)
+      {
+        sec  = (uint32_t)ts->tv_sec;
+        usec = (uint32_t)(ts->tv_nsec / 1000);
+      }
+
+    memcpy(&record[offset], &sec, sizeof(uint32_t));
+    offset += sizeof(uint32_t);
+    memcpy(&record[offset], &usec, sizeof(uint32_t));
+    offset += sizeof(uint32_t);
+  }
+#endif
+
+  offset += syslog_packargs(fmt, ap, &record[offset],
+                            SYSLOG_DREC_MAXSIZE - offset);
+  return syslog_dbuffer_put(record, offset);
+}
+#endif
+
+/****************************************************************************
+ * Name: syslog_deferred_flush
+ *
+ * Description:
+ *   Output all deferred SYSLOG messages immediately using the sc_force()
+ *   method of the channel.  This is called from syslog_flush() by the
+ *   system crash-handling logic with interrupts disabled.
+ *
+ * Input Parameters:
+ *   channel - The SYSLOG channel to use in performing the flush operation.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void syslog_deferred_flush(FAR const struct syslog_channel_s *channel)
+{
+  struct syslog_dstream_s stream;
+
+  if (g_syslog_dpid > 0 && channel->sc_force != NULL)
+    {
+      syslog_dstream_init(&stream, channel, true);
+      (void)syslog_ddrain(&stream);
+    }
+}
+
+#endif /* CONFIG_SYSLOG_DEFERRED */
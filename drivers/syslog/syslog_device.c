@@ -95,7 +95,7 @@ enum syslog_dev_state
 struct syslog_dev_s
 {
   uint8_t      sl_state;    /* See enum syslog_dev_state */
-  uint8_t      sl_oflags;   /* Saved open mode (for re-open) */
+  uint16_t     sl_oflags;   /* Saved open mode (for re-open) */
   uint16_t     sl_mode;     /* Saved open flags (for re-open) */
   sem_t        sl_sem;      /* Enforces mutually exclusive access */
   pid_t        sl_holder;   /* PID of the thread that holds the semaphore */
@@ -488,6 +488,15 @@ ssize_t syslog_dev_write(FAR const char *buffer, size_t buflen)
       return ret;
     }
 
+  /* Data written in binary mode is not modified */
+
+  if ((g_syslog_dev.sl_oflags & O_BINARY) != 0)
+    {
+      nwritten = file_write(&g_syslog_dev.sl_file, buffer, buflen);
+      syslog_dev_givesem();
+      return nwritten;
+    }
+
   /* Loop until we have output all characters */
 
   for (endptr = buffer, remaining = buflen;
@@ -53,7 +53,13 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define OPEN_FLAGS (O_WRONLY | O_CREAT | O_APPEND)
+/* Binary SYSLOG records must be written without CR-LF expansion */
+
+#ifdef CONFIG_SYSLOG_BINARY
+#  define OPEN_FLAGS (O_WRONLY | O_CREAT | O_APPEND | O_BINARY)
+#else
+#  define OPEN_FLAGS (O_WRONLY | O_CREAT | O_APPEND)
+#endif
 #define OPEN_MODE  (S_IROTH | S_IRGRP | S_IRUSR | S_IWUSR)
 
 /****************************************************************************
@@ -89,6 +89,12 @@ int syslog_flush(void)
   (void)syslog_flush_intbuffer(g_syslog_channel, true);
 #endif
 
+#ifdef CONFIG_SYSLOG_DEFERRED
+  /* Output any messages waiting in the deferred SYSLOG buffers */
+
+  syslog_deferred_flush(g_syslog_channel);
+#endif
+
   /* Then flush all of the buffered output to the SYSLOG device */
 
   DEBUGASSERT(g_syslog_channel->sc_flush != NULL);
@@ -116,6 +116,15 @@ int syslog_initialize(enum syslog_init_e phase)
     }
 #endif
 
+#ifdef CONFIG_SYSLOG_DEFERRED
+  if (phase == SYSLOG_INIT_LATE && ret >= 0)
+    {
+      /* Start the thread that drains the deferred SYSLOG buffers */
+
+      ret = syslog_deferred_initialize();
+    }
+#endif
+
   return ret;
 }
 
@@ -0,0 +1,616 @@
+/****************************************************************************
+ * drivers/syslog/syslog_packargs.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <nuttx/streams.h>
+
+#include "syslog.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The maximum length of one conversion specification, including the
+ * expansion of any '*' width or precision.
+ */
+
+#define SYSLOG_SPEC_MAX 24
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Describes one conversion specification in a format string */
+
+struct syslog_fmtspec_s
+{
+  FAR const char *start;  /* Points to the '%' character */
+  FAR const char *end;    /* Points one past the conversion character */
+  uint8_t nstars;         /* Number of '*' width/precision arguments */
+  uint8_t type;           /* Argument type.  See enum syslog_argtype_e */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: syslog_inttype
+ *
+ * Description:
+ *   Select the packed integer type that matches an integer of 'size' bytes.
+ *
+ ****************************************************************************/
+
+static uint8_t syslog_inttype(size_t size)
+{
+#ifdef CONFIG_HAVE_LONG_LONG
+  if (size > sizeof(long))
+    {
+      return SYSLOG_ARG_LLONG;
+    }
+#endif
+
+  if (size > sizeof(int))
+    {
+      return SYSLOG_ARG_LONG;
+    }
+
+  return SYSLOG_ARG_INT;
+}
+
+/****************************************************************************
+ * Name: syslog_nextspec
+ *
+ * Description:
+ *   Find the next conversion specification in the format string 'fmt'.
+ *
+ * Returned Value:
+ *   true if a conversion specification was found and described in 'spec';
+ *   false if the end of the format string was reached.
+ *
+ ****************************************************************************/
+
+static bool syslog_nextspec(FAR const char *fmt,
+                            FAR struct syslog_fmtspec_s *spec)
+{
+  size_t size = sizeof(int);
+  bool islong = false;
+
+  /* Skip over literal text */
+
+  while (*fmt != '%')
+    {
+      if (*fmt == '\0')
+        {
+          return false;
+        }
+
+      fmt++;
+    }
+
+  spec->start  = fmt++;
+  spec->nstars = 0;
+
+  /* Flags, field width and precision */
+
+  while (*fmt != '\0' && strchr("-+ #0123456789.*", *fmt) != NULL)
+    {
+      if (*fmt == '*')
+        {
+          spec->nstars++;
+        }
+
+      fmt++;
+    }
+
+  /* Length modifiers */
+
+  for (; ; fmt++)
+    {
+      switch (*fmt)
+        {
+          case 'h':
+            continue;
+
+          case 'l':
+            size   = islong ? sizeof(long long) : sizeof(long);
+            islong = true;
+            continue;
+
+          case 'q':
+          case 'L':
+            size   = sizeof(long long);
+            continue;
+
+          case 'z':
+            size   = sizeof(size_t);
+            continue;
+
+          case 'j':
+            size   = sizeof(intmax_t);
+            continue;
+
+          case 't':
+            size   = sizeof(ptrdiff_t);
+            continue;
+
+          default:
+            break;
+        }
+
+      break;
+    }
+
+  /* The conversion character */
+
+  switch (*fmt)
+    {
+      case 'd':
+      case 'i':
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+      case 'c':
+        spec->type = syslog_inttype(size);
+        break;
+
+      case 'p':
+        spec->type = SYSLOG_ARG_PTR;
+        break;
+
+      case 'n':
+        spec->type = SYSLOG_ARG_SKIP;
+        break;
+
+      case 's':
+        spec->type = SYSLOG_ARG_STRING;
+        break;
+
+      case 'e':
+      case 'E':
+      case 'f':
+      case 'F':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        spec->type = SYSLOG_ARG_DOUBLE;
+        break;
+
+      case '\0':
+
+        /* Truncated specification.  Stop before the NUL terminator. */
+
+        spec->type = SYSLOG_ARG_NONE;
+        spec->end  = fmt;
+        return true;
+
+      default:
+
+        /* "%%" or an unsupported conversion */
+
+        spec->type = SYSLOG_ARG_NONE;
+        break;
+    }
+
+  spec->end = fmt + 1;
+  return true;
+}
+
+/****************************************************************************
+ * Name: syslog_put
+ *
+ * Description:
+ *   Append 'size' bytes to the packed argument buffer if there is space.
+ *
+ ****************************************************************************/
+
+static bool syslog_put(FAR uint8_t *buffer, size_t buflen,
+                       FAR size_t *offset, FAR const void *src, size_t size)
+{
+  if (*offset + size > buflen)
+    {
+      return false;
+    }
+
+  memcpy(&buffer[*offset], src, size);
+  *offset += size;
+  return true;
+}
+
+/****************************************************************************
+ * Name: syslog_get
+ *
+ * Description:
+ *   Remove 'size' bytes from the packed argument buffer if available.
+ *
+ ****************************************************************************/
+
+static bool syslog_get(FAR const uint8_t *args, size_t arglen,
+                       FAR size_t *offset, FAR void *dest, size_t size)
+{
+  if (*offset + size > arglen)
+    {
+      return false;
+    }
+
+  memcpy(dest, &args[*offset], size);
+  *offset += size;
+  return true;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: syslog_packargs
+ *
+ * Description:
+ *   Walk the format string 'fmt' and copy each of the arguments referenced
+ *   by 'ap' into 'buffer' in their raw, binary form.  Integer, pointer and
+ *   floating point values are stored with their native size and byte order
+ *   and without any alignment padding.  String arguments are copied into
+ *   the buffer as NUL-terminated strings.  Each '*' field width or
+ *   precision is stored as an int that precedes the value that it applies
+ *   to.
+ *
+ *   If the buffer is too small, the packed argument list is truncated and
+ *   syslog_unpackargs() will stop formatting at that point.  A truncated
+ *   string argument is still NUL-terminated.
+ *
+ * Input Parameters:
+ *   fmt    - The printf-style format string
+ *   ap     - The variable argument list
+ *   buffer - The buffer that will receive the packed arguments
+ *   buflen - The size of the buffer in bytes
+ *
+ * Returned Value:
+ *   The number of bytes used in 'buffer'.
+ *
+ ****************************************************************************/
+
+size_t syslog_packargs(FAR const IPTR char *fmt, FAR va_list *ap,
+                       FAR uint8_t *buffer, size_t buflen)
+{
+  struct syslog_fmtspec_s spec;
+  size_t offset = 0;
+  bool ok = true;
+
+  while (ok && syslog_nextspec(fmt, &spec))
+    {
+      int i;
+
+      for (i = 0; ok && i < spec.nstars; i++)
+        {
+          int width = va_arg(*ap, int);
+          ok = syslog_put(buffer, buflen, &offset, &width, sizeof(int));
+        }
+
+      switch (spec.type)
+        {
+          case SYSLOG_ARG_INT:
+            {
+              int value = va_arg(*ap, int);
+              ok = ok && syslog_put(buffer, buflen, &offset, &value,
+                                    sizeof(int));
+            }
+            break;
+
+          case SYSLOG_ARG_LONG:
+            {
+              long value = va_arg(*ap, long);
+              ok = ok && syslog_put(buffer, buflen, &offset, &value,
+                                    sizeof(long));
+            }
+            break;
+
+#ifdef CONFIG_HAVE_LONG_LONG
+          case SYSLOG_ARG_LLONG:
+            {
+              long long value = va_arg(*ap, long long);
+              ok = ok && syslog_put(buffer, buflen, &offset, &value,
+                                    sizeof(long long));
+            }
+            break;
+#endif
+
+          case SYSLOG_ARG_PTR:
+            {
+              FAR void *value = va_arg(*ap, FAR void *);
+              ok = ok && syslog_put(buffer, buflen, &offset, &value,
+                                    sizeof(FAR void *));
+            }
+            break;
+
+          case SYSLOG_ARG_DOUBLE:
+            {
+              double value = va_arg(*ap, double);
+              ok = ok && syslog_put(buffer, buflen, &offset, &value,
+                                    sizeof(double));
+            }
+            break;
+
+          case SYSLOG_ARG_STRING:
+            {
+              FAR const char *str = va_arg(*ap, FAR const char *);
+              size_t len;
+
+              if (str == NULL)
+                {
+                  str = "(null)";
+                }
+
+              if (!ok || offset >= buflen)
+                {
+                  ok = false;
+                  break;
+                }
+
+              /* Copy as much of the string as will fit, always leaving
+               * space for the NUL terminator.
+               */
+
+              len = strlen(str);
+              if (len >= buflen - offset)
+                {
+                  len = buflen - offset - 1;
+                  ok  = false;
+                }
+
+              memcpy(&buffer[offset], str, len);
+              buffer[offset + len] = '\0';
+              offset += len + 1;
+            }
+            break;
+
+          case SYSLOG_ARG_SKIP:
+            (void)va_arg(*ap, FAR void *);
+            break;
+
+          default:
+            break;
+        }
+
+      fmt = spec.end;
+    }
+
+  return offset;
+}
+
+/****************************************************************************
+ * Name: syslog_unpackargs
+ *
+ * Description:
+ *   Format the message described by the format string 'fmt' and the
+ *   argument list previously packed by syslog_packargs() to 'stream'.
+ *   Formatting stops at the first argument that was not packed.
+ *
+ * Input Parameters:
+ *   stream - The stream that will receive the formatted output
+ *   fmt    - The printf-style format string
+ *   args   - The packed argument list
+ *   arglen - The size of the packed argument list in bytes
+ *
+ * Returned Value:
+ *   The number of characters generated.
+ *
+ ****************************************************************************/
+
+int syslog_unpackargs(FAR struct lib_outstream_s *stream,
+                      FAR const IPTR char *fmt, FAR const uint8_t *args,
+                      size_t arglen)
+{
+  struct syslog_fmtspec_s spec;
+  char specbuf[SYSLOG_SPEC_MAX];
+  size_t offset = 0;
+  int nput = stream->nput;
+
+  while (syslog_nextspec(fmt, &spec))
+    {
+      FAR const char *src;
+      size_t len;
+      bool ok = true;
+
+      /* Output the literal text that precedes the specification */
+
+      while (fmt < spec.start)
+        {
+          stream->put(stream, *fmt++);
+        }
+
+      /* Copy the specification, expanding any '*' field widths */
+
+      for (src = spec.start, len = 0;
+           src < spec.end && len < SYSLOG_SPEC_MAX - 12;
+           src++)
+        {
+          if (*src == '*')
+            {
+              int width;
+
+              ok = ok && syslog_get(args, arglen, &offset, &width,
+                                    sizeof(int));
+              if (ok)
+                {
+                  len += snprintf(&specbuf[len], SYSLOG_SPEC_MAX - len,
+                                  "%d", width);
+                }
+            }
+          else
+            {
+              specbuf[len++] = *src;
+            }
+        }
+
+      specbuf[len] = '\0';
+
+      switch (spec.type)
+        {
+          case SYSLOG_ARG_INT:
+            {
+              int value;
+
+              ok = ok && syslog_get(args, arglen, &offset, &value,
+                                    sizeof(int));
+              if (ok)
+                {
+                  lib_sprintf(stream, specbuf, value);
+                }
+            }
+            break;
+
+          case SYSLOG_ARG_LONG:
+            {
+              long value;
+
+              ok = ok && syslog_get(args, arglen, &offset, &value,
+                                    sizeof(long));
+              if (ok)
+                {
+                  lib_sprintf(stream, specbuf, value);
+                }
+            }
+            break;
+
+#ifdef CONFIG_HAVE_LONG_LONG
+          case SYSLOG_ARG_LLONG:
+            {
+              long long value;
+
+              ok = ok && syslog_get(args, arglen, &offset, &value,
+                                    sizeof(long long));
+              if (ok)
+                {
+                  lib_sprintf(stream, specbuf, value);
+                }
+            }
+            break;
+#endif
+
+          case SYSLOG_ARG_PTR:
+            {
+              FAR void *value;
+
+              ok = ok && syslog_get(args, arglen, &offset, &value,
+                                    sizeof(FAR void *));
+              if (ok)
+                {
+                  lib_sprintf(stream, specbuf, value);
+                }
+            }
+            break;
+
+          case SYSLOG_ARG_DOUBLE:
+            {
+              double value;
+
+              ok = ok && syslog_get(args, arglen, &offset, &value,
+                                    sizeof(double));
+              if (ok)
+                {
+                  lib_sprintf(stream, specbuf, value);
+                }
+            }
+            break;
+
+          case SYSLOG_ARG_STRING:
+            if (ok && offset < arglen)
+              {
+                FAR const char *str = (FAR const char *)&args[offset];
+
+                len = strnlen(str, arglen - offset);
+                offset += len + 1;
+                lib_sprintf(stream, specbuf, str);
+              }
+            else
+              {
+                ok = false;
+              }
+            break;
+
+          case SYSLOG_ARG_SKIP:
+            break;
+
+          default:
+
+            /* Let lib_sprintf() deal with "%%" */
+
+            lib_sprintf(stream, specbuf);
+            break;
+        }
+
+      if (!ok)
+        {
+          /* The packed argument list was truncated.  Keep the line
+           * termination so that the next message starts on a new line.
+           */
+
+          len = strlen(fmt);
+          if (len > 0 && fmt[len - 1] == '\n')
+            {
+              stream->put(stream, '\n');
+            }
+
+          return stream->nput - nput;
+        }
+
+      fmt = spec.end;
+    }
+
+  /* Output any trailing literal text */
+
+  while (*fmt != '\0')
+    {
+      stream->put(stream, *fmt++);
+    }
+
+  return stream->nput - nput;
+}
@@ -113,10 +113,10 @@ static ssize_t syslog_default_write(FAR const char *buffer, size_t buflen)
  ****************************************************************************/
 
 /****************************************************************************
- * Name: syslog_write
+ * Name: syslog_direct_write
  *
  * Description:
- *   This is the low-level, multiple character, system logging interface.
+ *   Write to the SYSLOG channel, bypassing the deferred SYSLOG buffer.
  *
  * Input Parameters:
  *   buffer - The buffer containing the data to be output
@@ -128,7 +128,7 @@ static ssize_t syslog_default_write(FAR const char *buffer, size_t buflen)
  *
  ****************************************************************************/
 
-ssize_t syslog_write(FAR const char *buffer, size_t buflen)
+ssize_t syslog_direct_write(FAR const char *buffer, size_t buflen)
 {
 #ifdef CONFIG_SYSLOG_INTBUFFER
   if (!up_interrupt_context() && !sched_idletask())
@@ -142,3 +142,57 @@ ssize_t syslog_write(FAR const char *buffer, size_t buflen)
 #endif
   return syslog_default_write(buffer, buflen);
 }
+
+/****************************************************************************
+ * Name: syslog_write
+ *
+ * Description:
+ *   This is the low-level, multiple character, system logging interface.
+ *   Once the SYSLOG draining thread is running, the data is added to the
+ *   deferred SYSLOG buffer instead of being written to the channel.
+ *
+ * Input Parameters:
+ *   buffer - The buffer containing the data to be output
+ *   buflen - The number of bytes in the buffer
+ *
+ * Returned Value:
+ *   On success, the number of characters written is returned.  A negated
+ *   errno value is returned on any failure.
+ *
+ ****************************************************************************/
+
+ssize_t syslog_write(FAR const char *buffer, size_t buflen)
+{
+#ifdef CONFIG_SYSLOG_DEFERRED
+  if (syslog_deferred_ready())
+    {
+      size_t remaining = buflen;
+      int ret;
+
+      /* Add the data in pieces no larger than one deferred message */
+
+      while (remaining > 0)
+        {
+          size_t chunk = remaining;
+
+          if (chunk > CONFIG_SYSLOG_DEFERRED_MSGSIZE)
+            {
+              chunk = CONFIG_SYSLOG_DEFERRED_MSGSIZE;
+            }
+
+          ret = syslog_deferred_write(buffer, chunk);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          buffer    += chunk;
+          remaining -= chunk;
+        }
+
+      return buflen;
+    }
+#endif
+
+  return syslog_direct_write(buffer, buflen);
+}
@@ -49,6 +49,8 @@
 #include <nuttx/streams.h>
 #include <nuttx/syslog/syslog.h>
 
+#include "syslog.h"
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -69,6 +71,11 @@
 int nx_vsyslog(int priority, FAR const IPTR char *fmt, FAR va_list *ap)
 {
   struct lib_syslogstream_s stream;
+#if defined(CONFIG_SYSLOG_DEFERRED) && !defined(CONFIG_SYSLOG_DEFERRED_FORMAT)
+  struct lib_memoutstream_s dstream;
+  char dbuffer[CONFIG_SYSLOG_DEFERRED_MSGSIZE + 1];
+#endif
+  FAR struct lib_outstream_s *out;
   int ret;
 
 #ifdef CONFIG_SYSLOG_TIMESTAMP
@@ -110,17 +117,53 @@ int nx_vsyslog(int priority, FAR const IPTR char *fmt, FAR va_list *ap)
     }
 #endif
 
+#ifdef CONFIG_SYSLOG_BINARY
+  /* Output a binary record instead of formatted text.  Emergency output is
+   * always formatted so that it is readable without the host decoder.
+   */
+
+  if (priority != LOG_EMERG)
+    {
+      return syslog_binary(priority, &ts, fmt, ap);
+    }
+#endif
+
   /* Wrap the low-level output in a stream object and let lib_vsprintf
    * do the work.  NOTE that emergency priority output is handled
    * differently.. it will use the SYSLOG emergency stream.
    */
 
+  out = &stream.public;
   if (priority == LOG_EMERG)
     {
       /* Use the SYSLOG emergency stream */
 
       emergstream(&stream.public);
     }
+#ifdef CONFIG_SYSLOG_DEFERRED
+  else if (syslog_deferred_ready())
+    {
+#ifdef CONFIG_SYSLOG_DEFERRED_FORMAT
+      /* Save only the format string and the raw arguments.  Formatting is
+       * performed later by the SYSLOG draining thread.
+       */
+
+#ifdef CONFIG_SYSLOG_TIMESTAMP
+      ret = syslog_deferred_format(&ts, fmt, ap);
+#else
+      ret = syslog_deferred_format(NULL, fmt, ap);
+#endif
+      return ret < 0 ? ret : 0;
+#else
+      /* Format into a buffer on the stack.  The buffer will be added to
+       * the deferred SYSLOG buffer when the message is complete.
+       */
+
+      lib_memoutstream(&dstream, dbuffer, sizeof(dbuffer));
+      out = &dstream.public;
+#endif
+    }
+#endif
   else
     {
       /* Use the normal SYSLOG stream */
@@ -131,7 +174,7 @@ int nx_vsyslog(int priority, FAR const IPTR char *fmt, FAR va_list *ap)
 #if defined(CONFIG_SYSLOG_TIMESTAMP)
   /* Pre-pend the message with the current time, if available */
 
-  ret = lib_sprintf(&stream.public, "[%5d.%06d] ",
+  ret = lib_sprintf(out, "[%5d.%06d] ",
                     ts.tv_sec, ts.tv_nsec/1000);
 #else
   ret = 0;
@@ -140,12 +183,24 @@ int nx_vsyslog(int priority, FAR const IPTR char *fmt, FAR va_list *ap)
 #if defined(CONFIG_SYSLOG_PREFIX)
   /* Pre-pend the prefix, if available */
 
-  ret += lib_sprintf(&stream.public, "%s", CONFIG_SYSLOG_PREFIX_STRING);
+  ret += lib_sprintf(out, "%s", CONFIG_SYSLOG_PREFIX_STRING);
 #endif
 
   /* Generate the output */
 
-  ret += lib_vsprintf(&stream.public, fmt, *ap);
+  ret += lib_vsprintf(out, fmt, *ap);
+
+#if defined(CONFIG_SYSLOG_DEFERRED) && !defined(CONFIG_SYSLOG_DEFERRED_FORMAT)
+  if (out == &dstream.public)
+    {
+      /* Queue the formatted message for the SYSLOG draining thread.  This
+       * never blocks; if there is no space, the message is discarded.
+       */
+
+      (void)syslog_deferred_write(dbuffer, dstream.public.nput);
+      return ret;
+    }
+#endif
 
 #ifdef CONFIG_SYSLOG_BUFFER
   /* Flush and destroy the syslog stream buffer */
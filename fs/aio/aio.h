@@ -43,11 +43,11 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <stdbool.h>
 #include <string.h>
 #include <aio.h>
 #include <queue.h>
 
-#include <nuttx/wqueue.h>
 #include <nuttx/net/net.h>
 
 #ifdef CONFIG_FS_AIO
@@ -63,6 +63,28 @@
 #  define CONFIG_FS_NAIOC 8
 #endif
 
+/* AIO worker threads */
+
+#ifndef CONFIG_FS_AIO_NWORKERS
+#  define CONFIG_FS_AIO_NWORKERS 2
+#endif
+
+#ifndef CONFIG_FS_AIO_PRIORITY
+#  define CONFIG_FS_AIO_PRIORITY 50
+#endif
+
+#ifndef CONFIG_FS_AIO_STACKSIZE
+#  define CONFIG_FS_AIO_STACKSIZE 2048
+#endif
+
+/* Size of the per-worker buffer used to merge contiguous requests.  Zero
+ * disables merging.
+ */
+
+#ifndef CONFIG_FS_AIO_COALESCE
+#  define CONFIG_FS_AIO_COALESCE 0
+#endif
+
 #undef AIO_HAVE_FILEP
 #undef AIO_HAVE_PSOCK
 
@@ -81,6 +103,12 @@
 /****************************************************************************
  * Public Types
  ****************************************************************************/
+/* This is the form of the function that performs a request on an AIO
+ * worker thread.  The argument is the container of the request.
+ */
+
+typedef CODE void (*aio_worker_t)(FAR void *arg);
+
 /* This structure contains one AIO control block and appends information
  * needed by the logic running on the worker thread.  These structures are
  * pre-allocated, the number pre-allocated controlled by CONFIG_FS_NAIOC.
@@ -101,8 +129,11 @@ struct aio_container_s
 #endif
     FAR void *ptr;                 /* Generic pointer to FAR data */
   } u;
-  struct work_s aioc_work;         /* Used to defer I/O to the work thread */
+  aio_worker_t aioc_worker;        /* Performs the I/O (NULL until queued) */
+  FAR struct aio_ring_s *aioc_ring; /* Completion ring or NULL to signal */
   pid_t aioc_pid;                  /* ID of the waiting task */
+  uint8_t aioc_opcode;             /* LIO_READ, LIO_WRITE or LIO_NOP (fsync) */
+  bool aioc_started;               /* Taken by a worker or canceled */
 #ifdef CONFIG_PRIORITY_INHERITANCE
   uint8_t aioc_prio;               /* Priority of the waiting task */
 #endif
@@ -244,28 +275,68 @@ FAR struct aiocb *aioc_decant(FAR struct aio_container_s *aioc);
  * Name: aio_queue
  *
  * Description:
- *   Schedule the asynchronous I/O on the low priority work queue
+ *   Schedule the asynchronous I/O on the AIO worker threads.  The worker
+ *   threads are started when the first request is queued.
  *
  * Input Parameters:
- *   arg - Worker argument.  In this case, a pointer to an instance of
- *     struct aiocb cast to void *.
+ *   aioc   - The container of the request
+ *   worker - The function that performs the request on the worker thread
  *
  * Returned Value:
  *   Zero (OK) on success.  Otherwise, -1 is returned and the errno is set
- *   appropriately.
+ *   appropriately.  The container is freed on failure.
  *
  ****************************************************************************/
 
-int aio_queue(FAR struct aio_container_s *aioc, worker_t worker);
+int aio_queue(FAR struct aio_container_s *aioc, aio_worker_t worker);
+
+/****************************************************************************
+ * Name: aio_dequeue
+ *
+ * Description:
+ *   Remove a request from the queue if it has not yet been started.  The
+ *   container is not freed.
+ *
+ * Input Parameters:
+ *   aioc - The container of the request
+ *
+ * Returned Value:
+ *   Zero (OK) if the request was removed; -EBUSY if it has already been
+ *   started.
+ *
+ ****************************************************************************/
+
+int aio_dequeue(FAR struct aio_container_s *aioc);
+
+/****************************************************************************
+ * Name: aio_read_worker, aio_write_worker
+ *
+ * Description:
+ *   These functions execute on an AIO worker thread and perform a read or
+ *   a write request.
+ *
+ * Input Parameters:
+ *   arg - Worker argument.  In this case, a pointer to the container of
+ *     the request cast to void *.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void aio_read_worker(FAR void *arg);
+void aio_write_worker(FAR void *arg);
 
 /****************************************************************************
  * Name: aio_signal
  *
  * Description:
- *   Signal the client that an I/O has completed.
+ *   Signal the client that an I/O has completed.  Requests submitted
+ *   through a completion ring are posted to the ring instead.
  *
  * Input Parameters:
  *   pid    - ID of the task to signal
+ *   ring   - The completion ring of the request or NULL
  *   aiocbp - Pointer to the asynchronous I/O state structure that includes
  *            information about how to signal the client
  *
@@ -275,7 +346,31 @@ int aio_queue(FAR struct aio_container_s *aioc, worker_t worker);
  *
  ****************************************************************************/
 
-int aio_signal(pid_t pid, FAR struct aiocb *aiocbp);
+int aio_signal(pid_t pid, FAR struct aio_ring_s *ring,
+               FAR struct aiocb *aiocbp);
+
+/****************************************************************************
+ * Name: aio_ring_complete
+ *
+ * Description:
+ *   Post the completion of a request to its completion ring and wake up
+ *   the thread waiting in aio_ring_enter(), if any.
+ *
+ * Input Parameters:
+ *   ring   - The completion ring of the request
+ *   aiocbp - The completed AIO control block
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_AIO_RING
+void aio_ring_complete(FAR struct aio_ring_s *ring,
+                       FAR struct aiocb *aiocbp);
+#else
+#  define aio_ring_complete(ring,aiocbp)
+#endif
 
 #undef EXTERN
 #if defined(__cplusplus)
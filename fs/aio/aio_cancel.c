@@ -44,12 +44,38 @@
 #include <assert.h>
 #include <errno.h>
 
-#include <nuttx/wqueue.h>
-
 #include "aio/aio.h"
 
 #ifdef CONFIG_FS_AIO
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aio_cancel_complete
+ *
+ * Description:
+ *   Free the container of a canceled request.  A request submitted through
+ *   a completion ring still has its (canceled) completion posted so that
+ *   the ring's count of requests in flight stays correct.
+ *
+ ****************************************************************************/
+
+static void aio_cancel_complete(FAR struct aio_container_s *aioc)
+{
+  FAR struct aio_ring_s *ring = aioc->aioc_ring;
+  FAR struct aiocb *aiocbp;
+
+  aiocbp = aioc_decant(aioc);
+  DEBUGASSERT(aiocbp);
+
+  if (ring != NULL)
+    {
+      aio_ring_complete(ring, aiocbp);
+    }
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -130,27 +156,28 @@ int aio_cancel(int fildes, FAR struct aiocb *aiocbp)
           if (aioc)
             {
               /* Yes... attempt to cancel the I/O.  There are two
-               * possibilities:* (1) the work has already been started and
-               * is no longer queued, or (2) the work has not been started
-               * and is still in the work queue.  Only the second case can
-               * be canceled.  work_cancel() will return -ENOENT in the
-               * first case.
+               * possibilities:* (1) a worker has already started the I/O,
+               * or (2) the I/O has not been started and is still queued.
+               * Only the second case can be canceled.  aio_dequeue() will
+               * return -EBUSY in the first case.
                */
 
-              status = work_cancel(LPWORK, &aioc->aioc_work);
+              status = aio_dequeue(aioc);
               if (status >= 0)
                 {
                   aiocbp->aio_result = -ECANCELED;
                   ret = AIO_CANCELED;
+
+                  /* Remove the container from the list of pending
+                   * transfers.
+                   */
+
+                  aio_cancel_complete(aioc);
                 }
               else
                 {
                   ret = AIO_NOTCANCELED;
                 }
-
-              /* Remove the container from the list of pending transfers */
-
-              (void)aioc_decant(aioc);
             }
         }
     }
@@ -174,24 +201,25 @@ int aio_cancel(int fildes, FAR struct aiocb *aiocbp)
           if (aioc)
             {
               /* Yes... attempt to cancel the I/O.  There are two
-               * possibilities:* (1) the work has already been started and
-               * is no longer queued, or (2) the work has not been started
-               * and is still in the work queue.  Only the second case can
-               * be canceled.  work_cancel() will return -ENOENT in the
-               * first case.
+               * possibilities:* (1) a worker has already started the I/O,
+               * or (2) the I/O has not been started and is still queued.
+               * Only the second case can be canceled.  aio_dequeue() will
+               * return -EBUSY in the first case.  The worker frees the
+               * container of a started I/O.
                */
 
-              status = work_cancel(LPWORK, &aioc->aioc_work);
-
-              /* Remove the container from the list of pending transfers */
-
+              status = aio_dequeue(aioc);
               next   = (FAR struct aio_container_s *)aioc->aioc_link.flink;
-              aiocbp = aioc_decant(aioc);
-              DEBUGASSERT(aiocbp);
 
               if (status >= 0)
                 {
-                  aiocbp->aio_result = -ECANCELED;
+                  aioc->aioc_aiocbp->aio_result = -ECANCELED;
+
+                  /* Remove the container from the list of pending
+                   * transfers.
+                   */
+
+                  aio_cancel_complete(aioc);
                   if (ret != AIO_NOTCANCELED)
                     {
                       ret = AIO_CANCELED;
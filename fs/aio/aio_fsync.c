@@ -76,10 +76,8 @@ static void aio_fsync_worker(FAR void *arg)
 {
   FAR struct aio_container_s *aioc = (FAR struct aio_container_s *)arg;
   FAR struct aiocb *aiocbp;
+  FAR struct aio_ring_s *ring;
   pid_t pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  uint8_t prio;
-#endif
   int ret;
 
   /* Get the information from the container, decant the AIO control block,
@@ -89,9 +87,7 @@ static void aio_fsync_worker(FAR void *arg)
 
   DEBUGASSERT(aioc && aioc->aioc_aiocbp);
   pid    = aioc->aioc_pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  prio   = aioc->aioc_prio;
-#endif
+  ring   = aioc->aioc_ring;
   aiocbp = aioc_decant(aioc);
 
   /* Perform the fsync using u.aioc_filep */
@@ -109,13 +105,7 @@ static void aio_fsync_worker(FAR void *arg)
 
   /* Signal the client */
 
-  (void)aio_signal(pid, aiocbp);
-
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  /* Restore the low priority worker thread default priority */
-
-  lpwork_restorepriority(prio);
-#endif
+  (void)aio_signal(pid, ring, aiocbp);
 }
 
 /****************************************************************************
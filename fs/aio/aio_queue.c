@@ -39,71 +39,605 @@
 
 #include <nuttx/config.h>
 
+#include <sys/types.h>
+#include <stdbool.h>
+#include <string.h>
 #include <sched.h>
+#include <fcntl.h>
 #include <aio.h>
+#include <assert.h>
 #include <errno.h>
 #include <debug.h>
 
-#include <nuttx/wqueue.h>
+#include <nuttx/sched.h>
+#include <nuttx/kthread.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/fs/fs.h>
 
 #include "aio/aio.h"
 
 #ifdef CONFIG_FS_AIO
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The maximum number of requests that may be merged into one transfer */
+
+#define AIO_MAXBATCH 8
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The process IDs of the AIO worker threads */
+
+static pid_t g_aio_worker[CONFIG_FS_AIO_NWORKERS];
+
+/* The file or socket that each AIO worker thread is serving, or NULL if the
+ * worker is idle.  A request is never started while another worker is
+ * still serving the same file so that the requests on one file complete in
+ * the order that they were queued.
+ */
+
+static FAR void *g_aio_active[CONFIG_FS_AIO_NWORKERS];
+
+/* This counting semaphore is posted once for each queued request */
+
+static sem_t g_aio_worksem = SEM_INITIALIZER(0);
+
+/* The number of workers that awakened but found only requests for files
+ * that were busy.  The semaphore is posted again for each when a request
+ * completes.
+ */
+
+static uint16_t g_aio_ndeferred;
+
+/* True when the worker threads have been started */
+
+static bool g_aio_started;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
 /****************************************************************************
- * Name: aio_queue
+ * Name: aio_next
  *
  * Description:
- *   Schedule the asynchronous I/O on the low priority work queue
+ *   Select the next request to be performed by a worker.  This is the
+ *   oldest queued request that has not been started and is not for a file
+ *   that another worker is serving.  The caller must hold the AIO lock.
  *
  * Input Parameters:
- *   arg - Worker argument.  In this case, a pointer to an instance of
- *     struct aiocb cast to void *.
+ *   wndx - The index of the worker
  *
  * Returned Value:
- *   Zero (OK) on success.  Otherwise, -1 is returned and the errno is set
- *   appropriately.
+ *   The selected container or NULL if there is nothing that can be started
+ *   now.
+ *
+ ****************************************************************************/
+
+static FAR struct aio_container_s *aio_next(int wndx)
+{
+  FAR struct aio_container_s *aioc;
+  int i;
+
+  for (aioc = (FAR struct aio_container_s *)g_aio_pending.head;
+       aioc != NULL;
+       aioc = (FAR struct aio_container_s *)aioc->aioc_link.flink)
+    {
+      /* Skip over requests that are started or not yet fully queued */
+
+      if (aioc->aioc_started || aioc->aioc_worker == NULL)
+        {
+          continue;
+        }
+
+      /* Is another worker serving this file? */
+
+      for (i = 0; i < CONFIG_FS_AIO_NWORKERS; i++)
+        {
+          if (g_aio_active[i] == aioc->u.ptr)
+            {
+              break;
+            }
+        }
+
+      if (i >= CONFIG_FS_AIO_NWORKERS)
+        {
+          /* No.. this request can be started */
+
+          aioc->aioc_started = true;
+          g_aio_active[wndx] = aioc->u.ptr;
+          return aioc;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: aio_gather
+ *
+ * Description:
+ *   Collect the queued requests that immediately follow the selected
+ *   request on the same file and that continue its transfer contiguously.
+ *   These are performed together as one transfer.  The caller must hold
+ *   the AIO lock.
+ *
+ * Input Parameters:
+ *   batch - The selected request in batch[0].  The gathered requests are
+ *           returned in the following entries.
+ *
+ * Returned Value:
+ *   The number of requests in the batch (at least one).
  *
  ****************************************************************************/
 
-int aio_queue(FAR struct aio_container_s *aioc, worker_t worker)
+#if CONFIG_FS_AIO_COALESCE > 0 && defined(AIO_HAVE_FILEP)
+static int aio_gather(FAR struct aio_container_s **batch)
 {
-  int ret;
+  FAR struct aio_container_s *aioc = batch[0];
+  FAR struct aio_container_s *next;
+  FAR struct aiocb *aiocbp = aioc->aioc_aiocbp;
+  size_t total;
+  off_t end;
+  int nbatch = 1;
+
+  /* Only reads and writes on files at an explicit offset can be merged */
+
+#ifdef AIO_HAVE_PSOCK
+  if (aiocbp->aio_fildes >= CONFIG_NFILE_DESCRIPTORS)
+    {
+      return 1;
+    }
+#endif
+
+  if (aioc->aioc_opcode == LIO_NOP ||
+      (aioc->aioc_opcode == LIO_WRITE &&
+       (aioc->u.aioc_filep->f_oflags & O_APPEND) != 0))
+    {
+      return 1;
+    }
+
+  total = aiocbp->aio_nbytes;
+  end   = aiocbp->aio_offset + aiocbp->aio_nbytes;
+
+  for (next = (FAR struct aio_container_s *)aioc->aioc_link.flink;
+       next != NULL && nbatch < AIO_MAXBATCH;
+       next = (FAR struct aio_container_s *)next->aioc_link.flink)
+    {
+      if (next->u.ptr != aioc->u.ptr)
+        {
+          continue;
+        }
+
+      /* The next request on this file must be the same operation, it must
+       * start where the batch ends, and the batch must still fit into the
+       * bounce buffer.  Otherwise, stop so that the order is kept.
+       */
 
+      aiocbp = next->aioc_aiocbp;
+      if (next->aioc_started || next->aioc_worker == NULL ||
+          next->aioc_opcode != aioc->aioc_opcode ||
+          aiocbp->aio_offset != end ||
+          total + aiocbp->aio_nbytes > CONFIG_FS_AIO_COALESCE)
+        {
+          break;
+        }
+
+      /* Take the request and the semaphore count posted for it */
+
+      next->aioc_started = true;
+      (void)nxsem_trywait(&g_aio_worksem);
+
+      batch[nbatch++] = next;
+      total          += aiocbp->aio_nbytes;
+      end            += aiocbp->aio_nbytes;
+    }
+
+  return nbatch;
+}
+#endif
+
+/****************************************************************************
+ * Name: aio_batch
+ *
+ * Description:
+ *   Perform a batch of contiguous reads or writes as one transfer through
+ *   the worker's bounce buffer and distribute the result to each request.
+ *
+ * Input Parameters:
+ *   batch  - The containers of the requests, in file order
+ *   nbatch - The number of requests in the batch
+ *   buffer - The bounce buffer of the worker
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+#if CONFIG_FS_AIO_COALESCE > 0 && defined(AIO_HAVE_FILEP)
+static void aio_batch(FAR struct aio_container_s **batch, int nbatch,
+                      FAR uint8_t *buffer)
+{
+  FAR struct aiocb *aiocbp[AIO_MAXBATCH];
+  FAR struct aio_ring_s *ring[AIO_MAXBATCH];
+  pid_t pid[AIO_MAXBATCH];
+  FAR struct file *filep = batch[0]->u.aioc_filep;
+  uint8_t opcode = batch[0]->aioc_opcode;
+  size_t total = 0;
+  ssize_t nxfrd;
+  off_t offset;
+  int i;
+
+  /* Get the information from the containers and free them before starting
+   * the I/O.
+   */
+
+  for (i = 0; i < nbatch; i++)
+    {
+      pid[i]    = batch[i]->aioc_pid;
+      ring[i]   = batch[i]->aioc_ring;
+      aiocbp[i] = aioc_decant(batch[i]);
+    }
+
+  offset = aiocbp[0]->aio_offset;
+  if (opcode == LIO_WRITE)
+    {
+      /* Gather the write data into the bounce buffer */
+
+      for (i = 0; i < nbatch; i++)
+        {
+          memcpy(&buffer[total], (FAR const void *)aiocbp[i]->aio_buf,
+                 aiocbp[i]->aio_nbytes);
+          total += aiocbp[i]->aio_nbytes;
+        }
+
+      nxfrd = file_pwrite(filep, buffer, total, offset);
+    }
+  else
+    {
+      for (i = 0; i < nbatch; i++)
+        {
+          total += aiocbp[i]->aio_nbytes;
+        }
+
+      nxfrd = file_pread(filep, buffer, total, offset);
+    }
+
+  if (nxfrd < 0)
+    {
+      ferr("ERROR: Transfer of %d requests failed: %d\n",
+           nbatch, (int)nxfrd);
+    }
+
+  /* Distribute the result.  Each request is credited with the part of the
+   * transfer that falls within its range.
+   */
+
+  for (i = 0, total = 0; i < nbatch; i++)
+    {
+      ssize_t nbytes = 0;
+
+      if (nxfrd < 0)
+        {
+          aiocbp[i]->aio_result = nxfrd;
+        }
+      else
+        {
+          if ((size_t)nxfrd > total)
+            {
+              nbytes = nxfrd - total;
+              if ((size_t)nbytes > aiocbp[i]->aio_nbytes)
+                {
+                  nbytes = aiocbp[i]->aio_nbytes;
+                }
+            }
+
+          if (opcode == LIO_READ && nbytes > 0)
+            {
+              memcpy((FAR void *)aiocbp[i]->aio_buf, &buffer[total], nbytes);
+            }
+
+          aiocbp[i]->aio_result = nbytes;
+        }
+
+      total += aiocbp[i]->aio_nbytes;
+
+      /* Signal the client */
+
+      (void)aio_signal(pid[i], ring[i], aiocbp[i]);
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: aio_thread
+ *
+ * Description:
+ *   The body of an AIO worker thread.  Each worker waits for queued
+ *   requests and performs them.
+ *
+ * Input Parameters:
+ *   argc, argv (not used)
+ *
+ * Returned Value:
+ *   Does not return
+ *
+ ****************************************************************************/
+
+static int aio_thread(int argc, FAR char *argv[])
+{
+  FAR struct aio_container_s *batch[AIO_MAXBATCH];
 #ifdef CONFIG_PRIORITY_INHERITANCE
-  /* Prohibit context switches until we complete the queuing */
+  struct sched_param param;
+#endif
+#if CONFIG_FS_AIO_COALESCE > 0 && defined(AIO_HAVE_FILEP)
+  FAR uint8_t *buffer;
+#endif
+  pid_t me = getpid();
+  int nbatch;
+  int wndx;
+  int i;
 
-  sched_lock();
+  /* Find our index in g_aio_worker */
 
-  /* Make sure that the low-priority worker thread is running at at least
-   * the priority specified for this action.
+  aio_lock();
+  for (wndx = 0; wndx < CONFIG_FS_AIO_NWORKERS; wndx++)
+    {
+      if (g_aio_worker[wndx] == me)
+        {
+          break;
+        }
+    }
+
+  aio_unlock();
+  DEBUGASSERT(wndx < CONFIG_FS_AIO_NWORKERS);
+
+#if CONFIG_FS_AIO_COALESCE > 0 && defined(AIO_HAVE_FILEP)
+  /* Allocate the bounce buffer for merged transfers.  Requests are simply
+   * not merged if this fails.
    */
 
-  lpwork_boostpriority(aioc->aioc_prio);
+  buffer = (FAR uint8_t *)kmm_malloc(CONFIG_FS_AIO_COALESCE);
 #endif
 
-  /* Schedule the work on the low priority worker thread */
+  for (; ; )
+    {
+      /* Wait for a request to be queued */
+
+      (void)nxsem_wait_uninterruptible(&g_aio_worksem);
+
+      aio_lock();
+      batch[0] = aio_next(wndx);
+      if (batch[0] == NULL)
+        {
+          /* All queued requests are for files that other workers are
+           * serving.  Wait until one of them completes.
+           */
+
+          g_aio_ndeferred++;
+          aio_unlock();
+          continue;
+        }
+
+      nbatch = 1;
+#if CONFIG_FS_AIO_COALESCE > 0 && defined(AIO_HAVE_FILEP)
+      if (buffer != NULL)
+        {
+          nbatch = aio_gather(batch);
+        }
+#endif
+
+      aio_unlock();
+
+#ifdef CONFIG_PRIORITY_INHERITANCE
+      /* Run at the priority of the highest priority waiting task */
+
+      param.sched_priority = CONFIG_FS_AIO_PRIORITY;
+      for (i = 0; i < nbatch; i++)
+        {
+          if (batch[i]->aioc_prio > param.sched_priority)
+            {
+              param.sched_priority = batch[i]->aioc_prio;
+            }
+        }
+
+      if (param.sched_priority != CONFIG_FS_AIO_PRIORITY)
+        {
+          (void)nxsched_setparam(0, &param);
+        }
+#endif
+
+      /* Perform the I/O.  The worker functions and aio_batch() free the
+       * containers.
+       */
+
+#if CONFIG_FS_AIO_COALESCE > 0 && defined(AIO_HAVE_FILEP)
+      if (nbatch > 1)
+        {
+          aio_batch(batch, nbatch, buffer);
+        }
+      else
+#endif
+        {
+          batch[0]->aioc_worker(batch[0]);
+        }
+
+#ifdef CONFIG_PRIORITY_INHERITANCE
+      /* Restore the default priority of the worker */
+
+      if (param.sched_priority != CONFIG_FS_AIO_PRIORITY)
+        {
+          param.sched_priority = CONFIG_FS_AIO_PRIORITY;
+          (void)nxsched_setparam(0, &param);
+        }
+#endif
+
+      /* The file is no longer busy.  Wake up any workers that deferred
+       * because of it.
+       */
+
+      aio_lock();
+      g_aio_active[wndx] = NULL;
+
+      for (i = g_aio_ndeferred; i > 0; i--)
+        {
+          nxsem_post(&g_aio_worksem);
+        }
+
+      g_aio_ndeferred = 0;
+      aio_unlock();
+    }
+
+  return OK; /* To keep some compilers happy */
+}
+
+/****************************************************************************
+ * Name: aio_start
+ *
+ * Description:
+ *   Start the AIO worker threads.  The caller must hold the AIO lock.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+static int aio_start(void)
+{
+  pid_t pid;
+  int wndx;
+
+  /* The work semaphore is used for signaling and, hence, should not have
+   * priority inheritance enabled.
+   */
+
+  (void)nxsem_setprotocol(&g_aio_worksem, SEM_PRIO_NONE);
+
+  for (wndx = 0; wndx < CONFIG_FS_AIO_NWORKERS; wndx++)
+    {
+      if (g_aio_worker[wndx] > 0)
+        {
+          continue;
+        }
+
+      pid = kthread_create("aio", CONFIG_FS_AIO_PRIORITY,
+                           CONFIG_FS_AIO_STACKSIZE, (main_t)aio_thread,
+                           (FAR char * const *)NULL);
+      if (pid < 0)
+        {
+          ferr("ERROR: kthread_create %d failed: %d\n", wndx, (int)pid);
+
+          /* The request can still be served if any worker is running */
+
+          return wndx > 0 ? OK : (int)pid;
+        }
+
+      g_aio_worker[wndx] = pid;
+    }
+
+  g_aio_started = true;
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aio_queue
+ *
+ * Description:
+ *   Schedule the asynchronous I/O on the AIO worker threads.  The worker
+ *   threads are started when the first request is queued.
+ *
+ * Input Parameters:
+ *   aioc   - The container of the request
+ *   worker - The function that performs the request on the worker thread
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  Otherwise, -1 is returned and the errno is set
+ *   appropriately.  The container is freed on failure.
+ *
+ ****************************************************************************/
+
+int aio_queue(FAR struct aio_container_s *aioc, aio_worker_t worker)
+{
+  int ret = OK;
+
+  DEBUGASSERT(aioc != NULL && worker != NULL);
+
+  aio_lock();
+  if (!g_aio_started)
+    {
+      ret = aio_start();
+    }
 
-  ret = work_queue(LPWORK, &aioc->aioc_work, worker, aioc, 0);
   if (ret < 0)
     {
-      FAR struct aiocb *aiocbp = aioc->aioc_aiocbp;
+      FAR struct aiocb *aiocbp = aioc_decant(aioc);
       DEBUGASSERT(aiocbp);
 
+      aio_unlock();
       aiocbp->aio_result = ret;
       set_errno(-ret);
-      ret = ERROR;
+      return ERROR;
     }
 
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  /* Now the low-priority work queue might run at its new priority */
+  /* The request may be started as soon as the worker function is set */
 
-  sched_unlock();
-#endif
+  aioc->aioc_worker = worker;
+  aio_unlock();
+
+  nxsem_post(&g_aio_worksem);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: aio_dequeue
+ *
+ * Description:
+ *   Remove a request from the queue if it has not yet been started.  The
+ *   container is not freed.
+ *
+ * Input Parameters:
+ *   aioc - The container of the request
+ *
+ * Returned Value:
+ *   Zero (OK) if the request was removed; -EBUSY if it has already been
+ *   started.
+ *
+ ****************************************************************************/
+
+int aio_dequeue(FAR struct aio_container_s *aioc)
+{
+  int ret = -EBUSY;
+
+  aio_lock();
+  if (!aioc->aioc_started)
+    {
+      /* Mark it started so that no worker will take it and consume the
+       * semaphore count that was posted for it.  If a worker already took
+       * the count, that worker will just find nothing to do.
+       */
+
+      aioc->aioc_started = true;
+      if (aioc->aioc_worker != NULL)
+        {
+          (void)nxsem_trywait(&g_aio_worksem);
+        }
+
+      ret = OK;
+    }
+
+  aio_unlock();
   return ret;
 }
 
@@ -53,7 +53,7 @@
 #ifdef CONFIG_FS_AIO
 
 /****************************************************************************
- * Private Functions
+ * Public Functions
  ****************************************************************************/
 
 /****************************************************************************
@@ -72,14 +72,12 @@
  *
  ****************************************************************************/
 
-static void aio_read_worker(FAR void *arg)
+void aio_read_worker(FAR void *arg)
 {
   FAR struct aio_container_s *aioc = (FAR struct aio_container_s *)arg;
   FAR struct aiocb *aiocbp;
+  FAR struct aio_ring_s *ring;
   pid_t pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  uint8_t prio;
-#endif
   ssize_t nread = 0;
 
   /* Get the information from the container, decant the AIO control block,
@@ -89,9 +87,7 @@ static void aio_read_worker(FAR void *arg)
 
   DEBUGASSERT(aioc && aioc->aioc_aiocbp);
   pid    = aioc->aioc_pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  prio   = aioc->aioc_prio;
-#endif
+  ring   = aioc->aioc_ring;
   aiocbp = aioc_decant(aioc);
 
 #if defined(AIO_HAVE_FILEP) && defined(AIO_HAVE_PSOCK)
@@ -141,19 +137,9 @@ static void aio_read_worker(FAR void *arg)
 
   /* Signal the client */
 
-  (void)aio_signal(pid, aiocbp);
-
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  /* Restore the low priority worker thread default priority */
-
-  lpwork_restorepriority(prio);
-#endif
+  (void)aio_signal(pid, ring, aiocbp);
 }
 
-/****************************************************************************
- * Public Functions
- ****************************************************************************/
-
 /****************************************************************************
  * Name: aio_read
  *
@@ -277,6 +263,7 @@ int aio_read(FAR struct aiocb *aiocbp)
 
   /* Defer the work to the worker thread */
 
+  aioc->aioc_opcode = LIO_READ;
   ret = aio_queue(aioc, aio_read_worker);
   if (ret < 0)
     {
@@ -0,0 +1,286 @@
+/****************************************************************************
+ * fs/aio/aio_ring.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <aio.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/semaphore.h>
+
+#include "aio/aio.h"
+
+#ifdef CONFIG_FS_AIO_RING
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aio_ring_submit
+ *
+ * Description:
+ *   Submit one request from the submission queue.  The request is counted
+ *   as in flight; a request that cannot be queued completes at once with
+ *   an error.
+ *
+ * Input Parameters:
+ *   ring   - The submission/completion ring
+ *   aiocbp - The AIO control block of the request
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+static void aio_ring_submit(FAR struct aio_ring_s *ring,
+                           FAR struct aiocb *aiocbp)
+{
+  FAR struct aio_container_s *aioc;
+  aio_worker_t worker;
+  irqstate_t flags;
+
+  flags = enter_critical_section();
+  ring->ar_inflight++;
+  leave_critical_section(flags);
+
+  aiocbp->aio_result = -EINPROGRESS;
+  aiocbp->aio_priv   = NULL;
+
+  switch (aiocbp->aio_lio_opcode)
+    {
+      case LIO_NOP:
+        aiocbp->aio_result = OK;
+        aio_ring_complete(ring, aiocbp);
+        return;
+
+      case LIO_READ:
+        worker = aio_read_worker;
+        break;
+
+      case LIO_WRITE:
+        worker = aio_write_worker;
+        break;
+
+      default:
+        ferr("ERROR: Unrecognized opcode: %d\n", aiocbp->aio_lio_opcode);
+        aiocbp->aio_result = -EINVAL;
+        aio_ring_complete(ring, aiocbp);
+        return;
+    }
+
+  /* Create a container for the AIO control block.  This may cause us to
+   * block if there are insufficient resources to satisfy the request.
+   */
+
+  aioc = aio_contain(aiocbp);
+  if (aioc == NULL)
+    {
+      aiocbp->aio_result = -get_errno();
+      aio_ring_complete(ring, aiocbp);
+      return;
+    }
+
+  /* Defer the work to a worker thread.  On failure, the container has
+   * been freed and the result set.
+   */
+
+  aioc->aioc_ring   = ring;
+  aioc->aioc_opcode = aiocbp->aio_lio_opcode;
+
+  if (aio_queue(aioc, worker) < 0)
+    {
+      aio_ring_complete(ring, aiocbp);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aio_ring_complete
+ *
+ * Description:
+ *   Post the completion of a request to its completion ring and wake up
+ *   the thread waiting in aio_ring_enter(), if any.
+ *
+ * Input Parameters:
+ *   ring   - The completion ring of the request
+ *   aiocbp - The completed AIO control block
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void aio_ring_complete(FAR struct aio_ring_s *ring,
+                       FAR struct aiocb *aiocbp)
+{
+  FAR struct aio_cqe_s *cqe;
+  irqstate_t flags;
+
+  /* aio_ring_enter() never submits more requests than the completion queue
+   * has room for, so the queue cannot overflow here.
+   */
+
+  flags = enter_critical_section();
+  DEBUGASSERT(ring->ar_inflight > 0 &&
+              (uint16_t)(ring->ar_cqtail - ring->ar_cqhead) <=
+              ring->ar_cqmask);
+
+  cqe             = &ring->ar_cq[ring->ar_cqtail & ring->ar_cqmask];
+  cqe->cqe_aiocbp = aiocbp;
+  cqe->cqe_result = aiocbp->aio_result;
+
+  ring->ar_cqtail++;
+  ring->ar_inflight--;
+
+  if (ring->ar_waiting)
+    {
+      ring->ar_waiting = false;
+      nxsem_post(&ring->ar_cqsem);
+    }
+
+  leave_critical_section(flags);
+}
+
+/****************************************************************************
+ * Name: aio_ring_enter
+ *
+ * Description:
+ *   Submit all requests queued in the submission queue of the ring and,
+ *   optionally, wait for completions.  The requests are submitted together
+ *   so that the worker threads see the whole batch and can merge
+ *   contiguous transfers.  Submission stops early if the completion queue
+ *   has no room for more requests; the remaining entries stay queued.
+ *
+ * Input Parameters:
+ *   ring         - The ring initialized with aio_ring_init()
+ *   min_complete - Wait until at least this many completions are waiting
+ *                  in the completion queue.  The wait ends early if no
+ *                  request is in flight.
+ *
+ * Returned Value:
+ *   The number of requests submitted on success.  Otherwise, -1 is
+ *   returned and the errno is set appropriately:
+ *
+ *   EINVAL - The ring is not valid
+ *   EINTR  - The wait for completions was interrupted by a signal
+ *
+ ****************************************************************************/
+
+int aio_ring_enter(FAR struct aio_ring_s *ring, int min_complete)
+{
+  FAR struct aiocb *aiocbp;
+  irqstate_t flags;
+  uint16_t used;
+  int nsubmitted = 0;
+  int ret;
+
+  if (ring == NULL || ring->ar_sq == NULL || ring->ar_cq == NULL)
+    {
+      set_errno(EINVAL);
+      return ERROR;
+    }
+
+  /* Hold off the workers until the whole batch has been queued */
+
+  sched_lock();
+  while (ring->ar_sqhead != ring->ar_sqtail)
+    {
+      /* Is there room for one more completion? */
+
+      flags = enter_critical_section();
+      used  = (uint16_t)(ring->ar_cqtail - ring->ar_cqhead) +
+              ring->ar_inflight;
+      leave_critical_section(flags);
+
+      if (used > ring->ar_cqmask)
+        {
+          break;
+        }
+
+      aiocbp = ring->ar_sq[ring->ar_sqhead & ring->ar_sqmask];
+      ring->ar_sqhead++;
+
+      if (aiocbp != NULL)
+        {
+          aio_ring_submit(ring, aiocbp);
+          nsubmitted++;
+        }
+    }
+
+  sched_unlock();
+
+  /* Wait for completions */
+
+  for (; ; )
+    {
+      flags = enter_critical_section();
+      if ((uint16_t)(ring->ar_cqtail - ring->ar_cqhead) >= min_complete ||
+          ring->ar_inflight == 0)
+        {
+          leave_critical_section(flags);
+          break;
+        }
+
+      ring->ar_waiting = true;
+      leave_critical_section(flags);
+
+      ret = nxsem_wait(&ring->ar_cqsem);
+      if (ret < 0)
+        {
+          ring->ar_waiting = false;
+          set_errno(-ret);
+          return ERROR;
+        }
+    }
+
+  return nsubmitted;
+}
+
+#endif /* CONFIG_FS_AIO_RING */
@@ -61,10 +61,12 @@
  * Name: aio_signal
  *
  * Description:
- *   Signal the client that an I/O has completed.
+ *   Signal the client that an I/O has completed.  Requests submitted
+ *   through a completion ring are posted to the ring instead.
  *
  * Input Parameters:
  *   pid    - ID of the task to signal
+ *   ring   - The completion ring of the request or NULL
  *   aiocbp - Pointer to the asynchronous I/O state structure that includes
  *            information about how to signal the client
  *
@@ -73,11 +75,12 @@
  *   negated errno value is returned.
  *
  * Assumptions:
- *   This function runs only in the context of the worker thread.
+ *   This function runs only in the context of a worker thread.
  *
  ****************************************************************************/
 
-int aio_signal(pid_t pid, FAR struct aiocb *aiocbp)
+int aio_signal(pid_t pid, FAR struct aio_ring_s *ring,
+               FAR struct aiocb *aiocbp)
 {
 #ifdef CONFIG_CAN_PASS_STRUCTS
   union sigval value;
@@ -87,6 +90,14 @@ int aio_signal(pid_t pid, FAR struct aiocb *aiocbp)
 
   DEBUGASSERT(aiocbp);
 
+  /* Is the client reaping completions from a ring? */
+
+  if (ring != NULL)
+    {
+      aio_ring_complete(ring, aiocbp);
+      return OK;
+    }
+
   ret = OK; /* Assume success */
 
   /* Signal the client */
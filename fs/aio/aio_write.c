@@ -73,6 +73,10 @@ static inline int file_fcntl(FAR struct file *filep, int cmd, ...)
 }
 #endif
 
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
 /****************************************************************************
  * Name: aio_write_worker
  *
@@ -89,14 +93,12 @@ static inline int file_fcntl(FAR struct file *filep, int cmd, ...)
  *
  ****************************************************************************/
 
-static void aio_write_worker(FAR void *arg)
+void aio_write_worker(FAR void *arg)
 {
   FAR struct aio_container_s *aioc = (FAR struct aio_container_s *)arg;
   FAR struct aiocb *aiocbp;
+  FAR struct aio_ring_s *ring;
   pid_t pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  uint8_t prio;
-#endif
   ssize_t nwritten = 0;
 #ifdef AIO_HAVE_FILEP
   int oflags;
@@ -109,9 +111,7 @@ static void aio_write_worker(FAR void *arg)
 
   DEBUGASSERT(aioc && aioc->aioc_aiocbp);
   pid    = aioc->aioc_pid;
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  prio   = aioc->aioc_prio;
-#endif
+  ring   = aioc->aioc_ring;
   aiocbp = aioc_decant(aioc);
 
 #if defined(AIO_HAVE_FILEP) && defined(AIO_HAVE_PSOCK)
@@ -189,19 +189,9 @@ errout:
 
   /* Signal the client */
 
-  (void)aio_signal(pid, aiocbp);
-
-#ifdef CONFIG_PRIORITY_INHERITANCE
-  /* Restore the low priority worker thread default priority */
-
-  lpwork_restorepriority(prio);
-#endif
+  (void)aio_signal(pid, ring, aiocbp);
 }
 
-/****************************************************************************
- * Public Functions
- ****************************************************************************/
-
 /****************************************************************************
  * Name: aio_write
  *
@@ -327,6 +317,7 @@ int aio_write(FAR struct aiocb *aiocbp)
 
   /* Defer the work to the worker thread */
 
+  aioc->aioc_opcode = LIO_WRITE;
   ret = aio_queue(aioc, aio_write_worker);
   if (ret < 0)
     {
@@ -0,0 +1,1234 @@
+/****************************************************************************
+ * fs/bcache/fs_bcache.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <queue.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/kthread.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/bcache.h>
+
+#ifdef CONFIG_FS_BCACHE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_FS_BCACHE_NBLOCKS
+#  define CONFIG_FS_BCACHE_NBLOCKS 32
+#endif
+
+#ifndef CONFIG_FS_BCACHE_BLOCKSIZE
+#  define CONFIG_FS_BCACHE_BLOCKSIZE 512
+#endif
+
+#ifndef CONFIG_FS_BCACHE_HASHSIZE
+#  define CONFIG_FS_BCACHE_HASHSIZE 16
+#endif
+
+#ifndef CONFIG_FS_BCACHE_BYPASS
+#  define CONFIG_FS_BCACHE_BYPASS 8
+#endif
+
+#ifndef CONFIG_FS_BCACHE_WRDELAY
+#  define CONFIG_FS_BCACHE_WRDELAY 1000
+#endif
+
+#ifndef CONFIG_FS_BCACHE_READAHEAD
+#  define CONFIG_FS_BCACHE_READAHEAD 8
+#endif
+
+#ifndef CONFIG_FS_BCACHE_PRIORITY
+#  define CONFIG_FS_BCACHE_PRIORITY 100
+#endif
+
+#ifndef CONFIG_FS_BCACHE_STACKSIZE
+#  define CONFIG_FS_BCACHE_STACKSIZE 2048
+#endif
+
+/* The write-back thread is awakened early when this many sectors are
+ * dirty.
+ */
+
+#define BCACHE_HIWATER   ((3 * CONFIG_FS_BCACHE_NBLOCKS) / 4)
+#define BCACHE_WRTICKS   MSEC2TICK(CONFIG_FS_BCACHE_WRDELAY)
+
+/* Values of struct bcache_buf_s flags */
+
+#define BCACHE_VALID     (1 << 0)  /* Buffer holds a copy of the sector */
+#define BCACHE_DIRTY     (1 << 1)  /* Buffer must be written to the device */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One device attached to the cache */
+
+struct bcache_dev_s
+{
+  FAR struct bcache_dev_s *flink;     /* Supports a singly linked list */
+  FAR const struct bcache_ops_s *ops; /* Device access operations */
+  FAR void *priv;                     /* Opaque device reference */
+  uint16_t sectsize;                  /* Size of one sector */
+  uint16_t crefs;                     /* Number of attachments */
+  uint16_t ranum;                     /* Number of sectors to read ahead */
+  off_t rasector;                     /* Next sector to read ahead */
+  int error;                          /* Last background write-back error */
+};
+
+/* One cached sector.  Buffers are kept on the LRU list with the most
+ * recently used buffer at the head of the list.
+ */
+
+struct bcache_buf_s
+{
+  dq_entry_t lru;                     /* Supports a doubly linked LRU list */
+  FAR struct bcache_buf_s *hnext;     /* Hash chain */
+  FAR struct bcache_dev_s *dev;       /* The device that owns the sector */
+  off_t sector;                       /* The cached sector number */
+  clock_t dirtied;                    /* Time when the buffer became dirty */
+  uint8_t flags;                      /* See BCACHE_* definitions */
+  FAR uint8_t *data;                  /* The cached sector data */
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static ssize_t bcache_blkread(FAR void *priv, FAR uint8_t *buffer,
+                              off_t sector, unsigned int nsectors);
+static ssize_t bcache_blkwrite(FAR void *priv, FAR const uint8_t *buffer,
+                               off_t sector, unsigned int nsectors);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Operations used for block drivers */
+
+static const struct bcache_ops_s g_bcache_blkops =
+{
+  bcache_blkread,  /* read */
+  bcache_blkwrite  /* write */
+};
+
+static sem_t g_bcache_sem;            /* Protects all of the cache state */
+static sem_t g_bcache_wksem;          /* Wakes up the write-back thread */
+static pid_t g_bcache_pid;            /* Write-back thread */
+static uint16_t g_bcache_ndirty;      /* Number of dirty buffers */
+static dq_queue_t g_bcache_lru;       /* LRU list of all buffers */
+static FAR uint8_t *g_bcache_pool;    /* Memory for all sector data */
+static FAR struct bcache_dev_s *g_bcache_devs;
+static FAR struct bcache_buf_s *g_bcache_hash[CONFIG_FS_BCACHE_HASHSIZE];
+static struct bcache_buf_s g_bcache_bufs[CONFIG_FS_BCACHE_NBLOCKS];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: bcache_semtake
+ ****************************************************************************/
+
+static void bcache_semtake(void)
+{
+  int ret;
+
+  do
+    {
+      /* Take the semaphore (perhaps waiting) */
+
+      ret = nxsem_wait(&g_bcache_sem);
+
+      /* The only case that an error should occur here is if the wait was
+       * awakened by a signal.
+       */
+
+      DEBUGASSERT(ret == OK || ret == -EINTR);
+    }
+  while (ret == -EINTR);
+}
+
+/****************************************************************************
+ * Name: bcache_semgive
+ ****************************************************************************/
+
+#define bcache_semgive() nxsem_post(&g_bcache_sem)
+
+/****************************************************************************
+ * Name: bcache_blkread and bcache_blkwrite
+ *
+ * Description:
+ *   Access a block driver through its block_operations.
+ *
+ ****************************************************************************/
+
+static ssize_t bcache_blkread(FAR void *priv, FAR uint8_t *buffer,
+                              off_t sector, unsigned int nsectors)
+{
+  FAR struct inode *inode = (FAR struct inode *)priv;
+
+  if (inode->u.i_bops == NULL || inode->u.i_bops->read == NULL)
+    {
+      return -ENOSYS;
+    }
+
+  return inode->u.i_bops->read(inode, buffer, sector, nsectors);
+}
+
+static ssize_t bcache_blkwrite(FAR void *priv, FAR const uint8_t *buffer,
+                               off_t sector, unsigned int nsectors)
+{
+  FAR struct inode *inode = (FAR struct inode *)priv;
+
+  if (inode->u.i_bops == NULL || inode->u.i_bops->write == NULL)
+    {
+      return -EACCES;
+    }
+
+  return inode->u.i_bops->write(inode, buffer, sector, nsectors);
+}
+
+/****************************************************************************
+ * Name: bcache_devread and bcache_devwrite
+ *
+ * Description:
+ *   Transfer sectors directly to or from the device.
+ *
+ ****************************************************************************/
+
+static int bcache_devread(FAR struct bcache_dev_s *dev, FAR uint8_t *buffer,
+                          off_t sector, unsigned int nsectors)
+{
+  ssize_t nread = dev->ops->read(dev->priv, buffer, sector, nsectors);
+
+  if (nread == (ssize_t)nsectors)
+    {
+      return OK;
+    }
+
+  return nread < 0 ? (int)nread : -EIO;
+}
+
+static int bcache_devwrite(FAR struct bcache_dev_s *dev,
+                           FAR const uint8_t *buffer, off_t sector,
+                           unsigned int nsectors)
+{
+  ssize_t nwritten;
+
+  if (dev->ops->write == NULL)
+    {
+      return -EACCES;
+    }
+
+  nwritten = dev->ops->write(dev->priv, buffer, sector, nsectors);
+  if (nwritten == (ssize_t)nsectors)
+    {
+      return OK;
+    }
+
+  return nwritten < 0 ? (int)nwritten : -EIO;
+}
+
+/****************************************************************************
+ * Name: bcache_wakeup
+ ****************************************************************************/
+
+static void bcache_wakeup(void)
+{
+  int semcount;
+
+  if (nxsem_getvalue(&g_bcache_wksem, &semcount) == OK && semcount <= 0)
+    {
+      (void)nxsem_post(&g_bcache_wksem);
+    }
+}
+
+/****************************************************************************
+ * Name: bcache_hash
+ ****************************************************************************/
+
+static inline unsigned int bcache_hash(FAR struct bcache_dev_s *dev,
+                                       off_t sector)
+{
+  return ((uintptr_t)dev / sizeof(struct bcache_dev_s) + (uintptr_t)sector) %
+         CONFIG_FS_BCACHE_HASHSIZE;
+}
+
+/****************************************************************************
+ * Name: bcache_inrange
+ ****************************************************************************/
+
+static inline bool bcache_inrange(FAR struct bcache_buf_s *buf,
+                                  FAR struct bcache_dev_s *dev,
+                                  off_t sector, unsigned int nsectors)
+{
+  return buf->dev == dev && buf->sector >= sector &&
+         (nsectors == UINT_MAX || buf->sector - sector < (off_t)nsectors);
+}
+
+/****************************************************************************
+ * Name: bcache_find
+ *
+ * Description:
+ *   Find the buffer that holds a sector.
+ *
+ ****************************************************************************/
+
+static FAR struct bcache_buf_s *bcache_find(FAR struct bcache_dev_s *dev,
+                                            off_t sector)
+{
+  FAR struct bcache_buf_s *buf;
+
+  for (buf = g_bcache_hash[bcache_hash(dev, sector)];
+       buf != NULL;
+       buf = buf->hnext)
+    {
+      if (buf->dev == dev && buf->sector == sector)
+        {
+          return buf;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: bcache_insert
+ *
+ * Description:
+ *   Assign a free buffer to a sector and make it the most recently used
+ *   buffer.
+ *
+ ****************************************************************************/
+
+static void bcache_insert(FAR struct bcache_buf_s *buf,
+                          FAR struct bcache_dev_s *dev, off_t sector)
+{
+  unsigned int ndx = bcache_hash(dev, sector);
+
+  buf->dev            = dev;
+  buf->sector         = sector;
+  buf->flags          = BCACHE_VALID;
+  buf->hnext          = g_bcache_hash[ndx];
+  g_bcache_hash[ndx]  = buf;
+
+  dq_rem(&buf->lru, &g_bcache_lru);
+  dq_addfirst(&buf->lru, &g_bcache_lru);
+}
+
+/****************************************************************************
+ * Name: bcache_release
+ *
+ * Description:
+ *   Discard the contents of a buffer and make it the first buffer to be
+ *   reused.
+ *
+ ****************************************************************************/
+
+static void bcache_release(FAR struct bcache_buf_s *buf)
+{
+  FAR struct bcache_buf_s **pprev;
+
+  if ((buf->flags & BCACHE_VALID) != 0)
+    {
+      pprev = &g_bcache_hash[bcache_hash(buf->dev, buf->sector)];
+      while (*pprev != buf)
+        {
+          pprev = &(*pprev)->hnext;
+        }
+
+      *pprev = buf->hnext;
+    }
+
+  if ((buf->flags & BCACHE_DIRTY) != 0)
+    {
+      g_bcache_ndirty--;
+    }
+
+  buf->hnext = NULL;
+  buf->dev   = NULL;
+  buf->flags = 0;
+
+  dq_rem(&buf->lru, &g_bcache_lru);
+  dq_addlast(&buf->lru, &g_bcache_lru);
+}
+
+/****************************************************************************
+ * Name: bcache_touch
+ ****************************************************************************/
+
+static inline void bcache_touch(FAR struct bcache_buf_s *buf)
+{
+  dq_rem(&buf->lru, &g_bcache_lru);
+  dq_addfirst(&buf->lru, &g_bcache_lru);
+}
+
+/****************************************************************************
+ * Name: bcache_writeback
+ *
+ * Description:
+ *   Write one dirty buffer to the device.
+ *
+ ****************************************************************************/
+
+static int bcache_writeback(FAR struct bcache_buf_s *buf)
+{
+  int ret;
+
+  ret = bcache_devwrite(buf->dev, buf->data, buf->sector, 1);
+  if (ret >= 0)
+    {
+      buf->flags &= ~BCACHE_DIRTY;
+      g_bcache_ndirty--;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bcache_flushrange
+ *
+ * Description:
+ *   Write back the dirty buffers in a range of sectors in ascending sector
+ *   order.
+ *
+ ****************************************************************************/
+
+static int bcache_flushrange(FAR struct bcache_dev_s *dev, off_t sector,
+                             unsigned int nsectors)
+{
+  FAR struct bcache_buf_s *buf;
+  FAR struct bcache_buf_s *next;
+  int ret;
+  int i;
+
+  for (; ; )
+    {
+      /* Find the dirty buffer with the lowest sector number */
+
+      next = NULL;
+      for (i = 0; i < CONFIG_FS_BCACHE_NBLOCKS; i++)
+        {
+          buf = &g_bcache_bufs[i];
+          if ((buf->flags & BCACHE_DIRTY) != 0 &&
+              bcache_inrange(buf, dev, sector, nsectors) &&
+              (next == NULL || buf->sector < next->sector))
+            {
+              next = buf;
+            }
+        }
+
+      if (next == NULL)
+        {
+          return OK;
+        }
+
+      /* The buffer remains dirty if the write fails */
+
+      ret = bcache_writeback(next);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: bcache_getbuf
+ *
+ * Description:
+ *   Get the least recently used clean buffer for reuse.  If every buffer is
+ *   dirty, the least recently used buffer is written back first unless
+ *   'clean' is true.
+ *
+ ****************************************************************************/
+
+static FAR struct bcache_buf_s *bcache_getbuf(bool clean, FAR int *errcode)
+{
+  FAR struct bcache_buf_s *buf;
+  int ret;
+
+  for (buf = (FAR struct bcache_buf_s *)dq_tail(&g_bcache_lru);
+       buf != NULL;
+       buf = (FAR struct bcache_buf_s *)dq_prev(&buf->lru))
+    {
+      if ((buf->flags & BCACHE_DIRTY) == 0)
+        {
+          bcache_release(buf);
+          return buf;
+        }
+    }
+
+  if (clean)
+    {
+      *errcode = -EBUSY;
+      return NULL;
+    }
+
+  buf = (FAR struct bcache_buf_s *)dq_tail(&g_bcache_lru);
+  ret = bcache_writeback(buf);
+  if (ret < 0)
+    {
+      *errcode = ret;
+      return NULL;
+    }
+
+  bcache_release(buf);
+  return buf;
+}
+
+/****************************************************************************
+ * Name: bcache_discard
+ *
+ * Description:
+ *   Discard the cached copies of a range of sectors.
+ *
+ ****************************************************************************/
+
+static void bcache_discard(FAR struct bcache_dev_s *dev, off_t sector,
+                           unsigned int nsectors)
+{
+  FAR struct bcache_buf_s *buf;
+  int i;
+
+  for (i = 0; i < CONFIG_FS_BCACHE_NBLOCKS; i++)
+    {
+      buf = &g_bcache_bufs[i];
+      if (buf->dev != NULL && bcache_inrange(buf, dev, sector, nsectors))
+        {
+          bcache_release(buf);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: bcache_expired
+ *
+ * Description:
+ *   Return true if a dirty buffer of the device has been dirty for longer
+ *   than the write-back delay.
+ *
+ ****************************************************************************/
+
+static bool bcache_expired(FAR struct bcache_dev_s *dev, clock_t now)
+{
+  FAR struct bcache_buf_s *buf;
+  int i;
+
+  for (i = 0; i < CONFIG_FS_BCACHE_NBLOCKS; i++)
+    {
+      buf = &g_bcache_bufs[i];
+      if (buf->dev == dev && (buf->flags & BCACHE_DIRTY) != 0 &&
+          now - buf->dirtied >= BCACHE_WRTICKS)
+        {
+          return true;
+        }
+    }
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: bcache_readahead_one
+ *
+ * Description:
+ *   Read ahead one sector for the first device with a pending read-ahead
+ *   hint.  Returns false if there was nothing to do.
+ *
+ ****************************************************************************/
+
+static bool bcache_readahead_one(void)
+{
+  FAR struct bcache_dev_s *dev;
+  FAR struct bcache_buf_s *buf;
+  off_t sector;
+  int errcode;
+
+  for (dev = g_bcache_devs; dev != NULL; dev = dev->flink)
+    {
+      if (dev->ranum > 0)
+        {
+          break;
+        }
+    }
+
+  if (dev == NULL)
+    {
+      return false;
+    }
+
+  sector = dev->rasector++;
+  dev->ranum--;
+
+  if (bcache_find(dev, sector) != NULL)
+    {
+      return true;
+    }
+
+  /* Read-ahead never forces dirty sectors out of the cache */
+
+  buf = bcache_getbuf(true, &errcode);
+  if (buf == NULL)
+    {
+      dev->ranum = 0;
+      return true;
+    }
+
+  if (bcache_devread(dev, buf->data, sector, 1) < 0)
+    {
+      dev->ranum = 0;
+      return true;
+    }
+
+  bcache_insert(buf, dev, sector);
+  return true;
+}
+
+/****************************************************************************
+ * Name: bcache_thread
+ *
+ * Description:
+ *   This is the kernel thread that performs read-ahead and writes back
+ *   dirty sectors.  The cache lock is released between sectors so that
+ *   foreground accesses are not held off by a long read-ahead.
+ *
+ ****************************************************************************/
+
+static int bcache_thread(int argc, char *argv[])
+{
+  FAR struct bcache_dev_s *dev;
+  bool more;
+  int ret;
+
+  for (; ; )
+    {
+      /* Wait until awakened or until it is time to check for expired dirty
+       * sectors.
+       */
+
+      if (g_bcache_ndirty > 0 && BCACHE_WRTICKS > 0)
+        {
+          (void)nxsem_tickwait(&g_bcache_wksem, clock_systimer(),
+                               BCACHE_WRTICKS);
+        }
+      else
+        {
+          (void)nxsem_wait(&g_bcache_wksem);
+        }
+
+      /* Service the read-ahead hints */
+
+      do
+        {
+          bcache_semtake();
+          more = bcache_readahead_one();
+          bcache_semgive();
+        }
+      while (more);
+
+      /* Write back each device that has expired dirty sectors, or every
+       * device if too many sectors are dirty.
+       */
+
+      bcache_semtake();
+      for (dev = g_bcache_devs; dev != NULL; dev = dev->flink)
+        {
+          if (g_bcache_ndirty >= BCACHE_HIWATER ||
+              bcache_expired(dev, clock_systimer()))
+            {
+              ret = bcache_flushrange(dev, 0, UINT_MAX);
+              if (ret < 0)
+                {
+                  dev->error = ret;
+                }
+            }
+        }
+
+      bcache_semgive();
+    }
+
+  return OK; /* Not reachable */
+}
+
+/****************************************************************************
+ * Name: bcache_start
+ *
+ * Description:
+ *   Allocate the cache memory and start the write-back thread, if that has
+ *   not already been done.
+ *
+ ****************************************************************************/
+
+static int bcache_start(void)
+{
+  FAR struct bcache_buf_s *buf;
+  pid_t pid;
+  int i;
+
+  if (g_bcache_pool == NULL)
+    {
+      g_bcache_pool = (FAR uint8_t *)
+        kmm_malloc(CONFIG_FS_BCACHE_NBLOCKS * CONFIG_FS_BCACHE_BLOCKSIZE);
+      if (g_bcache_pool == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      for (i = 0; i < CONFIG_FS_BCACHE_NBLOCKS; i++)
+        {
+          buf       = &g_bcache_bufs[i];
+          buf->data = &g_bcache_pool[i * CONFIG_FS_BCACHE_BLOCKSIZE];
+          dq_addlast(&buf->lru, &g_bcache_lru);
+        }
+    }
+
+  if (g_bcache_pid <= 0)
+    {
+      pid = kthread_create("bcache", CONFIG_FS_BCACHE_PRIORITY,
+                           CONFIG_FS_BCACHE_STACKSIZE,
+                           (main_t)bcache_thread, (FAR char * const *)NULL);
+      if (pid < 0)
+        {
+          return (int)pid;
+        }
+
+      g_bcache_pid = pid;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: bcache_initialize
+ *
+ * Description:
+ *   Initialize the block buffer cache.  This is called once from
+ *   fs_initialize().  The cache memory and the write-back thread are not
+ *   created until the first device is attached.
+ *
+ ****************************************************************************/
+
+void bcache_initialize(void)
+{
+  nxsem_init(&g_bcache_sem, 0, 1);
+
+  /* The write-back thread only waits on this semaphore; it must not
+   * participate in priority inheritance.
+   */
+
+  nxsem_init(&g_bcache_wksem, 0, 0);
+  nxsem_setprotocol(&g_bcache_wksem, SEM_PRIO_NONE);
+
+  dq_init(&g_bcache_lru);
+}
+
+/****************************************************************************
+ * Name: bcache_attach_ops
+ *
+ * Description:
+ *   Attach a device that is accessed through the provided operations.
+ *
+ ****************************************************************************/
+
+FAR struct bcache_dev_s *bcache_attach_ops(FAR const struct bcache_ops_s *ops,
+                                           FAR void *priv,
+                                           uint16_t sectsize)
+{
+  FAR struct bcache_dev_s *dev;
+
+  DEBUGASSERT(ops != NULL && ops->read != NULL);
+
+  if (sectsize == 0 || sectsize > CONFIG_FS_BCACHE_BLOCKSIZE)
+    {
+      return NULL;
+    }
+
+  bcache_semtake();
+  if (bcache_start() < 0)
+    {
+      bcache_semgive();
+      return NULL;
+    }
+
+  /* Is this device already attached? */
+
+  for (dev = g_bcache_devs; dev != NULL; dev = dev->flink)
+    {
+      if (dev->ops == ops && dev->priv == priv)
+        {
+          if (dev->sectsize != sectsize)
+            {
+              dev = NULL;
+            }
+          else
+            {
+              dev->crefs++;
+            }
+
+          bcache_semgive();
+          return dev;
+        }
+    }
+
+  dev = (FAR struct bcache_dev_s *)kmm_zalloc(sizeof(struct bcache_dev_s));
+  if (dev != NULL)
+    {
+      dev->ops      = ops;
+      dev->priv     = priv;
+      dev->sectsize = sectsize;
+      dev->crefs    = 1;
+      dev->flink    = g_bcache_devs;
+      g_bcache_devs = dev;
+    }
+
+  bcache_semgive();
+  return dev;
+}
+
+/****************************************************************************
+ * Name: bcache_attach
+ *
+ * Description:
+ *   Attach a block driver that is accessed through its block_operations.
+ *
+ ****************************************************************************/
+
+FAR struct bcache_dev_s *bcache_attach(FAR struct inode *blkdriver,
+                                       uint16_t sectsize)
+{
+  DEBUGASSERT(blkdriver != NULL);
+  return bcache_attach_ops(&g_bcache_blkops, blkdriver, sectsize);
+}
+
+/****************************************************************************
+ * Name: bcache_detach
+ *
+ * Description:
+ *   Release one reference to a device.  When the last reference is
+ *   released, all dirty sectors are written back and all cached sectors of
+ *   the device are discarded.
+ *
+ ****************************************************************************/
+
+int bcache_detach(FAR struct bcache_dev_s *dev)
+{
+  FAR struct bcache_dev_s **pprev;
+  int ret = OK;
+
+  DEBUGASSERT(dev != NULL && dev->crefs > 0);
+
+  bcache_semtake();
+  if (--dev->crefs == 0)
+    {
+      ret = bcache_flushrange(dev, 0, UINT_MAX);
+      if (ret >= 0)
+        {
+          ret = dev->error;
+        }
+
+      bcache_discard(dev, 0, UINT_MAX);
+
+      for (pprev = &g_bcache_devs; *pprev != dev; pprev = &(*pprev)->flink)
+        {
+        }
+
+      *pprev = dev->flink;
+      kmm_free(dev);
+    }
+
+  bcache_semgive();
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bcache_read
+ *
+ * Description:
+ *   Read sectors through the cache.
+ *
+ ****************************************************************************/
+
+int bcache_read(FAR struct bcache_dev_s *dev, FAR uint8_t *buffer,
+                off_t sector, unsigned int nsectors)
+{
+  FAR struct bcache_buf_s *buf;
+  unsigned int nmiss;
+  unsigned int i;
+  int errcode;
+  int ret = OK;
+
+  DEBUGASSERT(dev != NULL && buffer != NULL);
+
+  bcache_semtake();
+
+  /* Large transfers bypass the cache, but must see any dirty sectors */
+
+  if (CONFIG_FS_BCACHE_BYPASS > 0 && nsectors >= CONFIG_FS_BCACHE_BYPASS)
+    {
+      ret = bcache_flushrange(dev, sector, nsectors);
+      if (ret >= 0)
+        {
+          ret = bcache_devread(dev, buffer, sector, nsectors);
+        }
+
+      bcache_semgive();
+      return ret;
+    }
+
+  while (nsectors > 0)
+    {
+      buf = bcache_find(dev, sector);
+      if (buf != NULL)
+        {
+          memcpy(buffer, buf->data, dev->sectsize);
+          bcache_touch(buf);
+
+          buffer += dev->sectsize;
+          sector++;
+          nsectors--;
+          continue;
+        }
+
+      /* Read the run of sectors that are not cached with one request */
+
+      for (nmiss = 1;
+           nmiss < nsectors && bcache_find(dev, sector + nmiss) == NULL;
+           nmiss++)
+        {
+        }
+
+      ret = bcache_devread(dev, buffer, sector, nmiss);
+      if (ret < 0)
+        {
+          break;
+        }
+
+      /* Then keep a copy of each sector.  Failing to find a buffer is not
+       * an error; the sector is simply not cached.
+       */
+
+      for (i = 0; i < nmiss; i++)
+        {
+          buf = bcache_getbuf(false, &errcode);
+          if (buf == NULL)
+            {
+              break;
+            }
+
+          memcpy(buf->data, buffer + i * dev->sectsize, dev->sectsize);
+          bcache_insert(buf, dev, sector + i);
+        }
+
+      buffer   += nmiss * dev->sectsize;
+      sector   += nmiss;
+      nsectors -= nmiss;
+    }
+
+  bcache_semgive();
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bcache_readbytes
+ *
+ * Description:
+ *   Read part of one sector through the cache.
+ *
+ ****************************************************************************/
+
+int bcache_readbytes(FAR struct bcache_dev_s *dev, off_t sector,
+                     unsigned int offset, FAR uint8_t *buffer, size_t len)
+{
+  FAR struct bcache_buf_s *buf;
+  int ret = OK;
+
+  DEBUGASSERT(dev != NULL && buffer != NULL &&
+              offset + len <= dev->sectsize);
+
+  bcache_semtake();
+
+  buf = bcache_find(dev, sector);
+  if (buf == NULL)
+    {
+      buf = bcache_getbuf(false, &ret);
+      if (buf == NULL)
+        {
+          goto errout_with_sem;
+        }
+
+      /* On failure, the released buffer is simply left unused */
+
+      ret = bcache_devread(dev, buf->data, sector, 1);
+      if (ret < 0)
+        {
+          goto errout_with_sem;
+        }
+
+      bcache_insert(buf, dev, sector);
+    }
+  else
+    {
+      bcache_touch(buf);
+    }
+
+  memcpy(buffer, buf->data + offset, len);
+
+errout_with_sem:
+  bcache_semgive();
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bcache_write
+ *
+ * Description:
+ *   Write sectors through the cache.
+ *
+ ****************************************************************************/
+
+int bcache_write(FAR struct bcache_dev_s *dev, FAR const uint8_t *buffer,
+                 off_t sector, unsigned int nsectors)
+{
+  FAR struct bcache_buf_s *buf;
+  uint16_t ndirty;
+  int ret = OK;
+
+  DEBUGASSERT(dev != NULL && buffer != NULL);
+
+  if (dev->ops->write == NULL)
+    {
+      return -EACCES;
+    }
+
+  bcache_semtake();
+  ndirty = g_bcache_ndirty;
+
+  /* Large transfers bypass the cache.  Every sector in the range is
+   * overwritten, so any cached copies are simply discarded.
+   */
+
+  if (CONFIG_FS_BCACHE_BYPASS > 0 && nsectors >= CONFIG_FS_BCACHE_BYPASS)
+    {
+      bcache_discard(dev, sector, nsectors);
+      ret = bcache_devwrite(dev, buffer, sector, nsectors);
+      bcache_semgive();
+      return ret;
+    }
+
+  for (; nsectors > 0; nsectors--, sector++, buffer += dev->sectsize)
+    {
+      buf = bcache_find(dev, sector);
+      if (buf == NULL)
+        {
+          buf = bcache_getbuf(false, &ret);
+          if (buf == NULL)
+            {
+              break;
+            }
+
+          bcache_insert(buf, dev, sector);
+        }
+      else
+        {
+          bcache_touch(buf);
+        }
+
+      memcpy(buf->data, buffer, dev->sectsize);
+
+#if CONFIG_FS_BCACHE_WRDELAY > 0
+      if ((buf->flags & BCACHE_DIRTY) == 0)
+        {
+          buf->flags  |= BCACHE_DIRTY;
+          buf->dirtied = clock_systimer();
+          g_bcache_ndirty++;
+        }
+#else
+      /* Write-through */
+
+      ret = bcache_devwrite(dev, buffer, sector, 1);
+      if (ret < 0)
+        {
+          bcache_release(buf);
+          break;
+        }
+#endif
+    }
+
+  /* The write-back thread must start timing the first dirty sectors and
+   * must run now if too many sectors are dirty.
+   */
+
+  if ((ndirty == 0 && g_bcache_ndirty > 0) ||
+      g_bcache_ndirty >= BCACHE_HIWATER)
+    {
+      bcache_wakeup();
+    }
+
+  bcache_semgive();
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bcache_update
+ *
+ * Description:
+ *   Update part of a cached sector after the caller has written the same
+ *   data directly to the device.
+ *
+ ****************************************************************************/
+
+void bcache_update(FAR struct bcache_dev_s *dev, off_t sector,
+                   unsigned int offset, FAR const uint8_t *buffer,
+                   size_t len)
+{
+  FAR struct bcache_buf_s *buf;
+
+  DEBUGASSERT(dev != NULL && offset + len <= dev->sectsize);
+
+  bcache_semtake();
+  buf = bcache_find(dev, sector);
+  if (buf != NULL)
+    {
+      memcpy(buf->data + offset, buffer, len);
+    }
+
+  bcache_semgive();
+}
+
+/****************************************************************************
+ * Name: bcache_flush
+ *
+ * Description:
+ *   Write back all dirty sectors of the device.
+ *
+ ****************************************************************************/
+
+int bcache_flush(FAR struct bcache_dev_s *dev)
+{
+  int ret;
+
+  DEBUGASSERT(dev != NULL);
+
+  bcache_semtake();
+  ret = bcache_flushrange(dev, 0, UINT_MAX);
+  if (ret >= 0 && dev->error < 0)
+    {
+      /* Report an earlier background failure only once */
+
+      ret        = dev->error;
+      dev->error = OK;
+    }
+
+  bcache_semgive();
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bcache_invalidate
+ *
+ * Description:
+ *   Discard the cached copies of a range of sectors, including any dirty
+ *   sectors.
+ *
+ ****************************************************************************/
+
+void bcache_invalidate(FAR struct bcache_dev_s *dev, off_t sector,
+                       unsigned int nsectors)
+{
+  DEBUGASSERT(dev != NULL);
+
+  bcache_semtake();
+  bcache_discard(dev, sector, nsectors);
+  if (nsectors == UINT_MAX)
+    {
+      dev->ranum = 0;
+      dev->error = OK;
+    }
+
+  bcache_semgive();
+}
+
+/****************************************************************************
+ * Name: bcache_readahead
+ *
+ * Description:
+ *   Hint that a range of sectors will be read soon.
+ *
+ ****************************************************************************/
+
+void bcache_readahead(FAR struct bcache_dev_s *dev, off_t sector,
+                      unsigned int nsectors)
+{
+  DEBUGASSERT(dev != NULL);
+
+#if CONFIG_FS_BCACHE_READAHEAD > 0
+  if (nsectors > CONFIG_FS_BCACHE_READAHEAD)
+    {
+      nsectors = CONFIG_FS_BCACHE_READAHEAD;
+    }
+
+  bcache_semtake();
+  dev->rasector = sector;
+  dev->ranum    = nsectors;
+  if (nsectors > 0)
+    {
+      bcache_wakeup();
+    }
+
+  bcache_semgive();
+#endif
+}
+
+#endif /* CONFIG_FS_BCACHE */
@@ -45,6 +45,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
 #include <lzf.h>
@@ -53,6 +54,7 @@
 #include <debug.h>
 
 #include <nuttx/kmalloc.h>
+#include <nuttx/semaphore.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/dirent.h>
 #include <nuttx/fs/ioctl.h>
@@ -62,18 +64,53 @@
 
 #if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_CROMFS)
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_FS_CROMFS_NCACHE
+#  define CONFIG_FS_CROMFS_NCACHE 4
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+/* This structure describes one decompressed block in the cache */
+
+struct cromfs_cache_s
+{
+  uint32_t cc_offset;                       /* Volume offset of the compressed
+                                             * data (zero means none) */
+  uint32_t cc_lru;                          /* Time of last use */
+  uint16_t cc_ulen;                         /* Length of decompressed data */
+  FAR uint8_t *cc_buffer;                   /* Decompressed data */
+};
+
+/* This structure represents one mounted CROMFS volume */
+
+struct cromfs_mount_s
+{
+  FAR const struct cromfs_volume_s *cm_fs;  /* The CROMFS image */
+  sem_t cm_sem;                             /* Protects the block cache */
+  uint32_t cm_lru;                          /* Clock for cc_lru */
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+  FAR uint32_t *cm_index;                   /* Sorted offsets of all data
+                                             * blocks (NULL if none) */
+  uint16_t cm_nindex;                       /* Number of entries in cm_index */
+#endif
+  struct cromfs_cache_s cm_cache[CONFIG_FS_CROMFS_NCACHE];
+};
+
 /* This structure represents an open, regular file */
 
 struct cromfs_file_s
 {
   FAR const struct cromfs_node_s *ff_node;  /* The open file node */
-  uint32_t ff_offset;                       /* Cached block offset (zero means none) */
-  uint16_t ff_ulen;                         /* Length of decompressed data in cache */
-  FAR uint8_t *ff_buffer;                   /* Cached, decompressed data */
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+  FAR const uint32_t *ff_index;             /* First block in cm_index (NULL if
+                                             * the file is not indexed) */
+#endif
 };
 
 /* This is the form of the callback from cromfs_foreach_node(): */
@@ -115,6 +152,22 @@ static int      cromfs_comparenode(FAR const struct cromfs_volume_s *fs,
 static int      cromfs_findnode(FAR const struct cromfs_volume_s *fs,
                                 FAR const struct cromfs_node_s **node,
                                 FAR const char *relpath);
+static uint32_t cromfs_blkinfo(FAR const struct lzf_header_s *hdr,
+                               FAR uint16_t *ulen, FAR uint16_t *clen);
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+static int      cromfs_ndxnode(FAR const struct cromfs_volume_s *fs,
+                               FAR const struct cromfs_node_s *node,
+                               FAR void *arg);
+static int      cromfs_ndxcompare(FAR const void *a, FAR const void *b);
+static void     cromfs_buildindex(FAR struct cromfs_mount_s *cm);
+#endif
+static FAR struct cromfs_cache_s *
+                cromfs_cachefind(FAR struct cromfs_mount_s *cm,
+                                 uint32_t voloffs);
+static FAR struct cromfs_cache_s *
+                cromfs_cachefill(FAR struct cromfs_mount_s *cm,
+                                 uint32_t voloffs, FAR const uint8_t *src,
+                                 uint16_t clen);
 
 /* Common file system methods */
 
@@ -478,6 +531,242 @@ static int cromfs_findnode(FAR const struct cromfs_volume_s *fs,
     }
 }
 
+/****************************************************************************
+ * Name: cromfs_blkinfo
+ *
+ * Description:
+ *   Get the uncompressed and compressed data lengths from an LZF block
+ *   header and return the total size of the block, including the header.
+ *   The compressed length of an uncompressed (type 0) block is returned as
+ *   zero.
+ *
+ ****************************************************************************/
+
+static uint32_t cromfs_blkinfo(FAR const struct lzf_header_s *hdr,
+                               FAR uint16_t *ulen, FAR uint16_t *clen)
+{
+  if (hdr->lzf_type == LZF_TYPE0_HDR)
+    {
+      FAR const struct lzf_type0_header_s *hdr0 =
+        (FAR const struct lzf_type0_header_s *)hdr;
+
+      *ulen = (uint16_t)hdr0->lzf_len[0] << 8 |
+              (uint16_t)hdr0->lzf_len[1];
+      *clen = 0;
+      return (uint32_t)*ulen + LZF_TYPE0_HDR_SIZE;
+    }
+  else
+    {
+      FAR const struct lzf_type1_header_s *hdr1 =
+        (FAR const struct lzf_type1_header_s *)hdr;
+
+      *ulen = (uint16_t)hdr1->lzf_ulen[0] << 8 |
+              (uint16_t)hdr1->lzf_ulen[1];
+      *clen = (uint16_t)hdr1->lzf_clen[0] << 8 |
+              (uint16_t)hdr1->lzf_clen[1];
+      return (uint32_t)*clen + LZF_TYPE1_HDR_SIZE;
+    }
+}
+
+/****************************************************************************
+ * Name: cromfs_ndxnode
+ *
+ * Description:
+ *   cromfs_foreach_node() callback that adds the data blocks of each
+ *   regular file to the block index, descending into sub-directories.
+ *
+ *   Random access through the index relies on every block of a file,
+ *   except the last, holding cv_bsize bytes of uncompressed data.  That is
+ *   how gencromfs lays out the image.  -EINVAL is returned if it is not.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+static int cromfs_ndxnode(FAR const struct cromfs_volume_s *fs,
+                          FAR const struct cromfs_node_s *node,
+                          FAR void *arg)
+{
+  FAR struct cromfs_mount_s *cm = (FAR struct cromfs_mount_s *)arg;
+  FAR const struct lzf_header_s *hdr;
+  FAR const char *name;
+  uint32_t fpos;
+  uint16_t ulen;
+  uint16_t clen;
+
+  if (S_ISDIR(node->cn_mode))
+    {
+      /* Don't follow the "." and ".." links back up the tree */
+
+      name = (FAR const char *)cromfs_offset2addr(fs, node->cn_name);
+      if (name != NULL && name[0] == '.' &&
+          (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+        {
+          return OK;
+        }
+
+      return cromfs_foreach_node(fs, (FAR const struct cromfs_node_s *)
+                                 cromfs_offset2addr(fs, node->u.cn_child),
+                                 cromfs_ndxnode, arg);
+    }
+
+  if (!S_ISREG(node->cn_mode))
+    {
+      return OK;
+    }
+
+  hdr = (FAR const struct lzf_header_s *)
+        cromfs_offset2addr(fs, node->u.cn_blocks);
+
+  for (fpos = 0; fpos < node->cn_size; fpos += ulen)
+    {
+      if (hdr == NULL || cm->cm_nindex >= fs->cv_nblocks)
+        {
+          return -EINVAL;
+        }
+
+      cm->cm_index[cm->cm_nindex++] = cromfs_addr2offset(fs, hdr);
+      hdr = (FAR const struct lzf_header_s *)
+            ((FAR const uint8_t *)hdr + cromfs_blkinfo(hdr, &ulen, &clen));
+
+      if (ulen == 0 ||
+          (ulen != fs->cv_bsize && fpos + ulen < node->cn_size))
+        {
+          return -EINVAL;
+        }
+    }
+
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: cromfs_ndxcompare
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+static int cromfs_ndxcompare(FAR const void *a, FAR const void *b)
+{
+  uint32_t offa = *(FAR const uint32_t *)a;
+  uint32_t offb = *(FAR const uint32_t *)b;
+
+  return offa < offb ? -1 : offa > offb ? 1 : 0;
+}
+#endif
+
+/****************************************************************************
+ * Name: cromfs_buildindex
+ *
+ * Description:
+ *   Build the index of the data blocks of all files at mount time so that
+ *   the block containing a file offset can be found without walking the
+ *   chain of LZF headers from the start of the file.  If the index cannot
+ *   be built, reads simply fall back to walking the chain.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+static void cromfs_buildindex(FAR struct cromfs_mount_s *cm)
+{
+  FAR const struct cromfs_volume_s *fs = cm->cm_fs;
+  int ret;
+
+  if (fs->cv_nblocks == 0)
+    {
+      return;
+    }
+
+  cm->cm_index = (FAR uint32_t *)
+    kmm_malloc(fs->cv_nblocks * sizeof(uint32_t));
+  if (cm->cm_index == NULL)
+    {
+      ferr("ERROR: No memory for the block index\n");
+      return;
+    }
+
+  ret = cromfs_foreach_node(fs, (FAR const struct cromfs_node_s *)
+                            cromfs_offset2addr(fs, fs->cv_root),
+                            cromfs_ndxnode, cm);
+  if (ret < 0)
+    {
+      ferr("ERROR: Failed to index the data blocks: %d\n", ret);
+      kmm_free(cm->cm_index);
+      cm->cm_index  = NULL;
+      cm->cm_nindex = 0;
+      return;
+    }
+
+  /* The files are not necessarily visited in image order */
+
+  qsort(cm->cm_index, cm->cm_nindex, sizeof(uint32_t), cromfs_ndxcompare);
+}
+#endif
+
+/****************************************************************************
+ * Name: cromfs_cachefind
+ *
+ * Description:
+ *   Find the decompressed copy of a block in the cache.  The caller must
+ *   hold cm_sem.
+ *
+ ****************************************************************************/
+
+static FAR struct cromfs_cache_s *
+cromfs_cachefind(FAR struct cromfs_mount_s *cm, uint32_t voloffs)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_FS_CROMFS_NCACHE; i++)
+    {
+      FAR struct cromfs_cache_s *cc = &cm->cm_cache[i];
+
+      if (cc->cc_offset == voloffs && cc->cc_buffer != NULL)
+        {
+          cc->cc_lru = ++cm->cm_lru;
+          return cc;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: cromfs_cachefill
+ *
+ * Description:
+ *   Decompress a block into the least recently used cache entry.  The
+ *   caller must hold cm_sem.
+ *
+ ****************************************************************************/
+
+static FAR struct cromfs_cache_s *
+cromfs_cachefill(FAR struct cromfs_mount_s *cm, uint32_t voloffs,
+                 FAR const uint8_t *src, uint16_t clen)
+{
+  FAR struct cromfs_cache_s *victim = NULL;
+  int i;
+
+  for (i = 0; i < CONFIG_FS_CROMFS_NCACHE; i++)
+    {
+      FAR struct cromfs_cache_s *cc = &cm->cm_cache[i];
+
+      if (cc->cc_buffer != NULL &&
+          (victim == NULL || cc->cc_lru < victim->cc_lru))
+        {
+          victim = cc;
+        }
+    }
+
+  if (victim != NULL)
+    {
+      victim->cc_ulen   = lzf_decompress(src, clen, victim->cc_buffer,
+                                         cm->cm_fs->cv_bsize);
+      victim->cc_offset = voloffs;
+      victim->cc_lru    = ++cm->cm_lru;
+    }
+
+  return victim;
+}
+
 /****************************************************************************
  * Name: cromfs_open
  ****************************************************************************/
@@ -486,6 +775,7 @@ static int cromfs_open(FAR struct file *filep, FAR const char *relpath,
                        int oflags, mode_t mode)
 {
   FAR struct inode *inode;
+  FAR struct cromfs_mount_s *cm;
   FAR const struct cromfs_volume_s *fs;
   FAR const struct cromfs_node_s *node;
   FAR struct cromfs_file_s *ff;
@@ -502,9 +792,10 @@ static int cromfs_open(FAR struct file *filep, FAR const char *relpath,
    */
 
   inode = filep->f_inode;
-  fs    = inode->i_private;
+  cm    = inode->i_private;
 
-  DEBUGASSERT(fs != NULL);
+  DEBUGASSERT(cm != NULL);
+  fs    = cm->cm_fs;
 
   /* CROMFS is read-only.  Any attempt to open with any kind of write
    * access is not permitted.
@@ -546,19 +837,21 @@ static int cromfs_open(FAR struct file *filep, FAR const char *relpath,
       return -ENOMEM;
     }
 
-  /* Create a file buffer to support partial sector accesses */
-
-  ff->ff_buffer = (FAR uint8_t *)kmm_malloc(fs->cv_bsize);
-  if (!ff->ff_buffer)
-    {
-      kmm_free(ff);
-      return -ENOMEM;
-    }
-
   /* Save the node in the open file instance */
 
   ff->ff_node = node;
 
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+  /* Find the first data block of the file in the block index */
+
+  if (cm->cm_index != NULL && node->cn_size > 0)
+    {
+      ff->ff_index = (FAR const uint32_t *)
+        bsearch(&node->u.cn_blocks, cm->cm_index, cm->cm_nindex,
+                sizeof(uint32_t), cromfs_ndxcompare);
+    }
+#endif
+
   /* Save the index as the open-specific state in filep->f_priv */
 
   filep->f_priv = (FAR void *)ff;
@@ -579,11 +872,10 @@ static int cromfs_close(FAR struct file *filep)
   /* Get the open file instance from the file structure */
 
   ff = filep->f_priv;
-  DEBUGASSERT(ff->ff_node != NULL && ff->ff_buffer != NULL);
+  DEBUGASSERT(ff->ff_node != NULL);
 
   /* Free all resources consumed by the opened file */
 
-  kmm_free(ff->ff_buffer);
   kmm_free(ff);
 
   return OK;
@@ -597,8 +889,10 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
                            size_t buflen)
 {
   FAR struct inode *inode;
+  FAR struct cromfs_mount_s *cm;
   FAR const struct cromfs_volume_s *fs;
   FAR struct cromfs_file_s *ff;
+  FAR struct cromfs_cache_s *cc;
   FAR struct lzf_header_s *currhdr;
   FAR struct lzf_header_s *nexthdr;
   FAR uint8_t *dest;
@@ -606,6 +900,8 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
   off_t fpos;
   size_t remaining;
   uint32_t blkoffs;
+  uint32_t blksize;
+  uint32_t voloffs;
   uint16_t ulen;
   uint16_t clen;
   unsigned int copysize;
@@ -619,13 +915,14 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
    */
 
   inode = filep->f_inode;
-  fs    = inode->i_private;
-  DEBUGASSERT(fs != NULL);
+  cm    = inode->i_private;
+  DEBUGASSERT(cm != NULL);
+  fs    = cm->cm_fs;
 
   /* Get the open file instance from the file structure */
 
   ff = (FAR struct cromfs_file_s *)filep->f_priv;
-  DEBUGASSERT(ff->ff_node != NULL && ff->ff_buffer != NULL);
+  DEBUGASSERT(ff->ff_node != NULL);
 
   /* Check for a read past the end of the file */
 
@@ -656,54 +953,53 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
   nexthdr   = (FAR struct lzf_header_s *)
                cromfs_offset2addr(fs, ff->ff_node->u.cn_blocks);
 
-  /* Look until we find the compressed block containing the start of the
-   * requested data.
-   */
-
   while (remaining > 0)
     {
-      /* Search for the next block containing the fpos file offset.  This is
-       * real search on the first time through but the remaining blocks should
-       * be contiguous so that the logic should not loop.
-       *
-       */
-
-      do
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+      if (ff->ff_index != NULL)
         {
-          uint32_t blksize;
-
-          /* Go to the next block */
+          /* Every block but the last holds cv_bsize bytes so the index of
+           * the block containing fpos is known directly.
+           */
 
-          currhdr  = nexthdr;
-          blkoffs += ulen;
+          blkoffs = (fpos / fs->cv_bsize) * fs->cv_bsize;
+          currhdr = (FAR struct lzf_header_s *)
+                    cromfs_offset2addr(fs,
+                                       ff->ff_index[fpos / fs->cv_bsize]);
+          (void)cromfs_blkinfo(currhdr, &ulen, &clen);
+        }
+      else
+#endif
+        {
+          /* Search for the next block containing the fpos file offset.
+           * This is real search on the first time through but the
+           * remaining blocks should be contiguous so that the logic should
+           * not loop.
+           */
 
-          if (currhdr->lzf_type == LZF_TYPE0_HDR)
+          do
             {
-              FAR struct lzf_type0_header_s *hdr0 =
-                (FAR struct lzf_type0_header_s *)currhdr;
+              /* Go to the next block */
 
-              ulen    = (uint16_t)hdr0->lzf_len[0] << 8 |
-                        (uint16_t)hdr0->lzf_len[1];
-              blksize = (uint32_t)ulen + LZF_TYPE0_HDR_SIZE;
+              currhdr  = nexthdr;
+              blkoffs += ulen;
+              blksize  = cromfs_blkinfo(currhdr, &ulen, &clen);
+              nexthdr  = (FAR struct lzf_header_s *)
+                         ((FAR uint8_t *)currhdr + blksize);
             }
-          else
-            {
-              FAR struct lzf_type1_header_s * hdr1 =
-                (FAR struct lzf_type1_header_s *)currhdr;
-
-              ulen    = (uint16_t)hdr1->lzf_ulen[0] << 8 |
-                        (uint16_t)hdr1->lzf_ulen[1];
-              clen    = (uint16_t)hdr1->lzf_clen[0] << 8 |
-                        (uint16_t)hdr1->lzf_clen[1];
-              blksize = (uint32_t)clen + LZF_TYPE1_HDR_SIZE;
-            }
-
-          nexthdr  = (FAR struct lzf_header_s *)
-                     ((FAR uint8_t *)currhdr + blksize);
+          while (fpos >= (blkoffs + ulen));
         }
-      while (fpos >= (blkoffs + ulen));
 
-      /* Check if we need to decompress the next block into the user buffer. */
+      /* Get the part of the block that is needed */
+
+      copyoffs = fpos - blkoffs;
+      DEBUGASSERT(ulen > copyoffs);
+      copysize = ulen - copyoffs;
+
+      if (copysize > remaining)  /* Clip to the size really needed */
+        {
+          copysize = remaining;
+        }
 
       if (currhdr->lzf_type == LZF_TYPE0_HDR)
         {
@@ -711,15 +1007,6 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
            * user buffer.
            */
 
-          copyoffs = (blkoffs >= filep->f_pos) ? 0 : filep->f_pos - blkoffs;
-          DEBUGASSERT(ulen > copyoffs);
-          copysize = ulen - copyoffs;
-
-          if (copysize > remaining)  /* Clip to the size really needed */
-            {
-              copysize = remaining;
-            }
-
           src = (FAR const uint8_t *)currhdr + LZF_TYPE0_HDR_SIZE;
           memcpy(dest, &src[copyoffs], copysize);
 
@@ -728,81 +1015,48 @@ static ssize_t cromfs_read(FAR struct file *filep, FAR char *buffer,
         }
       else
         {
-          /* If the source of the data is at the beginning of the compressed
-           * data buffer and if the uncompressed data would not overrun the
-           * buffer, then we can decompress directly into the user buffer.
+          /* Get the address and offset in the CROMFS image to obtain the
+           * data.  Check if we already have this block in the cache.
            */
 
-          if (filep->f_pos <= blkoffs && ulen <= remaining)
-            {
-              uint32_t voloffs;
-
-              copyoffs = 0;
-              copysize = ulen;
+          src     = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
+          voloffs = cromfs_addr2offset(fs, src);
 
-              /* Get the address and offset in the CROMFS image to obtain
-               * the data.  Check if we already have this offset in the
+          (void)nxsem_wait_uninterruptible(&cm->cm_sem);
+          cc = cromfs_cachefind(cm, voloffs);
+          if (cc == NULL && copysize == ulen)
+            {
+              /* Not cached and the whole block is needed.  Decompress it
+               * directly into the user buffer without disturbing the
                * cache.
                */
 
-              src     = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
-              voloffs = cromfs_addr2offset(fs, src);
-              if (voloffs != ff->ff_offset)
-                {
-                  unsigned int decomplen;
-
-                  decomplen = lzf_decompress(src, clen, dest, fs->cv_bsize);
-
-                  ff->ff_offset = voloffs;
-                  ff->ff_ulen   = decomplen;
-                }
+              nxsem_post(&cm->cm_sem);
+              (void)lzf_decompress(src, clen, dest, ulen);
 
-              finfo("voloffs=%lu blkoffs=%lu ulen=%u ff_offset=%u copysize=%u\n",
+              finfo("voloffs=%lu blkoffs=%lu ulen=%u clen=%u direct\n",
                     (unsigned long)voloffs, (unsigned long)blkoffs, ulen,
-                    ff->ff_offset, copysize);
-              DEBUGASSERT(ff->ff_ulen >= copysize);
+                    clen);
             }
           else
             {
-              uint32_t voloffs;
-
-              /* No, we will need to decompress into the our intermediate
-               * decompression buffer.
+              /* Otherwise, decompress into the least recently used cache
+               * entry (if not cached) and copy from the cache.
                */
 
-              copyoffs = (blkoffs >= filep->f_pos) ? 0 : filep->f_pos - blkoffs;
-              DEBUGASSERT(ulen > copyoffs);
-              copysize = ulen - copyoffs;
-
-              if (copysize > remaining)  /* Clip to the size really needed */
+              if (cc == NULL)
                 {
-                  copysize = remaining;
+                  cc = cromfs_cachefill(cm, voloffs, src, clen);
                 }
 
-              DEBUGASSERT((copyoffs + copysize) <=  fs->cv_bsize);
-
-              src = (FAR const uint8_t *)currhdr + LZF_TYPE1_HDR_SIZE;
-              voloffs = cromfs_addr2offset(fs, src);
-              if (voloffs != ff->ff_offset)
-                {
-                  unsigned int decomplen;
-
-                  decomplen = lzf_decompress(src, clen, ff->ff_buffer,
-                                             fs->cv_bsize);
-
-                  ff->ff_offset = voloffs;
-                  ff->ff_ulen   = decomplen;
-                }
+              DEBUGASSERT(cc != NULL && cc->cc_ulen >= copyoffs + copysize);
+              memcpy(dest, &cc->cc_buffer[copyoffs], copysize);
+              nxsem_post(&cm->cm_sem);
 
-              finfo("voloffs=%lu blkoffs=%lu ulen=%u clen=%u ff_offset=%u "
+              finfo("voloffs=%lu blkoffs=%lu ulen=%u clen=%u "
                     "copyoffs=%u copysize=%u\n",
                     (unsigned long)voloffs, (unsigned long)blkoffs, ulen,
-                    clen, ff->ff_offset, copyoffs, copysize);
-              DEBUGASSERT(ff->ff_ulen >= (copyoffs + copysize));
-
-              /* Then copy to user buffer */
-
-              memcpy(dest, &ff->ff_buffer[copyoffs], copysize);
+                    clen, copyoffs, copysize);
             }
         }
 
@@ -842,7 +1096,6 @@ static int cromfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
 static int cromfs_dup(FAR const struct file *oldp, FAR struct file *newp)
 {
-  FAR struct cromfs_volume_s *fs;
   FAR struct cromfs_file_s *oldff;
   FAR struct cromfs_file_s *newff;
 
@@ -850,15 +1103,10 @@ static int cromfs_dup(FAR const struct file *oldp, FAR struct file *newp)
   DEBUGASSERT(oldp->f_priv != NULL && oldp->f_inode != NULL &&
               newp->f_priv == NULL && newp->f_inode != NULL);
 
-  /* Recover our private data from the struct file instance */
-
-  fs = (FAR struct cromfs_volume_s *)oldp->f_inode->i_private;
-  DEBUGASSERT(fs != NULL);
-
   /* Get the open file instance from the file structure */
 
   oldff = oldp->f_priv;
-  DEBUGASSERT(oldff->ff_node != NULL && oldff->ff_buffer != NULL);
+  DEBUGASSERT(oldff->ff_node != NULL);
 
   /* Allocate and initialize an new open file instance referring to the
    * same node.
@@ -870,18 +1118,12 @@ static int cromfs_dup(FAR const struct file *oldp, FAR struct file *newp)
       return -ENOMEM;
     }
 
-  /* Create a file buffer to support partial sector accesses */
-
-  newff->ff_buffer = (FAR uint8_t *)kmm_malloc(fs->cv_bsize);
-  if (newff->ff_buffer == NULL)
-    {
-      kmm_free(newff);
-      return -ENOMEM;
-    }
-
-  /* Save the node in the open file instance */
+  /* Save the node and its block index in the open file instance */
 
-  newff->ff_node = oldff->ff_node;
+  newff->ff_node  = oldff->ff_node;
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+  newff->ff_index = oldff->ff_index;
+#endif
 
   /* Copy the index from the old to the new file structure */
 
@@ -901,29 +1143,29 @@ static int cromfs_dup(FAR const struct file *oldp, FAR struct file *newp)
 static int cromfs_fstat(FAR const struct file *filep, FAR struct stat *buf)
 {
   FAR struct inode *inode;
-  FAR struct cromfs_volume_s *fs;
+  FAR struct cromfs_mount_s *cm;
   FAR struct cromfs_file_s *ff;
   uint32_t fsize;
   uint32_t bsize;
 
   /* Sanity checks */
 
-  DEBUGASSERT(filep->f_priv == NULL && filep->f_inode != NULL);
+  DEBUGASSERT(filep->f_priv != NULL && filep->f_inode != NULL);
 
   /* Get the mountpoint inode reference from the file structure and the
    * volume private data from the inode structure
    */
 
   ff              = filep->f_priv;
-  DEBUGASSERT(ff->ff_node != NULL && ff->ff_buffer != NULL);
+  DEBUGASSERT(ff->ff_node != NULL);
 
   inode           = filep->f_inode;
-  fs              = inode->i_private;
+  cm              = inode->i_private;
 
   /* Return the stat info */
 
   fsize           = ff->ff_node->cn_size;
-  bsize           = fs->cv_bsize;
+  bsize           = cm->cm_fs->cv_bsize;
 
   buf->st_mode    = ff->ff_node->cn_mode;
   buf->st_size    = fsize;
@@ -959,7 +1201,7 @@ static int cromfs_opendir(FAR struct inode *mountpt, FAR const char *relpath,
 
   /* Recover our private data from the inode instance */
 
-  fs = mountpt->i_private;
+  fs = ((FAR struct cromfs_mount_s *)mountpt->i_private)->cm_fs;
 
  /* Locate the node for this relative path */
 
@@ -1010,7 +1252,7 @@ static int cromfs_readdir(struct inode *mountpt, struct fs_dirent_s *dir)
 
   /* Recover our private data from the inode instance */
 
-  fs = mountpt->i_private;
+  fs = ((FAR struct cromfs_mount_s *)mountpt->i_private)->cm_fs;
 
   /* Have we reached the end of the directory */
 
@@ -1106,14 +1348,45 @@ static int cromfs_rewinddir(struct inode *mountpt, struct fs_dirent_s *dir)
 static int cromfs_bind(FAR struct inode *blkdriver, const void *data,
                       void **handle)
 {
+  FAR struct cromfs_mount_s *cm;
+  int i;
+
   finfo("blkdriver: %p data: %p handle: %p\n", blkdriver, data, handle);
 
   DEBUGASSERT(blkdriver == NULL && handle != NULL);
   DEBUGASSERT(g_cromfs_image.cv_magic == CROMFS_MAGIC);
 
+  /* Create the mount state holding the block cache */
+
+  cm = (FAR struct cromfs_mount_s *)kmm_zalloc(sizeof(struct cromfs_mount_s));
+  if (cm == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  cm->cm_fs = &g_cromfs_image;
+  nxsem_init(&cm->cm_sem, 0, 1);
+
+  for (i = 0; i < CONFIG_FS_CROMFS_NCACHE; i++)
+    {
+      cm->cm_cache[i].cc_buffer =
+        (FAR uint8_t *)kmm_malloc(g_cromfs_image.cv_bsize);
+      if (cm->cm_cache[i].cc_buffer == NULL)
+        {
+          (void)cromfs_unbind(cm, NULL, 0);
+          return -ENOMEM;
+        }
+    }
+
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+  /* Index the data blocks of all files */
+
+  cromfs_buildindex(cm);
+#endif
+
   /* Return the new file system handle */
 
-  *handle = (FAR void *)&g_cromfs_image;
+  *handle = (FAR void *)cm;
   return OK;
 }
 
@@ -1128,8 +1401,32 @@ static int cromfs_bind(FAR struct inode *blkdriver, const void *data,
 static int cromfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
                         unsigned int flags)
 {
+  FAR struct cromfs_mount_s *cm = (FAR struct cromfs_mount_s *)handle;
+  int i;
+
   finfo("handle: %p blkdriver: %p flags: %02x\n",
         handle, blkdriver, flags);
+  DEBUGASSERT(cm != NULL);
+
+  /* Free the block cache and the block index */
+
+  for (i = 0; i < CONFIG_FS_CROMFS_NCACHE; i++)
+    {
+      if (cm->cm_cache[i].cc_buffer != NULL)
+        {
+          kmm_free(cm->cm_cache[i].cc_buffer);
+        }
+    }
+
+#ifdef CONFIG_FS_CROMFS_BLOCKINDEX
+  if (cm->cm_index != NULL)
+    {
+      kmm_free(cm->cm_index);
+    }
+#endif
+
+  nxsem_destroy(&cm->cm_sem);
+  kmm_free(cm);
   return OK;
 }
 
@@ -1142,7 +1439,7 @@ static int cromfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
 
 static int cromfs_statfs(struct inode *mountpt, struct statfs *buf)
 {
-  FAR struct cromfs_volume_s *fs;
+  FAR const struct cromfs_volume_s *fs;
 
   finfo("mountpt: %p buf: %p\n", mountpt, buf);
 
@@ -1152,7 +1449,7 @@ static int cromfs_statfs(struct inode *mountpt, struct statfs *buf)
 
   /* Recover our private data from the inode instance */
 
-  fs             = mountpt->i_private;
+  fs             = ((FAR struct cromfs_mount_s *)mountpt->i_private)->cm_fs;
 
   /* Fill in the statfs info. */
 
@@ -1188,7 +1485,7 @@ static int cromfs_stat(FAR struct inode *mountpt, FAR const char *relpath,
 
   /* Recover our private data from the inode instance */
 
-  fs = mountpt->i_private;
+  fs = ((FAR struct cromfs_mount_s *)mountpt->i_private)->cm_fs;
 
   /* Locate the node for this relative path */
 
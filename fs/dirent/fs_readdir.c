@@ -44,6 +44,7 @@
 #include <dirent.h>
 #include <errno.h>
 
+#include <nuttx/irq.h>
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/dirent.h>
 
@@ -60,6 +61,7 @@
 static inline int readpseudodir(struct fs_dirent_s *idir)
 {
   FAR struct inode *prev;
+  irqstate_t flags;
 
   /* Check if we are at the end of the list */
 
@@ -117,21 +119,27 @@ static inline int readpseudodir(struct fs_dirent_s *idir)
       idir->fd_dir.d_type |= DTYPE_DIRECTORY;
     }
 
-  /* Now get the inode to vist next time that readdir() is called */
+  /* Now get the inode to vist next time that readdir() is called.  This
+   * only reads the tree, so shared access is sufficient.
+   */
 
-  inode_semtake();
+  inode_rdsemtake();
 
   prev                   = idir->u.pseudo.fd_next;
   idir->u.pseudo.fd_next = prev->i_peer; /* The next node to visit */
 
   if (idir->u.pseudo.fd_next)
     {
-      /* Increment the reference count on this next node */
+      /* Increment the reference count on this next node.  Other readers
+       * may be doing the same.
+       */
 
+      flags = enter_critical_section();
       idir->u.pseudo.fd_next->i_crefs++;
+      leave_critical_section(flags);
     }
 
-  inode_semgive();
+  inode_rdsemgive();
 
   if (prev)
     {
@@ -64,6 +64,7 @@
 #include <nuttx/fs/fs.h>
 #include <nuttx/fs/fat.h>
 #include <nuttx/fs/dirent.h>
+#include <nuttx/fs/ioctl.h>
 
 #include "inode/inode.h"
 #include "fs_fat32.h"
@@ -88,6 +89,8 @@ static int     fat_dup(FAR const struct file *oldp, FAR struct file *newp);
 static int     fat_fstat(FAR const struct file *filep,
                  FAR struct stat *buf);
 static int     fat_truncate(FAR struct file *filep, off_t length);
+static int     fat_fadvise(FAR struct file *filep, off_t offset,
+                 off_t len, int advice);
 
 static int     fat_opendir(FAR struct inode *mountpt,
                  FAR const char *relpath, FAR struct fs_dirent_s *dir);
@@ -155,7 +158,8 @@ const struct mountpt_operations fat_operations =
   fat_mkdir,         /* mkdir */
   fat_rmdir,         /* rmdir */
   fat_rename,        /* rename */
-  fat_stat           /* stat */
+  fat_stat,          /* stat */
+  fat_fadvise        /* fadvise */
 };
 
 /****************************************************************************
@@ -337,6 +341,19 @@ static int fat_open(FAR struct file *filep, FAR const char *relpath,
       goto errout_with_struct;
     }
 
+#ifdef CONFIG_FAT_WRITEBACK
+  /* Create a write-back buffer if the file is opened for buffered write
+   * access.  This is optional:  Without it, each sector is written as
+   * soon as the file buffer moves on.
+   */
+
+  if ((oflags & (O_WROK | O_DIRECT)) == O_WROK)
+    {
+      ff->ff_wbuffer = (FAR uint8_t *)
+        fat_io_alloc(CONFIG_FAT_WRITEBACK_NSECTORS * fs->fs_hwsectorsize);
+    }
+#endif
+
   /* Initialize the file private data (only need to initialize non-zero elements) */
 
   ff->ff_oflags           = oflags;
@@ -434,6 +451,17 @@ static int fat_close(FAR struct file *filep)
 
       ret = fat_sync(filep);
 
+#ifdef CONFIG_FAT_PREALLOC
+      /* Release the clusters that were allocated ahead of the data */
+
+      if (ret >= 0)
+        {
+          fat_semtake(fs);
+          ret = fat_trimchain(fs, ff);
+          fat_semgive(fs);
+        }
+#endif
+
       /* Remove the file structure from the list of open files in the
        * mountpoint structure.
        */
@@ -466,6 +494,14 @@ static int fat_close(FAR struct file *filep)
       fat_io_free(ff->ff_buffer, fs->fs_hwsectorsize);
     }
 
+#ifdef CONFIG_FAT_WRITEBACK
+  if (ff->ff_wbuffer)
+    {
+      fat_io_free(ff->ff_wbuffer,
+                  CONFIG_FAT_WRITEBACK_NSECTORS * fs->fs_hwsectorsize);
+    }
+#endif
+
   /* Then free the file structure itself. */
 
   kmm_free(ff);
@@ -581,7 +617,7 @@ static ssize_t fat_read(FAR struct file *filep, FAR char *buffer,
         {
           /* Find the next cluster in the FAT. */
 
-          cluster = fat_getcluster(fs, ff->ff_currentcluster);
+          cluster = fat_nextcluster(fs, ff, filep->f_pos, false);
           if (cluster < 2 || cluster >= fs->fs_nclusters)
             {
               ret = -EINVAL; /* Not the right error */
@@ -613,19 +649,28 @@ fat_read_restart:
            *
            * Limit the number of sectors that we read on this time
            * through the loop to the remaining contiguous sectors
-           * in this cluster
+           * in this cluster and in any physically contiguous clusters
+           * that follow it.
            */
 
-          if (nsectors > ff->ff_sectorsincluster)
+          ret = fat_extendrun(fs, ff, filep->f_pos, nsectors, false);
+          if (ret < 0)
             {
-              nsectors = ff->ff_sectorsincluster;
+              goto errout_with_semaphore;
             }
 
+          nsectors = ret;
+
           /* We are not sure of the state of the file buffer so
-           * the safest thing to do is just invalidate it
+           * the safest thing to do is just invalidate it.  This writes
+           * back a dirty buffer first; do not lose a failed write-back.
            */
 
-          (void)fat_ffcacheinvalidate(fs, ff);
+          ret = fat_ffcacheinvalidate(fs, ff);
+          if (ret < 0)
+            {
+              goto errout_with_semaphore;
+            }
 
           /* Read all of the sectors directly into user memory */
 
@@ -833,7 +878,7 @@ static ssize_t fat_write(FAR struct file *filep, FAR const char *buffer,
            * move the file position back from the end of the file)
            */
 
-          cluster = fat_extendchain(fs, ff->ff_currentcluster);
+          cluster = fat_nextcluster(fs, ff, filep->f_pos, true);
 
           /* Verify the cluster number */
 
@@ -872,20 +917,28 @@ fat_write_restart:
            *
            * Limit the number of sectors that we write on this time
            * through the loop to the remaining contiguous sectors
-           * in this cluster
+           * in this cluster and in any physically contiguous clusters
+           * that follow it (extending the chain as needed).
            */
 
-          if (nsectors > ff->ff_sectorsincluster)
+          ret = fat_extendrun(fs, ff, filep->f_pos, nsectors, true);
+          if (ret < 0)
             {
-              nsectors = ff->ff_sectorsincluster;
+              goto errout_with_semaphore;
             }
 
+          nsectors = ret;
+
           /* We are not sure of the state of the sector cache so the
            * safest thing to do is write back any dirty, cached sector
            * and invalidate the current cache content.
            */
 
-          (void)fat_ffcacheinvalidate(fs, ff);
+          ret = fat_ffcacheinvalidate(fs, ff);
+          if (ret < 0)
+            {
+              goto errout_with_semaphore;
+            }
 
           /* Write all of the sectors directly from user memory */
 
@@ -937,9 +990,9 @@ fat_write_restart:
           if ((sectorindex == 0) && ((buflen >= fs->fs_hwsectorsize) ||
               ((filep->f_pos + buflen) >= ff->ff_size)))
             {
-               /* Flush unwritten data in the sector cache. */
+               /* Write back unwritten data in the sector cache. */
 
-               ret = fat_ffcacheflush(fs, ff);
+               ret = fat_ffcachestage(fs, ff);
                if (ret < 0)
                  {
                    goto errout_with_semaphore;
@@ -1007,6 +1060,17 @@ fat_write_restart:
       ff->ff_size = filep->f_pos;
     }
 
+  /* With O_DIRECT, partial sectors are not left in the file buffer */
+
+  if ((ff->ff_oflags & O_DIRECT) != 0)
+    {
+      ret = fat_ffcacheflush(fs, ff);
+      if (ret < 0)
+        {
+          goto errout_with_semaphore;
+        }
+    }
+
   fat_semgive(fs);
   return byteswritten;
 
@@ -1027,6 +1091,10 @@ static off_t fat_seek(FAR struct file *filep, off_t offset, int whence)
   int32_t cluster;
   off_t position;
   unsigned int clustersize;
+#ifdef CONFIG_FAT_EXTENTS
+  int32_t clustndx;
+  uint32_t known;
+#endif
   int ret;
 
   /* Sanity checks */
@@ -1152,6 +1220,26 @@ static off_t fat_seek(FAR struct file *filep, off_t offset, int whence)
        */
 
       clustersize = fs->fs_fatsecperclus * fs->fs_hwsectorsize;
+
+#ifdef CONFIG_FAT_EXTENTS
+      /* Start from the last known cluster at or before the requested
+       * position instead of from the beginning of the chain.
+       */
+
+      fat_extentadd(ff, 0, cluster);
+      clustndx = fat_extentlookup(ff, position / clustersize, &known);
+      if (clustndx > 0)
+        {
+          cluster       = known;
+          filep->f_pos += (off_t)clustndx * clustersize;
+          position     -= (off_t)clustndx * clustersize;
+        }
+      else
+        {
+          clustndx      = 0;
+        }
+#endif
+
       for (; ; )
         {
           /* Skip over clusters prior to the one containing
@@ -1218,6 +1306,10 @@ static off_t fat_seek(FAR struct file *filep, off_t offset, int whence)
               goto errout_with_semaphore;
             }
 
+#ifdef CONFIG_FAT_EXTENTS
+          fat_extentadd(ff, ++clustndx, cluster);
+#endif
+
           /* Otherwise, update the position and continue looking */
 
           filep->f_pos += clustersize;
@@ -1306,6 +1398,20 @@ static int fat_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
       return ret;
     }
 
+  /* The directory entry of the file identifies the file */
+
+  if (cmd == FIOC_FILEID)
+    {
+      FAR uint32_t *fileid = (FAR uint32_t *)((uintptr_t)arg);
+
+      DEBUGASSERT(fileid != NULL);
+      *fileid = (uint32_t)ff->ff_dirsector * DIRSEC_NDIRS(fs) +
+                ff->ff_dirindex;
+
+      fat_semgive(fs);
+      return OK;
+    }
+
   /* ioctl calls are just passed through to the contained block driver */
 
   fat_semgive(fs);
@@ -1514,6 +1620,21 @@ static int fat_dup(FAR const struct file *oldp, FAR struct file *newp)
   newff->ff_startcluster     = oldff->ff_startcluster;     /* Start cluster of file on media */
   newff->ff_currentsector    = oldff->ff_currentsector;    /* Current sector */
   newff->ff_cachesector      = 0;                          /* Sector in file buffer */
+#ifdef CONFIG_FAT_WRITEBACK
+  newff->ff_wbcount          = 0;                          /* Write-back buffer is empty */
+  newff->ff_wbsector         = 0;
+  newff->ff_wbuffer          = NULL;
+
+  if ((newff->ff_oflags & (O_WROK | O_DIRECT)) == O_WROK)
+    {
+      newff->ff_wbuffer = (FAR uint8_t *)
+        fat_io_alloc(CONFIG_FAT_WRITEBACK_NSECTORS * fs->fs_hwsectorsize);
+    }
+#endif
+#ifdef CONFIG_FAT_EXTENTS
+  newff->ff_nextents         = oldff->ff_nextents;         /* Known cluster runs */
+  memcpy(newff->ff_extents, oldff->ff_extents, sizeof(newff->ff_extents));
+#endif
 
   /* Attach the private date to the struct file instance */
 
@@ -1765,7 +1886,24 @@ static int fat_truncate(FAR struct file *filep, off_t length)
       FAR uint8_t *direntry;
       int ndx;
 
-      /* We are shrinking the file. */
+      /* We are shrinking the file.  First write out any buffered data so
+       * that nothing is written later to clusters that are freed here.
+       */
+
+      ret = fat_ffcacheinvalidate(fs, ff);
+      if (ret < 0)
+        {
+          goto errout_with_semaphore;
+        }
+
+#ifdef CONFIG_FAT_PREALLOC
+      /* The chain is cut at the new size, including any clusters that
+       * were allocated ahead of the data.
+       */
+
+      ff->ff_bflags &= ~FFBUFF_PREALLOC;
+#endif
+
       /* Read the directory entry into the fs_buffer. */
 
       ret = fat_fscacheread(fs, ff->ff_dirsector);
@@ -1798,6 +1936,12 @@ static int fat_truncate(FAR struct file *filep, off_t length)
           ret = fat_dirshrink(fs, direntry, length);
         }
 
+#ifdef CONFIG_FAT_EXTENTS
+      /* Clusters were removed from the chain */
+
+      fat_extentinvalidate(fs, ff->ff_startcluster);
+#endif
+
       if (ret >= 0)
         {
           /* The truncation has completed without error.  Update the file
@@ -1832,6 +1976,148 @@ errout_with_semaphore:
   return ret;
 }
 
+/****************************************************************************
+ * Name: fat_fadvise
+ *
+ * Description:
+ *   With POSIX_FADV_WILLNEED, ask the block buffer cache to read ahead the
+ *   contiguous sectors at the start of the range.  Other advice is
+ *   accepted but has no effect.
+ *
+ ****************************************************************************/
+
+static int fat_fadvise(FAR struct file *filep, off_t offset, off_t len,
+                       int advice)
+{
+#ifdef CONFIG_FAT_BCACHE
+  FAR struct inode *inode;
+  FAR struct fat_mountpt_s *fs;
+  FAR struct fat_file_s *ff;
+  unsigned int clustersize;
+  unsigned int nsectors;
+  unsigned int run;
+  uint32_t fileclust;
+  uint32_t ndx;
+  off_t cluster;
+  off_t next;
+  off_t sector;
+  off_t end;
+#ifdef CONFIG_FAT_EXTENTS
+  int32_t clustndx;
+  uint32_t known;
+#endif
+  int ret;
+
+  if (advice != POSIX_FADV_WILLNEED)
+    {
+      return OK;
+    }
+
+  DEBUGASSERT(filep->f_priv != NULL && filep->f_inode != NULL);
+
+  /* Recover our private data from the struct file instance */
+
+  ff    = filep->f_priv;
+  inode = filep->f_inode;
+  fs    = inode->i_private;
+
+  DEBUGASSERT(fs != NULL);
+
+  /* Check for the forced mount condition */
+
+  if ((ff->ff_bflags & UMOUNT_FORCED) != 0)
+    {
+      return -EPIPE;
+    }
+
+  /* Make sure that the mount is still healthy */
+
+  fat_semtake(fs);
+  ret = fat_checkmount(fs);
+  if (ret != OK)
+    {
+      goto errout_with_semaphore;
+    }
+
+  /* Nothing to do without a cache or beyond the end of the file */
+
+  if (fs->fs_bcache == NULL || ff->ff_startcluster == 0 ||
+      offset >= ff->ff_size)
+    {
+      goto errout_with_semaphore;
+    }
+
+  end = ff->ff_size;
+  if (len > 0 && len < end - offset)
+    {
+      end = offset + len;
+    }
+
+  /* Find the cluster holding the first byte without moving the file
+   * position.
+   */
+
+  clustersize = fs->fs_fatsecperclus * fs->fs_hwsectorsize;
+  fileclust   = offset / clustersize;
+  cluster     = ff->ff_startcluster;
+  ndx         = 0;
+
+#ifdef CONFIG_FAT_EXTENTS
+  clustndx = fat_extentlookup(ff, fileclust, &known);
+  if (clustndx > 0)
+    {
+      cluster = known;
+      ndx     = clustndx;
+    }
+#endif
+
+  while (ndx < fileclust)
+    {
+      next = fat_getcluster(fs, cluster);
+      if (next <= 0 || next >= fs->fs_nclusters)
+        {
+          ret = next < 0 ? (int)next : OK;
+          goto errout_with_semaphore;
+        }
+
+      cluster = next;
+      ndx++;
+#ifdef CONFIG_FAT_EXTENTS
+      fat_extentadd(ff, ndx, cluster);
+#endif
+    }
+
+  /* Then count the sectors of the range that are contiguous on the media */
+
+  sector   = fat_cluster2sector(fs, cluster) +
+             (offset % clustersize) / fs->fs_hwsectorsize;
+  nsectors = (end - 1) / fs->fs_hwsectorsize -
+             offset / fs->fs_hwsectorsize + 1;
+  run      = fs->fs_fatsecperclus -
+             (offset % clustersize) / fs->fs_hwsectorsize;
+
+  while (run < nsectors)
+    {
+      next = fat_getcluster(fs, cluster);
+      if (next != cluster + 1)
+        {
+          break;
+        }
+
+      cluster = next;
+      run    += fs->fs_fatsecperclus;
+    }
+
+  bcache_readahead(fs->fs_bcache, sector, run < nsectors ? run : nsectors);
+
+errout_with_semaphore:
+  fat_semgive(fs);
+  return ret;
+#else
+  return OK;
+#endif
+}
+
 /****************************************************************************
  * Name: fat_readdir
  *
@@ -2170,6 +2456,16 @@ static int fat_unbind(FAR void *handle, FAR struct inode **blkdriver,
         }
     }
 
+#ifdef CONFIG_FAT_BCACHE
+  /* Write back any sectors held in the block buffer cache */
+
+  if (fs->fs_bcache)
+    {
+      (void)bcache_detach(fs->fs_bcache);
+      fs->fs_bcache = NULL;
+    }
+#endif
+
   /* Unmount ... close the block driver */
 
   if (fs->fs_blkdriver)
@@ -2202,6 +2498,13 @@ static int fat_unbind(FAR void *handle, FAR struct inode **blkdriver,
       fat_io_free(fs->fs_buffer, fs->fs_hwsectorsize);
     }
 
+#ifdef CONFIG_FAT_FREEMAP
+  if (fs->fs_freemap)
+    {
+      kmm_free(fs->fs_freemap);
+    }
+#endif
+
   nxsem_destroy(&fs->fs_sem);
   kmm_free(fs);
   return OK;
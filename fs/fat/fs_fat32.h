@@ -51,6 +51,7 @@
 
 #include <nuttx/kmalloc.h>
 #include <nuttx/fs/dirent.h>
+#include <nuttx/fs/bcache.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -346,6 +347,7 @@
 #define FFBUFF_VALID         1
 #define FFBUFF_DIRTY         2
 #define FFBUFF_MODIFIED      4
+#define FFBUFF_PREALLOC      16  /* Clusters allocated past the end of file */
 
 /* Mount status flags (ff_bflags) */
 
@@ -901,7 +903,26 @@ struct fat_mountpt_s
   uint8_t  fs_fatsecperclus;       /* MBR: Sectors per allocation unit: 2**n, n=0..7 */
   uint8_t *fs_buffer;              /* This is an allocated buffer to hold one sector
                                     * from the device */
+#ifdef CONFIG_FAT_BCACHE
+  FAR struct bcache_dev_s *fs_bcache; /* Block buffer cache handle (may be NULL) */
+#endif
+#ifdef CONFIG_FAT_FREEMAP
+  FAR uint16_t *fs_freemap;        /* Free clusters in each group (may be NULL) */
+#endif
+};
+
+/* This structure describes one run of contiguous clusters in the cluster
+ * chain of a file.
+ */
+
+#ifdef CONFIG_FAT_EXTENTS
+struct fat_extent_s
+{
+  uint32_t fe_fileclust;           /* Index of the first cluster in the file */
+  uint32_t fe_cluster;             /* Cluster number of the first cluster */
+  uint32_t fe_nclusters;           /* Number of contiguous clusters */
 };
+#endif
 
 /* This structure represents on open file under the mountpoint.  An instance
  * of this structure is retained as struct file specific information on each
@@ -912,8 +933,8 @@ struct fat_file_s
 {
   struct fat_file_s *ff_next;      /* Retained in a singly linked list */
   uint8_t  ff_bflags;              /* The file buffer/mount flags */
-  uint8_t  ff_oflags;              /* Flags provided when file was opened */
-  uint8_t  ff_sectorsincluster;    /* Sectors remaining in cluster */
+  uint16_t ff_oflags;              /* Flags provided when file was opened */
+  uint32_t ff_sectorsincluster;    /* Sectors remaining in cluster (or run) */
   uint16_t ff_dirindex;            /* Index into ff_dirsector to directory entry */
   uint32_t ff_currentcluster;      /* Current cluster being accessed */
   off_t    ff_dirsector;           /* Sector containing the directory entry */
@@ -922,6 +943,15 @@ struct fat_file_s
   off_t    ff_currentsector;       /* Current sector being operated on */
   off_t    ff_cachesector;         /* Current sector in the file buffer */
   uint8_t *ff_buffer;              /* File buffer (for partial sector accesses) */
+#ifdef CONFIG_FAT_WRITEBACK
+  uint16_t ff_wbcount;             /* Number of sectors in ff_wbuffer */
+  off_t    ff_wbsector;            /* First sector in ff_wbuffer */
+  uint8_t *ff_wbuffer;             /* Write-back buffer for full sectors (may be NULL) */
+#endif
+#ifdef CONFIG_FAT_EXTENTS
+  uint8_t  ff_nextents;            /* Number of valid entries in ff_extents[] */
+  struct fat_extent_s ff_extents[CONFIG_FAT_NEXTENTS]; /* Sorted by file cluster */
+#endif
 };
 
 /* This structure holds the sequence of directory entries used by one
@@ -1053,6 +1083,20 @@ EXTERN int    fat_putcluster(struct fat_mountpt_s *fs, uint32_t clusterno,
                              off_t startsector);
 EXTERN int    fat_removechain(struct fat_mountpt_s *fs, uint32_t cluster);
 EXTERN int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster);
+EXTERN off_t  fat_nextcluster(struct fat_mountpt_s *fs, struct fat_file_s *ff,
+                              off_t position, bool extend);
+EXTERN int    fat_extendrun(struct fat_mountpt_s *fs, struct fat_file_s *ff,
+                            off_t position, unsigned int nsectors, bool extend);
+#ifdef CONFIG_FAT_PREALLOC
+EXTERN int    fat_trimchain(struct fat_mountpt_s *fs, struct fat_file_s *ff);
+#endif
+#ifdef CONFIG_FAT_EXTENTS
+EXTERN int32_t fat_extentlookup(struct fat_file_s *ff, uint32_t fileclust,
+                                FAR uint32_t *cluster);
+EXTERN void   fat_extentadd(struct fat_file_s *ff, uint32_t fileclust,
+                            uint32_t cluster);
+EXTERN void   fat_extentinvalidate(struct fat_mountpt_s *fs, off_t startcluster);
+#endif
 
 #define fat_createchain(fs) fat_extendchain(fs, 0)
 
@@ -1082,6 +1126,7 @@ EXTERN int    fat_remove(struct fat_mountpt_s *fs, const char *relpath, bool dir
 
 EXTERN int    fat_fscacheflush(struct fat_mountpt_s *fs);
 EXTERN int    fat_fscacheread(struct fat_mountpt_s *fs, off_t sector);
+EXTERN int    fat_ffcachestage(struct fat_mountpt_s *fs, struct fat_file_s *ff);
 EXTERN int    fat_ffcacheflush(struct fat_mountpt_s *fs, struct fat_file_s *ff);
 EXTERN int    fat_ffcacheread(struct fat_mountpt_s *fs, struct fat_file_s *ff, off_t sector);
 EXTERN int    fat_ffcacheinvalidate(struct fat_mountpt_s *fs, struct fat_file_s *ff);
@@ -51,6 +51,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <time.h>
 #include <semaphore.h>
 #include <assert.h>
@@ -64,6 +65,16 @@
 #include "inode/inode.h"
 #include "fs_fat32.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_FREEMAP
+#  define FREEMAP_GROUPSIZE    (1 << CONFIG_FAT_FREEMAP_SHIFT)
+#  define FREEMAP_GROUP(c)     ((c) >> CONFIG_FAT_FREEMAP_SHIFT)
+#  define FREEMAP_NGROUPS(fs)  FREEMAP_GROUP((fs)->fs_nclusters + FREEMAP_GROUPSIZE - 1)
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -546,13 +557,21 @@ int fat_mount(struct fat_mountpt_s *fs, bool writeable)
   fs->fs_hwsectorsize = geo.geo_sectorsize;
   fs->fs_hwnsectors   = geo.geo_nsectors;
 
+#ifdef CONFIG_FAT_BCACHE
+  /* Access the volume through the block buffer cache, if possible.  If not,
+   * fs_bcache is NULL and the block driver is accessed directly.
+   */
+
+  fs->fs_bcache = bcache_attach(inode, (uint16_t)fs->fs_hwsectorsize);
+#endif
+
   /* Allocate a buffer to hold one hardware sector */
 
   fs->fs_buffer = (FAR uint8_t *)fat_io_alloc(fs->fs_hwsectorsize);
   if (!fs->fs_buffer)
     {
       ret = -ENOMEM;
-      goto errout;
+      goto errout_with_bcache;
     }
 
   /* Search FAT boot record on the drive.  First check the MBR at sector
@@ -685,6 +704,15 @@ errout_with_buffer:
   fat_io_free(fs->fs_buffer, fs->fs_hwsectorsize);
   fs->fs_buffer = 0;
 
+errout_with_bcache:
+#ifdef CONFIG_FAT_BCACHE
+  if (fs->fs_bcache)
+    {
+      (void)bcache_detach(fs->fs_bcache);
+      fs->fs_bcache = NULL;
+    }
+#endif
+
 errout:
   fs->fs_mounted = false;
   return ret;
@@ -729,6 +757,15 @@ int fat_checkmount(struct fat_mountpt_s *fs)
       /* If we get here, the mount is NOT healthy */
 
       fs->fs_mounted = false;
+
+#ifdef CONFIG_FAT_BCACHE
+      /* Nothing cached for the old media may be used or written back */
+
+      if (fs->fs_bcache)
+        {
+          bcache_invalidate(fs->fs_bcache, 0, UINT_MAX);
+        }
+#endif
     }
 
   return -ENODEV;
@@ -746,6 +783,14 @@ int fat_hwread(struct fat_mountpt_s *fs, uint8_t *buffer,  off_t sector,
                unsigned int nsectors)
 {
   int ret = -ENODEV;
+
+#ifdef CONFIG_FAT_BCACHE
+  if (fs && fs->fs_bcache)
+    {
+      return bcache_read(fs->fs_bcache, buffer, sector, nsectors);
+    }
+#endif
+
   if (fs && fs->fs_blkdriver)
     {
       struct inode *inode = fs->fs_blkdriver;
@@ -779,6 +824,14 @@ int fat_hwwrite(struct fat_mountpt_s *fs, uint8_t *buffer, off_t sector,
                 unsigned int nsectors)
 {
   int ret = -ENODEV;
+
+#ifdef CONFIG_FAT_BCACHE
+  if (fs && fs->fs_bcache)
+    {
+      return bcache_write(fs->fs_bcache, buffer, sector, nsectors);
+    }
+#endif
+
   if (fs && fs->fs_blkdriver)
     {
       struct inode *inode = fs->fs_blkdriver;
@@ -966,10 +1019,27 @@ off_t fat_getcluster(struct fat_mountpt_s *fs, uint32_t clusterno)
 int fat_putcluster(struct fat_mountpt_s *fs, uint32_t clusterno,
                    off_t nextcluster)
 {
+#ifdef CONFIG_FAT_FREEMAP
+  off_t oldvalue = 0;
+#endif
+
   /* Verify that the cluster number is within range.  Zero erases the cluster. */
 
   if (clusterno == 0 || (clusterno >= 2 && clusterno < fs->fs_nclusters))
     {
+#ifdef CONFIG_FAT_FREEMAP
+      /* Get the old value so that the free cluster summary can be updated */
+
+      if (fs->fs_freemap != NULL && clusterno >= 2)
+        {
+          oldvalue = fat_getcluster(fs, clusterno);
+          if (oldvalue < 0)
+            {
+              return (int)oldvalue;
+            }
+        }
+#endif
+
       /* Okay.. Write the next cluster into the FAT.  The way we will do
        * this depends on the type of FAT filesystem we are dealing with.
        */
@@ -1110,6 +1180,21 @@ int fat_putcluster(struct fat_mountpt_s *fs, uint32_t clusterno,
       /* Mark the modified sector as "dirty" and return success */
 
       fs->fs_dirty = true;
+
+#ifdef CONFIG_FAT_FREEMAP
+      if (fs->fs_freemap != NULL && clusterno >= 2)
+        {
+          if (oldvalue == 0 && nextcluster != 0)
+            {
+              fs->fs_freemap[FREEMAP_GROUP(clusterno)]--;
+            }
+          else if (oldvalue != 0 && nextcluster == 0)
+            {
+              fs->fs_freemap[FREEMAP_GROUP(clusterno)]++;
+            }
+        }
+#endif
+
       return OK;
     }
 
@@ -1168,70 +1253,20 @@ int fat_removechain(struct fat_mountpt_s *fs, uint32_t cluster)
 }
 
 /****************************************************************************
- * Name: fat_extendchain
+ * Name: fat_findfree
  *
  * Description:
- *   Add a new cluster to the chain following cluster (if cluster is non-
- *   NULL).  if cluster is zero, then a new chain is created.
+ *   Search the FAT for a free cluster following startcluster.
  *
  * Returned Value:
- *   <0:error, 0: no free cluster, >=2: new cluster number
+ *   <0:error, 0: no free cluster, >=2: free cluster number
  *
  ****************************************************************************/
 
-int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster)
+static int32_t fat_findfree(struct fat_mountpt_s *fs, uint32_t startcluster)
 {
   off_t    startsector;
   uint32_t newcluster;
-  uint32_t startcluster;
-  int      ret;
-
-  /* The special value 0 is used when the new chain should start */
-
-  if (cluster == 0)
-    {
-      /* The FSINFO NextFree entry should be a good starting point
-       * in the search for a new cluster
-       */
-
-      startcluster = fs->fs_fsinextfree;
-      if (startcluster == 0 || startcluster >= fs->fs_nclusters)
-        {
-          /* But it is bad.. we have to start at the beginning */
-
-          startcluster = 1;
-        }
-    }
-  else
-    {
-      /* We are extending an existing chain. Verify that this
-       * is a valid cluster by examining its start sector.
-       */
-
-      startsector = fat_getcluster(fs, cluster);
-      if (startsector < 0)
-        {
-          /* An error occurred, return the error value */
-
-          return startsector;
-        }
-      else if (startsector < 2)
-        {
-          /* Oops.. this cluster does not exist. */
-
-          return 0;
-        }
-      else if (startsector < fs->fs_nclusters)
-        {
-          /* It is already followed by next cluster */
-
-          return startsector;
-        }
-
-      /* Okay.. it checks out */
-
-      startcluster = cluster;
-    }
 
   /* Loop until (1) we discover that there are not free clusters
    * (return 0), an errors occurs (return -errno), or (3) we find
@@ -1270,9 +1305,9 @@ int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster)
       startsector = fat_getcluster(fs, newcluster);
       if (startsector == 0)
         {
-          /* Found have found a free cluster break out */
+          /* Found have found a free cluster */
 
-          break;
+          return newcluster;
         }
       else if (startsector < 0)
         {
@@ -1290,165 +1325,853 @@ int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster)
           return 0;
         }
     }
+}
 
-  /* We get here only if we break out with an available cluster
-   * number in 'newcluster'  Now mark that cluster as in-use.
-   */
+/****************************************************************************
+ * Name: fat_freemapbuild
+ *
+ * Description:
+ *   Build the free cluster summary, if it has not already been built.  This
+ *   reads the whole FAT once and also provides the number of free clusters.
+ *
+ ****************************************************************************/
 
-  ret = fat_putcluster(fs, newcluster, 0x0fffffff);
-  if (ret < 0)
+#ifdef CONFIG_FAT_FREEMAP
+static int fat_freemapbuild(struct fat_mountpt_s *fs)
+{
+  FAR uint16_t *freemap;
+  uint32_t nfreeclusters;
+  uint32_t cluster;
+  off_t next;
+
+  if (fs->fs_freemap != NULL)
     {
-      /* An error occurred */
+      return OK;
+    }
 
-      return ret;
+  freemap = (FAR uint16_t *)
+    kmm_zalloc(FREEMAP_NGROUPS(fs) * sizeof(uint16_t));
+  if (freemap == NULL)
+    {
+      return -ENOMEM;
     }
 
-  /* And link if to the start cluster (if any) */
+  /* Consecutive FAT entries share the sector in fs_buffer, so each FAT
+   * sector is read only once.
+   */
 
-  if (cluster)
+  nfreeclusters = 0;
+  for (cluster = 2; cluster < fs->fs_nclusters; cluster++)
     {
-      /* There is a start cluster -- link it */
+      next = fat_getcluster(fs, cluster);
+      if (next < 0)
+        {
+          kmm_free(freemap);
+          return (int)next;
+        }
 
-      ret = fat_putcluster(fs, cluster, newcluster);
-      if (ret < 0)
+      if (next == 0)
         {
-          return ret;
+          freemap[FREEMAP_GROUP(cluster)]++;
+          nfreeclusters++;
         }
     }
 
-  /* And update the FINSINFO for the next time we have to search */
+  fs->fs_freemap = freemap;
 
-  fs->fs_fsinextfree = newcluster;
-  if (fs->fs_fsifreecount != 0xffffffff)
+  /* Now we also know the number of free clusters */
+
+  if (fs->fs_fsifreecount != nfreeclusters)
     {
-      fs->fs_fsifreecount--;
-      fs->fs_fsidirty = 1;
+      fs->fs_fsifreecount = nfreeclusters;
+      if (fs->fs_type == FSTYPE_FAT32)
+        {
+          fs->fs_fsidirty = true;
+        }
     }
 
-  /* Return then number of the new cluster that was added to the chain */
-
-  return newcluster;
+  return OK;
 }
+#endif
 
 /****************************************************************************
- * Name: fat_nextdirentry
+ * Name: fat_freemapfind
  *
  * Description:
- *   Read the next directory entry from the sector in cache, reading the
- *   next sector(s) in the cluster as necessary.  This function must
- *   return -ENOSPC if it fails because there are no further entries
- *   available in the directory.
+ *   Find a free cluster following startcluster, examining only the groups
+ *   of clusters that the free cluster summary shows to have free clusters.
+ *
+ * Returned Value:
+ *   <0:error, 0: no free cluster, >=2: free cluster number
  *
  ****************************************************************************/
 
-int fat_nextdirentry(struct fat_mountpt_s *fs, struct fs_fatdir_s *dir)
+#ifdef CONFIG_FAT_FREEMAP
+static int32_t fat_freemapfind(struct fat_mountpt_s *fs, uint32_t startcluster)
 {
-  unsigned int cluster;
-  unsigned int ndx;
+  uint32_t ngroups;
+  uint32_t group;
+  uint32_t cluster;
+  uint32_t last;
+  uint32_t i;
+  off_t next;
 
-  /* Increment the index to the next 32-byte directory entry */
+  /* Fall back to searching the FAT if the summary cannot be built */
 
-  ndx = dir->fd_index + 1;
+  if (fat_freemapbuild(fs) < 0)
+    {
+      return fat_findfree(fs, startcluster);
+    }
 
-  /* Check if all of the directory entries in this sectory have
-   * been examined.
+  /* Visit every group once, starting with the group following the start
+   * cluster, and then the beginning of that group once more.
    */
 
-  if ((ndx & (DIRSEC_NDIRS(fs)-1)) == 0)
-    {
-      /* Yes, then we will have to read the next sector */
-
-      dir->fd_currsector++;
+  ngroups = FREEMAP_NGROUPS(fs);
+  group   = FREEMAP_GROUP(startcluster + 1);
 
-      /* For FAT12/16, the root directory is a group of sectors relative
-       * to the first sector of the fat volume.
-       */
+  for (i = 0; i <= ngroups; i++, group++)
+    {
+      if (group >= ngroups)
+        {
+          group = 0;
+        }
 
-      if (!dir->fd_currcluster)
+      if (fs->fs_freemap[group] == 0)
         {
-          /* For FAT12/16, the boot record tells us number of 32-bit directories
-           * that are contained in the root directory.  This should correspond to
-           * an even number of sectors.
-           */
+          continue;
+        }
 
-          if (ndx >= fs->fs_rootentcnt)
-            {
-              /* When we index past this count, we have examined all of the
-               * entries in the root directory.
-               */
+      cluster = group << CONFIG_FAT_FREEMAP_SHIFT;
+      last    = cluster + FREEMAP_GROUPSIZE;
 
-              return -ENOSPC;
-            }
-        }
-      else
+      if (i == 0 && cluster < startcluster + 1)
         {
-          /* Not a FAT12/16 root directory, check if we have examined the entire
-           * cluster comprising the directory.
-           *
-           * The current sector within the cluster is the entry number divided
-           * byte the number of entries per sector
-           */
+          cluster = startcluster + 1;
+        }
 
-          int sector = ndx / DIRSEC_NDIRS(fs);
+      if (cluster < 2)
+        {
+          cluster = 2;
+        }
 
-          /* We are finished with the cluster when the last sector of the cluster
-           * has been examined.
-           */
+      if (last > fs->fs_nclusters)
+        {
+          last = fs->fs_nclusters;
+        }
 
-          if ((sector & (fs->fs_fatsecperclus-1)) == 0)
+      for (; cluster < last; cluster++)
+        {
+          next = fat_getcluster(fs, cluster);
+          if (next < 0)
             {
-              /* Get next cluster */
-
-              cluster = fat_getcluster(fs, dir->fd_currcluster);
-
-              /* Check if a valid cluster was obtained. */
-
-              if (cluster < 2 || cluster >= fs->fs_nclusters)
-                {
-                  /* No, we have probably reached the end of the cluster list */
-
-                  return -ENOSPC;
-                }
-
-              /* Initialize for new cluster */
-
-              dir->fd_currcluster = cluster;
-              dir->fd_currsector  = fat_cluster2sector(fs, cluster);
-              ndx                 = 0;
+              return (int32_t)next;
+            }
+          else if (next == 0)
+            {
+              return cluster;
             }
         }
     }
 
-  /* Save the new index into dir->fd_currsector */
-
-  dir->fd_index = ndx;
-  return OK;
+  return 0;
 }
+#endif
 
 /****************************************************************************
- * Name: fat_dirtruncate
+ * Name: fat_extendchain
  *
  * Description:
- *   Truncate an existing file to zero length.
+ *   Add a new cluster to the chain following cluster (if cluster is non-
+ *   NULL).  if cluster is zero, then a new chain is created.
  *
- * Assumptions:
- *   The caller holds mountpoint semaphore, fs_buffer holds the directory
- *   entry, the directory entry sector (fd_sector) is currently in the
- *   sector cache.
+ * Returned Value:
+ *   <0:error, 0: no free cluster, >=2: new cluster number
  *
  ****************************************************************************/
 
-int fat_dirtruncate(struct fat_mountpt_s *fs, FAR uint8_t *direntry)
+int32_t fat_extendchain(struct fat_mountpt_s *fs, uint32_t cluster)
 {
-  unsigned int startcluster;
-  uint32_t writetime;
-  off_t savesector;
-  int ret;
-
-  /* Get start cluster of the file to truncate */
+  off_t    startsector;
+  uint32_t newcluster;
+  uint32_t startcluster;
+  int      ret;
 
-  startcluster = ((uint32_t)DIR_GETFSTCLUSTHI(direntry) << 16) |
-                  DIR_GETFSTCLUSTLO(direntry);
+  /* The special value 0 is used when the new chain should start */
+
+  if (cluster == 0)
+    {
+      /* The FSINFO NextFree entry should be a good starting point
+       * in the search for a new cluster
+       */
+
+      startcluster = fs->fs_fsinextfree;
+      if (startcluster == 0 || startcluster >= fs->fs_nclusters)
+        {
+          /* But it is bad.. we have to start at the beginning */
+
+          startcluster = 1;
+        }
+    }
+  else
+    {
+      /* We are extending an existing chain. Verify that this
+       * is a valid cluster by examining its start sector.
+       */
+
+      startsector = fat_getcluster(fs, cluster);
+      if (startsector < 0)
+        {
+          /* An error occurred, return the error value */
+
+          return startsector;
+        }
+      else if (startsector < 2)
+        {
+          /* Oops.. this cluster does not exist. */
+
+          return 0;
+        }
+      else if (startsector < fs->fs_nclusters)
+        {
+          /* It is already followed by next cluster */
+
+          return startsector;
+        }
+
+      /* Okay.. it checks out */
+
+      startcluster = cluster;
+    }
+
+#ifdef CONFIG_FAT_FREEMAP
+  /* Use the free cluster summary to skip groups with no free clusters */
+
+  ret = fat_freemapfind(fs, startcluster);
+#else
+  ret = fat_findfree(fs, startcluster);
+#endif
+  if (ret <= 0)
+    {
+      /* No free cluster (0) or an error occurred (-errno) */
+
+      return ret;
+    }
+
+  newcluster = ret;
+
+  /* We get here only if we break out with an available cluster
+   * number in 'newcluster'  Now mark that cluster as in-use.
+   */
+
+  ret = fat_putcluster(fs, newcluster, 0x0fffffff);
+  if (ret < 0)
+    {
+      /* An error occurred */
+
+      return ret;
+    }
+
+  /* And link if to the start cluster (if any) */
+
+  if (cluster)
+    {
+      /* There is a start cluster -- link it */
+
+      ret = fat_putcluster(fs, cluster, newcluster);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  /* And update the FINSINFO for the next time we have to search */
+
+  fs->fs_fsinextfree = newcluster;
+  if (fs->fs_fsifreecount != 0xffffffff)
+    {
+      fs->fs_fsifreecount--;
+      fs->fs_fsidirty = 1;
+    }
+
+  /* Return then number of the new cluster that was added to the chain */
+
+  return newcluster;
+}
+
+/****************************************************************************
+ * Name: fat_preallocate
+ *
+ * Description:
+ *   Return the cluster following ff_currentcluster.  If the chain ends
+ *   there, extend it by a batch of CONFIG_FAT_PREALLOC_NCLUSTERS clusters
+ *   at once.  This keeps the file contiguous and avoids a search of the FAT
+ *   at most cluster boundaries.  Clusters beyond the end of the file are
+ *   released by fat_trimchain() when the file is closed.
+ *
+ * Returned Value:
+ *   <0:error, 0: no free cluster, >=2: the following cluster number
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_PREALLOC
+static off_t fat_preallocate(struct fat_mountpt_s *fs, struct fat_file_s *ff)
+{
+  off_t first;
+  off_t cluster;
+  off_t next;
+  int i;
+
+  /* Does the chain already continue (perhaps into an earlier batch)? */
+
+  cluster = fat_getcluster(fs, ff->ff_currentcluster);
+  if (cluster < 0 || (cluster >= 2 && cluster < fs->fs_nclusters))
+    {
+      return cluster;
+    }
+
+  first = fat_extendchain(fs, ff->ff_currentcluster);
+  if (first < 2)
+    {
+      return first;
+    }
+
+  /* Then add the rest of the batch.  Running out of space here is not an
+   * error; the file just gets fewer clusters ahead of time.
+   */
+
+  for (cluster = first, i = 1; i < CONFIG_FAT_PREALLOC_NCLUSTERS; i++)
+    {
+      next = fat_extendchain(fs, cluster);
+      if (next < 2)
+        {
+          break;
+        }
+
+      cluster = next;
+    }
+
+  if (cluster != first)
+    {
+      ff->ff_bflags |= FFBUFF_PREALLOC;
+    }
+
+  return first;
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_nextcluster
+ *
+ * Description:
+ *   Find the cluster of an open file that follows ff_currentcluster and
+ *   holds the file 'position'.  If 'extend' is true, then a new cluster is
+ *   added to the chain when there is no following cluster.
+ *
+ * Returned Value:
+ *   <0:error, 0: no following cluster, >=2: the cluster number
+ *
+ ****************************************************************************/
+
+off_t fat_nextcluster(struct fat_mountpt_s *fs, struct fat_file_s *ff,
+                      off_t position, bool extend)
+{
+  off_t cluster;
+#ifdef CONFIG_FAT_EXTENTS
+  uint32_t clustndx;
+  uint32_t known;
+
+  /* Is the cluster already known? */
+
+  clustndx = position / (fs->fs_fatsecperclus * fs->fs_hwsectorsize);
+  if (fat_extentlookup(ff, clustndx, &known) == (int32_t)clustndx)
+    {
+      return known;
+    }
+#endif
+
+  if (extend)
+    {
+#ifdef CONFIG_FAT_PREALLOC
+      cluster = fat_preallocate(fs, ff);
+#else
+      cluster = fat_extendchain(fs, ff->ff_currentcluster);
+#endif
+    }
+  else
+    {
+      cluster = fat_getcluster(fs, ff->ff_currentcluster);
+    }
+
+#ifdef CONFIG_FAT_EXTENTS
+  /* Remember both the current and the following cluster */
+
+  if (clustndx > 0 && cluster >= 2 && cluster < fs->fs_nclusters)
+    {
+      fat_extentadd(ff, clustndx - 1, ff->ff_currentcluster);
+      fat_extentadd(ff, clustndx, cluster);
+    }
+#endif
+
+  return cluster;
+}
+
+/****************************************************************************
+ * Name: fat_extendrun
+ *
+ * Description:
+ *   Extend the run of sectors that starts at ff_currentsector (and file
+ *   'position') into the following clusters for as long as they are
+ *   physically contiguous, so that up to 'nsectors' can be transferred
+ *   with a single request.  On return, ff_currentcluster is the last
+ *   cluster of the run and ff_sectorsincluster counts the sectors that
+ *   remain in the run.  If 'extend' is true, clusters are added to the end
+ *   of the chain as needed.
+ *
+ * Returned Value:
+ *   The number of sectors that can be transferred (at most nsectors) or a
+ *   negated errno value.
+ *
+ ****************************************************************************/
+
+int fat_extendrun(struct fat_mountpt_s *fs, struct fat_file_s *ff,
+                  off_t position, unsigned int nsectors, bool extend)
+{
+  off_t cluster;
+
+  while (ff->ff_sectorsincluster < nsectors)
+    {
+      cluster = fat_nextcluster(fs, ff, position +
+                                ff->ff_sectorsincluster * fs->fs_hwsectorsize,
+                                extend);
+      if (cluster < 0)
+        {
+          return cluster;
+        }
+
+      /* Stop at the end of the chain or at the first discontinuity.  In
+       * the latter case, the cluster is found again at the next cluster
+       * boundary.
+       */
+
+      if (cluster != ff->ff_currentcluster + 1)
+        {
+          break;
+        }
+
+      ff->ff_currentcluster    = cluster;
+      ff->ff_sectorsincluster += fs->fs_fatsecperclus;
+    }
+
+  return nsectors < ff->ff_sectorsincluster ?
+         nsectors : ff->ff_sectorsincluster;
+}
+
+/****************************************************************************
+ * Name: fat_trimchain
+ *
+ * Description:
+ *   Release the clusters that were allocated ahead of the data by
+ *   fat_preallocate():  Terminate the chain after the last cluster that
+ *   holds file data and free the rest.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_PREALLOC
+int fat_trimchain(struct fat_mountpt_s *fs, struct fat_file_s *ff)
+{
+  uint32_t clustersize;
+  uint32_t nclusters;
+  uint32_t ndx;
+  off_t cluster;
+  off_t next;
+  int ret;
+
+  if ((ff->ff_bflags & FFBUFF_PREALLOC) == 0 || ff->ff_startcluster < 2)
+    {
+      return OK;
+    }
+
+  ff->ff_bflags &= ~FFBUFF_PREALLOC;
+
+  /* Find the last cluster that holds file data.  The first cluster is kept
+   * even for an empty file.
+   */
+
+  clustersize = fs->fs_fatsecperclus * fs->fs_hwsectorsize;
+  nclusters   = (ff->ff_size + clustersize - 1) / clustersize;
+  ndx         = 0;
+  cluster     = ff->ff_startcluster;
+
+#ifdef CONFIG_FAT_EXTENTS
+  if (nclusters > 1)
+    {
+      uint32_t known;
+      int32_t found;
+
+      found = fat_extentlookup(ff, nclusters - 1, &known);
+      if (found > 0)
+        {
+          ndx     = found;
+          cluster = known;
+        }
+    }
+#endif
+
+  for (; ndx + 1 < nclusters; ndx++)
+    {
+      cluster = fat_getcluster(fs, cluster);
+      if (cluster < 2 || cluster >= fs->fs_nclusters)
+        {
+          return cluster < 0 ? (int)cluster : -EINVAL;
+        }
+    }
+
+  /* Cut the chain after it */
+
+  next = fat_getcluster(fs, cluster);
+  if (next < 2 || next >= fs->fs_nclusters)
+    {
+      return next < 0 ? (int)next : OK;
+    }
+
+  ret = fat_putcluster(fs, cluster, 0x0fffffff);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = fat_removechain(fs, next);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+#ifdef CONFIG_FAT_EXTENTS
+  fat_extentinvalidate(fs, ff->ff_startcluster);
+#endif
+
+  /* Write the FAT changes and the free cluster count */
+
+  return fat_updatefsinfo(fs);
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_extentfind
+ *
+ * Description:
+ *   Return the index of the last extent that begins at or before the file
+ *   cluster 'fileclust', or -1 if there is no such extent.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FAT_EXTENTS
+static int fat_extentfind(struct fat_file_s *ff, uint32_t fileclust)
+{
+  int found = -1;
+  int lo    = 0;
+  int hi    = ff->ff_nextents - 1;
+  int mid;
+
+  while (lo <= hi)
+    {
+      mid = (lo + hi) >> 1;
+      if (ff->ff_extents[mid].fe_fileclust <= fileclust)
+        {
+          found = mid;
+          lo    = mid + 1;
+        }
+      else
+        {
+          hi    = mid - 1;
+        }
+    }
+
+  return found;
+}
+
+/****************************************************************************
+ * Name: fat_extentlookup
+ *
+ * Description:
+ *   Find the cluster that holds the file cluster 'fileclust' or, if that is
+ *   not known, the last known cluster before it.
+ *
+ * Returned Value:
+ *   The file cluster index of the cluster returned in 'cluster', or
+ *   -ENOENT if no cluster at or before 'fileclust' is known.
+ *
+ ****************************************************************************/
+
+int32_t fat_extentlookup(struct fat_file_s *ff, uint32_t fileclust,
+                         FAR uint32_t *cluster)
+{
+  FAR struct fat_extent_s *fe;
+  uint32_t offset;
+  int ndx;
+
+  ndx = fat_extentfind(ff, fileclust);
+  if (ndx < 0)
+    {
+      return -ENOENT;
+    }
+
+  fe     = &ff->ff_extents[ndx];
+  offset = fileclust - fe->fe_fileclust;
+  if (offset >= fe->fe_nclusters)
+    {
+      offset = fe->fe_nclusters - 1;
+    }
+
+  *cluster = fe->fe_cluster + offset;
+  return fe->fe_fileclust + offset;
+}
+
+/****************************************************************************
+ * Name: fat_extentadd
+ *
+ * Description:
+ *   Remember that file cluster 'fileclust' is held in 'cluster'.
+ *
+ ****************************************************************************/
+
+void fat_extentadd(struct fat_file_s *ff, uint32_t fileclust,
+                   uint32_t cluster)
+{
+  FAR struct fat_extent_s *fe;
+  int victim;
+  int ndx;
+  int i;
+
+  ndx = fat_extentfind(ff, fileclust);
+  if (ndx >= 0)
+    {
+      fe = &ff->ff_extents[ndx];
+      if (fileclust < fe->fe_fileclust + fe->fe_nclusters)
+        {
+          /* Already known */
+
+          return;
+        }
+
+      if (fileclust == fe->fe_fileclust + fe->fe_nclusters &&
+          cluster == fe->fe_cluster + fe->fe_nclusters)
+        {
+          /* The cluster extends this extent.  It may also close the gap
+           * to the following extent.
+           */
+
+          fe->fe_nclusters++;
+          if (ndx + 1 < ff->ff_nextents &&
+              fe[1].fe_fileclust == fileclust + 1 &&
+              fe[1].fe_cluster == cluster + 1)
+            {
+              fe->fe_nclusters += fe[1].fe_nclusters;
+              memmove(&fe[1], &fe[2],
+                      (ff->ff_nextents - ndx - 2) * sizeof(struct fat_extent_s));
+              ff->ff_nextents--;
+            }
+
+          return;
+        }
+    }
+
+  /* Does the cluster immediately precede the following extent? */
+
+  if (ndx + 1 < ff->ff_nextents)
+    {
+      fe = &ff->ff_extents[ndx + 1];
+      if (fe->fe_fileclust == fileclust + 1 && fe->fe_cluster == cluster + 1)
+        {
+          fe->fe_fileclust--;
+          fe->fe_cluster--;
+          fe->fe_nclusters++;
+          return;
+        }
+    }
+
+  /* A new extent is needed.  If the table is full, then discard the
+   * shortest extent; it is the cheapest to rediscover.
+   */
+
+  if (ff->ff_nextents >= CONFIG_FAT_NEXTENTS)
+    {
+      victim = 0;
+      for (i = 1; i < ff->ff_nextents; i++)
+        {
+          if (ff->ff_extents[i].fe_nclusters <
+              ff->ff_extents[victim].fe_nclusters)
+            {
+              victim = i;
+            }
+        }
+
+      memmove(&ff->ff_extents[victim], &ff->ff_extents[victim + 1],
+              (ff->ff_nextents - victim - 1) * sizeof(struct fat_extent_s));
+      ff->ff_nextents--;
+
+      if (victim <= ndx)
+        {
+          ndx--;
+        }
+    }
+
+  /* Insert the new extent after ndx */
+
+  ndx++;
+  fe = &ff->ff_extents[ndx];
+  memmove(&fe[1], fe, (ff->ff_nextents - ndx) * sizeof(struct fat_extent_s));
+
+  fe->fe_fileclust = fileclust;
+  fe->fe_cluster   = cluster;
+  fe->fe_nclusters = 1;
+  ff->ff_nextents++;
+}
+
+/****************************************************************************
+ * Name: fat_extentinvalidate
+ *
+ * Description:
+ *   Forget the extents of every open file with the cluster chain that
+ *   begins at 'startcluster'.  This must be called whenever clusters are
+ *   removed from the chain.
+ *
+ ****************************************************************************/
+
+void fat_extentinvalidate(struct fat_mountpt_s *fs, off_t startcluster)
+{
+  FAR struct fat_file_s *ff;
+
+  for (ff = fs->fs_head; ff != NULL; ff = ff->ff_next)
+    {
+      if (ff->ff_startcluster == startcluster)
+        {
+          ff->ff_nextents = 0;
+        }
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_nextdirentry
+ *
+ * Description:
+ *   Read the next directory entry from the sector in cache, reading the
+ *   next sector(s) in the cluster as necessary.  This function must
+ *   return -ENOSPC if it fails because there are no further entries
+ *   available in the directory.
+ *
+ ****************************************************************************/
+
+int fat_nextdirentry(struct fat_mountpt_s *fs, struct fs_fatdir_s *dir)
+{
+  unsigned int cluster;
+  unsigned int ndx;
+
+  /* Increment the index to the next 32-byte directory entry */
+
+  ndx = dir->fd_index + 1;
+
+  /* Check if all of the directory entries in this sectory have
+   * been examined.
+   */
+
+  if ((ndx & (DIRSEC_NDIRS(fs)-1)) == 0)
+    {
+      /* Yes, then we will have to read the next sector */
+
+      dir->fd_currsector++;
+
+      /* For FAT12/16, the root directory is a group of sectors relative
+       * to the first sector of the fat volume.
+       */
+
+      if (!dir->fd_currcluster)
+        {
+          /* For FAT12/16, the boot record tells us number of 32-bit directories
+           * that are contained in the root directory.  This should correspond to
+           * an even number of sectors.
+           */
+
+          if (ndx >= fs->fs_rootentcnt)
+            {
+              /* When we index past this count, we have examined all of the
+               * entries in the root directory.
+               */
+
+              return -ENOSPC;
+            }
+        }
+      else
+        {
+          /* Not a FAT12/16 root directory, check if we have examined the entire
+           * cluster comprising the directory.
+           *
+           * The current sector within the cluster is the entry number divided
+           * byte the number of entries per sector
+           */
+
+          int sector = ndx / DIRSEC_NDIRS(fs);
+
+          /* We are finished with the cluster when the last sector of the cluster
+           * has been examined.
+           */
+
+          if ((sector & (fs->fs_fatsecperclus-1)) == 0)
+            {
+              /* Get next cluster */
+
+              cluster = fat_getcluster(fs, dir->fd_currcluster);
+
+              /* Check if a valid cluster was obtained. */
+
+              if (cluster < 2 || cluster >= fs->fs_nclusters)
+                {
+                  /* No, we have probably reached the end of the cluster list */
+
+                  return -ENOSPC;
+                }
+
+              /* Initialize for new cluster */
+
+              dir->fd_currcluster = cluster;
+              dir->fd_currsector  = fat_cluster2sector(fs, cluster);
+              ndx                 = 0;
+            }
+        }
+    }
+
+  /* Save the new index into dir->fd_currsector */
+
+  dir->fd_index = ndx;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: fat_dirtruncate
+ *
+ * Description:
+ *   Truncate an existing file to zero length.
+ *
+ * Assumptions:
+ *   The caller holds mountpoint semaphore, fs_buffer holds the directory
+ *   entry, the directory entry sector (fd_sector) is currently in the
+ *   sector cache.
+ *
+ ****************************************************************************/
+
+int fat_dirtruncate(struct fat_mountpt_s *fs, FAR uint8_t *direntry)
+{
+  unsigned int startcluster;
+  uint32_t writetime;
+  off_t savesector;
+  int ret;
+
+  /* Get start cluster of the file to truncate */
+
+  startcluster = ((uint32_t)DIR_GETFSTCLUSTHI(direntry) << 16) |
+                  DIR_GETFSTCLUSTLO(direntry);
 
   /* Clear the cluster start value in the directory and set the file size
    * to zero.  This makes the file look empty but also have to dispose of
@@ -1662,7 +2385,7 @@ int fat_dirextend(FAR struct fat_mountpt_s *fs, FAR struct fat_file_s *ff,
            * move the file position back from the end of the file)
            */
 
-          cluster = fat_extendchain(fs, ff->ff_currentcluster);
+          cluster = fat_nextcluster(fs, ff, pos, true);
 
           /* Verify the cluster number */
 
@@ -1864,14 +2587,46 @@ int fat_fscacheread(struct fat_mountpt_s *fs, off_t sector)
 }
 
 /****************************************************************************
- * Name: fat_ffcacheflush
+ * Name: fat_ffwbflush
  *
  * Description:
- *   Flush any dirty sectors as necessary
+ *   Write the contents of the per-file write-back buffer with a single
+ *   multiple sector request.
  *
  ****************************************************************************/
 
-int fat_ffcacheflush(struct fat_mountpt_s *fs, struct fat_file_s *ff)
+#ifdef CONFIG_FAT_WRITEBACK
+static int fat_ffwbflush(struct fat_mountpt_s *fs, struct fat_file_s *ff)
+{
+  int ret;
+
+  if (ff->ff_wbcount > 0)
+    {
+      ret = fat_hwwrite(fs, ff->ff_wbuffer, ff->ff_wbsector, ff->ff_wbcount);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      ff->ff_wbcount = 0;
+    }
+
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: fat_ffcachestage
+ *
+ * Description:
+ *   Write back the dirty sector in the file buffer before the buffer is
+ *   re-used.  If there is a write-back buffer, the sector is only copied
+ *   there:  Runs of consecutive sectors are then written together when the
+ *   write-back buffer is full or by fat_ffcacheflush().
+ *
+ ****************************************************************************/
+
+int fat_ffcachestage(struct fat_mountpt_s *fs, struct fat_file_s *ff)
 {
   int ret;
 
@@ -1883,12 +2638,52 @@ int fat_ffcacheflush(struct fat_mountpt_s *fs, struct fat_file_s *ff)
       (ff->ff_bflags & (FFBUFF_DIRTY | FFBUFF_VALID)) ==
        (FFBUFF_DIRTY | FFBUFF_VALID))
     {
-      /* Write the dirty sector */
+#ifdef CONFIG_FAT_WRITEBACK
+      if (ff->ff_wbuffer != NULL)
+        {
+          off_t sector = ff->ff_cachesector;
+          off_t ndx;
 
-      ret = fat_hwwrite(fs, ff->ff_buffer, ff->ff_cachesector, 1);
-      if (ret < 0)
+          /* The sector must replace one already buffered or follow the
+           * last one.  Otherwise, write out what we have and start over.
+           */
+
+          if (ff->ff_wbcount > 0 &&
+              (sector < ff->ff_wbsector ||
+               sector > ff->ff_wbsector + ff->ff_wbcount ||
+               sector == ff->ff_wbsector + CONFIG_FAT_WRITEBACK_NSECTORS))
+            {
+              ret = fat_ffwbflush(fs, ff);
+              if (ret < 0)
+                {
+                  return ret;
+                }
+            }
+
+          if (ff->ff_wbcount == 0)
+            {
+              ff->ff_wbsector = sector;
+            }
+
+          ndx = sector - ff->ff_wbsector;
+          memcpy(&ff->ff_wbuffer[ndx * fs->fs_hwsectorsize], ff->ff_buffer,
+                 fs->fs_hwsectorsize);
+
+          if (ndx == ff->ff_wbcount)
+            {
+              ff->ff_wbcount++;
+            }
+        }
+      else
+#endif
         {
-          return ret;
+          /* Write the dirty sector */
+
+          ret = fat_hwwrite(fs, ff->ff_buffer, ff->ff_cachesector, 1);
+          if (ret < 0)
+            {
+              return ret;
+            }
         }
 
       /* No longer dirty, but still valid */
@@ -1899,6 +2694,29 @@ int fat_ffcacheflush(struct fat_mountpt_s *fs, struct fat_file_s *ff)
   return OK;
 }
 
+/****************************************************************************
+ * Name: fat_ffcacheflush
+ *
+ * Description:
+ *   Flush any dirty sectors as necessary
+ *
+ ****************************************************************************/
+
+int fat_ffcacheflush(struct fat_mountpt_s *fs, struct fat_file_s *ff)
+{
+  int ret;
+
+  ret = fat_ffcachestage(fs, ff);
+#ifdef CONFIG_FAT_WRITEBACK
+  if (ret >= 0)
+    {
+      ret = fat_ffwbflush(fs, ff);
+    }
+#endif
+
+  return ret;
+}
+
 /****************************************************************************
  * Name: fat_ffcacheread
  *
@@ -1923,18 +2741,33 @@ int fat_ffcacheread(struct fat_mountpt_s *fs, struct fat_file_s *ff, off_t secto
        * sector if it is dirty.
        */
 
-      ret = fat_ffcacheflush(fs, ff);
+      ret = fat_ffcachestage(fs, ff);
       if (ret < 0)
         {
           return ret;
         }
 
-      /* Then read the specified sector into the cache */
+      /* Then read the specified sector into the cache.  The newest copy
+       * may still be in the write-back buffer.
+       */
 
-      ret = fat_hwread(fs, ff->ff_buffer, sector, 1);
-      if (ret < 0)
+#ifdef CONFIG_FAT_WRITEBACK
+      if (ff->ff_wbcount > 0 && sector >= ff->ff_wbsector &&
+          sector < ff->ff_wbsector + ff->ff_wbcount)
         {
-          return ret;
+          memcpy(ff->ff_buffer,
+                 &ff->ff_wbuffer[(sector - ff->ff_wbsector) *
+                                 fs->fs_hwsectorsize],
+                 fs->fs_hwsectorsize);
+        }
+      else
+#endif
+        {
+          ret = fat_hwread(fs, ff->ff_buffer, sector, 1);
+          if (ret < 0)
+            {
+              return ret;
+            }
         }
 
       /* Update the cached sector number */
@@ -1958,6 +2791,18 @@ int fat_ffcacheinvalidate(struct fat_mountpt_s *fs, struct fat_file_s *ff)
 {
   int ret;
 
+#ifdef CONFIG_FAT_WRITEBACK
+  /* The write-back buffer must be written even if the file buffer holds
+   * nothing.
+   */
+
+  ret = fat_ffcacheflush(fs, ff);
+  if (ret < 0)
+    {
+      return ret;
+    }
+#endif
+
   /* Is there anything valid in the buffer now? */
 
   if ((ff->ff_bflags & FFBUFF_VALID) != 0)
@@ -2026,6 +2871,15 @@ int fat_updatefsinfo(struct fat_mountpt_s *fs)
         }
     }
 
+#ifdef CONFIG_FAT_BCACHE
+  /* Then make sure that everything reaches the media */
+
+  if (ret == OK && fs->fs_bcache)
+    {
+      ret = bcache_flush(fs->fs_bcache);
+    }
+#endif
+
   return ret;
 }
 
@@ -2049,6 +2903,16 @@ int fat_nfreeclusters(struct fat_mountpt_s *fs, off_t *pfreeclusters)
       return OK;
     }
 
+#ifdef CONFIG_FAT_FREEMAP
+  /* Building the free cluster summary also counts the free clusters */
+
+  if (fat_freemapbuild(fs) >= 0)
+    {
+      *pfreeclusters = fs->fs_fsifreecount;
+      return OK;
+    }
+#endif
+
   /* Otherwise, we will have to count the number of free clusters */
 
   nfreeclusters = 0;
@@ -2087,7 +2951,7 @@ int fat_nfreeclusters(struct fat_mountpt_s *fs, off_t *pfreeclusters)
 
           if (offset >= fs->fs_hwsectorsize)
             {
-              ret = fat_fscacheread(fs, fatsector++);
+              ret = fat_fscacheread(fs, fatsector);
               if (ret < 0)
                 {
                   return ret;
@@ -39,6 +39,8 @@
 
 #include <nuttx/config.h>
 
+#include <nuttx/fs/bcache.h>
+
 #include "inode/inode.h"
 #include "aio/aio.h"
 
@@ -67,4 +69,10 @@ void fs_initialize(void)
   aio_initialize();
 
 #endif
+
+#ifdef CONFIG_FS_BCACHE
+  /* Initialize the block buffer cache */
+
+  bcache_initialize();
+#endif
 }
@@ -90,6 +90,8 @@ static int     hostfs_fstat(FAR const struct file *filep,
                         FAR struct stat *buf);
 static int     hostfs_ftruncate(FAR struct file *filep,
                         off_t length);
+static int     hostfs_fadvise(FAR struct file *filep, off_t offset,
+                        off_t len, int advice);
 
 static int     hostfs_opendir(FAR struct inode *mountpt,
                         FAR const char *relpath,
@@ -162,7 +164,8 @@ const struct mountpt_operations hostfs_operations =
   hostfs_mkdir,         /* mkdir */
   hostfs_rmdir,         /* rmdir */
   hostfs_rename,        /* rename */
-  hostfs_stat           /* stat */
+  hostfs_stat,          /* stat */
+  hostfs_fadvise        /* fadvise */
 };
 
 /****************************************************************************
@@ -772,6 +775,48 @@ static int hostfs_ftruncate(FAR struct file *filep, off_t length)
   return ret;
 }
 
+/****************************************************************************
+ * Name: hostfs_fadvise
+ *
+ * Description:
+ *   Pass the advice to the host.  With POSIX_FADV_WILLNEED, the host starts
+ *   reading the data into its own cache.
+ *
+ ****************************************************************************/
+
+static int hostfs_fadvise(FAR struct file *filep, off_t offset, off_t len,
+                          int advice)
+{
+  FAR struct inode *inode;
+  FAR struct hostfs_mountpt_s *fs;
+  FAR struct hostfs_ofile_s *hf;
+  int ret;
+
+  /* Sanity checks */
+
+  DEBUGASSERT(filep != NULL);
+
+  /* Recover our private data from the struct file instance */
+
+  DEBUGASSERT(filep->f_priv != NULL && filep->f_inode != NULL);
+  hf    = filep->f_priv;
+  inode = filep->f_inode;
+
+  fs    = inode->i_private;
+  DEBUGASSERT(fs != NULL);
+
+  /* Take the semaphore */
+
+  hostfs_semtake(fs);
+
+  /* Call the host to pass on the advice */
+
+  ret = host_fadvise(hf->fd, offset, len, advice);
+
+  hostfs_semgive(fs);
+  return ret;
+}
+
 /****************************************************************************
  * Name: hostfs_opendir
  *
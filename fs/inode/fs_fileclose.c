@@ -80,6 +80,12 @@ int file_close(FAR struct file *filep)
 
   if (inode)
     {
+#ifdef CONFIG_FS_READAHEAD
+      /* Stop any read-ahead before the file is closed */
+
+      file_readahead_release(filep);
+#endif
+
       /* Close the file, driver, or mountpoint. */
 
       if (inode->u.i_ops && inode->u.i_ops->close)
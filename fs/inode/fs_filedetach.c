@@ -54,32 +54,27 @@
 
 /****************************************************************************
  * Name: _files_semtake
+ *
+ * Description:
+ *   Take exclusive access to the file list.  Look-ups by fs_getfilep()
+ *   take shared access.
+ *
  ****************************************************************************/
 
 static inline void _files_semtake(FAR struct filelist *list)
 {
   int ret;
 
-  do
-    {
-      /* Take the semaphore (perhaps waiting) */
-
-      ret = nxsem_wait(&list->fl_sem);
-
-      /* The only case that an error should occur here is if the wait was
-       * awakened by a signal.
-       */
-
-      DEBUGASSERT(ret == OK || ret == -EINTR);
-    }
-  while (ret == -EINTR);
+  ret = nxrwsem_wrlock(&list->fl_sem);
+  DEBUGASSERT(ret == OK);
+  UNUSED(ret);
 }
 
 /****************************************************************************
  * Name: _files_semgive
  ****************************************************************************/
 
-#define _files_semgive(list) nxsem_post(&list->fl_sem)
+#define _files_semgive(list) nxrwsem_wrunlock(&list->fl_sem)
 
 /****************************************************************************
  * Public Functions
@@ -151,6 +146,9 @@ int file_detach(int fd, FAR struct file *filep)
   filep->f_pos     = parent->f_pos;
   filep->f_inode   = parent->f_inode;
   filep->f_priv    = parent->f_priv;
+#ifdef CONFIG_FS_READAHEAD
+  filep->f_ra      = parent->f_ra;
+#endif
 
   /* Release the file descriptor *without* calling the driver close method
    * and without decrementing the inode reference count.  That will be done
@@ -161,6 +159,9 @@ int file_detach(int fd, FAR struct file *filep)
   parent->f_pos    = 0;
   parent->f_inode  = NULL;
   parent->f_priv   = NULL;
+#ifdef CONFIG_FS_READAHEAD
+  parent->f_ra     = NULL;
+#endif
 
   _files_semgive(list);
   return OK;
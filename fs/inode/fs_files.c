@@ -58,32 +58,27 @@
 
 /****************************************************************************
  * Name: _files_semtake
+ *
+ * Description:
+ *   Take exclusive access to the file list.  Look-ups by fs_getfilep()
+ *   take shared access.
+ *
  ****************************************************************************/
 
 static void _files_semtake(FAR struct filelist *list)
 {
   int ret;
 
-  do
-    {
-      /* Take the semaphore (perhaps waiting) */
-
-      ret = nxsem_wait(&list->fl_sem);
-
-      /* The only case that an error should occur here is if the wait was
-       * awakened by a signal.
-       */
-
-      DEBUGASSERT(ret == OK || ret == -EINTR);
-    }
-  while (ret == -EINTR);
+  ret = nxrwsem_wrlock(&list->fl_sem);
+  DEBUGASSERT(ret == OK);
+  UNUSED(ret);
 }
 
 /****************************************************************************
  * Name: _files_semgive
  ****************************************************************************/
 
-#define _files_semgive(list) nxsem_post(&list->fl_sem)
+#define _files_semgive(list) nxrwsem_wrunlock(&list->fl_sem)
 
 /****************************************************************************
  * Name: _files_close
@@ -105,6 +100,12 @@ static int _files_close(FAR struct file *filep)
 
   if (inode)
     {
+#ifdef CONFIG_FS_READAHEAD
+      /* Stop any read-ahead before the file is closed */
+
+      file_readahead_release(filep);
+#endif
+
       /* Close the file, driver, or mountpoint. */
 
       if (inode->u.i_ops && inode->u.i_ops->close)
@@ -157,7 +158,7 @@ void files_initlist(FAR struct filelist *list)
 
   /* Initialize the list access mutex */
 
-  (void)nxsem_init(&list->fl_sem, 0, 1);
+  (void)nxrwsem_init(&list->fl_sem);
 }
 
 /****************************************************************************
@@ -186,7 +187,7 @@ void files_releaselist(FAR struct filelist *list)
 
   /* Destroy the semaphore */
 
-  (void)nxsem_destroy(&list->fl_sem);
+  (void)nxrwsem_destroy(&list->fl_sem);
 }
 
 /****************************************************************************
@@ -253,6 +254,9 @@ int file_dup2(FAR struct file *filep1, FAR struct file *filep2)
   filep2->f_oflags = filep1->f_oflags;
   filep2->f_pos    = filep1->f_pos;
   filep2->f_inode  = inode;
+#ifdef CONFIG_FS_READAHEAD
+  filep2->f_ra     = NULL;
+#endif
 
   /* Call the open method on the file, driver, mountpoint so that it
    * can maintain the correct open counts.
@@ -335,6 +339,9 @@ int files_allocate(FAR struct inode *inode, int oflags, off_t pos, int minfd)
            list->fl_files[i].f_pos    = pos;
            list->fl_files[i].f_inode  = inode;
            list->fl_files[i].f_priv   = NULL;
+#ifdef CONFIG_FS_READAHEAD
+           list->fl_files[i].f_ra     = NULL;
+#endif
            _files_semgive(list);
            return i;
         }
@@ -40,45 +40,32 @@
 
 #include <nuttx/config.h>
 
-#include <unistd.h>
 #include <semaphore.h>
 #include <assert.h>
 #include <errno.h>
 
+#include <nuttx/semaphore.h>
 #include <nuttx/fs/fs.h>
 
 #include "inode/inode.h"
 
 /****************************************************************************
- * Pre-processor Definitions
- ****************************************************************************/
-
-#define NO_HOLDER ((pid_t)-1)
-
-/****************************************************************************
- * Private Types
+ * Private Data
  ****************************************************************************/
 
-/* Implements a re-entrant mutex for inode access.  This must be re-entrant
- * because there can be cycles.  For example, it may be necessary to destroy
- * a block driver inode on umount() after a removable block device has been
- * removed.  In that case umount() hold the inode semaphore, but the block
- * driver may callback to unregister_blockdriver() after the un-mount,
- * requiring the seamphore again.
+/* Implements a re-entrant reader/writer lock for inode access.  Write
+ * access must be re-entrant because there can be cycles.  For example, it
+ * may be necessary to destroy a block driver inode on umount() after a
+ * removable block device has been removed.  In that case umount() hold the
+ * inode semaphore, but the block driver may callback to
+ * unregister_blockdriver() after the un-mount, requiring the seamphore
+ * again.
+ *
+ * Pure look-ups, such as open() and stat() path resolution, take only
+ * shared access so that they may proceed concurrently.
  */
 
-struct inode_sem_s
-{
-  sem_t   sem;     /* The semaphore */
-  pid_t   holder;  /* The current holder of the semaphore */
-  int16_t count;   /* Number of counts held */
-};
-
-/****************************************************************************
- * Private Data
- ****************************************************************************/
-
-static struct inode_sem_s g_inode_sem;
+static rwsem_t g_inode_sem;
 
 /****************************************************************************
  * Public Functions
@@ -95,13 +82,9 @@ static struct inode_sem_s g_inode_sem;
 
 void inode_initialize(void)
 {
-  /* Initialize the semaphore to one (to support one-at-a-time access to the
-   * inode tree).
-   */
+  /* Initialize the reader/writer semaphore that protects the inode tree */
 
-  (void)nxsem_init(&g_inode_sem.sem, 0, 1);
-  g_inode_sem.holder = NO_HOLDER;
-  g_inode_sem.count  = 0;
+  (void)nxrwsem_init(&g_inode_sem);
 
   /* Initialize files array (if it is used) */
 
@@ -123,42 +106,11 @@ void inode_initialize(void)
 
 void inode_semtake(void)
 {
-  pid_t me;
-
-  /* Do we already hold the semaphore? */
-
-  me = getpid();
-  if (me == g_inode_sem.holder)
-    {
-      /* Yes... just increment the count */
-
-      g_inode_sem.count++;
-      DEBUGASSERT(g_inode_sem.count > 0);
-    }
-
-  /* Take the semaphore (perhaps waiting) */
-
-  else
-    {
-      int ret;
-
-      do
-        {
-          ret = nxsem_wait(&g_inode_sem.sem);
-
-          /* The only case that an error should occur here is if the wait
-           * was awakened by a signal.
-           */
+  int ret;
 
-          DEBUGASSERT(ret == OK || ret == -EINTR);
-        }
-      while (ret == -EINTR);
-
-      /* No we hold the semaphore */
-
-      g_inode_sem.holder = me;
-      g_inode_sem.count  = 1;
-    }
+  ret = nxrwsem_wrlock(&g_inode_sem);
+  DEBUGASSERT(ret == OK);
+  UNUSED(ret);
 }
 
 /****************************************************************************
@@ -171,23 +123,37 @@ void inode_semtake(void)
 
 void inode_semgive(void)
 {
-  DEBUGASSERT(g_inode_sem.holder == getpid());
+  nxrwsem_wrunlock(&g_inode_sem);
+}
 
-  /* Is this our last count on the semaphore? */
+/****************************************************************************
+ * Name: inode_rdsemtake
+ *
+ * Description:
+ *   Get shared, read-only access to the in-memory inode tree (g_inode_sem).
+ *   The caller must not modify the tree and must not call inode_semtake()
+ *   or inode_rdsemtake() again until inode_rdsemgive() is called.
+ *
+ ****************************************************************************/
 
-  if (g_inode_sem.count > 1)
-    {
-      /* No.. just decrement the count */
+void inode_rdsemtake(void)
+{
+  int ret;
 
-      g_inode_sem.count--;
-    }
+  ret = nxrwsem_rdlock(&g_inode_sem);
+  DEBUGASSERT(ret == OK);
+  UNUSED(ret);
+}
 
-  /* Yes.. then we can really release the semaphore */
+/****************************************************************************
+ * Name: inode_rdsemgive
+ *
+ * Description:
+ *   Relinquish shared access to the in-memory inode tree (g_inode_sem).
+ *
+ ****************************************************************************/
 
-  else
-    {
-      g_inode_sem.holder = NO_HOLDER;
-      g_inode_sem.count  = 0;
-      nxsem_post(&g_inode_sem.sem);
-    }
+void inode_rdsemgive(void)
+{
+  nxrwsem_rdunlock(&g_inode_sem);
 }
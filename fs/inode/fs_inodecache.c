@@ -0,0 +1,270 @@
+/****************************************************************************
+ * fs/inode/fs_inodecache.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/fs/fs.h>
+
+#include "inode/inode.h"
+
+#ifdef CONFIG_FS_INODE_CACHE
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_FS_INODE_CACHE_NENTRIES
+#  define CONFIG_FS_INODE_CACHE_NENTRIES 32
+#endif
+
+#ifndef CONFIG_FS_INODE_CACHE_PATHLEN
+#  define CONFIG_FS_INODE_CACHE_PATHLEN 48
+#endif
+
+#if (CONFIG_FS_INODE_CACHE_NENTRIES & (CONFIG_FS_INODE_CACHE_NENTRIES - 1)) != 0
+#  error CONFIG_FS_INODE_CACHE_NENTRIES must be a power of two
+#endif
+
+#define INODE_CACHE_MASK  (CONFIG_FS_INODE_CACHE_NENTRIES - 1)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One remembered result of inode_search().  The path is the key; the
+ * remaining fields are the search outputs.  The relative path into a
+ * mountpoint is saved as an offset into the path since the caller's path
+ * buffer is different on each look-up.
+ */
+
+struct inode_cache_s
+{
+  uint32_t hash;                  /* Hash of the full path */
+  uint16_t generation;            /* Tree generation when entry was added */
+  uint8_t  pathlen;               /* Length of the path (excluding NUL) */
+  uint8_t  reloffset;             /* Offset of relpath into the path */
+  FAR struct inode *node;         /* Pointer to the inode found */
+  FAR struct inode *peer;         /* Node to the "left" of the found inode */
+  FAR struct inode *parent;       /* Node "above" the found inode */
+  char path[CONFIG_FS_INODE_CACHE_PATHLEN];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct inode_cache_s g_inode_cache[CONFIG_FS_INODE_CACHE_NENTRIES];
+
+/* Incremented each time the shape of the inode tree changes.  Entries
+ * added under an earlier generation are stale.  Generation zero is never
+ * used so that the zeroed, initial entries are never valid.
+ */
+
+static uint16_t g_inode_generation = 1;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inode_cachehash
+ *
+ * Description:
+ *   Return the 32-bit FNV-1a hash of 'path' and its length.
+ *
+ ****************************************************************************/
+
+static uint32_t inode_cachehash(FAR const char *path, FAR size_t *len)
+{
+  FAR const char *ptr = path;
+  uint32_t hash = 2166136261u;
+
+  while (*ptr != '\0')
+    {
+      hash ^= (uint8_t)*ptr++;
+      hash *= 16777619u;
+    }
+
+  *len = ptr - path;
+  return hash;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inode_cachelookup
+ *
+ * Description:
+ *   Look for 'desc->path' among the remembered results of earlier
+ *   inode_search() calls.  On a hit, the search outputs in 'desc' are set
+ *   as inode_search() would set them.
+ *
+ * Returned Value:
+ *   OK on a cache hit; -ENOENT if the path is not in the cache.
+ *
+ * Assumptions:
+ *   The caller holds the g_inode_sem semaphore (shared or exclusive)
+ *
+ ****************************************************************************/
+
+int inode_cachelookup(FAR struct inode_search_s *desc)
+{
+  FAR struct inode_cache_s *entry;
+  FAR const char *path = desc->path;
+  irqstate_t flags;
+  uint32_t hash;
+  size_t len;
+
+  hash  = inode_cachehash(path, &len);
+  entry = &g_inode_cache[hash & INODE_CACHE_MASK];
+
+  /* Look-ups may run concurrently with shared access to the tree */
+
+  flags = enter_critical_section();
+  if (entry->generation != g_inode_generation || entry->hash != hash ||
+      entry->pathlen != len || memcmp(entry->path, path, len) != 0)
+    {
+      leave_critical_section(flags);
+      return -ENOENT;
+    }
+
+  desc->node    = entry->node;
+  desc->peer    = entry->peer;
+  desc->parent  = entry->parent;
+  desc->relpath = path + entry->reloffset;
+  desc->path    = desc->relpath;
+  leave_critical_section(flags);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: inode_cacheadd
+ *
+ * Description:
+ *   Remember the result of a successful inode_search() of 'path'.  Look-ups
+ *   that passed through a soft link or that are too long for the cache are
+ *   not remembered.
+ *
+ * Assumptions:
+ *   The caller holds the g_inode_sem semaphore (shared or exclusive)
+ *
+ ****************************************************************************/
+
+void inode_cacheadd(FAR const char *path, FAR struct inode_search_s *desc)
+{
+  FAR struct inode_cache_s *entry;
+  irqstate_t flags;
+  uint32_t hash;
+  size_t len;
+
+  DEBUGASSERT(desc->node != NULL && desc->relpath != NULL);
+
+#ifdef CONFIG_PSEUDOFS_SOFTLINKS
+  /* The result depends on the soft link target and the 'nofollow' setting
+   * rather than on the path alone.
+   */
+
+  if (desc->linktgt != NULL || desc->buffer != NULL ||
+      INODE_IS_SOFTLINK(desc->node))
+    {
+      return;
+    }
+#endif
+
+  /* The relative path must lie within the caller's path */
+
+  if (desc->relpath < path)
+    {
+      return;
+    }
+
+  hash = inode_cachehash(path, &len);
+  if (len >= CONFIG_FS_INODE_CACHE_PATHLEN)
+    {
+      return;
+    }
+
+  entry             = &g_inode_cache[hash & INODE_CACHE_MASK];
+
+  flags             = enter_critical_section();
+  entry->hash       = hash;
+  entry->generation = g_inode_generation;
+  entry->pathlen    = len;
+  entry->reloffset  = desc->relpath - path;
+  entry->node       = desc->node;
+  entry->peer       = desc->peer;
+  entry->parent     = desc->parent;
+  memcpy(entry->path, path, len);
+  leave_critical_section(flags);
+}
+
+/****************************************************************************
+ * Name: inode_cacheflush
+ *
+ * Description:
+ *   Discard all remembered look-up results.  This must be called whenever
+ *   an inode is linked into or unlinked from the inode tree.
+ *
+ * Assumptions:
+ *   The caller holds the g_inode_sem semaphore exclusively
+ *
+ ****************************************************************************/
+
+void inode_cacheflush(void)
+{
+  if (++g_inode_generation == 0)
+    {
+      /* The generation counter wrapped.  Clear all entries so that a stale
+       * entry cannot come back to life.
+       */
+
+      memset(g_inode_cache, 0, sizeof(g_inode_cache));
+      g_inode_generation = 1;
+    }
+}
+
+#endif /* CONFIG_FS_INODE_CACHE */
@@ -117,6 +117,10 @@ FAR struct inode *inode_unlink(FAR const char *path)
         }
 
       node->i_peer = NULL;
+
+      /* Cached look-up results may no longer be correct */
+
+      inode_cacheflush();
     }
 
   RELEASE_SEARCH(&desc);
@@ -459,6 +459,9 @@ static int _inode_search(FAR struct inode_search_s *desc)
 
 int inode_search(FAR struct inode_search_s *desc)
 {
+#ifdef CONFIG_FS_INODE_CACHE
+  FAR const char *path;
+#endif
   int ret;
 
   /* Perform the common _inode_search() logic.  This does everything except
@@ -471,6 +474,16 @@ int inode_search(FAR struct inode_search_s *desc)
   desc->linktgt = NULL;
 #endif
 
+#ifdef CONFIG_FS_INODE_CACHE
+  /* Check if this path was resolved recently */
+
+  path = desc->path;
+  if (inode_cachelookup(desc) >= 0)
+    {
+      return OK;
+    }
+#endif
+
   ret = _inode_search(desc);
 
 #ifdef CONFIG_PSEUDOFS_SOFTLINKS
@@ -577,6 +590,13 @@ int inode_search(FAR struct inode_search_s *desc)
     }
 #endif
 
+#ifdef CONFIG_FS_INODE_CACHE
+  if (ret >= 0)
+    {
+      inode_cacheadd(path, desc);
+    }
+#endif
+
   return ret;
 }
 
@@ -200,6 +200,27 @@ void inode_semtake(void);
 
 void inode_semgive(void);
 
+/****************************************************************************
+ * Name: inode_rdsemtake
+ *
+ * Description:
+ *   Get shared, read-only access to the in-memory inode tree (tree_sem).
+ *   Read access is not recursive.
+ *
+ ****************************************************************************/
+
+void inode_rdsemtake(void);
+
+/****************************************************************************
+ * Name: inode_rdsemgive
+ *
+ * Description:
+ *   Relinquish shared access to the in-memory inode tree (tree_sem).
+ *
+ ****************************************************************************/
+
+void inode_rdsemgive(void);
+
 /****************************************************************************
  * Name: inode_search
  *
@@ -226,6 +247,30 @@ void inode_semgive(void);
 
 int inode_search(FAR struct inode_search_s *desc);
 
+/****************************************************************************
+ * Name: inode_cachelookup, inode_cacheadd, and inode_cacheflush
+ *
+ * Description:
+ *   Manage the cache of recent inode_search() results.  inode_cachelookup()
+ *   returns OK and sets up 'desc' if the path was found in the cache;
+ *   inode_cacheadd() remembers a successful look-up of 'path';
+ *   inode_cacheflush() discards the cache when the inode tree changes.
+ *
+ * Assumptions:
+ *   The caller holds the g_inode_sem semaphore
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_INODE_CACHE
+int inode_cachelookup(FAR struct inode_search_s *desc);
+void inode_cacheadd(FAR const char *path, FAR struct inode_search_s *desc);
+void inode_cacheflush(void);
+#else
+#  define inode_cachelookup(d)  (-ENOENT)
+#  define inode_cacheadd(p,d)
+#  define inode_cacheflush()
+#endif
+
 /****************************************************************************
  * Name: inode_find
  *
@@ -424,6 +469,59 @@ int files_close(int fd);
 
 void files_release(int fd);
 
+/****************************************************************************
+ * Name: file_readahead
+ *
+ * Description:
+ *   Called by file_read() after each successful read from a file system
+ *   that supports the fadvise method.  If the file is being read
+ *   sequentially, the following data is requested from the file system on
+ *   the low priority work queue.
+ *
+ * Input Parameters:
+ *   filep - The file that was read
+ *   pos   - The file position before the read
+ *   nread - The number of bytes read
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_READAHEAD
+void file_readahead(FAR struct file *filep, off_t pos, size_t nread);
+#endif
+
+/****************************************************************************
+ * Name: file_readahead_advise
+ *
+ * Description:
+ *   Apply posix_fadvise() advice to the read-ahead state of a file.
+ *   POSIX_FADV_WILLNEED is passed to the file system on the low priority
+ *   work queue.
+ *
+ * Returned Value:
+ *   One (1) if the advice was queued for the work queue; zero (OK) if the
+ *   caller must still pass the advice to the file system; a negated errno
+ *   value on failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_READAHEAD
+int file_readahead_advise(FAR struct file *filep, off_t offset, off_t len,
+                          int advice);
+#endif
+
+/****************************************************************************
+ * Name: file_readahead_release
+ *
+ * Description:
+ *   Cancel any pending read-ahead and free the read-ahead state of a file.
+ *   This must be called before the file is closed.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_READAHEAD
+void file_readahead_release(FAR struct file *filep);
+#endif
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
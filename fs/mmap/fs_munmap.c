@@ -43,10 +43,12 @@
 #include <sys/mman.h>
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <errno.h>
 #include <assert.h>
 #include <debug.h>
 
+#include <nuttx/sched.h>
 #include <nuttx/kmalloc.h>
 
 #include "inode/inode.h"
@@ -54,6 +56,51 @@
 
 #ifdef CONFIG_FS_RAMMAP
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: munmap_find
+ *
+ * Description:
+ *   Find the mapping of the calling task group that includes 'start'.
+ *
+ ****************************************************************************/
+
+static FAR struct fs_rammapref_s *
+munmap_find(FAR void *start, size_t length,
+            FAR struct fs_rammapref_s **prevp)
+{
+  FAR struct fs_rammapref_s *prev;
+  FAR struct fs_rammapref_s *curr;
+#ifdef HAVE_TASK_GROUP
+  FAR struct task_group_s *group = sched_self()->group;
+#endif
+
+  for (prev = NULL, curr = g_rammaps.refs; curr;
+       prev = curr, curr = curr->flink)
+    {
+#ifdef HAVE_TASK_GROUP
+      if (curr->group != group)
+        {
+          continue;
+        }
+#endif
+
+      /* Does this region include any part of the specified range? */
+
+      if ((uintptr_t)start < (uintptr_t)curr->addr + curr->length &&
+          (uintptr_t)start + length >= (uintptr_t)curr->addr)
+        {
+          break;
+        }
+    }
+
+  *prevp = prev;
+  return curr;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -110,10 +157,12 @@
 
 int munmap(FAR void *start, size_t length)
 {
-  FAR struct fs_rammap_s *prev;
-  FAR struct fs_rammap_s *curr;
+  FAR struct fs_rammapref_s *prev;
+  FAR struct fs_rammapref_s *curr;
+  FAR struct fs_rammap_s *map;
   FAR void *newaddr;
   unsigned int offset;
+  size_t newlen;
   int ret;
   int errcode;
 
@@ -123,22 +172,16 @@ int munmap(FAR void *start, size_t length)
   ret = nxsem_wait(&g_rammaps.exclsem);
   if (ret < 0)
     {
-      errcode = ret;
+      errcode = -ret;
       goto errout;
     }
 
-  /* Seach the list of regions */
-
-  for (prev = NULL, curr = g_rammaps.head; curr; prev = curr, curr = curr->flink)
-    {
-      /* Does this region include any part of the specified range? */
+  /* Search the list of mappings.  Several tasks may have mapped the same
+   * region of the same file, but a task may only remove the mappings of its
+   * own task group.
+   */
 
-      if ((uintptr_t)start < (uintptr_t)curr->addr + curr->length &&
-          (uintptr_t)start + length >= (uintptr_t)curr->addr)
-        {
-          break;
-        }
-    }
+  curr = munmap_find(start, length, &prev);
 
   /* Did we find the region */
 
@@ -156,7 +199,7 @@ int munmap(FAR void *start, size_t length)
    * simulate the unmapping.
    */
 
-  offset = start - curr->addr;
+  offset = (FAR uint8_t *)start - (FAR uint8_t *)curr->addr;
   if (offset + length < curr->length)
     {
       ferr("ERROR: Cannot umap without unmapping to the end\n");
@@ -164,30 +207,15 @@ int munmap(FAR void *start, size_t length)
       goto errout_with_semaphore;
     }
 
-  /* Okay.. the region is beging umapped to the end.  Make sure the length
-   * indicates that.
-   */
-
-  length = curr->length - offset;
-
   /* Are we unmapping the entire region (offset == 0)? */
 
-  if (length >= curr->length)
+  if (offset == 0)
     {
-      /* Yes.. remove the mapping from the list */
-
-      if (prev)
-        {
-          prev->flink = curr->flink;
-        }
-      else
-        {
-          g_rammaps.head = curr->flink;
-        }
-
-      /* Then free the region */
+      /* Yes.. remove the mapping and free the copy of the file if no other
+       * mapping refers to it.
+       */
 
-      kumm_free(curr);
+      rammap_unref(prev, curr);
     }
 
   /* No.. We have been asked to "unmap' only a portion of the memory
@@ -196,9 +224,22 @@ int munmap(FAR void *start, size_t length)
 
   else
     {
-      newaddr = kumm_realloc(curr->addr, sizeof(struct fs_rammap_s) + length);
-      DEBUGASSERT(newaddr == (FAR void *)(curr->addr));
-      curr->length = length;
+      curr->length = offset;
+
+      /* The memory can only be given back if no other mapping shares the
+       * copy of the file.  Otherwise, it is freed with the last mapping.
+       */
+
+      map = curr->map;
+      if (map->crefs == 1)
+        {
+          newlen  = ((FAR uint8_t *)curr->addr - (FAR uint8_t *)map->addr) +
+                    offset;
+          newaddr = kumm_realloc(map, sizeof(struct fs_rammap_s) + newlen);
+          DEBUGASSERT(newaddr == (FAR void *)map);
+          UNUSED(newaddr);
+          map->length = newlen;
+        }
     }
 
   nxsem_post(&g_rammaps.exclsem);
@@ -41,13 +41,20 @@
 
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
+#include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
+#include <assert.h>
 #include <errno.h>
 #include <debug.h>
 
+#include <nuttx/sched.h>
+#include <nuttx/semaphore.h>
 #include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
 #include <nuttx/kmalloc.h>
 
 #include "inode/inode.h"
@@ -118,121 +125,369 @@ void rammap_initialize(void)
 FAR void *rammap(int fd, size_t length, off_t offset)
 {
   FAR struct fs_rammap_s *map;
+  FAR struct fs_rammapref_s *ref;
+  FAR struct file *filep;
+  FAR struct inode *inode;
   FAR uint8_t *alloc;
   FAR uint8_t *rdbuffer;
+  struct stat buf;
+  uint32_t fileid = 0;
   ssize_t nread;
+  size_t remaining;
   off_t fpos;
+  bool shared;
   int errcode;
   int ret;
 
-  /* There is a major design flaw that I have not yet thought of fix for:
-   * The goal is to have a single region of memory that represents a single
-   * file and can be shared by many threads.  That is, given a filename a
-   * thread should be able to open the file, get a file descriptor, and
-   * call mmap() to get a memory region.  Different file descriptors opened
-   * with the same file path should get the same memory region when mapped.
-   *
-   * The design flaw is that I don't have sufficient knowledge to know that
-   * these different file descriptors map to the same file.  So, for the time
-   * being, a new memory region is created each time that rammap() is called.
-   * Not very useful!
-   */
-
-  /* Allocate a region of memory of the specified size */
+  /* Get the file structure corresponding to the file descriptor. */
 
-  alloc = (FAR uint8_t *)kumm_malloc(sizeof(struct fs_rammap_s) + length);
-  if (!alloc)
+  ret = fs_getfilep(fd, &filep);
+  if (ret < 0)
     {
-      ferr("ERROR: Region allocation failed, length: %d\n", (int)length);
-      errcode = ENOMEM;
+      ferr("ERROR: Invalid file descriptor: %d\n", fd);
+      errcode = -ret;
       goto errout;
     }
 
-  /* Initialize the region */
+  DEBUGASSERT(filep->f_inode != NULL);
+  inode = filep->f_inode;
 
-  map         = (FAR struct fs_rammap_s *)alloc;
-  memset(map, 0, sizeof(struct fs_rammap_s));
-  map->addr   = alloc + sizeof(struct fs_rammap_s);
-  map->length = length;
-  map->offset = offset;
+  /* Different file descriptors opened with the same file path should get
+   * the same memory region when mapped.  A pseudo-file is identified by its
+   * inode.  But all files in a mounted volume share the inode of the
+   * mountpoint; they can be told apart only if the file system supports
+   * FIOC_FILEID.  The size and modification time of the file tell if the
+   * file has changed since an existing copy was made.
+   */
 
-  /* Seek to the specified file offset */
+  shared = true;
+#ifndef CONFIG_DISABLE_MOUNTPOINT
+  if (INODE_IS_MOUNTPT(inode))
+    {
+      ret = file_ioctl(filep, FIOC_FILEID,
+                       (unsigned long)((uintptr_t)&fileid));
+      shared = (ret >= 0);
+    }
+#endif
 
-  fpos = lseek(fd, offset,  SEEK_SET);
-  if (fpos == (off_t)-1)
+  memset(&buf, 0, sizeof(struct stat));
+  if (shared && file_fstat(filep, &buf) < 0)
     {
-      /* Seek failed... errno has already been set, but EINVAL is probably
-       * the correct response.
-       */
+      shared = false;
+    }
+
+  /* Allocate the structure that describes this mapping */
+
+  ref = (FAR struct fs_rammapref_s *)
+    kmm_zalloc(sizeof(struct fs_rammapref_s));
 
-      ferr("ERROR: Seek to position %d failed\n", (int)offset);
-      errcode = EINVAL;
-      goto errout_with_region;
+  if (!ref)
+    {
+      ferr("ERROR: Failed to allocate mapping\n");
+      errcode = ENOMEM;
+      goto errout;
+    }
+
+  rammap_initialize();
+  ret = nxsem_wait(&g_rammaps.exclsem);
+  if (ret < 0)
+    {
+      errcode = -ret;
+      goto errout_with_ref;
     }
 
-  /* Read the file data into the memory region */
+  /* Is there already a copy that holds this region of the file? */
+
+  map = NULL;
+  if (shared)
+    {
+      for (map = g_rammaps.head; map; map = map->flink)
+        {
+          if (map->shared && map->inode == inode && map->fileid == fileid &&
+              map->size == buf.st_size && map->mtime == buf.st_mtime &&
+              offset >= map->offset &&
+              offset + length <= map->offset + map->length)
+            {
+              break;
+            }
+        }
+    }
 
-  rdbuffer = map->addr;
-  while (length > 0)
+  if (map == NULL)
     {
-      nread = nx_read(fd, rdbuffer, length);
-      if (nread < 0)
+      /* No.. Allocate a region of memory of the specified size */
+
+      alloc = (FAR uint8_t *)kumm_malloc(sizeof(struct fs_rammap_s) +
+                                         length);
+      if (!alloc)
         {
-          /* Handle the special case where the read was interrupted by a
-           * signal.
-           */
+          ferr("ERROR: Region allocation failed, length: %d\n",
+               (int)length);
+          errcode = ENOMEM;
+          goto errout_with_semaphore;
+        }
 
-          if (nread != -EINTR)
+      /* Initialize the region */
+
+      map         = (FAR struct fs_rammap_s *)alloc;
+      memset(map, 0, sizeof(struct fs_rammap_s));
+      map->addr   = alloc + sizeof(struct fs_rammap_s);
+      map->length = length;
+      map->offset = offset;
+      map->inode  = inode;
+      map->fileid = fileid;
+      map->size   = buf.st_size;
+      map->mtime  = buf.st_mtime;
+      map->shared = shared;
+
+      /* Read the file data into the memory region.  The file position of
+       * the caller's file descriptor is not changed.
+       */
+
+      rdbuffer  = map->addr;
+      remaining = length;
+      fpos      = offset;
+
+      while (remaining > 0)
+        {
+          nread = file_pread(filep, rdbuffer, remaining, fpos);
+          if (nread < 0)
             {
-              /* All other read errors are bad. */
+              /* Handle the special case where the read was interrupted by a
+               * signal.
+               */
+
+              if (nread != -EINTR)
+                {
+                  /* All other read errors are bad. */
 
-              ferr("ERROR: Read failed: offset=%d errno=%d\n",
-                   (int)offset, (int)nread);
+                  ferr("ERROR: Read failed: offset=%d errno=%d\n",
+                       (int)fpos, (int)nread);
 
-              errcode = (int)-nread;
-              goto errout_with_region;
+                  errcode = (int)-nread;
+                  kumm_free(alloc);
+                  goto errout_with_semaphore;
+                }
+
+              continue;
+            }
+
+          /* Check for end of file. */
+
+          if (nread == 0)
+            {
+              break;
             }
+
+          /* Increment number of bytes read */
+
+          rdbuffer  += nread;
+          remaining -= nread;
+          fpos      += nread;
         }
 
-      /* Check for end of file. */
+      /* Zero any memory beyond the amount read from the file */
+
+      memset(rdbuffer, 0, remaining);
+
+      /* A shared copy keeps the inode so that it cannot be confused with
+       * some other file that reuses the inode structure.
+       */
 
-      if (nread == 0)
+      if (shared)
         {
-          break;
+          inode_addref(inode);
         }
 
-      /* Increment number of bytes read */
+      /* Add the buffer to the list of regions */
 
-      rdbuffer += nread;
-      length   -= nread;
+      map->flink     = g_rammaps.head;
+      g_rammaps.head = map;
     }
 
-  /* Zero any memory beyond the amount read from the file */
-
-  memset(rdbuffer, 0, length);
+  /* Add the mapping to the list of mappings */
 
-  /* Add the buffer to the list of regions */
+  map->crefs++;
 
-  rammap_initialize();
-  ret = nxsem_wait(&g_rammaps.exclsem);
-  if (ret < 0)
-    {
-      errcode = -ret;
-      goto errout_with_region;
-    }
+  ref->map       = map;
+  ref->addr      = (FAR uint8_t *)map->addr + (offset - map->offset);
+  ref->length    = length;
+#ifdef HAVE_TASK_GROUP
+  ref->group     = sched_self()->group;
+#endif
+  ref->flink     = g_rammaps.refs;
+  g_rammaps.refs = ref;
 
-  map->flink  = g_rammaps.head;
-  g_rammaps.head = map;
+  nxsem_post(&g_rammaps.exclsem);
+  return ref->addr;
 
+errout_with_semaphore:
   nxsem_post(&g_rammaps.exclsem);
-  return map->addr;
 
-errout_with_region:
-  kumm_free(alloc);
+errout_with_ref:
+  kmm_free(ref);
 
 errout:
   set_errno(errcode);
   return MAP_FAILED;
 }
 
+/****************************************************************************
+ * Name: rammap_unref
+ *
+ * Description:
+ *   Remove one mapping and free the copy of the file if it was the last
+ *   mapping of it.  The caller must hold g_rammaps.exclsem.
+ *
+ * Input Parameters:
+ *   prev - The mapping that precedes 'ref' in the list (NULL if none)
+ *   ref  - The mapping to remove
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void rammap_unref(FAR struct fs_rammapref_s *prev,
+                  FAR struct fs_rammapref_s *ref)
+{
+  FAR struct fs_rammap_s *map = ref->map;
+  FAR struct fs_rammap_s *mprev;
+  FAR struct fs_rammap_s *curr;
+
+  /* Remove the mapping from the list of mappings */
+
+  if (prev)
+    {
+      prev->flink = ref->flink;
+    }
+  else
+    {
+      g_rammaps.refs = ref->flink;
+    }
+
+  kmm_free(ref);
+
+  /* Was this the last mapping of the copy? */
+
+  DEBUGASSERT(map->crefs > 0);
+  if (--map->crefs > 0)
+    {
+      return;
+    }
+
+  /* Yes.. remove the copy from the list of regions */
+
+  for (mprev = NULL, curr = g_rammaps.head;
+       curr != NULL && curr != map;
+       mprev = curr, curr = curr->flink);
+
+  DEBUGASSERT(curr != NULL);
+  if (mprev)
+    {
+      mprev->flink = map->flink;
+    }
+  else
+    {
+      g_rammaps.head = map->flink;
+    }
+
+  /* Then free the region */
+
+  if (map->shared)
+    {
+      inode_release(map->inode);
+    }
+
+  kumm_free(map);
+}
+
+#ifdef HAVE_TASK_GROUP
+/****************************************************************************
+ * Name: rammap_release
+ *
+ * Description:
+ *   Remove all mappings that belong to a task group.  This is called when
+ *   the last member of the group exits.
+ *
+ * Input Parameters:
+ *   group - The exiting task group
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void rammap_release(FAR struct task_group_s *group)
+{
+  FAR struct fs_rammapref_s *prev;
+  FAR struct fs_rammapref_s *ref;
+  FAR struct fs_rammapref_s *next;
+
+  if (!g_rammaps.initialized)
+    {
+      return;
+    }
+
+  nxsem_wait_uninterruptible(&g_rammaps.exclsem);
+
+  for (prev = NULL, ref = g_rammaps.refs; ref; ref = next)
+    {
+      next = ref->flink;
+      if (ref->group == group)
+        {
+          rammap_unref(prev, ref);
+        }
+      else
+        {
+          prev = ref;
+        }
+    }
+
+  nxsem_post(&g_rammaps.exclsem);
+}
+
+/****************************************************************************
+ * Name: rammap_reparent
+ *
+ * Description:
+ *   Make another task group the owner of a mapping made by the calling
+ *   task.  A program loader uses this so that the mapped image of a program
+ *   stays mapped as long as the program runs, rather than as long as the
+ *   task that loaded it.
+ *
+ * Input Parameters:
+ *   addr  - The address returned by mmap()
+ *   group - The new owner of the mapping
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; -ENOENT is returned if the calling
+ *   task group holds no mapping at addr.
+ *
+ ****************************************************************************/
+
+int rammap_reparent(FAR void *addr, FAR struct task_group_s *group)
+{
+  FAR struct task_group_s *self = sched_self()->group;
+  FAR struct fs_rammapref_s *ref;
+  int ret = -ENOENT;
+
+  rammap_initialize();
+  nxsem_wait_uninterruptible(&g_rammaps.exclsem);
+
+  for (ref = g_rammaps.refs; ref; ref = ref->flink)
+    {
+      if (ref->addr == addr && ref->group == self)
+        {
+          ref->group = group;
+          ret = OK;
+          break;
+        }
+    }
+
+  nxsem_post(&g_rammaps.exclsem);
+  return ret;
+}
+#endif /* HAVE_TASK_GROUP */
+
 #endif /* CONFIG_FS_RAMMAP */
@@ -45,7 +45,12 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <semaphore.h>
+#include <time.h>
+
+#include <nuttx/sched.h>
 
 #ifdef CONFIG_FS_RAMMAP
 
@@ -68,6 +73,10 @@
  * - All mapped files are read-only.  You can write to the in-memory image,
  *   but the file contents will not change.
  * - There are not access privileges.
+ *
+ * One copy is shared by all mappings of the same region of the same file
+ * (see struct fs_rammapref_s).  The copy is freed when the last mapping is
+ * removed.
  */
 
 struct fs_rammap_s
@@ -76,6 +85,27 @@ struct fs_rammap_s
   FAR void           *addr;        /* Start of allocated memory */
   size_t              length;      /* Length of region */
   off_t               offset;      /* File offset */
+  FAR struct inode   *inode;       /* Inode of the file (or its mountpoint) */
+  uint32_t            fileid;      /* File identity within the mountpoint */
+  off_t               size;        /* File size when the copy was made */
+  time_t              mtime;       /* File modification time at that time */
+  uint16_t            crefs;       /* Number of mappings of this copy */
+  bool                shared;      /* True: The copy may be shared */
+};
+
+/* This structure describes one mapping, i.e., one successful call to
+ * mmap().  Each refers to a shared copy of the file.
+ */
+
+struct fs_rammapref_s
+{
+  struct fs_rammapref_s *flink;    /* Implements a singly linked list */
+  FAR struct fs_rammap_s *map;     /* The copy of the file that is mapped */
+  FAR void              *addr;     /* Mapped address returned by mmap() */
+  size_t                 length;   /* Mapped length */
+#ifdef HAVE_TASK_GROUP
+  FAR struct task_group_s *group;  /* Task group that owns the mapping */
+#endif
 };
 
 /* This structure defines all "mapped" files */
@@ -85,6 +115,7 @@ struct fs_allmaps_s
   bool                initialized; /* True: This structure has been initialized */
   sem_t               exclsem;     /* Provides exclusive access the list */
   struct fs_rammap_s *head;        /* List of mapped files */
+  struct fs_rammapref_s *refs;     /* List of mappings */
 };
 
 /****************************************************************************
@@ -142,5 +173,24 @@ void rammap_initialize(void);
 
 FAR void *rammap(int fd, size_t length, off_t offset);
 
+/****************************************************************************
+ * Name: rammap_unref
+ *
+ * Description:
+ *   Remove one mapping and free the copy of the file if it was the last
+ *   mapping of it.  The caller must hold g_rammaps.exclsem.
+ *
+ * Input Parameters:
+ *   prev - The mapping that precedes 'ref' in the list (NULL if none)
+ *   ref  - The mapping to remove
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void rammap_unref(FAR struct fs_rammapref_s *prev,
+                  FAR struct fs_rammapref_s *ref);
+
 #endif /* CONFIG_FS_RAMMAP */
 #endif /* __FS_MMAP_RAMMAP_H */
@@ -122,6 +122,8 @@ EXTERN int  nfs_fsinfo(FAR struct nfsmount *nmp);
 EXTERN int nfs_request(struct nfsmount *nmp, int procnum,
                 FAR void *request, size_t reqlen,
                 FAR void *response, size_t resplen);
+EXTERN int nfs_requestv(FAR struct nfsmount *nmp, int procnum,
+                FAR struct rpc_call_s *calls, int ncalls);
 EXTERN int  nfs_lookup(FAR struct nfsmount *nmp, FAR const char *filename,
               FAR struct file_handle *fhandle,
               FAR struct nfs_fattr *obj_attributes,
@@ -135,6 +137,11 @@ EXTERN int nfs_finddir(FAR struct nfsmount *nmp, FAR const char *relpath,
               FAR struct nfs_fattr *attributes, FAR char *filename);
 EXTERN void nfs_attrupdate(FAR struct nfsnode *np,
               FAR struct nfs_fattr *attributes);
+#ifdef CONFIG_NFS_ATTRCACHE
+EXTERN void nfs_attrcache_invalidate(FAR struct nfsmount *nmp);
+#else
+#  define nfs_attrcache_invalidate(n)
+#endif
 
 #undef EXTERN
 #if defined(__cplusplus)
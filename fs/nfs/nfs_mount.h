@@ -48,7 +48,10 @@
  * Included Files
  ****************************************************************************/
 
+#include <sys/types.h>
 #include <sys/socket.h>
+#include <stdbool.h>
+#include <time.h>
 
 #include "rpc.h"
 
@@ -56,10 +59,63 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+#ifndef CONFIG_NFS_NPIPELINE
+#  define CONFIG_NFS_NPIPELINE 4
+#endif
+
+#ifdef CONFIG_NFS_ATTRCACHE
+#  ifndef CONFIG_NFS_ACTIMEO
+#    define CONFIG_NFS_ACTIMEO 3
+#  endif
+#  ifndef CONFIG_NFS_ACNENTRIES
+#    define CONFIG_NFS_ACNENTRIES 8
+#  endif
+
+/* Longer paths are not held in the attribute cache */
+
+#  define NFS_ACPATHLEN 64
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
 
+/* One slot of pipelined READ or WRITE RPCs.  The I/O buffer holds the
+ * READ reply message or the WRITE call message; the small message holds
+ * the READ call message or the WRITE reply message.  After a READ, the
+ * buffer also serves as read-ahead data for the file 'ns_np'.
+ */
+
+struct nfsnode;
+struct nfs_slot_s
+{
+  union
+  {
+    struct rpc_call_read   read;              /* READ call message */
+    struct rpc_reply_write write;             /* WRITE reply message */
+  } ns_msg;
+
+  FAR struct nfsnode *ns_np;                  /* File that the read data belongs to */
+  off_t              ns_offset;               /* File offset of the read data */
+  uint16_t           ns_len;                  /* Number of bytes of read data */
+  uint16_t           ns_dataoff;              /* Offset to the data in ns_buffer */
+  bool               ns_eof;                  /* The read data ends the file */
+  FAR uint32_t      *ns_buffer;               /* I/O buffer of nm_buflen bytes */
+};
+
+#ifdef CONFIG_NFS_ATTRCACHE
+/* One remembered result of nfs_findnode() */
+
+struct nfs_attrcache_s
+{
+  clock_t            ac_time;                 /* Time when the entry was added */
+  bool               ac_valid;                /* True: entry is in use */
+  struct file_handle ac_fhandle;              /* File handle of the object */
+  struct nfs_fattr   ac_fattr;                /* Attributes of the object */
+  char               ac_path[NFS_ACPATHLEN];  /* Path relative to the mountpoint */
+};
+#endif
+
 /* Mount structure. One mount structure is allocated for each NFS mount. This
  * structure holds NFS specific information for mount.
  */
@@ -84,6 +140,23 @@ struct nfsmount
   uint16_t         nm_readdirsize;            /* Size of a readdir RPC */
   uint16_t         nm_buflen;                 /* Size of I/O buffer */
 
+  /* Pipelined READ/WRITE RPCs */
+
+  struct nfs_slot_s nm_slots[CONFIG_NFS_NPIPELINE];
+  FAR uint8_t     *nm_slotbuffer;             /* Allocated slot I/O buffers */
+
+  /* Written data not yet sent to the server.  The data lies in the WRITE
+   * call messages of the pipeline slots.
+   */
+
+  struct nfsnode  *nm_wbnode;                 /* File that the data belongs to */
+  off_t            nm_wboffset;               /* File offset of the data */
+  size_t           nm_wblen;                  /* Number of bytes of data */
+
+#ifdef CONFIG_NFS_ATTRCACHE
+  struct nfs_attrcache_s nm_attrcache[CONFIG_NFS_ACNENTRIES];
+#endif
+
   /* Set aside memory on the stack to hold the largest call message.  NOTE
    * that for the case of the write call message, it is the reply message that
    * is in this union.
@@ -79,6 +79,9 @@ struct nfsnode
   time_t             n_ctime;       /* File creation time */
   nfsfh_t            n_fhandle;     /* NFS File Handle */
   uint64_t           n_size;        /* Current size of file */
+#ifdef CONFIG_NFS_READAHEAD
+  off_t              n_rdnext;      /* Offset following the last read */
+#endif
 };
 
 #endif /* __FS_NFS_NFS_NODE_H */
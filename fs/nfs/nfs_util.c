@@ -52,6 +52,7 @@
 #include <assert.h>
 #include <debug.h>
 
+#include <nuttx/clock.h>
 #include <nuttx/semaphore.h>
 #include <nuttx/fs/dirent.h>
 
@@ -118,6 +119,139 @@ static inline int nfs_pathsegment(FAR const char **path, FAR char *buffer,
     }
 }
 
+/****************************************************************************
+ * Name: nfs_replystatus
+ *
+ * Description:
+ *   Verify the NFS level status of a reply message.
+ *
+ * Returned Value:
+ *   Zero on success; a positive errno value on failure.  EAGAIN means that
+ *   the request should be sent again.
+ *
+ ****************************************************************************/
+
+static int nfs_replystatus(FAR void *response)
+{
+  struct nfs_reply_header replyh;
+  int error;
+
+  memcpy(&replyh, response, sizeof(struct nfs_reply_header));
+
+  if (replyh.nfs_status != 0)
+    {
+      if (fxdr_unsigned(uint32_t, replyh.nfs_status) > 32)
+        {
+          error = EOPNOTSUPP;
+        }
+      else
+        {
+          /* NFS_ERRORS are the same as NuttX errno values */
+
+          error = fxdr_unsigned(uint32_t, replyh.nfs_status);
+        }
+
+      return error;
+    }
+
+  if (replyh.rpc_verfi.authtype != 0)
+    {
+      error = fxdr_unsigned(int, replyh.rpc_verfi.authtype);
+      if (error != EAGAIN)
+        {
+          ferr("ERROR: NFS error %d from server\n", error);
+        }
+
+      return error;
+    }
+
+  finfo("NFS_SUCCESS\n");
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nfs_attrcache_find
+ *
+ * Description:
+ *   Return the valid, unexpired attribute cache entry for 'relpath' or NULL
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NFS_ATTRCACHE
+static FAR struct nfs_attrcache_s *
+nfs_attrcache_find(FAR struct nfsmount *nmp, FAR const char *relpath)
+{
+  FAR struct nfs_attrcache_s *ac;
+  clock_t now = clock_systimer();
+  int i;
+
+  for (i = 0; i < CONFIG_NFS_ACNENTRIES; i++)
+    {
+      ac = &nmp->nm_attrcache[i];
+      if (ac->ac_valid)
+        {
+          if (now - ac->ac_time >= SEC2TICK(CONFIG_NFS_ACTIMEO))
+            {
+              /* Expired */
+
+              ac->ac_valid = false;
+            }
+          else if (strcmp(ac->ac_path, relpath) == 0)
+            {
+              return ac;
+            }
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: nfs_attrcache_add
+ *
+ * Description:
+ *   Remember the file handle and attributes of 'relpath', replacing the
+ *   oldest entry if the cache is full.
+ *
+ ****************************************************************************/
+
+static void nfs_attrcache_add(FAR struct nfsmount *nmp,
+                              FAR const char *relpath,
+                              FAR struct file_handle *fhandle,
+                              FAR struct nfs_fattr *fattr)
+{
+  FAR struct nfs_attrcache_s *ac;
+  FAR struct nfs_attrcache_s *victim = &nmp->nm_attrcache[0];
+  int i;
+
+  if (strlen(relpath) >= NFS_ACPATHLEN)
+    {
+      return;
+    }
+
+  for (i = 0; i < CONFIG_NFS_ACNENTRIES; i++)
+    {
+      ac = &nmp->nm_attrcache[i];
+      if (!ac->ac_valid)
+        {
+          victim = ac;
+          break;
+        }
+
+      if ((int32_t)(ac->ac_time - victim->ac_time) < 0)
+        {
+          victim = ac;
+        }
+    }
+
+  victim->ac_time  = clock_systimer();
+  victim->ac_valid = true;
+  memcpy(&victim->ac_fhandle, fhandle, sizeof(struct file_handle));
+  memcpy(&victim->ac_fattr, fattr, sizeof(struct nfs_fattr));
+  strcpy(victim->ac_path, relpath);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -204,7 +338,6 @@ int nfs_request(struct nfsmount *nmp, int procnum,
                 FAR void *response, size_t resplen)
 {
   struct rpcclnt *clnt = nmp->nm_rpcclnt;
-  struct nfs_reply_header replyh;
   int error;
 
 tryagain:
@@ -216,39 +349,57 @@ tryagain:
       return error;
     }
 
-  memcpy(&replyh, response, sizeof(struct nfs_reply_header));
-
-  if (replyh.nfs_status != 0)
+  error = nfs_replystatus(response);
+  if (error == EAGAIN)
     {
-      if (fxdr_unsigned(uint32_t, replyh.nfs_status) > 32)
-        {
-          error = EOPNOTSUPP;
-        }
-      else
-        {
-          /* NFS_ERRORS are the same as NuttX errno values */
+      goto tryagain;
+    }
 
-          error = fxdr_unsigned(uint32_t, replyh.nfs_status);
-        }
+  return error;
+}
 
+/****************************************************************************
+ * Name: nfs_requestv
+ *
+ * Description:
+ *   Perform several NFS requests of the same procedure with all of the
+ *   calls outstanding at the same time (see rpcclnt_requestv()).  On
+ *   successful receipt, it verifies the NFS level of each returned value.
+ *
+ * Returned Value:
+ *   Zero on success; a positive errno value if any of the requests failed.
+ *
+ ****************************************************************************/
+
+int nfs_requestv(FAR struct nfsmount *nmp, int procnum,
+                 FAR struct rpc_call_s *calls, int ncalls)
+{
+  int error;
+  int i;
+
+  error = rpcclnt_requestv(nmp->nm_rpcclnt, procnum, NFS_PROG, NFS_VER3,
+                           calls, ncalls);
+  if (error != 0)
+    {
+      ferr("ERROR: rpcclnt_requestv failed: %d\n", error);
       return error;
     }
 
-  if (replyh.rpc_verfi.authtype != 0)
+  for (i = 0; i < ncalls; i++)
     {
-      error = fxdr_unsigned(int, replyh.rpc_verfi.authtype);
-
-      if (error == EAGAIN)
+      error = calls[i].rq_error;
+      if (error == OK)
         {
-          error = 0;
-          goto tryagain;
+          error = nfs_replystatus(calls[i].rq_response);
         }
 
-      ferr("ERROR: NFS error %d from server\n", error);
-      return error;
+      if (error != OK)
+        {
+          ferr("ERROR: Request %d failed: %d\n", i, error);
+          return error;
+        }
     }
 
-  finfo("NFS_SUCCESS\n");
   return OK;
 }
 
@@ -421,6 +572,21 @@ int nfs_findnode(struct nfsmount *nmp, FAR const char *relpath,
       return OK;
     }
 
+#ifdef CONFIG_NFS_ATTRCACHE
+  /* Was this path looked up recently? */
+
+  if (dir_attributes == NULL && obj_attributes != NULL)
+    {
+      FAR struct nfs_attrcache_s *ac = nfs_attrcache_find(nmp, relpath);
+      if (ac != NULL)
+        {
+          memcpy(fhandle, &ac->ac_fhandle, sizeof(struct file_handle));
+          memcpy(obj_attributes, &ac->ac_fattr, sizeof(struct nfs_fattr));
+          return OK;
+        }
+    }
+#endif
+
   /* This is not the root directory. Loop until the directory entry corresponding
    * to the path is found.
    */
@@ -460,6 +626,13 @@ int nfs_findnode(struct nfsmount *nmp, FAR const char *relpath,
            * directory entry is in fhandle, obj_attributes, and dir_attributes.
            */
 
+#ifdef CONFIG_NFS_ATTRCACHE
+          if (obj_attributes != NULL)
+            {
+              nfs_attrcache_add(nmp, relpath, fhandle, obj_attributes);
+            }
+#endif
+
           return OK;
         }
 
@@ -598,3 +771,24 @@ void nfs_attrupdate(FAR struct nfsnode *np, FAR struct nfs_fattr *attributes)
   fxdr_nfsv3time(&attributes->fa_ctime, &ts);
   np->n_ctime  = ts.tv_sec;
 }
+
+/****************************************************************************
+ * Name: nfs_attrcache_invalidate
+ *
+ * Description:
+ *   Discard all cached attributes.  This is called whenever this client
+ *   modifies the file system.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NFS_ATTRCACHE
+void nfs_attrcache_invalidate(FAR struct nfsmount *nmp)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_NFS_ACNENTRIES; i++)
+    {
+      nmp->nm_attrcache[i].ac_valid = false;
+    }
+}
+#endif
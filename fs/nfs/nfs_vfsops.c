@@ -150,6 +150,7 @@ static int     nfs_close(FAR struct file *filep);
 static ssize_t nfs_read(FAR struct file *filep, char *buffer, size_t buflen);
 static ssize_t nfs_write(FAR struct file *filep, const char *buffer,
                    size_t buflen);
+static int     nfs_sync(FAR struct file *filep);
 static int     nfs_dup(FAR const struct file *oldp, FAR struct file *newp);
 static int     nfs_fstat(FAR const struct file *filep, FAR struct stat *buf);
 static int     nfs_truncate(FAR struct file *filep, off_t length);
@@ -194,7 +195,7 @@ const struct mountpt_operations nfs_operations =
   NULL,                         /* seek */
   NULL,                         /* ioctl */
 
-  NULL,                         /* sync */
+  nfs_sync,                     /* sync */
   nfs_dup,                      /* dup */
   nfs_fstat,                    /* fstat */
   nfs_truncate,                 /* truncate */
@@ -219,6 +220,449 @@ const struct mountpt_operations nfs_operations =
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nfs_rdchunk
+ *
+ * Description:
+ *   Return the amount of data that one READ RPC may return:  The server's
+ *   maximum, limited by the size of one I/O buffer.
+ *
+ ****************************************************************************/
+
+static size_t nfs_rdchunk(FAR struct nfsmount *nmp)
+{
+  size_t readsize = nmp->nm_rsize;
+  size_t tmp;
+
+  tmp = SIZEOF_rpc_reply_read(readsize);
+  if (tmp > nmp->nm_buflen)
+    {
+      readsize -= (tmp - nmp->nm_buflen);
+    }
+
+  return readsize;
+}
+
+/****************************************************************************
+ * Name: nfs_wrhdrlen
+ *
+ * Description:
+ *   Return the offset of the data in a WRITE call message for 'np'.  This
+ *   depends on the size of the file handle.
+ *
+ ****************************************************************************/
+
+static size_t nfs_wrhdrlen(FAR struct nfsnode *np)
+{
+  return sizeof(struct rpc_call_header) +
+         sizeof(uint32_t) + uint32_alignup(np->n_fhsize) +  /* File handle */
+         2 * sizeof(uint32_t) +                             /* Offset */
+         3 * sizeof(uint32_t);                  /* Count, stable, length */
+}
+
+/****************************************************************************
+ * Name: nfs_wrchunk
+ *
+ * Description:
+ *   Return the amount of data that one WRITE RPC may send:  The server's
+ *   maximum, limited by the size of one I/O buffer.
+ *
+ ****************************************************************************/
+
+static size_t nfs_wrchunk(FAR struct nfsmount *nmp, FAR struct nfsnode *np)
+{
+  size_t writesize = nmp->nm_buflen - nfs_wrhdrlen(np);
+
+  if (writesize > nmp->nm_wsize)
+    {
+      writesize = nmp->nm_wsize;
+    }
+
+  return writesize & ~3;
+}
+
+/****************************************************************************
+ * Name: nfs_rainvalidate
+ *
+ * Description:
+ *   Discard the read data held in the pipeline slots for 'np' (or for all
+ *   files if 'np' is NULL).
+ *
+ ****************************************************************************/
+
+static void nfs_rainvalidate(FAR struct nfsmount *nmp,
+                             FAR struct nfsnode *np)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_NFS_NPIPELINE; i++)
+    {
+      if (np == NULL || nmp->nm_slots[i].ns_np == np)
+        {
+          nmp->nm_slots[i].ns_np = NULL;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: nfs_wbflush
+ *
+ * Description:
+ *   Send the written data held in the pipeline slots to the server.  One
+ *   WRITE RPC is sent for each slot and all of them are outstanding at the
+ *   same time.
+ *
+ * Returned Value:
+ *   0 on success; a positive errno value on failure.
+ *
+ ****************************************************************************/
+
+static int nfs_wbflush(FAR struct nfsmount *nmp)
+{
+  struct rpc_call_s  calls[CONFIG_NFS_NPIPELINE];
+  FAR struct nfs_slot_s *slot;
+  FAR struct nfsnode *np = nmp->nm_wbnode;
+  FAR uint32_t      *ptr;
+  uint64_t           size;
+  size_t             chunk;
+  size_t             nbytes;
+  size_t             total;
+  size_t             remaining;
+  uint32_t           tmp;
+  int                ncalls;
+  int                error;
+  int                i;
+
+  if (nmp->nm_wblen == 0)
+    {
+      return OK;
+    }
+
+  DEBUGASSERT(np != NULL);
+
+  chunk     = nfs_wrchunk(nmp, np);
+  total     = nmp->nm_wblen;
+  remaining = total;
+
+  for (ncalls = 0; remaining > 0; ncalls++)
+    {
+      slot   = &nmp->nm_slots[ncalls];
+      nbytes = remaining > chunk ? chunk : remaining;
+
+      /* Initialize the WRITE arguments in front of the buffered data.  Here
+       * we need an offset pointer to the write arguments, skipping over the
+       * RPC header.
+       */
+
+      ptr   = (FAR uint32_t *)
+              &((FAR struct rpc_call_write *)slot->ns_buffer)->write;
+
+      /* Copy the variable length, file handle */
+
+      *ptr++ = txdr_unsigned((uint32_t)np->n_fhsize);
+      memcpy(ptr, &np->n_fhandle, np->n_fhsize);
+      ptr   += uint32_increment((int)np->n_fhsize);
+
+      /* Copy the file offset */
+
+      txdr_hyper((uint64_t)(nmp->nm_wboffset + ncalls * chunk), ptr);
+      ptr   += 2;
+
+      /* Copy the count and stable values, and the length of the data */
+
+      *ptr++ = txdr_unsigned(nbytes);
+      *ptr++ = txdr_unsigned(NFSV3WRITE_FILESYNC);
+      *ptr++ = txdr_unsigned(nbytes);
+
+      DEBUGASSERT((FAR uint8_t *)ptr ==
+                  (FAR uint8_t *)slot->ns_buffer + nfs_wrhdrlen(np));
+
+      calls[ncalls].rq_request  = slot->ns_buffer;
+      calls[ncalls].rq_reqlen   = nfs_wrhdrlen(np) -
+                                  sizeof(struct rpc_call_header) +
+                                  uint32_alignup(nbytes);
+      calls[ncalls].rq_response = &slot->ns_msg.write;
+      calls[ncalls].rq_resplen  = sizeof(struct rpc_reply_write);
+
+      nfs_statistics(NFSPROC_WRITE);
+      remaining -= nbytes;
+    }
+
+  /* The buffered data is consumed whether or not the WRITEs succeed */
+
+  nmp->nm_wbnode = NULL;
+  nmp->nm_wblen  = 0;
+
+  nfs_attrcache_invalidate(nmp);
+
+  error = nfs_requestv(nmp, NFSPROC_WRITE, calls, ncalls);
+  if (error)
+    {
+      ferr("ERROR: nfs_requestv failed: %d\n", error);
+      return error;
+    }
+
+  /* The replies may carry the file size as of different points in the
+   * sequence of writes.  The largest size is the right one.
+   */
+
+  size = np->n_size;
+
+  for (i = 0; i < ncalls; i++)
+    {
+      remaining = total - i * chunk;
+      nbytes    = remaining > chunk ? chunk : remaining;
+
+      /* Parse file_wcc.  First, check if WCC attributes follow. */
+
+      ptr = (FAR uint32_t *)&nmp->nm_slots[i].ns_msg.write.write;
+      tmp = *ptr++;
+      if (tmp != 0)
+        {
+          /* Yes.. WCC attributes follow.  But we just skip over them. */
+
+          ptr += uint32_increment(sizeof(struct wcc_attr));
+        }
+
+      /* Check if normal file attributes follow */
+
+      tmp = *ptr++;
+      if (tmp != 0)
+        {
+          /* Yes.. Update the cached file status in the file structure. */
+
+          nfs_attrupdate(np, (FAR struct nfs_fattr *)ptr);
+          if (np->n_size > size)
+            {
+              size = np->n_size;
+            }
+
+          ptr += uint32_increment(sizeof(struct nfs_fattr));
+        }
+
+      /* Get the count of bytes actually written.  A short write is not
+       * retried.
+       */
+
+      tmp = fxdr_unsigned(uint32_t, *ptr);
+      if (tmp != nbytes)
+        {
+          ferr("ERROR: Short write: %u of %u bytes\n", tmp, nbytes);
+          error = EIO;
+        }
+    }
+
+  np->n_size = size;
+  return error;
+}
+
+/****************************************************************************
+ * Name: nfs_rdfill
+ *
+ * Description:
+ *   Read file data beginning at 'pos' into the pipeline slots.  Enough READ
+ *   RPCs are sent to cover 'len' bytes and, if the file is being read
+ *   sequentially, the slots that remain are used to read ahead.  All of the
+ *   READs are outstanding at the same time.
+ *
+ * Returned Value:
+ *   0 on success; a positive errno value on failure.
+ *
+ ****************************************************************************/
+
+static int nfs_rdfill(FAR struct nfsmount *nmp, FAR struct nfsnode *np,
+                      off_t pos, size_t len)
+{
+  struct rpc_call_s  calls[CONFIG_NFS_NPIPELINE];
+  FAR struct nfs_slot_s *slot;
+  FAR uint32_t      *ptr;
+  size_t             chunk;
+  size_t             reqlen;
+  uint64_t           remaining;
+  uint32_t           readsize;
+  uint32_t           tmp;
+  int                ncalls;
+  int                maxcalls;
+  int                error;
+  int                i;
+
+  chunk  = nfs_rdchunk(nmp);
+  ncalls = (len + chunk - 1) / chunk;
+
+#ifdef CONFIG_NFS_READAHEAD
+  /* Read ahead if this read continues where the last one ended */
+
+  if (np->n_rdnext == pos)
+    {
+      ncalls = CONFIG_NFS_NPIPELINE;
+    }
+#endif
+
+  /* But don't read beyond the end of the file */
+
+  remaining = np->n_size - pos;
+  maxcalls  = (remaining + chunk - 1) / chunk;
+
+  if (ncalls > maxcalls)
+    {
+      ncalls = maxcalls;
+    }
+
+  if (ncalls > CONFIG_NFS_NPIPELINE)
+    {
+      ncalls = CONFIG_NFS_NPIPELINE;
+    }
+
+  if (ncalls < 1)
+    {
+      ncalls = 1;
+    }
+
+  /* All slots are about to be reused */
+
+  nfs_rainvalidate(nmp, NULL);
+
+  for (i = 0; i < ncalls; i++)
+    {
+      slot    = &nmp->nm_slots[i];
+
+      /* Initialize the request */
+
+      ptr     = (FAR uint32_t *)&slot->ns_msg.read.read;
+      reqlen  = 0;
+
+      /* Copy the variable length, file handle */
+
+      *ptr++  = txdr_unsigned((uint32_t)np->n_fhsize);
+      reqlen += sizeof(uint32_t);
+
+      memcpy(ptr, &np->n_fhandle, np->n_fhsize);
+      reqlen += (int)np->n_fhsize;
+      ptr    += uint32_increment((int)np->n_fhsize);
+
+      /* Copy the file offset */
+
+      txdr_hyper((uint64_t)(pos + i * chunk), ptr);
+      ptr    += 2;
+      reqlen += 2*sizeof(uint32_t);
+
+      /* Set the readsize */
+
+      *ptr    = txdr_unsigned(chunk);
+      reqlen += sizeof(uint32_t);
+
+      calls[i].rq_request  = &slot->ns_msg.read;
+      calls[i].rq_reqlen   = reqlen;
+      calls[i].rq_response = slot->ns_buffer;
+      calls[i].rq_resplen  = nmp->nm_buflen;
+
+      nfs_statistics(NFSPROC_READ);
+    }
+
+  /* Perform the reads */
+
+  finfo("Reading %d x %d bytes\n", ncalls, chunk);
+  error = nfs_requestv(nmp, NFSPROC_READ, calls, ncalls);
+  if (error)
+    {
+      ferr("ERROR: nfs_requestv failed: %d\n", error);
+      return error;
+    }
+
+  for (i = 0; i < ncalls; i++)
+    {
+      slot = &nmp->nm_slots[i];
+
+      /* The read was successful.  Get a pointer to the beginning of the NFS
+       * response data.
+       */
+
+      ptr = (FAR uint32_t *)
+            &((FAR struct rpc_reply_read *)slot->ns_buffer)->read;
+
+      /* Check if attributes are included in the responses */
+
+      tmp = *ptr++;
+      if (tmp != 0)
+        {
+          /* Yes... just skip over the attributes for now */
+
+          ptr += uint32_increment(sizeof(struct nfs_fattr));
+        }
+
+      /* This is followed by the count of data read.  Isn't this
+       * the same as the length that is included in the read data?
+       *
+       * Just skip over if for now.
+       */
+
+      ptr++;
+
+      /* Next comes an EOF indication */
+
+      slot->ns_eof = (*ptr++ != 0);
+
+      /* Then the length of the read data followed by the read data itself */
+
+      readsize = fxdr_unsigned(uint32_t, *ptr);
+      ptr++;
+
+      if (readsize > chunk)
+        {
+          return EIO;
+        }
+
+      slot->ns_np      = np;
+      slot->ns_offset  = pos + i * chunk;
+      slot->ns_len     = readsize;
+      slot->ns_dataoff = (FAR uint8_t *)ptr - (FAR uint8_t *)slot->ns_buffer;
+
+      /* Data beyond an EOF or short read is not valid */
+
+      if (slot->ns_eof || readsize < chunk)
+        {
+          break;
+        }
+    }
+
+  /* Invalidate any slots after a short read */
+
+  for (i++; i < ncalls; i++)
+    {
+      nmp->nm_slots[i].ns_np = NULL;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nfs_rdfind
+ *
+ * Description:
+ *   Return the pipeline slot holding read data at 'pos' for 'np', or NULL.
+ *
+ ****************************************************************************/
+
+static FAR struct nfs_slot_s *nfs_rdfind(FAR struct nfsmount *nmp,
+                                         FAR struct nfsnode *np, off_t pos)
+{
+  FAR struct nfs_slot_s *slot;
+  int i;
+
+  for (i = 0; i < CONFIG_NFS_NPIPELINE; i++)
+    {
+      slot = &nmp->nm_slots[i];
+      if (slot->ns_np == np && pos >= slot->ns_offset &&
+          (pos < slot->ns_offset + slot->ns_len ||
+           (slot->ns_eof && pos == slot->ns_offset + slot->ns_len)))
+        {
+          return slot;
+        }
+    }
+
+  return NULL;
+}
+
 /****************************************************************************
  * Name: nfs_filecreate
  *
@@ -347,6 +791,7 @@ static int nfs_filecreate(FAR struct nfsmount *nmp, FAR struct nfsnode *np,
   do
     {
       nfs_statistics(NFSPROC_CREATE);
+      nfs_attrcache_invalidate(nmp);
       error = nfs_request(nmp, NFSPROC_CREATE,
                           (FAR void *)&nmp->nm_msgbuffer.create, reqlen,
                           (FAR void *)nmp->nm_iobuffer, nmp->nm_buflen);
@@ -453,6 +898,7 @@ static int nfs_filetruncate(FAR struct nfsmount *nmp,
   /* Perform the SETATTR RPC */
 
   nfs_statistics(NFSPROC_SETATTR);
+  nfs_attrcache_invalidate(nmp);
   error = nfs_request(nmp, NFSPROC_SETATTR,
                       (FAR void *)&nmp->nm_msgbuffer.setattr, reqlen,
                       (FAR void *)nmp->nm_iobuffer, nmp->nm_buflen);
@@ -705,6 +1151,7 @@ static int nfs_close(FAR struct file *filep)
   FAR struct nfsnode  *np;
   FAR struct nfsnode  *prev;
   FAR struct nfsnode  *curr;
+  int error;
   int ret;
 
   /* Sanity checks */
@@ -722,6 +1169,14 @@ static int nfs_close(FAR struct file *filep)
 
   nfs_semtake(nmp);
 
+  /* Send any written data that is still held for this file */
+
+  error = OK;
+  if (nmp->nm_wbnode == np)
+    {
+      error = nfs_wbflush(nmp);
+    }
+
   /* Decrement the reference count.  If the reference count would not
    * decrement to zero, then that is all we have to do.
    */
@@ -770,6 +1225,7 @@ static int nfs_close(FAR struct file *filep)
 
               /* Then deallocate the file structure and return success */
 
+              nfs_rainvalidate(nmp, np);
               kmm_free(np);
               ret = OK;
               break;
@@ -777,6 +1233,11 @@ static int nfs_close(FAR struct file *filep)
         }
     }
 
+  if (ret == OK && error != OK)
+    {
+      ret = -error;
+    }
+
   filep->f_priv = NULL;
   nfs_semgive(nmp);
   return ret;
@@ -795,11 +1256,10 @@ static ssize_t nfs_read(FAR struct file *filep, char *buffer, size_t buflen)
 {
   FAR struct nfsmount       *nmp;
   FAR struct nfsnode        *np;
+  FAR struct nfs_slot_s     *slot;
   ssize_t                    readsize;
   ssize_t                    tmp;
   ssize_t                    bytesread;
-  size_t                     reqlen;
-  FAR uint32_t              *ptr;
   int                        error = 0;
 
   finfo("Read %d bytes from offset %d\n", buflen, filep->f_pos);
@@ -825,6 +1285,17 @@ static ssize_t nfs_read(FAR struct file *filep, char *buffer, size_t buflen)
       goto errout_with_semaphore;
     }
 
+  /* The pipeline slots are needed for reading, so any written data that
+   * they hold must be sent first.
+   */
+
+  error = nfs_wbflush(nmp);
+  if (error != OK)
+    {
+      ferr("ERROR: nfs_wbflush failed: %d\n", error);
+      goto errout_with_semaphore;
+    }
+
   /* Get the number of bytes left in the file and truncate read count so that
    * it does not exceed the number of bytes left in the file.
    */
@@ -840,96 +1311,40 @@ static ssize_t nfs_read(FAR struct file *filep, char *buffer, size_t buflen)
 
   for (bytesread = 0; bytesread < buflen; )
     {
-      /* Make sure that the attempted read size does not exceed the RPC maximum */
+      /* Is the data at the file position already in a pipeline slot? */
 
-      readsize = buflen - bytesread;
-      if (readsize > nmp->nm_rsize)
+      slot = nfs_rdfind(nmp, np, filep->f_pos);
+      if (slot == NULL)
         {
-          readsize = nmp->nm_rsize;
-        }
-
-      /* Make sure that the attempted read size does not exceed the IO buffer size */
-
-      tmp = SIZEOF_rpc_reply_read(readsize);
-      if (tmp > nmp->nm_buflen)
-        {
-          readsize -= (tmp - nmp->nm_buflen);
-        }
-
-      /* Initialize the request */
-
-      ptr     = (FAR uint32_t *)&nmp->nm_msgbuffer.read.read;
-      reqlen  = 0;
-
-      /* Copy the variable length, file handle */
-
-      *ptr++  = txdr_unsigned((uint32_t)np->n_fhsize);
-      reqlen += sizeof(uint32_t);
-
-      memcpy(ptr, &np->n_fhandle, np->n_fhsize);
-      reqlen += (int)np->n_fhsize;
-      ptr    += uint32_increment((int)np->n_fhsize);
-
-      /* Copy the file offset */
-
-      txdr_hyper((uint64_t)filep->f_pos, ptr);
-      ptr += 2;
-      reqlen += 2*sizeof(uint32_t);
-
-      /* Set the readsize */
+          /* No.. read it (and perhaps more) from the server */
 
-      *ptr = txdr_unsigned(readsize);
-      reqlen += sizeof(uint32_t);
+          error = nfs_rdfill(nmp, np, filep->f_pos, buflen - bytesread);
+          if (error != OK)
+            {
+              ferr("ERROR: nfs_rdfill failed: %d\n", error);
+              goto errout_with_semaphore;
+            }
 
-      /* Perform the read */
+          slot = nfs_rdfind(nmp, np, filep->f_pos);
+          if (slot == NULL)
+            {
+              /* The server returned nothing at this position */
 
-      finfo("Reading %d bytes\n", readsize);
-      nfs_statistics(NFSPROC_READ);
-      error = nfs_request(nmp, NFSPROC_READ,
-                          (FAR void *)&nmp->nm_msgbuffer.read, reqlen,
-                          (FAR void *)nmp->nm_iobuffer, nmp->nm_buflen);
-      if (error)
-        {
-          ferr("ERROR: nfs_request failed: %d\n", error);
-          goto errout_with_semaphore;
+              break;
+            }
         }
 
-      /* The read was successful.  Get a pointer to the beginning of the NFS
-       * response data.
-       */
-
-      ptr = (FAR uint32_t *)&((FAR struct rpc_reply_read *)nmp->nm_iobuffer)->read;
-
-      /* Check if attributes are included in the responses */
+      /* Copy the read data into the user buffer */
 
-      tmp = *ptr++;
-      if (*ptr != 0)
+      tmp      = filep->f_pos - slot->ns_offset;
+      readsize = slot->ns_len - tmp;
+      if (readsize > buflen - bytesread)
         {
-          /* Yes... just skip over the attributes for now */
-
-          ptr += uint32_increment(sizeof(struct nfs_fattr));
+          readsize = buflen - bytesread;
         }
 
-      /* This is followed by the count of data read.  Isn't this
-       * the same as the length that is included in the read data?
-       *
-       * Just skip over if for now.
-       */
-
-      ptr++;
-
-      /* Next comes an EOF indication.  Save that in tmp for now. */
-
-      tmp = *ptr++;
-
-      /* Then the length of the read data followed by the read data itself */
-
-      readsize = fxdr_unsigned(uint32_t, *ptr);
-      ptr++;
-
-      /* Copy the read data into the user buffer */
-
-      memcpy(buffer, ptr, readsize);
+      memcpy(buffer, (FAR uint8_t *)slot->ns_buffer + slot->ns_dataoff + tmp,
+             readsize);
 
       /* Update the read state data */
 
@@ -939,12 +1354,19 @@ static ssize_t nfs_read(FAR struct file *filep, char *buffer, size_t buflen)
 
       /* Check if we hit the end of file */
 
-      if (tmp != 0)
+      if (readsize == 0 ||
+          (slot->ns_eof && filep->f_pos >= slot->ns_offset + slot->ns_len))
         {
           break;
         }
     }
 
+#ifdef CONFIG_NFS_READAHEAD
+  /* Remember where a sequential reader will continue */
+
+  np->n_rdnext = filep->f_pos;
+#endif
+
   finfo("Read %d bytes\n", bytesread);
   nfs_semgive(nmp);
   return bytesread;
@@ -957,6 +1379,11 @@ errout_with_semaphore:
 /****************************************************************************
  * Name: nfs_write
  *
+ * Description:
+ *   Copy the user data into the WRITE call messages of the pipeline slots.
+ *   The data is sent when all slots are full or, unless write-behind is
+ *   enabled, before returning.
+ *
  * Returned Value:
  *   The (non-negative) number of bytes written on success; a negated errno
  *   value on failure.
@@ -969,13 +1396,10 @@ static ssize_t nfs_write(FAR struct file *filep, const char *buffer,
   struct nfsmount       *nmp;
   struct nfsnode        *np;
   ssize_t                writesize;
-  ssize_t                bufsize;
   ssize_t                byteswritten;
-  size_t                 reqlen;
-  FAR uint32_t          *ptr;
-  uint32_t               tmp;
-  int                    commit = 0;
-  int                    committed = NFSV3WRITE_FILESYNC;
+  size_t                 chunk;
+  size_t                 offset;
+  int                    ndx;
   int                    error;
 
   finfo("Write %d bytes to offset %d\n", buflen, filep->f_pos);
@@ -1009,137 +1433,134 @@ static ssize_t nfs_write(FAR struct file *filep, const char *buffer,
       goto errout_with_semaphore;
     }
 
-  /* Now loop until we send the entire user buffer */
+  /* Buffered data can only be extended if it belongs to this file and ends
+   * at the current file position.
+   */
 
-  writesize = 0;
-  for (byteswritten = 0; byteswritten < buflen; )
+  if (nmp->nm_wblen > 0 &&
+      (nmp->nm_wbnode != np ||
+       nmp->nm_wboffset + nmp->nm_wblen != filep->f_pos))
     {
-      /* Make sure that the attempted write size does not exceed the RPC maximum */
-
-      writesize = buflen;
-      if (writesize > nmp->nm_wsize)
-        {
-          writesize = nmp->nm_wsize;
-        }
-
-      /* Make sure that the attempted read size does not exceed the IO buffer size */
-
-      bufsize = SIZEOF_rpc_call_write(writesize);
-      if (bufsize > nmp->nm_buflen)
+      error = nfs_wbflush(nmp);
+      if (error != OK)
         {
-          writesize -= (bufsize - nmp->nm_buflen);
+          ferr("ERROR: nfs_wbflush failed: %d\n", error);
+          goto errout_with_semaphore;
         }
+    }
 
-      /* Initialize the request.  Here we need an offset pointer to the write
-       * arguments, skipping over the RPC header.  Write is unique among the
-       * RPC calls in that the entry RPC calls messasge lies in the I/O buffer
-       */
-
-      ptr     = (FAR uint32_t *)&((FAR struct rpc_call_write *)nmp->nm_iobuffer)->write;
-      reqlen  = 0;
-
-      /* Copy the variable length, file handle */
+  /* The slots will now hold write data, not read-ahead data */
 
-      *ptr++  = txdr_unsigned((uint32_t)np->n_fhsize);
-      reqlen += sizeof(uint32_t);
+  nfs_rainvalidate(nmp, NULL);
 
-      memcpy(ptr, &np->n_fhandle, np->n_fhsize);
-      reqlen += (int)np->n_fhsize;
-      ptr    += uint32_increment((int)np->n_fhsize);
+  /* Now loop until the entire user buffer has been taken */
 
-      /* Copy the file offset */
+  chunk = nfs_wrchunk(nmp, np);
+  for (byteswritten = 0; byteswritten < buflen; )
+    {
+      if (nmp->nm_wblen == 0)
+        {
+          nmp->nm_wbnode   = np;
+          nmp->nm_wboffset = filep->f_pos;
+        }
 
-      txdr_hyper((uint64_t)filep->f_pos, ptr);
-      ptr    += 2;
-      reqlen += 2*sizeof(uint32_t);
+      /* Find the slot and the offset in the slot for the next byte */
 
-      /* Copy the count and stable values */
+      ndx    = nmp->nm_wblen / chunk;
+      offset = nmp->nm_wblen % chunk;
 
-      *ptr++  = txdr_unsigned(buflen);
-      *ptr++  = txdr_unsigned(committed);
-      reqlen += 2*sizeof(uint32_t);
+      if (ndx >= CONFIG_NFS_NPIPELINE)
+        {
+          /* All slots are full.  Send them. */
 
-      /* Copy a chunk of the user data into the I/O buffer */
+          error = nfs_wbflush(nmp);
+          if (error != OK)
+            {
+              ferr("ERROR: nfs_wbflush failed: %d\n", error);
+              goto errout_with_semaphore;
+            }
 
-      *ptr++  = txdr_unsigned(buflen);
-      reqlen += sizeof(uint32_t);
-      memcpy(ptr, buffer, writesize);
-      reqlen += uint32_alignup(writesize);
+          continue;
+        }
 
-      /* Perform the write */
+      /* Copy user data into the data area of the WRITE call message */
 
-      nfs_statistics(NFSPROC_WRITE);
-      error = nfs_request(nmp, NFSPROC_WRITE,
-                          (FAR void *)nmp->nm_iobuffer, reqlen,
-                          (FAR void *)&nmp->nm_msgbuffer.write, sizeof(struct rpc_reply_write));
-      if (error)
+      writesize = chunk - offset;
+      if (writesize > buflen - byteswritten)
         {
-          ferr("ERROR: nfs_request failed: %d\n", error);
-          goto errout_with_semaphore;
+          writesize = buflen - byteswritten;
         }
 
-      /* Get a pointer to the WRITE reply data */
+      memcpy((FAR uint8_t *)nmp->nm_slots[ndx].ns_buffer +
+             nfs_wrhdrlen(np) + offset, buffer, writesize);
 
-      ptr = (FAR uint32_t *)&nmp->nm_msgbuffer.write.write;
+      /* Update the write state data */
 
-      /* Parse file_wcc.  First, check if WCC attributes follow. */
+      nmp->nm_wblen += writesize;
+      filep->f_pos  += writesize;
+      byteswritten  += writesize;
+      buffer        += writesize;
 
-      tmp = *ptr++;
-      if (tmp != 0)
+      if (filep->f_pos > np->n_size)
         {
-          /* Yes.. WCC attributes follow.  But we just skip over them. */
-
-          ptr += uint32_increment(sizeof(struct wcc_attr));
+          np->n_size = filep->f_pos;
         }
+    }
 
-      /* Check if normal file attributes follow */
+#ifndef CONFIG_NFS_WRITEBEHIND
+  /* Send the data now */
 
-      tmp = *ptr++;
-      if (tmp != 0)
-        {
-          /* Yes.. Update the cached file status in the file structure. */
+  error = nfs_wbflush(nmp);
+  if (error != OK)
+    {
+      ferr("ERROR: nfs_wbflush failed: %d\n", error);
+      goto errout_with_semaphore;
+    }
+#endif
 
-          nfs_attrupdate(np, (FAR struct nfs_fattr *)ptr);
-          ptr += uint32_increment(sizeof(struct nfs_fattr));
-        }
+  nfs_semgive(nmp);
+  return byteswritten;
 
-      /* Get the count of bytes actually written */
+errout_with_semaphore:
+  nfs_semgive(nmp);
+  return -error;
+}
 
-      tmp = fxdr_unsigned(uint32_t, *ptr);
-      ptr++;
+/****************************************************************************
+ * Name: nfs_sync
+ *
+ * Description:
+ *   Send any written data that is still held for this file to the server.
+ *
+ * Returned Value:
+ *   0 on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
 
-      if (tmp < 1 || tmp > writesize)
-        {
-           error = EIO;
-           goto errout_with_semaphore;
-        }
+static int nfs_sync(FAR struct file *filep)
+{
+  FAR struct nfsmount *nmp;
+  FAR struct nfsnode  *np;
+  int error;
 
-      writesize = tmp;
+  /* Sanity checks */
 
-      /* Determine the lowest committment level obtained by any of the RPCs. */
+  DEBUGASSERT(filep->f_priv != NULL && filep->f_inode != NULL);
 
-      commit = *ptr++;
-      if (committed == NFSV3WRITE_FILESYNC)
-        {
-          committed = commit;
-        }
-      else if (committed == NFSV3WRITE_DATASYNC &&
-               commit == NFSV3WRITE_UNSTABLE)
-        {
-          committed = commit;
-        }
+  /* Recover our private data from the struct file instance */
 
-      /* Update the read state data */
+  nmp = (FAR struct nfsmount *)filep->f_inode->i_private;
+  np  = (FAR struct nfsnode *)filep->f_priv;
 
-      filep->f_pos += writesize;
-      byteswritten += writesize;
-      buffer       += writesize;
-    }
+  DEBUGASSERT(nmp != NULL);
 
-  nfs_semgive(nmp);
-  return writesize;
+  nfs_semtake(nmp);
+  error = nfs_checkmount(nmp);
+  if (error == OK && nmp->nm_wbnode == np)
+    {
+      error = nfs_wbflush(nmp);
+    }
 
-errout_with_semaphore:
   nfs_semgive(nmp);
   return -error;
 }
@@ -1313,6 +1734,22 @@ static int nfs_truncate(FAR struct file *filep, off_t length)
       goto errout_with_semaphore;
     }
 
+  /* Send any data written before the truncation and discard read-ahead
+   * data that may no longer exist.
+   */
+
+  if (nmp->nm_wbnode == np)
+    {
+      error = nfs_wbflush(nmp);
+      if (error != OK)
+        {
+          ferr("ERROR: nfs_wbflush failed: %d\n", error);
+          goto errout_with_semaphore;
+        }
+    }
+
+  nfs_rainvalidate(nmp, np);
+
   /* Then perform the SETATTR RPC to set the new file size */
 
   error = nfs_filetruncate(nmp, np, length);
@@ -1834,8 +2271,10 @@ static int nfs_bind(FAR struct inode *blkdriver, FAR const void *data,
   struct rpc_reply_getattr    resok;
   struct nfs_mount_parameters nprmt;
   uint32_t                    buflen;
+  uint32_t                    stride;
   uint32_t                    tmp;
   int                         error = 0;
+  int                         i;
 
   DEBUGASSERT(data && handle);
 
@@ -1891,6 +2330,27 @@ static int nfs_bind(FAR struct inode *blkdriver, FAR const void *data,
 
   nmp->nm_buflen = (uint16_t)buflen;
 
+  /* Allocate one I/O buffer for each pipeline slot.  These hold READ
+   * replies and WRITE calls while several RPCs are outstanding.
+   */
+
+  stride = uint32_alignup(buflen);
+  nmp->nm_slotbuffer = (FAR uint8_t *)
+    kmm_malloc(CONFIG_NFS_NPIPELINE * stride);
+
+  if (!nmp->nm_slotbuffer)
+    {
+      ferr("ERROR: Failed to allocate pipeline buffers\n");
+      kmm_free(nmp);
+      return ENOMEM;
+    }
+
+  for (i = 0; i < CONFIG_NFS_NPIPELINE; i++)
+    {
+      nmp->nm_slots[i].ns_buffer =
+        (FAR uint32_t *)(nmp->nm_slotbuffer + i * stride);
+    }
+
   /* Initialize the allocated mountpt state structure. */
 
   /* Initialize the semaphore that controls access.  The initial count
@@ -2007,6 +2467,7 @@ bad:
           kmm_free(nmp->nm_rpcclnt);
         }
 
+      kmm_free(nmp->nm_slotbuffer);
       kmm_free(nmp);
     }
 
@@ -2072,6 +2533,7 @@ static int nfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
   nxsem_destroy(&nmp->nm_sem);
   kmm_free(nmp->nm_so);
   kmm_free(nmp->nm_rpcclnt);
+  kmm_free(nmp->nm_slotbuffer);
   kmm_free(nmp);
 
   return -error;
@@ -2322,6 +2784,7 @@ static int nfs_remove(struct inode *mountpt, const char *relpath)
   /* Perform the REMOVE RPC call */
 
   nfs_statistics(NFSPROC_REMOVE);
+  nfs_attrcache_invalidate(nmp);
   error = nfs_request(nmp, NFSPROC_REMOVE,
                       (FAR void *)&nmp->nm_msgbuffer.removef, reqlen,
                       (FAR void *)nmp->nm_iobuffer, nmp->nm_buflen);
@@ -2445,6 +2908,7 @@ static int nfs_mkdir(struct inode *mountpt, const char *relpath, mode_t mode)
   /* Perform the MKDIR RPC */
 
   nfs_statistics(NFSPROC_MKDIR);
+  nfs_attrcache_invalidate(nmp);
   error = nfs_request(nmp, NFSPROC_MKDIR,
                       (FAR void *)&nmp->nm_msgbuffer.mkdir, reqlen,
                       (FAR void *)&nmp->nm_iobuffer, nmp->nm_buflen);
@@ -2534,6 +2998,7 @@ static int nfs_rmdir(struct inode *mountpt, const char *relpath)
   /* Perform the RMDIR RPC */
 
   nfs_statistics(NFSPROC_RMDIR);
+  nfs_attrcache_invalidate(nmp);
   error = nfs_request(nmp, NFSPROC_RMDIR,
                           (FAR void *)&nmp->nm_msgbuffer.rmdir, reqlen,
                           (FAR void *)nmp->nm_iobuffer, nmp->nm_buflen);
@@ -2651,6 +3116,7 @@ static int nfs_rename(struct inode *mountpt, const char *oldrelpath,
   /* Perform the RENAME RPC */
 
   nfs_statistics(NFSPROC_RENAME);
+  nfs_attrcache_invalidate(nmp);
   error = nfs_request(nmp, NFSPROC_RENAME,
                       (FAR void *)&nmp->nm_msgbuffer.renamef, reqlen,
                       (FAR void *)nmp->nm_iobuffer, nmp->nm_buflen);
@@ -2783,6 +3249,15 @@ static int nfs_stat(struct inode *mountpt, const char *relpath,
       goto errout_with_semaphore;
     }
 
+  /* The server must see any buffered writes before it reports the size */
+
+  error = nfs_wbflush(nmp);
+  if (error != OK)
+    {
+      ferr("ERROR: nfs_wbflush failed: %d\n", error);
+      goto errout_with_semaphore;
+    }
+
   /* Get the file handle attributes of the requested node */
 
   error = nfs_findnode(nmp, relpath, &fhandle, &obj_attributes, NULL);
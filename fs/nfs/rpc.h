@@ -473,6 +473,19 @@ struct rpc_reply_setattr
   struct SETATTR3resok setattr;
 };
 
+/* One CALL of a pipelined RPC request.  See rpcclnt_requestv(). */
+
+struct rpc_call_s
+{
+  FAR void *rq_request;       /* CALL message with room for the RPC header */
+  size_t    rq_reqlen;        /* Length of the CALL data after the header */
+  FAR void *rq_response;      /* Buffer to receive the reply message */
+  size_t    rq_resplen;       /* Size of the reply buffer */
+  uint32_t  rq_xid;           /* Transaction ID of the CALL */
+  int       rq_error;         /* RPC level status of the reply */
+  bool      rq_done;          /* A reply has been received */
+};
+
 struct  rpcclnt
 {
   nfsfh_t  rc_fh;             /* File handle of the root directory */
@@ -500,5 +513,7 @@ void rpcclnt_safedisconnect(FAR struct rpcclnt *rpc);
 int  rpcclnt_request(FAR struct rpcclnt *rpc, int procnum, int prog, int version,
                      FAR void *request, size_t reqlen,
                      FAR void *response, size_t resplen);
+int  rpcclnt_requestv(FAR struct rpcclnt *rpc, int procnum, int prog,
+                      int version, FAR struct rpc_call_s *calls, int ncalls);
 
 #endif /* __FS_NFS_RPC_H */
@@ -136,9 +136,11 @@ static struct rpcstats rpcstats;
 static int rpcclnt_send(FAR struct rpcclnt *rpc, int procid, int prog,
                         FAR void *call, int reqlen);
 static int rpcclnt_receive(FAR struct rpcclnt *rpc, struct sockaddr *aname,
-                           int proc, int program, void *reply, size_t resplen);
-static int rpcclnt_reply(FAR struct rpcclnt *rpc, int procid, int prog,
-                         void *reply, size_t resplen);
+                           void *reply, size_t resplen,
+                           FAR size_t *nrecvd);
+static int rpcclnt_reply(FAR struct rpcclnt *rpc, void *reply,
+                         size_t resplen, FAR size_t *nrecvd);
+static int rpcclnt_checkreply(FAR void *response);
 static uint32_t rpcclnt_newxid(void);
 static void rpcclnt_fmtheader(FAR struct rpc_call_header *ch,
                               uint32_t xid, int procid, int prog, int vers);
@@ -193,8 +195,8 @@ static int rpcclnt_send(FAR struct rpcclnt *rpc, int procid, int prog,
  ****************************************************************************/
 
 static int rpcclnt_receive(FAR struct rpcclnt *rpc, FAR struct sockaddr *aname,
-                           int proc, int program, FAR void *reply,
-                           size_t resplen)
+                           FAR void *reply, size_t resplen,
+                           FAR size_t *nrecvd)
 {
   ssize_t nbytes;
   int error = 0;
@@ -206,6 +208,10 @@ static int rpcclnt_receive(FAR struct rpcclnt *rpc, FAR struct sockaddr *aname,
       error = (int)-nbytes;
       ferr("ERROR: psock_recvfrom failed: %d\n", error);
     }
+  else
+    {
+      *nrecvd = (size_t)nbytes;
+    }
 
   return error;
 }
@@ -214,18 +220,19 @@ static int rpcclnt_receive(FAR struct rpcclnt *rpc, FAR struct sockaddr *aname,
  * Name: rpcclnt_reply
  *
  * Description:
- *   Received the RPC reply on the socket.
+ *   Received the next RPC reply on the socket.  The caller must match the
+ *   transaction ID of the reply with its outstanding calls.
  *
  ****************************************************************************/
 
-static int rpcclnt_reply(FAR struct rpcclnt *rpc, int procid, int prog,
-                         FAR void *reply, size_t resplen)
+static int rpcclnt_reply(FAR struct rpcclnt *rpc, FAR void *reply,
+                         size_t resplen, FAR size_t *nrecvd)
 {
   int error;
 
   /* Get the next RPC reply from the socket */
 
-  error = rpcclnt_receive(rpc, rpc->rc_name, procid, prog, reply, resplen);
+  error = rpcclnt_receive(rpc, rpc->rc_name, reply, resplen, nrecvd);
   if (error != 0)
     {
       ferr("ERROR: rpcclnt_receive returned: %d\n", error);
@@ -247,7 +254,8 @@ static int rpcclnt_reply(FAR struct rpcclnt *rpc, int procid, int prog,
       FAR struct rpc_reply_header *replyheader =
         (FAR struct rpc_reply_header *)reply;
 
-      if (replyheader->rp_direction != rpc_reply)
+      if (*nrecvd < 2 * sizeof(uint32_t) ||
+          replyheader->rp_direction != rpc_reply)
         {
           ferr("ERROR: Different RPC REPLY returned\n");
           rpc_statistics(rpcinvalid);
@@ -323,6 +331,69 @@ static void rpcclnt_fmtheader(FAR struct rpc_call_header *ch,
   ch->rpc_verf.authlen   = 0;
 }
 
+/****************************************************************************
+ * Name: rpcclnt_checkreply
+ *
+ * Description:
+ *   Verify the RPC level of a received reply message.  (There may still be
+ *   be NFS layer errors that will be deted by calling logic).
+ *
+ * Returned Value:
+ *   Zero on success; a positive errno value on failure.
+ *
+ ****************************************************************************/
+
+static int rpcclnt_checkreply(FAR void *response)
+{
+  FAR struct rpc_reply_header *replymsg;
+  uint32_t tmp;
+
+  /* Break down the RPC header and check if it is OK */
+
+  replymsg = (FAR struct rpc_reply_header *)response;
+
+  tmp = fxdr_unsigned(uint32_t, replymsg->type);
+  if (tmp == RPC_MSGDENIED)
+    {
+      tmp = fxdr_unsigned(uint32_t, replymsg->status);
+      switch (tmp)
+        {
+        case RPC_MISMATCH:
+          ferr("ERROR: RPC_MSGDENIED: RPC_MISMATCH error\n");
+          return EOPNOTSUPP;
+
+        case RPC_AUTHERR:
+          ferr("ERROR: RPC_MSGDENIED: RPC_AUTHERR error\n");
+          return EACCES;
+
+        default:
+          return EOPNOTSUPP;
+        }
+    }
+  else if (tmp != RPC_MSGACCEPTED)
+    {
+      return EOPNOTSUPP;
+    }
+
+  tmp = fxdr_unsigned(uint32_t, replymsg->status);
+  if (tmp == RPC_SUCCESS)
+    {
+      finfo("RPC_SUCCESS\n");
+    }
+  else if (tmp == RPC_PROGMISMATCH)
+    {
+      ferr("ERROR: RPC_MSGACCEPTED: RPC_PROGMISMATCH error\n");
+      return EOPNOTSUPP;
+    }
+  else if (tmp > 5)
+    {
+      ferr("ERROR: Unsupported RPC type: %d\n", tmp);
+      return EOPNOTSUPP;
+    }
+
+  return OK;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -695,111 +766,179 @@ int rpcclnt_request(FAR struct rpcclnt *rpc, int procnum, int prog,
                     int version, FAR void *request, size_t reqlen,
                     FAR void *response, size_t resplen)
 {
-  struct rpc_reply_header *replymsg;
-  uint32_t tmp;
-  uint32_t xid;
-  int retries;
-  int error = 0;
+  struct rpc_call_s call;
+  int error;
 
-  /* Get a new (non-zero) xid */
+  call.rq_request  = request;
+  call.rq_reqlen   = reqlen;
+  call.rq_response = response;
+  call.rq_resplen  = resplen;
 
-  xid = rpcclnt_newxid();
+  error = rpcclnt_requestv(rpc, procnum, prog, version, &call, 1);
+  if (error == OK)
+    {
+      error = call.rq_error;
+    }
 
-  /* Initialize the RPC header fields */
+  return error;
+}
 
-  rpcclnt_fmtheader((FAR struct rpc_call_header *)request,
-                    xid, prog, version, procnum);
+/****************************************************************************
+ * Name: rpcclnt_requestv
+ *
+ * Description:
+ *   Perform several RPC requests of the same procedure with all of the
+ *   CALL messages outstanding at the same time.  Each CALL gets its own
+ *   transaction ID and each reply is matched to its CALL by that ID, so
+ *   replies may arrive in any order.  Replies to earlier, abandoned CALLs
+ *   are discarded.  On a timeout, only the CALLs without a reply are sent
+ *   again.
+ *
+ *   Each reply is received into the response buffer of the first CALL that
+ *   is still waiting.  If it belongs to a different CALL, it is copied to
+ *   that CALL's response buffer.  Hence, response buffers must not overlap
+ *   request messages.
+ *
+ * Returned Value:
+ *   Zero if a reply was received for every CALL, in which case the RPC
+ *   level status of each reply is in rq_error.  Otherwise, a positive errno
+ *   value.
+ *
+ ****************************************************************************/
 
-  /* Get the full size of the message (the size of variable data plus the size of
-   * the messages header).
-   */
+int rpcclnt_requestv(FAR struct rpcclnt *rpc, int procnum, int prog,
+                     int version, FAR struct rpc_call_s *calls, int ncalls)
+{
+  FAR struct rpc_reply_header *replyheader;
+  FAR struct rpc_call_s *call;
+  size_t nbytes;
+  int retries;
+  int ndone;
+  int error = 0;
+  int i;
+  int j;
+
+  DEBUGASSERT(calls != NULL && ncalls > 0);
 
-  reqlen += sizeof(struct rpc_call_header);
+  /* Format the call headers, each with a new (non-zero) xid */
 
-  /* Send the RPC call messsages and receive the RPC response.  A limited
+  for (i = 0; i < ncalls; i++)
+    {
+      call           = &calls[i];
+      call->rq_xid   = rpcclnt_newxid();
+      call->rq_done  = false;
+      call->rq_error = OK;
+
+      rpcclnt_fmtheader((FAR struct rpc_call_header *)call->rq_request,
+                        call->rq_xid, prog, version, procnum);
+    }
+
+  /* Send the RPC call messsages and receive the RPC responses.  A limited
    * number of re-tries will be attempted, but only for the case of response
    * timeouts.
    */
 
   retries = 0;
-  do
+  ndone   = 0;
+
+  for (; ; )
     {
-      /* Do the client side RPC. */
+      /* (Re-)send every CALL that does not yet have a reply.  The full size
+       * of the message is the size of variable data plus the size of the
+       * messages header.
+       */
 
-      rpc_statistics(rpcrequests);
       rpc->rc_timeout = false;
-
-      /* Send the RPC CALL message */
-
-      error = rpcclnt_send(rpc, procnum, prog, request, reqlen);
-      if (error != OK)
+      for (i = 0; i < ncalls; i++)
         {
-          finfo("ERROR rpcclnt_send failed: %d\n", error);
+          call = &calls[i];
+          if (!call->rq_done)
+            {
+              rpc_statistics(rpcrequests);
+              error = rpcclnt_send(rpc, procnum, prog, call->rq_request,
+                                   call->rq_reqlen +
+                                   sizeof(struct rpc_call_header));
+              if (error != OK)
+                {
+                  ferr("ERROR: rpcclnt_send failed: %d\n", error);
+                  return error;
+                }
+            }
         }
 
-      /* Wait for the reply from our send */
+      /* Collect replies until all CALLs are answered or we time out */
 
-      else
+      while (ndone < ncalls)
         {
-          error = rpcclnt_reply(rpc, procnum, prog, response, resplen);
-          if (error != OK)
+          /* Receive into the buffer of the first CALL still waiting */
+
+          for (i = 0; calls[i].rq_done; i++);
+          call = &calls[i];
+
+          error = rpcclnt_reply(rpc, call->rq_response, call->rq_resplen,
+                                &nbytes);
+          if (error == EPROTO)
             {
-              finfo("ERROR rpcclnt_reply failed: %d\n", error);
+              /* Not an RPC reply.  Ignore it. */
+
+              continue;
+            }
+          else if (error != OK)
+            {
+              break;
             }
-        }
 
-      retries++;
-    }
-  while (rpc->rc_timeout && retries <= rpc->rc_retry);
+          /* Find the CALL that this reply answers */
 
-  if (error != OK)
-    {
-      ferr("ERROR: RPC failed: %d\n", error);
-      return error;
-    }
+          replyheader = (FAR struct rpc_reply_header *)call->rq_response;
+          for (j = i; j < ncalls; j++)
+            {
+              if (!calls[j].rq_done &&
+                  replyheader->rp_xid == txdr_unsigned(calls[j].rq_xid))
+                {
+                  break;
+                }
+            }
 
-  /* Break down the RPC header and check if it is OK */
+          if (j >= ncalls)
+            {
+              /* A late or duplicate reply to some earlier CALL */
 
-  replymsg = (FAR struct rpc_reply_header *)response;
+              finfo("Discarding reply with stale xid\n");
+              rpc_statistics(rpcinvalid);
+              continue;
+            }
 
-  tmp = fxdr_unsigned(uint32_t, replymsg->type);
-  if (tmp == RPC_MSGDENIED)
-    {
-      tmp = fxdr_unsigned(uint32_t, replymsg->status);
-      switch (tmp)
+          if (j != i)
+            {
+              /* Move the reply to the CALL that it belongs to */
+
+              if (nbytes > calls[j].rq_resplen)
+                {
+                  nbytes = calls[j].rq_resplen;
+                }
+
+              memcpy(calls[j].rq_response, call->rq_response, nbytes);
+            }
+
+          calls[j].rq_done  = true;
+          calls[j].rq_error = rpcclnt_checkreply(calls[j].rq_response);
+          ndone++;
+        }
+
+      if (ndone >= ncalls)
         {
-        case RPC_MISMATCH:
-          ferr("ERROR: RPC_MSGDENIED: RPC_MISMATCH error\n");
-          return EOPNOTSUPP;
+          return OK;
+        }
 
-        case RPC_AUTHERR:
-          ferr("ERROR: RPC_MSGDENIED: RPC_AUTHERR error\n");
-          return EACCES;
+      /* Only timeouts are retried */
 
-        default:
-          return EOPNOTSUPP;
+      if (!rpc->rc_timeout || ++retries > rpc->rc_retry)
+        {
+          ferr("ERROR: RPC failed: %d\n", error);
+          return error;
         }
-    }
-  else if (tmp != RPC_MSGACCEPTED)
-    {
-      return EOPNOTSUPP;
-    }
 
-  tmp = fxdr_unsigned(uint32_t, replymsg->status);
-  if (tmp == RPC_SUCCESS)
-    {
-      finfo("RPC_SUCCESS\n");
-    }
-  else if (tmp == RPC_PROGMISMATCH)
-    {
-      ferr("ERROR: RPC_MSGACCEPTED: RPC_PROGMISMATCH error\n");
-      return EOPNOTSUPP;
+      rpc_statistics(rpcretries);
     }
-  else if (tmp > 5)
-    {
-      ferr("ERROR: Unsupported RPC type: %d\n", tmp);
-      return EOPNOTSUPP;
-    }
-
-  return OK;
 }
@@ -50,6 +50,7 @@
 #include <stdbool.h>
 #include <semaphore.h>
 
+#include <nuttx/wqueue.h>
 #include <nuttx/mtd/mtd.h>
 #include <nuttx/fs/nxffs.h>
 
@@ -185,6 +186,18 @@
 
 #define NXFFS_NERASED             128
 
+/* States of the inode index */
+
+#define NXFFS_IXSTATE_INVALID     0 /* Must be built before use */
+#define NXFFS_IXSTATE_VALID       1 /* Describes all valid inodes */
+#define NXFFS_IXSTATE_DISABLED    2 /* Not enough memory; not used */
+
+/* Number of I/O blocks read at once into the read-ahead buffer */
+
+#ifndef CONFIG_NXFFS_READAHEAD
+#  define CONFIG_NXFFS_READAHEAD  0
+#endif
+
 /* Quasi-standard definitions */
 
 #ifndef MIN
@@ -247,6 +260,16 @@ struct nxffs_entry_s
   uint32_t                  datlen;    /* Length of inode data */
 };
 
+/* This structure describes one entry of the in-memory inode index */
+
+#ifdef CONFIG_NXFFS_INODEINDEX
+struct nxffs_ixentry_s
+{
+  uint32_t                  hash;      /* Hash of the inode name */
+  off_t                     hoffset;   /* FLASH offset to the inode header */
+};
+#endif
+
 /* This structure describes int in-memory representation of the data block */
 
 struct nxffs_blkentry_s
@@ -302,6 +325,22 @@ struct nxffs_volume_s
   FAR struct nxffs_ofile_s *ofiles;    /* A singly-linked list of open files */
   FAR uint8_t              *cache;     /* On cached erase block for general I/O */
   FAR uint8_t              *pack;      /* A full erase block to support packing */
+  off_t                     ndeleted;  /* Bytes deleted since the last pack */
+  uint32_t                  npacks;    /* Number of completed packs */
+#ifdef CONFIG_NXFFS_GC_BACKGROUND
+  struct work_s             gcwork;    /* Background packing */
+#endif
+#if CONFIG_NXFFS_READAHEAD > 1
+  FAR uint8_t              *rabuf;     /* Read-ahead buffer (may be NULL) */
+  off_t                     rablock;   /* Starting block number in rabuf */
+  off_t                     nrablocks; /* Number of blocks in rabuf */
+#endif
+#ifdef CONFIG_NXFFS_INODEINDEX
+  FAR struct nxffs_ixentry_s *index;   /* Inode index, sorted by name hash */
+  int                       nindex;    /* Number of entries in the index */
+  int                       maxindex;  /* Allocated size of the index */
+  uint8_t                   ixstate;   /* See NXFFS_IXSTATE_* definitions */
+#endif
 };
 
 /* This structure describes the state of the blocks on the NXFFS volume */
@@ -508,6 +547,33 @@ int nxffs_rdcache(FAR struct nxffs_volume_s *volume, off_t block);
 
 int nxffs_wrcache(FAR struct nxffs_volume_s *volume);
 
+/****************************************************************************
+ * Name: nxffs_rainvalidate
+ *
+ * Description:
+ *   Discard the read-ahead buffer if it holds any of the specified blocks.
+ *   This must be done when those blocks are erased or written without
+ *   nxffs_wrcache().
+ *
+ * Input Parameters:
+ *   volume  - Describes the current volume
+ *   block   - The first logical block that was modified
+ *   nblocks - The number of logical blocks that were modified
+ *
+ * Returned Value:
+ *   None
+ *
+ * Defined in nxffs_cache.c
+ *
+ ****************************************************************************/
+
+#if CONFIG_NXFFS_READAHEAD > 1
+void nxffs_rainvalidate(FAR struct nxffs_volume_s *volume, off_t block,
+                        off_t nblocks);
+#else
+#  define nxffs_rainvalidate(v,b,n)
+#endif
+
 /****************************************************************************
  * Name: nxffs_ioseek
  *
@@ -640,6 +706,128 @@ int nxffs_nextentry(FAR struct nxffs_volume_s *volume, off_t offset,
 int nxffs_findinode(FAR struct nxffs_volume_s *volume, FAR const char *name,
                     FAR struct nxffs_entry_s *entry);
 
+/****************************************************************************
+ * Name: nxffs_ixreset
+ *
+ * Description:
+ *   Empty the inode index and set its state.  An index in the
+ *   NXFFS_IXSTATE_INVALID state will be rebuilt by the next look-up.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *   state  - The new state of the index (NXFFS_IXSTATE_*)
+ *
+ * Returned Value:
+ *   None
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_INODEINDEX
+void nxffs_ixreset(FAR struct nxffs_volume_s *volume, uint8_t state);
+#else
+#  define nxffs_ixreset(v,s)
+#endif
+
+/****************************************************************************
+ * Name: nxffs_ixadd
+ *
+ * Description:
+ *   Add a valid inode to the inode index.  Nothing is done if the index is
+ *   not valid.
+ *
+ * Input Parameters:
+ *   volume  - Describes the NXFFS volume
+ *   name    - The name of the inode
+ *   hoffset - The FLASH offset to the inode header
+ *
+ * Returned Value:
+ *   None.  The index is disabled if it cannot be extended.
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_INODEINDEX
+void nxffs_ixadd(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                 off_t hoffset);
+#else
+#  define nxffs_ixadd(v,n,o)
+#endif
+
+/****************************************************************************
+ * Name: nxffs_ixremove
+ *
+ * Description:
+ *   Remove a deleted inode from the inode index.
+ *
+ * Input Parameters:
+ *   volume  - Describes the NXFFS volume
+ *   name    - The name of the inode
+ *   hoffset - The FLASH offset to the inode header
+ *
+ * Returned Value:
+ *   None
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_INODEINDEX
+void nxffs_ixremove(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                    off_t hoffset);
+#else
+#  define nxffs_ixremove(v,n,o)
+#endif
+
+/****************************************************************************
+ * Name: nxffs_ixbuild
+ *
+ * Description:
+ *   Scan all inodes on the volume and build the inode index.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *
+ * Returned Value:
+ *   Zero is returned on success. Otherwise, a negated errno is returned
+ *   that indicates the nature of the failure.
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_INODEINDEX
+int nxffs_ixbuild(FAR struct nxffs_volume_s *volume);
+#endif
+
+/****************************************************************************
+ * Name: nxffs_ixfind
+ *
+ * Description:
+ *   Use the inode index to find the inode with the provided name.
+ *
+ * Input Parameters:
+ *   volume - Describes the NXFFS volume
+ *   name   - The name of the inode to find
+ *   entry  - The location to return information about the inode.
+ *
+ * Returned Value:
+ *   Zero is returned if the inode was found and -ENOENT if there is no
+ *   such inode.  -EAGAIN is returned if the index cannot be used; the
+ *   inodes must then be searched on FLASH.  Other negated errno values
+ *   report read failures.
+ *
+ * Defined in nxffs_index.c
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_INODEINDEX
+int nxffs_ixfind(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                 FAR struct nxffs_entry_s *entry);
+#endif
+
 /****************************************************************************
  * Name: nxffs_inodeend
  *
@@ -1082,6 +1270,28 @@ int nxffs_rminode(FAR struct nxffs_volume_s *volume, FAR const char *name);
 
 int nxffs_pack(FAR struct nxffs_volume_s *volume);
 
+/****************************************************************************
+ * Name: nxffs_gcschedule
+ *
+ * Description:
+ *   Schedule packing of the volume on the low priority work queue if the
+ *   free FLASH has fallen below CONFIG_NXFFS_GC_WATERMARK and files have
+ *   been deleted since the volume was last packed.
+ *
+ * Input Parameters:
+ *   volume - The volume to be packed.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_GC_BACKGROUND
+void nxffs_gcschedule(FAR struct nxffs_volume_s *volume);
+#else
+#  define nxffs_gcschedule(v)
+#endif
+
 /****************************************************************************
  * Standard mountpoint operation methods
  *
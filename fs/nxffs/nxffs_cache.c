@@ -41,6 +41,7 @@
 
 #include <nuttx/config.h>
 
+#include <string.h>
 #include <assert.h>
 #include <errno.h>
 #include <debug.h>
@@ -93,6 +94,45 @@ int nxffs_rdcache(FAR struct nxffs_volume_s *volume, off_t block)
 
   if (block != volume->cblock)
     {
+#if CONFIG_NXFFS_READAHEAD > 1
+      if (volume->rabuf != NULL)
+        {
+          /* Read the block and the blocks that follow it into the
+           * read-ahead buffer, unless it is already there.
+           */
+
+          if (block < volume->rablock ||
+              block >= volume->rablock + volume->nrablocks)
+            {
+              off_t nblocks = volume->nblocks - block;
+
+              if (nblocks > CONFIG_NXFFS_READAHEAD)
+                {
+                  nblocks = CONFIG_NXFFS_READAHEAD;
+                }
+
+              nxfrd = MTD_BREAD(volume->mtd, block, nblocks, volume->rabuf);
+              if (nxfrd != nblocks)
+                {
+                  ferr("ERROR: Read block %d failed: %d\n", block, nxfrd);
+                  volume->rablock   = (off_t)-1;
+                  volume->nrablocks = 0;
+                  return -EIO;
+                }
+
+              volume->rablock   = block;
+              volume->nrablocks = nblocks;
+            }
+
+          memcpy(volume->cache,
+                 &volume->rabuf[(block - volume->rablock) *
+                                volume->geo.blocksize],
+                 volume->geo.blocksize);
+          volume->cblock = block;
+          return OK;
+        }
+#endif
+
       /* Read the specified blocks into cache */
 
       nxfrd = MTD_BREAD(volume->mtd, block, 1, volume->cache);
@@ -134,14 +174,55 @@ int nxffs_wrcache(FAR struct nxffs_volume_s *volume)
   if (nxfrd != 1)
     {
       ferr("ERROR: Write block %d failed: %d\n", volume->cblock, nxfrd);
+      nxffs_rainvalidate(volume, volume->cblock, 1);
       return -EIO;
     }
 
+#if CONFIG_NXFFS_READAHEAD > 1
+  /* Keep the read-ahead buffer up to date */
+
+  if (volume->rabuf != NULL && volume->cblock >= volume->rablock &&
+      volume->cblock < volume->rablock + volume->nrablocks)
+    {
+      memcpy(&volume->rabuf[(volume->cblock - volume->rablock) *
+                            volume->geo.blocksize],
+             volume->cache, volume->geo.blocksize);
+    }
+#endif
+
   /* Write was successful */
 
   return OK;
 }
 
+/****************************************************************************
+ * Name: nxffs_rainvalidate
+ *
+ * Description:
+ *   Discard the read-ahead buffer if it holds any of the specified blocks.
+ *   This must be done when those blocks are erased or written without
+ *   nxffs_wrcache().
+ *
+ * Input Parameters:
+ *   volume  - Describes the current volume
+ *   block   - The first logical block that was modified
+ *   nblocks - The number of logical blocks that were modified
+ *
+ ****************************************************************************/
+
+#if CONFIG_NXFFS_READAHEAD > 1
+void nxffs_rainvalidate(FAR struct nxffs_volume_s *volume, off_t block,
+                        off_t nblocks)
+{
+  if (block < volume->rablock + volume->nrablocks &&
+      block + nblocks > volume->rablock)
+    {
+      volume->rablock   = (off_t)-1;
+      volume->nrablocks = 0;
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: nxffs_ioseek
  *
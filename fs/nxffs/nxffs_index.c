@@ -0,0 +1,322 @@
+/****************************************************************************
+ * fs/nxffs/nxffs_index.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/kmalloc.h>
+
+#include "nxffs.h"
+
+#ifdef CONFIG_NXFFS_INODEINDEX
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The index array grows by this many entries at a time */
+
+#define NXFFS_IXINCR 32
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_ixhash
+ *
+ * Description:
+ *   Return the hash of an inode name.
+ *
+ ****************************************************************************/
+
+static uint32_t nxffs_ixhash(FAR const char *name)
+{
+  uint32_t hash = 2166136261ul;
+
+  while (*name != '\0')
+    {
+      hash ^= (uint8_t)*name++;
+      hash *= 16777619ul;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name: nxffs_ixlower
+ *
+ * Description:
+ *   Return the position of the first index entry with a hash greater than
+ *   or equal to 'hash'.  The index is sorted by hash.
+ *
+ ****************************************************************************/
+
+static int nxffs_ixlower(FAR struct nxffs_volume_s *volume, uint32_t hash)
+{
+  int lo = 0;
+  int hi = volume->nindex;
+  int mid;
+
+  while (lo < hi)
+    {
+      mid = (lo + hi) >> 1;
+      if (volume->index[mid].hash < hash)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  return lo;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_ixreset
+ *
+ * Description:
+ *   Empty the inode index and set its state.
+ *
+ ****************************************************************************/
+
+void nxffs_ixreset(FAR struct nxffs_volume_s *volume, uint8_t state)
+{
+  volume->nindex  = 0;
+  volume->ixstate = state;
+}
+
+/****************************************************************************
+ * Name: nxffs_ixadd
+ *
+ * Description:
+ *   Add a valid inode to the inode index.
+ *
+ ****************************************************************************/
+
+void nxffs_ixadd(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                 off_t hoffset)
+{
+  FAR struct nxffs_ixentry_s *index;
+  uint32_t hash;
+  int pos;
+
+  if (volume->ixstate != NXFFS_IXSTATE_VALID)
+    {
+      return;
+    }
+
+  /* Make room for one more entry */
+
+  if (volume->nindex >= volume->maxindex)
+    {
+      index = (FAR struct nxffs_ixentry_s *)
+        kmm_realloc(volume->index, (volume->maxindex + NXFFS_IXINCR) *
+                    sizeof(struct nxffs_ixentry_s));
+      if (index == NULL)
+        {
+          /* Do not try again until the volume is scanned again */
+
+          ferr("ERROR: Failed to grow the inode index\n");
+          nxffs_ixreset(volume, NXFFS_IXSTATE_DISABLED);
+          return;
+        }
+
+      volume->index     = index;
+      volume->maxindex += NXFFS_IXINCR;
+    }
+
+  /* Keep the index sorted by hash */
+
+  hash = nxffs_ixhash(name);
+  pos  = nxffs_ixlower(volume, hash);
+
+  memmove(&volume->index[pos + 1], &volume->index[pos],
+          (volume->nindex - pos) * sizeof(struct nxffs_ixentry_s));
+  volume->index[pos].hash    = hash;
+  volume->index[pos].hoffset = hoffset;
+  volume->nindex++;
+}
+
+/****************************************************************************
+ * Name: nxffs_ixremove
+ *
+ * Description:
+ *   Remove a deleted inode from the inode index.
+ *
+ ****************************************************************************/
+
+void nxffs_ixremove(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                    off_t hoffset)
+{
+  int pos;
+
+  if (volume->ixstate != NXFFS_IXSTATE_VALID)
+    {
+      return;
+    }
+
+  for (pos = nxffs_ixlower(volume, nxffs_ixhash(name));
+       pos < volume->nindex;
+       pos++)
+    {
+      if (volume->index[pos].hoffset == hoffset)
+        {
+          volume->nindex--;
+          memmove(&volume->index[pos], &volume->index[pos + 1],
+                  (volume->nindex - pos) * sizeof(struct nxffs_ixentry_s));
+          return;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: nxffs_ixbuild
+ *
+ * Description:
+ *   Scan all inodes on the volume and build the inode index.
+ *
+ ****************************************************************************/
+
+int nxffs_ixbuild(FAR struct nxffs_volume_s *volume)
+{
+  struct nxffs_entry_s entry;
+  off_t offset;
+  int ret;
+
+  nxffs_ixreset(volume, NXFFS_IXSTATE_VALID);
+
+  /* Visit every valid inode from the first one to the end of the inodes */
+
+  offset = volume->inoffset;
+  while ((ret = nxffs_nextentry(volume, offset, &entry)) == OK)
+    {
+      nxffs_ixadd(volume, entry.name, entry.hoffset);
+      offset = nxffs_inodeend(volume, &entry);
+      nxffs_freeentry(&entry);
+    }
+
+  if (ret != -ENOENT && ret != -ENOSPC)
+    {
+      ferr("ERROR: Failed to scan the inodes: %d\n", -ret);
+      nxffs_ixreset(volume, NXFFS_IXSTATE_INVALID);
+      return ret;
+    }
+
+  return volume->ixstate == NXFFS_IXSTATE_VALID ? OK : -ENOMEM;
+}
+
+/****************************************************************************
+ * Name: nxffs_ixfind
+ *
+ * Description:
+ *   Use the inode index to find the inode with the provided name.
+ *
+ ****************************************************************************/
+
+int nxffs_ixfind(FAR struct nxffs_volume_s *volume, FAR const char *name,
+                 FAR struct nxffs_entry_s *entry)
+{
+  uint32_t hash;
+  off_t hoffset;
+  int pos;
+  int ret;
+
+  /* The index is built when the volume is first mounted.  It must be
+   * built again after the volume has been packed.
+   */
+
+  if (volume->ixstate == NXFFS_IXSTATE_INVALID)
+    {
+      (void)nxffs_ixbuild(volume);
+    }
+
+  if (volume->ixstate != NXFFS_IXSTATE_VALID)
+    {
+      return -EAGAIN;
+    }
+
+  /* Check each inode with a matching name hash */
+
+  hash = nxffs_ixhash(name);
+  for (pos = nxffs_ixlower(volume, hash);
+       pos < volume->nindex && volume->index[pos].hash == hash;
+       pos++)
+    {
+      hoffset = volume->index[pos].hoffset;
+      ret     = nxffs_nextentry(volume, hoffset, entry);
+      if (ret == OK && entry->hoffset == hoffset)
+        {
+          if (strcmp(name, entry->name) == 0)
+            {
+              return OK;
+            }
+
+          nxffs_freeentry(entry);
+          continue;
+        }
+
+      /* There is no valid inode at this offset.  The index is out of date
+       * and must be rebuilt.
+       */
+
+      ferr("ERROR: No inode at indexed offset %ld\n", (long)hoffset);
+      if (ret == OK)
+        {
+          nxffs_freeentry(entry);
+        }
+
+      nxffs_ixreset(volume, NXFFS_IXSTATE_INVALID);
+      return -EAGAIN;
+    }
+
+  return -ENOENT;
+}
+
+#endif /* CONFIG_NXFFS_INODEINDEX */
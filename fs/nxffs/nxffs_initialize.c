@@ -134,6 +134,61 @@ const uint8_t g_datamagic[NXFFS_MAGICSIZE] =
 struct nxffs_volume_s g_volume;
 #endif
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxffs_skipdata
+ *
+ * Description:
+ *   If a valid data block begins at the current FLASH position, seek to the
+ *   end of its data.  The data may end with bytes that look erased and must
+ *   not be mistaken for the beginning of the free FLASH region.
+ *
+ * Input Parameters:
+ *   volume - Identifies the NXFFS volume
+ *
+ * Returned Value:
+ *   True if a data block was skipped.
+ *
+ ****************************************************************************/
+
+static bool nxffs_skipdata(FAR struct nxffs_volume_s *volume)
+{
+  off_t offset = nxffs_iotell(volume);
+  off_t doffset = offset;
+  uint16_t datlen;
+
+  /* nxffs_getc() would skip over the header of the next block */
+
+  if (volume->iooffset >= volume->geo.blocksize)
+    {
+      doffset = (volume->ioblock + 1) * volume->geo.blocksize +
+                SIZEOF_NXFFS_BLOCK_HDR;
+    }
+  else if (volume->iooffset < SIZEOF_NXFFS_BLOCK_HDR)
+    {
+      doffset = volume->ioblock * volume->geo.blocksize +
+                SIZEOF_NXFFS_BLOCK_HDR;
+    }
+
+  nxffs_ioseek(volume, doffset);
+  if (volume->ioblock >= volume->nblocks ||
+      volume->iooffset + SIZEOF_NXFFS_DATA_HDR > volume->geo.blocksize ||
+      nxffs_rdcache(volume, volume->ioblock) < 0 ||
+      memcmp(&volume->cache[volume->iooffset], g_datamagic,
+             NXFFS_MAGICSIZE) != 0 ||
+      nxffs_rdblkhdr(volume, doffset, &datlen) < 0)
+    {
+      nxffs_ioseek(volume, offset);
+      return false;
+    }
+
+  nxffs_ioseek(volume, doffset + SIZEOF_NXFFS_DATA_HDR + datlen);
+  return true;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -224,6 +279,16 @@ int nxffs_initialize(FAR struct mtd_dev_s *mtd)
       goto errout_with_cache;
     }
 
+#if CONFIG_NXFFS_READAHEAD > 1
+  /* Allocate the read-ahead buffer.  Reads are done one block at a time
+   * if it cannot be allocated.
+   */
+
+  volume->rabuf = (FAR uint8_t *)
+    kmm_malloc(CONFIG_NXFFS_READAHEAD * volume->geo.blocksize);
+  volume->rablock = (off_t)-1;
+#endif
+
   /* Get the number of R/W blocks per erase block and the total number o
    * R/W blocks
    */
@@ -313,6 +378,18 @@ int nxffs_initialize(FAR struct mtd_dev_s *mtd)
   ferr("ERROR: Failed to calculate file system limits: %d\n", -ret);
 
 errout_with_buffer:
+#if CONFIG_NXFFS_READAHEAD > 1
+  if (volume->rabuf != NULL)
+    {
+      kmm_free(volume->rabuf);
+    }
+#endif
+#ifdef CONFIG_NXFFS_INODEINDEX
+  if (volume->index != NULL)
+    {
+      kmm_free(volume->index);
+    }
+#endif
   kmm_free(volume->pack);
 errout_with_cache:
   kmm_free(volume->cache);
@@ -357,6 +434,10 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
   int nerased;
   int ret;
 
+  /* The inode index is rebuilt as the inodes are visited */
+
+  nxffs_ixreset(volume, NXFFS_IXSTATE_VALID);
+
   /* Get the offset to the first valid block on the FLASH */
 
   block = 0;
@@ -399,6 +480,7 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
 
       volume->inoffset = entry.hoffset;
       finfo("First inode at offset %d\n", volume->inoffset);
+      nxffs_ixadd(volume, entry.name, entry.hoffset);
 
       /* Discard this entry and set the next offset. */
 
@@ -410,26 +492,48 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
 
   if (!noinodes)
     {
-      while (nxffs_nextentry(volume, offset, &entry) == OK)
+      while ((ret = nxffs_nextentry(volume, offset, &entry)) == OK)
         {
+          nxffs_ixadd(volume, entry.name, entry.hoffset);
+
           /* Discard the entry and guess the next offset. */
 
           offset = nxffs_inodeend(volume, &entry);
           nxffs_freeentry(&entry);
         }
 
+      if (ret != -ENOENT && ret != -ENOSPC)
+        {
+          /* Some inodes may have been missed */
+
+          nxffs_ixreset(volume, NXFFS_IXSTATE_INVALID);
+        }
+
       finfo("Last inode before offset %d\n", offset);
     }
 
   /* No inodes were found after this offset.  Now search for a block of
-   * erased flash.
+   * erased flash.  File data may end with bytes that look erased, so begin
+   * at the start of the block where data blocks can be recognized and
+   * skipped.
    */
 
+  offset = (offset / volume->geo.blocksize) * volume->geo.blocksize +
+           SIZEOF_NXFFS_BLOCK_HDR;
   nxffs_ioseek(volume, offset);
   nerased = 0;
   for (; ; )
     {
-      int ch = nxffs_getc(volume, 1);
+      int ch;
+
+      if (nxffs_skipdata(volume))
+        {
+          offset  = nxffs_iotell(volume);
+          nerased = 0;
+          continue;
+        }
+
+      ch = nxffs_getc(volume, 1);
       if (ch < 0)
         {
           /* Failed to read the next byte... this could mean that the FLASH
@@ -485,9 +589,13 @@ int nxffs_limits(FAR struct nxffs_volume_s *volume)
               return OK;
             }
         }
+      /* nxffs_getc() skips over block headers, so the free FLASH region
+       * can only begin after the current position.
+       */
+
       else
         {
-          offset += nerased + 1;
+          offset  = nxffs_iotell(volume);
           nerased = 0;
         }
     }
@@ -565,6 +673,17 @@ int nxffs_unbind(FAR void *handle, FAR struct inode **blkdriver,
       return -ENOSYS;
     }
 
-  return g_volume.ofiles ? -EBUSY : OK;
+  if (g_volume.ofiles)
+    {
+      return -EBUSY;
+    }
+
+#ifdef CONFIG_NXFFS_GC_BACKGROUND
+  /* Stop background packing */
+
+  (void)work_cancel(LPWORK, &g_volume.gcwork);
+#endif
+
+  return OK;
 #endif
 }
@@ -56,6 +56,79 @@
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nxffs_skipdata
+ *
+ * Description:
+ *   Skip over the bytes in the volume cache that cannot start an inode
+ *   header without going through nxffs_getc() for each byte.  Erased bytes
+ *   are compared a 32-bit word at a time where possible.  Called only from
+ *   nxffs_nextentry() when it is not in the middle of a magic sequence and
+ *   the block at the current position is in the cache and has been
+ *   verified.
+ *
+ *   The bytes are accounted for exactly as nxffs_nextentry() would.  The
+ *   scan stops before the byte that completes NXFFS_NERASED erased bytes
+ *   and before the point where nxffs_getc() would skip to the next block,
+ *   so that nxffs_nextentry() handles those cases itself.
+ *
+ * Input Parameters:
+ *   volume  - Describes the current volume.
+ *   nerased - The number of consecutive erased bytes seen so far.  Updated
+ *     on return.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+static void nxffs_skipdata(FAR struct nxffs_volume_s *volume,
+                           FAR int *nerased)
+{
+  FAR const uint8_t *cache = volume->cache;
+  uint32_t erased = (uint32_t)CONFIG_NXFFS_ERASEDSTATE * 0x01010101;
+  uint32_t word;
+  uint16_t offset = volume->iooffset;
+  uint16_t end = volume->geo.blocksize - SIZEOF_NXFFS_INODE_HDR;
+
+  while (offset < end)
+    {
+      if (cache[offset] == CONFIG_NXFFS_ERASEDSTATE)
+        {
+          if ((offset & 3) == 0 && offset + 4 <= end &&
+              *nerased + 4 < NXFFS_NERASED)
+            {
+              memcpy(&word, &cache[offset], 4);
+              if (word == erased)
+                {
+                  *nerased += 4;
+                  offset   += 4;
+                  continue;
+                }
+            }
+
+          if (*nerased + 1 >= NXFFS_NERASED)
+            {
+              break;
+            }
+
+          (*nerased)++;
+        }
+      else if (cache[offset] != g_inodemagic[0])
+        {
+          *nerased = 0;
+        }
+      else
+        {
+          break;
+        }
+
+      offset++;
+    }
+
+  volume->iooffset = offset;
+}
+
 /****************************************************************************
  * Name: nxffs_rdentry
  *
@@ -251,6 +324,7 @@ void nxffs_freeentry(FAR struct nxffs_entry_s *entry)
 int nxffs_nextentry(FAR struct nxffs_volume_s *volume, off_t offset,
                     FAR struct nxffs_entry_s *entry)
 {
+  bool verified;
   int nmagic;
   int ch;
   int nerased;
@@ -262,10 +336,20 @@ int nxffs_nextentry(FAR struct nxffs_volume_s *volume, off_t offset,
 
   /* Then begin searching */
 
-  nerased = 0;
-  nmagic  = 0;
+  verified = false;
+  nerased  = 0;
+  nmagic   = 0;
   for (; ; )
     {
+      /* Skip quickly over data that cannot begin an inode header.  This is
+       * only possible once nxffs_getc() has verified the cached block.
+       */
+
+      if (verified && nmagic == 0 && volume->ioblock == volume->cblock)
+        {
+          nxffs_skipdata(volume, &nerased);
+        }
+
       /* Read the next character */
 
       ch = nxffs_getc(volume, SIZEOF_NXFFS_INODE_HDR - nmagic);
@@ -275,9 +359,11 @@ int nxffs_nextentry(FAR struct nxffs_volume_s *volume, off_t offset,
           return ch;
         }
 
+      verified = true;
+
       /* Check for another erased byte */
 
-      else if (ch == CONFIG_NXFFS_ERASEDSTATE)
+      if (ch == CONFIG_NXFFS_ERASEDSTATE)
         {
           /* If we have encountered NXFFS_NERASED number of consecutive
            * erased bytes, then presume we have reached the end of valid
@@ -343,7 +429,8 @@ int nxffs_nextentry(FAR struct nxffs_volume_s *volume, off_t offset,
 
               /* False alarm.. keep looking */
 
-              nmagic = 0;
+              verified = false;
+              nmagic   = 0;
             }
         }
     }
@@ -378,6 +465,16 @@ int nxffs_findinode(FAR struct nxffs_volume_s *volume, FAR const char *name,
   off_t offset;
   int ret;
 
+#ifdef CONFIG_NXFFS_INODEINDEX
+  /* Use the inode index, if possible */
+
+  ret = nxffs_ixfind(volume, name, entry);
+  if (ret != -EAGAIN)
+    {
+      return ret;
+    }
+#endif
+
   /* Start with the first valid inode that was discovered when the volume
    * was created (or modified after the last file system re-packing).
    */
@@ -92,7 +92,9 @@ int nxffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
       goto errout;
     }
 
-  /* Only a reformat and optimize commands are supported */
+  /* Only reformat, optimize and garbage collection commands are
+   * supported
+   */
 
   if (cmd == FIOC_REFORMAT)
     {
@@ -120,11 +122,58 @@ int nxffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
       ret = nxffs_pack(volume);
     }
+
+  else if (cmd == FIOC_GCSTEP)
+    {
+      off_t froffset = volume->froffset;
+
+      finfo("GC step command\n");
+
+      /* The volume can only be packed as a whole.  Report if that did not
+       * free anything.
+       */
+
+      ret = nxffs_pack(volume);
+      if (ret >= 0 && volume->froffset >= froffset)
+        {
+          ret = -ENODATA;
+        }
+    }
+
+  else if (cmd == FIOC_GCSTATUS)
+    {
+      FAR struct fs_gcstatus_s *status =
+        (FAR struct fs_gcstatus_s *)((uintptr_t)arg);
+
+      finfo("GC status command\n");
+
+      if (status == NULL)
+        {
+          ret = -EINVAL;
+        }
+      else
+        {
+#ifdef CONFIG_NXFFS_GC_BACKGROUND
+          status->gc_active = !work_available(&volume->gcwork);
+#else
+          status->gc_active = false;
+#endif
+          status->gc_steps  = volume->npacks;
+          status->gc_free   = volume->nblocks * volume->geo.blocksize -
+                              volume->froffset;
+          status->gc_dirty  = volume->ndeleted;
+          ret = OK;
+        }
+    }
   else
     {
       /* Command not recognized, forward to the MTD driver */
 
       ret = MTD_IOCTL(volume->mtd, cmd, arg);
+
+      /* The driver may have modified the FLASH (MTDIOC_BULKERASE) */
+
+      nxffs_rainvalidate(volume, 0, volume->nblocks);
     }
 
 errout_with_semaphore:
@@ -1268,6 +1268,10 @@ int nxffs_wrinode(FAR struct nxffs_volume_s *volume,
       ferr("ERROR: Failed to write inode header block %d: %d\n",
            volume->ioblock, -ret);
     }
+  else
+    {
+      nxffs_ixadd(volume, entry->name, entry->hoffset);
+    }
 
   /* The volume is now available for other writers */
 
@@ -1298,10 +1302,14 @@ int nxffs_updateinode(FAR struct nxffs_volume_s *volume,
 {
   FAR struct nxffs_ofile_s *ofile;
 
-  /* Find the open inode structure matching this name */
+  /* Find the open inode structure matching this name.  A file open for
+   * writing with this name is a new version of the file that replaces the
+   * inode being moved.  Its inode is not on FLASH yet and is moved by
+   * nxffs_packwriter().
+   */
 
   ofile = nxffs_findofile(volume, entry->name);
-  if (ofile)
+  if (ofile && (ofile->oflags & O_WROK) == 0)
     {
       /* Yes.. the file is open.  Update the FLASH offsets to inode headers */
 
@@ -1243,16 +1243,53 @@ static inline int nxffs_packwriter(FAR struct nxffs_volume_s *volume,
   return -ENOSYS;
 }
 
+#ifdef CONFIG_NXFFS_GC_BACKGROUND
+/****************************************************************************
+ * Name: nxffs_gcworker
+ *
+ * Description:
+ *   Pack the volume on the low priority work queue.
+ *
+ ****************************************************************************/
+
+static void nxffs_gcworker(FAR void *arg)
+{
+  FAR struct nxffs_volume_s *volume = (FAR struct nxffs_volume_s *)arg;
+  off_t nfree;
+  int ret;
+
+  ret = nxsem_wait_uninterruptible(&volume->exclsem);
+  if (ret < 0)
+    {
+      return;
+    }
+
+  /* Check again.  A foreground pack may have been done in the meantime. */
+
+  nfree = volume->nblocks * volume->geo.blocksize - volume->froffset;
+  if (nfree < CONFIG_NXFFS_GC_WATERMARK && volume->ndeleted > 0)
+    {
+      ret = nxffs_pack(volume);
+      if (ret < 0)
+        {
+          ferr("ERROR: Failed to pack the volume: %d\n", -ret);
+        }
+    }
+
+  nxsem_post(&volume->exclsem);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
 /****************************************************************************
- * Name: nxffs_pack
+ * Name: nxffs_packvolume
  *
  * Description:
  *   Pack and re-write the filesystem in order to free up memory at the end
- *   of FLASH.
+ *   of FLASH.  This is the body of nxffs_pack().
  *
  * Input Parameters:
  *   volume - The volume to be packed.
@@ -1263,7 +1300,7 @@ static inline int nxffs_packwriter(FAR struct nxffs_volume_s *volume,
  *
  ****************************************************************************/
 
-int nxffs_pack(FAR struct nxffs_volume_s *volume)
+static int nxffs_packvolume(FAR struct nxffs_volume_s *volume)
 {
   struct nxffs_pack_s pack;
   FAR struct nxffs_wrfile_s *wrfile;
@@ -1274,6 +1311,12 @@ int nxffs_pack(FAR struct nxffs_volume_s *volume)
   int i;
   int ret = OK;
 
+  /* Packing moves the inodes.  The inode index will be rebuilt when it is
+   * next used.
+   */
+
+  nxffs_ixreset(volume, NXFFS_IXSTATE_INVALID);
+
   /* Get the offset to the first valid inode entry */
 
   wrfile = NULL;
@@ -1327,6 +1370,7 @@ int nxffs_pack(FAR struct nxffs_volume_s *volume)
 
                   volume->froffset =
                     block * volume->geo.blocksize + SIZEOF_NXFFS_BLOCK_HDR;
+                  volume->inoffset = volume->froffset;
                 }
             }
 
@@ -1397,6 +1441,15 @@ start_pack:
   pack.iooffset    = nxffs_getoffset(volume, iooffset, pack.ioblock);
   volume->froffset = iooffset;
 
+  /* Inodes will be moved down to this position, so the first valid inode
+   * may now be found here.
+   */
+
+  if (iooffset < volume->inoffset)
+    {
+      volume->inoffset = iooffset;
+    }
+
   /* Then pack all erase blocks starting with the erase block that contains
    * the ioblock and through the final erase block on the FLASH.
    */
@@ -1577,6 +1630,7 @@ start_pack:
        * appear. Now it is safe to erase the block.
        */
 
+      nxffs_rainvalidate(volume, pack.block0, volume->blkper);
       ret = MTD_ERASE(volume->mtd, eblock, 1);
       if (ret < 0)
         {
@@ -1601,3 +1655,66 @@ errout_with_pack:
   nxffs_freeentry(&pack.dest.entry);
   return ret;
 }
+
+/****************************************************************************
+ * Name: nxffs_pack
+ *
+ * Description:
+ *   Pack and re-write the filesystem in order to free up memory at the end
+ *   of FLASH.
+ *
+ * Input Parameters:
+ *   volume - The volume to be packed.
+ *
+ * Returned Value:
+ *   Zero on success; Otherwise, a negated errno value is returned to
+ *   indicate the nature of the failure.
+ *
+ ****************************************************************************/
+
+int nxffs_pack(FAR struct nxffs_volume_s *volume)
+{
+  int ret;
+
+  ret = nxffs_packvolume(volume);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Any deleted space that remains is too small to be worth packing */
+
+  volume->ndeleted = 0;
+  volume->npacks++;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxffs_gcschedule
+ *
+ * Description:
+ *   Schedule packing of the volume on the low priority work queue if the
+ *   free FLASH has fallen below CONFIG_NXFFS_GC_WATERMARK and files have
+ *   been deleted since the volume was last packed.
+ *
+ * Input Parameters:
+ *   volume - The volume to be packed.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXFFS_GC_BACKGROUND
+void nxffs_gcschedule(FAR struct nxffs_volume_s *volume)
+{
+  off_t nfree = volume->nblocks * volume->geo.blocksize - volume->froffset;
+
+  if (nfree < CONFIG_NXFFS_GC_WATERMARK && volume->ndeleted > 0 &&
+      work_available(&volume->gcwork))
+    {
+      (void)work_queue(LPWORK, &volume->gcwork, nxffs_gcworker, volume,
+                       MSEC2TICK(CONFIG_NXFFS_GC_DELAY));
+    }
+}
+#endif
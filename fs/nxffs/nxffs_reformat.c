@@ -281,20 +281,28 @@ int nxffs_reformat(FAR struct nxffs_volume_s *volume)
   /* Erase and reformat the entire volume */
 
   ret = nxffs_format(volume);
+  nxffs_rainvalidate(volume, 0, volume->nblocks);
   if (ret < 0)
     {
       ferr("ERROR: Failed to reformat the volume: %d\n", -ret);
+      nxffs_ixreset(volume, NXFFS_IXSTATE_INVALID);
       return ret;
     }
 
   /* Check for bad blocks */
 
   ret = nxffs_badblocks(volume);
+  nxffs_rainvalidate(volume, 0, volume->nblocks);
   if (ret < 0)
     {
       ferr("ERROR: Bad block check failed: %d\n", -ret);
     }
 
+  /* There are no inodes on the re-formatted volume */
+
+  nxffs_ixreset(volume, ret < 0 ? NXFFS_IXSTATE_INVALID :
+                NXFFS_IXSTATE_VALID);
+  volume->ndeleted = 0;
   return ret;
 }
 
@@ -130,6 +130,15 @@ int nxffs_rminode(FAR struct nxffs_volume_s *volume, FAR const char *name)
       ferr("ERROR: Failed to write block %d: %d\n",
            volume->ioblock, ret);
     }
+  else
+    {
+      nxffs_ixremove(volume, name, entry.hoffset);
+
+      /* The space used by the inode can be recovered by packing */
+
+      volume->ndeleted += nxffs_inodeend(volume, &entry) - entry.hoffset;
+      nxffs_gcschedule(volume);
+    }
 
 errout_with_entry:
   nxffs_freeentry(&entry);
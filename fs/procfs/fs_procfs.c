@@ -80,6 +80,7 @@ extern const struct procfs_operations proc_operations;
 extern const struct procfs_operations irq_operations;
 extern const struct procfs_operations cpuload_operations;
 extern const struct procfs_operations critmon_operations;
+extern const struct procfs_operations iobinfo_operations;
 extern const struct procfs_operations meminfo_operations;
 extern const struct procfs_operations module_operations;
 extern const struct procfs_operations uptime_operations;
@@ -130,6 +131,11 @@ static const struct procfs_entry_s g_procfs_entries[] =
   { "critmon",       &critmon_operations,         PROCFS_FILE_TYPE   },
 #endif
 
+#if defined(CONFIG_MM_IOB) && defined(CONFIG_IOB_STATISTICS) && \
+   !defined(CONFIG_FS_PROCFS_EXCLUDE_IOBINFO)
+  { "iobinfo",       &iobinfo_operations,         PROCFS_FILE_TYPE   },
+#endif
+
 #ifdef CONFIG_SCHED_IRQMONITOR
   { "irqs",          &irq_operations,             PROCFS_FILE_TYPE   },
 #endif
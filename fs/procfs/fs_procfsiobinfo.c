@@ -0,0 +1,358 @@
+/****************************************************************************
+ * fs/procfs/fs_procfsiobinfo.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/kmalloc.h>
+#include <nuttx/mm/iob.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/procfs.h>
+
+#if defined(CONFIG_MM_IOB) && defined(CONFIG_IOB_STATISTICS) && \
+   !defined(CONFIG_FS_PROCFS_EXCLUDE_IOBINFO)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+/* Determines the size of an intermediate buffer that must be large enough
+ * to handle the longest line generated by this logic.
+ */
+
+#define IOBINFO_LINELEN 32
+
+/* The number of lines of output */
+
+#define IOBINFO_NLINES  15
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* This structure describes one open "file" */
+
+struct iobinfo_file_s
+{
+  struct procfs_file_s base;      /* Base open file structure */
+  unsigned int linesize;          /* Number of valid characters in line[] */
+  char line[IOBINFO_LINELEN];     /* Pre-allocated buffer for formatted lines */
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+/* File system methods */
+
+static int     iobinfo_open(FAR struct file *filep, FAR const char *relpath,
+                 int oflags, mode_t mode);
+static int     iobinfo_close(FAR struct file *filep);
+static ssize_t iobinfo_read(FAR struct file *filep, FAR char *buffer,
+                 size_t buflen);
+static int     iobinfo_dup(FAR const struct file *oldp,
+                 FAR struct file *newp);
+static int     iobinfo_stat(FAR const char *relpath, FAR struct stat *buf);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The label of each line of output */
+
+static const char * const g_iobinfo_labels[IOBINFO_NLINES] =
+{
+  "Total:",      /* Total number of full-size I/O buffers */
+  "Free:",       /* Buffers in the global free list */
+  "Cached:",     /* Free buffers held in per-CPU caches */
+  "MinFree:",    /* Low-water mark of the global free list */
+  "Waiting:",    /* Threads waiting for a buffer */
+  "Chunks:",     /* Chunks allocated from the heap */
+  "SmallTotal:", /* Total number of small I/O buffers */
+  "SmallFree:",  /* Free small I/O buffers */
+  "Allocs:",     /* Successful allocations */
+  "Failed:",     /* Allocations that found no free buffer */
+  "Waits:",      /* Allocations that had to wait */
+  "WaitMsec:",   /* Total time spent waiting */
+  "MaxWait:",    /* Longest single wait (msec) */
+  "Grown:",      /* Number of times the pool was grown */
+  "Shrunk:"      /* Number of times the pool was shrunk */
+};
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* See fs_mount.c -- this structure is explicitly externed there.
+ * We use the old-fashioned kind of initializers so that this will compile
+ * with any compiler.
+ */
+
+const struct procfs_operations iobinfo_operations =
+{
+  iobinfo_open,   /* open */
+  iobinfo_close,  /* close */
+  iobinfo_read,   /* read */
+  NULL,           /* write */
+
+  iobinfo_dup,    /* dup */
+
+  NULL,           /* opendir */
+  NULL,           /* closedir */
+  NULL,           /* readdir */
+  NULL,           /* rewinddir */
+
+  iobinfo_stat    /* stat */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: iobinfo_open
+ ****************************************************************************/
+
+static int iobinfo_open(FAR struct file *filep, FAR const char *relpath,
+                        int oflags, mode_t mode)
+{
+  FAR struct iobinfo_file_s *procfile;
+
+  finfo("Open '%s'\n", relpath);
+
+  /* PROCFS is read-only.  Any attempt to open with any kind of write
+   * access is not permitted.
+   */
+
+  if ((oflags & O_WRONLY) != 0 || (oflags & O_RDONLY) == 0)
+    {
+      ferr("ERROR: Only O_RDONLY supported\n");
+      return -EACCES;
+    }
+
+  /* "iobinfo" is the only acceptable value for the relpath */
+
+  if (strcmp(relpath, "iobinfo") != 0)
+    {
+      ferr("ERROR: relpath is '%s'\n", relpath);
+      return -ENOENT;
+    }
+
+  /* Allocate a container to hold the file attributes */
+
+  procfile = (FAR struct iobinfo_file_s *)
+    kmm_zalloc(sizeof(struct iobinfo_file_s));
+  if (!procfile)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* Save the attributes as the open-specific state in filep->f_priv */
+
+  filep->f_priv = (FAR void *)procfile;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: iobinfo_close
+ ****************************************************************************/
+
+static int iobinfo_close(FAR struct file *filep)
+{
+  FAR struct iobinfo_file_s *procfile;
+
+  /* Recover our private data from the struct file instance */
+
+  procfile = (FAR struct iobinfo_file_s *)filep->f_priv;
+  DEBUGASSERT(procfile);
+
+  /* Release the file attributes structure */
+
+  kmm_free(procfile);
+  filep->f_priv = NULL;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: iobinfo_read
+ ****************************************************************************/
+
+static ssize_t iobinfo_read(FAR struct file *filep, FAR char *buffer,
+                            size_t buflen)
+{
+  FAR struct iobinfo_file_s *procfile;
+  struct iobinfo_s info;
+  size_t linesize;
+  size_t copysize;
+  size_t totalsize;
+  off_t offset;
+  int i;
+
+  unsigned long values[IOBINFO_NLINES];
+
+  finfo("buffer=%p buflen=%d\n", buffer, (int)buflen);
+
+  DEBUGASSERT(filep != NULL && buffer != NULL && buflen > 0);
+  offset = filep->f_pos;
+
+  /* Recover our private data from the struct file instance */
+
+  procfile = (FAR struct iobinfo_file_s *)filep->f_priv;
+  DEBUGASSERT(procfile);
+
+  /* Get a snapshot of the I/O buffer pool */
+
+  iob_info(&info);
+
+  values[0]  = info.ntotal;
+  values[1]  = info.nfree;
+  values[2]  = info.ncached;
+  values[3]  = info.nminfree;
+  values[4]  = info.nwaiting;
+  values[5]  = info.nchunks;
+  values[6]  = info.nsmall;
+  values[7]  = info.nsmallfree;
+  values[8]  = info.nalloc;
+  values[9]  = info.nfailed;
+  values[10] = info.nwaits;
+  values[11] = info.waittime;
+  values[12] = info.maxwait;
+  values[13] = info.ngrow;
+  values[14] = info.nshrink;
+
+  /* Each line of output is one labeled value */
+
+  totalsize = 0;
+  for (i = 0; i < IOBINFO_NLINES && totalsize < buflen; i++)
+    {
+      linesize   = snprintf(procfile->line, IOBINFO_LINELEN, "%-12s%10lu\n",
+                            g_iobinfo_labels[i], values[i]);
+      copysize   = procfs_memcpy(procfile->line, linesize, buffer, buflen,
+                                 &offset);
+      totalsize += copysize;
+      buffer    += copysize;
+      buflen    -= copysize;
+    }
+
+  /* Update the file offset */
+
+  filep->f_pos += totalsize;
+  return totalsize;
+}
+
+/****************************************************************************
+ * Name: iobinfo_dup
+ *
+ * Description:
+ *   Duplicate open file data in the new file structure.
+ *
+ ****************************************************************************/
+
+static int iobinfo_dup(FAR const struct file *oldp, FAR struct file *newp)
+{
+  FAR struct iobinfo_file_s *oldattr;
+  FAR struct iobinfo_file_s *newattr;
+
+  finfo("Dup %p->%p\n", oldp, newp);
+
+  /* Recover our private data from the old struct file instance */
+
+  oldattr = (FAR struct iobinfo_file_s *)oldp->f_priv;
+  DEBUGASSERT(oldattr);
+
+  /* Allocate a new container to hold the task and attribute selection */
+
+  newattr = (FAR struct iobinfo_file_s *)
+    kmm_malloc(sizeof(struct iobinfo_file_s));
+  if (!newattr)
+    {
+      ferr("ERROR: Failed to allocate file attributes\n");
+      return -ENOMEM;
+    }
+
+  /* The copy the file attributes from the old attributes to the new */
+
+  memcpy(newattr, oldattr, sizeof(struct iobinfo_file_s));
+
+  /* Save the new attributes in the new file structure */
+
+  newp->f_priv = (FAR void *)newattr;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: iobinfo_stat
+ *
+ * Description: Return information about a file or directory
+ *
+ ****************************************************************************/
+
+static int iobinfo_stat(FAR const char *relpath, FAR struct stat *buf)
+{
+  /* "iobinfo" is the only acceptable value for the relpath */
+
+  if (strcmp(relpath, "iobinfo") != 0)
+    {
+      ferr("ERROR: relpath is '%s'\n", relpath);
+      return -ENOENT;
+    }
+
+  /* "iobinfo" is the name for a read-only file */
+
+  memset(buf, 0, sizeof(struct stat));
+  buf->st_mode = S_IFREG | S_IROTH | S_IRGRP | S_IRUSR;
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+#endif /* CONFIG_MM_IOB && CONFIG_IOB_STATISTICS && !CONFIG_FS_PROCFS_EXCLUDE_IOBINFO */
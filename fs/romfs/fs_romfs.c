@@ -81,6 +81,8 @@ static int     romfs_dup(FAR const struct file *oldp,
                          FAR struct file *newp);
 static int     romfs_fstat(FAR const struct file *filep,
                            FAR struct stat *buf);
+static int     romfs_fadvise(FAR struct file *filep, off_t offset,
+                             off_t len, int advice);
 
 static int     romfs_opendir(FAR struct inode *mountpt,
                              FAR const char *relpath,
@@ -138,7 +140,8 @@ const struct mountpt_operations romfs_operations =
   NULL,            /* mkdir */
   NULL,            /* rmdir */
   NULL,            /* rename */
-  romfs_stat       /* stat */
+  romfs_stat,      /* stat */
+  romfs_fadvise    /* fadvise */
 };
 
 /****************************************************************************
@@ -748,6 +751,71 @@ static int romfs_fstat(FAR const struct file *filep, FAR struct stat *buf)
   return ret;
 }
 
+/****************************************************************************
+ * Name: romfs_fadvise
+ *
+ * Description:
+ *   With POSIX_FADV_WILLNEED, ask the block buffer cache to read ahead the
+ *   sectors of the range.  ROMFS file data is contiguous, so no look-up is
+ *   needed.  Other advice is accepted but has no effect.
+ *
+ ****************************************************************************/
+
+static int romfs_fadvise(FAR struct file *filep, off_t offset, off_t len,
+                         int advice)
+{
+#ifdef CONFIG_ROMFS_BCACHE
+  FAR struct romfs_mountpt_s *rm;
+  FAR struct romfs_file_s *rf;
+  uint32_t sector;
+  uint32_t last;
+  off_t end;
+  int ret;
+
+  if (advice != POSIX_FADV_WILLNEED)
+    {
+      return OK;
+    }
+
+  /* Sanity checks */
+
+  DEBUGASSERT(filep->f_priv != NULL && filep->f_inode != NULL);
+
+  /* Recover our private data from the struct file instance */
+
+  rf = filep->f_priv;
+  rm = (FAR struct romfs_mountpt_s *)filep->f_inode->i_private;
+  DEBUGASSERT(rm != NULL);
+
+  /* Check if the mount is still healthy */
+
+  romfs_semtake(rm);
+  ret = romfs_checkmount(rm);
+  if (ret >= 0 && rm->rm_bcache != NULL && offset < (off_t)rf->rf_size)
+    {
+      end = rf->rf_size;
+      if (len > 0 && len < end - offset)
+        {
+          end = offset + len;
+        }
+
+      sector = (rf->rf_startoffset + offset) / rm->rm_hwsectorsize;
+      last   = (rf->rf_startoffset + end - 1) / rm->rm_hwsectorsize;
+
+      bcache_readahead(rm->rm_bcache, sector, last - sector + 1);
+    }
+
+  romfs_semgive(rm);
+  return ret < 0 ? ret : OK;
+#else
+  /* Without the cache, the data is either directly accessible (XIP) or
+   * there is nowhere to keep it.
+   */
+
+  return OK;
+#endif
+}
+
 /****************************************************************************
  * Name: romfs_opendir
  *
@@ -1026,6 +1094,13 @@ static int romfs_bind(FAR struct inode *blkdriver, FAR const void *data,
 errout_with_buffer:
   if (!rm->rm_xipbase)
     {
+#ifdef CONFIG_ROMFS_BCACHE
+      if (rm->rm_bcache)
+        {
+          (void)bcache_detach(rm->rm_bcache);
+        }
+#endif
+
       kmm_free(rm->rm_buffer);
     }
 
@@ -1107,6 +1182,13 @@ static int romfs_unbind(FAR void *handle, FAR struct inode **blkdriver,
           kmm_free(rm->rm_buffer);
         }
 
+#ifdef CONFIG_ROMFS_BCACHE
+      if (rm->rm_bcache)
+        {
+          (void)bcache_detach(rm->rm_bcache);
+        }
+#endif
+
       nxsem_destroy(&rm->rm_sem);
       kmm_free(rm);
       return OK;
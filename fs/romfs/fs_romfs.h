@@ -48,6 +48,7 @@
 #include <stdbool.h>
 
 #include <nuttx/fs/dirent.h>
+#include <nuttx/fs/bcache.h>
 
 #include "inode/inode.h"
 
@@ -149,6 +150,9 @@ struct romfs_mountpt_s
   uint32_t rm_cachesector;          /* Current sector in the rm_buffer */
   uint8_t *rm_xipbase;              /* Base address of directly accessible media */
   uint8_t *rm_buffer;               /* Device sector buffer, allocated if rm_xipbase==0 */
+#ifdef CONFIG_ROMFS_BCACHE
+  FAR struct bcache_dev_s *rm_bcache; /* Block buffer cache handle (may be NULL) */
+#endif
 };
 
 /* This structure represents on open file under the mountpoint.  An instance
@@ -387,6 +387,13 @@ int romfs_hwread(struct romfs_mountpt_s *rm, uint8_t *buffer, uint32_t sector,
       struct inode *inode = rm->rm_blkdriver;
       ssize_t nsectorsread;
 
+#ifdef CONFIG_ROMFS_BCACHE
+      if (rm->rm_bcache)
+        {
+          return bcache_read(rm->rm_bcache, buffer, sector, nsectors);
+        }
+#endif
+
       DEBUGASSERT(inode);
       if (inode->u.i_bops && inode->u.i_bops->read)
         {
@@ -453,6 +460,24 @@ int romfs_filecacheread(struct romfs_mountpt_s *rm, struct romfs_file_s *rf,
               ferr("ERROR: romfs_hwread failed: %d\n", ret);
               return ret;
             }
+
+#ifdef CONFIG_ROMFS_BCACHE
+          /* ROMFS file data is contiguous.  If the file is being read
+           * sequentially, then ask for the following sectors of the file
+           * to be read ahead.
+           */
+
+          if (rm->rm_bcache && sector == rf->rf_cachesector + 1)
+            {
+              uint32_t last = (rf->rf_startoffset + rf->rf_size - 1) /
+                              rm->rm_hwsectorsize;
+
+              if (last > sector)
+                {
+                  bcache_readahead(rm->rm_bcache, sector + 1, last - sector);
+                }
+            }
+#endif
         }
 
       /* Update the cached sector number */
@@ -533,6 +558,14 @@ int romfs_hwconfigure(struct romfs_mountpt_s *rm)
       return -ENOMEM;
     }
 
+#ifdef CONFIG_ROMFS_BCACHE
+  /* Access the device through the block buffer cache, if possible.  If not,
+   * rm_bcache is NULL and the block driver is accessed directly.
+   */
+
+  rm->rm_bcache = bcache_attach(inode, rm->rm_hwsectorsize);
+#endif
+
   return OK;
 }
 
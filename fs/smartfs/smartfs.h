@@ -49,6 +49,7 @@
 
 #include <nuttx/mtd/mtd.h>
 #include <nuttx/fs/smart.h>
+#include <nuttx/fs/bcache.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -186,7 +187,15 @@
 /* Underlying MTD Block driver access functions */
 
 #define FS_BOPS(f)        (f)->fs_blkdriver->u.i_bops
-#define FS_IOCTL(f,c,a)   (FS_BOPS(f)->ioctl ? FS_BOPS(f)->ioctl((f)->fs_blkdriver,c,a) : (-ENOSYS))
+#define FS_BIOCTL(f,c,a)  (FS_BOPS(f)->ioctl ? FS_BOPS(f)->ioctl((f)->fs_blkdriver,c,a) : (-ENOSYS))
+
+/* Logical sector accesses go through the block buffer cache, if enabled */
+
+#ifdef CONFIG_SMARTFS_BCACHE
+#  define FS_IOCTL(f,c,a) smartfs_blkioctl(f,c,a)
+#else
+#  define FS_IOCTL(f,c,a) FS_BIOCTL(f,c,a)
+#endif
 
 /* The logical sector number of the root directory. */
 
@@ -222,10 +231,24 @@
 #define SMARTFS_NEXTSECTOR(h)    (*((uint16_t *)h->nextsector))
 #define SMARTFS_USED(h)          (*((uint16_t *)h->used))
 
-#ifdef CONFIG_MTD_SMART_ENABLE_CRC
+#if defined(CONFIG_MTD_SMART_ENABLE_CRC) || defined(CONFIG_SMARTFS_WRITEBUFFER)
 #define CONFIG_SMARTFS_USE_SECTOR_BUFFER
 #endif
 
+/* Directory index definitions */
+
+#ifdef CONFIG_SMARTFS_DIRINDEX
+#  ifndef CONFIG_SMARTFS_DIRINDEX_NDIRS
+#    define CONFIG_SMARTFS_DIRINDEX_NDIRS 8
+#  endif
+#  ifndef CONFIG_SMARTFS_DIRINDEX_NBUCKETS
+#    define CONFIG_SMARTFS_DIRINDEX_NBUCKETS 32
+#  endif
+#  ifndef CONFIG_SMARTFS_DIRINDEX_MAXENTRIES
+#    define CONFIG_SMARTFS_DIRINDEX_MAXENTRIES 512
+#  endif
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -315,6 +338,34 @@ struct smartfs_ofile_s
                                           * causes the sector to change. */
 };
 
+#ifdef CONFIG_SMARTFS_DIRINDEX
+/* This structure locates one active directory entry of an indexed
+ * directory.  Entries are hashed by name.
+ */
+
+struct smartfs_dirindex_entry_s
+{
+  FAR struct smartfs_dirindex_entry_s *flink; /* Next entry in the bucket */
+  uint16_t          dfirst;       /* 1st sector of the directory */
+  uint16_t          hash;         /* Hash of the entry name */
+  uint16_t          dsector;      /* Sector of the directory entry */
+  uint16_t          doffset;      /* Offset of the directory entry */
+};
+
+/* This structure is the in-memory index of the entries of the most recently
+ * searched directories of one mountpoint.
+ */
+
+struct smartfs_dirindex_s
+{
+  FAR struct smartfs_dirindex_entry_s *bucket[CONFIG_SMARTFS_DIRINDEX_NBUCKETS];
+  uint16_t          dfirst[CONFIG_SMARTFS_DIRINDEX_NDIRS]; /* Indexed dirs, MRU first */
+  uint16_t          ndirs;        /* Number of indexed directories */
+  uint16_t          nentries;     /* Number of entries in the hash table */
+  uint16_t          toobig;       /* Directory with too many entries to index */
+};
+#endif
+
 /* This structure represents the overall mountpoint state.  An instance of this
  * structure is retained as inode private data on each mountpoint that is
  * mounted with a smartfs filesystem.
@@ -333,6 +384,12 @@ struct smartfs_mountpt_s
   char                       *fs_rwbuffer;  /* Read/Write working buffer */
   char                       *fs_workbuffer;/* Working buffer */
   uint8_t                     fs_rootsector;/* Root directory sector num */
+#ifdef CONFIG_SMARTFS_BCACHE
+  FAR struct bcache_dev_s    *fs_bcache;    /* Block buffer cache handle */
+#endif
+#ifdef CONFIG_SMARTFS_DIRINDEX
+  struct smartfs_dirindex_s   fs_dirindex;  /* Directory entry index */
+#endif
 };
 
 /****************************************************************************
@@ -356,6 +413,11 @@ struct smartfs_mountpt_s;
 
 int smartfs_mount(FAR struct smartfs_mountpt_s *fs, bool writeable);
 
+#ifdef CONFIG_SMARTFS_BCACHE
+int smartfs_blkioctl(FAR struct smartfs_mountpt_s *fs, int cmd,
+                     unsigned long arg);
+#endif
+
 int smartfs_unmount(FAR struct smartfs_mountpt_s *fs);
 
 int smartfs_finddirentry(FAR struct smartfs_mountpt_s *fs,
@@ -386,6 +448,24 @@ int smartfs_shrinkfile(FAR struct smartfs_mountpt_s *fs,
 int smartfs_extendfile(FAR struct smartfs_mountpt_s *fs,
         FAR struct smartfs_ofile_s *sf, off_t length);
 
+#ifdef CONFIG_SMARTFS_DIRINDEX
+int smartfs_dirindex_lookup(FAR struct smartfs_mountpt_s *fs,
+        uint16_t dfirst, FAR const char *name, FAR uint16_t *dsector,
+        FAR uint16_t *doffset);
+
+void smartfs_dirindex_insert(FAR struct smartfs_mountpt_s *fs,
+        uint16_t dfirst, FAR const char *name, uint16_t dsector,
+        uint16_t doffset);
+
+void smartfs_dirindex_remove(FAR struct smartfs_mountpt_s *fs,
+        FAR const char *name, uint16_t dsector, uint16_t doffset);
+
+void smartfs_dirindex_forget(FAR struct smartfs_mountpt_s *fs,
+        uint16_t dfirst);
+
+void smartfs_dirindex_release(FAR struct smartfs_mountpt_s *fs);
+#endif
+
 uint16_t smartfs_rdle16(FAR const void *val);
 
 void smartfs_wrle16(void *dest, uint16_t val);
@@ -0,0 +1,547 @@
+/****************************************************************************
+ * fs/smartfs/smartfs_dirindex.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/kmalloc.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
+
+#include "smartfs.h"
+
+#ifdef CONFIG_SMARTFS_DIRINDEX
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: smartfs_dirindex_hash
+ *
+ * Description:
+ *   Return a 16-bit hash of the first 'namesize' characters of a name.
+ *   Only that many characters are compared when a directory is searched.
+ *
+ ****************************************************************************/
+
+static uint16_t smartfs_dirindex_hash(FAR const char *name, uint16_t namesize)
+{
+  uint32_t hash = 2166136261ul;
+  uint16_t i;
+
+  for (i = 0; i < namesize && name[i] != '\0'; i++)
+    {
+      hash ^= (uint8_t)name[i];
+      hash *= 16777619ul;
+    }
+
+  return (uint16_t)(hash ^ (hash >> 16));
+}
+
+/****************************************************************************
+ * Name: smartfs_dirindex_active
+ *
+ * Description:
+ *   Return true if the directory entry is in use and active.
+ *
+ ****************************************************************************/
+
+static bool smartfs_dirindex_active(FAR struct smartfs_entry_header_s *entry)
+{
+  uint16_t flags;
+
+#ifdef CONFIG_SMARTFS_ALIGNED_ACCESS
+  flags = smartfs_rdle16(&entry->flags);
+#else
+  flags = entry->flags;
+#endif
+
+  return (flags & SMARTFS_DIRENT_EMPTY) !=
+         (SMARTFS_ERASEDSTATE_16BIT & SMARTFS_DIRENT_EMPTY) &&
+         (flags & SMARTFS_DIRENT_ACTIVE) ==
+         (SMARTFS_ERASEDSTATE_16BIT & SMARTFS_DIRENT_ACTIVE);
+}
+
+/****************************************************************************
+ * Name: smartfs_dirindex_finddir
+ *
+ * Description:
+ *   Return the position of the directory in the list of indexed
+ *   directories or -1 if the directory is not indexed.
+ *
+ ****************************************************************************/
+
+static int smartfs_dirindex_finddir(FAR struct smartfs_dirindex_s *index,
+                                    uint16_t dfirst)
+{
+  int i;
+
+  for (i = 0; i < index->ndirs; i++)
+    {
+      if (index->dfirst[i] == dfirst)
+        {
+          return i;
+        }
+    }
+
+  return -1;
+}
+
+/****************************************************************************
+ * Name: smartfs_dirindex_add
+ *
+ * Description:
+ *   Add one directory entry to the hash table.
+ *
+ ****************************************************************************/
+
+static int smartfs_dirindex_add(FAR struct smartfs_dirindex_s *index,
+                                uint16_t dfirst, uint16_t hash,
+                                uint16_t dsector, uint16_t doffset)
+{
+  FAR struct smartfs_dirindex_entry_s *node;
+  int ndx;
+
+  if (index->nentries >= CONFIG_SMARTFS_DIRINDEX_MAXENTRIES)
+    {
+      return -ENOSPC;
+    }
+
+  node = (FAR struct smartfs_dirindex_entry_s *)
+    kmm_malloc(sizeof(struct smartfs_dirindex_entry_s));
+  if (node == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  node->dfirst  = dfirst;
+  node->hash    = hash;
+  node->dsector = dsector;
+  node->doffset = doffset;
+
+  ndx                 = hash % CONFIG_SMARTFS_DIRINDEX_NBUCKETS;
+  node->flink         = index->bucket[ndx];
+  index->bucket[ndx]  = node;
+  index->nentries++;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: smartfs_dirindex_evict
+ *
+ * Description:
+ *   Remove the directory at position 'pos' of the list of indexed
+ *   directories together with all of its entries.
+ *
+ ****************************************************************************/
+
+static void smartfs_dirindex_evict(FAR struct smartfs_dirindex_s *index,
+                                   int pos)
+{
+  FAR struct smartfs_dirindex_entry_s **prev;
+  FAR struct smartfs_dirindex_entry_s *node;
+  uint16_t dfirst = index->dfirst[pos];
+  int ndx;
+
+  for (ndx = 0; ndx < CONFIG_SMARTFS_DIRINDEX_NBUCKETS; ndx++)
+    {
+      prev = &index->bucket[ndx];
+      while ((node = *prev) != NULL)
+        {
+          if (node->dfirst == dfirst)
+            {
+              *prev = node->flink;
+              kmm_free(node);
+              index->nentries--;
+            }
+          else
+            {
+              prev = &node->flink;
+            }
+        }
+    }
+
+  index->ndirs--;
+  memmove(&index->dfirst[pos], &index->dfirst[pos + 1],
+          (index->ndirs - pos) * sizeof(uint16_t));
+}
+
+/****************************************************************************
+ * Name: smartfs_dirindex_build
+ *
+ * Description:
+ *   Read the sector chain of a directory and add all of its active entries
+ *   to the index.  The least recently used directories are dropped from
+ *   the index to make room, if necessary.
+ *
+ ****************************************************************************/
+
+static int smartfs_dirindex_build(FAR struct smartfs_mountpt_s *fs,
+                                  uint16_t dfirst)
+{
+  FAR struct smartfs_dirindex_s *index = &fs->fs_dirindex;
+  FAR struct smartfs_chain_header_s *header;
+  FAR struct smartfs_entry_header_s *entry;
+  struct smart_read_write_s readwrite;
+  uint16_t entrysize;
+  uint16_t dirsector;
+  uint16_t offset;
+  int ret;
+
+  if (index->ndirs >= CONFIG_SMARTFS_DIRINDEX_NDIRS)
+    {
+      smartfs_dirindex_evict(index, index->ndirs - 1);
+    }
+
+  /* Add the directory as the most recently used one */
+
+  memmove(&index->dfirst[1], &index->dfirst[0],
+          index->ndirs * sizeof(uint16_t));
+  index->dfirst[0] = dfirst;
+  index->ndirs++;
+
+  entrysize = sizeof(struct smartfs_entry_header_s) + fs->fs_llformat.namesize;
+  dirsector = dfirst;
+
+  while (dirsector != SMARTFS_ERASEDSTATE_16BIT)
+    {
+      readwrite.logsector = dirsector;
+      readwrite.offset    = 0;
+      readwrite.count     = fs->fs_llformat.availbytes;
+      readwrite.buffer    = (FAR uint8_t *)fs->fs_rwbuffer;
+
+      ret = FS_IOCTL(fs, BIOC_READSECT, (unsigned long)&readwrite);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+
+      header    = (FAR struct smartfs_chain_header_s *)fs->fs_rwbuffer;
+      dirsector = SMARTFS_NEXTSECTOR(header);
+
+      for (offset = sizeof(struct smartfs_chain_header_s);
+           offset + entrysize <= readwrite.count;
+           offset += entrysize)
+        {
+          entry = (FAR struct smartfs_entry_header_s *)
+            &fs->fs_rwbuffer[offset];
+          if (!smartfs_dirindex_active(entry))
+            {
+              continue;
+            }
+
+          /* Make room by dropping the least recently used directories */
+
+          while (index->nentries >= CONFIG_SMARTFS_DIRINDEX_MAXENTRIES &&
+                 index->ndirs > 1)
+            {
+              smartfs_dirindex_evict(index, index->ndirs - 1);
+            }
+
+          ret = smartfs_dirindex_add(index, dfirst,
+                  smartfs_dirindex_hash(entry->name,
+                                        fs->fs_llformat.namesize),
+                  readwrite.logsector, offset);
+          if (ret < 0)
+            {
+              goto errout;
+            }
+        }
+    }
+
+  return OK;
+
+errout:
+
+  /* A partial index would report entries that exist as missing */
+
+  smartfs_dirindex_forget(fs, dfirst);
+  if (ret == -ENOSPC)
+    {
+      /* Do not try to index this directory on every lookup */
+
+      index->toobig = dfirst;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: smartfs_dirindex_search
+ *
+ * Description:
+ *   Look up a name in an indexed directory.  The directory sector holding
+ *   each candidate entry is read and the name is compared.
+ *
+ ****************************************************************************/
+
+static int smartfs_dirindex_search(FAR struct smartfs_mountpt_s *fs,
+                                   uint16_t dfirst, FAR const char *name,
+                                   FAR uint16_t *dsector,
+                                   FAR uint16_t *doffset)
+{
+  FAR struct smartfs_dirindex_s *index = &fs->fs_dirindex;
+  FAR struct smartfs_dirindex_entry_s *node;
+  FAR struct smartfs_entry_header_s *entry;
+  struct smart_read_write_s readwrite;
+  uint16_t hash;
+  int ret;
+
+  hash = smartfs_dirindex_hash(name, fs->fs_llformat.namesize);
+  for (node = index->bucket[hash % CONFIG_SMARTFS_DIRINDEX_NBUCKETS];
+       node != NULL;
+       node = node->flink)
+    {
+      if (node->dfirst != dfirst || node->hash != hash)
+        {
+          continue;
+        }
+
+      readwrite.logsector = node->dsector;
+      readwrite.offset    = 0;
+      readwrite.count     = fs->fs_llformat.availbytes;
+      readwrite.buffer    = (FAR uint8_t *)fs->fs_rwbuffer;
+
+      ret = FS_IOCTL(fs, BIOC_READSECT, (unsigned long)&readwrite);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      entry = (FAR struct smartfs_entry_header_s *)
+        &fs->fs_rwbuffer[node->doffset];
+      if (!smartfs_dirindex_active(entry))
+        {
+          /* The index is out of date.  Drop the directory; it will be
+           * scanned again.
+           */
+
+          ferr("ERROR: Stale index entry at sector %d\n", node->dsector);
+          smartfs_dirindex_forget(fs, dfirst);
+          return -EAGAIN;
+        }
+
+      if (strncmp(entry->name, name, fs->fs_llformat.namesize) == 0)
+        {
+          *dsector = node->dsector;
+          *doffset = node->doffset;
+          return OK;
+        }
+    }
+
+  return -ENOENT;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: smartfs_dirindex_lookup
+ *
+ * Description:
+ *   Find the entry 'name' in the directory starting at logical sector
+ *   'dfirst' using the directory index.  The index of the directory is
+ *   built when the directory is first searched.
+ *
+ * Returned Value:
+ *   OK if the entry was found.  Its location is returned in 'dsector' and
+ *   'doffset' and the directory sector is in fs->fs_rwbuffer.  -ENOENT if
+ *   the directory does not hold the entry.  Any other negated errno value
+ *   means that the directory must be searched without the index.
+ *
+ ****************************************************************************/
+
+int smartfs_dirindex_lookup(FAR struct smartfs_mountpt_s *fs,
+                            uint16_t dfirst, FAR const char *name,
+                            FAR uint16_t *dsector, FAR uint16_t *doffset)
+{
+  FAR struct smartfs_dirindex_s *index = &fs->fs_dirindex;
+  int pos;
+  int ret;
+
+  if (dfirst == index->toobig)
+    {
+      return -ENOSPC;
+    }
+
+  pos = smartfs_dirindex_finddir(index, dfirst);
+  if (pos < 0)
+    {
+      ret = smartfs_dirindex_build(fs, dfirst);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+  else if (pos > 0)
+    {
+      /* Make this the most recently used directory */
+
+      memmove(&index->dfirst[1], &index->dfirst[0], pos * sizeof(uint16_t));
+      index->dfirst[0] = dfirst;
+    }
+
+  return smartfs_dirindex_search(fs, dfirst, name, dsector, doffset);
+}
+
+/****************************************************************************
+ * Name: smartfs_dirindex_insert
+ *
+ * Description:
+ *   Record a new entry in the directory starting at logical sector
+ *   'dfirst', if that directory is indexed.
+ *
+ ****************************************************************************/
+
+void smartfs_dirindex_insert(FAR struct smartfs_mountpt_s *fs,
+                             uint16_t dfirst, FAR const char *name,
+                             uint16_t dsector, uint16_t doffset)
+{
+  FAR struct smartfs_dirindex_s *index = &fs->fs_dirindex;
+
+  if (smartfs_dirindex_finddir(index, dfirst) >= 0 &&
+      smartfs_dirindex_add(index, dfirst,
+                           smartfs_dirindex_hash(name,
+                                                 fs->fs_llformat.namesize),
+                           dsector, doffset) < 0)
+    {
+      /* The directory can no longer be indexed completely */
+
+      smartfs_dirindex_forget(fs, dfirst);
+    }
+}
+
+/****************************************************************************
+ * Name: smartfs_dirindex_remove
+ *
+ * Description:
+ *   Remove the entry at 'dsector' and 'doffset' from the index.
+ *
+ ****************************************************************************/
+
+void smartfs_dirindex_remove(FAR struct smartfs_mountpt_s *fs,
+                             FAR const char *name, uint16_t dsector,
+                             uint16_t doffset)
+{
+  FAR struct smartfs_dirindex_s *index = &fs->fs_dirindex;
+  FAR struct smartfs_dirindex_entry_s **prev;
+  FAR struct smartfs_dirindex_entry_s *node;
+  uint16_t hash;
+
+  /* A directory that was too big to index may fit now */
+
+  index->toobig = 0;
+
+  hash = smartfs_dirindex_hash(name, fs->fs_llformat.namesize);
+  prev = &index->bucket[hash % CONFIG_SMARTFS_DIRINDEX_NBUCKETS];
+
+  while ((node = *prev) != NULL)
+    {
+      if (node->dsector == dsector && node->doffset == doffset)
+        {
+          *prev = node->flink;
+          kmm_free(node);
+          index->nentries--;
+          return;
+        }
+
+      prev = &node->flink;
+    }
+}
+
+/****************************************************************************
+ * Name: smartfs_dirindex_forget
+ *
+ * Description:
+ *   Drop the index of the directory starting at logical sector 'dfirst'.
+ *   This must be done when the directory is deleted because its first
+ *   sector may later be reused by another directory.
+ *
+ ****************************************************************************/
+
+void smartfs_dirindex_forget(FAR struct smartfs_mountpt_s *fs,
+                             uint16_t dfirst)
+{
+  int pos;
+
+  pos = smartfs_dirindex_finddir(&fs->fs_dirindex, dfirst);
+  if (pos >= 0)
+    {
+      smartfs_dirindex_evict(&fs->fs_dirindex, pos);
+    }
+}
+
+/****************************************************************************
+ * Name: smartfs_dirindex_release
+ *
+ * Description:
+ *   Free the directory index when the volume is unmounted.
+ *
+ ****************************************************************************/
+
+void smartfs_dirindex_release(FAR struct smartfs_mountpt_s *fs)
+{
+  FAR struct smartfs_dirindex_s *index = &fs->fs_dirindex;
+  FAR struct smartfs_dirindex_entry_s *node;
+  int ndx;
+
+  for (ndx = 0; ndx < CONFIG_SMARTFS_DIRINDEX_NBUCKETS; ndx++)
+    {
+      while ((node = index->bucket[ndx]) != NULL)
+        {
+          index->bucket[ndx] = node->flink;
+          kmm_free(node);
+        }
+    }
+
+  index->nentries = 0;
+  index->ndirs    = 0;
+  index->toobig   = 0;
+}
+
+#endif /* CONFIG_SMARTFS_DIRINDEX */
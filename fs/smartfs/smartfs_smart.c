@@ -527,6 +527,23 @@ static ssize_t smartfs_read(FAR struct file *filep, char *buffer, size_t buflen)
 
   smartfs_semtake(fs);
 
+  /* Data written to the current sector must be on the device before it
+   * can be read back.
+   */
+
+#ifdef CONFIG_SMARTFS_USE_SECTOR_BUFFER
+  if ((sf->bflags & SMARTFS_BFLAG_DIRTY) != 0)
+#else
+  if (sf->byteswritten > 0)
+#endif
+    {
+      ret = smartfs_sync_internal(fs, sf);
+      if (ret < 0)
+        {
+          goto errout_with_semaphore;
+        }
+    }
+
   /* Loop until all byte read or error */
 
   bytesread = 0;
@@ -555,6 +572,12 @@ static ssize_t smartfs_read(FAR struct file *filep, char *buffer, size_t buflen)
           goto errout_with_semaphore;
         }
 
+#ifdef CONFIG_SMARTFS_USE_SECTOR_BUFFER
+      /* Keep the current sector in the sector buffer for later writes */
+
+      memcpy(sf->buffer, fs->fs_rwbuffer, fs->fs_llformat.availbytes);
+#endif
+
       /* Point header to the read data to get used byte count */
 
       header = (struct smartfs_chain_header_s *) fs->fs_rwbuffer;
@@ -721,6 +744,13 @@ static ssize_t smartfs_write(FAR struct file *filep, const char *buffer,
               goto errout_with_semaphore;
             }
 
+#ifdef CONFIG_SMARTFS_USE_SECTOR_BUFFER
+          /* The sector buffer holds the current sector, too */
+
+          memcpy(&sf->buffer[sf->curroffset], readwrite.buffer,
+                 readwrite.count);
+#endif
+
           /* Update our control variables */
 
           sf->filepos += readwrite.count;
@@ -753,6 +783,24 @@ static ssize_t smartfs_write(FAR struct file *filep, const char *buffer,
 
           sf->curroffset = sizeof(struct smartfs_chain_header_s);
           sf->currsector = SMARTFS_NEXTSECTOR(header);
+
+#ifdef CONFIG_SMARTFS_USE_SECTOR_BUFFER
+          /* Load the next sector into the sector buffer */
+
+          if (sf->currsector != SMARTFS_ERASEDSTATE_16BIT)
+            {
+              readwrite.logsector = sf->currsector;
+              readwrite.count = fs->fs_llformat.availbytes;
+              readwrite.buffer = sf->buffer;
+              ret = FS_IOCTL(fs, BIOC_READSECT, (unsigned long) &readwrite);
+              if (ret < 0)
+                {
+                  ferr("ERROR: Error %d reading sector %d data\n",
+                       ret, sf->currsector);
+                  goto errout_with_semaphore;
+                }
+            }
+#endif
         }
     }
 
@@ -965,7 +1013,21 @@ static off_t smartfs_seek(FAR struct file *filep, off_t offset, int whence)
 
 static int smartfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 {
-  /* We don't use any ioctls */
+  FAR struct smartfs_ofile_s *sf;
+
+  DEBUGASSERT(filep->f_priv != NULL);
+  sf = filep->f_priv;
+
+  /* The first sector of the file identifies the file */
+
+  if (cmd == FIOC_FILEID)
+    {
+      FAR uint32_t *fileid = (FAR uint32_t *)((uintptr_t)arg);
+
+      DEBUGASSERT(fileid != NULL);
+      *fileid = sf->entry.firstsector;
+      return OK;
+    }
 
   return -ENOSYS;
 }
@@ -1879,6 +1941,11 @@ int smartfs_rename(struct inode *mountpt, const char *oldrelpath,
                ret, readwrite.logsector);
           goto errout_with_semaphore;
         }
+
+#ifdef CONFIG_SMARTFS_DIRINDEX
+      smartfs_dirindex_remove(fs, oldentry.name, oldentry.dsector,
+                              oldentry.doffset);
+#endif
     }
   else
     {
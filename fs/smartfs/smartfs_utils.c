@@ -56,6 +56,18 @@
 
 #include "smartfs.h"
 
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_SMARTFS_BCACHE
+static ssize_t smartfs_bcread(FAR void *priv, FAR uint8_t *buffer,
+                              off_t sector, unsigned int nsectors);
+#endif
+static int smartfs_searchdir(FAR struct smartfs_mountpt_s *fs,
+                             uint16_t dfirst, FAR const char *name,
+                             FAR uint16_t *dsector, FAR uint16_t *doffset);
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -65,10 +77,220 @@
 static struct smartfs_mountpt_s *g_mounthead = NULL;
 #endif
 
+#ifdef CONFIG_SMARTFS_BCACHE
+/* Logical sectors are only written through smartfs_blkioctl() */
+
+static const struct bcache_ops_s g_smartfs_bcops =
+{
+  smartfs_bcread,  /* read */
+  NULL             /* write */
+};
+#endif
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: smartfs_bcread
+ *
+ * Description:
+ *   Read whole logical sectors for the block buffer cache.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SMARTFS_BCACHE
+static ssize_t smartfs_bcread(FAR void *priv, FAR uint8_t *buffer,
+                              off_t sector, unsigned int nsectors)
+{
+  FAR struct smartfs_mountpt_s *fs = (FAR struct smartfs_mountpt_s *)priv;
+  struct smart_read_write_s readwrite;
+  unsigned int i;
+  int ret;
+
+  for (i = 0; i < nsectors; i++)
+    {
+      readwrite.logsector = sector + i;
+      readwrite.offset    = 0;
+      readwrite.count     = fs->fs_llformat.availbytes;
+      readwrite.buffer    = buffer + i * fs->fs_llformat.availbytes;
+
+      ret = FS_BIOCTL(fs, BIOC_READSECT, (unsigned long)&readwrite);
+      if (ret < 0)
+        {
+          return i > 0 ? (ssize_t)i : (ssize_t)ret;
+        }
+    }
+
+  return nsectors;
+}
+#endif
+
+/****************************************************************************
+ * Name: smartfs_searchdir
+ *
+ * Description:
+ *   Search the directory starting at logical sector 'dfirst' for an active
+ *   entry matching 'name'.  On success, the directory sector holding the
+ *   entry is in fs->fs_rwbuffer and its logical sector number and the
+ *   offset of the entry are returned in 'dsector' and 'doffset'.
+ *   -ENOENT is returned if the directory has no such entry.
+ *
+ ****************************************************************************/
+
+static int smartfs_searchdir(FAR struct smartfs_mountpt_s *fs,
+                             uint16_t dfirst, FAR const char *name,
+                             FAR uint16_t *dsector, FAR uint16_t *doffset)
+{
+  FAR struct smartfs_chain_header_s *header;
+  FAR struct smartfs_entry_header_s *entry;
+  struct smart_read_write_s readwrite;
+  uint16_t dirsector;
+  uint16_t entrysize;
+  uint16_t offset;
+  int ret;
+
+#ifdef CONFIG_SMARTFS_DIRINDEX
+  /* Use the directory index, if possible */
+
+  ret = smartfs_dirindex_lookup(fs, dfirst, name, dsector, doffset);
+  if (ret == OK || ret == -ENOENT)
+    {
+      return ret;
+    }
+#endif
+
+  entrysize = sizeof(struct smartfs_entry_header_s) + fs->fs_llformat.namesize;
+  dirsector = dfirst;
+
+  while (dirsector != SMARTFS_ERASEDSTATE_16BIT)
+    {
+      /* Read the next directory in the chain */
+
+      readwrite.logsector = dirsector;
+      readwrite.count = fs->fs_llformat.availbytes;
+      readwrite.buffer = (uint8_t *)fs->fs_rwbuffer;
+      readwrite.offset = 0;
+      ret = FS_IOCTL(fs, BIOC_READSECT, (unsigned long) &readwrite);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      /* Point to next sector in chain */
+
+      header = (struct smartfs_chain_header_s *) fs->fs_rwbuffer;
+      dirsector = SMARTFS_NEXTSECTOR(header);
+
+      /* Search for the entry */
+
+      for (offset = sizeof(struct smartfs_chain_header_s);
+           offset + entrysize <= readwrite.count;
+           offset += entrysize)
+        {
+          entry = (struct smartfs_entry_header_s *) &fs->fs_rwbuffer[offset];
+
+          /* Test if this entry is valid and active */
+
+#ifdef CONFIG_SMARTFS_ALIGNED_ACCESS
+          if (((smartfs_rdle16(&entry->flags) & SMARTFS_DIRENT_EMPTY) ==
+              (SMARTFS_ERASEDSTATE_16BIT & SMARTFS_DIRENT_EMPTY)) ||
+              ((smartfs_rdle16(&entry->flags) & SMARTFS_DIRENT_ACTIVE) !=
+              (SMARTFS_ERASEDSTATE_16BIT & SMARTFS_DIRENT_ACTIVE)))
+#else
+          if (((entry->flags & SMARTFS_DIRENT_EMPTY) ==
+              (SMARTFS_ERASEDSTATE_16BIT & SMARTFS_DIRENT_EMPTY)) ||
+              ((entry->flags & SMARTFS_DIRENT_ACTIVE) !=
+              (SMARTFS_ERASEDSTATE_16BIT & SMARTFS_DIRENT_ACTIVE)))
+#endif
+            {
+              /* This entry isn't valid, skip it */
+
+              continue;
+            }
+
+          /* Test if the name matches */
+
+          if (strncmp(entry->name, name, fs->fs_llformat.namesize) == 0)
+            {
+              *dsector = readwrite.logsector;
+              *doffset = offset;
+              return OK;
+            }
+        }
+    }
+
+  return -ENOENT;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: smartfs_blkioctl
+ *
+ * Description:
+ *   Perform a SMART block driver ioctl, serving logical sector reads from
+ *   the block buffer cache and keeping the cache consistent with logical
+ *   sector writes, allocations and releases.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SMARTFS_BCACHE
+int smartfs_blkioctl(FAR struct smartfs_mountpt_s *fs, int cmd,
+                     unsigned long arg)
+{
+  FAR struct smart_read_write_s *req;
+  int ret;
+
+  if (fs->fs_bcache == NULL)
+    {
+      return FS_BIOCTL(fs, cmd, arg);
+    }
+
+  switch (cmd)
+    {
+      case BIOC_READSECT:
+        req = (FAR struct smart_read_write_s *)arg;
+        ret = bcache_readbytes(fs->fs_bcache, req->logsector, req->offset,
+                               (FAR uint8_t *)req->buffer, req->count);
+        return ret < 0 ? ret : req->count;
+
+      case BIOC_WRITESECT:
+        req = (FAR struct smart_read_write_s *)arg;
+        ret = FS_BIOCTL(fs, cmd, arg);
+        if (ret >= 0)
+          {
+            bcache_update(fs->fs_bcache, req->logsector, req->offset,
+                          req->buffer, req->count);
+          }
+        else
+          {
+            bcache_invalidate(fs->fs_bcache, req->logsector, 1);
+          }
+
+        return ret;
+
+      case BIOC_FREESECT:
+        bcache_invalidate(fs->fs_bcache, (off_t)arg, 1);
+        return FS_BIOCTL(fs, cmd, arg);
+
+      case BIOC_ALLOCSECT:
+        ret = FS_BIOCTL(fs, cmd, arg);
+        if (ret >= 0)
+          {
+            bcache_invalidate(fs->fs_bcache, ret, 1);
+          }
+
+        return ret;
+
+      default:
+        return FS_BIOCTL(fs, cmd, arg);
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: smartfs_semtake
  ****************************************************************************/
@@ -312,6 +534,15 @@ int smartfs_mount(struct smartfs_mountpt_s *fs, bool writeable)
   fs->fs_workbuffer = (char *) kmm_malloc(256);
   fs->fs_rootsector = SMARTFS_ROOT_DIR_SECTOR;
 
+#ifdef CONFIG_SMARTFS_BCACHE
+  /* Cache whole logical sectors, if possible.  If not, fs_bcache is NULL
+   * and every logical sector access goes to the SMART layer.
+   */
+
+  fs->fs_bcache = bcache_attach_ops(&g_smartfs_bcops, fs,
+                                    fs->fs_llformat.availbytes);
+#endif
+
   /* We did it! */
 
   fs->fs_mounted = TRUE;
@@ -431,6 +662,10 @@ int smartfs_unmount(struct smartfs_mountpt_s *fs)
       fs->fs_workbuffer = (char *) 0xDEADBEEF;
     }
 
+#ifdef CONFIG_SMARTFS_DIRINDEX
+  smartfs_dirindex_release(fs);
+#endif
+
   /* Now removed ourselves from the linked list */
 
   if (fs == g_mounthead)
@@ -446,6 +681,14 @@ int smartfs_unmount(struct smartfs_mountpt_s *fs)
       prevfs->fs_next = fs->fs_next;
     }
 #else
+#ifdef CONFIG_SMARTFS_BCACHE
+  if (fs->fs_bcache)
+    {
+      (void)bcache_detach(fs->fs_bcache);
+      fs->fs_bcache = NULL;
+    }
+#endif
+
   if (fs->fs_blkdriver)
     {
      inode = fs->fs_blkdriver;
@@ -458,6 +701,10 @@ int smartfs_unmount(struct smartfs_mountpt_s *fs)
         }
     }
 
+#ifdef CONFIG_SMARTFS_DIRINDEX
+  smartfs_dirindex_release(fs);
+#endif
+
   /* Release the mountpoint private data */
 
   kmm_free(fs->fs_rwbuffer);
@@ -494,7 +741,6 @@ int smartfs_finddirentry(struct smartfs_mountpt_s *fs,
   uint16_t    depth = 0;
   uint16_t    dirstack[CONFIG_SMARTFS_DIRDEPTH];
   uint16_t    dirsector;
-  uint16_t    entrysize;
   uint16_t    offset;
   struct      smartfs_chain_header_s *header;
   struct      smart_read_write_s readwrite;
@@ -503,7 +749,6 @@ int smartfs_finddirentry(struct smartfs_mountpt_s *fs,
   /* Initialize directory level zero as the root sector */
 
   dirstack[0] = fs->fs_rootsector;
-  entrysize = sizeof(struct smartfs_entry_header_s) + fs->fs_llformat.namesize;
 
   /* Test if this is a request for the root directory */
 
@@ -580,218 +825,129 @@ int smartfs_finddirentry(struct smartfs_mountpt_s *fs,
         {
           /* Search for the entry in the current directory */
 
-          dirsector = dirstack[depth];
-
-          /* Read the directory */
-
-          offset = 0xFFFF;
-
-#if CONFIG_SMARTFS_ERASEDSTATE == 0xFF
-          while (dirsector != 0xFFFF)
-#else
-          while (dirsector != 0)
-#endif
+          ret = smartfs_searchdir(fs, dirstack[depth], fs->fs_workbuffer,
+                                  &dirsector, &offset);
+          if (ret == OK)
             {
-              /* Read the next directory in the chain */
-
-              readwrite.logsector = dirsector;
-              readwrite.count = fs->fs_llformat.availbytes;
-              readwrite.buffer = (uint8_t *)fs->fs_rwbuffer;
-              readwrite.offset = 0;
-              ret = FS_IOCTL(fs, BIOC_READSECT, (unsigned long) &readwrite);
-              if (ret < 0)
-                {
-                  goto errout;
-                }
-
-              /* Point to next sector in chain */
-
-              header = (struct smartfs_chain_header_s *) fs->fs_rwbuffer;
-              dirsector = SMARTFS_NEXTSECTOR(header);
-
-              /* Search for the entry */
+              /* We found it!  If this is the last segment entry, then
+               * report the entry.  If it isn't the last entry, then
+               * validate it is a directory entry and open it and continue
+               * searching.
+               */
 
-              offset = sizeof(struct smartfs_chain_header_s);
               entry = (struct smartfs_entry_header_s *) &fs->fs_rwbuffer[offset];
-              while (offset < readwrite.count)
+              if (*ptr == '\0')
                 {
-                  /* Test if this entry is valid and active */
+                  /* We are at the last segment.  Report the entry */
+
+                  /* Fill in the entry */
 
 #ifdef CONFIG_SMARTFS_ALIGNED_ACCESS
-                  if (((smartfs_rdle16(&entry->flags) & SMARTFS_DIRENT_EMPTY) ==
-                      (SMARTFS_ERASEDSTATE_16BIT & SMARTFS_DIRENT_EMPTY)) ||
-                      ((smartfs_rdle16(&entry->flags) & SMARTFS_DIRENT_ACTIVE) !=
-                      (SMARTFS_ERASEDSTATE_16BIT & SMARTFS_DIRENT_ACTIVE)))
+                  direntry->firstsector = smartfs_rdle16(&entry->firstsector);
+                  direntry->flags = smartfs_rdle16(&entry->flags);
+                  direntry->utc = smartfs_rdle32(&entry->utc);
 #else
-                  if (((entry->flags & SMARTFS_DIRENT_EMPTY) ==
-                      (SMARTFS_ERASEDSTATE_16BIT & SMARTFS_DIRENT_EMPTY)) ||
-                      ((entry->flags & SMARTFS_DIRENT_ACTIVE) !=
-                      (SMARTFS_ERASEDSTATE_16BIT & SMARTFS_DIRENT_ACTIVE)))
+                  direntry->firstsector = entry->firstsector;
+                  direntry->flags = entry->flags;
+                  direntry->utc = entry->utc;
 #endif
+                  direntry->dsector = dirsector;
+                  direntry->doffset = offset;
+                  direntry->dfirst = dirstack[depth];
+                  if (direntry->name == NULL)
                     {
-                      /* This entry isn't valid, skip it */
-
-                      offset += entrysize;
-                      entry = (struct smartfs_entry_header_s *)
-                        &fs->fs_rwbuffer[offset];
-
-                      continue;
+                      direntry->name = (char *) kmm_malloc(fs->fs_llformat.namesize+1);
                     }
 
-                  /* Test if the name matches */
+                  memset(direntry->name, 0, fs->fs_llformat.namesize + 1);
+                  strncpy(direntry->name, entry->name, fs->fs_llformat.namesize);
+                  direntry->datlen = 0;
+
+                  /* Scan the file's sectors to calculate the length and perform
+                   * a rudimentary check.
+                   */
 
-                  if (strncmp(entry->name, fs->fs_workbuffer,
-                      fs->fs_llformat.namesize) == 0)
+                  if ((direntry->flags & SMARTFS_DIRENT_TYPE) ==
+                      SMARTFS_DIRENT_TYPE_FILE)
                     {
-                      /* We found it!  If this is the last segment entry,
-                       * then report the entry.  If it isn't the last
-                       * entry, then validate it is a directory entry and
-                       * open it and continue searching.
-                       */
+                      dirsector = direntry->firstsector;
+                      header = (struct smartfs_chain_header_s *) fs->fs_rwbuffer;
+                      readwrite.count = sizeof(struct smartfs_chain_header_s);
+                      readwrite.buffer = (uint8_t *)fs->fs_rwbuffer;
+                      readwrite.offset = 0;
 
-                      if (*ptr == '\0')
+                      while (dirsector != SMARTFS_ERASEDSTATE_16BIT)
                         {
-                          /* We are at the last segment.  Report the entry */
+                          /* Read the next sector of the file */
 
-                          /* Fill in the entry */
-
-#ifdef CONFIG_SMARTFS_ALIGNED_ACCESS
-                          direntry->firstsector = smartfs_rdle16(&entry->firstsector);
-                          direntry->flags = smartfs_rdle16(&entry->flags);
-                          direntry->utc = smartfs_rdle32(&entry->utc);
-#else
-                          direntry->firstsector = entry->firstsector;
-                          direntry->flags = entry->flags;
-                          direntry->utc = entry->utc;
-#endif
-                          direntry->dsector = readwrite.logsector;
-                          direntry->doffset = offset;
-                          direntry->dfirst = dirstack[depth];
-                          if (direntry->name == NULL)
+                          readwrite.logsector = dirsector;
+                          ret = FS_IOCTL(fs, BIOC_READSECT,
+                                         (unsigned long) &readwrite);
+                          if (ret < 0)
                             {
-                              direntry->name = (char *) kmm_malloc(fs->fs_llformat.namesize+1);
+                              ferr("ERROR: Error in sector chain at %d!\n",
+                                   dirsector);
+                              break;
                             }
 
-                          memset(direntry->name, 0, fs->fs_llformat.namesize + 1);
-                          strncpy(direntry->name, entry->name, fs->fs_llformat.namesize);
-                          direntry->datlen = 0;
-
-                          /* Scan the file's sectors to calculate the length and perform
-                           * a rudimentary check.
-                           */
+                          /* Add used bytes to the total and point to next sector */
 
-#ifdef CONFIG_SMARTFS_ALIGNED_ACCESS
-                          if ((smartfs_rdle16(&entry->flags) & SMARTFS_DIRENT_TYPE) ==
-                              SMARTFS_DIRENT_TYPE_FILE)
-                            {
-                              dirsector = smartfs_rdle16(&entry->firstsector);
-#else
-                          if ((entry->flags & SMARTFS_DIRENT_TYPE) ==
-                              SMARTFS_DIRENT_TYPE_FILE)
+                          if (*((uint16_t *)header->used) != SMARTFS_ERASEDSTATE_16BIT)
                             {
-                              dirsector = entry->firstsector;
-#endif
-                              readwrite.count = sizeof(struct smartfs_chain_header_s);
-                              readwrite.buffer = (uint8_t *)fs->fs_rwbuffer;
-                              readwrite.offset = 0;
-
-                              while (dirsector != SMARTFS_ERASEDSTATE_16BIT)
-                                {
-                                  /* Read the next sector of the file */
-
-                                  readwrite.logsector = dirsector;
-                                  ret = FS_IOCTL(fs, BIOC_READSECT,
-                                                 (unsigned long) &readwrite);
-                                  if (ret < 0)
-                                    {
-                                      ferr("ERROR: Error in sector chain at %d!\n",
-                                           dirsector);
-                                      break;
-                                    }
-
-                                  /* Add used bytes to the total and point to next sector */
-
-                                  if (*((uint16_t *)header->used) != SMARTFS_ERASEDSTATE_16BIT)
-                                    {
-                                      direntry->datlen += *((uint16_t *)header->used);
-                                    }
-
-                                  dirsector = SMARTFS_NEXTSECTOR(header);
-                                }
+                              direntry->datlen += *((uint16_t *)header->used);
                             }
 
-                          *parentdirsector = dirstack[depth];
-                          *filename = segment;
-                          ret = OK;
-                          goto errout;
+                          dirsector = SMARTFS_NEXTSECTOR(header);
                         }
-                      else
-                        {
-                          /* Validate it's a directory */
-
-#ifdef CONFIG_SMARTFS_ALIGNED_ACCESS
-                          if ((smartfs_rdle16(&entry->flags) & SMARTFS_DIRENT_TYPE) !=
-                              SMARTFS_DIRENT_TYPE_DIR)
-#else
-                          if ((entry->flags & SMARTFS_DIRENT_TYPE) !=
-                              SMARTFS_DIRENT_TYPE_DIR)
-#endif
-                            {
-                                /* Not a directory!  Report the error */
-
-                                ret = -ENOTDIR;
-                                goto errout;
-                            }
-
-                          /* "Push" the directory and continue searching */
+                    }
 
-                          if (depth >= CONFIG_SMARTFS_DIRDEPTH - 1)
-                            {
-                              /* Directory depth too big */
+                  *parentdirsector = dirstack[depth];
+                  *filename = segment;
+                  ret = OK;
+                  goto errout;
+                }
 
-                              ret = -ENAMETOOLONG;
-                              goto errout;
-                            }
+              /* Validate it's a directory */
 
 #ifdef CONFIG_SMARTFS_ALIGNED_ACCESS
-                          dirstack[++depth] = smartfs_rdle16(&entry->firstsector);
+              if ((smartfs_rdle16(&entry->flags) & SMARTFS_DIRENT_TYPE) !=
+                  SMARTFS_DIRENT_TYPE_DIR)
 #else
-                          dirstack[++depth] = entry->firstsector;
+              if ((entry->flags & SMARTFS_DIRENT_TYPE) !=
+                  SMARTFS_DIRENT_TYPE_DIR)
 #endif
-                          segment = ptr + 1;
-                          break;
-                        }
-                    }
-
-                  /* Not this entry.  Skip to the next one */
+                {
+                  /* Not a directory!  Report the error */
 
-                  offset += entrysize;
-                  entry = (struct smartfs_entry_header_s *)
-                    &fs->fs_rwbuffer[offset];
+                  ret = -ENOTDIR;
+                  goto errout;
                 }
 
-              /* Test if a directory entry was found and break if it was */
+              /* "Push" the directory and continue searching */
 
-              if (offset < readwrite.count)
+              if (depth >= CONFIG_SMARTFS_DIRDEPTH - 1)
                 {
-                  break;
+                  /* Directory depth too big */
+
+                  ret = -ENAMETOOLONG;
+                  goto errout;
                 }
-            }
 
-          /* If we found a dir entry, then continue searching */
+#ifdef CONFIG_SMARTFS_ALIGNED_ACCESS
+              dirstack[++depth] = smartfs_rdle16(&entry->firstsector);
+#else
+              dirstack[++depth] = entry->firstsector;
+#endif
 
-          if (offset < readwrite.count)
-            {
               /* Update the segment pointer */
 
-              if (*ptr != '\0')
-                {
-                  ptr++;
-                }
-
-              segment = ptr;
+              segment = ptr + 1;
               continue;
             }
+          else if (ret != -ENOENT)
+            {
+              goto errout;
+            }
 
           /* Entry not found!  Report the error.  Also, if this is the last
            * segment, then report the parent directory sector.
@@ -1079,6 +1235,10 @@ int smartfs_createentry(FAR struct smartfs_mountpt_s *fs,
   memset(direntry->name, 0, fs->fs_llformat.namesize+1);
   strncpy(direntry->name, filename, fs->fs_llformat.namesize);
 
+#ifdef CONFIG_SMARTFS_DIRINDEX
+  smartfs_dirindex_insert(fs, parentdirsector, filename, psector, offset);
+#endif
+
   ret = OK;
 
 errout:
@@ -1190,6 +1350,15 @@ int smartfs_deleteentry(struct smartfs_mountpt_s *fs,
       goto errout;
     }
 
+#ifdef CONFIG_SMARTFS_DIRINDEX
+  /* Remove the entry from the directory index.  If it was a directory, its
+   * first sector has been released and may be reused by another directory.
+   */
+
+  smartfs_dirindex_remove(fs, entry->name, entry->dsector, entry->doffset);
+  smartfs_dirindex_forget(fs, entry->firstsector);
+#endif
+
   /* Test if any entries in this sector are being used */
 
   if ((entry->dsector != fs->fs_rootsector) &&
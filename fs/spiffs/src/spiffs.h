@@ -58,6 +58,7 @@ extern "C"
 #include <queue.h>
 
 #include <nuttx/semaphore.h>
+#include <nuttx/wqueue.h>
 #include <nuttx/mtd/mtd.h>
 
 /****************************************************************************
@@ -122,6 +123,7 @@ struct spiffs_sem_s
 /* This structure represents the current state of an SPIFFS volume */
 
 struct spiffs_file_s;               /* Forward reference */
+struct spiffs_ixentry_s;            /* Forward reference */
 
 struct spiffs_s
 {
@@ -146,8 +148,26 @@ struct spiffs_s
   uint32_t deleted_pages;           /* Current number of deleted pages */
 #ifdef CONFIG_SPIFFS_GCDBG
   uint32_t stats_gc_runs;
+#endif
+  uint32_t gc_steps;                /* Number of blocks reclaimed by GC */
+#ifdef CONFIG_SPIFFS_GC_BACKGROUND
+  struct work_s gcwork;             /* Background garbage collection */
+  sem_t gcdone;                     /* Posted when a stopped worker exits */
+  bool gcbusy;                      /* gcwork is queued or running */
+  bool gcstop;                      /* The volume is being unmounted */
 #endif
   uint32_t cache_size;              /* Cache size */
+#ifdef CONFIG_SPIFFS_OBJINDEX
+  FAR struct spiffs_ixentry_s *ixentries; /* Object index header locations */
+  int nindex;                       /* Number of entries in ixentries[] */
+  int maxindex;                     /* Allocated size of ixentries[] */
+  uint8_t ixstate;                  /* See SPIFFS_IXSTATE_* definitions */
+#endif
+#if CONFIG_SPIFFS_READAHEAD > 1
+  FAR uint8_t *rabuf;               /* Read-ahead buffer, READAHEAD pages */
+  int16_t rapgndx;                  /* First page in rabuf */
+  int16_t ranpages;                 /* Number of valid pages in rabuf */
+#endif
 #ifdef CONFIG_SPIFFS_CACHEDBG
   uint32_t cache_hits;              /* Number of cache hits */
   uint32_t cache_misses;            /* Number of cache misses */
@@ -423,6 +423,27 @@ ssize_t spiffs_cache_read(FAR struct spiffs_s *fs, uint8_t op, int16_t objid,
     }
   else
     {
+#if CONFIG_SPIFFS_READAHEAD > 1
+      int16_t pgndx = SPIFFS_PADDR_TO_PAGE(fs, addr);
+
+      /* Check if the page is in the read-ahead buffer.  Read-ahead data is
+       * not copied into a cache page so that streaming a file does not
+       * evict the object lookup and index pages.
+       */
+
+      if (fs->ranpages > 0 && pgndx >= fs->rapgndx &&
+          pgndx < fs->rapgndx + fs->ranpages)
+        {
+#ifdef CONFIG_SPIFFS_CACHEDBG
+          fs->cache_hits++;
+#endif
+          memcpy(dest, &fs->rabuf[SPIFFS_PAGE_TO_PADDR(fs,
+                                  pgndx - fs->rapgndx) +
+                                  SPIFFS_PADDR_TO_PAGE_OFFSET(fs, addr)],
+                 len);
+        }
+      else
+#endif
       /* Check for second layer lookup */
 
       if ((op & SPIFFS_OP_TYPE_MASK) == SPIFFS_OP_T_OBJ_LU2)
@@ -675,6 +696,96 @@ FAR struct spiffs_cache_page_s *
   return cp;
 }
 
+#if CONFIG_SPIFFS_READAHEAD > 1
+/****************************************************************************
+ * Name: spiffs_cache_prefetch
+ *
+ * Description:
+ *   Read a run of physically consecutive pages into the read-ahead buffer
+ *   with a single MTD read.
+ *
+ * Input Parameters:
+ *   fs     - A reference to the SPIFFS volume object instance
+ *   pgndx  - The first page to read
+ *   npages - The number of pages to read
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void spiffs_cache_prefetch(FAR struct spiffs_s *fs, int16_t pgndx,
+                           int16_t npages)
+{
+  ssize_t ret;
+
+  if (fs->rabuf == NULL || npages < 2)
+    {
+      return;
+    }
+
+  /* Nothing needs to be read if the first page is already available */
+
+  if ((fs->ranpages > 0 && pgndx >= fs->rapgndx &&
+       pgndx < fs->rapgndx + fs->ranpages) ||
+      spiffs_cache_page_get(fs, pgndx) != NULL)
+    {
+      return;
+    }
+
+  if (npages > CONFIG_SPIFFS_READAHEAD)
+    {
+      npages = CONFIG_SPIFFS_READAHEAD;
+    }
+
+  spiffs_cacheinfo("Read ahead pgndx=%04x npages=%d\n", pgndx, npages);
+
+  fs->ranpages = 0;
+  ret = spiffs_mtd_read(fs, SPIFFS_PAGE_TO_PADDR(fs, pgndx),
+                        SPIFFS_PAGE_TO_PADDR(fs, npages), fs->rabuf);
+  if (ret >= 0)
+    {
+      fs->rapgndx  = pgndx;
+      fs->ranpages = npages;
+    }
+}
+
+/****************************************************************************
+ * Name: spiffs_cache_rainvalidate
+ *
+ * Description:
+ *   Discard the read-ahead buffer if it overlaps a region of FLASH that
+ *   is being written or erased.
+ *
+ * Input Parameters:
+ *   fs   - A reference to the SPIFFS volume object instance
+ *   addr - The first address of the region
+ *   len  - The size of the region in bytes
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void spiffs_cache_rainvalidate(FAR struct spiffs_s *fs, off_t addr,
+                               size_t len)
+{
+  off_t rastart;
+  off_t raend;
+
+  if (fs->ranpages > 0)
+    {
+      rastart = SPIFFS_PAGE_TO_PADDR(fs, fs->rapgndx);
+      raend   = rastart + SPIFFS_PAGE_TO_PADDR(fs, fs->ranpages);
+
+      if (addr < raend && addr + (off_t)len > rastart)
+        {
+          fs->ranpages = 0;
+        }
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: spiffs_cache_page_release
  *
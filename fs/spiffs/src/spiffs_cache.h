@@ -74,6 +74,13 @@ extern "C"
   ((FAR uint8_t *)(&((c)->cpages[(cpndx) * SPIFFS_CACHE_PAGE_SIZE(fs)])) + \
   sizeof(struct spiffs_cache_page_s))
 
+/* Read-ahead */
+
+#if CONFIG_SPIFFS_READAHEAD < 2
+#  define spiffs_cache_prefetch(fs,p,n)
+#  define spiffs_cache_rainvalidate(fs,a,l)
+#endif
+
 /* Debug */
 
 #ifdef CONFIG_SPIFFS_CACHEDBG
@@ -256,6 +263,50 @@ FAR struct spiffs_cache_page_s *
   spiffs_cache_page_allocate_byobjid(FAR struct spiffs_s *fs,
                                      FAR struct spiffs_file_s *fobj);
 
+#if CONFIG_SPIFFS_READAHEAD > 1
+/****************************************************************************
+ * Name: spiffs_cache_prefetch
+ *
+ * Description:
+ *   Read a run of physically consecutive pages into the read-ahead buffer
+ *   with a single MTD read.  Nothing is done if the first page is already
+ *   cached or in the read-ahead buffer.  spiffs_cache_read() then returns
+ *   data from the read-ahead buffer without using a cache page.
+ *
+ * Input Parameters:
+ *   fs     - A reference to the SPIFFS volume object instance
+ *   pgndx  - The first page to read
+ *   npages - The number of pages to read
+ *
+ * Returned Value:
+ *   None.  Read failures are reported when the data is read again.
+ *
+ ****************************************************************************/
+
+void spiffs_cache_prefetch(FAR struct spiffs_s *fs, int16_t pgndx,
+                           int16_t npages);
+
+/****************************************************************************
+ * Name: spiffs_cache_rainvalidate
+ *
+ * Description:
+ *   Discard the read-ahead buffer if it overlaps a region of FLASH that
+ *   is being written or erased.
+ *
+ * Input Parameters:
+ *   fs   - A reference to the SPIFFS volume object instance
+ *   addr - The first address of the region
+ *   len  - The size of the region in bytes
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void spiffs_cache_rainvalidate(FAR struct spiffs_s *fs, off_t addr,
+                               size_t len);
+#endif
+
 /****************************************************************************
  * Name: spiffs_cache_page_release
  *
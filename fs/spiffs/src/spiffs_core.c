@@ -54,6 +54,7 @@
 #include "spiffs_gc.h"
 #include "spiffs_cache.h"
 #include "spiffs_core.h"
+#include "spiffs_index.h"
 
 /****************************************************************************
  * Private Types
@@ -796,16 +797,18 @@ int spiffs_erase_block(FAR struct spiffs_s *fs, int16_t blkndx)
 int spiffs_objlu_scan(FAR struct spiffs_s *fs)
 {
   int16_t blkndx;
-  int16_t erase_count_final;
-  int16_t erase_count_min;
-  int16_t erase_count_max;
+  uint16_t erase_count_final;
+  uint16_t erase_count_min;
+  uint16_t erase_count_max;
   int entry;
   int ret;
 
-  /* Find out erase count. */
+  /* Find out erase count.  The erase counts are compared as unsigned
+   * values:  SPIFFS_OBJID_FREE is negative as an int16_t.
+   */
 
   blkndx          = 0;
-  erase_count_min = SPIFFS_OBJID_FREE;
+  erase_count_min = (uint16_t)SPIFFS_OBJID_FREE;
   erase_count_max = 0;
 
   while (blkndx < SPIFFS_GEO_BLOCK_COUNT(fs))
@@ -823,20 +826,22 @@ int spiffs_objlu_scan(FAR struct spiffs_s *fs)
 
       if (erase_count != SPIFFS_OBJID_FREE)
         {
-          erase_count_min = MIN(erase_count_min, erase_count);
-          erase_count_max = MAX(erase_count_max, erase_count);
+          erase_count_min = MIN(erase_count_min, (uint16_t)erase_count);
+          erase_count_max = MAX(erase_count_max, (uint16_t)erase_count);
         }
 
       blkndx++;
     }
 
-  if (erase_count_min == 0 && erase_count_max == SPIFFS_OBJID_FREE)
+  if (erase_count_min == 0 &&
+      erase_count_max == (uint16_t)SPIFFS_OBJID_FREE)
     {
       /* Clean system, set counter to zero */
 
       erase_count_final = 0;
     }
-  else if (erase_count_max - erase_count_min > (SPIFFS_OBJID_FREE / 2))
+  else if (erase_count_max - erase_count_min >
+           (uint16_t)SPIFFS_OBJID_FREE / 2)
     {
       /* Wrap, take min */
 
@@ -969,6 +974,27 @@ int spiffs_objlu_find_id_and_span(FAR struct spiffs_s *fs, int16_t objid,
   int entry;
   int ret;
 
+#ifdef CONFIG_SPIFFS_OBJINDEX
+  /* Object index headers can be found without searching the FLASH */
+
+  if (spndx == 0 && (objid & SPIFFS_OBJID_NDXFLAG) != 0 &&
+      exclusion_pgndx == 0)
+    {
+      int16_t tmp;
+
+      ret = spiffs_index_findid(fs, objid, &tmp);
+      if (ret != -EAGAIN)
+        {
+          if (ret >= 0 && pgndx != NULL)
+            {
+              *pgndx = tmp;
+            }
+
+          return ret;
+        }
+    }
+#endif
+
   ret = spiffs_foreach_objlu(fs, fs->lu_blkndx, fs->lu_entry,
                              SPIFFS_VIS_CHECK_ID, objid,
                              spiffs_objlu_find_id_and_span_callback,
@@ -1307,9 +1333,10 @@ int spiffs_page_delete(FAR struct spiffs_s *fs, int16_t pgndx)
   if (ret < 0)
     {
       ferr("ERROR: spiffs_cache_write() failed: %d\n", ret);
+      return ret;
     }
 
-  return ret;
+  return OK;
 }
 
 /****************************************************************************
@@ -1526,6 +1553,13 @@ void spiffs_fobj_event(FAR struct spiffs_s *fs,
   finfo("Event=%s objid=%04x spndx=%04x npgndx=%04x nsz=%d\n",
         evname[MIN(ev, 5)], objid_raw, spndx, new_pgndx, new_size);
 
+  /* Keep the object index of the volume up to date */
+
+  if (spndx == 0)
+    {
+      spiffs_index_event(fs, objndx, ev, objid, new_pgndx);
+    }
+
   /* Update index caches in all file descriptors */
 
   for (fobj  = (FAR struct spiffs_file_s *)dq_peek(&fs->objq);
@@ -2676,6 +2710,16 @@ int spiffs_find_objhdr_pgndx(FAR struct spiffs_s *fs,
   int entry;
   int ret;
 
+#ifdef CONFIG_SPIFFS_OBJINDEX
+  /* Only the headers of objects with the same name hash need to be read */
+
+  ret = spiffs_index_findname(fs, name, pgndx != NULL ? pgndx : &blkndx);
+  if (ret != -EAGAIN)
+    {
+      return ret;
+    }
+#endif
+
   ret = spiffs_foreach_objlu(fs, fs->lu_blkndx, fs->lu_entry,
                              0, 0, spiffs_find_objhdr_pgndx_callback,
                              name, 0, &blkndx, &entry);
@@ -3135,7 +3179,7 @@ int spiffs_fobj_truncate(FAR struct spiffs_s *fs,
                                               objndx_pgndx, fs->work,
                                               0, SPIFFS_UNDEFINED_LEN,
                                               &new_objhdr_pgndx);
-
+              if (ret < 0)
                 {
                   ferr("ERROR: spiffs_fobj_update_ndxhdr() failed: %d\n",
                        ret);
@@ -3231,8 +3275,23 @@ ssize_t spiffs_object_read(FAR struct spiffs_s *fs,
   int16_t data_spndx;
   int16_t cur_objndx_spndx;
   int16_t prev_objndx_spndx;
+#if CONFIG_SPIFFS_READAHEAD > 1
+  FAR int16_t *entries;
+  bool sequential;
+  int nentries;
+  int entndx;
+  int npages;
+#endif
   int ret = OK;
 
+#if CONFIG_SPIFFS_READAHEAD > 1
+  /* Reads that continue where the last read stopped will be followed by
+   * more reads.
+   */
+
+  sequential        = (offset == fobj->offset);
+#endif
+
   objhdr            = (FAR struct spiffs_pgobj_ndxheader_s *)fs->work;
   objndx            = (FAR struct spiffs_page_objndx_s *)fs->work;
 
@@ -3348,6 +3407,42 @@ ssize_t spiffs_object_read(FAR struct spiffs_s *fs,
           break;
         }
 
+#if CONFIG_SPIFFS_READAHEAD > 1
+      /* Count the following data pages of the file that are in the same
+       * block and directly follow this one, and read them all at once.
+       */
+
+      if (sequential || cur_offset + len_to_read < offset + len)
+        {
+          if (cur_objndx_spndx == 0)
+            {
+              entries  = (FAR int16_t *)((FAR uint8_t *)objhdr +
+                           sizeof(struct spiffs_pgobj_ndxheader_s));
+              entndx   = data_spndx;
+              nentries = SPIFFS_OBJHDR_NDXLEN(fs);
+            }
+          else
+            {
+              entries  = (FAR int16_t *)((FAR uint8_t *)objndx +
+                           sizeof(struct spiffs_page_objndx_s));
+              entndx   = SPIFFS_OBJNDX_ENTRY(fs, data_spndx);
+              nentries = SPIFFS_OBJNDX_LEN(fs);
+            }
+
+          for (npages = 1;
+               npages < CONFIG_SPIFFS_READAHEAD &&
+               entndx + npages < nentries &&
+               (data_spndx + npages) * SPIFFS_DATA_PAGE_SIZE(fs) <
+               fobj->size &&
+               entries[entndx + npages] == data_pgndx + npages &&
+               SPIFFS_BLOCK_FOR_PAGE(fs, data_pgndx + npages) ==
+               SPIFFS_BLOCK_FOR_PAGE(fs, data_pgndx);
+               npages++);
+
+          spiffs_cache_prefetch(fs, data_pgndx, npages);
+        }
+#endif
+
       ret = spiffs_page_data_check(fs, fobj, data_pgndx, data_spndx);
       if (ret < 0)
         {
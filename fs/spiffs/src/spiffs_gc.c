@@ -114,6 +114,10 @@ static int spiffs_gc_erase_block(FAR struct spiffs_s *fs, int16_t blkndx)
     {
       ferr("ERROR: spiffs_erase_block() blkndx=%d failed: %d\n", blkndx, ret);
     }
+  else
+    {
+      fs->gc_steps++;
+    }
 
   /* Then remove the pages from the cache. */
 
@@ -943,6 +947,52 @@ static int spiffs_gc_clean(FAR struct spiffs_s *fs, int16_t blkndx)
   return ret;
 }
 
+/****************************************************************************
+ * Name: spiffs_gc_reclaim
+ *
+ * Description:
+ *   Move the pages that are still in use out of a block and erase it.
+ *
+ * Input Parameters:
+ *   fs     - A reference to the SPIFFS volume object instance
+ *   blkndx - The block index to reclaim
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; A negated errno value is returned on
+ *   any failure.
+ *
+ ****************************************************************************/
+
+static int spiffs_gc_reclaim(FAR struct spiffs_s *fs, int16_t blkndx)
+{
+  int ret;
+
+  ret = spiffs_gc_clean(fs, blkndx);
+
+  spiffs_gcinfo("Cleaning block %d, result=%d\n", blkndx, ret);
+
+  if (ret < 0)
+    {
+      ferr("ERROR: spiffs_gc_clean() failed: %d\n", ret);
+      return ret;
+    }
+
+  ret = spiffs_gc_epage_stats(fs, blkndx);
+  if (ret < 0)
+    {
+      ferr("ERROR: spiffs_gc_epage_stats() failed: %d\n", ret);
+      return ret;
+    }
+
+  ret = spiffs_gc_erase_block(fs, blkndx);
+  if (ret < 0)
+    {
+      ferr("ERROR: spiffs_gc_erase_block() failed: %d\n", ret);
+    }
+
+  return ret;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -1184,27 +1234,9 @@ int spiffs_gc_check(FAR struct spiffs_s *fs, off_t len)
 #endif
       cand = cands[0];
 
-      ret = spiffs_gc_clean(fs, cand);
-
-      spiffs_gcinfo("Cleaning block %d, result=%d\n", cand, ret);
-
-      if (ret < 0)
-        {
-          ferr("ERROR: spiffs_gc_clean() failed: %d\n", ret);
-          return ret;
-        }
-
-      ret = spiffs_gc_epage_stats(fs, cand);
-      if (ret < 0)
-        {
-          ferr("ERROR: spiffs_gc_epage_stats() failed: %d\n", ret);
-          return ret;
-        }
-
-      ret = spiffs_gc_erase_block(fs, cand);
+      ret = spiffs_gc_reclaim(fs, cand);
       if (ret < 0)
         {
-          ferr("ERROR: spiffs_gc_erase_block() failed: %d\n", ret);
           return ret;
         }
 
@@ -1243,3 +1275,65 @@ int spiffs_gc_check(FAR struct spiffs_s *fs, off_t len)
 
   return ret;
 }
+
+/****************************************************************************
+ * Name: spiffs_gc_step
+ *
+ * Description:
+ *   Perform one bounded step of garbage collection:  Erase one block that
+ *   holds only deleted pages or, if there is none, move the pages in use
+ *   out of the best candidate block and erase it.  At most one block is
+ *   erased, so the time taken is bounded by the time to relocate one
+ *   block.  This is used for background garbage collection.
+ *
+ * Input Parameters:
+ *   fs - A reference to the SPIFFS volume object instance
+ *
+ * Returned Value:
+ *   Zero (OK) is returned if a block was reclaimed; A negated errno value
+ *   is returned on any failure.  -ENODATA is returned if there was nothing
+ *   to collect.
+ *
+ ****************************************************************************/
+
+int spiffs_gc_step(FAR struct spiffs_s *fs)
+{
+  FAR int16_t *cands;
+  int32_t free_pages;
+  int count;
+  int ret;
+
+  /* Blocks that hold only deleted pages can be erased without moving
+   * anything.
+   */
+
+  ret = spiffs_gc_quick(fs, 0);
+  if (ret != -ENODATA)
+    {
+      return ret;
+    }
+
+  if (fs->deleted_pages == 0)
+    {
+      return -ENODATA;
+    }
+
+  free_pages = (SPIFFS_GEO_PAGES_PER_BLOCK(fs) -
+                SPIFFS_OBJ_LOOKUP_PAGES(fs)) * (SPIFFS_GEO_BLOCK_COUNT(fs) - 2) -
+                fs->alloc_pages - fs->deleted_pages;
+
+  ret = spiffs_gc_find_candidate(fs, &cands, &count, free_pages <= 0);
+  if (ret < 0)
+    {
+      ferr("ERROR: spiffs_gc_find_candidate() failed: %d\n", ret);
+      return ret;
+    }
+
+  if (count == 0)
+    {
+      spiffs_gcinfo("No candidates\n");
+      return -ENODATA;
+    }
+
+  return spiffs_gc_reclaim(fs, cands[0]);
+}
@@ -126,6 +126,26 @@ int spiffs_gc_quick(FAR struct spiffs_s *fs, uint16_t max_free_pages);
 
 int spiffs_gc_check(FAR struct spiffs_s *fs, off_t len);
 
+/****************************************************************************
+ * Name: spiffs_gc_step
+ *
+ * Description:
+ *   Perform one bounded step of garbage collection:  Erase one block that
+ *   holds only deleted pages or, if there is none, move the pages in use
+ *   out of the best candidate block and erase it.
+ *
+ * Input Parameters:
+ *   fs - A reference to the SPIFFS volume object instance
+ *
+ * Returned Value:
+ *   Zero (OK) is returned if a block was reclaimed; A negated errno value
+ *   is returned on any failure.  -ENODATA is returned if there was nothing
+ *   to collect.
+ *
+ ****************************************************************************/
+
+int spiffs_gc_step(FAR struct spiffs_s *fs);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,550 @@
+/****************************************************************************
+ * fs/spiffs/src/spiffs_index.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/kmalloc.h>
+
+#include "spiffs.h"
+#include "spiffs_core.h"
+#include "spiffs_cache.h"
+#include "spiffs_index.h"
+
+#ifdef CONFIG_SPIFFS_OBJINDEX
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The index grows by this many entries at a time */
+
+#define SPIFFS_IXINCR 16
+
+/* The page header flags of a valid object index header */
+
+#define SPIFFS_IXFLAGS_MASK \
+  (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_NDXDELE)
+#define SPIFFS_IXFLAGS_VALID \
+  (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_NDXDELE)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: spiffs_index_hash
+ *
+ * Description:
+ *   Return the 32-bit FNV-1a hash of an object name.
+ *
+ ****************************************************************************/
+
+static uint32_t spiffs_index_hash(FAR const uint8_t *name)
+{
+  uint32_t hash = 2166136261u;
+  int i;
+
+  for (i = 0; i < CONFIG_SPIFFS_NAME_MAX && name[i] != '\0'; i++)
+    {
+      hash ^= name[i];
+      hash *= 16777619u;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name: spiffs_index_lower
+ *
+ * Description:
+ *   Return the position of the first entry with an object ID that is not
+ *   less than objid.
+ *
+ ****************************************************************************/
+
+static int spiffs_index_lower(FAR struct spiffs_s *fs, int16_t objid)
+{
+  int lo = 0;
+  int hi = fs->nindex;
+
+  while (lo < hi)
+    {
+      int mid = (lo + hi) >> 1;
+
+      if (fs->ixentries[mid].objid < objid)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  return lo;
+}
+
+/****************************************************************************
+ * Name: spiffs_index_set
+ *
+ * Description:
+ *   Add an object to the index or update its entry.  The index is disabled
+ *   if it cannot be grown.
+ *
+ ****************************************************************************/
+
+static void spiffs_index_set(FAR struct spiffs_s *fs, int16_t objid,
+                             int16_t pgndx, uint32_t hash)
+{
+  FAR struct spiffs_ixentry_s *entry;
+  int ndx;
+
+  ndx = spiffs_index_lower(fs, objid);
+  if (ndx >= fs->nindex || fs->ixentries[ndx].objid != objid)
+    {
+      if (fs->nindex >= fs->maxindex)
+        {
+          FAR struct spiffs_ixentry_s *newindex;
+
+          newindex = (FAR struct spiffs_ixentry_s *)
+            kmm_realloc(fs->ixentries, (fs->maxindex + SPIFFS_IXINCR) *
+                        sizeof(struct spiffs_ixentry_s));
+          if (newindex == NULL)
+            {
+              fwarn("WARNING: Object index disabled\n");
+              fs->ixstate = SPIFFS_IXSTATE_DISABLED;
+              return;
+            }
+
+          fs->ixentries = newindex;
+          fs->maxindex += SPIFFS_IXINCR;
+        }
+
+      memmove(&fs->ixentries[ndx + 1], &fs->ixentries[ndx],
+              (fs->nindex - ndx) * sizeof(struct spiffs_ixentry_s));
+      fs->nindex++;
+    }
+
+  entry        = &fs->ixentries[ndx];
+  entry->objid = objid;
+  entry->pgndx = pgndx;
+  entry->hash  = hash;
+}
+
+/****************************************************************************
+ * Name: spiffs_index_remove
+ *
+ * Description:
+ *   Remove an object from the index.
+ *
+ ****************************************************************************/
+
+static void spiffs_index_remove(FAR struct spiffs_s *fs, int16_t objid)
+{
+  int ndx;
+
+  ndx = spiffs_index_lower(fs, objid);
+  if (ndx < fs->nindex && fs->ixentries[ndx].objid == objid)
+    {
+      fs->nindex--;
+      memmove(&fs->ixentries[ndx], &fs->ixentries[ndx + 1],
+              (fs->nindex - ndx) * sizeof(struct spiffs_ixentry_s));
+    }
+}
+
+/****************************************************************************
+ * Name: spiffs_index_readhdr
+ *
+ * Description:
+ *   Read an object index header page and verify that it is a valid header
+ *   of the object.
+ *
+ ****************************************************************************/
+
+static int spiffs_index_readhdr(FAR struct spiffs_s *fs, int16_t objid,
+                                int16_t pgndx,
+                                FAR struct spiffs_pgobj_ndxheader_s *objhdr)
+{
+  int ret;
+
+  ret = spiffs_cache_read(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ, 0,
+                          SPIFFS_PAGE_TO_PADDR(fs, pgndx),
+                          sizeof(struct spiffs_pgobj_ndxheader_s),
+                          (FAR uint8_t *)objhdr);
+  if (ret < 0)
+    {
+      ferr("ERROR: spiffs_cache_read() failed: %d\n", ret);
+      return ret;
+    }
+
+  if (objhdr->phdr.objid != (objid | SPIFFS_OBJID_NDXFLAG) ||
+      objhdr->phdr.spndx != 0 ||
+      (objhdr->phdr.flags & SPIFFS_IXFLAGS_MASK) != SPIFFS_IXFLAGS_VALID)
+    {
+      return -ESTALE;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: spiffs_index_build_callback
+ *
+ * Description:
+ *   Add the object index header at this object lookup entry to the index.
+ *
+ ****************************************************************************/
+
+static int spiffs_index_build_callback(FAR struct spiffs_s *fs,
+                                       int16_t objid, int16_t blkndx,
+                                       int entry,
+                                       FAR const void *user_const,
+                                       FAR void *user_var)
+{
+  struct spiffs_pgobj_ndxheader_s objhdr;
+  int16_t pgndx;
+  int ret;
+
+  if (objid == SPIFFS_OBJID_FREE || objid == SPIFFS_OBJID_DELETED ||
+      (objid & SPIFFS_OBJID_NDXFLAG) == 0)
+    {
+      return SPIFFS_VIS_COUNTINUE;
+    }
+
+  objid &= ~SPIFFS_OBJID_NDXFLAG;
+  pgndx  = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PGNDX(fs, blkndx, entry);
+
+  ret = spiffs_index_readhdr(fs, objid, pgndx, &objhdr);
+  if (ret == OK)
+    {
+      spiffs_index_set(fs, objid, pgndx, spiffs_index_hash(objhdr.name));
+      if (fs->ixstate == SPIFFS_IXSTATE_DISABLED)
+        {
+          return -ENOMEM;
+        }
+    }
+  else if (ret != -ESTALE)
+    {
+      return ret;
+    }
+
+  return SPIFFS_VIS_COUNTINUE;
+}
+
+/****************************************************************************
+ * Name: spiffs_index_build
+ *
+ * Description:
+ *   Rebuild the index from the object lookup pages, if necessary.
+ *
+ * Returned Value:
+ *   Zero (OK) is returned if the index can be used; -EAGAIN otherwise.
+ *
+ ****************************************************************************/
+
+static int spiffs_index_build(FAR struct spiffs_s *fs)
+{
+  int16_t blkndx;
+  int entry;
+  int ret;
+
+  if (fs->ixstate == SPIFFS_IXSTATE_INVALID)
+    {
+      fs->nindex  = 0;
+      fs->ixstate = SPIFFS_IXSTATE_VALID;
+
+      ret = spiffs_foreach_objlu(fs, 0, 0, 0, 0,
+                                 spiffs_index_build_callback, NULL, NULL,
+                                 &blkndx, &entry);
+      if (ret != SPIFFS_VIS_END && fs->ixstate == SPIFFS_IXSTATE_VALID)
+        {
+          ferr("ERROR: spiffs_foreach_objlu() failed: %d\n", ret);
+          fs->ixstate = SPIFFS_IXSTATE_INVALID;
+        }
+    }
+
+  return fs->ixstate == SPIFFS_IXSTATE_VALID ? OK : -EAGAIN;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: spiffs_index_invalidate
+ *
+ * Description:
+ *   Discard the contents of the object index.  It will be rebuilt from the
+ *   object lookup pages when it is next used.
+ *
+ * Input Parameters:
+ *   fs - A reference to the SPIFFS volume object instance
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void spiffs_index_invalidate(FAR struct spiffs_s *fs)
+{
+  fs->nindex  = 0;
+  fs->ixstate = SPIFFS_IXSTATE_INVALID;
+}
+
+/****************************************************************************
+ * Name: spiffs_index_event
+ *
+ * Description:
+ *   Update the object index when an object index header page is created,
+ *   updated, moved or deleted.
+ *
+ * Input Parameters:
+ *   fs     - A reference to the SPIFFS volume object instance
+ *   objndx - The new content of the object index header page, if known
+ *   ev     - The event, one of SPIFFS_EV_*
+ *   objid  - The object ID
+ *   pgndx  - The new page of the object index header
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void spiffs_index_event(FAR struct spiffs_s *fs,
+                        FAR struct spiffs_page_objndx_s *objndx, int ev,
+                        int16_t objid, int16_t pgndx)
+{
+  FAR struct spiffs_pgobj_ndxheader_s *objhdr;
+  int ndx;
+
+  if (fs->ixstate != SPIFFS_IXSTATE_VALID)
+    {
+      return;
+    }
+
+  objid &= ~SPIFFS_OBJID_NDXFLAG;
+
+  switch (ev)
+    {
+      case SPIFFS_EV_NDXDEL:
+        spiffs_index_remove(fs, objid);
+        break;
+
+      case SPIFFS_EV_NDXMOV:
+
+        /* Only the page header is provided.  The name is unchanged. */
+
+        ndx = spiffs_index_lower(fs, objid);
+        if (ndx < fs->nindex && fs->ixentries[ndx].objid == objid)
+          {
+            fs->ixentries[ndx].pgndx = pgndx;
+          }
+        else
+          {
+            spiffs_index_invalidate(fs);
+          }
+        break;
+
+      default:
+
+        /* The complete object index header is provided */
+
+        if (objndx == NULL)
+          {
+            spiffs_index_invalidate(fs);
+          }
+        else
+          {
+            objhdr = (FAR struct spiffs_pgobj_ndxheader_s *)objndx;
+            spiffs_index_set(fs, objid, pgndx,
+                             spiffs_index_hash(objhdr->name));
+          }
+        break;
+    }
+}
+
+/****************************************************************************
+ * Name: spiffs_index_findname
+ *
+ * Description:
+ *   Find the object index header page of the object with this name.
+ *
+ * Input Parameters:
+ *   fs    - A reference to the SPIFFS volume object instance
+ *   name  - The name of the object
+ *   pgndx - The location to return the page index
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; -ENOENT is returned if there is no
+ *   such object.  -EAGAIN is returned if the index cannot be used.
+ *
+ ****************************************************************************/
+
+int spiffs_index_findname(FAR struct spiffs_s *fs, FAR const uint8_t *name,
+                          FAR int16_t *pgndx)
+{
+  struct spiffs_pgobj_ndxheader_s objhdr;
+  uint32_t hash;
+  int ret;
+  int i;
+
+  ret = spiffs_index_build(fs);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  hash = spiffs_index_hash(name);
+  for (i = 0; i < fs->nindex; i++)
+    {
+      if (fs->ixentries[i].hash != hash)
+        {
+          continue;
+        }
+
+      ret = spiffs_index_readhdr(fs, fs->ixentries[i].objid,
+                                 fs->ixentries[i].pgndx, &objhdr);
+      if (ret == -ESTALE)
+        {
+          /* The index is out of date.  Search the FLASH instead. */
+
+          spiffs_index_invalidate(fs);
+          return -EAGAIN;
+        }
+      else if (ret < 0)
+        {
+          return ret;
+        }
+
+      if (strncmp((FAR const char *)name, (FAR const char *)objhdr.name,
+                  CONFIG_SPIFFS_NAME_MAX) == 0)
+        {
+          *pgndx = fs->ixentries[i].pgndx;
+          return OK;
+        }
+    }
+
+  return -ENOENT;
+}
+
+/****************************************************************************
+ * Name: spiffs_index_findid
+ *
+ * Description:
+ *   Find the object index header page of an object.
+ *
+ * Input Parameters:
+ *   fs    - A reference to the SPIFFS volume object instance
+ *   objid - The object ID
+ *   pgndx - The location to return the page index
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; -ENOENT is returned if there is no
+ *   such object.  -EAGAIN is returned if the index cannot be used.
+ *
+ ****************************************************************************/
+
+int spiffs_index_findid(FAR struct spiffs_s *fs, int16_t objid,
+                        FAR int16_t *pgndx)
+{
+  struct spiffs_pgobj_ndxheader_s objhdr;
+  int ndx;
+  int ret;
+
+  ret = spiffs_index_build(fs);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  objid &= ~SPIFFS_OBJID_NDXFLAG;
+  ndx    = spiffs_index_lower(fs, objid);
+  if (ndx >= fs->nindex || fs->ixentries[ndx].objid != objid)
+    {
+      return -ENOENT;
+    }
+
+  ret = spiffs_index_readhdr(fs, objid, fs->ixentries[ndx].pgndx, &objhdr);
+  if (ret == -ESTALE)
+    {
+      spiffs_index_invalidate(fs);
+      return -EAGAIN;
+    }
+  else if (ret < 0)
+    {
+      return ret;
+    }
+
+  *pgndx = fs->ixentries[ndx].pgndx;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: spiffs_index_release
+ *
+ * Description:
+ *   Free the memory used by the object index.
+ *
+ * Input Parameters:
+ *   fs - A reference to the SPIFFS volume object instance
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void spiffs_index_release(FAR struct spiffs_s *fs)
+{
+  if (fs->ixentries != NULL)
+    {
+      kmm_free(fs->ixentries);
+    }
+
+  fs->ixentries = NULL;
+  fs->nindex    = 0;
+  fs->maxindex  = 0;
+  fs->ixstate  = SPIFFS_IXSTATE_INVALID;
+}
+
+#endif /* CONFIG_SPIFFS_OBJINDEX */
@@ -0,0 +1,195 @@
+/****************************************************************************
+ * fs/spiffs/src/spiffs_index.h
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __FS_SPIFFS_SRC_SPIFFS_INDEX_H
+#define __FS_SPIFFS_SRC_SPIFFS_INDEX_H
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Values of ixstate in struct spiffs_s */
+
+#define SPIFFS_IXSTATE_INVALID   0  /* Must be rebuilt before it is used */
+#define SPIFFS_IXSTATE_VALID     1  /* Describes all object index headers */
+#define SPIFFS_IXSTATE_DISABLED  2  /* Could not be allocated */
+
+#ifndef CONFIG_SPIFFS_OBJINDEX
+#  define spiffs_index_invalidate(fs)
+#  define spiffs_index_event(fs,o,e,i,p)
+#  define spiffs_index_release(fs)
+#endif
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* One entry in the object index.  The entries are sorted by object ID. */
+
+struct spiffs_ixentry_s
+{
+  int16_t  objid;            /* Object ID (without SPIFFS_OBJID_NDXFLAG) */
+  int16_t  pgndx;            /* Page of the object index header */
+  uint32_t hash;             /* Hash of the object name */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_SPIFFS_OBJINDEX
+struct spiffs_s;                 /* Forward reference */
+struct spiffs_page_objndx_s;     /* Forward reference */
+
+/****************************************************************************
+ * Name: spiffs_index_invalidate
+ *
+ * Description:
+ *   Discard the contents of the object index.  It will be rebuilt from the
+ *   object lookup pages when it is next used.  This must be called when
+ *   object index headers are modified without spiffs_fobj_event(), for
+ *   example by the consistency check or by re-formatting.
+ *
+ * Input Parameters:
+ *   fs - A reference to the SPIFFS volume object instance
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void spiffs_index_invalidate(FAR struct spiffs_s *fs);
+
+/****************************************************************************
+ * Name: spiffs_index_event
+ *
+ * Description:
+ *   Update the object index when an object index header page is created,
+ *   updated, moved or deleted.  Called from spiffs_fobj_event().
+ *
+ * Input Parameters:
+ *   fs     - A reference to the SPIFFS volume object instance
+ *   objndx - The new content of the object index header page, if known
+ *   ev     - The event, one of SPIFFS_EV_*
+ *   objid  - The object ID
+ *   pgndx  - The new page of the object index header
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void spiffs_index_event(FAR struct spiffs_s *fs,
+                        FAR struct spiffs_page_objndx_s *objndx, int ev,
+                        int16_t objid, int16_t pgndx);
+
+/****************************************************************************
+ * Name: spiffs_index_findname
+ *
+ * Description:
+ *   Find the object index header page of the object with this name.  Only
+ *   the headers of objects whose name has the same hash are read.
+ *
+ * Input Parameters:
+ *   fs    - A reference to the SPIFFS volume object instance
+ *   name  - The name of the object
+ *   pgndx - The location to return the page index
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; -ENOENT is returned if there is no
+ *   such object.  -EAGAIN is returned if the index cannot be used and the
+ *   object lookup pages must be searched instead.
+ *
+ ****************************************************************************/
+
+int spiffs_index_findname(FAR struct spiffs_s *fs, FAR const uint8_t *name,
+                          FAR int16_t *pgndx);
+
+/****************************************************************************
+ * Name: spiffs_index_findid
+ *
+ * Description:
+ *   Find the object index header page of an object.
+ *
+ * Input Parameters:
+ *   fs    - A reference to the SPIFFS volume object instance
+ *   objid - The object ID
+ *   pgndx - The location to return the page index
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; -ENOENT is returned if there is no
+ *   such object.  -EAGAIN is returned if the index cannot be used and the
+ *   object lookup pages must be searched instead.
+ *
+ ****************************************************************************/
+
+int spiffs_index_findid(FAR struct spiffs_s *fs, int16_t objid,
+                        FAR int16_t *pgndx);
+
+/****************************************************************************
+ * Name: spiffs_index_release
+ *
+ * Description:
+ *   Free the memory used by the object index.
+ *
+ * Input Parameters:
+ *   fs - A reference to the SPIFFS volume object instance
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void spiffs_index_release(FAR struct spiffs_s *fs);
+#endif /* CONFIG_SPIFFS_OBJINDEX */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* __FS_SPIFFS_SRC_SPIFFS_INDEX_H */
@@ -50,6 +50,8 @@
 
 #include "spiffs.h"
 #include "spiffs_mtd.h"
+#include "spiffs_core.h"
+#include "spiffs_cache.h"
 
 /****************************************************************************
  * Private Functions
@@ -106,6 +108,7 @@ ssize_t spiffs_mtd_write(FAR struct spiffs_s *fs, off_t offset, size_t len,
 
   DEBUGASSERT(fs != NULL && fs->mtd != NULL && src != NULL && len > 0);
 
+  spiffs_cache_rainvalidate(fs, offset, len);
   remaining = len;
 
 #ifdef CONFIG_MTD_BYTE_WRITE
@@ -452,6 +455,8 @@ ssize_t spiffs_mtd_erase(FAR struct spiffs_s *fs, off_t offset, size_t len)
 
   DEBUGASSERT(fs != NULL && fs->mtd != NULL);
 
+  spiffs_cache_rainvalidate(fs, offset, len);
+
   /* We will have to do block read(s)
    *
    * erasesize  - Size of one erase block.
@@ -67,6 +67,7 @@
 #include "spiffs_cache.h"
 #include "spiffs_gc.h"
 #include "spiffs_check.h"
+#include "spiffs_index.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -75,6 +76,10 @@
 #define spiffs_lock_volume(fs)       (spiffs_lock_reentrant(&fs->exclsem))
 #define spiffs_unlock_volume(fs)     (spiffs_unlock_reentrant(&fs->exclsem))
 
+#ifndef CONFIG_SPIFFS_GC_BACKGROUND
+#  define spiffs_gc_schedule(fs)
+#endif
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -83,6 +88,10 @@
 
 static void spiffs_lock_reentrant(FAR struct spiffs_sem_s *sem);
 static void spiffs_unlock_reentrant(FAR struct spiffs_sem_s *sem);
+#ifdef CONFIG_SPIFFS_GC_BACKGROUND
+static void spiffs_gc_worker(FAR void *arg);
+static void spiffs_gc_schedule(FAR struct spiffs_s *fs);
+#endif
 
 /* File system operations */
 
@@ -243,6 +252,75 @@ static void spiffs_unlock_reentrant(FAR struct spiffs_sem_s *rsem)
     }
 }
 
+#ifdef CONFIG_SPIFFS_GC_BACKGROUND
+/****************************************************************************
+ * Name: spiffs_gc_worker
+ *
+ * Description:
+ *   Perform one bounded step of garbage collection on the low priority
+ *   work queue.  The volume is locked only for the duration of the step so
+ *   that file system operations wait for at most one block to be
+ *   reclaimed.
+ *
+ ****************************************************************************/
+
+static void spiffs_gc_worker(FAR void *arg)
+{
+  FAR struct spiffs_s *fs = (FAR struct spiffs_s *)arg;
+  int ret;
+
+  spiffs_lock_volume(fs);
+  fs->gcbusy = false;
+
+  /* The volume is being unmounted.  spiffs_unbind() waits for us to let
+   * go of the volume before it frees it.
+   */
+
+  if (fs->gcstop)
+    {
+      spiffs_unlock_volume(fs);
+      nxsem_post(&fs->gcdone);
+      return;
+    }
+
+  ret = spiffs_gc_step(fs);
+  if (ret >= 0)
+    {
+      /* Continue later if the free space is still below the watermark */
+
+      spiffs_gc_schedule(fs);
+    }
+  else if (ret != -ENODATA)
+    {
+      ferr("ERROR: spiffs_gc_step() failed: %d\n", ret);
+    }
+
+  spiffs_unlock_volume(fs);
+}
+
+/****************************************************************************
+ * Name: spiffs_gc_schedule
+ *
+ * Description:
+ *   Schedule a background garbage collection step if the number of free
+ *   blocks is below the watermark and there are deleted pages to reclaim.
+ *
+ ****************************************************************************/
+
+static void spiffs_gc_schedule(FAR struct spiffs_s *fs)
+{
+  if (!fs->gcstop && fs->free_blocks < CONFIG_SPIFFS_GC_WATERMARK &&
+      fs->deleted_pages > 0 && work_available(&fs->gcwork))
+    {
+      if (work_queue(LPWORK, &fs->gcwork, spiffs_gc_worker, fs,
+                     MSEC2TICK(CONFIG_SPIFFS_GC_DELAY)) >= 0)
+        {
+          fs->gcbusy = true;
+        }
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: spiffs_readdir_callback
  ****************************************************************************/
@@ -458,6 +536,14 @@ static int spiffs_open(FAR struct file *filep, FAR const char *relpath,
       goto errout_with_fileobject;
     }
 
+  /* Add the new file object to the tail of the open file list.  This must
+   * be done before the file is truncated:  Garbage collection may then move
+   * the object index header and only the open files are told about it.
+   */
+
+  finfo("Adding fobj for objid=%04x\n", fobj->objid);
+  dq_addlast((FAR dq_entry_t *)fobj, &fs->objq);
+
   /* Truncate the file to zero length */
 
   if ((oflags & O_TRUNC) != 0)
@@ -466,6 +552,7 @@ static int spiffs_open(FAR struct file *filep, FAR const char *relpath,
       if (ret < 0)
         {
           ferr("ERROR: spiffs_fobj_truncate() failed: %d\n", ret);
+          dq_rem((FAR dq_entry_t *)fobj, &fs->objq);
           goto errout_with_fileobject;
         }
     }
@@ -488,11 +575,6 @@ static int spiffs_open(FAR struct file *filep, FAR const char *relpath,
 
   filep->f_pos = offset;
 
-  /* Add the new file object to the tail of the open file list */
-
-  finfo("Adding fobj for objid=%04x\n", fobj->objid);
-  dq_addlast((FAR dq_entry_t *)fobj, &fs->objq);
-
   spiffs_unlock_volume(fs);
   return OK;
 
@@ -511,7 +593,7 @@ static int spiffs_close(FAR struct file *filep)
   FAR struct inode *inode;
   FAR struct spiffs_s *fs;
   FAR struct spiffs_file_s *fobj;
-  int ret;
+  int ret = OK;
 
   finfo("filep=%p\n", filep);
   DEBUGASSERT(filep->f_priv != NULL && filep->f_inode != NULL);
@@ -559,7 +641,7 @@ static int spiffs_close(FAR struct file *filep)
       nflushed = spiffs_fobj_flush(fs, fobj);
       if (nflushed < 0)
         {
-          ferr("ERROR: spiffs_fobj_flush() failed: %d\n", ret);
+          ferr("ERROR: spiffs_fobj_flush() failed: %d\n", (int)nflushed);
           ret = (int)nflushed;
         }
 
@@ -576,6 +658,7 @@ static int spiffs_close(FAR struct file *filep)
 
   /* Release the lock on the file system */
 
+  spiffs_gc_schedule(fs);
   spiffs_unlock_volume(fs);
   return ret;
 }
@@ -683,93 +766,117 @@ static ssize_t spiffs_write(FAR struct file *filep, FAR const char *buffer,
     {
       if (buflen < (size_t)SPIFFS_GEO_PAGE_SIZE(fs))
         {
-          /* Small write, try to cache it */
+          FAR struct spiffs_cache_page_s *cp;
+          FAR uint8_t *cpage_data;
+          off_t offset_in_cpage;
+          off_t wend;
+          size_t nbytes;
+
+          /* Small write, try to cache it.  A cache page holds data for at
+           * most one data page:  Writes are split at data page boundaries
+           * and a cache page is written back as soon as its data page is
+           * complete.  Sequential small writes are then written to FLASH as
+           * whole data pages and no data page is rewritten.
+           */
 
-          bool alloc_cpage = true;
-          if (fobj->cache_page != NULL)
+          nwritten = 0;
+          while (buflen > 0)
             {
-              /* We have a cached page for this object already, check cache
-               * page boundaries
-               */
-
-              if (offset < fobj->cache_page->offset ||
-                  offset > fobj->cache_page->offset + fobj->cache_page->size ||
-                  offset + buflen > fobj->cache_page->offset + SPIFFS_GEO_PAGE_SIZE(fs))
+              cp = fobj->cache_page;
+              if (cp != NULL)
                 {
-                  /* Boundary violation, write back cache first and allocate
-                   * new
+                  /* We have a cached page for this object already, check
+                   * cache page boundaries
                    */
 
-                  spiffs_cacheinfo("Cache page=%d for fobj ID=%d "
-                                   "Boundary violation, offset=%d size=%d\n",
-                                   fobj->cache_page->cpndx, fobj->objid,
-                                   fobj->cache_page->offset, fobj->cache_page->size);
-
-                  nwritten = spiffs_fobj_write(fs, fobj,
-                                               spiffs_get_cache_page(fs, spiffs_get_cache(fs),
-                                                                     fobj->cache_page->cpndx),
-                                               fobj->cache_page->offset,
-                                               fobj->cache_page->size);
-                  spiffs_cache_page_release(fs, fobj->cache_page);
-                  if (nwritten < 0)
+                  wend = (cp->offset / SPIFFS_DATA_PAGE_SIZE(fs) + 1) *
+                         SPIFFS_DATA_PAGE_SIZE(fs);
+
+                  if (offset < cp->offset ||
+                      offset > cp->offset + cp->size ||
+                      offset >= wend)
                     {
-                      ret = (int)nwritten;
-                      goto errout_with_lock;
+                      /* Boundary violation, write back cache first and
+                       * allocate new
+                       */
+
+                      spiffs_cacheinfo("Cache page=%d for fobj ID=%d "
+                                       "Boundary violation, offset=%d "
+                                       "size=%d\n",
+                                       cp->cpndx, fobj->objid,
+                                       cp->offset, cp->size);
+
+                      ret = spiffs_fobj_flush(fs, fobj);
+                      if (ret < 0)
+                        {
+                          goto errout_with_lock;
+                        }
+
+                      cp = NULL;
                     }
                 }
-              else
+
+              if (cp == NULL)
                 {
-                  /* Writing within cache */
+                  cp = spiffs_cache_page_allocate_byobjid(fs, fobj);
+                  if (cp == NULL)
+                    {
+                      /* No cache page, write the remaining data directly */
 
-                  alloc_cpage = false;
-                }
-            }
+                      ret = spiffs_fobj_write(fs, fobj, buffer, offset,
+                                              buflen);
+                      if (ret < 0)
+                        {
+                          goto errout_with_lock;
+                        }
 
-          if (alloc_cpage)
-            {
-              fobj->cache_page = spiffs_cache_page_allocate_byobjid(fs, fobj);
-              if (fobj->cache_page)
-                {
-                  fobj->cache_page->offset = offset;
-                  fobj->cache_page->size   = 0;
+                      nwritten += buflen;
+                      goto success_with_lock;
+                    }
+
+                  cp->offset = offset;
+                  cp->size   = 0;
 
                   spiffs_cacheinfo("Allocated cache page %d for fobj %d\n",
-                                   fobj->cache_page->cpndx, fobj->objid);
+                                   cp->cpndx, fobj->objid);
+
+                  wend = (offset / SPIFFS_DATA_PAGE_SIZE(fs) + 1) *
+                         SPIFFS_DATA_PAGE_SIZE(fs);
                 }
-            }
 
-          if (fobj->cache_page)
-            {
-              FAR struct spiffs_cache_s *cache;
-              FAR uint8_t *cpage_data;
-              off_t offset_in_cpage;
+              /* Store the data up to the end of the data page */
 
-              offset_in_cpage = offset - fobj->cache_page->offset;
+              offset_in_cpage = offset - cp->offset;
+              nbytes          = MIN(buflen, (size_t)(wend - offset));
 
-              spiffs_cacheinfo("Storing to cache page %d for fobj %d offset=%d:%d buflen=%d\n",
-                               fobj->cache_page->cpndx, fobj->objid, offset,
-                               offset_in_cpage, buflen);
+              spiffs_cacheinfo("Storing to cache page %d for fobj %d "
+                               "offset=%d:%d nbytes=%d\n",
+                               cp->cpndx, fobj->objid, offset,
+                               offset_in_cpage, nbytes);
 
-              cache = spiffs_get_cache(fs);
-              cpage_data = spiffs_get_cache_page(fs, cache, fobj->cache_page->cpndx);
+              cpage_data = spiffs_get_cache_page(fs, spiffs_get_cache(fs),
+                                                 cp->cpndx);
+              memcpy(&cpage_data[offset_in_cpage], buffer, nbytes);
+              cp->size = MAX(cp->size, offset_in_cpage + nbytes);
 
-              memcpy(&cpage_data[offset_in_cpage], buffer, buflen);
-              fobj->cache_page->size = MAX(fobj->cache_page->size, offset_in_cpage + buflen);
+              buffer   += nbytes;
+              buflen   -= nbytes;
+              offset   += nbytes;
+              nwritten += nbytes;
 
-              nwritten = buflen;
-              goto success_with_lock;
-            }
-          else
-            {
-              nwritten = spiffs_fobj_write(fs, fobj, buffer, offset, buflen);
-              if (nwritten < 0)
+              /* Write back the cache page if the data page is complete */
+
+              if (cp->offset + cp->size >= wend)
                 {
-                  ret = (int)nwritten;
-                  goto errout_with_lock;
+                  ret = spiffs_fobj_flush(fs, fobj);
+                  if (ret < 0)
+                    {
+                      goto errout_with_lock;
+                    }
                 }
-
-               goto success_with_lock;
             }
+
+          goto success_with_lock;
         }
       else
         {
@@ -819,6 +926,7 @@ success_with_lock:
 
   /* Release our access to the volume */
 
+  spiffs_gc_schedule(fs);
   spiffs_unlock_volume(fs);
   return nwritten;
 
@@ -955,6 +1063,7 @@ static int spiffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 {
   FAR struct inode *inode;
   FAR struct spiffs_s *fs;
+  int16_t pgndx;
   int ret;
 
   finfo("filep=%p cmd=%d arg=%ld\n", filep, cmd, (long)arg);
@@ -984,6 +1093,10 @@ static int spiffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
       case FIOC_INTEGRITY:
         {
           ret = spiffs_consistency_check(fs);
+
+          /* The check may have moved or deleted object index headers */
+
+          spiffs_index_invalidate(fs);
         }
         break;
 
@@ -1015,6 +1128,23 @@ static int spiffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
                   blkndx++;
                 }
             }
+
+          /* Forget the old content of the volume:  Drop the cached pages
+           * and count the free blocks and pages again.
+           */
+
+          for (pgndx = 0; pgndx < (int16_t)fs->total_pages; pgndx++)
+            {
+              spiffs_cache_drop_page(fs, pgndx);
+            }
+
+          spiffs_cache_rainvalidate(fs, 0, fs->media_size);
+          spiffs_index_invalidate(fs);
+
+          if (ret >= 0)
+            {
+              ret = spiffs_objlu_scan(fs);
+            }
         }
         break;
 
@@ -1029,6 +1159,54 @@ static int spiffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
         }
         break;
 
+      /* Run one bounded step of garbage collection.
+       * IN:  None
+       * OUT: None
+       */
+
+      case FIOC_GCSTEP:
+        {
+          ret = spiffs_gc_step(fs);
+        }
+        break;
+
+      /* Report the garbage collection state.
+       * IN:  Pointer to a struct fs_gcstatus_s
+       * OUT: The garbage collection state
+       */
+
+      case FIOC_GCSTATUS:
+        {
+          FAR struct fs_gcstatus_s *status =
+            (FAR struct fs_gcstatus_s *)((uintptr_t)arg);
+          int32_t free_pages;
+
+          if (status == NULL)
+            {
+              ret = -EINVAL;
+              break;
+            }
+
+          free_pages = (SPIFFS_GEO_PAGES_PER_BLOCK(fs) -
+                        SPIFFS_OBJ_LOOKUP_PAGES(fs)) *
+                       (SPIFFS_GEO_BLOCK_COUNT(fs) - 2) -
+                       fs->alloc_pages - fs->deleted_pages;
+
+#ifdef CONFIG_SPIFFS_GC_BACKGROUND
+          status->gc_active = !work_available(&fs->gcwork);
+#else
+          status->gc_active = false;
+#endif
+          status->gc_steps  = fs->gc_steps;
+          status->gc_free   = free_pages > 0 ?
+                              (off_t)free_pages * SPIFFS_DATA_PAGE_SIZE(fs) :
+                              0;
+          status->gc_dirty  = (off_t)fs->deleted_pages *
+                              SPIFFS_DATA_PAGE_SIZE(fs);
+          ret = OK;
+        }
+        break;
+
       /* Dump logical content of FLASH.
        * IN:  None
        * OUT: None
@@ -1043,9 +1221,13 @@ static int spiffs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 #endif
 
       default:
-        /* Pass through to the contained MTD driver */
+        /* Pass through to the contained MTD driver.  This may change the
+         * FLASH content behind our back.
+         */
 
         ret = MTD_IOCTL(fs->mtd, cmd, arg);
+        spiffs_cache_rainvalidate(fs, 0, fs->media_size);
+        spiffs_index_invalidate(fs);
         break;
     }
 
@@ -1246,6 +1428,7 @@ static int spiffs_truncate(FAR struct file *filep, off_t length)
       filep->f_pos = fsize;
     }
 
+  spiffs_gc_schedule(fs);
   spiffs_unlock_volume(fs);
   return spiffs_map_errno(ret);
 }
@@ -1441,8 +1624,26 @@ static int spiffs_bind(FAR struct inode *mtdinode, FAR const void *data,
   fs->lu_work   = &work[SPIFFS_GEO_PAGE_SIZE(fs)];
   fs->mtd_work  = &work[2 * SPIFFS_GEO_PAGE_SIZE(fs)];
 
+#if CONFIG_SPIFFS_READAHEAD > 1
+  /* Allocate the read-ahead buffer.  Read-ahead is simply disabled if
+   * there is not enough memory.
+   */
+
+  fs->rabuf = (FAR uint8_t *)
+    kmm_malloc(CONFIG_SPIFFS_READAHEAD * SPIFFS_GEO_PAGE_SIZE(fs));
+  if (fs->rabuf == NULL)
+    {
+      fwarn("WARNING: Failed to allocate read-ahead buffer\n");
+    }
+#endif
+
   (void)nxsem_init(&fs->exclsem.sem, 0, 1);
 
+#ifdef CONFIG_SPIFFS_GC_BACKGROUND
+  (void)nxsem_init(&fs->gcdone, 0, 0);
+  nxsem_setprotocol(&fs->gcdone, SEM_PRIO_NONE);
+#endif
+
   /* Check the file system */
 
   ret = spiffs_objlu_scan(fs);
@@ -1475,6 +1676,8 @@ static int spiffs_bind(FAR struct inode *mtdinode, FAR const void *data,
     {
       fwarn("WARNING: File system is damaged: %d\n", ret);
     }
+
+  spiffs_index_invalidate(fs);
 #endif
 
   /* Return the new file system handle */
@@ -1483,6 +1686,13 @@ static int spiffs_bind(FAR struct inode *mtdinode, FAR const void *data,
   return OK;
 
 errout_with_work:
+#if CONFIG_SPIFFS_READAHEAD > 1
+  if (fs->rabuf != NULL)
+    {
+      kmm_free(fs->rabuf);
+    }
+
+#endif
   kmm_free(fs->work);
 
 errout_with_cache:
@@ -1530,6 +1740,29 @@ static int spiffs_unbind(FAR void *handle, FAR struct inode **mtdinode,
       spiffs_fobj_free(fs, fobj, false);
     }
 
+#ifdef CONFIG_SPIFFS_GC_BACKGROUND
+  /* Stop background garbage collection.  If the worker has already been
+   * started, it may be waiting for the volume lock that we hold.  Let it
+   * run to see that the volume is going away and wait until it has let
+   * go of the volume.
+   */
+
+  fs->gcstop = true;
+  if (work_cancel(LPWORK, &fs->gcwork) >= 0)
+    {
+      fs->gcbusy = false;
+    }
+
+  if (fs->gcbusy)
+    {
+      spiffs_unlock_volume(fs);
+      (void)nxsem_wait_uninterruptible(&fs->gcdone);
+      spiffs_lock_volume(fs);
+    }
+
+  nxsem_destroy(&fs->gcdone);
+#endif
+
  /* Free allocated working buffers */
 
   if (fs->work != NULL)
@@ -1542,11 +1775,20 @@ static int spiffs_unbind(FAR void *handle, FAR struct inode **mtdinode,
       kmm_free(fs->cache);
     }
 
+#if CONFIG_SPIFFS_READAHEAD > 1
+  if (fs->rabuf != NULL)
+    {
+      kmm_free(fs->rabuf);
+    }
+#endif
+
+  spiffs_index_release(fs);
+
    /* Free the volume memory (note that the semaphore is now stale!) */
 
   nxsem_destroy(&fs->exclsem.sem);
   kmm_free(fs);
-  ret = OK;
+  return OK;
 
 errout_with_lock:
   spiffs_unlock_volume(fs);
@@ -1711,6 +1953,7 @@ static int spiffs_unlink(FAR struct inode *mountpt, FAR const char *relpath)
 
   /* Release the lock on the volume */
 
+  spiffs_gc_schedule(fs);
   spiffs_unlock_volume(fs);
   return OK;
 
@@ -1786,7 +2029,7 @@ static int spiffs_rename(FAR struct inode *mountpt, FAR const char *oldrelpath,
                                  &oldpgndx);
   if (ret < 0)
     {
-      fwarn("WARNING: spiffs_find_objhdr_pgndx failed: %d\n");
+      fwarn("WARNING: spiffs_find_objhdr_pgndx failed: %d\n", ret);
       goto errout_with_lock;
     }
 
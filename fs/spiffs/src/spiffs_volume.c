@@ -294,7 +294,7 @@ ssize_t spiffs_fobj_write(FAR struct spiffs_s *fs,
 
   if (fobj->size != SPIFFS_UNDEFINED_LEN)
     {
-      while (offset < fobj->size)
+      while (remaining > 0 && offset < fobj->size)
         {
           ssize_t nwritten;
           ssize_t wrsize;
@@ -67,10 +67,6 @@
 #  warning CONFIG_FS_TMPFS_DIRECTORY_FREEGUARD needs to be > ALLOCGUARD
 #endif
 
-#if CONFIG_FS_TMPFS_FILE_FREEGUARD <= CONFIG_FS_TMPFS_FILE_ALLOCGUARD
-#  warning CONFIG_FS_TMPFS_FILE_FREEGUARD needs to be > ALLOCGUARD
-#endif
-
 #define tmpfs_lock_file(tfo) \
            (tmpfs_lock_object((FAR struct tmpfs_object_s *)tfo))
 #define tmpfs_lock_directory(tdo) \
@@ -93,8 +89,11 @@ static void tmpfs_lock_object(FAR struct tmpfs_object_s *to);
 static void tmpfs_unlock_object(FAR struct tmpfs_object_s *to);
 static int  tmpfs_realloc_directory(FAR struct tmpfs_directory_s **tdo,
               unsigned int nentries);
-static int  tmpfs_realloc_file(FAR struct tmpfs_file_s **tfo,
+static int  tmpfs_realloc_file(FAR struct tmpfs_file_s *tfo,
               size_t newsize);
+static void tmpfs_copy_file(FAR struct tmpfs_file_s *tfo, off_t pos,
+              FAR uint8_t *dest, FAR const uint8_t *src, size_t nbytes);
+static void tmpfs_free_file(FAR struct tmpfs_file_s *tfo);
 static void tmpfs_release_lockedobject(FAR struct tmpfs_object_s *to);
 static void tmpfs_release_lockedfile(FAR struct tmpfs_file_s *tfo);
 static int  tmpfs_find_dirent(FAR struct tmpfs_directory_s *tdo,
@@ -373,71 +372,146 @@ static int tmpfs_realloc_directory(FAR struct tmpfs_directory_s **tdo,
 
 /****************************************************************************
  * Name: tmpfs_realloc_file
+ *
+ * Description:
+ *   Set the size of the file, allocating or freeing pages as needed.  The
+ *   content of newly added pages is not initialized.
+ *
  ****************************************************************************/
 
-static int tmpfs_realloc_file(FAR struct tmpfs_file_s **tfo,
+static int tmpfs_realloc_file(FAR struct tmpfs_file_s *tfo,
                               size_t newsize)
 {
-  FAR struct tmpfs_file_s *oldtfo = *tfo;
-  FAR struct tmpfs_file_s *newtfo;
-  size_t objsize;
-  size_t allocsize;
-  size_t delta;
-
-  /* Check if the current allocation is sufficient */
+  FAR uint8_t **pages;
+  unsigned int npages;
+  unsigned int maxpages;
 
-  objsize = SIZEOF_TMPFS_FILE(newsize);
+  npages = TMPFS_NPAGES(newsize);
 
-  /* Are we growing or shrinking the object? */
+  /* Grow the page table if needed.  Doubling its size keeps the cost of
+   * appending to a file constant on average.
+   */
 
-  if (objsize <= oldtfo->tfo_alloc)
+  if (npages > tfo->tfo_maxpages)
     {
-      /* Shrinking ... Shrink unconditionally if the size is shrinking to
-       * zero.
-       */
+      maxpages = tfo->tfo_maxpages > 0 ? tfo->tfo_maxpages : 1;
+      while (maxpages < npages)
+        {
+          maxpages <<= 1;
+        }
 
-      if (newsize > 0)
+      pages = (FAR uint8_t **)
+        kmm_realloc(tfo->tfo_pages, maxpages * sizeof(FAR uint8_t *));
+      if (pages == NULL)
         {
-          /* Otherwise, don't realloc unless the object has shrunk by a
-           * lot.
-           */
+          return -ENOMEM;
+        }
 
-          delta = oldtfo->tfo_alloc - objsize;
-          if (delta <= CONFIG_FS_TMPFS_FILE_FREEGUARD)
-            {
-              /* Hasn't shrunk enough.. Return doing nothing for now */
+      tfo->tfo_pages    = pages;
+      tfo->tfo_maxpages = maxpages;
+    }
 
-              oldtfo->tfo_size = newsize;
-              return OK;
-            }
+  /* Allocate any pages that are needed */
+
+  while (tfo->tfo_npages < npages)
+    {
+      FAR uint8_t *page = (FAR uint8_t *)kmm_malloc(TMPFS_PAGESIZE);
+      if (page == NULL)
+        {
+          return -ENOMEM;
         }
+
+      tfo->tfo_pages[tfo->tfo_npages++] = page;
     }
 
-  /* Added some additional amount to the new size to account frequent
-   * reallocations.
-   */
+  /* And free any pages that are no longer needed */
 
-  allocsize = objsize + CONFIG_FS_TMPFS_FILE_ALLOCGUARD;
+  while (tfo->tfo_npages > npages)
+    {
+      kmm_free(tfo->tfo_pages[--tfo->tfo_npages]);
+    }
 
-  /* Realloc the file object */
+  if (npages == 0 && tfo->tfo_pages != NULL)
+    {
+      kmm_free(tfo->tfo_pages);
+      tfo->tfo_pages    = NULL;
+      tfo->tfo_maxpages = 0;
+    }
 
-  newtfo = (FAR struct tmpfs_file_s *)kmm_realloc(oldtfo, allocsize);
-  if (newtfo == NULL)
+  tfo->tfo_alloc = sizeof(struct tmpfs_file_s) +
+                   tfo->tfo_maxpages * sizeof(FAR uint8_t *) +
+                   tfo->tfo_npages * TMPFS_PAGESIZE;
+  tfo->tfo_size  = newsize;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tmpfs_copy_file
+ *
+ * Description:
+ *   Copy data between a buffer and the pages of the file.  If 'src' is
+ *   NULL, the file data is set to zero instead.
+ *
+ ****************************************************************************/
+
+static void tmpfs_copy_file(FAR struct tmpfs_file_s *tfo, off_t pos,
+                            FAR uint8_t *dest, FAR const uint8_t *src,
+                            size_t nbytes)
+{
+  FAR uint8_t *page;
+  size_t offset;
+  size_t ncopy;
+
+  while (nbytes > 0)
     {
-      return -ENOMEM;
+      DEBUGASSERT(pos / TMPFS_PAGESIZE < tfo->tfo_npages);
+
+      page   = tfo->tfo_pages[pos / TMPFS_PAGESIZE];
+      offset = pos % TMPFS_PAGESIZE;
+      ncopy  = TMPFS_PAGESIZE - offset;
+      if (ncopy > nbytes)
+        {
+          ncopy = nbytes;
+        }
+
+      if (dest != NULL)
+        {
+          memcpy(dest, &page[offset], ncopy);
+          dest += ncopy;
+        }
+      else if (src != NULL)
+        {
+          memcpy(&page[offset], src, ncopy);
+          src += ncopy;
+        }
+      else
+        {
+          memset(&page[offset], 0, ncopy);
+        }
+
+      pos    += ncopy;
+      nbytes -= ncopy;
     }
+}
 
-  /* Adjust the reference in the parent directory entry */
+/****************************************************************************
+ * Name: tmpfs_free_file
+ ****************************************************************************/
 
-  DEBUGASSERT(newtfo->tfo_dirent);
-  newtfo->tfo_dirent->tde_object = (FAR struct tmpfs_object_s *)newtfo;
+static void tmpfs_free_file(FAR struct tmpfs_file_s *tfo)
+{
+  while (tfo->tfo_npages > 0)
+    {
+      kmm_free(tfo->tfo_pages[--tfo->tfo_npages]);
+    }
 
-  /* Return the new address of the reallocated file object */
+  if (tfo->tfo_pages != NULL)
+    {
+      kmm_free(tfo->tfo_pages);
+    }
 
-  newtfo->tfo_alloc = allocsize;
-  newtfo->tfo_size  = newsize;
-  *tfo              = newtfo;
-  return OK;
+  nxsem_destroy(&tfo->tfo_exclsem.ts_sem);
+  kmm_free(tfo);
 }
 
 /****************************************************************************
@@ -475,8 +549,7 @@ static void tmpfs_release_lockedfile(FAR struct tmpfs_file_s *tfo)
 
   if (tfo->tfo_refs == 1 && (tfo->tfo_flags & TFO_FLAG_UNLINKED) != 0)
     {
-      nxsem_destroy(&tfo->tfo_exclsem.ts_sem);
-      kmm_free(tfo);
+      tmpfs_free_file(tfo);
     }
 
   /* Otherwise, just decrement the reference count on the file object */
@@ -622,12 +695,12 @@ static int tmpfs_add_dirent(FAR struct tmpfs_directory_s **tdo,
 static FAR struct tmpfs_file_s *tmpfs_alloc_file(void)
 {
   FAR struct tmpfs_file_s *tfo;
-  size_t allocsize;
 
-  /* Create a new zero length file object */
+  /* Create a new zero length file object.  No pages are allocated until
+   * data is written.
+   */
 
-  allocsize = SIZEOF_TMPFS_FILE(CONFIG_FS_TMPFS_FILE_ALLOCGUARD);
-  tfo = (FAR struct tmpfs_file_s *)kmm_malloc(allocsize);
+  tfo = (FAR struct tmpfs_file_s *)kmm_malloc(sizeof(struct tmpfs_file_s));
   if (tfo == NULL)
     {
       return NULL;
@@ -637,11 +710,14 @@ static FAR struct tmpfs_file_s *tmpfs_alloc_file(void)
    * locked with one reference count.
    */
 
-  tfo->tfo_alloc = allocsize;
-  tfo->tfo_type  = TMPFS_REGULAR;
-  tfo->tfo_refs  = 1;
-  tfo->tfo_flags = 0;
-  tfo->tfo_size  = 0;
+  tfo->tfo_alloc    = sizeof(struct tmpfs_file_s);
+  tfo->tfo_type     = TMPFS_REGULAR;
+  tfo->tfo_refs     = 1;
+  tfo->tfo_flags    = 0;
+  tfo->tfo_size     = 0;
+  tfo->tfo_pages    = NULL;
+  tfo->tfo_npages   = 0;
+  tfo->tfo_maxpages = 0;
 
   tfo->tfo_exclsem.ts_holder = getpid();
   tfo->tfo_exclsem.ts_count  = 1;
@@ -1275,6 +1351,11 @@ static int tmpfs_free_callout(FAR struct tmpfs_directory_s *tdo,
           tfo->tfo_flags |= TFO_FLAG_UNLINKED;
           return TMPFS_UNLINKED;
         }
+
+      /* No.. free the file and its pages now */
+
+      tmpfs_free_file(tfo);
+      return TMPFS_DELETED;
     }
 
   /* Free the object now */
@@ -1428,7 +1509,7 @@ static int tmpfs_open(FAR struct file *filep, FAR const char *relpath,
 
           if (tfo->tfo_size > 0)
             {
-              ret = tmpfs_realloc_file(&tfo, 0);
+              ret = tmpfs_realloc_file(tfo, 0);
               if (ret < 0)
                 {
                   goto errout_with_filelock;
@@ -1543,7 +1624,7 @@ static int tmpfs_close(FAR struct file *filep)
        * have any other references.
        */
 
-      kmm_free(tfo);
+      tmpfs_free_file(tfo);
       return OK;
     }
 
@@ -1586,12 +1667,12 @@ static ssize_t tmpfs_read(FAR struct file *filep, FAR char *buffer,
   if (endpos > tfo->tfo_size)
     {
       endpos = tfo->tfo_size;
-      nread  = endpos - startpos;
+      nread  = endpos > startpos ? endpos - startpos : 0;
     }
 
   /* Copy data from the memory object to the user buffer */
 
-  memcpy(buffer, &tfo->tfo_data[startpos], nread);
+  tmpfs_copy_file(tfo, startpos, (FAR uint8_t *)buffer, NULL, nread);
   filep->f_pos += nread;
 
   /* Release the lock on the file */
@@ -1611,6 +1692,7 @@ static ssize_t tmpfs_write(FAR struct file *filep, FAR const char *buffer,
   ssize_t nwritten;
   off_t startpos;
   off_t endpos;
+  off_t oldsize;
   int ret;
 
   finfo("filep: %p buffer: %p buflen: %lu\n",
@@ -1633,20 +1715,27 @@ static ssize_t tmpfs_write(FAR struct file *filep, FAR const char *buffer,
 
   if (endpos > tfo->tfo_size)
     {
-      /* Reallocate the file to handle the write past the end of the file. */
+      /* Add pages to handle the write past the end of the file. */
 
-      ret = tmpfs_realloc_file(&tfo, (size_t)endpos);
+      oldsize = tfo->tfo_size;
+      ret = tmpfs_realloc_file(tfo, (size_t)endpos);
       if (ret < 0)
         {
           goto errout_with_lock;
         }
 
-      filep->f_priv = tfo;
+      /* Zero any gap between the old end of the file and the data */
+
+      if (startpos > oldsize)
+        {
+          tmpfs_copy_file(tfo, oldsize, NULL, NULL, startpos - oldsize);
+        }
     }
 
-  /* Copy data from the memory object to the user buffer */
+  /* Copy data from the user buffer to the memory object */
 
-  memcpy(&tfo->tfo_data[startpos], buffer, nwritten);
+  tmpfs_copy_file(tfo, startpos, NULL, (FAR const uint8_t *)buffer,
+                  nwritten);
   filep->f_pos += nwritten;
 
   /* Release the lock on the file */
@@ -1741,12 +1830,38 @@ static int tmpfs_ioctl(FAR struct file *filep, int cmd, unsigned long arg)
 
   if (cmd == FIOC_MMAP && ppv != NULL)
     {
-      /* Return the address on the media corresponding to the start of
-       * the file.
+      unsigned int i;
+      int ret = OK;
+
+      /* The file can be mapped only if all of its pages lie one after the
+       * other in memory.
        */
 
-      *ppv = (FAR void *)tfo->tfo_data;
-      return OK;
+      tmpfs_lock_file(tfo);
+      if (tfo->tfo_npages == 0)
+        {
+          ret = -ENOSYS;
+        }
+
+      for (i = 1; ret == OK && i < tfo->tfo_npages; i++)
+        {
+          if (tfo->tfo_pages[i] != tfo->tfo_pages[i - 1] + TMPFS_PAGESIZE)
+            {
+              ret = -ENOSYS;
+            }
+        }
+
+      /* Return the address in memory corresponding to the start of the
+       * file.
+       */
+
+      if (ret == OK)
+        {
+          *ppv = (FAR void *)tfo->tfo_pages[0];
+        }
+
+      tmpfs_unlock_file(tfo);
+      return ret;
     }
 
   ferr("ERROR: Invalid cmd: %d\n", cmd);
@@ -1850,21 +1965,19 @@ static int tmpfs_truncate(FAR struct file *filep, off_t length)
     {
       /* The size is changing.. up or down.  Reallocate the file memory. */
 
-      ret = tmpfs_realloc_file(&tfo, (size_t)length);
+      ret = tmpfs_realloc_file(tfo, (size_t)length);
       if (ret < 0)
         {
           goto errout_with_lock;
         }
 
-      filep->f_priv = tfo;
-
       /* If the size has increased, then we need to zero the newly added
        * memory.
        */
 
       if (length > oldsize)
         {
-          memset(&tfo->tfo_data[oldsize], 0, length - oldsize);
+          tmpfs_copy_file(tfo, oldsize, NULL, NULL, length - oldsize);
         }
 
       ret = OK;
@@ -2275,8 +2388,7 @@ static int tmpfs_unlink(FAR struct inode *mountpt, FAR const char *relpath)
 
   else
     {
-      nxsem_destroy(&tfo->tfo_exclsem.ts_sem);
-      kmm_free(tfo);
+      tmpfs_free_file(tfo);
     }
 
   /* Release the reference and lock on the parent directory */
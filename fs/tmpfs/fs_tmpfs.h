@@ -54,6 +54,15 @@
 
 #define TMPFS_NO_HOLDER   -1
 
+/* File data is held in pages of this size */
+
+#ifndef CONFIG_FS_TMPFS_PAGESIZE
+#  define CONFIG_FS_TMPFS_PAGESIZE 512
+#endif
+
+#define TMPFS_PAGESIZE    CONFIG_FS_TMPFS_PAGESIZE
+#define TMPFS_NPAGES(n)   (((n) + TMPFS_PAGESIZE - 1) / TMPFS_PAGESIZE)
+
 /* Bit definitions for file object flags */
 
 #define TFO_FLAG_UNLINKED (1 << 0)  /* Bit 0: File is unlinked */
@@ -137,6 +146,12 @@ struct tmpfs_directory_s
  * state.  The file memory object also serves as the open file object,
  * saving an allocation.  This has the negative side effect that no per-
  * open state can be retained (such as open flags).
+ *
+ * The file data is held in separately allocated pages of TMPFS_PAGESIZE
+ * bytes.  Page n holds the file data at offset n * TMPFS_PAGESIZE.  Only
+ * the table of page pointers is reallocated as the file grows, so the file
+ * object itself never moves and no contiguous memory as large as the file
+ * is needed.
  */
 
 struct tmpfs_file_s
@@ -154,11 +169,11 @@ struct tmpfs_file_s
 
   uint8_t  tfo_flags;    /* See TFO_FLAG_* definitions */
   size_t   tfo_size;     /* Valid file size */
-  uint8_t  tfo_data[1];  /* File data starts here */
+  FAR uint8_t **tfo_pages; /* Table of allocated pages */
+  unsigned int tfo_npages; /* Number of allocated pages */
+  unsigned int tfo_maxpages; /* Number of entries in the page table */
 };
 
-#define SIZEOF_TMPFS_FILE(n) (sizeof(struct tmpfs_file_s) + (n) - 1)
-
 /* This structure represents one instance of a TMPFS file system */
 
 struct tmpfs_s
@@ -0,0 +1,188 @@
+/****************************************************************************
+ * fs/vfs/fs_fadvise.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <assert.h>
+
+#include <nuttx/fs/fs.h>
+
+#include "inode/inode.h"
+
+#ifndef CONFIG_DISABLE_MOUNTPOINT
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: file_fadvise
+ *
+ * Description:
+ *   Equivalent to the standard posix_fadvise() function except that is
+ *   accepts a struct file instance instead of a file descriptor and it
+ *   returns a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int file_fadvise(FAR struct file *filep, off_t offset, off_t len,
+                 int advice)
+{
+  FAR struct inode *inode;
+  int ret;
+
+  DEBUGASSERT(filep != NULL);
+
+  if (offset < 0 || len < 0 ||
+      advice < POSIX_FADV_NORMAL || advice > POSIX_FADV_NOREUSE)
+    {
+      return -EINVAL;
+    }
+
+  inode = filep->f_inode;
+  if (inode == NULL)
+    {
+      return -EBADF;
+    }
+
+  /* The advice has no effect on anything but files in mounted volumes
+   * whose file system supports it.
+   */
+
+  if (!INODE_IS_MOUNTPT(inode) || inode->u.i_mops == NULL ||
+      inode->u.i_mops->fadvise == NULL)
+    {
+      return OK;
+    }
+
+#ifdef CONFIG_FS_READAHEAD
+  /* Let the read-ahead logic know about the advice.  Data that will be
+   * needed is requested from the file system on the work queue so that the
+   * caller does not wait for it.
+   */
+
+  ret = file_readahead_advise(filep, offset, len, advice);
+  if (ret != OK)
+    {
+      return ret < 0 ? ret : OK;
+    }
+#endif
+
+  /* Pass the advice to the file system */
+
+  ret = inode->u.i_mops->fadvise(filep, offset, len, advice);
+  return ret == -ENOSYS ? OK : ret;
+}
+
+/****************************************************************************
+ * Name: posix_fadvise
+ *
+ * Description:
+ *   Advise the system about the expected use of a range of the data of an
+ *   open file.  The advice does not change the semantics of any operation
+ *   on the file.  Returns zero on success and an error number on failure;
+ *   the errno variable is not modified.
+ *
+ ****************************************************************************/
+
+int posix_fadvise(int fd, off_t offset, off_t len, int advice)
+{
+  FAR struct file *filep;
+  int ret;
+
+  ret = fs_getfilep(fd, &filep);
+  if (ret < 0)
+    {
+      return -ret;
+    }
+
+  DEBUGASSERT(filep != NULL);
+
+  ret = file_fadvise(filep, offset, len, advice);
+  return ret < 0 ? -ret : OK;
+}
+
+/****************************************************************************
+ * Name: readahead
+ *
+ * Description:
+ *   Start reading a range of the data of an open file into memory so that
+ *   subsequent reads do not wait for the media (non-standard, Linux).  This
+ *   is equivalent to posix_fadvise() with POSIX_FADV_WILLNEED except that
+ *   the file must be open for reading and the errno variable is set on
+ *   failure.
+ *
+ ****************************************************************************/
+
+ssize_t readahead(int fd, off_t offset, size_t count)
+{
+  FAR struct file *filep;
+  int ret;
+
+  ret = fs_getfilep(fd, &filep);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  DEBUGASSERT(filep != NULL);
+
+  if ((filep->f_oflags & O_RDOK) == 0)
+    {
+      ret = -EBADF;
+      goto errout;
+    }
+
+  ret = file_fadvise(filep, offset, (off_t)count, POSIX_FADV_WILLNEED);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  return OK;
+
+errout:
+  set_errno(-ret);
+  return ERROR;
+}
+
+#endif /* !CONFIG_DISABLE_MOUNTPOINT */
@@ -100,7 +100,12 @@ int fs_getfilep(int fd, FAR struct file **filep)
       return -EAGAIN;
     }
 
-  /* And return the file pointer from the list */
+  /* And return the file pointer from the list.  No lock is needed here:
+   * The list is per-group and the descriptor slot itself is never moved,
+   * so the read/write fast path does not serialize on the list semaphore.
+   * A lock held only for the look-up would not keep the slot from being
+   * closed or replaced while the caller uses it anyway.
+   */
 
   *filep = &list->fl_files[fd];
   return OK;
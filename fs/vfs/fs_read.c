@@ -82,6 +82,9 @@
 ssize_t file_read(FAR struct file *filep, FAR void *buf, size_t nbytes)
 {
   FAR struct inode *inode;
+#ifdef CONFIG_FS_READAHEAD
+  off_t pos;
+#endif
   int ret = -EBADF;
 
   DEBUGASSERT(filep);
@@ -107,7 +110,23 @@ ssize_t file_read(FAR struct file *filep, FAR void *buf, size_t nbytes)
        * signature and position in the operations vtable.
        */
 
+#ifdef CONFIG_FS_READAHEAD
+      pos = filep->f_pos;
+#endif
       ret = (int)inode->u.i_ops->read(filep, (FAR char *)buf, (size_t)nbytes);
+
+#ifdef CONFIG_FS_READAHEAD
+      /* Let the read-ahead logic see the access if the file system can
+       * read ahead.
+       */
+
+      if (ret > 0 && INODE_IS_MOUNTPT(inode) &&
+          inode->u.i_mops->fadvise != NULL &&
+          (filep->f_oflags & O_DIRECT) == 0)
+        {
+          file_readahead(filep, pos, ret);
+        }
+#endif
     }
 
   /* Return the number of bytes read (or possibly an error code) */
@@ -0,0 +1,450 @@
+/****************************************************************************
+ * fs/vfs/fs_readahead.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <assert.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/semaphore.h>
+#include <nuttx/wqueue.h>
+#include <nuttx/fs/fs.h>
+
+#include "inode/inode.h"
+
+#ifdef CONFIG_FS_READAHEAD
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_FS_READAHEAD_MIN
+#  define CONFIG_FS_READAHEAD_MIN 1024
+#endif
+
+#ifndef CONFIG_FS_READAHEAD_MAX
+#  define CONFIG_FS_READAHEAD_MAX 8192
+#endif
+
+#if CONFIG_FS_READAHEAD_MAX < CONFIG_FS_READAHEAD_MIN
+#  error CONFIG_FS_READAHEAD_MAX must not be less than CONFIG_FS_READAHEAD_MIN
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* This is the read-ahead state of one open file.  All fields but ra_work
+ * and ra_donesem are protected by ra_sem.
+ */
+
+struct file_readahead_s
+{
+  struct work_s     ra_work;    /* Runs file system requests on LPWORK */
+  sem_t             ra_sem;     /* Protects the read-ahead state */
+  sem_t             ra_donesem; /* Posted when the worker quits on close */
+  FAR struct inode *ra_inode;   /* The file system of the file */
+  FAR void         *ra_priv;    /* The file system's open file data */
+  int               ra_oflags;  /* Open mode flags of the file */
+  off_t             ra_next;    /* Offset expected for the next read */
+  off_t             ra_end;     /* End of the data requested so far */
+  off_t             ra_offset;  /* Start of the pending request */
+  off_t             ra_len;     /* Length of the pending request */
+  size_t            ra_window;  /* Current read-ahead window size */
+  uint8_t           ra_advice;  /* Last POSIX_FADV_NORMAL/RANDOM/SEQUENTIAL */
+  bool              ra_pending; /* A request is waiting for the worker */
+  bool              ra_busy;    /* The worker is queued or running */
+  bool              ra_closing; /* file_readahead_release() is waiting */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: readahead_worker
+ *
+ * Description:
+ *   Pass the pending read-ahead requests to the file system.  This runs on
+ *   the low priority work queue.
+ *
+ ****************************************************************************/
+
+static void readahead_worker(FAR void *arg)
+{
+  FAR struct file_readahead_s *ra = (FAR struct file_readahead_s *)arg;
+  FAR const struct mountpt_operations *mops;
+  struct file file;
+  off_t offset;
+  off_t len;
+  bool closing;
+  int ret;
+
+  DEBUGASSERT(ra != NULL && ra->ra_inode != NULL);
+  mops = ra->ra_inode->u.i_mops;
+
+  /* The file system sees a copy of the open file.  The file position of
+   * the caller's file is not touched.
+   */
+
+  file.f_oflags = ra->ra_oflags;
+  file.f_pos    = 0;
+  file.f_inode  = ra->ra_inode;
+  file.f_priv   = ra->ra_priv;
+  file.f_ra     = NULL;
+
+  for (; ; )
+    {
+      (void)nxsem_wait_uninterruptible(&ra->ra_sem);
+      if (!ra->ra_pending || ra->ra_closing)
+        {
+          break;
+        }
+
+      offset         = ra->ra_offset;
+      len            = ra->ra_len;
+      ra->ra_pending = false;
+      nxsem_post(&ra->ra_sem);
+
+      ret = mops->fadvise(&file, offset, len, POSIX_FADV_WILLNEED);
+      if (ret < 0)
+        {
+          finfo("Read-ahead of %ld bytes at %ld failed: %d\n",
+                (long)len, (long)offset, ret);
+        }
+    }
+
+  /* Nothing more to do.  If the file is being closed, this is the last
+   * access to the read-ahead state.
+   */
+
+  ra->ra_busy = false;
+  closing     = ra->ra_closing;
+  nxsem_post(&ra->ra_sem);
+
+  if (closing)
+    {
+      nxsem_post(&ra->ra_donesem);
+    }
+}
+
+/****************************************************************************
+ * Name: readahead_request
+ *
+ * Description:
+ *   Ask the worker to pass a range of the file to the file system.  A
+ *   request that has not been started yet is replaced.  The caller holds
+ *   ra_sem.
+ *
+ ****************************************************************************/
+
+static void readahead_request(FAR struct file_readahead_s *ra, off_t offset,
+                              off_t len)
+{
+  int ret;
+
+  ra->ra_offset  = offset;
+  ra->ra_len     = len;
+  ra->ra_pending = true;
+
+  if (!ra->ra_busy)
+    {
+      ret = work_queue(LPWORK, &ra->ra_work, readahead_worker, ra, 0);
+      if (ret < 0)
+        {
+          ra->ra_pending = false;
+          return;
+        }
+
+      ra->ra_busy = true;
+    }
+}
+
+/****************************************************************************
+ * Name: readahead_get
+ *
+ * Description:
+ *   Return the read-ahead state of the file, allocating it on first use.
+ *   NULL is returned if the file system does not support read-ahead or if
+ *   memory is not available.
+ *
+ *   Threads sharing the descriptor may get here at the same time.  The new
+ *   state is installed in a critical section only if no other thread has
+ *   installed one in the meantime; otherwise it is freed again.
+ *
+ ****************************************************************************/
+
+static FAR struct file_readahead_s *readahead_get(FAR struct file *filep)
+{
+  FAR struct file_readahead_s *ra;
+  FAR struct file_readahead_s *other;
+  FAR struct inode *inode = filep->f_inode;
+  irqstate_t flags;
+
+  if (filep->f_ra != NULL)
+    {
+      return filep->f_ra;
+    }
+
+  if (inode == NULL || !INODE_IS_MOUNTPT(inode) ||
+      inode->u.i_mops == NULL || inode->u.i_mops->fadvise == NULL)
+    {
+      return NULL;
+    }
+
+  ra = (FAR struct file_readahead_s *)
+    kmm_zalloc(sizeof(struct file_readahead_s));
+  if (ra == NULL)
+    {
+      return NULL;
+    }
+
+  nxsem_init(&ra->ra_sem, 0, 1);
+  nxsem_init(&ra->ra_donesem, 0, 0);
+  nxsem_setprotocol(&ra->ra_donesem, SEM_PRIO_NONE);
+
+  ra->ra_inode  = inode;
+  ra->ra_priv   = filep->f_priv;
+  ra->ra_oflags = filep->f_oflags;
+  ra->ra_window = CONFIG_FS_READAHEAD_MIN;
+  ra->ra_advice = POSIX_FADV_NORMAL;
+
+  flags = enter_critical_section();
+  other = filep->f_ra;
+  if (other == NULL)
+    {
+      filep->f_ra = ra;
+    }
+
+  leave_critical_section(flags);
+
+  if (other != NULL)
+    {
+      /* Another thread won.  Nothing was queued on our state yet. */
+
+      nxsem_destroy(&ra->ra_sem);
+      nxsem_destroy(&ra->ra_donesem);
+      kmm_free(ra);
+      return other;
+    }
+
+  return ra;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: file_readahead
+ *
+ * Description:
+ *   Called by file_read() after each successful read from a file system
+ *   that supports the fadvise method.  See fs/inode/inode.h.
+ *
+ ****************************************************************************/
+
+void file_readahead(FAR struct file *filep, off_t pos, size_t nread)
+{
+  FAR struct file_readahead_s *ra;
+  off_t next;
+
+  ra = readahead_get(filep);
+  if (ra == NULL)
+    {
+      return;
+    }
+
+  next = pos + nread;
+
+  (void)nxsem_wait_uninterruptible(&ra->ra_sem);
+  if (ra->ra_advice == POSIX_FADV_RANDOM)
+    {
+      ra->ra_next = next;
+    }
+  else if (pos != ra->ra_next)
+    {
+      /* Not sequential.  Start over with a small window unless sequential
+       * access was advised.
+       */
+
+      if (ra->ra_advice != POSIX_FADV_SEQUENTIAL)
+        {
+          ra->ra_window = CONFIG_FS_READAHEAD_MIN;
+        }
+
+      ra->ra_next = next;
+      ra->ra_end  = next;
+    }
+  else
+    {
+      /* Sequential.  Keep one window of data requested ahead of the
+       * reader, asking for more when half of it has been consumed.  The
+       * window doubles each time up to the maximum.
+       */
+
+      ra->ra_next = next;
+      if (ra->ra_end < next)
+        {
+          ra->ra_end = next;
+        }
+
+      if (ra->ra_end - next < (off_t)(ra->ra_window >> 1))
+        {
+          readahead_request(ra, ra->ra_end,
+                            next + ra->ra_window - ra->ra_end);
+          ra->ra_end = next + ra->ra_window;
+
+          if (ra->ra_window < CONFIG_FS_READAHEAD_MAX)
+            {
+              ra->ra_window <<= 1;
+              if (ra->ra_window > CONFIG_FS_READAHEAD_MAX)
+                {
+                  ra->ra_window = CONFIG_FS_READAHEAD_MAX;
+                }
+            }
+        }
+    }
+
+  nxsem_post(&ra->ra_sem);
+}
+
+/****************************************************************************
+ * Name: file_readahead_advise
+ *
+ * Description:
+ *   Apply posix_fadvise() advice to the read-ahead state of a file.  See
+ *   fs/inode/inode.h.
+ *
+ ****************************************************************************/
+
+int file_readahead_advise(FAR struct file *filep, off_t offset, off_t len,
+                          int advice)
+{
+  FAR struct file_readahead_s *ra;
+  int ret = OK;
+
+  ra = readahead_get(filep);
+  if (ra == NULL)
+    {
+      return OK;
+    }
+
+  (void)nxsem_wait_uninterruptible(&ra->ra_sem);
+  switch (advice)
+    {
+      case POSIX_FADV_NORMAL:
+      case POSIX_FADV_RANDOM:
+        ra->ra_advice = advice;
+        ra->ra_window = CONFIG_FS_READAHEAD_MIN;
+        break;
+
+      case POSIX_FADV_SEQUENTIAL:
+        ra->ra_advice = advice;
+        ra->ra_window = CONFIG_FS_READAHEAD_MAX;
+        break;
+
+      case POSIX_FADV_WILLNEED:
+        readahead_request(ra, offset, len);
+        ret = ra->ra_pending ? 1 : OK;
+        break;
+
+      default:
+        break;
+    }
+
+  nxsem_post(&ra->ra_sem);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: file_readahead_release
+ *
+ * Description:
+ *   Cancel any pending read-ahead and free the read-ahead state of a file.
+ *   See fs/inode/inode.h.
+ *
+ ****************************************************************************/
+
+void file_readahead_release(FAR struct file *filep)
+{
+  FAR struct file_readahead_s *ra = filep->f_ra;
+  bool wait = false;
+
+  if (ra == NULL)
+    {
+      return;
+    }
+
+  filep->f_ra = NULL;
+
+  /* If the worker has not started yet, it never will.  Otherwise, wait
+   * for it to finish with the file.
+   */
+
+  if (work_cancel(LPWORK, &ra->ra_work) < 0)
+    {
+      (void)nxsem_wait_uninterruptible(&ra->ra_sem);
+      if (ra->ra_busy)
+        {
+          ra->ra_closing = true;
+          wait           = true;
+        }
+
+      nxsem_post(&ra->ra_sem);
+
+      if (wait)
+        {
+          (void)nxsem_wait_uninterruptible(&ra->ra_donesem);
+        }
+    }
+
+  nxsem_destroy(&ra->ra_sem);
+  nxsem_destroy(&ra->ra_donesem);
+  kmm_free(ra);
+}
+
+#endif /* CONFIG_FS_READAHEAD */
@@ -43,11 +43,12 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <signal.h>
+#include <semaphore.h>
 #include <time.h>
 
-#include <nuttx/wqueue.h>
-
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -58,22 +59,8 @@
 #  undef CONFIG_FS_AIO
 #endif
 
-/* Work queue support is required.  The low-priority work queue is required
- * so that the asynchronous I/O does not interfere with high priority driver
- * operations.  If this pre-requisite is met, then asynchronous I/O support
- * can be enabled with CONFIG_FS_AIO
- */
-
 #ifdef CONFIG_FS_AIO
 
-#ifndef CONFIG_SCHED_WORKQUEUE
-#  error Asynchronous I/O requires CONFIG_SCHED_WORKQUEUE
-#endif
-
-#ifndef CONFIG_SCHED_LPWORK
-#  error Asynchronous I/O requires CONFIG_SCHED_LPWORK
-#endif
-
 /* Standard Definitions *****************************************************/
 /* aio_cancel return values
  *
@@ -141,6 +128,42 @@ struct aiocb
   FAR void *aio_priv;            /* Used by signal handlers */
 };
 
+/* Non-standard submission/completion ring.
+ *
+ * The application places pointers to AIO control blocks in the submission
+ * queue, advancing ar_sqtail, and calls aio_ring_enter().  The aio_fildes,
+ * aio_buf, aio_nbytes, aio_offset and aio_lio_opcode fields of each control
+ * block describe the request as for lio_listio(); aio_sigevent is ignored.
+ * aio_ring_enter() submits all queued entries at once (as far as the
+ * completion queue has room for them) and advances ar_sqhead.
+ *
+ * The completion of each request is posted to the completion queue,
+ * advancing ar_cqtail, instead of sending a signal.  The application reaps
+ * the entries from ar_cqhead up to ar_cqtail and then advances ar_cqhead.
+ * Both queue sizes must be powers of two.
+ */
+
+struct aio_cqe_s
+{
+  FAR struct aiocb *cqe_aiocbp;  /* The completed AIO control block */
+  ssize_t cqe_result;            /* Its result, as from aio_return() */
+};
+
+struct aio_ring_s
+{
+  FAR struct aiocb **ar_sq;      /* Submission queue entries */
+  FAR struct aio_cqe_s *ar_cq;   /* Completion queue entries */
+  uint16_t ar_sqmask;            /* Submission queue size - 1 */
+  uint16_t ar_cqmask;            /* Completion queue size - 1 */
+  volatile uint16_t ar_sqhead;   /* Next entry to submit (kernel) */
+  volatile uint16_t ar_sqtail;   /* Next free entry (application) */
+  volatile uint16_t ar_cqhead;   /* Next entry to reap (application) */
+  volatile uint16_t ar_cqtail;   /* Next entry to post (kernel) */
+  volatile uint16_t ar_inflight; /* Submitted but not yet completed */
+  volatile bool ar_waiting;      /* aio_ring_enter() waits for completions */
+  sem_t ar_cqsem;                /* Posted for a waiting aio_ring_enter() */
+};
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -168,6 +191,14 @@ int aio_write(FAR struct aiocb *aiocbp);
 int lio_listio(int mode, FAR struct aiocb *const list[], int nent,
                FAR struct sigevent *sig);
 
+/* Non-standard submission/completion ring interfaces (flat build only) */
+
+#ifdef CONFIG_FS_AIO_RING
+int aio_ring_init(FAR struct aio_ring_s *ring, FAR struct aiocb **sq,
+                  int nsq, FAR struct aio_cqe_s *cq, int ncq);
+int aio_ring_enter(FAR struct aio_ring_s *ring, int min_complete);
+#endif
+
 #undef EXTERN
 #ifdef __cplusplus
 }
@@ -129,6 +129,15 @@
 #define DN_RENAME   4  /* A file was renamed */
 #define DN_ATTRIB   5  /* Attributes of a file were changed */
 
+/* Advice for posix_fadvise() */
+
+#define POSIX_FADV_NORMAL     0 /* No advice, the default */
+#define POSIX_FADV_RANDOM     1 /* Data will be accessed in random order */
+#define POSIX_FADV_SEQUENTIAL 2 /* Data will be accessed sequentially */
+#define POSIX_FADV_WILLNEED   3 /* Data will be accessed in the near future */
+#define POSIX_FADV_DONTNEED   4 /* Data will not be accessed in the near future */
+#define POSIX_FADV_NOREUSE    5 /* Data will be accessed only once */
+
 /* int creat(const char *path, mode_t mode);
  *
  * is equivalent to open with O_WRONLY|O_CREAT|O_TRUNC.
@@ -173,6 +182,9 @@ extern "C"
 int open(const char *path, int oflag, ...);
 int fcntl(int fd, int cmd, ...);
 
+int posix_fadvise(int fd, off_t offset, off_t len, int advice);
+ssize_t readahead(int fd, off_t offset, size_t count);
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
@@ -69,4 +69,14 @@
 #define TCP_KEEPCNT   (__SO_PROTOCOL + 3) /* Number of keepalives before death
                                            * Argument: max retry count */
 
+/* TCP protocol socket operations to select the congestion control
+ * algorithm:
+ */
+
+#define TCP_CONGESTION (__SO_PROTOCOL + 4) /* Congestion control algorithm
+                                            * Argument: name string, e.g.
+                                            * "newreno" or "cubic" */
+
+#define TCP_CA_NAME_MAX 16                 /* Max length of the name */
+
 #endif /* __INCLUDE_NETINET_TCP_H */
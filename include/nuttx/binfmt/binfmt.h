@@ -115,6 +115,9 @@ struct binary_s
 #endif
 
   size_t mapsize;                      /* Size of the mapped address region (needed for munmap) */
+#if defined(CONFIG_FS_RAMMAP) && defined(HAVE_TASK_GROUP)
+  bool reparented;                     /* The mapping belongs to the new task group */
+#endif
 
   /* Start-up information that is provided by the loader, but may be modified
    * by the caller between load_module() and exec_module() calls.
@@ -248,7 +251,7 @@ int unload_module(FAR struct binary_s *bin);
  *
  ****************************************************************************/
 
-int exec_module(FAR const struct binary_s *bin);
+int exec_module(FAR struct binary_s *bin);
 
 /****************************************************************************
  * Name: exec
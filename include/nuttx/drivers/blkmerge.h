@@ -0,0 +1,126 @@
+/****************************************************************************
+ * include/nuttx/drivers/blkmerge.h
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_DRIVERS_BLKMERGE_H
+#define __INCLUDE_NUTTX_DRIVERS_BLKMERGE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/compiler.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef CONFIG_DRVR_BLKMERGE
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* A run of consecutive blocks staged in memory for a single multiple block
+ * transfer.  The block driver provides the data buffer, which must hold
+ * the maximum number of blocks that it passes to blkmerge_add().
+ */
+
+struct blk_run_s
+{
+  FAR uint8_t *data;             /* Staged data */
+  off_t        startblock;       /* First block held in the run */
+  size_t       nblocks;          /* Number of blocks held (0 = empty) */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: blkmerge_overlaps
+ *
+ * Description:
+ *   Return true if the run holds any block in the range startblock through
+ *   startblock + nblocks - 1.
+ *
+ ****************************************************************************/
+
+bool blkmerge_overlaps(FAR const struct blk_run_s *run, off_t startblock,
+                       size_t nblocks);
+
+/****************************************************************************
+ * Name: blkmerge_add
+ *
+ * Description:
+ *   Elevator merge of a write request into a run.  The new blocks are
+ *   accepted if the run is empty or if they are adjacent to (back or front
+ *   merge) or overlap the blocks already in the run, and the combined
+ *   range still fits in maxblocks.  Newer data replaces older data where
+ *   the ranges overlap.
+ *
+ * Input Parameters:
+ *   run        - The run to merge into
+ *   blocksize  - The size of one block in bytes
+ *   maxblocks  - The capacity of the run's data buffer in blocks
+ *   startblock - The first block of the request
+ *   nblocks    - The number of blocks in the request
+ *   src        - The data of the request
+ *
+ * Returned Value:
+ *   true if the request was merged into the run; false if the run was not
+ *   modified.
+ *
+ ****************************************************************************/
+
+bool blkmerge_add(FAR struct blk_run_s *run, size_t blocksize,
+                  size_t maxblocks, off_t startblock, size_t nblocks,
+                  FAR const uint8_t *src);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_DRVR_BLKMERGE */
+#endif /* __INCLUDE_NUTTX_DRIVERS_BLKMERGE_H */
@@ -0,0 +1,97 @@
+/****************************************************************************
+ * include/nuttx/drivers/cowdisk.h
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_DRIVERS_COWDISK_H
+#define __INCLUDE_NUTTX_DRIVERS_COWDISK_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#ifdef CONFIG_COWDISK
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: cowdisk_register
+ *
+ * Description:
+ *   Register a copy-on-write block device, /dev/cowN, on top of an existing
+ *   block driver (a RAM disk, a loop device, an MMC/SD card, ...).  The
+ *   underlying device is only read.  Sectors written to /dev/cowN are kept
+ *   in memory; only the sectors that have been written use memory.
+ *
+ *   The device also supports these ioctl commands:
+ *
+ *     BIOC_SNAPSHOT - Take a snapshot.  Returns the snapshot number.
+ *     BIOC_ROLLBACK - Discard every change made since the given snapshot
+ *                     (0: since registration).  The time needed depends
+ *                     only on the number of sectors discarded.
+ *     BIOC_DISCARD  - Release the memory of sectors written since the
+ *                     last snapshot.  They then read as they did before.
+ *
+ *   A file system mounted on the device must be unmounted before a
+ *   rollback.
+ *
+ * Input Parameters:
+ *   minor:         Selects suffix of device named /dev/cowN, N={0,1,2,...}
+ *   basedev:       Path to the underlying block driver
+ *
+ * Returned Value:
+ *   Zero on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int cowdisk_register(int minor, FAR const char *basedev);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_COWDISK */
+#endif /* __INCLUDE_NUTTX_DRIVERS_COWDISK_H */
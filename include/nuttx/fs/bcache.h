@@ -0,0 +1,253 @@
+/****************************************************************************
+ * include/nuttx/fs/bcache.h
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __INCLUDE_NUTTX_FS_BCACHE_H
+#define __INCLUDE_NUTTX_FS_BCACHE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#ifdef CONFIG_FS_BCACHE
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* These are the operations used by the block buffer cache to access the
+ * underlying device.  Each returns the number of sectors transferred or a
+ * negated errno value on failure.  The write method may be NULL for
+ * read-only devices.
+ */
+
+struct bcache_ops_s
+{
+  CODE ssize_t (*read)(FAR void *priv, FAR uint8_t *buffer, off_t sector,
+                       unsigned int nsectors);
+  CODE ssize_t (*write)(FAR void *priv, FAR const uint8_t *buffer,
+                        off_t sector, unsigned int nsectors);
+};
+
+/* This is the opaque handle that represents one device attached to the
+ * block buffer cache.
+ */
+
+struct bcache_dev_s;
+struct inode;
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: bcache_initialize
+ *
+ * Description:
+ *   Initialize the block buffer cache.  This is called once from
+ *   fs_initialize().  The cache memory and the write-back thread are not
+ *   created until the first device is attached.
+ *
+ ****************************************************************************/
+
+void bcache_initialize(void);
+
+/****************************************************************************
+ * Name: bcache_attach and bcache_attach_ops
+ *
+ * Description:
+ *   Attach a device to the block buffer cache.  bcache_attach() attaches a
+ *   block driver and accesses it through its block_operations.
+ *   bcache_attach_ops() attaches any device that is accessed through the
+ *   provided operations.  Attaching the same device more than once returns
+ *   the same, reference counted handle.
+ *
+ * Input Parameters:
+ *   blkdriver - The block driver inode
+ *   ops       - Operations used to access the device
+ *   priv      - Opaque device reference passed to each operation
+ *   sectsize  - The size of one sector in bytes
+ *
+ * Returned Value:
+ *   The device handle on success.  NULL is returned if the sector size is
+ *   larger than CONFIG_FS_BCACHE_BLOCKSIZE or if memory could not be
+ *   allocated.  In that case, the caller must access the device directly.
+ *
+ ****************************************************************************/
+
+FAR struct bcache_dev_s *bcache_attach(FAR struct inode *blkdriver,
+                                       uint16_t sectsize);
+FAR struct bcache_dev_s *bcache_attach_ops(FAR const struct bcache_ops_s *ops,
+                                           FAR void *priv,
+                                           uint16_t sectsize);
+
+/****************************************************************************
+ * Name: bcache_detach
+ *
+ * Description:
+ *   Release one reference to a device.  When the last reference is
+ *   released, all dirty sectors are written back and all cached sectors of
+ *   the device are discarded.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; the negated errno value of any failed write-back.
+ *
+ ****************************************************************************/
+
+int bcache_detach(FAR struct bcache_dev_s *dev);
+
+/****************************************************************************
+ * Name: bcache_read
+ *
+ * Description:
+ *   Read sectors through the cache.  Requests of CONFIG_FS_BCACHE_BYPASS
+ *   sectors or more are passed directly to the device after any dirty
+ *   sectors in the range have been written back.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int bcache_read(FAR struct bcache_dev_s *dev, FAR uint8_t *buffer,
+                off_t sector, unsigned int nsectors);
+
+/****************************************************************************
+ * Name: bcache_write
+ *
+ * Description:
+ *   Write sectors through the cache.  The sectors are marked dirty and are
+ *   written back by the write-back thread after CONFIG_FS_BCACHE_WRDELAY
+ *   milliseconds, when the cache runs short of clean sectors, or when
+ *   bcache_flush() is called.  Requests of CONFIG_FS_BCACHE_BYPASS sectors
+ *   or more are written directly to the device.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int bcache_write(FAR struct bcache_dev_s *dev, FAR const uint8_t *buffer,
+                 off_t sector, unsigned int nsectors);
+
+/****************************************************************************
+ * Name: bcache_readbytes
+ *
+ * Description:
+ *   Read part of one sector through the cache.  The whole sector is read
+ *   into the cache if it is not already cached.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int bcache_readbytes(FAR struct bcache_dev_s *dev, off_t sector,
+                     unsigned int offset, FAR uint8_t *buffer, size_t len);
+
+/****************************************************************************
+ * Name: bcache_update
+ *
+ * Description:
+ *   Update part of a cached sector after the caller has written the same
+ *   data directly to the device.  Nothing is done if the sector is not
+ *   cached.  This supports devices that are written in partial sectors.
+ *
+ ****************************************************************************/
+
+void bcache_update(FAR struct bcache_dev_s *dev, off_t sector,
+                   unsigned int offset, FAR const uint8_t *buffer,
+                   size_t len);
+
+/****************************************************************************
+ * Name: bcache_flush
+ *
+ * Description:
+ *   Write back all dirty sectors of the device.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value if this or any earlier
+ *   background write-back failed.
+ *
+ ****************************************************************************/
+
+int bcache_flush(FAR struct bcache_dev_s *dev);
+
+/****************************************************************************
+ * Name: bcache_invalidate
+ *
+ * Description:
+ *   Discard the cached copies of a range of sectors, including any dirty
+ *   sectors.  Use nsectors == UINT_MAX to discard everything cached for the
+ *   device (for example, after a media change).
+ *
+ ****************************************************************************/
+
+void bcache_invalidate(FAR struct bcache_dev_s *dev, off_t sector,
+                       unsigned int nsectors);
+
+/****************************************************************************
+ * Name: bcache_readahead
+ *
+ * Description:
+ *   Hint that a range of sectors will be read soon.  The write-back thread
+ *   reads any of the sectors that are not already cached, up to
+ *   CONFIG_FS_BCACHE_READAHEAD sectors.  Only one hint is retained per
+ *   device; a new hint replaces the previous one.
+ *
+ ****************************************************************************/
+
+void bcache_readahead(FAR struct bcache_dev_s *dev, off_t sector,
+                      unsigned int nsectors);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_FS_BCACHE */
+#endif /* __INCLUDE_NUTTX_FS_BCACHE_H */
@@ -50,9 +50,7 @@
 #include <stdbool.h>
 #include <semaphore.h>
 
-#ifdef CONFIG_FS_NAMED_SEMAPHORES
-#  include <nuttx/semaphore.h>
-#endif
+#include <nuttx/semaphore.h>
 
 #ifndef CONFIG_DISABLE_MQUEUE
 #  include <nuttx/mqueue.h>
@@ -260,6 +258,24 @@ struct geometry
   size_t geo_sectorsize;   /* Size of one sector */
 };
 
+/* This structure is provided with the BIOC_DISCARD ioctl command */
+
+struct blkdiscard_s
+{
+  size_t bd_startsector;   /* First sector whose contents may be discarded */
+  size_t bd_nsectors;      /* Number of sectors */
+};
+
+/* This structure is returned by the FIOC_GCSTATUS ioctl command */
+
+struct fs_gcstatus_s
+{
+  bool     gc_active;      /* true: Background collection is pending */
+  uint32_t gc_steps;       /* Number of collection steps completed */
+  off_t    gc_free;        /* Bytes that can be written without collection */
+  off_t    gc_dirty;       /* Bytes of deleted data not yet reclaimed */
+};
+
 /* This structure is provided by block devices when they register with the
  * system.  It is used by file systems to perform filesystem transfers.  It
  * differs from the normal driver vtable in several ways -- most notably in
@@ -353,6 +369,14 @@ struct mountpt_operations
   int     (*stat)(FAR struct inode *mountpt, FAR const char *relpath,
             FAR struct stat *buf);
 
+  /* Advice about the future use of file data (see posix_fadvise()).  With
+   * POSIX_FADV_WILLNEED, this may be called from a worker thread to read
+   * ahead.  It must not change the file position.
+   */
+
+  int     (*fadvise)(FAR struct file *filep, off_t offset, off_t len,
+            int advice);
+
   /* NOTE:  More operations will be needed here to support:  disk usage
    * stats file stat(), file attributes, file truncation, etc.
    */
@@ -417,12 +441,19 @@ struct inode
  * the file descriptor to the file state and to a set of inode operations.
  */
 
+#ifdef CONFIG_FS_READAHEAD
+struct file_readahead_s;
+#endif
+
 struct file
 {
   int               f_oflags;   /* Open mode flags */
   off_t             f_pos;      /* File position */
   FAR struct inode *f_inode;    /* Driver or file system interface */
   void             *f_priv;     /* Per file driver private data */
+#ifdef CONFIG_FS_READAHEAD
+  FAR struct file_readahead_s *f_ra; /* Read-ahead state (may be NULL) */
+#endif
 };
 
 /* This defines a list of files indexed by the file descriptor */
@@ -430,7 +461,7 @@ struct file
 #if CONFIG_NFILE_DESCRIPTORS > 0
 struct filelist
 {
-  sem_t   fl_sem;               /* Manage access to the file list */
+  rwsem_t fl_sem;               /* Manage access to the file list */
   struct file fl_files[CONFIG_NFILE_DESCRIPTORS];
 };
 #endif
@@ -721,6 +752,34 @@ void files_initlist(FAR struct filelist *list);
 void files_releaselist(FAR struct filelist *list);
 #endif
 
+/****************************************************************************
+ * Name: rammap_release
+ *
+ * Description:
+ *   Remove all file mappings that belong to an exiting task group.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_RAMMAP
+struct task_group_s; /* Forward reference */
+void rammap_release(FAR struct task_group_s *group);
+#endif
+
+/****************************************************************************
+ * Name: rammap_reparent
+ *
+ * Description:
+ *   Transfer a file mapping made by the calling task to another task group.
+ *   Used by program loaders to tie the mapped program image to the program
+ *   rather than to the task that loaded it.  Returns -ENOENT if the calling
+ *   task group holds no mapping at addr.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FS_RAMMAP
+int rammap_reparent(FAR void *addr, FAR struct task_group_s *group);
+#endif
+
 /****************************************************************************
  * Name: file_dup2
  *
@@ -1207,6 +1266,21 @@ int file_fsync(FAR struct file *filep);
 int file_truncate(FAR struct file *filep, off_t length);
 #endif
 
+/****************************************************************************
+ * Name: file_fadvise
+ *
+ * Description:
+ *   Equivalent to the standard posix_fadvise() function except that is
+ *   accepts a struct file instance instead of a file descriptor and it
+ *   returns a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+#if CONFIG_NFILE_DESCRIPTORS > 0 && !defined(CONFIG_DISABLE_MOUNTPOINT)
+int file_fadvise(FAR struct file *filep, off_t offset, off_t len,
+                 int advice);
+#endif
+
 /****************************************************************************
  * Name: file_ioctl
  *
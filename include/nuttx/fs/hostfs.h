@@ -89,6 +89,15 @@
 
 #define NUTTX_O_RDWR     (NUTTX_O_RDONLY | NUTTX_O_WRONLY)
 
+/* These must exactly match the definitions from include/fcntl.h: */
+
+#define NUTTX_POSIX_FADV_NORMAL     0
+#define NUTTX_POSIX_FADV_RANDOM     1
+#define NUTTX_POSIX_FADV_SEQUENTIAL 2
+#define NUTTX_POSIX_FADV_WILLNEED   3
+#define NUTTX_POSIX_FADV_DONTNEED   4
+#define NUTTX_POSIX_FADV_NOREUSE    5
+
 /* Should match definition in include/limits.h */
 
 #define NUTTX_NAME_MAX   32
@@ -165,6 +174,7 @@ void          host_sync(int fd);
 int           host_dup(int fd);
 int           host_fstat(int fd, struct nuttx_stat_s *buf);
 int           host_ftruncate(int fd, off_t length);
+int           host_fadvise(int fd, off_t offset, off_t len, int advice);
 void         *host_opendir(const char *name);
 int           host_readdir(void* dirp, struct nuttx_dirent_s* entry);
 void          host_rewinddir(void* dirp);
@@ -186,6 +196,7 @@ void          host_sync(int fd);
 int           host_dup(int fd);
 int           host_fstat(int fd, struct stat *buf);
 int           host_ftruncate(int fd, off_t length);
+int           host_fadvise(int fd, off_t offset, off_t len, int advice);
 void         *host_opendir(const char *name);
 int           host_readdir(void* dirp, struct dirent *entry);
 void          host_rewinddir(void* dirp);
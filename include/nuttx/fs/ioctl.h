@@ -167,6 +167,23 @@
                                            * OUT: Instance number is returned on
                                            *      success.
                                            */
+#define FIOC_FILEID     _FIOC(0x000b)     /* IN:  Location to return the ID
+                                           *      (uint32_t *)
+                                           * OUT: A value that identifies the
+                                           *      file uniquely within the
+                                           *      mounted volume
+                                           */
+#define FIOC_GCSTEP     _FIOC(0x000c)     /* Run one bounded step of garbage
+                                           *      collection.
+                                           * IN:  None
+                                           * OUT: None.  -ENODATA if there
+                                           *      was nothing to collect
+                                           */
+#define FIOC_GCSTATUS   _FIOC(0x000d)     /* IN:  Pointer to a struct
+                                           *      fs_gcstatus_s
+                                           * OUT: The state of garbage
+                                           *      collection on the volume
+                                           */
 
 /* NuttX file system ioctl definitions **************************************/
 
@@ -261,6 +278,24 @@
                                            * IN:  None
                                            * OUT: None (ioctl return value provides
                                            *      success/failure indication). */
+#define BIOC_DISCARD    _BIOC(0x000e)     /* The contents of a range of sectors
+                                           * are no longer needed
+                                           * IN:  Pointer to a read-only instance
+                                           *      of struct blkdiscard_s
+                                           * OUT: None (ioctl return value provides
+                                           *      success/failure indication). */
+#define BIOC_SNAPSHOT   _BIOC(0x000f)     /* Take a snapshot of the contents of a
+                                           * copy-on-write block device
+                                           * IN:  None
+                                           * OUT: The snapshot number (>0) is
+                                           *      the ioctl return value. */
+#define BIOC_ROLLBACK   _BIOC(0x0010)     /* Discard all changes made to a copy-
+                                           * on-write block device since a
+                                           * snapshot was taken.
+                                           * IN:  The snapshot number (0 = return
+                                           *      to the underlying device)
+                                           * OUT: None (ioctl return value provides
+                                           *      success/failure indication). */
 
 /* NuttX MTD driver ioctl definitions ***************************************/
 
@@ -84,10 +84,31 @@
 #  error CONFIG_IOB_NBUFFERS <= CONFIG_IOB_THROTTLE
 #endif
 
+/* Small I/O buffers are an optional second size class.  They hold at most
+ * CONFIG_IOB_SMALL_BUFSIZE bytes and are only returned by
+ * iob_tryalloc_size().
+ */
+
+#ifdef CONFIG_IOB_SMALL
+#  if !defined(CONFIG_IOB_SMALL_NBUFFERS) || CONFIG_IOB_SMALL_NBUFFERS < 1
+#    error CONFIG_IOB_SMALL_NBUFFERS must be greater than zero
+#  endif
+#  if !defined(CONFIG_IOB_SMALL_BUFSIZE) || \
+      CONFIG_IOB_SMALL_BUFSIZE >= CONFIG_IOB_BUFSIZE
+#    error CONFIG_IOB_SMALL_BUFSIZE must be less than CONFIG_IOB_BUFSIZE
+#  endif
+#endif
+
 /* IOB helpers */
 
+#ifdef CONFIG_IOB_SMALL
+#  define IOB_BUFSIZE(p) ((p)->io_bufsize)
+#else
+#  define IOB_BUFSIZE(p) CONFIG_IOB_BUFSIZE
+#endif
+
 #define IOB_DATA(p)      (&(p)->io_data[(p)->io_offset])
-#define IOB_FREESPACE(p) (CONFIG_IOB_BUFSIZE - (p)->io_len - (p)->io_offset)
+#define IOB_FREESPACE(p) (IOB_BUFSIZE(p) - (p)->io_len - (p)->io_offset)
 
 #if CONFIG_IOB_NCHAINS > 0
 /* Queue helpers */
@@ -116,9 +137,15 @@ struct iob_s
 #if CONFIG_IOB_BUFSIZE < 256
   uint8_t  io_len;      /* Length of the data in the entry */
   uint8_t  io_offset;   /* Data begins at this offset */
+#ifdef CONFIG_IOB_SMALL
+  uint8_t  io_bufsize;  /* Size of io_data[] for this buffer */
+#endif
 #else
   uint16_t io_len;      /* Length of the data in the entry */
   uint16_t io_offset;   /* Data begins at this offset */
+#ifdef CONFIG_IOB_SMALL
+  uint16_t io_bufsize;  /* Size of io_data[] for this buffer */
+#endif
 #endif
   uint16_t io_pktlen;   /* Total length of the packet */
 
@@ -152,6 +179,31 @@ struct iob_queue_s
 };
 #endif /* CONFIG_IOB_NCHAINS > 0 */
 
+#ifdef CONFIG_IOB_STATISTICS
+/* This structure is returned by iob_info() and describes the current state
+ * of the I/O buffer pool.
+ */
+
+struct iobinfo_s
+{
+  uint16_t ntotal;      /* Total number of full-size I/O buffers */
+  uint16_t nfree;       /* Number of buffers in the global free list */
+  uint16_t ncached;     /* Number of free buffers held in per-CPU caches */
+  uint16_t nminfree;    /* Fewest buffers ever seen in the free list */
+  uint16_t nwaiting;    /* Number of threads waiting for a buffer */
+  uint16_t nchunks;     /* Number of chunks allocated from the heap */
+  uint16_t nsmall;      /* Total number of small I/O buffers */
+  uint16_t nsmallfree;  /* Number of free small I/O buffers */
+  uint32_t nalloc;      /* Number of successful allocations */
+  uint32_t nfailed;     /* Number of times no free buffer was found */
+  uint32_t nwaits;      /* Number of allocations that had to wait */
+  uint32_t waittime;    /* Total time spent waiting (milliseconds) */
+  uint32_t maxwait;     /* Longest single wait (milliseconds) */
+  uint32_t ngrow;       /* Number of times the pool was grown */
+  uint32_t nshrink;     /* Number of times the pool was shrunk */
+};
+#endif
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -187,6 +239,20 @@ FAR struct iob_s *iob_alloc(bool throttled);
 
 FAR struct iob_s *iob_tryalloc(bool throttled);
 
+/****************************************************************************
+ * Name: iob_tryalloc_size
+ *
+ * Description:
+ *   Try to allocate an I/O buffer that will be used to hold 'len' bytes of
+ *   data without waiting for a buffer to become free.  If CONFIG_IOB_SMALL
+ *   is selected and 'len' fits, then a small I/O buffer is returned when one
+ *   is available.  Otherwise, this is equivalent to iob_tryalloc().  Small
+ *   buffers come from a separate pool and are not subject to throttling.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_tryalloc_size(bool throttled, unsigned int len);
+
 /****************************************************************************
  * Name: iob_navail
  *
@@ -218,6 +284,19 @@ int iob_qentry_navail(void);
 
 FAR struct iob_s *iob_free(FAR struct iob_s *iob);
 
+/****************************************************************************
+ * Name: iob_info
+ *
+ * Description:
+ *   Return a snapshot of the I/O buffer pool occupancy and usage
+ *   statistics.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_IOB_STATISTICS
+void iob_info(FAR struct iobinfo_s *info);
+#endif
+
 /****************************************************************************
  * Name: iob_notifier_setup
  *
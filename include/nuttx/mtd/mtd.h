@@ -100,6 +100,21 @@
 #  define CONFIG_MTD_SUBSECTOR_ERASE 1
 #endif
 
+/* Operations in a batch of MTD requests (see struct mtd_request_s) */
+
+#define MTD_REQ_READ      0       /* Read blocks, like bread() */
+#define MTD_REQ_WRITE     1       /* Write blocks, like bwrite() */
+#define MTD_REQ_ERASE     2       /* Erase erase blocks, like erase() */
+
+/* Submit a batch of requests.  Devices without the submit() method execute
+ * the batch synchronously.
+ */
+
+#ifdef CONFIG_MTD_BATCH
+#  define MTD_SUBMIT(d,b) \
+     ((d)->submit ? (d)->submit(d,b) : mtd_batch_execute(d,b))
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -141,6 +156,45 @@ struct mtd_byte_write_s
   const uint8_t *buffer;  /* Pointer to the data to write */
 };
 
+#ifdef CONFIG_MTD_BATCH
+/* One operation in a batch of MTD requests.  The startblock and nblocks are
+ * in units of read/write blocks for MTD_REQ_READ and MTD_REQ_WRITE and in
+ * units of erase blocks for MTD_REQ_ERASE, just as for the corresponding
+ * MTD methods.
+ */
+
+struct mtd_request_s
+{
+  uint8_t op;             /* One of MTD_REQ_* */
+  off_t  startblock;      /* First block */
+  size_t nblocks;         /* Number of blocks */
+  FAR uint8_t *buffer;    /* Data buffer (unused for MTD_REQ_ERASE) */
+};
+
+/* A batch of MTD requests.  The requests are performed in order.  The batch
+ * belongs to the MTD driver from the time that it is submitted until the
+ * callback is called; the caller must not touch the blocks of a pending
+ * batch with other MTD operations.
+ *
+ * The callback may be called before submit() returns or later from a
+ * worker thread.  It must not block for a long time.
+ */
+
+struct mtd_batch_s;
+typedef CODE void (*mtd_batchcb_t)(FAR struct mtd_batch_s *batch);
+
+struct mtd_batch_s
+{
+  FAR struct mtd_request_s *reqs; /* The requests */
+  int nreqs;              /* Number of requests */
+  int ndone;              /* Returned: Number of completed requests */
+  int result;             /* Returned: OK or negated errno of failing request */
+  mtd_batchcb_t callback; /* Called on completion (may be NULL) */
+  FAR void *arg;          /* Argument for use by the callback */
+  FAR struct mtd_batch_s *flink; /* For use by the MTD driver */
+};
+#endif
+
 /* This structure defines the interface to a simple memory technology device.
  * It will likely need to be extended in the future to support more complex
  * devices.
@@ -191,6 +245,16 @@ struct mtd_dev_s
   /* Name of this MTD device */
 
   FAR const char *name;
+
+#ifdef CONFIG_MTD_BATCH
+  /* Start a batch of read, write and erase requests (optional).  The
+   * batch->callback is called when all requests have completed or one of
+   * them has failed.  A negated errno value is returned if the batch could
+   * not be started; the callback is not called in that case.
+   */
+
+  int (*submit)(FAR struct mtd_dev_s *dev, FAR struct mtd_batch_s *batch);
+#endif
 };
 
 /****************************************************************************
@@ -255,6 +319,48 @@ FAR struct mtd_dev_s *mtd_partition(FAR struct mtd_dev_s *mtd,
 int mtd_setpartitionname(FAR struct mtd_dev_s *mtd, FAR const char *name);
 #endif
 
+/****************************************************************************
+ * Name: mtd_batch_execute
+ *
+ * Description:
+ *   Perform a batch of MTD requests synchronously using the erase(),
+ *   bread() and bwrite() methods of the MTD device, then call the batch
+ *   callback.  This is used for MTD devices without a submit() method and
+ *   may be used as the submit() method of devices that cannot do better.
+ *
+ * Input Parameters:
+ *   dev   - The MTD device
+ *   batch - The batch of requests
+ *
+ * Returned Value:
+ *   Always zero (OK).  The result of the requests is returned in
+ *   batch->result.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_MTD_BATCH
+int mtd_batch_execute(FAR struct mtd_dev_s *dev, FAR struct mtd_batch_s *batch);
+
+/****************************************************************************
+ * Name: mtd_batch_wait
+ *
+ * Description:
+ *   Submit a batch of MTD requests and wait for it to complete.  This
+ *   replaces the batch callback.
+ *
+ * Input Parameters:
+ *   dev   - The MTD device
+ *   batch - The batch of requests
+ *
+ * Returned Value:
+ *   Zero (OK) if all requests were performed; a negated errno value
+ *   otherwise.
+ *
+ ****************************************************************************/
+
+int mtd_batch_wait(FAR struct mtd_dev_s *dev, FAR struct mtd_batch_s *batch);
+#endif
+
 /************************************************************************************
  * Name: mtd_rwb_initialize
  *
@@ -141,6 +141,17 @@
 #define NET_LL_HDRLEN(d)       ((d)->d_llhdrlen)
 #define NETDEV_PKTSIZE(d)      ((d)->d_pktsize)
 
+/* The largest packet that may be held in the device packet buffer.  This is
+ * larger than the MTU if the device supports TCP super-segments.
+ */
+
+#if defined(CONFIG_NET_TCP_GSO) || defined(CONFIG_NET_TCP_GRO)
+#  define NETDEV_BUFSIZE(d)    ((d)->d_gsosize > (d)->d_pktsize ? \
+                                (d)->d_gsosize : (d)->d_pktsize)
+#else
+#  define NETDEV_BUFSIZE(d)    NETDEV_PKTSIZE(d)
+#endif
+
 #ifdef CONFIG_NET_ETHERNET
 #  define _MIN_ETH_PKTSIZE     CONFIG_NET_ETH_PKTSIZE
 #  define _MAX_ETH_PKTSIZE     CONFIG_NET_ETH_PKTSIZE
@@ -254,6 +254,14 @@ struct net_driver_s
 #endif
 
   uint16_t d_pktsize;           /* Maximum packet size */
+#if defined(CONFIG_NET_TCP_GSO) || defined(CONFIG_NET_TCP_GRO)
+  uint16_t d_gsosize;           /* Size of d_buf for TCP super-segments.
+                                 * Zero if not supported by the driver. */
+#endif
+#ifdef CONFIG_NET_TCP_GSO
+  uint16_t d_gsomss;            /* Non-zero: d_buf holds a TCP super-segment
+                                 * to be sent as segments of this size */
+#endif
 
   /* Link layer address */
 
@@ -480,6 +488,51 @@ int ipv4_input(FAR struct net_driver_s *dev);
 int ipv6_input(FAR struct net_driver_s *dev);
 #endif
 
+/****************************************************************************
+ * Name: tcp_gro_merge
+ *
+ * Description:
+ *   Software TCP receive coalescing.  d_buf holds a received frame of
+ *   d_len bytes that has not yet been passed to ipv4_input().  If 'frame'
+ *   is the next, in-order TCP data segment of the same flow, then its
+ *   payload is appended to the packet in d_buf so that both are processed
+ *   by a single pass through the network.  Otherwise, the driver must
+ *   process the packet in d_buf first and then move 'frame' into d_buf.
+ *
+ *     while ((len = devicedriver_poll(frame)) > 0)
+ *       {
+ *         if (tcp_gro_merge(dev, frame, len) < 0)
+ *           {
+ *             ipv4_input(dev);
+ *             ...
+ *             memcpy(dev->d_buf, frame, len);
+ *             dev->d_len = len;
+ *           }
+ *       }
+ *
+ *   Only IPv4 segments addressed to this device, without IP or TCP
+ *   options, and carrying only the ACK (and PSH) flags are merged.  The
+ *   merged packet never exceeds d_gsosize bytes.
+ *
+ * Input Parameters:
+ *   dev      - The device with a received frame in d_buf
+ *   frame    - The next received frame, including the link layer header
+ *   framelen - The length of the frame
+ *
+ * Returned Value:
+ *   Zero (OK) if the frame was merged into d_buf; a negated errno value if
+ *   it could not be merged.
+ *
+ * Assumptions:
+ *   d_gsosize is non-zero and d_buf is at least that large.
+ *
+ ****************************************************************************/
+
+#if defined(CONFIG_NET_TCP_GRO) && defined(CONFIG_NET_IPv4)
+int tcp_gro_merge(FAR struct net_driver_s *dev, FAR const uint8_t *frame,
+                  uint16_t framelen);
+#endif
+
 #ifdef CONFIG_NET_6LOWPAN
 struct radio_driver_s;   /* Forward reference.  See radiodev.h */
 struct iob_s;            /* Forward reference See iob.h */
@@ -544,6 +597,34 @@ int sixlowpan_input(FAR struct radio_driver_s *ieee,
 int devif_poll(FAR struct net_driver_s *dev, devif_poll_callback_t callback);
 int devif_timer(FAR struct net_driver_s *dev, devif_poll_callback_t callback);
 
+/****************************************************************************
+ * Name: tcp_gso_segment
+ *
+ * Description:
+ *   Software TCP segmentation.  If the driver sets d_gsosize, then the TCP
+ *   layer may place a super-segment of up to d_gsosize bytes in d_buf and
+ *   set d_gsomss to the segment size that must be used on the wire.  A
+ *   driver without hardware segmentation support calls this function in
+ *   place of its transmit logic (after arp_out()).  The super-segment is
+ *   split, in place, into normal segments and 'output' is called for each
+ *   one with d_buf and d_len describing that segment.
+ *
+ *   If d_gsomss is zero, then 'output' is simply called once.
+ *
+ * Input Parameters:
+ *   dev    - The device with an outgoing packet in d_buf
+ *   output - The driver function that transmits d_buf/d_len
+ *
+ * Returned Value:
+ *   The return value of the last call to 'output'.
+ *
+ ****************************************************************************/
+
+#if defined(CONFIG_NET_TCP_GSO) && defined(CONFIG_NET_IPv4)
+int tcp_gso_segment(FAR struct net_driver_s *dev,
+                    devif_poll_callback_t output);
+#endif
+
 /****************************************************************************
  * Name: neighbor_out
  *
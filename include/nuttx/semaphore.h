@@ -42,6 +42,8 @@
 
 #include <nuttx/config.h>
 
+#include <sys/types.h>
+#include <stdbool.h>
 #include <errno.h>
 #include <semaphore.h>
 
@@ -104,6 +106,21 @@
  * Public Type Definitions
  ****************************************************************************/
 
+/* This is a reader/writer semaphore.  See nxrwsem_init(). */
+
+struct rwsem_s
+{
+  sem_t   rw_wrsem;      /* Held by the writer; waited on behind a writer */
+  sem_t   rw_rdwait;     /* Posted when the last reader leaves */
+  pid_t   rw_holder;     /* The current writer (or -1) */
+  int16_t rw_wrcount;    /* Number of recursive write counts held */
+  int16_t rw_readers;    /* Number of readers holding the semaphore */
+  bool    rw_writing;    /* A writer holds or is acquiring the semaphore */
+  bool    rw_wrwait;     /* A writer is waiting for readers to leave */
+};
+
+typedef struct rwsem_s rwsem_t;
+
 #ifdef CONFIG_FS_NAMED_SEMAPHORES
 /* This is the named semaphore inode */
 
@@ -523,6 +540,58 @@ int nxsem_setprotocol(FAR sem_t *sem, int protocol);
 
 int sem_setprotocol(FAR sem_t *sem, int protocol);
 
+/****************************************************************************
+ * Name: nxrwsem_init, nxrwsem_destroy
+ *
+ * Description:
+ *   Initialize or destroy a reader/writer semaphore.  Any number of readers
+ *   may hold the semaphore at the same time; a writer holds it exclusively.
+ *   A reader or writer that blocks behind a writer boosts the priority of
+ *   that writer (if priority inheritance is enabled).
+ *
+ * Returned Value:
+ *   This is an internal OS interface and should not be used by applications.
+ *   It follows the NuttX internal error return policy:  Zero (OK) is
+ *   returned on success.  A negated errno value is returned on failure.
+ *
+ ****************************************************************************/
+
+int nxrwsem_init(FAR rwsem_t *rwsem);
+int nxrwsem_destroy(FAR rwsem_t *rwsem);
+
+/****************************************************************************
+ * Name: nxrwsem_rdlock, nxrwsem_rdunlock
+ *
+ * Description:
+ *   Take or release shared (read) access to a reader/writer semaphore.
+ *   Read access is not recursive, but may be nested within write access
+ *   held by the same thread.
+ *
+ * Returned Value:
+ *   nxrwsem_rdlock() returns zero (OK) on success or a negated errno value
+ *   on failure.
+ *
+ ****************************************************************************/
+
+int nxrwsem_rdlock(FAR rwsem_t *rwsem);
+void nxrwsem_rdunlock(FAR rwsem_t *rwsem);
+
+/****************************************************************************
+ * Name: nxrwsem_wrlock, nxrwsem_wrunlock
+ *
+ * Description:
+ *   Take or release exclusive (write) access to a reader/writer semaphore.
+ *   Write access is recursive.
+ *
+ * Returned Value:
+ *   nxrwsem_wrlock() returns zero (OK) on success or a negated errno value
+ *   on failure.
+ *
+ ****************************************************************************/
+
+int nxrwsem_wrlock(FAR rwsem_t *rwsem);
+void nxrwsem_wrunlock(FAR rwsem_t *rwsem);
+
 /****************************************************************************
  * Name: nxsem_wait_uninterruptible
  *
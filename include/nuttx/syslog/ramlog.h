@@ -101,10 +101,12 @@
 #endif
 
 /* When used as a console or syslogging device, the RAM log will pre-pend
- * line-feeds with carriage returns.
+ * line-feeds with carriage returns.  Binary SYSLOG records must not be
+ * modified, however.
  */
 
-#if defined(CONFIG_RAMLOG_CONSOLE) || defined(CONFIG_RAMLOG_SYSLOG)
+#if (defined(CONFIG_RAMLOG_CONSOLE) || defined(CONFIG_RAMLOG_SYSLOG)) && \
+    !defined(CONFIG_SYSLOG_BINARY)
 #  undef CONFIG_RAMLOG_CRLF
 #  define CONFIG_RAMLOG_CRLF 1
 #endif
@@ -0,0 +1,109 @@
+/****************************************************************************
+ * include/nuttx/syslog/syslog_binary.h
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/* Binary SYSLOG records.  When CONFIG_SYSLOG_BINARY is selected, syslog()
+ * output is not formatted on the target.  Instead, each message is emitted
+ * as a compact binary record containing the address of the format string,
+ * a time stamp, the priority and the raw arguments.  The host tool
+ * tools/syslogdecode.c rebuilds the text using the format strings found in
+ * the ELF file of the target.
+ *
+ * All multi-byte fields are in the byte order of the target.  A record has
+ * the following layout:
+ *
+ *   Offset  Size  Description
+ *   ------  ----  ---------------------------------------------------------
+ *   0       1     SYSLOG_BINARY_SYNC
+ *   1       1     Target information.  See SYSLOG_BINARY_INFO_* below
+ *   2       1     The syslog() priority
+ *   3       1     N:  The size of the packed arguments in bytes
+ *   4       4     Time stamp seconds
+ *   8       4     Time stamp microseconds
+ *   12      P     The address of the format string (P = sizeof(void *))
+ *   12+P    N     The packed arguments
+ *   12+P+N  1     Checksum:  All bytes of the record sum to zero (mod 256)
+ *
+ * The packed arguments follow the format string in order.  Integers of type
+ * int, long and long long, pointers and doubles are stored with their
+ * native size and without alignment padding.  String arguments are stored
+ * as NUL-terminated strings.  Each '*' field width or precision is stored
+ * as an int preceding the argument that it applies to.  The argument list
+ * may be truncated; the decoder must stop formatting at that point.
+ *
+ * Any output that is not part of a valid record (such as LOG_EMERG output,
+ * which is never binary) is plain text.
+ */
+
+#ifndef __INCLUDE_NUTTX_SYSLOG_SYSLOG_BINARY_H
+#define __INCLUDE_NUTTX_SYSLOG_SYSLOG_BINARY_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The first byte of every binary record */
+
+#define SYSLOG_BINARY_SYNC            0xa5
+
+/* Sizes of the fixed fields */
+
+#define SYSLOG_BINARY_HDRSIZE         12  /* Fields before the format address */
+#define SYSLOG_BINARY_CHKSIZE         1   /* Trailing checksum */
+
+/* Target information byte.  Sizes are encoded as log2 of the size in
+ * bytes.
+ */
+
+#define SYSLOG_BINARY_INFO_INT_SHIFT  0   /* Bits 0-1: sizeof(int) */
+#define SYSLOG_BINARY_INFO_INT_MASK   (3 << SYSLOG_BINARY_INFO_INT_SHIFT)
+#define SYSLOG_BINARY_INFO_LONG_SHIFT 2   /* Bits 2-3: sizeof(long) */
+#define SYSLOG_BINARY_INFO_LONG_MASK  (3 << SYSLOG_BINARY_INFO_LONG_SHIFT)
+#define SYSLOG_BINARY_INFO_PTR_SHIFT  4   /* Bits 4-5: sizeof(void *) */
+#define SYSLOG_BINARY_INFO_PTR_MASK   (3 << SYSLOG_BINARY_INFO_PTR_SHIFT)
+#define SYSLOG_BINARY_INFO_BIGENDIAN  (1 << 6) /* Bit 6: Big-endian target */
+#define SYSLOG_BINARY_INFO_RESERVED   (1 << 7) /* Bit 7: Must be zero */
+
+/* Encode a size in bytes for the target information byte */
+
+#define SYSLOG_BINARY_LOG2(s) \
+  ((s) >= 8 ? 3 : (s) >= 4 ? 2 : (s) >= 2 ? 1 : 0)
+
+#endif /* __INCLUDE_NUTTX_SYSLOG_SYSLOG_BINARY_H */
@@ -402,7 +402,9 @@
 #    define SYS_rmdir                  (__SYS_mountpoint + 5)
 #    define SYS_umount2                (__SYS_mountpoint + 6)
 #    define SYS_unlink                 (__SYS_mountpoint + 7)
-#    define __SYS_shm                  (__SYS_mountpoint + 8)
+#    define SYS_posix_fadvise          (__SYS_mountpoint + 8)
+#    define SYS_readahead              (__SYS_mountpoint + 9)
+#    define __SYS_shm                  (__SYS_mountpoint + 10)
 #  else
 #    define __SYS_shm                  __SYS_mountpoint
 #  endif
@@ -0,0 +1,104 @@
+/****************************************************************************
+ * libs/libc/aio/aio_ring_init.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <semaphore.h>
+#include <aio.h>
+#include <errno.h>
+
+#include <nuttx/semaphore.h>
+
+#ifdef CONFIG_FS_AIO_RING
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: aio_ring_init
+ *
+ * Description:
+ *   Initialize a submission/completion ring for use with aio_ring_enter().
+ *   The caller provides the storage for both queues.  See include/aio.h
+ *   for how the queues are used.
+ *
+ * Input Parameters:
+ *   ring - The ring to be initialized
+ *   sq   - Storage for nsq submission queue entries
+ *   nsq  - The size of the submission queue (a power of two)
+ *   cq   - Storage for ncq completion queue entries
+ *   ncq  - The size of the completion queue (a power of two).  This
+ *          limits the number of requests in flight.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.  Otherwise, -1 is returned and the errno is set
+ *   to EINVAL to indicate an invalid argument.
+ *
+ ****************************************************************************/
+
+int aio_ring_init(FAR struct aio_ring_s *ring, FAR struct aiocb **sq,
+                  int nsq, FAR struct aio_cqe_s *cq, int ncq)
+{
+  if (ring == NULL || sq == NULL || cq == NULL ||
+      nsq <= 0 || nsq > UINT16_MAX || (nsq & (nsq - 1)) != 0 ||
+      ncq <= 0 || ncq > UINT16_MAX || (ncq & (ncq - 1)) != 0)
+    {
+      set_errno(EINVAL);
+      return ERROR;
+    }
+
+  memset(ring, 0, sizeof(struct aio_ring_s));
+  ring->ar_sq     = sq;
+  ring->ar_cq     = cq;
+  ring->ar_sqmask = nsq - 1;
+  ring->ar_cqmask = ncq - 1;
+
+  /* The completion semaphore is used for signaling and, hence, should not
+   * have priority inheritance enabled.
+   */
+
+  sem_init(&ring->ar_cqsem, 0, 0);
+  sem_setprotocol(&ring->ar_cqsem, SEM_PRIO_NONE);
+  return OK;
+}
+
+#endif /* CONFIG_FS_AIO_RING */
@@ -537,7 +537,9 @@ int lio_listio(int mode, FAR struct aiocb *const list[], int nent,
 
   /* Lock the scheduler so that no I/O events can complete on the worker
    * thread until we set our wait set up.  Pre-emption will, of course, be
-   * re-enabled while we are waiting for the signal.
+   * re-enabled while we are waiting for the signal.  This also lets the
+   * worker threads see the whole list at once so that contiguous transfers
+   * on the same file can be merged.
    */
 
   sched_lock();
@@ -46,6 +46,9 @@
 #include <debug.h>
 
 #include <nuttx/mm/iob.h>
+#ifdef CONFIG_IOB_PERCPU
+#  include <nuttx/spinlock.h>
+#endif
 
 #ifdef CONFIG_MM_IOB
 
@@ -83,6 +86,47 @@
 #endif
 #endif /* CONFIG_DEBUG_FEATURES && CONFIG_IOB_DEBUG */
 
+/* The total number of full-size I/O buffers in the pool */
+
+#ifdef CONFIG_IOB_DYNAMIC
+#  if CONFIG_IOB_DYNAMIC_MAX <= CONFIG_IOB_NBUFFERS
+#    error CONFIG_IOB_DYNAMIC_MAX must be greater than CONFIG_IOB_NBUFFERS
+#  endif
+#  define IOB_NTOTAL       g_iob_ntotal
+#else
+#  define IOB_NTOTAL       CONFIG_IOB_NBUFFERS
+#endif
+
+/* Statistics */
+
+#ifdef CONFIG_IOB_STATISTICS
+#  define IOB_STATS_INC(f) (g_iob_stats.f++)
+#else
+#  define IOB_STATS_INC(f)
+#endif
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+#ifdef CONFIG_IOB_PERCPU
+/* This structure holds the cache of free I/O buffers for one CPU.  It is
+ * normally accessed only by its own CPU with local interrupts disabled.
+ * The lock is needed because a CPU that runs out of I/O buffers may also
+ * empty the caches of the other CPUs.
+ */
+
+struct iob_percpu_s
+{
+  spinlock_t pc_lock;         /* Protects the cache */
+  FAR struct iob_s *pc_head;  /* List of cached, free I/O buffers */
+  uint16_t pc_count;          /* Number of buffers in the list */
+#ifdef CONFIG_IOB_STATISTICS
+  uint32_t pc_nalloc;         /* Allocations satisfied from this cache */
+#endif
+};
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -115,6 +159,32 @@ extern sem_t g_throttle_sem;  /* Counts available I/O buffers when throttled */
 extern sem_t g_qentry_sem;    /* Counts free I/O buffer queue containers */
 #endif
 
+#ifdef CONFIG_IOB_PERCPU
+/* Per-CPU caches of free I/O buffers */
+
+extern struct iob_percpu_s g_iob_percpu[CONFIG_SMP_NCPUS];
+#endif
+
+#ifdef CONFIG_IOB_DYNAMIC
+/* Total number of I/O buffers and number of dynamically allocated chunks */
+
+extern uint16_t g_iob_ntotal;
+extern uint16_t g_iob_nchunks;
+#endif
+
+#ifdef CONFIG_IOB_SMALL
+/* A list of all free, unallocated small I/O buffers */
+
+extern FAR struct iob_s *g_iob_smallfree;
+extern uint16_t g_iob_nsmallfree;
+#endif
+
+#ifdef CONFIG_IOB_STATISTICS
+/* Accumulated I/O buffer statistics */
+
+extern struct iobinfo_s g_iob_stats;
+#endif
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -154,6 +224,113 @@ FAR struct iob_qentry_s *iob_tryalloc_qentry(void);
 
 FAR struct iob_qentry_s *iob_free_qentry(FAR struct iob_qentry_s *iobq);
 
+/****************************************************************************
+ * Name: iob_percpu_alloc
+ *
+ * Description:
+ *   Take a free I/O buffer from the cache of the current CPU.  Returns NULL
+ *   if the cache is empty.  The state of the returned buffer is not
+ *   initialized.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_IOB_PERCPU
+FAR struct iob_s *iob_percpu_alloc(void);
+#endif
+
+/****************************************************************************
+ * Name: iob_percpu_free
+ *
+ * Description:
+ *   Try to place a free I/O buffer in the cache of the current CPU.  This
+ *   succeeds only if the cache is not full and there are still buffers in
+ *   the global free list (so that no waiting thread can be starved).
+ *
+ * Returned Value:
+ *   True if the buffer was cached; false if it must be returned to the
+ *   global free list.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_IOB_PERCPU
+bool iob_percpu_free(FAR struct iob_s *iob);
+#endif
+
+/****************************************************************************
+ * Name: iob_percpu_drain
+ *
+ * Description:
+ *   Empty the caches of all CPUs.  This is done before a thread waits for
+ *   an I/O buffer so that buffers cached by other CPUs are not left unused.
+ *
+ * Returned Value:
+ *   The list of I/O buffers that were cached, linked by io_flink, or NULL.
+ *   The caller must release each buffer.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_IOB_PERCPU
+FAR struct iob_s *iob_percpu_drain(void);
+#endif
+
+/****************************************************************************
+ * Name: iob_percpu_count
+ *
+ * Description:
+ *   Return the number of I/O buffers held in the caches of all CPUs.  The
+ *   value is only a snapshot.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_IOB_PERCPU
+int iob_percpu_count(void);
+#endif
+
+/****************************************************************************
+ * Name: iob_release
+ *
+ * Description:
+ *   Return one full-size I/O buffer to the free or the committed list and
+ *   signal its availability.  Must be called in a critical section.
+ *
+ ****************************************************************************/
+
+void iob_release(FAR struct iob_s *iob);
+
+/****************************************************************************
+ * Name: iob_grow
+ *
+ * Description:
+ *   Grow the I/O buffer pool by one chunk of buffers allocated from the
+ *   kernel heap.  The new buffers are released to the free list exactly as
+ *   if they had been freed by iob_free().  This may block and so must not
+ *   be called from an interrupt handler.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure:  -ENOMEM if
+ *   the pool is already at its maximum size or the heap is exhausted,
+ *   -EBUSY if another thread is already growing the pool.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_IOB_DYNAMIC
+int iob_grow(void);
+#endif
+
+/****************************************************************************
+ * Name: iob_shrink_schedule
+ *
+ * Description:
+ *   Called by iob_free() in a critical section.  If enough I/O buffers are
+ *   free that a dynamically allocated chunk could be released, schedule the
+ *   work that will return completely free chunks to the heap.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_IOB_DYNAMIC
+void iob_shrink_schedule(void);
+#endif
+
 /****************************************************************************
  * Name: iob_notifier_signal
  *
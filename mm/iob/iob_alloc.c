@@ -46,6 +46,7 @@
 #include <nuttx/irq.h>
 #include <nuttx/arch.h>
 #include <nuttx/sched.h>
+#include <nuttx/clock.h>
 #include <nuttx/mm/iob.h>
 
 #include "iob.h"
@@ -107,9 +108,17 @@ static FAR struct iob_s *iob_alloc_committed(void)
 static FAR struct iob_s *iob_allocwait(bool throttled)
 {
   FAR struct iob_s *iob;
+#ifdef CONFIG_IOB_PERCPU
+  FAR struct iob_s *cached;
+  FAR struct iob_s *cnext;
+#endif
   irqstate_t flags;
   FAR sem_t *sem;
   int ret = OK;
+#ifdef CONFIG_IOB_STATISTICS
+  clock_t start = 0;
+  bool waited = false;
+#endif
 
 #if CONFIG_IOB_THROTTLE > 0
   /* Select the semaphore count to check. */
@@ -134,6 +143,50 @@ static FAR struct iob_s *iob_allocwait(bool throttled)
   iob = iob_tryalloc(throttled);
   while (ret == OK && iob == NULL)
     {
+#ifdef CONFIG_IOB_DYNAMIC
+      /* Before waiting, try to grow the pool with a new chunk of I/O
+       * buffers from the heap.  This fails once the pool has reached its
+       * maximum size.
+       */
+
+      if (iob_grow() >= 0)
+        {
+          iob = iob_tryalloc(throttled);
+          continue;
+        }
+#endif
+
+#ifdef CONFIG_IOB_PERCPU
+      /* Before waiting, return the I/O buffers cached by all CPUs to the
+       * free list.  Nothing else would release them while we wait.
+       */
+
+      cached = iob_percpu_drain();
+      if (cached != NULL)
+        {
+          for (; cached != NULL; cached = cnext)
+            {
+              cnext = cached->io_flink;
+              iob_release(cached);
+            }
+
+          iob = iob_tryalloc(throttled);
+          if (iob != NULL)
+            {
+              continue;
+            }
+        }
+#endif
+
+#ifdef CONFIG_IOB_STATISTICS
+      if (!waited)
+        {
+          start  = clock_systimer();
+          waited = true;
+          IOB_STATS_INC(nwaits);
+        }
+#endif
+
       /* If not successful, then the semaphore count was less than or equal
        * to zero (meaning that there are no free buffers).  We need to wait
        * for an I/O buffer to be released and placed in the committed
@@ -170,6 +223,13 @@ static FAR struct iob_s *iob_allocwait(bool throttled)
           iob = iob_alloc_committed();
           DEBUGASSERT(iob != NULL);
 
+#ifdef CONFIG_IOB_STATISTICS
+          if (iob != NULL)
+            {
+              IOB_STATS_INC(nalloc);
+            }
+#endif
+
           if (iob == NULL)
             {
               /* This should not fail, but we allow for that possibility to
@@ -188,6 +248,21 @@ static FAR struct iob_s *iob_allocwait(bool throttled)
         }
     }
 
+#ifdef CONFIG_IOB_STATISTICS
+  /* Accumulate the time that we spent waiting */
+
+  if (waited)
+    {
+      uint32_t elapsed = TICK2MSEC(clock_systimer() - start);
+
+      g_iob_stats.waittime += elapsed;
+      if (elapsed > g_iob_stats.maxwait)
+        {
+          g_iob_stats.maxwait = elapsed;
+        }
+    }
+#endif
+
   leave_critical_section(flags);
   return iob;
 }
@@ -245,6 +320,31 @@ FAR struct iob_s *iob_tryalloc(bool throttled)
   sem = (throttled ? &g_throttle_sem : &g_iob_sem);
 #endif
 
+#ifdef CONFIG_IOB_PERCPU
+  /* First try the cache of this CPU.  That does not require the critical
+   * section.  A throttled allocation may use the cache only while the
+   * throttled count shows that it could have been satisfied from the free
+   * list.
+   */
+
+#if CONFIG_IOB_THROTTLE > 0
+  if (!throttled || sem->semcount > 0)
+#endif
+    {
+      iob = iob_percpu_alloc();
+      if (iob != NULL)
+        {
+          /* Put the I/O buffer in a known state */
+
+          iob->io_flink  = NULL; /* Not in a chain */
+          iob->io_len    = 0;    /* Length of the data in the entry */
+          iob->io_offset = 0;    /* Offset to the beginning of data */
+          iob->io_pktlen = 0;    /* Total length of the packet */
+          return iob;
+        }
+    }
+#endif
+
   /* We don't know what context we are called from so we use extreme measures
    * to protect the free list:  We disable interrupts very briefly.
    */
@@ -287,6 +387,15 @@ FAR struct iob_s *iob_tryalloc(bool throttled)
           g_throttle_sem.semcount--;
           DEBUGASSERT(g_throttle_sem.semcount >= -CONFIG_IOB_THROTTLE);
 #endif
+
+#ifdef CONFIG_IOB_STATISTICS
+          IOB_STATS_INC(nalloc);
+          if (g_iob_sem.semcount < g_iob_stats.nminfree)
+            {
+              g_iob_stats.nminfree = g_iob_sem.semcount;
+            }
+#endif
+
           leave_critical_section(flags);
 
           /* Put the I/O buffer in a known state */
@@ -299,6 +408,55 @@ FAR struct iob_s *iob_tryalloc(bool throttled)
         }
     }
 
+  IOB_STATS_INC(nfailed);
   leave_critical_section(flags);
   return NULL;
 }
+
+/****************************************************************************
+ * Name: iob_tryalloc_size
+ *
+ * Description:
+ *   Try to allocate an I/O buffer that will be used to hold 'len' bytes of
+ *   data without waiting for a buffer to become free.  A small I/O buffer
+ *   is returned if CONFIG_IOB_SMALL is selected, 'len' fits, and one is
+ *   available.  Otherwise, this is equivalent to iob_tryalloc().
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_tryalloc_size(bool throttled, unsigned int len)
+{
+#ifdef CONFIG_IOB_SMALL
+  if (len <= CONFIG_IOB_SMALL_BUFSIZE)
+    {
+      FAR struct iob_s *iob;
+      irqstate_t flags;
+
+      /* Take the I/O buffer from the head of the small buffer free list */
+
+      flags = enter_critical_section();
+      iob   = g_iob_smallfree;
+      if (iob != NULL)
+        {
+          g_iob_smallfree = iob->io_flink;
+          g_iob_nsmallfree--;
+          IOB_STATS_INC(nalloc);
+          leave_critical_section(flags);
+
+          /* Put the I/O buffer in a known state */
+
+          iob->io_flink  = NULL; /* Not in a chain */
+          iob->io_len    = 0;    /* Length of the data in the entry */
+          iob->io_offset = 0;    /* Offset to the beginning of data */
+          iob->io_pktlen = 0;    /* Total length of the packet */
+          return iob;
+        }
+
+      leave_critical_section(flags);
+    }
+#endif
+
+  /* Fall back to a full-size I/O buffer */
+
+  return iob_tryalloc(throttled);
+}
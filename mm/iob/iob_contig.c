@@ -81,6 +81,17 @@ int iob_contig(FAR struct iob_s *iob, unsigned int len)
 
   DEBUGASSERT(len <= CONFIG_IOB_BUFSIZE);
 
+#ifdef CONFIG_IOB_SMALL
+  /* Nor more than the size of the head I/O buffer, which may be small */
+
+  if (len > IOB_BUFSIZE(iob))
+    {
+      ioberr("ERROR: bufsize=%u < requested len=%u\n",
+             IOB_BUFSIZE(iob), len);
+      return -ENOSPC;
+    }
+#endif
+
   /* Check if there is already sufficient, contiguous space at the beginning
    * of the packet
    */
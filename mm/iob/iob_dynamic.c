@@ -0,0 +1,333 @@
+/****************************************************************************
+ * mm/iob/iob_dynamic.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <semaphore.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/clock.h>
+#include <nuttx/kmalloc.h>
+#include <nuttx/wqueue.h>
+#include <nuttx/mm/iob.h>
+
+#include "iob.h"
+
+#ifdef CONFIG_IOB_DYNAMIC
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Chunks are released from the low priority work queue, if available */
+
+#if defined(CONFIG_SCHED_LPWORK)
+#  define IOBWORK LPWORK
+#else
+#  define IOBWORK HPWORK
+#endif
+
+/* A chunk is only released if at least this many I/O buffers would remain
+ * free afterward.  This provides some hysteresis so that the pool does not
+ * grow and shrink repeatedly.
+ */
+
+#define IOB_SHRINK_THRESHOLD (2 * CONFIG_IOB_DYNAMIC_CHUNK)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One chunk of I/O buffers allocated from the kernel heap */
+
+struct iob_chunk_s
+{
+  FAR struct iob_chunk_s *ch_flink;  /* Supports a singly linked list */
+  struct iob_s ch_iob[CONFIG_IOB_DYNAMIC_CHUNK];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static FAR struct iob_chunk_s *g_iob_chunks; /* List of allocated chunks */
+static struct work_s g_iob_shrinkwork;       /* Releases free chunks */
+static bool g_iob_growing;                   /* A chunk is being allocated */
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: iob_inchunk
+ *
+ * Description:
+ *   Return true if the I/O buffer lies within the chunk.
+ *
+ ****************************************************************************/
+
+static inline bool iob_inchunk(FAR struct iob_chunk_s *chunk,
+                               FAR struct iob_s *iob)
+{
+  return iob >= &chunk->ch_iob[0] &&
+         iob <  &chunk->ch_iob[CONFIG_IOB_DYNAMIC_CHUNK];
+}
+
+/****************************************************************************
+ * Name: iob_shrink_worker
+ *
+ * Description:
+ *   Return every chunk whose I/O buffers are all in the free list to the
+ *   heap, as long as enough buffers remain free afterward.
+ *
+ ****************************************************************************/
+
+static void iob_shrink_worker(FAR void *arg)
+{
+  FAR struct iob_chunk_s *released = NULL;
+  FAR struct iob_chunk_s *prev;
+  FAR struct iob_chunk_s *chunk;
+  FAR struct iob_chunk_s *next;
+  FAR struct iob_s **pprev;
+  FAR struct iob_s *iob;
+  irqstate_t flags;
+  int nfree;
+
+  flags = enter_critical_section();
+
+  for (prev = NULL, chunk = g_iob_chunks;
+       chunk != NULL && g_iob_sem.semcount >= IOB_SHRINK_THRESHOLD;
+       chunk = next)
+    {
+      next = chunk->ch_flink;
+
+#if CONFIG_IOB_THROTTLE > 0
+      /* Do not disturb throttled waiters */
+
+      if (g_throttle_sem.semcount < CONFIG_IOB_DYNAMIC_CHUNK)
+        {
+          break;
+        }
+#endif
+
+      /* Count the I/O buffers from this chunk that are in the free list */
+
+      nfree = 0;
+      for (iob = g_iob_freelist; iob != NULL; iob = iob->io_flink)
+        {
+          if (iob_inchunk(chunk, iob))
+            {
+              nfree++;
+            }
+        }
+
+      if (nfree < CONFIG_IOB_DYNAMIC_CHUNK)
+        {
+          /* Some are still in use (or cached).  Keep this chunk. */
+
+          prev = chunk;
+          continue;
+        }
+
+      /* Remove all of the chunk's I/O buffers from the free list */
+
+      pprev = &g_iob_freelist;
+      while (*pprev != NULL)
+        {
+          if (iob_inchunk(chunk, *pprev))
+            {
+              *pprev = (*pprev)->io_flink;
+            }
+          else
+            {
+              pprev = &(*pprev)->io_flink;
+            }
+        }
+
+      /* And take their counts.  As in iob_tryalloc(), a simple decrement
+       * is sufficient because we know that the buffers are free.
+       */
+
+      g_iob_sem.semcount -= CONFIG_IOB_DYNAMIC_CHUNK;
+#if CONFIG_IOB_THROTTLE > 0
+      g_throttle_sem.semcount -= CONFIG_IOB_DYNAMIC_CHUNK;
+#endif
+
+      g_iob_ntotal -= CONFIG_IOB_DYNAMIC_CHUNK;
+      g_iob_nchunks--;
+      IOB_STATS_INC(nshrink);
+
+      /* Move the chunk to the list of chunks to be released */
+
+      if (prev != NULL)
+        {
+          prev->ch_flink = next;
+        }
+      else
+        {
+          g_iob_chunks = next;
+        }
+
+      chunk->ch_flink = released;
+      released        = chunk;
+    }
+
+  leave_critical_section(flags);
+
+  /* Now free the memory outside of the critical section */
+
+  while (released != NULL)
+    {
+      chunk    = released;
+      released = chunk->ch_flink;
+
+      iobinfo("Released chunk %p\n", chunk);
+      kmm_free(chunk);
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: iob_grow
+ *
+ * Description:
+ *   Grow the I/O buffer pool by one chunk of buffers allocated from the
+ *   kernel heap.  The new buffers are released to the free list exactly as
+ *   if they had been freed by iob_free().  This may block and so must not
+ *   be called from an interrupt handler.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; a negated errno value on failure:  -ENOMEM if
+ *   the pool is already at its maximum size or the heap is exhausted,
+ *   -EBUSY if another thread is already growing the pool.
+ *
+ ****************************************************************************/
+
+int iob_grow(void)
+{
+  FAR struct iob_chunk_s *chunk;
+  irqstate_t flags;
+  int i;
+
+  flags = enter_critical_section();
+
+  if (g_iob_ntotal + CONFIG_IOB_DYNAMIC_CHUNK > CONFIG_IOB_DYNAMIC_MAX)
+    {
+      leave_critical_section(flags);
+      return -ENOMEM;
+    }
+
+  /* kmm_malloc() may block, allowing another thread to get here */
+
+  if (g_iob_growing)
+    {
+      leave_critical_section(flags);
+      return -EBUSY;
+    }
+
+  g_iob_growing = true;
+  leave_critical_section(flags);
+
+  chunk = (FAR struct iob_chunk_s *)kmm_malloc(sizeof(struct iob_chunk_s));
+
+  flags = enter_critical_section();
+  g_iob_growing = false;
+
+  if (chunk == NULL)
+    {
+      leave_critical_section(flags);
+      ioberr("ERROR: Failed to allocate a chunk of I/O buffers\n");
+      return -ENOMEM;
+    }
+
+  iobinfo("Allocated chunk %p\n", chunk);
+
+  chunk->ch_flink = g_iob_chunks;
+  g_iob_chunks    = chunk;
+  g_iob_ntotal   += CONFIG_IOB_DYNAMIC_CHUNK;
+  g_iob_nchunks++;
+  IOB_STATS_INC(ngrow);
+
+  /* Then release the new I/O buffers to the pool */
+
+  for (i = 0; i < CONFIG_IOB_DYNAMIC_CHUNK; i++)
+    {
+      FAR struct iob_s *iob = &chunk->ch_iob[i];
+
+#ifdef CONFIG_IOB_SMALL
+      iob->io_bufsize = CONFIG_IOB_BUFSIZE;
+#endif
+      iob->io_flink   = NULL;
+      iob->io_len     = 0;
+      iob->io_pktlen  = 0;
+      (void)iob_free(iob);
+    }
+
+  leave_critical_section(flags);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: iob_shrink_schedule
+ *
+ * Description:
+ *   Called by iob_free() in a critical section.  If enough I/O buffers are
+ *   free that a dynamically allocated chunk could be released, schedule the
+ *   work that will return completely free chunks to the heap.
+ *
+ ****************************************************************************/
+
+void iob_shrink_schedule(void)
+{
+  if (g_iob_chunks != NULL &&
+      g_iob_sem.semcount >= IOB_SHRINK_THRESHOLD &&
+      work_available(&g_iob_shrinkwork))
+    {
+      (void)work_queue(IOBWORK, &g_iob_shrinkwork, iob_shrink_worker, NULL,
+                       MSEC2TICK(CONFIG_IOB_DYNAMIC_DELAY));
+    }
+}
+
+#endif /* CONFIG_IOB_DYNAMIC */
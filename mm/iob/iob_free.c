@@ -76,6 +76,52 @@
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: iob_release
+ *
+ * Description:
+ *   Return one full-size I/O buffer to the free or the committed list and
+ *   signal its availability.  Must be called in a critical section.
+ *
+ ****************************************************************************/
+
+void iob_release(FAR struct iob_s *iob)
+{
+  /* Which list?  If there is a task waiting for an IOB, then put
+   * the IOB on either the free list or on the committed list where
+   * it is reserved for that allocation (and not available to
+   * iob_tryalloc()).
+   */
+
+  if (g_iob_sem.semcount < 0)
+    {
+      iob->io_flink   = g_iob_committed;
+      g_iob_committed = iob;
+    }
+  else
+    {
+      iob->io_flink   = g_iob_freelist;
+      g_iob_freelist  = iob;
+    }
+
+  /* Signal that an IOB is available.  If there is a thread blocked,
+   * waiting for an IOB, this will wake up exactly one thread.  The
+   * semaphore count will correctly indicated that the awakened task
+   * owns an IOB and should find it in the committed list.
+   */
+
+  nxsem_post(&g_iob_sem);
+  DEBUGASSERT(g_iob_sem.semcount <= IOB_NTOTAL);
+
+#if CONFIG_IOB_THROTTLE > 0
+  nxsem_post(&g_throttle_sem);
+
+#if 0 /* REVISIT:  This assertion fires! */
+  DEBUGASSERT(g_throttle_sem.semcount <= (CONFIG_IOB_NBUFFERS - CONFIG_IOB_THROTTLE));
+#endif
+#endif
+}
+
 /****************************************************************************
  * Name: iob_free
  *
@@ -127,6 +173,21 @@ FAR struct iob_s *iob_free(FAR struct iob_s *iob)
               next, next->io_pktlen, next->io_len);
     }
 
+#ifdef CONFIG_IOB_PERCPU
+  /* Try to keep the I/O buffer in the cache of this CPU.  That does not
+   * require the critical section.
+   */
+
+#ifdef CONFIG_IOB_SMALL
+  if (iob->io_bufsize == CONFIG_IOB_BUFSIZE && iob_percpu_free(iob))
+#else
+  if (iob_percpu_free(iob))
+#endif
+    {
+      return next;
+    }
+#endif
+
   /* Free the I/O buffer by adding it to the head of the free or the
    * committed list. We don't know what context we are called from so
    * we use extreme measures to protect the free list:  We disable
@@ -135,38 +196,44 @@ FAR struct iob_s *iob_free(FAR struct iob_s *iob)
 
   flags = enter_critical_section();
 
-  /* Which list?  If there is a task waiting for an IOB, then put
-   * the IOB on either the free list or on the committed list where
-   * it is reserved for that allocation (and not available to
-   * iob_tryalloc()).
-   */
+#ifdef CONFIG_IOB_SMALL
+  /* Small I/O buffers simply go back to their own free list */
 
-  if (g_iob_sem.semcount < 0)
-    {
-      iob->io_flink   = g_iob_committed;
-      g_iob_committed = iob;
-    }
-  else
+  if (iob->io_bufsize < CONFIG_IOB_BUFSIZE)
     {
-      iob->io_flink   = g_iob_freelist;
-      g_iob_freelist  = iob;
+      iob->io_flink    = g_iob_smallfree;
+      g_iob_smallfree  = iob;
+      g_iob_nsmallfree++;
+
+      leave_critical_section(flags);
+      return next;
     }
+#endif
 
-  /* Signal that an IOB is available.  If there is a thread blocked,
-   * waiting for an IOB, this will wake up exactly one thread.  The
-   * semaphore count will correctly indicated that the awakened task
-   * owns an IOB and should find it in the committed list.
+#ifdef CONFIG_IOB_PERCPU
+  /* If the free list has run dry, then also return any I/O buffers cached
+   * by any CPU so that they are visible to waiting threads.
    */
 
-  nxsem_post(&g_iob_sem);
-  DEBUGASSERT(g_iob_sem.semcount <= CONFIG_IOB_NBUFFERS);
-
-#if CONFIG_IOB_THROTTLE > 0
-  nxsem_post(&g_throttle_sem);
+  if (g_iob_sem.semcount <= 0)
+    {
+      FAR struct iob_s *cached = iob_percpu_drain();
+      FAR struct iob_s *cnext;
 
-#if 0 /* REVISIT:  This assertion fires! */
-  DEBUGASSERT(g_throttle_sem.semcount <= (CONFIG_IOB_NBUFFERS - CONFIG_IOB_THROTTLE));
+      for (; cached != NULL; cached = cnext)
+        {
+          cnext = cached->io_flink;
+          iob_release(cached);
+        }
+    }
 #endif
+
+  iob_release(iob);
+
+#ifdef CONFIG_IOB_DYNAMIC
+  /* Check if dynamically allocated chunks could be released */
+
+  iob_shrink_schedule();
 #endif
 
 #ifdef CONFIG_IOB_NOTIFIER
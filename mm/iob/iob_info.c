@@ -0,0 +1,115 @@
+/****************************************************************************
+ * mm/iob/iob_info.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stddef.h>
+#include <semaphore.h>
+#include <assert.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/mm/iob.h>
+
+#include "iob.h"
+
+#ifdef CONFIG_IOB_STATISTICS
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: iob_info
+ *
+ * Description:
+ *   Return a snapshot of the I/O buffer pool occupancy and usage
+ *   statistics.
+ *
+ ****************************************************************************/
+
+void iob_info(FAR struct iobinfo_s *info)
+{
+  irqstate_t flags;
+  int semcount;
+#ifdef CONFIG_IOB_PERCPU
+  int cpu;
+#endif
+
+  DEBUGASSERT(info != NULL);
+
+  flags = enter_critical_section();
+
+  /* Start with the accumulated counts */
+
+  *info = g_iob_stats;
+
+  /* Then add the current state of the pool */
+
+  semcount       = g_iob_sem.semcount;
+  info->ntotal   = IOB_NTOTAL;
+  info->nfree    = semcount > 0 ? semcount : 0;
+  info->nwaiting = semcount < 0 ? -semcount : 0;
+  info->ncached  = 0;
+
+#ifdef CONFIG_IOB_PERCPU
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      info->ncached += g_iob_percpu[cpu].pc_count;
+      info->nalloc  += g_iob_percpu[cpu].pc_nalloc;
+    }
+#endif
+
+#ifdef CONFIG_IOB_DYNAMIC
+  info->nchunks  = g_iob_nchunks;
+#else
+  info->nchunks  = 0;
+#endif
+
+#ifdef CONFIG_IOB_SMALL
+  info->nsmall     = CONFIG_IOB_SMALL_NBUFFERS;
+  info->nsmallfree = g_iob_nsmallfree;
+#else
+  info->nsmall     = 0;
+  info->nsmallfree = 0;
+#endif
+
+  leave_critical_section(flags);
+}
+
+#endif /* CONFIG_IOB_STATISTICS */
@@ -39,6 +39,7 @@
 
 #include <nuttx/config.h>
 
+#include <stdint.h>
 #include <stdbool.h>
 
 #include <nuttx/semaphore.h>
@@ -54,6 +55,20 @@
 #  define NULL ((FAR void *)0)
 #endif
 
+#ifdef CONFIG_IOB_SMALL
+/* Small I/O buffers are struct iob_s instances truncated after
+ * CONFIG_IOB_SMALL_BUFSIZE bytes of io_data[].  This is the size of one,
+ * rounded up to preserve the alignment of the structure.
+ */
+
+#  define IOB_SMALL_ALIGN  (sizeof(uintptr_t) - 1)
+#  define IOB_SMALL_SIZE   \
+     ((sizeof(struct iob_s) - CONFIG_IOB_BUFSIZE + \
+       CONFIG_IOB_SMALL_BUFSIZE + IOB_SMALL_ALIGN) & ~IOB_SMALL_ALIGN)
+#  define IOB_SMALL_NWORDS \
+     ((CONFIG_IOB_SMALL_NBUFFERS * IOB_SMALL_SIZE) / sizeof(uintptr_t))
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -65,6 +80,12 @@ static struct iob_s        g_iob_pool[CONFIG_IOB_NBUFFERS];
 static struct iob_qentry_s g_iob_qpool[CONFIG_IOB_NCHAINS];
 #endif
 
+#ifdef CONFIG_IOB_SMALL
+/* This is the pool of pre-allocated small I/O buffers */
+
+static uintptr_t           g_iob_smallpool[IOB_SMALL_NWORDS];
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -97,6 +118,32 @@ sem_t g_throttle_sem;       /* Counts available I/O buffers when throttled */
 sem_t g_qentry_sem;         /* Counts free I/O buffer queue containers */
 #endif
 
+#ifdef CONFIG_IOB_PERCPU
+/* Per-CPU caches of free I/O buffers */
+
+struct iob_percpu_s g_iob_percpu[CONFIG_SMP_NCPUS];
+#endif
+
+#ifdef CONFIG_IOB_DYNAMIC
+/* Total number of I/O buffers and number of dynamically allocated chunks */
+
+uint16_t g_iob_ntotal = CONFIG_IOB_NBUFFERS;
+uint16_t g_iob_nchunks;
+#endif
+
+#ifdef CONFIG_IOB_SMALL
+/* A list of all free, unallocated small I/O buffers */
+
+FAR struct iob_s *g_iob_smallfree;
+uint16_t g_iob_nsmallfree;
+#endif
+
+#ifdef CONFIG_IOB_STATISTICS
+/* Accumulated I/O buffer statistics */
+
+struct iobinfo_s g_iob_stats;
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -126,12 +173,35 @@ void iob_initialize(void)
 
           /* Add the pre-allocate I/O buffer to the head of the free list */
 
-          iob->io_flink  = g_iob_freelist;
-          g_iob_freelist = iob;
+#ifdef CONFIG_IOB_SMALL
+          iob->io_bufsize = CONFIG_IOB_BUFSIZE;
+#endif
+          iob->io_flink   = g_iob_freelist;
+          g_iob_freelist  = iob;
         }
 
       g_iob_committed = NULL;
 
+#ifdef CONFIG_IOB_SMALL
+      /* Add each small I/O buffer to the small buffer free list */
+
+      for (i = 0; i < CONFIG_IOB_SMALL_NBUFFERS; i++)
+        {
+          FAR struct iob_s *iob = (FAR struct iob_s *)
+            ((FAR uint8_t *)g_iob_smallpool + i * IOB_SMALL_SIZE);
+
+          iob->io_bufsize = CONFIG_IOB_SMALL_BUFSIZE;
+          iob->io_flink   = g_iob_smallfree;
+          g_iob_smallfree = iob;
+        }
+
+      g_iob_nsmallfree = CONFIG_IOB_SMALL_NBUFFERS;
+#endif
+
+#ifdef CONFIG_IOB_STATISTICS
+      g_iob_stats.nminfree = CONFIG_IOB_NBUFFERS;
+#endif
+
       nxsem_init(&g_iob_sem, 0, CONFIG_IOB_NBUFFERS);
 #if CONFIG_IOB_THROTTLE > 0
       nxsem_init(&g_throttle_sem, 0, CONFIG_IOB_NBUFFERS - CONFIG_IOB_THROTTLE);
@@ -71,6 +71,19 @@ int iob_navail(bool throttled)
     {
       ret = navail;
 
+#ifdef CONFIG_IOB_PERCPU
+      /* Buffers held in the per-CPU caches are free too.  They are not
+       * counted by the semaphore.
+       */
+
+      if (ret < 0)
+        {
+          ret = 0;
+        }
+
+      ret += iob_percpu_count();
+#endif
+
 #if CONFIG_IOB_THROTTLE > 0
       /* Subtract the throttle value is so requested */
 
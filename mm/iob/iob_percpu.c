@@ -0,0 +1,199 @@
+/****************************************************************************
+ * mm/iob/iob_percpu.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <semaphore.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/arch.h>
+#include <nuttx/mm/iob.h>
+
+#include "iob.h"
+
+#ifdef CONFIG_IOB_PERCPU
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: iob_percpu_alloc
+ *
+ * Description:
+ *   Take a free I/O buffer from the cache of the current CPU.  Returns NULL
+ *   if the cache is empty.  The state of the returned buffer is not
+ *   initialized.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_percpu_alloc(void)
+{
+  FAR struct iob_percpu_s *pc;
+  FAR struct iob_s *iob;
+  irqstate_t flags;
+
+  /* Disabling local interrupts is sufficient:  The cache is only accessed
+   * by this CPU and we cannot migrate to another CPU.
+   */
+
+  flags = up_irq_save();
+
+  pc  = &g_iob_percpu[up_cpu_index()];
+  spin_lock(&pc->pc_lock);
+
+  iob = pc->pc_head;
+  if (iob != NULL)
+    {
+      pc->pc_head = iob->io_flink;
+      pc->pc_count--;
+#ifdef CONFIG_IOB_STATISTICS
+      pc->pc_nalloc++;
+#endif
+    }
+
+  spin_unlock(&pc->pc_lock);
+  up_irq_restore(flags);
+  return iob;
+}
+
+/****************************************************************************
+ * Name: iob_percpu_free
+ *
+ * Description:
+ *   Try to place a free I/O buffer in the cache of the current CPU.  This
+ *   succeeds only if the cache is not full and there are still buffers in
+ *   the global free list (so that no waiting thread can be starved).
+ *
+ * Returned Value:
+ *   True if the buffer was cached; false if it must be returned to the
+ *   global free list.
+ *
+ ****************************************************************************/
+
+bool iob_percpu_free(FAR struct iob_s *iob)
+{
+  FAR struct iob_percpu_s *pc;
+  irqstate_t flags;
+  bool cached = false;
+
+  flags = up_irq_save();
+
+  /* The semaphore count is sampled without the critical section.  If it is
+   * positive, then nobody is waiting for an I/O buffer.  A stale value can
+   * only cause a waiter to find the buffer on the next free.
+   */
+
+  pc = &g_iob_percpu[up_cpu_index()];
+  spin_lock(&pc->pc_lock);
+
+  if (g_iob_sem.semcount > 0 && pc->pc_count < CONFIG_IOB_PERCPU_NBUFFERS)
+    {
+      iob->io_flink = pc->pc_head;
+      pc->pc_head   = iob;
+      pc->pc_count++;
+      cached        = true;
+    }
+
+  spin_unlock(&pc->pc_lock);
+  up_irq_restore(flags);
+  return cached;
+}
+
+/****************************************************************************
+ * Name: iob_percpu_drain
+ *
+ * Description:
+ *   Empty the caches of all CPUs and return the cached I/O buffers.
+ *
+ ****************************************************************************/
+
+FAR struct iob_s *iob_percpu_drain(void)
+{
+  FAR struct iob_percpu_s *pc;
+  FAR struct iob_s *head = NULL;
+  FAR struct iob_s *iob;
+  irqstate_t flags;
+  int cpu;
+
+  flags = up_irq_save();
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      pc = &g_iob_percpu[cpu];
+      spin_lock(&pc->pc_lock);
+
+      while ((iob = pc->pc_head) != NULL)
+        {
+          pc->pc_head   = iob->io_flink;
+          iob->io_flink = head;
+          head          = iob;
+        }
+
+      pc->pc_count = 0;
+      spin_unlock(&pc->pc_lock);
+    }
+
+  up_irq_restore(flags);
+  return head;
+}
+
+/****************************************************************************
+ * Name: iob_percpu_count
+ *
+ * Description:
+ *   Return the number of I/O buffers held in the caches of all CPUs.
+ *
+ ****************************************************************************/
+
+int iob_percpu_count(void)
+{
+  int count = 0;
+  int cpu;
+
+  for (cpu = 0; cpu < CONFIG_SMP_NCPUS; cpu++)
+    {
+      count += g_iob_percpu[cpu].pc_count;
+    }
+
+  return count;
+}
+
+#endif /* CONFIG_IOB_PERCPU */
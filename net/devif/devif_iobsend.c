@@ -70,7 +70,7 @@
 void devif_iob_send(FAR struct net_driver_s *dev, FAR struct iob_s *iob,
                     unsigned int len, unsigned int offset)
 {
-  DEBUGASSERT(dev && len > 0 && len < NETDEV_PKTSIZE(dev));
+  DEBUGASSERT(dev && len > 0 && len < NETDEV_BUFSIZE(dev));
 
   /* Copy the data from the I/O buffer chain to the device buffer */
 
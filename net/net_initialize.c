@@ -178,6 +178,18 @@ void net_initialize(void)
 #ifdef CONFIG_NET_TCP_WRITE_BUFFERS
   tcp_wrbuffer_initialize();
 #endif
+
+#ifdef CONFIG_NET_TCP_CC
+  /* Register the TCP congestion control algorithms */
+
+  tcp_cc_initialize();
+#endif
+
+#ifdef CONFIG_NET_TCP_SACK
+  /* Initialize the pool of out-of-order TCP segments */
+
+  tcp_sack_initialize();
+#endif
 #endif /* CONFIG_NET_TCP */
 
 #ifdef NET_UDP_HAVE_STACK
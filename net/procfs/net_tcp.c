@@ -0,0 +1,262 @@
+/****************************************************************************
+ * net/procfs/net_tcp.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/* Output format (three lines per connection):
+ *
+ *   LPort RPort State       CC
+ *   ddddd ddddd sssssssssss ccccccc cwnd: dddd ssthresh: dddd
+ *     Timeouts: dddd FastRexmits: dddd Recoveries: dddd
+ *     DupACKs: dddd SACKBlocks: dddd OFOSegs: dddd
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <string.h>
+#include <debug.h>
+
+#include <arpa/inet.h>
+
+#include <nuttx/net/net.h>
+#include <nuttx/net/tcp.h>
+
+#include "tcp/tcp.h"
+#include "procfs/procfs.h"
+
+#if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FS_PROCFS) && \
+    !defined(CONFIG_FS_PROCFS_EXCLUDE_NET) && defined(NETPROCFS_HAVE_TCP)
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define TCP_LINES_PER_CONN 3
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static FAR const char *g_tcp_states[] =
+{
+  "CLOSED",
+  "ALLOCATED",
+  "SYN_RCVD",
+  "SYN_SENT",
+  "ESTABLISHED",
+  "FIN_WAIT_1",
+  "FIN_WAIT_2",
+  "CLOSING",
+  "TIME_WAIT",
+  "LAST_ACK"
+};
+
+#define NTCP_STATES (sizeof(g_tcp_states) / sizeof(FAR const char *))
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: netprocfs_tcpline
+ *
+ * Description:
+ *   Format line 'lineno' of the output into netfile->line.  Returns the
+ *   length of the line, zero if there is nothing more to show.
+ *
+ ****************************************************************************/
+
+static int netprocfs_tcpline(FAR struct netprocfs_file_s *netfile,
+                             int lineno)
+{
+  FAR struct tcp_conn_s *conn;
+  FAR const char *state;
+  uint8_t tcpstate;
+  int index;
+  int len;
+
+  if (lineno == 0)
+    {
+      return snprintf(netfile->line, NET_LINELEN,
+                      "LPort RPort State       CC\n");
+    }
+
+  /* Find the connection that this line describes */
+
+  index = (lineno - 1) / TCP_LINES_PER_CONN;
+  for (conn = tcp_nextconn(NULL);
+       conn != NULL && index > 0;
+       conn = tcp_nextconn(conn), index--)
+    {
+    }
+
+  if (conn == NULL)
+    {
+      return 0;
+    }
+
+  switch ((lineno - 1) % TCP_LINES_PER_CONN)
+    {
+      case 0:
+        tcpstate = conn->tcpstateflags & TCP_STATE_MASK;
+        state    = tcpstate < NTCP_STATES ? g_tcp_states[tcpstate] : "?";
+
+        len = snprintf(netfile->line, NET_LINELEN,
+                       "%5u %5u %-11s %-7s ",
+                       ntohs(conn->lport), ntohs(conn->rport), state,
+                       conn->cc_ops != NULL ? conn->cc_ops->name : "-");
+        len += snprintf(&netfile->line[len], NET_LINELEN - len,
+                        "cwnd: %lu ssthresh: %lu\n",
+                        (unsigned long)conn->cwnd,
+                        (unsigned long)conn->ssthresh);
+        break;
+
+      case 1:
+        len = snprintf(netfile->line, NET_LINELEN,
+                       "  Timeouts: %lu FastRexmits: %lu Recoveries: %lu\n",
+                       (unsigned long)conn->ccstats.timeouts,
+                       (unsigned long)conn->ccstats.fastrexmits,
+                       (unsigned long)conn->ccstats.recoveries);
+        break;
+
+      default:
+        len = snprintf(netfile->line, NET_LINELEN,
+                       "  DupACKs: %lu SACKBlocks: %lu OFOSegs: %lu\n",
+                       (unsigned long)conn->ccstats.dupacks,
+                       (unsigned long)conn->ccstats.sackblocks,
+                       (unsigned long)conn->ccstats.ofosegs);
+        break;
+    }
+
+  return len < NET_LINELEN ? len : NET_LINELEN - 1;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: netprocfs_read_tcpstats
+ *
+ * Description:
+ *   Read and format per-connection TCP congestion control state and
+ *   statistics.
+ *
+ * Input Parameters:
+ *   priv - A reference to the network procfs file structure
+ *   buffer - The user-provided buffer into which network status will be
+ *            returned.
+ *   bulen  - The size in bytes of the user provided buffer.
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned
+ *   on failure.
+ *
+ ****************************************************************************/
+
+ssize_t netprocfs_read_tcpstats(FAR struct netprocfs_file_s *priv,
+                                FAR char *buffer, size_t buflen)
+{
+  size_t xfrsize;
+  ssize_t nreturned = 0;
+
+  /* The number of lines depends on the number of connections so the
+   * fixed table of netprocfs_read_linegen() cannot be used.  Otherwise
+   * this is the same logic.  Begin with any line data already buffered.
+   */
+
+  if (priv->linesize > 0)
+    {
+      xfrsize = priv->linesize;
+      if (xfrsize > buflen)
+        {
+          xfrsize = buflen;
+        }
+
+      memcpy(buffer, &priv->line[priv->offset], xfrsize);
+
+      buffer         += xfrsize;
+      buflen         -= xfrsize;
+
+      priv->linesize -= xfrsize;
+      priv->offset   += xfrsize;
+      nreturned       = xfrsize;
+    }
+
+  /* Then format new lines until the user buffer is full or there are no
+   * more connections to show.  The list of connections may change between
+   * reads; that only affects which connections are shown.
+   */
+
+  net_lock();
+  while (buflen > 0 && priv->lineno < UINT8_MAX)
+    {
+      int len = netprocfs_tcpline(priv, priv->lineno);
+
+      if (len <= 0)
+        {
+          break;
+        }
+
+      priv->lineno++;
+      priv->linesize = len;
+      priv->offset   = 0;
+
+      xfrsize = priv->linesize;
+      if (xfrsize > buflen)
+        {
+          xfrsize = buflen;
+        }
+
+      memcpy(buffer, priv->line, xfrsize);
+
+      buffer         += xfrsize;
+      buflen         -= xfrsize;
+
+      priv->linesize -= xfrsize;
+      priv->offset   += xfrsize;
+      nreturned      += xfrsize;
+    }
+
+  net_unlock();
+  return nreturned;
+}
+
+#endif /* !CONFIG_DISABLE_MOUNTPOINT && CONFIG_FS_PROCFS &&
+        * !CONFIG_FS_PROCFS_EXCLUDE_NET && NETPROCFS_HAVE_TCP */
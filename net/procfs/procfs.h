@@ -54,6 +54,12 @@
 #  undef CONFIG_NET_ROUTE
 #endif
 
+/* Per-connection TCP state, /proc/net/tcp */
+
+#if defined(CONFIG_NET_TCP_CC) && !defined(CONFIG_FS_PROCFS_EXCLUDE_TCP)
+#  define NETPROCFS_HAVE_TCP 1
+#endif
+
 /* Determines the size of an intermediate buffer that must be large enough
  * to handle the longest line generated by this logic.
  */
@@ -75,6 +81,9 @@ enum netprocfs_entry_e
   , NETPROCFS_SUBDIR_MLD             /* /proc/net/mld */
 #endif
 #endif
+#ifdef NETPROCFS_HAVE_TCP
+  , NETPROCFS_SUBDIR_TCP             /* /proc/net/tcp */
+#endif
 #ifdef CONFIG_NET_ROUTE
   , NETPROCFS_SUBDIR_ROUTE           /* /proc/net/route */
 #endif
@@ -195,6 +204,30 @@ ssize_t netprocfs_read_mldstats(FAR struct netprocfs_file_s *priv,
                                 FAR char *buffer, size_t buflen);
 #endif
 
+/****************************************************************************
+ * Name: netprocfs_read_tcpstats
+ *
+ * Description:
+ *   Read and format per-connection TCP congestion control state and
+ *   statistics.
+ *
+ * Input Parameters:
+ *   priv - A reference to the network procfs file structure
+ *   buffer - The user-provided buffer into which network status will be
+ *            returned.
+ *   bulen  - The size in bytes of the user provided buffer.
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success; a negated errno value is returned
+ *   on failure.
+ *
+ ****************************************************************************/
+
+#ifdef NETPROCFS_HAVE_TCP
+ssize_t netprocfs_read_tcpstats(FAR struct netprocfs_file_s *priv,
+                                FAR char *buffer, size_t buflen);
+#endif
+
 /****************************************************************************
  * Name: netprocfs_read_routes
  *
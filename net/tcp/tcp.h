@@ -104,10 +104,85 @@
 #  endif
 #endif
 
+/* Sequence number comparisons that are safe across wrap-around */
+
+#define TCP_SEQ_LT(a,b)   ((int32_t)((a) - (b)) < 0)
+#define TCP_SEQ_LTE(a,b)  ((int32_t)((a) - (b)) <= 0)
+#define TCP_SEQ_GT(a,b)   ((int32_t)((a) - (b)) > 0)
+#define TCP_SEQ_GTE(a,b)  ((int32_t)((a) - (b)) >= 0)
+
+#ifdef CONFIG_NET_TCP_CC
+/* Congestion control state bits (struct tcp_conn_s ccflags field) */
+
+#  define TCP_CC_RECOVERY   (1 << 0) /* Fast recovery in progress */
+#  define TCP_CC_REXMIT     (1 << 1) /* A fast retransmission is pending */
+#  define TCP_CC_SACKPERM   (1 << 2) /* SACK was negotiated with the peer */
+
+/* Words of congestion control algorithm private state in each connection */
+
+#  define TCP_CC_PRIV_WORDS 6
+#endif
+
+#ifdef CONFIG_NET_TCP_SACK
+/* Maximum number of SACK blocks retained from the peer and sent to the
+ * peer.  Four is the most that fit in the TCP option space.
+ */
+
+#  define TCP_SACK_NBLOCKS  4
+#endif
+
 /****************************************************************************
  * Public Type Definitions
  ****************************************************************************/
 
+struct tcp_conn_s;        /* Forward reference */
+
+#ifdef CONFIG_NET_TCP_CC
+/* A congestion control algorithm.  Each algorithm provides these methods
+ * which are called with the network locked.  The congestion window is
+ * in bytes.
+ *
+ *   init       - Optional.  Prepare the algorithm's private state
+ *                (cc_priv) when the connection is established.
+ *   cong_avoid - Grow cwnd when 'acked' new bytes have been acknowledged
+ *                outside of fast recovery.
+ *   ssthresh   - Loss has been detected.  Return the new slow start
+ *                threshold.
+ */
+
+struct tcp_cc_ops_s
+{
+  FAR struct tcp_cc_ops_s *flink;   /* Supports a singly linked list */
+  FAR const char *name;             /* Name used with TCP_CONGESTION */
+
+  CODE void (*init)(FAR struct tcp_conn_s *conn);
+  CODE void (*cong_avoid)(FAR struct tcp_conn_s *conn, uint32_t acked);
+  CODE uint32_t (*ssthresh)(FAR struct tcp_conn_s *conn);
+};
+
+/* Per-connection congestion control statistics */
+
+struct tcp_ccstats_s
+{
+  uint32_t timeouts;      /* Retransmission timeouts */
+  uint32_t fastrexmits;   /* Fast retransmissions */
+  uint32_t recoveries;    /* Entries into fast recovery */
+  uint32_t dupacks;       /* Duplicate ACKs received */
+  uint32_t sackblocks;    /* SACK blocks received from the peer */
+  uint32_t ofosegs;       /* Out-of-order segments held */
+};
+#endif
+
+#ifdef CONFIG_NET_TCP_SACK
+/* A block of sequence numbers [left, right) */
+
+struct tcp_sack_s
+{
+  uint32_t left;          /* First sequence number of the block */
+  uint32_t right;         /* Sequence number following the block */
+};
+#endif
+
 /* Representation of a TCP connection.
  *
  * The tcp_conn_s structure is used for identifying a connection. All
@@ -189,6 +264,52 @@ struct tcp_conn_s
                            * segment (next greater sndseq) */
 #endif
 
+#ifdef CONFIG_NET_TCP_CC
+  /* Congestion control (see tcp_cc.c)
+   *
+   *   cc_ops    - The congestion control algorithm in use
+   *   cwnd      - The congestion window (bytes)
+   *   ssthresh  - The slow start threshold (bytes)
+   *   snduna    - The oldest unacknowledged sequence number
+   *   recover   - The highest sequence number sent when fast recovery began
+   *   rexmitseq - Start of the pending fast retransmission
+   *   rexmitnxt - Where to look for the next hole to fast retransmit
+   *   rexmitlen - Length of the pending fast retransmission
+   *   dupacks   - Number of consecutive duplicate ACKs
+   *   ccflags   - See TCP_CC_* definitions
+   *   cc_priv   - Private state of the congestion control algorithm
+   */
+
+  FAR struct tcp_cc_ops_s *cc_ops;
+  uint32_t   cwnd;
+  uint32_t   ssthresh;
+  uint32_t   snduna;
+  uint32_t   recover;
+  uint32_t   rexmitseq;
+  uint32_t   rexmitnxt;
+  uint16_t   rexmitlen;
+  uint8_t    dupacks;
+  uint8_t    ccflags;
+  uint32_t   cc_priv[TCP_CC_PRIV_WORDS];
+  struct tcp_ccstats_s ccstats;
+#endif
+
+#ifdef CONFIG_NET_TCP_SACK
+  /* Selective acknowledgements (see tcp_sack.c)
+   *
+   *   sack    - Blocks above snduna reported by the peer, in sequence order
+   *   nsack   - Number of valid entries in sack[]
+   *   ofo_q   - Out-of-order segments received from the peer, in sequence
+   *             order
+   *   ofolast - Sequence number of the most recently held segment
+   */
+
+  struct tcp_sack_s sack[TCP_SACK_NBLOCKS];
+  uint8_t    nsack;
+  sq_queue_t ofo_q;
+  uint32_t   ofolast;
+#endif
+
 #ifdef CONFIG_NET_TCPBACKLOG
   /* Listen backlog support
    *
@@ -322,6 +443,15 @@ extern "C"
 EXTERN struct net_driver_s *g_netdevices;
 #endif
 
+#ifdef CONFIG_NET_TCP_CC
+/* The built-in congestion control algorithms */
+
+EXTERN struct tcp_cc_ops_s g_tcp_newreno;
+#ifdef CONFIG_NET_TCP_CC_CUBIC
+EXTERN struct tcp_cc_ops_s g_tcp_cubic;
+#endif
+#endif
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -1682,6 +1812,260 @@ void tcp_readahead_signal(FAR struct tcp_conn_s *conn);
 void tcp_disconnect_signal(FAR struct tcp_conn_s *conn);
 #endif
 
+#ifdef CONFIG_NET_TCP_CC
+/****************************************************************************
+ * Name: tcp_cc_initialize
+ *
+ * Description:
+ *   Register the built-in congestion control algorithms.
+ *
+ * Assumptions:
+ *   Called once early initialization.
+ *
+ ****************************************************************************/
+
+void tcp_cc_initialize(void);
+
+/****************************************************************************
+ * Name: tcp_cc_register
+ *
+ * Description:
+ *   Register a congestion control algorithm so that it may be selected
+ *   with the TCP_CONGESTION socket option.
+ *
+ * Input Parameters:
+ *   ops - The algorithm.  This must persist for the life of the system.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; -EEXIST if an algorithm of the same name has
+ *   already been registered.
+ *
+ ****************************************************************************/
+
+int tcp_cc_register(FAR struct tcp_cc_ops_s *ops);
+
+/****************************************************************************
+ * Name: tcp_cc_find
+ *
+ * Description:
+ *   Find the registered congestion control algorithm with this name.
+ *   Returns NULL if there is no such algorithm.
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+FAR struct tcp_cc_ops_s *tcp_cc_find(FAR const char *name);
+
+/****************************************************************************
+ * Name: tcp_cc_default
+ *
+ * Description:
+ *   Return the congestion control algorithm that new connections use.
+ *
+ ****************************************************************************/
+
+FAR struct tcp_cc_ops_s *tcp_cc_default(void);
+
+/****************************************************************************
+ * Name: tcp_cc_setup
+ *
+ * Description:
+ *   Set the initial congestion window when the connection enters the
+ *   ESTABLISHED state.
+ *
+ * Input Parameters:
+ *   conn - The TCP connection
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+void tcp_cc_setup(FAR struct tcp_conn_s *conn);
+
+/****************************************************************************
+ * Name: tcp_cc_ack
+ *
+ * Description:
+ *   Update the congestion state for an incoming ACK: grow the congestion
+ *   window for new data acknowledged, count duplicate ACKs, and enter or
+ *   leave fast recovery.
+ *
+ * Input Parameters:
+ *   conn    - The TCP connection
+ *   tcp     - The TCP header of the incoming segment
+ *   ackno   - The acknowledgement number of the incoming segment
+ *   datalen - The number of data bytes in the incoming segment
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+void tcp_cc_ack(FAR struct tcp_conn_s *conn, FAR struct tcp_hdr_s *tcp,
+                uint32_t ackno, uint16_t datalen);
+
+/****************************************************************************
+ * Name: tcp_cc_timeout
+ *
+ * Description:
+ *   The retransmission timer has expired.  Collapse the congestion window
+ *   and abandon any fast recovery.
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+void tcp_cc_timeout(FAR struct tcp_conn_s *conn);
+
+/****************************************************************************
+ * Name: tcp_cc_sndwnd
+ *
+ * Description:
+ *   Return the number of new bytes that the congestion window allows to
+ *   be sent now.
+ *
+ * Input Parameters:
+ *   conn   - The TCP connection
+ *   sndnxt - The sequence number of the next byte to be sent
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+uint32_t tcp_cc_sndwnd(FAR struct tcp_conn_s *conn, uint32_t sndnxt);
+#endif /* CONFIG_NET_TCP_CC */
+
+#ifdef CONFIG_NET_TCP_SACK
+/****************************************************************************
+ * Name: tcp_sack_initialize
+ *
+ * Description:
+ *   Initialize the pool of out-of-order segment containers.
+ *
+ * Assumptions:
+ *   Called once early initialization.
+ *
+ ****************************************************************************/
+
+void tcp_sack_initialize(void);
+
+/****************************************************************************
+ * Name: tcp_sack_update
+ *
+ * Description:
+ *   Merge the SACK blocks carried in the options of an incoming segment
+ *   into the connection's scoreboard and discard blocks that are now
+ *   cumulatively acknowledged.
+ *
+ * Input Parameters:
+ *   conn - The TCP connection
+ *   tcp  - The TCP header of the incoming segment
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+void tcp_sack_update(FAR struct tcp_conn_s *conn, FAR struct tcp_hdr_s *tcp);
+
+/****************************************************************************
+ * Name: tcp_sack_nexthole
+ *
+ * Description:
+ *   Find the next unacknowledged range at or after *seq that lies below a
+ *   block SACKed by the peer.
+ *
+ * Input Parameters:
+ *   conn - The TCP connection
+ *   seq  - In: where to begin looking.  Out: the start of the hole.
+ *   len  - Out: the length of the hole.
+ *
+ * Returned Value:
+ *   true if a hole was found.
+ *
+ ****************************************************************************/
+
+bool tcp_sack_nexthole(FAR struct tcp_conn_s *conn, FAR uint32_t *seq,
+                       FAR uint32_t *len);
+
+/****************************************************************************
+ * Name: tcp_sack_options
+ *
+ * Description:
+ *   Build the SACK option describing the out-of-order data held for this
+ *   connection.
+ *
+ * Input Parameters:
+ *   conn - The TCP connection
+ *   opt  - Where to write the option.  Must have room for
+ *          2 + TCP_OPT_SACK_LEN(TCP_SACK_NBLOCKS) bytes.
+ *
+ * Returned Value:
+ *   The number of option bytes written, a multiple of four.  Zero if no
+ *   out-of-order data is held.
+ *
+ ****************************************************************************/
+
+unsigned int tcp_sack_options(FAR struct tcp_conn_s *conn,
+                              FAR uint8_t *opt);
+
+/****************************************************************************
+ * Name: tcp_ofo_insert
+ *
+ * Description:
+ *   Hold a segment that arrived ahead of the next expected sequence number.
+ *
+ * Input Parameters:
+ *   conn  - The TCP connection
+ *   seqno - The sequence number of the first byte of data
+ *   data  - The segment data
+ *   len   - The length of the segment data
+ *
+ * Returned Value:
+ *   Zero (OK) if the segment was held; a negated errno value if there were
+ *   no resources or the segment lies outside the receive window.
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+int tcp_ofo_insert(FAR struct tcp_conn_s *conn, uint32_t seqno,
+                   FAR const uint8_t *data, uint16_t len);
+
+/****************************************************************************
+ * Name: tcp_ofo_deliver
+ *
+ * Description:
+ *   Move any held segments that are now in sequence into the read-ahead
+ *   buffers and advance rcvseq past them.
+ *
+ * Returned Value:
+ *   The number of bytes delivered.
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+uint32_t tcp_ofo_deliver(FAR struct tcp_conn_s *conn);
+
+/****************************************************************************
+ * Name: tcp_ofo_free
+ *
+ * Description:
+ *   Release all out-of-order segments held for a connection.
+ *
+ ****************************************************************************/
+
+void tcp_ofo_free(FAR struct tcp_conn_s *conn);
+#endif /* CONFIG_NET_TCP_SACK */
+
 #undef EXTERN
 #ifdef __cplusplus
 }
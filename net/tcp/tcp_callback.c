@@ -250,10 +250,10 @@ uint16_t tcp_datahandler(FAR struct tcp_conn_s *conn, FAR uint8_t *buffer,
 
   /* Try to allocate on I/O buffer to start the chain without waiting (and
    * throttling as necessary).  If we would have to wait, then drop the
-   * packet.
+   * packet.  Small segments may be held in a small I/O buffer.
    */
 
-  iob = iob_tryalloc(true);
+  iob = iob_tryalloc_size(true, buflen);
   if (iob == NULL)
     {
       nerr("ERROR: Failed to create new I/O buffer chain\n");
@@ -0,0 +1,491 @@
+/****************************************************************************
+ * net/tcp/tcp_cc.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#if defined(CONFIG_NET) && defined(CONFIG_NET_TCP) && defined(CONFIG_NET_TCP_CC)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <debug.h>
+
+#include <netinet/tcp.h>
+
+#include <nuttx/net/net.h>
+#include <nuttx/net/netconfig.h>
+#include <nuttx/net/tcp.h>
+
+#include "tcp/tcp.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Number of duplicate ACKs that trigger a fast retransmission (RFC 5681) */
+
+#define TCP_CC_DUPTHRESH  3
+
+/* The largest initial window permitted by RFC 3390 regardless of MSS */
+
+#define TCP_CC_IWMAX      4380
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The list of registered congestion control algorithms */
+
+static FAR struct tcp_cc_ops_s *g_tcp_cclist;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: tcp_cc_nexthole
+ *
+ * Description:
+ *   Select the data to retransmit next, starting at 'seq'.  If SACK
+ *   information is available, this skips data that the peer already holds;
+ *   otherwise one MSS at 'seq' is selected.
+ *
+ * Returned Value:
+ *   true if a retransmission was scheduled.
+ *
+ ****************************************************************************/
+
+static bool tcp_cc_nexthole(FAR struct tcp_conn_s *conn, uint32_t seq)
+{
+  uint32_t len = conn->mss;
+
+  if (TCP_SEQ_LT(seq, conn->snduna))
+    {
+      seq = conn->snduna;
+    }
+
+#ifdef CONFIG_NET_TCP_SACK
+  if (conn->nsack > 0)
+    {
+      if (!tcp_sack_nexthole(conn, &seq, &len))
+        {
+          return false;
+        }
+
+      if (len > conn->mss)
+        {
+          len = conn->mss;
+        }
+    }
+  else
+#endif
+  if (!TCP_SEQ_LT(seq, conn->recover))
+    {
+      return false;
+    }
+
+  conn->rexmitseq = seq;
+  conn->rexmitlen = len;
+  conn->rexmitnxt = seq + len;
+  conn->ccflags  |= TCP_CC_REXMIT;
+  return true;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: tcp_cc_initialize
+ *
+ * Description:
+ *   Register the built-in congestion control algorithms.
+ *
+ * Assumptions:
+ *   Called once early initialization.
+ *
+ ****************************************************************************/
+
+void tcp_cc_initialize(void)
+{
+  (void)tcp_cc_register(&g_tcp_newreno);
+#ifdef CONFIG_NET_TCP_CC_CUBIC
+  (void)tcp_cc_register(&g_tcp_cubic);
+#endif
+}
+
+/****************************************************************************
+ * Name: tcp_cc_register
+ *
+ * Description:
+ *   Register a congestion control algorithm so that it may be selected
+ *   with the TCP_CONGESTION socket option.
+ *
+ * Input Parameters:
+ *   ops - The algorithm.  This must persist for the life of the system.
+ *
+ * Returned Value:
+ *   Zero (OK) on success; -EEXIST if an algorithm of the same name has
+ *   already been registered.
+ *
+ ****************************************************************************/
+
+int tcp_cc_register(FAR struct tcp_cc_ops_s *ops)
+{
+  DEBUGASSERT(ops != NULL && ops->name != NULL && ops->cong_avoid != NULL &&
+              ops->ssthresh != NULL);
+
+  net_lock();
+  if (tcp_cc_find(ops->name) != NULL)
+    {
+      net_unlock();
+      return -EEXIST;
+    }
+
+  ops->flink   = g_tcp_cclist;
+  g_tcp_cclist = ops;
+  net_unlock();
+
+  ninfo("Registered TCP congestion control: %s\n", ops->name);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tcp_cc_find
+ *
+ * Description:
+ *   Find the registered congestion control algorithm with this name.
+ *   Returns NULL if there is no such algorithm.
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+FAR struct tcp_cc_ops_s *tcp_cc_find(FAR const char *name)
+{
+  FAR struct tcp_cc_ops_s *ops;
+
+  for (ops = g_tcp_cclist; ops != NULL; ops = ops->flink)
+    {
+      if (strncmp(ops->name, name, TCP_CA_NAME_MAX) == 0)
+        {
+          return ops;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: tcp_cc_default
+ *
+ * Description:
+ *   Return the congestion control algorithm that new connections use.
+ *
+ ****************************************************************************/
+
+FAR struct tcp_cc_ops_s *tcp_cc_default(void)
+{
+#ifdef CONFIG_NET_TCP_CC_DEFAULT_CUBIC
+  return &g_tcp_cubic;
+#else
+  return &g_tcp_newreno;
+#endif
+}
+
+/****************************************************************************
+ * Name: tcp_cc_setup
+ *
+ * Description:
+ *   Set the initial congestion window when the connection enters the
+ *   ESTABLISHED state.
+ *
+ * Input Parameters:
+ *   conn - The TCP connection
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+void tcp_cc_setup(FAR struct tcp_conn_s *conn)
+{
+  uint32_t mss = conn->mss;
+
+  /* The initial window of RFC 3390:  min(4*MSS, max(2*MSS, 4380)) */
+
+  conn->cwnd      = 2 * mss > TCP_CC_IWMAX ? 2 * mss : TCP_CC_IWMAX;
+  if (conn->cwnd > 4 * mss)
+    {
+      conn->cwnd  = 4 * mss;
+    }
+
+  conn->ssthresh  = UINT32_MAX;
+  conn->snduna    = conn->isn;
+  conn->recover   = conn->isn - 1;
+  conn->rexmitnxt = conn->isn;
+  conn->dupacks   = 0;
+  conn->ccflags  &= TCP_CC_SACKPERM;
+
+  memset(conn->cc_priv, 0, sizeof(conn->cc_priv));
+  if (conn->cc_ops->init != NULL)
+    {
+      conn->cc_ops->init(conn);
+    }
+}
+
+/****************************************************************************
+ * Name: tcp_cc_ack
+ *
+ * Description:
+ *   Update the congestion state for an incoming ACK: grow the congestion
+ *   window for new data acknowledged, count duplicate ACKs, and enter or
+ *   leave fast recovery.
+ *
+ * Input Parameters:
+ *   conn    - The TCP connection
+ *   tcp     - The TCP header of the incoming segment
+ *   ackno   - The acknowledgement number of the incoming segment
+ *   datalen - The number of data bytes in the incoming segment
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+void tcp_cc_ack(FAR struct tcp_conn_s *conn, FAR struct tcp_hdr_s *tcp,
+                uint32_t ackno, uint16_t datalen)
+{
+  uint32_t mss = conn->mss;
+
+  if (conn->cwnd == 0 || TCP_SEQ_GT(ackno, conn->sndseq_max))
+    {
+      /* Not yet set up or an ACK for data that was never sent */
+
+      return;
+    }
+
+  if (TCP_SEQ_GT(ackno, conn->snduna))
+    {
+      uint32_t acked = ackno - conn->snduna;
+
+      /* New data has been acknowledged */
+
+      conn->snduna  = ackno;
+      conn->dupacks = 0;
+
+#ifdef CONFIG_NET_TCP_SACK
+      if ((conn->ccflags & TCP_CC_SACKPERM) != 0)
+        {
+          tcp_sack_update(conn, tcp);
+        }
+#endif
+
+      if ((conn->ccflags & TCP_CC_RECOVERY) != 0)
+        {
+          if (!TCP_SEQ_LT(ackno, conn->recover))
+            {
+              /* A full acknowledgement ends fast recovery.  Deflate the
+               * window (RFC 6582, section 3.2 step 3).
+               */
+
+              conn->ccflags &= ~(TCP_CC_RECOVERY | TCP_CC_REXMIT);
+              conn->cwnd     = conn->unacked + mss;
+              if (conn->cwnd > conn->ssthresh)
+                {
+                  conn->cwnd = conn->ssthresh;
+                }
+            }
+          else
+            {
+              /* A partial acknowledgement.  Retransmit the next hole at
+               * once and deflate the window by the amount acknowledged
+               * (RFC 6582, section 3.2 step 4).
+               */
+
+              (void)tcp_cc_nexthole(conn, ackno);
+
+              conn->cwnd = conn->cwnd > acked ? conn->cwnd - acked : 0;
+              conn->cwnd += mss;
+            }
+        }
+      else
+        {
+          conn->cc_ops->cong_avoid(conn, acked);
+        }
+
+      if (TCP_SEQ_LT(conn->rexmitnxt, ackno))
+        {
+          conn->rexmitnxt = ackno;
+        }
+    }
+  else if (ackno == conn->snduna && datalen == 0 && conn->unacked > 0 &&
+           (tcp->flags & (TCP_SYN | TCP_FIN | TCP_RST)) == 0)
+    {
+      /* A duplicate ACK */
+
+      conn->ccstats.dupacks++;
+      if (conn->dupacks < UINT8_MAX)
+        {
+          conn->dupacks++;
+        }
+
+#ifdef CONFIG_NET_TCP_SACK
+      if ((conn->ccflags & TCP_CC_SACKPERM) != 0)
+        {
+          tcp_sack_update(conn, tcp);
+        }
+#endif
+
+      if ((conn->ccflags & TCP_CC_RECOVERY) != 0)
+        {
+          /* Each duplicate ACK means another segment has left the network.
+           * Inflate the window and, if the peer has told us where the
+           * holes are, fill the next one.
+           */
+
+          conn->cwnd += mss;
+#ifdef CONFIG_NET_TCP_SACK
+          if (conn->nsack > 0)
+            {
+              (void)tcp_cc_nexthole(conn, conn->rexmitnxt);
+            }
+#endif
+        }
+      else if (conn->dupacks == TCP_CC_DUPTHRESH &&
+               TCP_SEQ_GT(ackno, conn->recover))
+        {
+          /* Fast retransmit and enter fast recovery (RFC 6582, section
+           * 3.2 step 2).  The check against 'recover' avoids a second
+           * reduction for losses from a window that has already been
+           * reduced.
+           */
+
+          conn->ssthresh = conn->cc_ops->ssthresh(conn);
+          conn->cwnd     = conn->ssthresh + TCP_CC_DUPTHRESH * mss;
+          conn->recover  = conn->sndseq_max;
+          conn->ccflags |= TCP_CC_RECOVERY;
+          conn->ccstats.recoveries++;
+
+          (void)tcp_cc_nexthole(conn, ackno);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: tcp_cc_timeout
+ *
+ * Description:
+ *   The retransmission timer has expired.  Collapse the congestion window
+ *   and abandon any fast recovery.
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+void tcp_cc_timeout(FAR struct tcp_conn_s *conn)
+{
+  if (conn->cwnd == 0)
+    {
+      return;
+    }
+
+  /* RFC 5681, section 3.1:  ssthresh as for a loss (but only on the first
+   * timeout for a segment), cwnd to one segment.  Everything outstanding is
+   * retransmitted, so anything the peer SACKed must be sent again too (RFC
+   * 2018, section 8).
+   */
+
+  if (conn->nrtx <= 1)
+    {
+      conn->ssthresh = conn->cc_ops->ssthresh(conn);
+    }
+
+  conn->cwnd      = conn->mss;
+  conn->recover   = conn->sndseq_max;
+  conn->rexmitnxt = conn->snduna;
+  conn->dupacks   = 0;
+  conn->ccflags  &= ~(TCP_CC_RECOVERY | TCP_CC_REXMIT);
+#ifdef CONFIG_NET_TCP_SACK
+  conn->nsack     = 0;
+#endif
+
+  conn->ccstats.timeouts++;
+}
+
+/****************************************************************************
+ * Name: tcp_cc_sndwnd
+ *
+ * Description:
+ *   Return the number of new bytes that the congestion window allows to
+ *   be sent now.
+ *
+ * Input Parameters:
+ *   conn   - The TCP connection
+ *   sndnxt - The sequence number of the next byte to be sent
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+uint32_t tcp_cc_sndwnd(FAR struct tcp_conn_s *conn, uint32_t sndnxt)
+{
+  uint32_t flight;
+
+  if (conn->cwnd == 0)
+    {
+      /* Not yet established */
+
+      return UINT32_MAX;
+    }
+
+  /* After a timeout, the data from snduna is sent again so the amount in
+   * flight is measured from snduna to where we are sending now rather
+   * than to the highest sequence number ever sent.
+   */
+
+  flight = TCP_SEQ_GT(sndnxt, conn->snduna) ? sndnxt - conn->snduna : 0;
+  return conn->cwnd > flight ? conn->cwnd - flight : 0;
+}
+
+#endif /* CONFIG_NET && CONFIG_NET_TCP && CONFIG_NET_TCP_CC */
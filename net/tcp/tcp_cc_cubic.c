@@ -0,0 +1,304 @@
+/****************************************************************************
+ * net/tcp/tcp_cc_cubic.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#if defined(CONFIG_NET) && defined(CONFIG_NET_TCP) && \
+    defined(CONFIG_NET_TCP_CC) && defined(CONFIG_NET_TCP_CC_CUBIC)
+
+#include <stdint.h>
+
+#include <nuttx/clock.h>
+
+#include "tcp/tcp.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* CUBIC state held in the connection's cc_priv[] words */
+
+#define CUBIC_WMAX(c)     ((c)->cc_priv[0]) /* Window before the last
+                                             * reduction (bytes) */
+#define CUBIC_EPOCH(c)    ((c)->cc_priv[1]) /* Start of the current epoch
+                                             * (msec, 0 if none) */
+#define CUBIC_K(c)        ((c)->cc_priv[2]) /* Time to reach W_max (msec) */
+#define CUBIC_ORIGIN(c)   ((c)->cc_priv[3]) /* Origin point of the cubic
+                                             * function (bytes) */
+#define CUBIC_WEST(c)     ((c)->cc_priv[4]) /* Reno-friendly window
+                                             * estimate (bytes) */
+
+/* The constants of RFC 8312 are C = 0.4 and beta_cubic = 0.7.  In the
+ * integer arithmetic below, times are in milliseconds so:
+ *
+ *   W(t) = C * t^3          -> segments = 4 * t_ms^3 / 10^10
+ *   K    = cbrt(dW / C)     -> K_ms     = cbrt(dW_seg * 2.5 * 10^9)
+ *
+ * The cubic term is computed in 1/64 segments and the time offset is
+ * limited so that t^3 << 6 cannot overflow 64 bits.
+ */
+
+#define CUBIC_BETA_NUM    7   /* beta_cubic = 7 / 10 */
+#define CUBIC_BETA_DEN    10
+#define CUBIC_KSCALE      2500000000ull
+#define CUBIC_CDIV        10000000000ull
+#define CUBIC_MAXOFFS     (1ul << 18)
+
+/* Msec per tick of the TCP timer in which the smoothed RTT is held */
+
+#define CUBIC_TIMER_MSEC  500
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static void cubic_cong_avoid(FAR struct tcp_conn_s *conn, uint32_t acked);
+static uint32_t cubic_ssthresh(FAR struct tcp_conn_s *conn);
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+struct tcp_cc_ops_s g_tcp_cubic =
+{
+  NULL,                 /* flink */
+  "cubic",              /* name */
+  NULL,                 /* init */
+  cubic_cong_avoid,     /* cong_avoid */
+  cubic_ssthresh        /* ssthresh */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cubic_cbrt
+ *
+ * Description:
+ *   Return the integer cube root of 'a', rounded down.
+ *
+ ****************************************************************************/
+
+static uint32_t cubic_cbrt(uint64_t a)
+{
+  uint64_t x = 0;
+  int shift;
+
+  /* Compute one bit at a time, most significant first */
+
+  for (shift = 63; shift >= 0; shift -= 3)
+    {
+      uint64_t b;
+
+      x <<= 1;
+      b    = 3 * x * (x + 1) + 1;
+      if ((a >> shift) >= b)
+        {
+          a -= b << shift;
+          x++;
+        }
+    }
+
+  return (uint32_t)x;
+}
+
+/****************************************************************************
+ * Name: cubic_msec
+ *
+ * Description:
+ *   Return the current time in milliseconds, never zero.
+ *
+ ****************************************************************************/
+
+static uint32_t cubic_msec(void)
+{
+  uint32_t now = (uint32_t)TICK2MSEC(clock_systimer());
+
+  return now != 0 ? now : 1;
+}
+
+/****************************************************************************
+ * Name: cubic_cong_avoid
+ *
+ * Description:
+ *   Grow the congestion window.  In slow start this is the same as
+ *   NewReno.  Otherwise the window follows the cubic function of the time
+ *   since the last reduction (RFC 8312, section 4), but never grows more
+ *   slowly than standard TCP would in the same conditions.
+ *
+ ****************************************************************************/
+
+static void cubic_cong_avoid(FAR struct tcp_conn_s *conn, uint32_t acked)
+{
+  uint32_t mss  = conn->mss;
+  uint32_t cwnd = conn->cwnd;
+  uint32_t target;
+  uint32_t offs;
+  uint32_t t;
+  uint64_t delta;
+  uint64_t incr;
+
+  if (cwnd < conn->ssthresh)
+    {
+      conn->cwnd += acked < 2 * mss ? acked : 2 * mss;
+      return;
+    }
+
+  /* Start a new epoch on the first ACK after a reduction */
+
+  if (CUBIC_EPOCH(conn) == 0)
+    {
+      CUBIC_EPOCH(conn) = cubic_msec();
+      if (cwnd < CUBIC_WMAX(conn))
+        {
+          CUBIC_K(conn)      = cubic_cbrt((uint64_t)
+                                          (CUBIC_WMAX(conn) - cwnd) *
+                                          CUBIC_KSCALE / mss);
+          CUBIC_ORIGIN(conn) = CUBIC_WMAX(conn);
+        }
+      else
+        {
+          CUBIC_K(conn)      = 0;
+          CUBIC_ORIGIN(conn) = cwnd;
+        }
+
+      CUBIC_WEST(conn) = cwnd;
+    }
+
+  /* t is the time since the epoch began plus one round trip (the window
+   * that we are growing now will take effect one RTT from now).
+   */
+
+  t = cubic_msec() - CUBIC_EPOCH(conn) +
+      (conn->sa >> 3) * CUBIC_TIMER_MSEC;
+
+  offs = t > CUBIC_K(conn) ? t - CUBIC_K(conn) : CUBIC_K(conn) - t;
+  if (offs > CUBIC_MAXOFFS)
+    {
+      offs = CUBIC_MAXOFFS;
+    }
+
+  delta = (((uint64_t)offs * offs * offs) << 6) / CUBIC_CDIV * 4;
+  delta = (delta * mss) >> 6;
+  if (delta > UINT32_MAX / 2)
+    {
+      delta = UINT32_MAX / 2;
+    }
+
+  if (t > CUBIC_K(conn))
+    {
+      target = CUBIC_ORIGIN(conn) + (uint32_t)delta;
+    }
+  else
+    {
+      target = CUBIC_ORIGIN(conn) > delta ?
+               CUBIC_ORIGIN(conn) - (uint32_t)delta : 0;
+    }
+
+  /* Limit growth to 1.5 times the window per RTT (RFC 8312, section 4.3) */
+
+  if (target > cwnd + cwnd / 2)
+    {
+      target = cwnd + cwnd / 2;
+    }
+
+  /* The window that standard TCP would reach, 3(1-beta)/(1+beta) = 9/17
+   * segments per RTT (RFC 8312, section 4.2).
+   */
+
+  CUBIC_WEST(conn) += (uint64_t)acked * mss * 9 / (17 * (uint64_t)cwnd);
+  if (CUBIC_WEST(conn) > target)
+    {
+      target = CUBIC_WEST(conn);
+    }
+
+  if (target > cwnd)
+    {
+      incr = (uint64_t)acked * (target - cwnd) / cwnd;
+      if (incr == 0)
+        {
+          incr = 1;
+        }
+    }
+  else
+    {
+      incr = (uint64_t)acked * mss / (100 * (uint64_t)cwnd);
+    }
+
+  if (cwnd + (uint32_t)incr > cwnd)
+    {
+      conn->cwnd = cwnd + (uint32_t)incr;
+    }
+}
+
+/****************************************************************************
+ * Name: cubic_ssthresh
+ *
+ * Description:
+ *   Return the slow start threshold after a loss:  beta_cubic times the
+ *   window.  With fast convergence, a flow whose window is still below
+ *   the previous maximum releases some of its share (RFC 8312, section
+ *   4.6).
+ *
+ ****************************************************************************/
+
+static uint32_t cubic_ssthresh(FAR struct tcp_conn_s *conn)
+{
+  uint32_t mss  = conn->mss;
+  uint32_t cwnd = conn->cwnd;
+  uint32_t ssthresh;
+
+  if (cwnd < CUBIC_WMAX(conn))
+    {
+      CUBIC_WMAX(conn) = (uint64_t)cwnd * (CUBIC_BETA_DEN + CUBIC_BETA_NUM) /
+                         (2 * CUBIC_BETA_DEN);
+    }
+  else
+    {
+      CUBIC_WMAX(conn) = cwnd;
+    }
+
+  CUBIC_EPOCH(conn) = 0;
+
+  ssthresh = (uint64_t)cwnd * CUBIC_BETA_NUM / CUBIC_BETA_DEN;
+  return ssthresh > 2 * mss ? ssthresh : 2 * mss;
+}
+
+#endif /* CONFIG_NET && CONFIG_NET_TCP && CONFIG_NET_TCP_CC &&
+        * CONFIG_NET_TCP_CC_CUBIC */
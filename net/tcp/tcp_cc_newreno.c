@@ -0,0 +1,122 @@
+/****************************************************************************
+ * net/tcp/tcp_cc_newreno.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#if defined(CONFIG_NET) && defined(CONFIG_NET_TCP) && defined(CONFIG_NET_TCP_CC)
+
+#include <stdint.h>
+
+#include "tcp/tcp.h"
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static void newreno_cong_avoid(FAR struct tcp_conn_s *conn, uint32_t acked);
+static uint32_t newreno_ssthresh(FAR struct tcp_conn_s *conn);
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+struct tcp_cc_ops_s g_tcp_newreno =
+{
+  NULL,                 /* flink */
+  "newreno",            /* name */
+  NULL,                 /* init */
+  newreno_cong_avoid,   /* cong_avoid */
+  newreno_ssthresh      /* ssthresh */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: newreno_cong_avoid
+ *
+ * Description:
+ *   Grow the congestion window (RFC 5681, section 3.1).  In slow start the
+ *   window grows by the number of bytes acknowledged, limited to two
+ *   segments per ACK to allow for ACK division (RFC 3465).  In congestion
+ *   avoidance it grows by about one segment per round trip.
+ *
+ ****************************************************************************/
+
+static void newreno_cong_avoid(FAR struct tcp_conn_s *conn, uint32_t acked)
+{
+  uint32_t mss = conn->mss;
+  uint32_t incr;
+
+  if (conn->cwnd < conn->ssthresh)
+    {
+      incr = acked < 2 * mss ? acked : 2 * mss;
+    }
+  else
+    {
+      incr = (mss * mss) / conn->cwnd;
+      if (incr == 0)
+        {
+          incr = 1;
+        }
+    }
+
+  if (conn->cwnd + incr > conn->cwnd)
+    {
+      conn->cwnd += incr;
+    }
+}
+
+/****************************************************************************
+ * Name: newreno_ssthresh
+ *
+ * Description:
+ *   Return the slow start threshold after a loss:  half of the data in
+ *   flight but no less than two segments (RFC 5681, equation 4).
+ *
+ ****************************************************************************/
+
+static uint32_t newreno_ssthresh(FAR struct tcp_conn_s *conn)
+{
+  uint32_t half = conn->unacked / 2;
+
+  return half > 2 * (uint32_t)conn->mss ? half : 2 * (uint32_t)conn->mss;
+}
+
+#endif /* CONFIG_NET && CONFIG_NET_TCP && CONFIG_NET_TCP_CC */
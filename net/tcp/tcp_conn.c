@@ -722,6 +722,9 @@ FAR struct tcp_conn_s *tcp_alloc(uint8_t domain)
       conn->keepidle      = 2 * DSEC_PER_HOUR;
       conn->keepintvl     = 2 * DSEC_PER_SEC;
       conn->keepcnt       = 3;
+#endif
+#ifdef CONFIG_NET_TCP_CC
+      conn->cc_ops        = tcp_cc_default();
 #endif
     }
 
@@ -780,6 +783,12 @@ void tcp_free(FAR struct tcp_conn_s *conn)
   iob_free_queue(&conn->readahead);
 #endif
 
+#ifdef CONFIG_NET_TCP_SACK
+  /* Release any out-of-order segments held for the connection */
+
+  tcp_ofo_free(conn);
+#endif
+
 #ifdef CONFIG_NET_TCP_WRITE_BUFFERS
   /* Release any write buffers attached to the connection */
 
@@ -41,6 +41,7 @@
 
 #include <sys/time.h>
 #include <stdint.h>
+#include <string.h>
 #include <errno.h>
 #include <assert.h>
 #include <debug.h>
@@ -97,9 +98,9 @@
 int tcp_getsockopt(FAR struct socket *psock, int option,
                    FAR void *value, FAR socklen_t *value_len)
 {
-#ifdef CONFIG_NET_TCP_KEEPALIVE
-  /* Keep alive options are the only TCP protocol socket option currently
-   * supported.
+#if defined(CONFIG_NET_TCP_KEEPALIVE) || defined(CONFIG_NET_TCP_CC)
+  /* Keep alive options and the congestion control algorithm are the only
+   * TCP protocol socket options currently supported.
    */
 
   FAR struct tcp_conn_s *conn;
@@ -120,10 +121,9 @@ int tcp_getsockopt(FAR struct socket *psock, int option,
       return -ENOTCONN;
     }
 
-  /* Handle the Keep-Alive option */
-
   switch (option)
     {
+#ifdef CONFIG_NET_TCP_KEEPALIVE
       /* Handle the SO_KEEPALIVE socket-level option.
        *
        * NOTE: SO_KEEPALIVE is not really a socket-level option; it is a
@@ -152,12 +152,14 @@ int tcp_getsockopt(FAR struct socket *psock, int option,
             ret                = OK;
           }
         break;
+#endif /* CONFIG_NET_TCP_KEEPALIVE */
 
       case TCP_NODELAY:  /* Avoid coalescing of small segments. */
         nerr("ERROR: TCP_NODELAY not supported\n");
         ret = -ENOSYS;
         break;
 
+#ifdef CONFIG_NET_TCP_KEEPALIVE
       case TCP_KEEPIDLE:  /* Start keepalives after this IDLE period */
         if (*value_len < sizeof(struct timeval))
           {
@@ -238,6 +240,37 @@ int tcp_getsockopt(FAR struct socket *psock, int option,
             ret              = OK;
           }
         break;
+#endif /* CONFIG_NET_TCP_KEEPALIVE */
+
+#ifdef CONFIG_NET_TCP_CC
+      case TCP_CONGESTION:  /* Congestion control algorithm */
+        if (*value_len == 0)
+          {
+            ret = -EINVAL;
+          }
+        else
+          {
+            /* Return the name, truncated if necessary, with a NUL
+             * terminator if there is room for one.
+             */
+
+            socklen_t len = strnlen(conn->cc_ops->name, TCP_CA_NAME_MAX);
+
+            if (len < *value_len)
+              {
+                len++;
+              }
+            else
+              {
+                len = *value_len;
+              }
+
+            memcpy(value, conn->cc_ops->name, len);
+            *value_len = len;
+            ret        = OK;
+          }
+        break;
+#endif /* CONFIG_NET_TCP_CC */
 
       default:
         nerr("ERROR: Unrecognized TCP option: %d\n", option);
@@ -248,7 +281,7 @@ int tcp_getsockopt(FAR struct socket *psock, int option,
   return ret;
 #else
   return -ENOPROTOOPT;
-#endif /* CONFIG_NET_TCP_KEEPALIVE */
+#endif /* CONFIG_NET_TCP_KEEPALIVE || CONFIG_NET_TCP_CC */
 }
 
 #endif /* CONFIG_NET_TCPPROTO_OPTIONS */
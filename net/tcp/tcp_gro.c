@@ -0,0 +1,293 @@
+/****************************************************************************
+ * net/tcp/tcp_gro.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#if defined(CONFIG_NET) && defined(CONFIG_NET_TCP_GRO) && \
+    defined(CONFIG_NET_IPv4)
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <debug.h>
+
+#include <nuttx/net/netconfig.h>
+#include <nuttx/net/netdev.h>
+#include <nuttx/net/ip.h>
+#include <nuttx/net/tcp.h>
+
+#include "utils/utils.h"
+#include "tcp/tcp.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define IPv4BUF ((FAR struct ipv4_hdr_s *)&dev->d_buf[NET_LL_HDRLEN(dev)])
+#define TCPBUF  ((FAR struct tcp_hdr_s *) \
+                 &dev->d_buf[NET_LL_HDRLEN(dev) + IPv4_HDRLEN])
+
+/* Read a 16-bit, network order value as a host integer */
+
+#define GRO_GET16(p)  (((uint16_t)((FAR const uint8_t *)(p))[0] << 8) | \
+                       ((FAR const uint8_t *)(p))[1])
+#define GRO_PUT16(p,v) \
+  do \
+    { \
+      ((FAR uint8_t *)(p))[0] = (uint8_t)((v) >> 8); \
+      ((FAR uint8_t *)(p))[1] = (uint8_t)((v) & 0xff); \
+    } \
+  while (0)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: gro_add
+ *
+ * Description:
+ *   One's complement addition of two 16-bit values.
+ *
+ ****************************************************************************/
+
+static inline uint16_t gro_add(uint16_t a, uint16_t b)
+{
+  uint32_t sum = (uint32_t)a + b;
+  return (uint16_t)((sum & 0xffff) + (sum >> 16));
+}
+
+/****************************************************************************
+ * Name: gro_adjust
+ *
+ * Description:
+ *   Incrementally update the checksum 'hc' for a 16-bit field that changed
+ *   from 'm' to 'mnew' (RFC 1624, eqn. 3).
+ *
+ ****************************************************************************/
+
+static inline uint16_t gro_adjust(uint16_t hc, uint16_t m, uint16_t mnew)
+{
+  return ~gro_add(gro_add(~hc, ~m), mnew);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: tcp_gro_merge
+ *
+ * Description:
+ *   Software TCP receive coalescing.  If 'frame' is the next, in-order TCP
+ *   data segment of the same flow as the packet in d_buf, then append its
+ *   payload to the packet in d_buf.
+ *
+ *   The checksums of the merged packet are updated incrementally.  The new
+ *   segment is verified before it is merged, but the packet in d_buf is
+ *   not:  Any error in it is carried into the merged checksums and so is
+ *   still detected by ipv4_input() and tcp_input().
+ *
+ * Input Parameters:
+ *   dev      - The device with a received frame in d_buf
+ *   frame    - The next received frame, including the link layer header
+ *   framelen - The length of the frame
+ *
+ * Returned Value:
+ *   Zero (OK) if the frame was merged into d_buf; a negated errno value if
+ *   it could not be merged.
+ *
+ * Assumptions:
+ *   Called from the network driver with the network locked.
+ *
+ ****************************************************************************/
+
+int tcp_gro_merge(FAR struct net_driver_s *dev, FAR const uint8_t *frame,
+                  uint16_t framelen)
+{
+  FAR struct ipv4_hdr_s *ipv4;
+  FAR struct tcp_hdr_s *tcp;
+  FAR const struct ipv4_hdr_s *nipv4;
+  FAR const struct tcp_hdr_s *ntcp;
+  FAR const uint8_t *payload;
+  unsigned int llhdrlen;
+  uint16_t iplen;
+  uint16_t niplen;
+  uint16_t paylen;
+  uint16_t npaylen;
+  uint16_t psum;
+  uint16_t sum;
+  uint16_t hc;
+  int i;
+
+  DEBUGASSERT(dev != NULL && frame != NULL);
+
+  llhdrlen = NET_LL_HDRLEN(dev);
+  if (dev->d_gsosize == 0 ||
+      dev->d_len < llhdrlen + IPv4TCP_HDRLEN ||
+      framelen < llhdrlen + IPv4TCP_HDRLEN ||
+      memcmp(dev->d_buf, frame, llhdrlen) != 0)
+    {
+      return -EINVAL;
+    }
+
+  ipv4  = IPv4BUF;
+  tcp   = TCPBUF;
+  nipv4 = (FAR const struct ipv4_hdr_s *)&frame[llhdrlen];
+  ntcp  = (FAR const struct tcp_hdr_s *)&frame[llhdrlen + IPv4_HDRLEN];
+
+  /* Both must be unfragmented IPv4 TCP packets without options, addressed
+   * to us and belonging to the same connection.
+   */
+
+  if (ipv4->vhl != 0x45 || nipv4->vhl != 0x45 ||
+      ipv4->proto != IP_PROTO_TCP || nipv4->proto != IP_PROTO_TCP ||
+      (ipv4->ipoffset[0] & 0x3f) != 0 || ipv4->ipoffset[1] != 0 ||
+      (nipv4->ipoffset[0] & 0x3f) != 0 || nipv4->ipoffset[1] != 0 ||
+      tcp->tcpoffset != 0x50 || ntcp->tcpoffset != 0x50)
+    {
+      return -EINVAL;
+    }
+
+  if (!net_ipv4addr_cmp(net_ip4addr_conv32(ipv4->destipaddr),
+                        dev->d_ipaddr) ||
+      memcmp(ipv4->srcipaddr, nipv4->srcipaddr,
+             2 * sizeof(in_addr_t)) != 0 ||
+      tcp->srcport != ntcp->srcport || tcp->destport != ntcp->destport)
+    {
+      return -EINVAL;
+    }
+
+  /* Only pure data segments are merged:  The held segment must carry
+   * only ACK and the new one only ACK and, perhaps, PSH.
+   */
+
+  if ((tcp->flags & TCP_CTL) != TCP_ACK ||
+      (ntcp->flags & TCP_CTL & ~TCP_PSH) != TCP_ACK)
+    {
+      return -EINVAL;
+    }
+
+  iplen  = GRO_GET16(ipv4->len);
+  niplen = GRO_GET16(nipv4->len);
+
+  if (llhdrlen + iplen != dev->d_len || llhdrlen + niplen > framelen ||
+      iplen <= IPv4TCP_HDRLEN || niplen <= IPv4TCP_HDRLEN)
+    {
+      return -EINVAL;
+    }
+
+  paylen  = iplen - IPv4TCP_HDRLEN;
+  npaylen = niplen - IPv4TCP_HDRLEN;
+
+  if (dev->d_len + npaylen > dev->d_gsosize ||
+      tcp_getsequence((FAR uint8_t *)ntcp->seqno) !=
+      tcp_getsequence(tcp->seqno) + paylen)
+    {
+      return -EINVAL;
+    }
+
+  /* Verify the new segment.  Its payload sum is kept for the incremental
+   * update below.
+   */
+
+  if (chksum(0, (FAR const uint8_t *)nipv4, IPv4_HDRLEN) != 0xffff)
+    {
+      return -EINVAL;
+    }
+
+  payload = &frame[llhdrlen + IPv4TCP_HDRLEN];
+  psum    = chksum(0, payload, npaylen);
+
+  sum = TCP_HDRLEN + npaylen + IP_PROTO_TCP;
+  sum = chksum(sum, (FAR const uint8_t *)nipv4->srcipaddr,
+               2 * sizeof(in_addr_t));
+  sum = chksum(sum, (FAR const uint8_t *)ntcp, TCP_HDRLEN);
+
+  if (gro_add(sum, psum) != 0xffff)
+    {
+      return -EINVAL;
+    }
+
+  /* Append the payload and update the IP header */
+
+  memcpy(&dev->d_buf[dev->d_len], payload, npaylen);
+  dev->d_len += npaylen;
+
+  hc = GRO_GET16(&ipv4->ipchksum);
+  hc = gro_adjust(hc, iplen, iplen + npaylen);
+  GRO_PUT16(&ipv4->ipchksum, hc);
+  GRO_PUT16(ipv4->len, iplen + npaylen);
+
+  /* Update the TCP checksum for the pseudo-header length, the ACK number,
+   * flags and window taken from the new segment, and the added payload.
+   * If the held payload has an odd length, then the new payload is summed
+   * at odd offsets which is the same as byte-swapping its sum.
+   */
+
+  hc = GRO_GET16(&tcp->tcpchksum);
+  hc = gro_adjust(hc, TCP_HDRLEN + paylen, TCP_HDRLEN + paylen + npaylen);
+
+  for (i = 0; i < 4; i += 2)
+    {
+      hc = gro_adjust(hc, GRO_GET16(&tcp->ackno[i]),
+                      GRO_GET16(&ntcp->ackno[i]));
+    }
+
+  hc = gro_adjust(hc, GRO_GET16(&tcp->tcpoffset),
+                  GRO_GET16(&ntcp->tcpoffset));
+  hc = gro_adjust(hc, GRO_GET16(tcp->wnd), GRO_GET16(ntcp->wnd));
+
+  if ((paylen & 1) != 0)
+    {
+      psum = (psum << 8) | (psum >> 8);
+    }
+
+  hc = ~gro_add(~hc, psum);
+  GRO_PUT16(&tcp->tcpchksum, hc);
+
+  memcpy(tcp->ackno, ntcp->ackno, 4);
+  tcp->flags  = ntcp->flags;
+  tcp->wnd[0] = ntcp->wnd[0];
+  tcp->wnd[1] = ntcp->wnd[1];
+
+  return OK;
+}
+
+#endif /* CONFIG_NET && CONFIG_NET_TCP_GRO && CONFIG_NET_IPv4 */
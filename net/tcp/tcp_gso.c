@@ -0,0 +1,224 @@
+/****************************************************************************
+ * net/tcp/tcp_gso.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#if defined(CONFIG_NET) && defined(CONFIG_NET_TCP_GSO) && \
+    defined(CONFIG_NET_IPv4)
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <debug.h>
+
+#include <nuttx/net/netconfig.h>
+#include <nuttx/net/netdev.h>
+#include <nuttx/net/netstats.h>
+#include <nuttx/net/ip.h>
+#include <nuttx/net/tcp.h>
+
+#include "inet/inet.h"
+#include "utils/utils.h"
+#include "tcp/tcp.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define IPv4BUF ((FAR struct ipv4_hdr_s *)&dev->d_buf[NET_LL_HDRLEN(dev)])
+#define TCPBUF  ((FAR struct tcp_hdr_s *) \
+                 &dev->d_buf[NET_LL_HDRLEN(dev) + IPv4_HDRLEN])
+
+/* Largest header that we will replicate:  link layer + IPv4 + TCP with
+ * options.
+ */
+
+#define GSO_MAXLLHDRLEN 32
+#define GSO_MAXHDRLEN   (GSO_MAXLLHDRLEN + IPv4_HDRLEN + 60)
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: tcp_gso_segment
+ *
+ * Description:
+ *   Split the TCP super-segment in d_buf into segments of d_gsomss bytes
+ *   of payload and pass each to the driver's output function.
+ *
+ *   This is done in place:  The headers of the super-segment are saved
+ *   and, for the k'th segment, they are written immediately in front of
+ *   that segment's payload, over the tail of the (already transmitted)
+ *   payload of the previous segment.  The output function must therefore
+ *   be finished with each segment before it returns.
+ *
+ * Input Parameters:
+ *   dev    - The device with an outgoing packet in d_buf
+ *   output - The driver function that transmits d_buf/d_len
+ *
+ * Returned Value:
+ *   The return value of the last call to 'output'.
+ *
+ * Assumptions:
+ *   Called with the network locked.
+ *
+ ****************************************************************************/
+
+int tcp_gso_segment(FAR struct net_driver_s *dev,
+                    devif_poll_callback_t output)
+{
+  uint8_t hdr[GSO_MAXHDRLEN];
+  FAR uint8_t *buf;
+  FAR struct ipv4_hdr_s *ipv4;
+  FAR struct tcp_hdr_s *tcp;
+  unsigned int hdrlen;
+  unsigned int paylen;
+  unsigned int seglen;
+  unsigned int offset;
+  uint32_t seqno;
+  uint16_t len;
+  uint8_t flags;
+  int ret;
+
+  DEBUGASSERT(dev != NULL && output != NULL);
+
+  seglen        = dev->d_gsomss;
+  dev->d_gsomss = 0;
+
+  /* Verify that this is really an IPv4 TCP super-segment.  The packet in
+   * d_buf may have been replaced (with an ARP request, for example) after
+   * the TCP layer set d_gsomss.
+   */
+
+  ipv4 = IPv4BUF;
+  tcp  = TCPBUF;
+
+  if (seglen == 0 || ipv4->vhl != 0x45 || ipv4->proto != IP_PROTO_TCP)
+    {
+      return output(dev);
+    }
+
+  hdrlen = NET_LL_HDRLEN(dev) + IPv4_HDRLEN + ((tcp->tcpoffset >> 4) << 2);
+  len    = ((uint16_t)ipv4->len[0] << 8) + ipv4->len[1];
+
+  if (hdrlen > GSO_MAXHDRLEN ||
+      NET_LL_HDRLEN(dev) + len != dev->d_len ||
+      dev->d_len <= hdrlen + seglen)
+    {
+      return output(dev);
+    }
+
+  /* Keep all segments but the last a multiple of four bytes so that the
+   * headers replicated in the payload remain aligned.
+   */
+
+  if (seglen > 4)
+    {
+      seglen &= ~3;
+    }
+
+  memcpy(hdr, dev->d_buf, hdrlen);
+
+  buf    = dev->d_buf;
+  paylen = dev->d_len - hdrlen;
+  seqno  = tcp_getsequence(tcp->seqno);
+  flags  = tcp->flags;
+  ret    = OK;
+
+  for (offset = 0; offset < paylen; offset += seglen)
+    {
+      unsigned int thislen = paylen - offset;
+
+      if (thislen > seglen)
+        {
+          thislen = seglen;
+        }
+
+      /* Replicate the headers in front of this segment's payload */
+
+      dev->d_buf = buf + offset;
+      if (offset > 0)
+        {
+          memcpy(dev->d_buf, hdr, hdrlen);
+        }
+
+      dev->d_len = hdrlen + thislen;
+      ipv4       = IPv4BUF;
+      tcp        = TCPBUF;
+
+      /* PSH and FIN belong only to the final segment */
+
+      tcp->flags = flags;
+      if (offset + thislen < paylen)
+        {
+          tcp->flags &= ~(TCP_PSH | TCP_FIN);
+        }
+
+      tcp_setsequence(tcp->seqno, seqno + offset);
+
+      len            = dev->d_len - NET_LL_HDRLEN(dev);
+      ipv4->len[0]   = len >> 8;
+      ipv4->len[1]   = len & 0xff;
+
+      if (offset > 0)
+        {
+          ++g_ipid;
+          ipv4->ipid[0] = g_ipid >> 8;
+          ipv4->ipid[1] = g_ipid & 0xff;
+
+#ifdef CONFIG_NET_STATISTICS
+          g_netstats.ipv4.sent++;
+#endif
+        }
+
+      tcp->tcpchksum = 0;
+      tcp->tcpchksum = ~tcp_ipv4_chksum(dev);
+
+      ipv4->ipchksum = 0;
+      ipv4->ipchksum = ~ipv4_chksum(dev);
+
+      ret = output(dev);
+    }
+
+  dev->d_buf = buf;
+  dev->d_len = 0;
+  return ret;
+}
+
+#endif /* CONFIG_NET && CONFIG_NET_TCP_GSO && CONFIG_NET_IPv4 */
@@ -262,11 +262,19 @@ static void tcp_input(FAR struct net_driver_s *dev, uint8_t domain,
                       tmp16 = ((uint16_t)dev->d_buf[hdrlen + 2 + i] << 8) |
                                (uint16_t)dev->d_buf[hdrlen + 3 + i];
                       conn->mss = tmp16 > tcp_mss ? tcp_mss : tmp16;
+                      i += TCP_OPT_MSS_LEN;
+                    }
+#ifdef CONFIG_NET_TCP_SACK
+                  else if (opt == TCP_OPT_SACK_PERM &&
+                           dev->d_buf[hdrlen + 1 + i] ==
+                           TCP_OPT_SACK_PERM_LEN)
+                    {
+                      /* The peer will accept selective acknowledgements */
 
-                      /* And we are done processing options. */
-
-                      break;
+                      conn->ccflags |= TCP_CC_SACKPERM;
+                      i += TCP_OPT_SACK_PERM_LEN;
                     }
+#endif
                   else
                     {
                       /* All other options have a length field, so that we easily
@@ -453,6 +461,21 @@ found:
       if ((dev->d_len > 0 || ((tcp->flags & (TCP_SYN | TCP_FIN)) != 0)) &&
           memcmp(tcp->seqno, conn->rcvseq, 4) != 0)
         {
+#ifdef CONFIG_NET_TCP_SACK
+          /* If the peer understands SACK, hold data that arrives ahead of
+           * a hole rather than dropping it.  The ACK below will then
+           * report it.
+           */
+
+          if ((conn->tcpstateflags & TCP_STATE_MASK) == TCP_ESTABLISHED &&
+              (conn->ccflags & TCP_CC_SACKPERM) != 0 && dev->d_len > 0 &&
+              (tcp->flags & (TCP_SYN | TCP_FIN | TCP_RST)) == 0)
+            {
+              (void)tcp_ofo_insert(conn, tcp_getsequence(tcp->seqno),
+                                   (FAR uint8_t *)tcp + len, dev->d_len);
+            }
+#endif
+
           tcp_send(dev, conn, TCP_ACK, tcpiplen);
           return;
         }
@@ -556,6 +579,16 @@ found:
        conn->timer = conn->rto;
     }
 
+#ifdef CONFIG_NET_TCP_CC
+  /* Let congestion control see every ACK, including duplicates */
+
+  if ((tcp->flags & TCP_ACK) != 0 &&
+      (conn->tcpstateflags & TCP_STATE_MASK) == TCP_ESTABLISHED)
+    {
+      tcp_cc_ack(conn, tcp, tcp_getsequence(tcp->ackno), dev->d_len);
+    }
+#endif
+
   /* Do different things depending on in what state the connection is. */
 
   switch (conn->tcpstateflags & TCP_STATE_MASK)
@@ -609,6 +642,9 @@ found:
             tcp_setsequence(conn->sndseq, conn->isn);
             conn->sent          = 0;
             conn->sndseq_max    = 0;
+#endif
+#ifdef CONFIG_NET_TCP_CC
+            tcp_cc_setup(conn);
 #endif
             conn->unacked       = 0;
             flags               = TCP_CONNECTED;
@@ -675,11 +711,21 @@ found:
                           (dev->d_buf[hdrlen + 2 + i] << 8) |
                           dev->d_buf[hdrlen + 3 + i];
                         conn->mss = tmp16 > tcp_mss ? tcp_mss : tmp16;
+                        i += TCP_OPT_MSS_LEN;
+                      }
+#ifdef CONFIG_NET_TCP_SACK
+                    else if (opt == TCP_OPT_SACK_PERM &&
+                             dev->d_buf[hdrlen + 1 + i] ==
+                             TCP_OPT_SACK_PERM_LEN)
+                      {
+                        /* The peer will accept selective acknowledgements.
+                         * We offered them in our SYN.
+                         */
 
-                        /* And we are done processing options. */
-
-                        break;
+                        conn->ccflags |= TCP_CC_SACKPERM;
+                        i += TCP_OPT_SACK_PERM_LEN;
                       }
+#endif
                     else
                       {
                         /* All other options have a length field, so that we
@@ -708,6 +754,9 @@ found:
 #ifdef CONFIG_NET_TCP_WRITE_BUFFERS
             conn->isn           = tcp_getsequence(tcp->ackno);
             tcp_setsequence(conn->sndseq, conn->isn);
+#endif
+#ifdef CONFIG_NET_TCP_CC
+            tcp_cc_setup(conn);
 #endif
             dev->d_len          = 0;
             dev->d_sndlen       = 0;
@@ -750,6 +799,20 @@ found:
          * sequence numbers will be screwed up.
          */
 
+#ifdef CONFIG_NET_TCP_SACK
+        /* A peer that has negotiated SACK may put SACK options on its data
+         * segments.  The data handlers expect the data to follow a TCP
+         * header without options, so move it down over the options.
+         */
+
+        if (dev->d_len > 0 && len > TCP_HDRLEN)
+          {
+            dev->d_appdata = (FAR uint8_t *)tcp + TCP_HDRLEN;
+            memmove(dev->d_appdata, (FAR uint8_t *)tcp + len, dev->d_len);
+          }
+
+#endif
+
         if ((tcp->flags & TCP_FIN) != 0 && (conn->tcpstateflags & TCP_STOPPED) == 0)
           {
             /* Needs to be investigated further.
@@ -890,6 +953,14 @@ found:
                 /* Update the sequence number using the saved length */
 
                 net_incr32(conn->rcvseq, len);
+
+#ifdef CONFIG_NET_TCP_SACK
+                /* This may have filled a hole.  Deliver any held data that
+                 * now follows in sequence; the ACK will cover it too.
+                 */
+
+                (void)tcp_ofo_deliver(conn);
+#endif
               }
 
             /* Send the response, ACKing the data or not, as appropriate */
@@ -0,0 +1,686 @@
+/****************************************************************************
+ * net/tcp/tcp_sack.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#if defined(CONFIG_NET) && defined(CONFIG_NET_TCP) && \
+    defined(CONFIG_NET_TCP_SACK)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <queue.h>
+#include <errno.h>
+#include <debug.h>
+
+#include <nuttx/mm/iob.h>
+#include <nuttx/net/netconfig.h>
+#include <nuttx/net/tcp.h>
+
+#include "tcp/tcp.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Without window scaling, the peer can never send further ahead than this */
+
+#define TCP_OFO_MAXWIN  UINT16_MAX
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* An out-of-order segment held for a connection */
+
+struct tcp_ofoseg_s
+{
+  sq_entry_t node;          /* Supports a singly linked list */
+  uint32_t seqno;           /* Sequence number of the first byte */
+  uint16_t len;             /* Number of bytes of data */
+  FAR struct iob_s *iob;    /* The data */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The pool of out-of-order segment containers, shared by all connections */
+
+static struct tcp_ofoseg_s g_ofosegs[CONFIG_NET_TCP_SACK_NOFOSEGS];
+static sq_queue_t g_ofofree;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: tcp_sack_get32
+ *
+ * Description:
+ *   Get a 32-bit value in network order from an unaligned option.
+ *
+ ****************************************************************************/
+
+static uint32_t tcp_sack_get32(FAR const uint8_t *ptr)
+{
+  return ((uint32_t)ptr[0] << 24) | ((uint32_t)ptr[1] << 16) |
+         ((uint32_t)ptr[2] << 8) | (uint32_t)ptr[3];
+}
+
+/****************************************************************************
+ * Name: tcp_sack_put32
+ *
+ * Description:
+ *   Put a 32-bit value in network order into an unaligned option.
+ *
+ ****************************************************************************/
+
+static void tcp_sack_put32(FAR uint8_t *ptr, uint32_t value)
+{
+  ptr[0] = value >> 24;
+  ptr[1] = value >> 16;
+  ptr[2] = value >> 8;
+  ptr[3] = value;
+}
+
+/****************************************************************************
+ * Name: tcp_sack_merge
+ *
+ * Description:
+ *   Add one block to the sorted, non-overlapping list 'blk' of 'nblk'
+ *   entries.  'blk' must have room for one more entry.  The new number of
+ *   entries is returned.
+ *
+ ****************************************************************************/
+
+static int tcp_sack_merge(FAR struct tcp_sack_s *blk, int nblk,
+                          uint32_t left, uint32_t right)
+{
+  int i;
+  int j;
+
+  /* Find the first block that ends at or after the new one begins */
+
+  for (i = 0; i < nblk && TCP_SEQ_LT(blk[i].right, left); i++)
+    {
+    }
+
+  if (i < nblk && !TCP_SEQ_GT(blk[i].left, right))
+    {
+      /* It overlaps or abuts the new block.  Extend it and absorb any
+       * following blocks that now overlap too.
+       */
+
+      if (TCP_SEQ_LT(left, blk[i].left))
+        {
+          blk[i].left = left;
+        }
+
+      if (TCP_SEQ_GT(right, blk[i].right))
+        {
+          blk[i].right = right;
+        }
+
+      for (j = i + 1;
+           j < nblk && !TCP_SEQ_GT(blk[j].left, blk[i].right);
+           j++)
+        {
+          if (TCP_SEQ_GT(blk[j].right, blk[i].right))
+            {
+              blk[i].right = blk[j].right;
+            }
+        }
+
+      /* Close the gap left by the absorbed blocks */
+
+      for (i++; j < nblk; i++, j++)
+        {
+          blk[i] = blk[j];
+        }
+
+      return i;
+    }
+
+  /* Otherwise insert a new block at position i */
+
+  for (j = nblk; j > i; j--)
+    {
+      blk[j] = blk[j - 1];
+    }
+
+  blk[i].left  = left;
+  blk[i].right = right;
+  return nblk + 1;
+}
+
+/****************************************************************************
+ * Name: tcp_ofo_release
+ *
+ * Description:
+ *   Free the data of an out-of-order segment and return the container to
+ *   the free list.
+ *
+ ****************************************************************************/
+
+static void tcp_ofo_release(FAR struct tcp_ofoseg_s *seg)
+{
+  if (seg->iob != NULL)
+    {
+      iob_free_chain(seg->iob);
+      seg->iob = NULL;
+    }
+
+  sq_addlast(&seg->node, &g_ofofree);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: tcp_sack_initialize
+ *
+ * Description:
+ *   Initialize the pool of out-of-order segment containers.
+ *
+ * Assumptions:
+ *   Called once early initialization.
+ *
+ ****************************************************************************/
+
+void tcp_sack_initialize(void)
+{
+  int i;
+
+  sq_init(&g_ofofree);
+  for (i = 0; i < CONFIG_NET_TCP_SACK_NOFOSEGS; i++)
+    {
+      sq_addlast(&g_ofosegs[i].node, &g_ofofree);
+    }
+}
+
+/****************************************************************************
+ * Name: tcp_sack_update
+ *
+ * Description:
+ *   Merge the SACK blocks carried in the options of an incoming segment
+ *   into the connection's scoreboard and discard blocks that are now
+ *   cumulatively acknowledged.
+ *
+ * Input Parameters:
+ *   conn - The TCP connection
+ *   tcp  - The TCP header of the incoming segment
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+void tcp_sack_update(FAR struct tcp_conn_s *conn, FAR struct tcp_hdr_s *tcp)
+{
+  struct tcp_sack_s blk[TCP_SACK_NBLOCKS + 1];
+  FAR const uint8_t *opt = (FAR const uint8_t *)tcp + TCP_HDRLEN;
+  uint16_t optlen = ((tcp->tcpoffset >> 4) << 2) - TCP_HDRLEN;
+  int nblk = 0;
+  int i;
+
+  /* Keep the blocks that are still above the cumulative ACK */
+
+  for (i = 0; i < conn->nsack; i++)
+    {
+      if (TCP_SEQ_GT(conn->sack[i].right, conn->snduna))
+        {
+          blk[nblk] = conn->sack[i];
+          if (TCP_SEQ_LT(blk[nblk].left, conn->snduna))
+            {
+              blk[nblk].left = conn->snduna;
+            }
+
+          nblk++;
+        }
+    }
+
+  /* Then add any reported in this segment */
+
+  for (i = 0; i < optlen; )
+    {
+      uint8_t kind = opt[i];
+      uint8_t len;
+
+      if (kind == TCP_OPT_END)
+        {
+          break;
+        }
+      else if (kind == TCP_OPT_NOOP)
+        {
+          i++;
+          continue;
+        }
+
+      if (i + 1 >= optlen || (len = opt[i + 1]) < 2 || i + len > optlen)
+        {
+          break;
+        }
+
+      if (kind == TCP_OPT_SACK && ((len - 2) & 7) == 0)
+        {
+          FAR const uint8_t *ptr;
+
+          for (ptr = &opt[i + 2]; ptr < &opt[i + len]; ptr += 8)
+            {
+              uint32_t left  = tcp_sack_get32(ptr);
+              uint32_t right = tcp_sack_get32(ptr + 4);
+
+              /* Ignore blocks that are empty, already ACKed, or report
+               * data that we have never sent.
+               */
+
+              if (!TCP_SEQ_LT(left, right) ||
+                  !TCP_SEQ_GT(right, conn->snduna) ||
+                  TCP_SEQ_GT(right, conn->sndseq_max))
+                {
+                  continue;
+                }
+
+              if (TCP_SEQ_LT(left, conn->snduna))
+                {
+                  left = conn->snduna;
+                }
+
+              conn->ccstats.sackblocks++;
+
+              /* Keep the lowest blocks if there are too many; those
+               * describe the holes that must be filled first.
+               */
+
+              nblk = tcp_sack_merge(blk, nblk, left, right);
+              if (nblk > TCP_SACK_NBLOCKS)
+                {
+                  nblk = TCP_SACK_NBLOCKS;
+                }
+            }
+        }
+
+      i += len;
+    }
+
+  for (i = 0; i < nblk; i++)
+    {
+      conn->sack[i] = blk[i];
+    }
+
+  conn->nsack = nblk;
+}
+
+/****************************************************************************
+ * Name: tcp_sack_nexthole
+ *
+ * Description:
+ *   Find the next unacknowledged range at or after *seq that lies below a
+ *   block SACKed by the peer.
+ *
+ * Input Parameters:
+ *   conn - The TCP connection
+ *   seq  - In: where to begin looking.  Out: the start of the hole.
+ *   len  - Out: the length of the hole.
+ *
+ * Returned Value:
+ *   true if a hole was found.
+ *
+ ****************************************************************************/
+
+bool tcp_sack_nexthole(FAR struct tcp_conn_s *conn, FAR uint32_t *seq,
+                       FAR uint32_t *len)
+{
+  uint32_t start = *seq;
+  int i;
+
+  if (TCP_SEQ_LT(start, conn->snduna))
+    {
+      start = conn->snduna;
+    }
+
+  for (i = 0; i < conn->nsack; i++)
+    {
+      if (TCP_SEQ_LT(start, conn->sack[i].left))
+        {
+          *seq = start;
+          *len = conn->sack[i].left - start;
+          return true;
+        }
+
+      if (TCP_SEQ_LT(start, conn->sack[i].right))
+        {
+          start = conn->sack[i].right;
+        }
+    }
+
+  /* Data above the highest SACK block is not presumed lost */
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: tcp_sack_options
+ *
+ * Description:
+ *   Build the SACK option describing the out-of-order data held for this
+ *   connection.
+ *
+ * Input Parameters:
+ *   conn - The TCP connection
+ *   opt  - Where to write the option.  Must have room for
+ *          2 + TCP_OPT_SACK_LEN(TCP_SACK_NBLOCKS) bytes.
+ *
+ * Returned Value:
+ *   The number of option bytes written, a multiple of four.  Zero if no
+ *   out-of-order data is held.
+ *
+ ****************************************************************************/
+
+unsigned int tcp_sack_options(FAR struct tcp_conn_s *conn,
+                              FAR uint8_t *opt)
+{
+  struct tcp_sack_s blk[TCP_SACK_NBLOCKS];
+  FAR struct tcp_ofoseg_s *seg;
+  struct tcp_sack_s first;
+  struct tcp_sack_s cur;
+  bool havefirst = false;
+  int nblk = 0;
+  int i;
+
+  /* Walk the held segments, in sequence order, coalescing them into
+   * ranges.  The range holding the most recently received segment must be
+   * reported first (RFC 2018, section 4); the others follow in order.
+   */
+
+  seg = (FAR struct tcp_ofoseg_s *)sq_peek(&conn->ofo_q);
+  while (seg != NULL)
+    {
+      cur.left  = seg->seqno;
+      cur.right = seg->seqno + seg->len;
+
+      for (seg = (FAR struct tcp_ofoseg_s *)sq_next(&seg->node);
+           seg != NULL && !TCP_SEQ_GT(seg->seqno, cur.right);
+           seg = (FAR struct tcp_ofoseg_s *)sq_next(&seg->node))
+        {
+          if (TCP_SEQ_GT(seg->seqno + seg->len, cur.right))
+            {
+              cur.right = seg->seqno + seg->len;
+            }
+        }
+
+      if (!havefirst && !TCP_SEQ_LT(conn->ofolast, cur.left) &&
+          TCP_SEQ_LT(conn->ofolast, cur.right))
+        {
+          first     = cur;
+          havefirst = true;
+        }
+      else if (nblk < TCP_SACK_NBLOCKS - 1)
+        {
+          blk[nblk++] = cur;
+        }
+    }
+
+  if (!havefirst)
+    {
+      if (nblk == 0)
+        {
+          return 0;
+        }
+
+      first = blk[--nblk];
+    }
+
+  /* Two NOPs keep the blocks 32-bit aligned */
+
+  opt[0] = TCP_OPT_NOOP;
+  opt[1] = TCP_OPT_NOOP;
+  opt[2] = TCP_OPT_SACK;
+  opt[3] = TCP_OPT_SACK_LEN(nblk + 1);
+
+  tcp_sack_put32(&opt[4], first.left);
+  tcp_sack_put32(&opt[8], first.right);
+
+  for (i = 0; i < nblk; i++)
+    {
+      tcp_sack_put32(&opt[12 + 8 * i], blk[i].left);
+      tcp_sack_put32(&opt[16 + 8 * i], blk[i].right);
+    }
+
+  return 2 + TCP_OPT_SACK_LEN(nblk + 1);
+}
+
+/****************************************************************************
+ * Name: tcp_ofo_insert
+ *
+ * Description:
+ *   Hold a segment that arrived ahead of the next expected sequence number.
+ *
+ * Input Parameters:
+ *   conn  - The TCP connection
+ *   seqno - The sequence number of the first byte of data
+ *   data  - The segment data
+ *   len   - The length of the segment data
+ *
+ * Returned Value:
+ *   Zero (OK) if the segment was held; a negated errno value if there were
+ *   no resources or the segment lies outside the receive window.
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+int tcp_ofo_insert(FAR struct tcp_conn_s *conn, uint32_t seqno,
+                   FAR const uint8_t *data, uint16_t len)
+{
+  FAR struct tcp_ofoseg_s *seg;
+  FAR sq_entry_t *prev = NULL;
+  FAR sq_entry_t *entry;
+  uint32_t rcvseq = tcp_getsequence(conn->rcvseq);
+  int ret;
+
+  /* The segment must begin beyond the next expected byte and end within
+   * the largest window that we could have advertised.
+   */
+
+  if (!TCP_SEQ_GT(seqno, rcvseq) ||
+      seqno + len - rcvseq > TCP_OFO_MAXWIN)
+    {
+      return -EINVAL;
+    }
+
+  /* Find where it belongs.  A retransmission of data that is already held
+   * need not be held twice.
+   */
+
+  for (entry = sq_peek(&conn->ofo_q); entry != NULL; entry = sq_next(entry))
+    {
+      seg = (FAR struct tcp_ofoseg_s *)entry;
+      if (!TCP_SEQ_GT(seg->seqno, seqno) &&
+          !TCP_SEQ_LT(seg->seqno + seg->len, seqno + len))
+        {
+          conn->ofolast = seqno;
+          return OK;
+        }
+
+      if (TCP_SEQ_GT(seg->seqno, seqno))
+        {
+          break;
+        }
+
+      prev = entry;
+    }
+
+  seg = (FAR struct tcp_ofoseg_s *)sq_remfirst(&g_ofofree);
+  if (seg == NULL)
+    {
+      ninfo("No free out-of-order segments\n");
+      return -ENOMEM;
+    }
+
+  /* Copy the data into I/O buffers without waiting, leaving the throttled
+   * buffers for in-order data.
+   */
+
+  seg->iob = iob_tryalloc_size(true, len);
+  if (seg->iob == NULL)
+    {
+      tcp_ofo_release(seg);
+      return -ENOMEM;
+    }
+
+  ret = iob_trycopyin(seg->iob, data, len, 0, true);
+  if (ret < 0)
+    {
+      tcp_ofo_release(seg);
+      return ret;
+    }
+
+  seg->seqno = seqno;
+  seg->len   = len;
+
+  if (prev == NULL)
+    {
+      sq_addfirst(&seg->node, &conn->ofo_q);
+    }
+  else
+    {
+      sq_addafter(prev, &seg->node, &conn->ofo_q);
+    }
+
+  conn->ofolast = seqno;
+  conn->ccstats.ofosegs++;
+
+  ninfo("Held seqno=%u len=%u rcvseq=%u\n", seqno, len, rcvseq);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: tcp_ofo_deliver
+ *
+ * Description:
+ *   Move any held segments that are now in sequence into the read-ahead
+ *   buffers and advance rcvseq past them.
+ *
+ * Returned Value:
+ *   The number of bytes delivered.
+ *
+ * Assumptions:
+ *   The network is locked.
+ *
+ ****************************************************************************/
+
+uint32_t tcp_ofo_deliver(FAR struct tcp_conn_s *conn)
+{
+  FAR struct tcp_ofoseg_s *seg;
+  uint32_t delivered = 0;
+
+  while ((seg = (FAR struct tcp_ofoseg_s *)sq_peek(&conn->ofo_q)) != NULL)
+    {
+      uint32_t rcvseq = tcp_getsequence(conn->rcvseq);
+      uint32_t endseq = seg->seqno + seg->len;
+
+      if (TCP_SEQ_GT(seg->seqno, rcvseq))
+        {
+          /* There is still a hole before this segment */
+
+          break;
+        }
+
+      sq_remfirst(&conn->ofo_q);
+
+      if (TCP_SEQ_GT(endseq, rcvseq))
+        {
+          FAR struct iob_s *iob = seg->iob;
+          uint32_t offset = rcvseq - seg->seqno;
+
+          /* Trim any part that was received again in order */
+
+          if (offset > 0)
+            {
+              iob = iob_trimhead(iob, offset);
+            }
+
+          seg->iob = NULL;
+          if (iob_tryadd_queue(iob, &conn->readahead) < 0)
+            {
+              /* The data will have to be sent again */
+
+              iob_free_chain(iob);
+            }
+          else
+            {
+              tcp_setsequence(conn->rcvseq, endseq);
+              delivered += endseq - rcvseq;
+            }
+        }
+
+      tcp_ofo_release(seg);
+    }
+
+#ifdef CONFIG_TCP_NOTIFIER
+  if (delivered > 0)
+    {
+      tcp_readahead_signal(conn);
+    }
+#endif
+
+  return delivered;
+}
+
+/****************************************************************************
+ * Name: tcp_ofo_free
+ *
+ * Description:
+ *   Release all out-of-order segments held for a connection.
+ *
+ ****************************************************************************/
+
+void tcp_ofo_free(FAR struct tcp_conn_s *conn)
+{
+  FAR sq_entry_t *entry;
+
+  while ((entry = sq_remfirst(&conn->ofo_q)) != NULL)
+    {
+      tcp_ofo_release((FAR struct tcp_ofoseg_s *)entry);
+    }
+}
+
+#endif /* CONFIG_NET && CONFIG_NET_TCP && CONFIG_NET_TCP_SACK */
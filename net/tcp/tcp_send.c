@@ -401,10 +401,23 @@ void tcp_send(FAR struct net_driver_s *dev, FAR struct tcp_conn_s *conn,
               uint16_t flags, uint16_t len)
 {
   FAR struct tcp_hdr_s *tcp = tcp_header(dev);
+  uint16_t tcplen = TCP_HDRLEN;
+
+#ifdef CONFIG_NET_TCP_SACK
+  /* Report any data held out of order on ACKs that carry no data */
+
+  if ((flags & (TCP_SYN | TCP_RST)) == 0 && !sq_empty(&conn->ofo_q) &&
+      len == (FAR uint8_t *)tcp - &dev->d_buf[NET_LL_HDRLEN(dev)] +
+             TCP_HDRLEN)
+    {
+      tcplen += tcp_sack_options(conn, (FAR uint8_t *)tcp + TCP_HDRLEN);
+      len    += tcplen - TCP_HDRLEN;
+    }
+#endif
 
   tcp->flags     = flags;
   dev->d_len     = len;
-  tcp->tcpoffset = (TCP_HDRLEN / 4) << 4;
+  tcp->tcpoffset = (tcplen / 4) << 4;
   tcp_sendcommon(dev, conn, tcp);
 }
 
@@ -594,6 +607,24 @@ void tcp_ack(FAR struct net_driver_s *dev, FAR struct tcp_conn_s *conn,
   tcp->optdata[3] = tcp_mss & 0xff;
   tcp->tcpoffset  = ((TCP_HDRLEN + TCP_OPT_MSS_LEN) / 4) << 4;
 
+#ifdef CONFIG_NET_TCP_SACK
+  /* Offer selective acknowledgements in our SYN.  In a SYNACK, this may
+   * only be done if the peer offered them too.
+   */
+
+  if ((ack & TCP_ACK) == 0 || (conn->ccflags & TCP_CC_SACKPERM) != 0)
+    {
+      FAR uint8_t *opt = (FAR uint8_t *)tcp + TCP_HDRLEN + TCP_OPT_MSS_LEN;
+
+      opt[0]          = TCP_OPT_NOOP;
+      opt[1]          = TCP_OPT_NOOP;
+      opt[2]          = TCP_OPT_SACK_PERM;
+      opt[3]          = TCP_OPT_SACK_PERM_LEN;
+      dev->d_len     += 4;
+      tcp->tcpoffset  = ((TCP_HDRLEN + TCP_OPT_MSS_LEN + 4) / 4) << 4;
+    }
+#endif
+
   /* Complete the common portions of the TCP message */
 
   tcp_sendcommon(dev, conn, tcp);
@@ -385,6 +385,100 @@ static inline bool psock_send_addrchck(FAR struct tcp_conn_s *conn)
 #  define psock_send_addrchck(r) (true)
 #endif /* CONFIG_NET_ETHERNET */
 
+/****************************************************************************
+ * Name: psock_send_fastrexmit
+ *
+ * Description:
+ *   Retransmit the data that congestion control has found to be missing
+ *   (conn->rexmitseq and conn->rexmitlen) without waiting for the
+ *   retransmission timer.  Unlike a timeout, this does not disturb the
+ *   write queues; the data is simply sent again from where it is held.
+ *
+ * Input Parameters:
+ *   dev   - The structure of the network driver that caused the event
+ *   conn  - The connection structure associated with the socket
+ *
+ * Returned Value:
+ *   None
+ *
+ * Assumptions:
+ *   The network is locked and the outgoing packet buffer is available.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NET_TCP_CC
+static void psock_send_fastrexmit(FAR struct net_driver_s *dev,
+                                  FAR struct tcp_conn_s *conn)
+{
+  FAR struct tcp_wrbuffer_s *wrb;
+  FAR sq_entry_t *entry;
+  uint32_t seqno = conn->rexmitseq;
+  uint32_t sndlen = conn->rexmitlen;
+  uint32_t offset;
+
+  conn->ccflags &= ~TCP_CC_REXMIT;
+
+  /* Find the write buffer holding the first byte.  That is in the
+   * unacked_q or else the partially sent buffer at the head of the write_q.
+   */
+
+  for (entry = sq_peek(&conn->unacked_q); entry; entry = sq_next(entry))
+    {
+      wrb = (FAR struct tcp_wrbuffer_s *)entry;
+      if (!TCP_SEQ_LT(seqno, TCP_WBSEQNO(wrb)) &&
+          TCP_SEQ_LT(seqno, TCP_WBSEQNO(wrb) + TCP_WBSENT(wrb)))
+        {
+          break;
+        }
+    }
+
+  if (entry == NULL)
+    {
+      wrb = (FAR struct tcp_wrbuffer_s *)sq_peek(&conn->write_q);
+      if (wrb == NULL || TCP_WBSENT(wrb) == 0 ||
+          TCP_SEQ_LT(seqno, TCP_WBSEQNO(wrb)) ||
+          !TCP_SEQ_LT(seqno, TCP_WBSEQNO(wrb) + TCP_WBSENT(wrb)))
+        {
+          /* Already ACKed or never sent */
+
+          return;
+        }
+    }
+
+  /* Resend no more than was sent from this buffer before */
+
+  offset = seqno - TCP_WBSEQNO(wrb);
+  if (sndlen > TCP_WBSENT(wrb) - offset)
+    {
+      sndlen = TCP_WBSENT(wrb) - offset;
+    }
+
+  if (sndlen > conn->mss)
+    {
+      sndlen = conn->mss;
+    }
+
+  ninfo("FASTREXMIT: wrb=%p seqno=%u sndlen=%u\n", wrb, seqno, sndlen);
+
+  tcp_setsequence(conn->sndseq, seqno);
+
+#ifdef NEED_IPDOMAIN_SUPPORT
+  send_ipselect(dev, conn);
+#endif
+
+  devif_iob_send(dev, TCP_WBIOB(wrb), sndlen, offset);
+#ifdef CONFIG_NET_TCP_GSO
+  dev->d_gsomss = 0;
+#endif
+
+  conn->rexmitnxt = seqno + sndlen;
+  conn->ccstats.fastrexmits++;
+#ifdef CONFIG_NET_STATISTICS
+  g_netstats.tcp.rexmit++;
+#endif
+}
+#endif /* CONFIG_NET_TCP_CC */
+
 /****************************************************************************
  * Name: psock_send_eventhandler
  *
@@ -569,6 +663,17 @@ static uint16_t psock_send_eventhandler(FAR struct net_driver_s *dev,
           ninfo("ACK: wrb=%p seqno=%u pktlen=%u sent=%u\n",
                 wrb, TCP_WBSEQNO(wrb), TCP_WBPKTLEN(wrb), TCP_WBSENT(wrb));
         }
+
+#ifdef CONFIG_NET_TCP_CC
+      /* Duplicate or partial ACKs may have revealed a lost segment.  If
+       * so, send it again now.
+       */
+
+      if ((conn->ccflags & TCP_CC_REXMIT) != 0 && dev->d_sndlen == 0)
+        {
+          psock_send_fastrexmit(dev, conn);
+        }
+#endif
     }
 
   /* Check for a loss of connection */
@@ -777,6 +882,9 @@ static uint16_t psock_send_eventhandler(FAR struct net_driver_s *dev,
           FAR struct tcp_wrbuffer_s *wrb;
           uint32_t predicted_seqno;
           size_t sndlen;
+#ifdef CONFIG_NET_TCP_CC
+          uint32_t cwndlen;
+#endif
 
           /* Peek at the head of the write queue (but don't remove anything
            * from the write queue yet).  We know from the above test that
@@ -793,6 +901,27 @@ static uint16_t psock_send_eventhandler(FAR struct net_driver_s *dev,
            */
 
           sndlen = TCP_WBPKTLEN(wrb) - TCP_WBSENT(wrb);
+#ifdef CONFIG_NET_TCP_GSO
+          /* If the driver can segment for us, then send as much as will
+           * fit in its super-segment buffer.
+           */
+
+#ifdef CONFIG_NET_IPv6
+          if (dev->d_gsosize > 0 && conn->domain == PF_INET)
+#else
+          if (dev->d_gsosize > 0)
+#endif
+            {
+              size_t maxlen = dev->d_gsosize -
+                              (NET_LL_HDRLEN(dev) + IPv4TCP_HDRLEN);
+
+              if (sndlen > maxlen)
+                {
+                  sndlen = maxlen;
+                }
+            }
+          else
+#endif
           if (sndlen > conn->mss)
             {
               sndlen = conn->mss;
@@ -803,6 +932,26 @@ static uint16_t psock_send_eventhandler(FAR struct net_driver_s *dev,
               sndlen = conn->winsize;
             }
 
+#ifdef CONFIG_NET_TCP_CC
+          /* And by the congestion window.  Rather than send a runt
+           * segment, wait for ACKs to open the window further.
+           */
+
+          cwndlen = tcp_cc_sndwnd(conn, TCP_WBSEQNO(wrb) == (unsigned)-1 ?
+                                  conn->isn + conn->sent :
+                                  TCP_WBSEQNO(wrb) + TCP_WBSENT(wrb));
+          if (cwndlen < sndlen && cwndlen < conn->mss)
+            {
+              ninfo("SEND: wrb=%p cwnd=%u full\n", wrb, conn->cwnd);
+              return flags;
+            }
+
+          if (sndlen > cwndlen)
+            {
+              sndlen = cwndlen;
+            }
+#endif
+
           ninfo("SEND: wrb=%p pktlen=%u sent=%u sndlen=%u\n",
                 wrb, TCP_WBPKTLEN(wrb), TCP_WBSENT(wrb), sndlen);
 
@@ -840,6 +989,9 @@ static uint16_t psock_send_eventhandler(FAR struct net_driver_s *dev,
            */
 
           devif_iob_send(dev, TCP_WBIOB(wrb), sndlen, TCP_WBSENT(wrb));
+#ifdef CONFIG_NET_TCP_GSO
+          dev->d_gsomss = sndlen > conn->mss ? conn->mss : 0;
+#endif
 
           /* Remember how much data we send out now so that we know
            * when everything has been acknowledged.  Just increment
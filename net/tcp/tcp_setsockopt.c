@@ -41,6 +41,7 @@
 
 #include <sys/time.h>
 #include <stdint.h>
+#include <string.h>
 #include <errno.h>
 #include <assert.h>
 #include <debug.h>
@@ -88,9 +89,9 @@
 int tcp_setsockopt(FAR struct socket *psock, int option,
                    FAR const void *value, socklen_t value_len)
 {
-#ifdef CONFIG_NET_TCP_KEEPALIVE
-  /* Keep alive options are the only TCP protocol socket option currently
-   * supported.
+#if defined(CONFIG_NET_TCP_KEEPALIVE) || defined(CONFIG_NET_TCP_CC)
+  /* Keep alive options and the congestion control algorithm are the only
+   * TCP protocol socket options currently supported.
    */
 
   FAR struct tcp_conn_s *conn;
@@ -110,10 +111,9 @@ int tcp_setsockopt(FAR struct socket *psock, int option,
       return -ENOTCONN;
     }
 
-  /* Handle the Keep-Alive option */
-
   switch (option)
     {
+#ifdef CONFIG_NET_TCP_KEEPALIVE
       /* Handle the SO_KEEPALIVE socket-level option.
        *
        * NOTE: SO_KEEPALIVE is not really a socket-level option; it is a
@@ -147,12 +147,14 @@ int tcp_setsockopt(FAR struct socket *psock, int option,
               }
           }
         break;
+#endif /* CONFIG_NET_TCP_KEEPALIVE */
 
       case TCP_NODELAY: /* Avoid coalescing of small segments. */
         nerr("ERROR: TCP_NODELAY not supported\n");
         ret = -ENOSYS;
         break;
 
+#ifdef CONFIG_NET_TCP_KEEPALIVE
       case TCP_KEEPIDLE:  /* Start keepalives after this IDLE period */
         if (value_len != sizeof(struct timeval))
           {
@@ -251,6 +253,59 @@ int tcp_setsockopt(FAR struct socket *psock, int option,
               }
           }
         break;
+#endif /* CONFIG_NET_TCP_KEEPALIVE */
+
+#ifdef CONFIG_NET_TCP_CC
+      case TCP_CONGESTION:  /* Congestion control algorithm */
+        if (value_len == 0)
+          {
+            ret = -EINVAL;
+          }
+        else
+          {
+            FAR struct tcp_cc_ops_s *ops;
+            char name[TCP_CA_NAME_MAX];
+
+            /* The name need not be NUL terminated */
+
+            if (value_len >= TCP_CA_NAME_MAX)
+              {
+                value_len = TCP_CA_NAME_MAX - 1;
+              }
+
+            memcpy(name, value, value_len);
+            name[value_len] = '\0';
+
+            net_lock();
+            ops = tcp_cc_find(name);
+            if (ops == NULL)
+              {
+                nerr("ERROR: Unknown congestion control: %s\n", name);
+                ret = -ENOENT;
+              }
+            else
+              {
+                /* If the connection is already established, the new
+                 * algorithm starts from the current window.
+                 */
+
+                conn->cc_ops = ops;
+                if (conn->cwnd != 0)
+                  {
+                    memset(conn->cc_priv, 0, sizeof(conn->cc_priv));
+                    if (ops->init != NULL)
+                      {
+                        ops->init(conn);
+                      }
+                  }
+
+                ret = OK;
+              }
+
+            net_unlock();
+          }
+        break;
+#endif /* CONFIG_NET_TCP_CC */
 
       default:
         nerr("ERROR: Unrecognized TCP option: %d\n", option);
@@ -261,7 +316,7 @@ int tcp_setsockopt(FAR struct socket *psock, int option,
   return ret;
 #else
   return -ENOPROTOOPT;
-#endif /* CONFIG_NET_TCP_KEEPALIVE */
+#endif /* CONFIG_NET_TCP_KEEPALIVE || CONFIG_NET_TCP_CC */
 }
 
 #endif /* CONFIG_NET_TCPPROTO_OPTIONS */
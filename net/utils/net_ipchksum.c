@@ -95,7 +95,7 @@ uint16_t ipv4_upperlayer_chksum(FAR struct net_driver_s *dev, uint8_t proto)
 
   /* Verify some minimal assumptions */
 
-  if (upperlen > NETDEV_PKTSIZE(dev))
+  if (upperlen > NETDEV_BUFSIZE(dev))
     {
       return 0;
     }
@@ -159,7 +159,7 @@ uint16_t ipv6_upperlayer_chksum(FAR struct net_driver_s *dev,
 
   /* Verify some minimal assumptions */
 
-  if (upperlen > NETDEV_PKTSIZE(dev))
+  if (upperlen > NETDEV_BUFSIZE(dev))
     {
       return 0;
     }
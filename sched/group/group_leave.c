@@ -162,6 +162,12 @@ static inline void group_release(FAR struct task_group_s *group)
   pthread_release(group);
 #endif
 
+#ifdef CONFIG_FS_RAMMAP
+  /* Remove any file mappings that the group still holds */
+
+  rammap_release(group);
+#endif
+
 #if CONFIG_NFILE_DESCRIPTORS > 0
   /* Free all file-related resources now.  We really need to close files as
    * soon as possible while we still have a functioning task.
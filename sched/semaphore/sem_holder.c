@@ -1142,6 +1142,92 @@ void nxsem_canceled(FAR struct tcb_s *stcb, FAR sem_t *sem)
 }
 #endif
 
+/****************************************************************************
+ * Name: nxsem_tryaddholder
+ *
+ * Description:
+ *   Record the running task as a holder of one count of a semaphore that
+ *   it did not take with nxsem_wait().  This lets a waiter on the semaphore
+ *   boost the priority of the task.  Unlike nxsem_addholder(), running out
+ *   of holder containers is not an error:  The task is then simply not
+ *   boosted.
+ *
+ * Input Parameters:
+ *   sem - A reference to the semaphore
+ *
+ * Returned Value:
+ *   None
+ *
+ * Assumptions:
+ *   Interrupts are disabled.
+ *
+ ****************************************************************************/
+
+void nxsem_tryaddholder(FAR sem_t *sem)
+{
+  FAR struct tcb_s *rtcb = this_task();
+
+  if ((sem->flags & PRIOINHERIT_FLAGS_DISABLE) == 0 &&
+      nxsem_findholder(sem, rtcb) == NULL &&
+#if CONFIG_SEM_PREALLOCHOLDERS > 0
+      g_freeholders == NULL)
+#else
+      sem->holder[0].htcb != NULL && sem->holder[1].htcb != NULL)
+#endif
+    {
+      return;
+    }
+
+  nxsem_addholder_tcb(rtcb, sem);
+}
+
+/****************************************************************************
+ * Name: nxsem_dropholder
+ *
+ * Description:
+ *   Remove the running task from the holders of a semaphore without
+ *   posting the semaphore.  If a waiter on the semaphore boosted the
+ *   priority of the task, the priority is restored.
+ *
+ * Input Parameters:
+ *   sem - A reference to the semaphore
+ *
+ * Returned Value:
+ *   None
+ *
+ * Assumptions:
+ *   Interrupts are disabled and the scheduler is locked.
+ *
+ ****************************************************************************/
+
+void nxsem_dropholder(FAR sem_t *sem)
+{
+  FAR struct tcb_s *rtcb = this_task();
+  FAR struct semholder_s *pholder;
+  FAR struct tcb_s *stcb;
+
+  pholder = nxsem_findholder(sem, rtcb);
+  if (pholder == NULL)
+    {
+      return;
+    }
+
+  nxsem_freeholder(sem, pholder);
+
+  /* The highest priority waiter is the one that we may have inherited our
+   * priority from.
+   */
+
+  for (stcb = (FAR struct tcb_s *)g_waitingforsemaphore.head;
+       stcb != NULL && stcb->waitsem != sem;
+       stcb = stcb->flink);
+
+  if (stcb != NULL)
+    {
+      (void)nxsem_restoreholderprio(rtcb, sem, stcb);
+    }
+}
+
 /****************************************************************************
  * Name: sem_enumholders
  *
@@ -0,0 +1,346 @@
+/****************************************************************************
+ * sched/semaphore/sem_rw.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <semaphore.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <nuttx/irq.h>
+#include <nuttx/semaphore.h>
+
+#include "sched/sched.h"
+#include "semaphore/semaphore.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define NO_HOLDER ((pid_t)-1)
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nxrwsem_init
+ *
+ * Description:
+ *   Initialize a reader/writer semaphore.  Any number of readers may hold
+ *   the semaphore at the same time; a writer holds it exclusively.
+ *
+ *   Writers are serialized on an ordinary, priority inheritance semaphore
+ *   so that a reader or writer blocked behind a writer boosts the priority
+ *   of that writer.  With CONFIG_PRIORITY_INHERITANCE, the readers are
+ *   recorded as holders of the semaphore that a writer waits on for the
+ *   readers to leave, so the waiting writer boosts the priority of the
+ *   readers in turn.
+ *
+ * Input Parameters:
+ *   rwsem - The reader/writer semaphore to be initialized
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  A negated errno value is returned on
+ *   failure.
+ *
+ ****************************************************************************/
+
+int nxrwsem_init(FAR rwsem_t *rwsem)
+{
+  int ret;
+
+  DEBUGASSERT(rwsem != NULL);
+
+  ret = nxsem_init(&rwsem->rw_wrsem, 0, 1);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* The reader wait semaphore is posted by the last reader to leave.  It
+   * keeps priority inheritance:  The readers are its holders.
+   */
+
+  ret = nxsem_init(&rwsem->rw_rdwait, 0, 0);
+  if (ret < 0)
+    {
+      (void)nxsem_destroy(&rwsem->rw_wrsem);
+      return ret;
+    }
+
+  rwsem->rw_holder  = NO_HOLDER;
+  rwsem->rw_wrcount = 0;
+  rwsem->rw_readers = 0;
+  rwsem->rw_writing = false;
+  rwsem->rw_wrwait  = false;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxrwsem_destroy
+ *
+ * Description:
+ *   Destroy a reader/writer semaphore.  The semaphore must not be held.
+ *
+ ****************************************************************************/
+
+int nxrwsem_destroy(FAR rwsem_t *rwsem)
+{
+  DEBUGASSERT(rwsem != NULL && rwsem->rw_readers == 0 &&
+              rwsem->rw_holder == NO_HOLDER);
+
+  (void)nxsem_destroy(&rwsem->rw_rdwait);
+  return nxsem_destroy(&rwsem->rw_wrsem);
+}
+
+/****************************************************************************
+ * Name: nxrwsem_rdlock
+ *
+ * Description:
+ *   Take the reader/writer semaphore for shared (read) access.  This does
+ *   not block unless a writer holds the semaphore.  If the caller already
+ *   holds the semaphore for write access, the nested read access is
+ *   counted as a recursive write access.
+ *
+ *   Read access is not recursive:  A caller holding read access must not
+ *   request read or write access again, since either could deadlock
+ *   behind a waiting writer.
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  A negated errno value is returned on
+ *   failure.
+ *
+ ****************************************************************************/
+
+int nxrwsem_rdlock(FAR rwsem_t *rwsem)
+{
+  irqstate_t flags;
+  int ret;
+
+  DEBUGASSERT(rwsem != NULL && !up_interrupt_context());
+
+  /* Nested within our own write access? */
+
+  if (rwsem->rw_holder == this_task()->pid)
+    {
+      rwsem->rw_wrcount++;
+      return OK;
+    }
+
+  /* Fast path:  No writer, just count the reader */
+
+  flags = enter_critical_section();
+  if (!rwsem->rw_writing)
+    {
+      rwsem->rw_readers++;
+      nxsem_tryaddholder(&rwsem->rw_rdwait);
+      leave_critical_section(flags);
+      return OK;
+    }
+
+  leave_critical_section(flags);
+
+  /* A writer holds the semaphore.  Wait for it on the writer semaphore so
+   * that the writer inherits our priority.
+   */
+
+  ret = nxsem_wait_uninterruptible(&rwsem->rw_wrsem);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  flags = enter_critical_section();
+  rwsem->rw_readers++;
+  nxsem_tryaddholder(&rwsem->rw_rdwait);
+  leave_critical_section(flags);
+
+  return nxsem_post(&rwsem->rw_wrsem);
+}
+
+/****************************************************************************
+ * Name: nxrwsem_rdunlock
+ *
+ * Description:
+ *   Release shared (read) access taken by nxrwsem_rdlock().
+ *
+ ****************************************************************************/
+
+void nxrwsem_rdunlock(FAR rwsem_t *rwsem)
+{
+  irqstate_t flags;
+
+  DEBUGASSERT(rwsem != NULL);
+
+  /* Nested within our own write access? */
+
+  if (rwsem->rw_holder == this_task()->pid)
+    {
+      DEBUGASSERT(rwsem->rw_wrcount > 1);
+      rwsem->rw_wrcount--;
+      return;
+    }
+
+  /* Wake up a writer waiting for the last reader.  Posting rw_rdwait also
+   * releases our holder entry.  Otherwise, just give up the holder entry
+   * and any priority that a waiting writer lent us.
+   */
+
+  sched_lock();
+  flags = enter_critical_section();
+  DEBUGASSERT(rwsem->rw_readers > 0);
+
+  if (--rwsem->rw_readers == 0 && rwsem->rw_wrwait)
+    {
+      rwsem->rw_wrwait = false;
+      (void)nxsem_post(&rwsem->rw_rdwait);
+    }
+  else
+    {
+      nxsem_dropholder(&rwsem->rw_rdwait);
+    }
+
+  leave_critical_section(flags);
+  sched_unlock();
+}
+
+/****************************************************************************
+ * Name: nxrwsem_wrlock
+ *
+ * Description:
+ *   Take the reader/writer semaphore for exclusive (write) access, waiting
+ *   for all current readers to release it.  Write access is recursive:  The
+ *   holder may take it again and must release it the same number of times.
+ *
+ * Returned Value:
+ *   Zero (OK) is returned on success.  A negated errno value is returned on
+ *   failure.
+ *
+ ****************************************************************************/
+
+int nxrwsem_wrlock(FAR rwsem_t *rwsem)
+{
+  irqstate_t flags;
+  pid_t me;
+  int ret;
+
+  DEBUGASSERT(rwsem != NULL && !up_interrupt_context());
+
+  /* Do we already hold the semaphore? */
+
+  me = this_task()->pid;
+  if (rwsem->rw_holder == me)
+    {
+      rwsem->rw_wrcount++;
+      DEBUGASSERT(rwsem->rw_wrcount > 0);
+      return OK;
+    }
+
+  /* Exclude other writers and new readers */
+
+  ret = nxsem_wait_uninterruptible(&rwsem->rw_wrsem);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Then wait for the readers that are already inside to leave.  Waiting
+   * on rw_rdwait boosts the priority of the readers.
+   */
+
+  flags = enter_critical_section();
+  rwsem->rw_writing = true;
+
+  while (rwsem->rw_readers > 0)
+    {
+      rwsem->rw_wrwait = true;
+      ret = nxsem_wait_uninterruptible(&rwsem->rw_rdwait);
+      DEBUGASSERT(ret == OK);
+      UNUSED(ret);
+
+      /* nxsem_post() made us a holder of rw_rdwait, but we are no reader */
+
+      nxsem_dropholder(&rwsem->rw_rdwait);
+    }
+
+  leave_critical_section(flags);
+
+  rwsem->rw_holder  = me;
+  rwsem->rw_wrcount = 1;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxrwsem_wrunlock
+ *
+ * Description:
+ *   Release exclusive (write) access taken by nxrwsem_wrlock().
+ *
+ ****************************************************************************/
+
+void nxrwsem_wrunlock(FAR rwsem_t *rwsem)
+{
+  irqstate_t flags;
+
+  DEBUGASSERT(rwsem != NULL && rwsem->rw_holder == this_task()->pid);
+
+  /* Is this our last count on the semaphore? */
+
+  if (rwsem->rw_wrcount > 1)
+    {
+      /* No.. just decrement the count */
+
+      rwsem->rw_wrcount--;
+      return;
+    }
+
+  /* Yes.. then we can really release the semaphore */
+
+  rwsem->rw_holder  = NO_HOLDER;
+  rwsem->rw_wrcount = 0;
+
+  flags = enter_critical_section();
+  rwsem->rw_writing = false;
+  leave_critical_section(flags);
+
+  (void)nxsem_post(&rwsem->rw_wrsem);
+}
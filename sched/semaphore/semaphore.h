@@ -93,6 +93,8 @@ void nxsem_addholder_tcb(FAR struct tcb_s *htcb, FAR sem_t *sem);
 void nxsem_boostpriority(FAR sem_t *sem);
 void nxsem_releaseholder(FAR sem_t *sem);
 void nxsem_restorebaseprio(FAR struct tcb_s *stcb, FAR sem_t *sem);
+void nxsem_tryaddholder(FAR sem_t *sem);
+void nxsem_dropholder(FAR sem_t *sem);
 #  ifndef CONFIG_DISABLE_SIGNALS
 void nxsem_canceled(FAR struct tcb_s *stcb, FAR sem_t *sem);
 #  else
@@ -106,6 +108,8 @@ void nxsem_canceled(FAR struct tcb_s *stcb, FAR sem_t *sem);
 #  define nxsem_boostpriority(sem)
 #  define nxsem_releaseholder(sem)
 #  define nxsem_restorebaseprio(stcb,sem)
+#  define nxsem_tryaddholder(sem)
+#  define nxsem_dropholder(sem)
 #  define nxsem_canceled(stcb,sem)
 #endif
 
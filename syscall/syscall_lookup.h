@@ -281,6 +281,8 @@ SYSCALL_LOOKUP(up_assert,                  2, STUB_up_assert)
   SYSCALL_LOOKUP(rmdir,                    1, STUB_rmdir)
   SYSCALL_LOOKUP(umount2,                  2, STUB_umount2)
   SYSCALL_LOOKUP(unlink,                   1, STUB_unlink)
+  SYSCALL_LOOKUP(posix_fadvise,            4, STUB_posix_fadvise)
+  SYSCALL_LOOKUP(readahead,                3, STUB_readahead)
 #  endif
 #endif
 
@@ -280,6 +280,10 @@ uintptr_t STUB_rename(int nbr, uintptr_t parm1, uintptr_t parm2);
 uintptr_t STUB_rmdir(int nbr, uintptr_t parm1);
 uintptr_t STUB_umount2(int nbr, uintptr_t parm1, uintptr_t parm2);
 uintptr_t STUB_unlink(int nbr, uintptr_t parm1);
+uintptr_t STUB_posix_fadvise(int nbr, uintptr_t parm1, uintptr_t parm2,
+            uintptr_t parm3, uintptr_t parm4);
+uintptr_t STUB_readahead(int nbr, uintptr_t parm1, uintptr_t parm2,
+            uintptr_t parm3);
 
 /* Shared memory interfaces */
 
@@ -0,0 +1,721 @@
+/****************************************************************************
+ * tools/syslogdecode.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The binary SYSLOG record format.  These definitions must agree with
+ * include/nuttx/syslog/syslog_binary.h.
+ */
+
+#define SYSLOG_BINARY_SYNC            0xa5
+#define SYSLOG_BINARY_HDRSIZE         12
+#define SYSLOG_BINARY_CHKSIZE         1
+
+#define SYSLOG_BINARY_INFO_INT_SHIFT  0
+#define SYSLOG_BINARY_INFO_LONG_SHIFT 2
+#define SYSLOG_BINARY_INFO_PTR_SHIFT  4
+#define SYSLOG_BINARY_INFO_BIGENDIAN  (1 << 6)
+#define SYSLOG_BINARY_INFO_RESERVED   (1 << 7)
+
+/* ELF definitions (only those needed to find the allocated sections) */
+
+#define EI_NIDENT       16
+#define EI_CLASS        4
+#define EI_DATA         5
+#define ELFCLASS32      1
+#define ELFCLASS64      2
+#define ELFDATA2LSB     1
+#define ELFDATA2MSB     2
+#define SHT_PROGBITS    1
+#define SHF_ALLOC       2
+
+#define MAX_SPEC        32
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One allocated section of the target ELF file */
+
+struct section_s
+{
+  uint64_t addr;     /* Load address of the section */
+  uint64_t size;     /* Size of the section */
+  uint64_t offset;   /* Offset of the section data in the ELF file */
+};
+
+/* Target properties decoded from the record information byte */
+
+struct target_s
+{
+  int intsize;
+  int longsize;
+  int ptrsize;
+  bool bigendian;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static uint8_t *g_elf;
+static size_t g_elfsize;
+static bool g_elfbig;
+static struct section_s *g_sections;
+static int g_nsections;
+static bool g_notimestamp;
+static bool g_priority;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(const char *progname, int exitcode)
+{
+  fprintf(stderr, "USAGE: %s [-n] [-p] <elf-file> [<log-file>]\n",
+          progname);
+  fprintf(stderr, "\nWhere:\n");
+  fprintf(stderr, "  -n           Do not show time stamps\n");
+  fprintf(stderr, "  -p           Show the priority of each message\n");
+  fprintf(stderr, "  <elf-file>   The ELF file of the target (e.g. nuttx)\n");
+  fprintf(stderr, "  <log-file>   The binary SYSLOG output.  The standard "
+                  "input is used if omitted.\n");
+  exit(exitcode);
+}
+
+static uint8_t *read_file(FILE *stream, size_t *size)
+{
+  uint8_t *buffer = NULL;
+  size_t allocated = 0;
+  size_t nread = 0;
+
+  for (; ; )
+    {
+      size_t n;
+
+      if (nread == allocated)
+        {
+          allocated = allocated ? 2 * allocated : 65536;
+          buffer = realloc(buffer, allocated);
+          if (buffer == NULL)
+            {
+              fprintf(stderr, "ERROR: Out of memory\n");
+              exit(EXIT_FAILURE);
+            }
+        }
+
+      n = fread(&buffer[nread], 1, allocated - nread, stream);
+      if (n == 0)
+        {
+          break;
+        }
+
+      nread += n;
+    }
+
+  *size = nread;
+  return buffer;
+}
+
+static uint64_t get_value(const uint8_t *src, int size, bool bigendian)
+{
+  uint64_t value = 0;
+  int i;
+
+  for (i = 0; i < size; i++)
+    {
+      int shift = bigendian ? 8 * (size - 1 - i) : 8 * i;
+      value |= (uint64_t)src[i] << shift;
+    }
+
+  return value;
+}
+
+static uint64_t elf_value(size_t offset, int size)
+{
+  if (offset + size > g_elfsize)
+    {
+      fprintf(stderr, "ERROR: Truncated ELF file\n");
+      exit(EXIT_FAILURE);
+    }
+
+  return get_value(&g_elf[offset], size, g_elfbig);
+}
+
+static void load_elf(const char *path)
+{
+  FILE *stream;
+  uint64_t shoff;
+  int shentsize;
+  int shnum;
+  bool is64;
+  int i;
+
+  stream = fopen(path, "rb");
+  if (stream == NULL)
+    {
+      fprintf(stderr, "ERROR: Failed to open %s: %s\n",
+              path, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+
+  g_elf = read_file(stream, &g_elfsize);
+  fclose(stream);
+
+  if (g_elfsize < EI_NIDENT || memcmp(g_elf, "\177ELF", 4) != 0)
+    {
+      fprintf(stderr, "ERROR: %s is not an ELF file\n", path);
+      exit(EXIT_FAILURE);
+    }
+
+  is64     = g_elf[EI_CLASS] == ELFCLASS64;
+  g_elfbig = g_elf[EI_DATA] == ELFDATA2MSB;
+
+  if (is64)
+    {
+      shoff     = elf_value(0x28, 8);
+      shentsize = (int)elf_value(0x3a, 2);
+      shnum     = (int)elf_value(0x3c, 2);
+    }
+  else
+    {
+      shoff     = elf_value(0x20, 4);
+      shentsize = (int)elf_value(0x2e, 2);
+      shnum     = (int)elf_value(0x30, 2);
+    }
+
+  g_sections = calloc(shnum, sizeof(struct section_s));
+  if (g_sections == NULL && shnum > 0)
+    {
+      fprintf(stderr, "ERROR: Out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+
+  for (i = 0; i < shnum; i++)
+    {
+      size_t shdr = shoff + (size_t)i * shentsize;
+      uint64_t type;
+      uint64_t flags;
+      struct section_s *section = &g_sections[g_nsections];
+
+      type = elf_value(shdr + 4, 4);
+      if (is64)
+        {
+          flags           = elf_value(shdr + 0x08, 8);
+          section->addr   = elf_value(shdr + 0x10, 8);
+          section->offset = elf_value(shdr + 0x18, 8);
+          section->size   = elf_value(shdr + 0x20, 8);
+        }
+      else
+        {
+          flags           = elf_value(shdr + 0x08, 4);
+          section->addr   = elf_value(shdr + 0x0c, 4);
+          section->offset = elf_value(shdr + 0x10, 4);
+          section->size   = elf_value(shdr + 0x14, 4);
+        }
+
+      /* Format strings can only be in allocated sections with data */
+
+      if (type == SHT_PROGBITS && (flags & SHF_ALLOC) != 0 &&
+          section->offset + section->size <= g_elfsize)
+        {
+          g_nsections++;
+        }
+    }
+}
+
+static const char *find_string(uint64_t addr)
+{
+  int i;
+
+  for (i = 0; i < g_nsections; i++)
+    {
+      const struct section_s *section = &g_sections[i];
+
+      if (addr >= section->addr && addr < section->addr + section->size)
+        {
+          const char *str = (const char *)&g_elf[section->offset +
+                                                 (addr - section->addr)];
+          size_t maxlen = section->size - (addr - section->addr);
+
+          /* The string must be terminated within the section */
+
+          return memchr(str, '\0', maxlen) != NULL ? str : NULL;
+        }
+    }
+
+  return NULL;
+}
+
+/* Return the size of the packed integer for a conversion with the target
+ * size 'size' (see syslog_inttype() in drivers/syslog/syslog_packargs.c).
+ */
+
+static int packed_intsize(const struct target_s *target, int size)
+{
+  if (size > target->longsize)
+    {
+      return 8;
+    }
+
+  if (size > target->intsize)
+    {
+      return target->longsize;
+    }
+
+  return target->intsize;
+}
+
+/* Format the arguments of one message.  Returns false if formatting
+ * stopped because the format string references more arguments than were
+ * packed.
+ */
+
+static bool format_args(const struct target_s *target, const char *fmt,
+                        const uint8_t *args, size_t arglen)
+{
+  size_t offset = 0;
+
+  while (*fmt != '\0')
+    {
+      char spec[MAX_SPEC];
+      int speclen = 0;
+      int size = target->intsize;
+      int nlong = 0;
+      char conv;
+
+      if (*fmt != '%')
+        {
+          putchar(*fmt++);
+          continue;
+        }
+
+      spec[speclen++] = *fmt++;
+
+      /* Flags, field width and precision.  Expand '*' */
+
+      while (*fmt != '\0' && strchr("-+ #0123456789.*", *fmt) != NULL)
+        {
+          if (*fmt == '*')
+            {
+              int64_t width;
+
+              if (offset + target->intsize > arglen)
+                {
+                  return false;
+                }
+
+              width = (int32_t)get_value(&args[offset], target->intsize,
+                                         target->bigendian);
+              if (target->intsize == 2)
+                {
+                  width = (int16_t)width;
+                }
+
+              offset  += target->intsize;
+              speclen += snprintf(&spec[speclen], MAX_SPEC - speclen - 4,
+                                  "%d", (int)width);
+            }
+          else if (speclen < MAX_SPEC - 4)
+            {
+              spec[speclen++] = *fmt;
+            }
+
+          fmt++;
+        }
+
+      /* Length modifiers are replaced with the host equivalents */
+
+      for (; ; fmt++)
+        {
+          if (*fmt == 'h')
+            {
+              continue;
+            }
+          else if (*fmt == 'l')
+            {
+              size = ++nlong > 1 ? 8 : target->longsize;
+            }
+          else if (*fmt == 'q' || *fmt == 'L' || *fmt == 'j')
+            {
+              size = 8;
+            }
+          else if (*fmt == 'z' || *fmt == 't')
+            {
+              size = target->ptrsize;
+            }
+          else
+            {
+              break;
+            }
+        }
+
+      conv = *fmt;
+      if (conv == '\0')
+        {
+          return true;
+        }
+
+      fmt++;
+
+      switch (conv)
+        {
+          case 'd':
+          case 'i':
+          case 'u':
+          case 'o':
+          case 'x':
+          case 'X':
+          case 'c':
+          case 'p':
+            {
+              int psize = conv == 'p' ? target->ptrsize :
+                          packed_intsize(target, size);
+              uint64_t value;
+
+              if (offset + psize > arglen)
+                {
+                  return false;
+                }
+
+              value   = get_value(&args[offset], psize, target->bigendian);
+              offset += psize;
+
+              if (conv == 'c')
+                {
+                  spec[speclen++] = 'c';
+                  spec[speclen]   = '\0';
+                  printf(spec, (int)(value & 0xff));
+                }
+              else if (conv == 'p')
+                {
+                  spec[speclen++] = 'l';
+                  spec[speclen++] = 'l';
+                  spec[speclen++] = 'x';
+                  spec[speclen]   = '\0';
+                  fputs("0x", stdout);
+                  printf(spec, (unsigned long long)value);
+                }
+              else
+                {
+                  /* Sign extend signed conversions */
+
+                  if ((conv == 'd' || conv == 'i') && psize < 8 &&
+                      (value & ((uint64_t)1 << (8 * psize - 1))) != 0)
+                    {
+                      value |= ~(uint64_t)0 << (8 * psize);
+                    }
+
+                  spec[speclen++] = 'l';
+                  spec[speclen++] = 'l';
+                  spec[speclen++] = conv;
+                  spec[speclen]   = '\0';
+
+                  if (conv == 'd' || conv == 'i')
+                    {
+                      printf(spec, (long long)value);
+                    }
+                  else
+                    {
+                      if (psize < 8)
+                        {
+                          value &= ((uint64_t)1 << (8 * psize)) - 1;
+                        }
+
+                      printf(spec, (unsigned long long)value);
+                    }
+                }
+            }
+            break;
+
+          case 'e':
+          case 'E':
+          case 'f':
+          case 'F':
+          case 'g':
+          case 'G':
+          case 'a':
+          case 'A':
+            {
+              uint64_t bits;
+              double value;
+
+              if (offset + 8 > arglen)
+                {
+                  return false;
+                }
+
+              bits    = get_value(&args[offset], 8, target->bigendian);
+              offset += 8;
+              memcpy(&value, &bits, sizeof(double));
+
+              spec[speclen++] = conv;
+              spec[speclen]   = '\0';
+              printf(spec, value);
+            }
+            break;
+
+          case 's':
+            {
+              size_t len;
+              char *str;
+
+              if (offset >= arglen)
+                {
+                  return false;
+                }
+
+              /* Copy the string in case it was not terminated */
+
+              len = strnlen((const char *)&args[offset], arglen - offset);
+              str = malloc(len + 1);
+              if (str == NULL)
+                {
+                  return false;
+                }
+
+              memcpy(str, &args[offset], len);
+              str[len] = '\0';
+              offset  += len + 1;
+
+              spec[speclen++] = 's';
+              spec[speclen]   = '\0';
+              printf(spec, str);
+              free(str);
+            }
+            break;
+
+          case 'n':
+            break;
+
+          default:
+            putchar(conv);
+            break;
+        }
+    }
+
+  return true;
+}
+
+static void format_message(const struct target_s *target, const char *fmt,
+                           const uint8_t *args, size_t arglen)
+{
+  size_t len = strlen(fmt);
+
+  /* Keep the line termination of a message whose arguments were truncated */
+
+  if (!format_args(target, fmt, args, arglen) &&
+      len > 0 && fmt[len - 1] == '\n')
+    {
+      putchar('\n');
+    }
+}
+
+/* Attempt to decode one record at 'record'.  Returns the size of the record
+ * or zero if this is not a valid record.
+ */
+
+static size_t decode_record(const uint8_t *record, size_t remaining)
+{
+  struct target_s target;
+  const char *fmt;
+  uint64_t addr;
+  uint32_t sec;
+  uint32_t usec;
+  uint8_t chksum;
+  size_t reclen;
+  size_t arglen;
+  size_t i;
+  uint8_t info;
+
+  if (remaining < SYSLOG_BINARY_HDRSIZE || record[0] != SYSLOG_BINARY_SYNC)
+    {
+      return 0;
+    }
+
+  info = record[1];
+  if ((info & SYSLOG_BINARY_INFO_RESERVED) != 0)
+    {
+      return 0;
+    }
+
+  target.intsize   = 1 << ((info >> SYSLOG_BINARY_INFO_INT_SHIFT) & 3);
+  target.longsize  = 1 << ((info >> SYSLOG_BINARY_INFO_LONG_SHIFT) & 3);
+  target.ptrsize   = 1 << ((info >> SYSLOG_BINARY_INFO_PTR_SHIFT) & 3);
+  target.bigendian = (info & SYSLOG_BINARY_INFO_BIGENDIAN) != 0;
+
+  arglen = record[3];
+  reclen = SYSLOG_BINARY_HDRSIZE + target.ptrsize + arglen +
+           SYSLOG_BINARY_CHKSIZE;
+
+  if (reclen > remaining)
+    {
+      return 0;
+    }
+
+  for (i = 0, chksum = 0; i < reclen; i++)
+    {
+      chksum += record[i];
+    }
+
+  if (chksum != 0)
+    {
+      return 0;
+    }
+
+  addr = get_value(&record[SYSLOG_BINARY_HDRSIZE], target.ptrsize,
+                   target.bigendian);
+  fmt  = find_string(addr);
+  if (fmt == NULL)
+    {
+      return 0;
+    }
+
+  sec  = (uint32_t)get_value(&record[4], 4, target.bigendian);
+  usec = (uint32_t)get_value(&record[8], 4, target.bigendian);
+
+  if (!g_notimestamp)
+    {
+      printf("[%5u.%06u] ", sec, usec);
+    }
+
+  if (g_priority)
+    {
+      printf("<%u> ", record[2]);
+    }
+
+  format_message(&target, fmt,
+                 &record[SYSLOG_BINARY_HDRSIZE + target.ptrsize], arglen);
+  return reclen;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, char **argv, char **envp)
+{
+  uint8_t *log;
+  size_t logsize;
+  size_t offset;
+  FILE *stream;
+  int option;
+
+  while ((option = getopt(argc, argv, "nph")) > 0)
+    {
+      switch (option)
+        {
+          case 'n':
+            g_notimestamp = true;
+            break;
+
+          case 'p':
+            g_priority = true;
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (optind >= argc || argc - optind > 2)
+    {
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  load_elf(argv[optind]);
+
+  if (optind + 1 < argc)
+    {
+      stream = fopen(argv[optind + 1], "rb");
+      if (stream == NULL)
+        {
+          fprintf(stderr, "ERROR: Failed to open %s: %s\n",
+                  argv[optind + 1], strerror(errno));
+          exit(EXIT_FAILURE);
+        }
+    }
+  else
+    {
+      stream = stdin;
+    }
+
+  log = read_file(stream, &logsize);
+  if (stream != stdin)
+    {
+      fclose(stream);
+    }
+
+  /* Anything that is not a valid binary record is passed through as
+   * text.
+   */
+
+  for (offset = 0; offset < logsize; )
+    {
+      size_t reclen = decode_record(&log[offset], logsize - offset);
+      if (reclen > 0)
+        {
+          offset += reclen;
+        }
+      else
+        {
+          putchar(log[offset++]);
+        }
+    }
+
+  free(log);
+  free(g_sections);
+  free(g_elf);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,314 @@
+/****************************************************************************
+ * tools/testblkmerge.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nuttx/drivers/blkmerge.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define BLOCKSIZE   16
+#define MAXBLOCKS   8
+#define DISKBLOCKS  64
+#define NRANDOM     10000
+
+#define CHECK(c) \
+  do \
+    { \
+      if (!(c)) \
+        { \
+          fprintf(stderr, "%s:%d: Check failed: %s\n", \
+                  __FILE__, __LINE__, #c); \
+          g_nfailed++; \
+        } \
+    } \
+  while (0)
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static uint8_t g_rundata[MAXBLOCKS * BLOCKSIZE];
+static uint8_t g_disk[DISKBLOCKS * BLOCKSIZE];
+static uint8_t g_refdisk[DISKBLOCKS * BLOCKSIZE];
+static int g_nfailed;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* Fill nblocks blocks with a pattern that identifies the block number and
+ * the write that produced it.
+ */
+
+static void fill_blocks(uint8_t *buffer, off_t startblock, size_t nblocks,
+                        uint8_t tag)
+{
+  size_t i;
+
+  for (i = 0; i < nblocks; i++)
+    {
+      memset(&buffer[i * BLOCKSIZE], tag, BLOCKSIZE);
+      buffer[i * BLOCKSIZE] = (uint8_t)(startblock + i);
+    }
+}
+
+/* Return true if block 'block' of the run holds the data of write 'tag' */
+
+static bool run_has(struct blk_run_s *run, off_t block, uint8_t tag)
+{
+  const uint8_t *data;
+
+  if (block < run->startblock ||
+      block >= run->startblock + (off_t)run->nblocks)
+    {
+      return false;
+    }
+
+  data = &run->data[(block - run->startblock) * BLOCKSIZE];
+  return data[0] == (uint8_t)block && data[1] == tag &&
+         data[BLOCKSIZE - 1] == tag;
+}
+
+static bool merge(struct blk_run_s *run, off_t startblock, size_t nblocks,
+                  uint8_t tag)
+{
+  uint8_t buffer[DISKBLOCKS * BLOCKSIZE];
+
+  fill_blocks(buffer, startblock, nblocks, tag);
+  return blkmerge_add(run, BLOCKSIZE, MAXBLOCKS, startblock, nblocks,
+                      buffer);
+}
+
+static void reset_run(struct blk_run_s *run)
+{
+  memset(g_rundata, 0, sizeof(g_rundata));
+  run->data       = g_rundata;
+  run->startblock = 0;
+  run->nblocks    = 0;
+}
+
+static void test_back_merge(void)
+{
+  struct blk_run_s run;
+
+  reset_run(&run);
+  CHECK(merge(&run, 10, 2, 1));
+  CHECK(merge(&run, 12, 3, 2));
+  CHECK(run.startblock == 10 && run.nblocks == 5);
+  CHECK(run_has(&run, 10, 1) && run_has(&run, 11, 1));
+  CHECK(run_has(&run, 12, 2) && run_has(&run, 14, 2));
+}
+
+static void test_front_merge(void)
+{
+  struct blk_run_s run;
+
+  reset_run(&run);
+  CHECK(merge(&run, 10, 2, 1));
+  CHECK(merge(&run, 7, 3, 2));
+  CHECK(run.startblock == 7 && run.nblocks == 5);
+  CHECK(run_has(&run, 7, 2) && run_has(&run, 9, 2));
+  CHECK(run_has(&run, 10, 1) && run_has(&run, 11, 1));
+}
+
+static void test_overlap_merge(void)
+{
+  struct blk_run_s run;
+
+  /* Overlap at the end of the run */
+
+  reset_run(&run);
+  CHECK(merge(&run, 10, 4, 1));
+  CHECK(merge(&run, 12, 4, 2));
+  CHECK(run.startblock == 10 && run.nblocks == 6);
+  CHECK(run_has(&run, 11, 1) && run_has(&run, 12, 2));
+  CHECK(run_has(&run, 15, 2));
+
+  /* Overlap at the start of the run */
+
+  CHECK(merge(&run, 8, 3, 3));
+  CHECK(run.startblock == 8 && run.nblocks == 8);
+  CHECK(run_has(&run, 8, 3) && run_has(&run, 10, 3));
+  CHECK(run_has(&run, 11, 1) && run_has(&run, 15, 2));
+
+  /* Fully contained */
+
+  CHECK(merge(&run, 12, 2, 4));
+  CHECK(run.startblock == 8 && run.nblocks == 8);
+  CHECK(run_has(&run, 11, 1) && run_has(&run, 12, 4));
+  CHECK(run_has(&run, 13, 4) && run_has(&run, 14, 2));
+}
+
+static void test_no_merge(void)
+{
+  struct blk_run_s run;
+
+  reset_run(&run);
+  CHECK(merge(&run, 10, 2, 1));
+
+  /* A gap on either side */
+
+  CHECK(!merge(&run, 13, 1, 2));
+  CHECK(!merge(&run, 7, 2, 2));
+
+  /* Adjacent, but the result would not fit */
+
+  CHECK(!merge(&run, 12, MAXBLOCKS - 1, 2));
+  CHECK(!merge(&run, 10 - MAXBLOCKS + 1, MAXBLOCKS - 1, 2));
+
+  /* Nothing, or too much */
+
+  CHECK(!merge(&run, 12, 0, 2));
+  CHECK(!merge(&run, 20, MAXBLOCKS + 1, 2));
+
+  /* The run must not have been changed */
+
+  CHECK(run.startblock == 10 && run.nblocks == 2);
+  CHECK(run_has(&run, 10, 1) && run_has(&run, 11, 1));
+
+  /* Overlap checks */
+
+  CHECK(blkmerge_overlaps(&run, 11, 5));
+  CHECK(blkmerge_overlaps(&run, 8, 3));
+  CHECK(!blkmerge_overlaps(&run, 12, 5));
+  CHECK(!blkmerge_overlaps(&run, 8, 2));
+  CHECK(!blkmerge_overlaps(&run, 10, 0));
+}
+
+/* Write random requests to a RAM disk through a run, writing the run to
+ * the disk whenever a request cannot be merged, and compare with a RAM
+ * disk that was written directly.
+ */
+
+static void flush_run(struct blk_run_s *run)
+{
+  memcpy(&g_disk[run->startblock * BLOCKSIZE], run->data,
+         run->nblocks * BLOCKSIZE);
+  run->nblocks = 0;
+}
+
+static void test_ramdisk(void)
+{
+  uint8_t buffer[MAXBLOCKS * BLOCKSIZE];
+  struct blk_run_s run;
+  unsigned int nflushes = 0;
+  int i;
+
+  reset_run(&run);
+  memset(g_disk, 0xff, sizeof(g_disk));
+  memset(g_refdisk, 0xff, sizeof(g_refdisk));
+  srand(1);
+
+  for (i = 0; i < NRANDOM; i++)
+    {
+      size_t nblocks = 1 + rand() % MAXBLOCKS;
+      off_t startblock;
+
+      /* Mostly sequential writes, with some rewrites and random seeks */
+
+      switch (rand() % 4)
+        {
+          case 0:
+            startblock = rand() % (DISKBLOCKS - nblocks + 1);
+            break;
+
+          case 1:
+            startblock = run.startblock;
+            break;
+
+          default:
+            startblock = run.startblock + run.nblocks;
+            break;
+        }
+
+      if (startblock + nblocks > DISKBLOCKS)
+        {
+          startblock = 0;
+        }
+
+      fill_blocks(buffer, startblock, nblocks, (uint8_t)i);
+      memcpy(&g_refdisk[startblock * BLOCKSIZE], buffer,
+             nblocks * BLOCKSIZE);
+
+      if (!blkmerge_add(&run, BLOCKSIZE, MAXBLOCKS, startblock, nblocks,
+                        buffer))
+        {
+          flush_run(&run);
+          nflushes++;
+          CHECK(blkmerge_add(&run, BLOCKSIZE, MAXBLOCKS, startblock,
+                             nblocks, buffer));
+        }
+
+      CHECK(run.nblocks <= MAXBLOCKS);
+    }
+
+  flush_run(&run);
+  CHECK(memcmp(g_disk, g_refdisk, sizeof(g_disk)) == 0);
+
+  printf("%d writes became %u transfers\n", NRANDOM, nflushes + 1);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, char **argv)
+{
+  test_back_merge();
+  test_front_merge();
+  test_overlap_merge();
+  test_no_merge();
+  test_ramdisk();
+
+  if (g_nfailed > 0)
+    {
+      fprintf(stderr, "%d checks FAILED\n", g_nfailed);
+      return EXIT_FAILURE;
+    }
+
+  printf("All block merge tests passed\n");
+  return EXIT_SUCCESS;
+}
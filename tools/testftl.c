@@ -0,0 +1,436 @@
+/****************************************************************************
+ * tools/testftl.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
+#include <nuttx/mtd/mtd.h>
+
+#include "testhost/testhost.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define FTL_PATH        "/dev/ftl0"
+#define RAMSIZE         (1024 * 1024)
+
+#define SECTORSIZE      CONFIG_RAMMTD_BLOCKSIZE
+#define PAGESPER        (CONFIG_RAMMTD_ERASESIZE / CONFIG_RAMMTD_BLOCKSIZE)
+#define MAXSECTORS      (RAMSIZE / SECTORSIZE)
+
+#define NRANDOM         20000  /* Random writes */
+#define MAXWRITE        4      /* Max sectors per random write */
+#define WORKINTERVAL    16     /* Writes between worker runs */
+#define NPOWERCUTS      48     /* Power failures */
+#define NCUTWRITES      24     /* Writes before a power failure */
+
+/* Bounds of the write amplification in hundredths:  Sequential writes only
+ * add the record and segment headers.  Random writes to a full device are
+ * dominated by garbage collection, but must still write no more than two
+ * thirds of the pages that rewriting the erase blocks would (what the FTL
+ * does without CONFIG_FTL_LOGSTRUCT).
+ */
+
+#define MAXWA_SEQUENTIAL 125
+#define MAXWA_RANDOM     800
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct testhost_mtd_s g_mtd;
+static uint8_t g_ram[RAMSIZE];
+
+static FAR struct inode *g_inode;
+static FAR const struct block_operations *g_bops;
+static size_t g_nsectors;
+
+/* What the device should hold:  The generation of the last write of each
+ * sector and, after a power failure, the generation that was last flushed.
+ * Generation 0 is erased.
+ */
+
+static uint32_t g_gen[MAXSECTORS];
+static uint32_t g_flushed[MAXSECTORS];
+static uint32_t g_lastgen;
+
+static uint8_t g_buffer[MAXWRITE * SECTORSIZE];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: test_fill and test_match
+ *
+ * Description:
+ *   The contents of a sector depend on the sector and on the generation of
+ *   the write.  Generation 0 is the erased state.
+ *
+ ****************************************************************************/
+
+static void test_fill(FAR uint8_t *buffer, uint32_t sector, uint32_t gen)
+{
+  int i;
+
+  for (i = 0; i < SECTORSIZE; i++)
+    {
+      buffer[i] = gen == 0 ? 0xff : (uint8_t)(sector * 7 + gen * 13 + i);
+    }
+}
+
+static bool test_match(FAR const uint8_t *buffer, uint32_t sector,
+                       uint32_t gen)
+{
+  uint8_t expected[SECTORSIZE];
+
+  test_fill(expected, sector, gen);
+  return memcmp(buffer, expected, SECTORSIZE) == 0;
+}
+
+/****************************************************************************
+ * Name: test_mount and test_unmount
+ ****************************************************************************/
+
+static void test_mount(void)
+{
+  struct geometry geo;
+  int ret;
+
+  ret = ftl_initialize_by_path(FTL_PATH, &g_mtd.mtd);
+  TESTHOST_CHECK(ret == OK);
+  if (ret < 0)
+    {
+      exit(testhost_result("testftl"));
+    }
+
+  g_inode = testhost_blockdriver(FTL_PATH);
+  g_bops  = g_inode->u.i_bops;
+
+  TESTHOST_CHECK(g_bops->open(g_inode) == OK);
+  TESTHOST_CHECK(g_bops->geometry(g_inode, &geo) == OK);
+  TESTHOST_CHECK(geo.geo_sectorsize == SECTORSIZE);
+  TESTHOST_CHECK(geo.geo_nsectors <= MAXSECTORS);
+
+  g_nsectors = geo.geo_nsectors;
+}
+
+static void test_unmount(void)
+{
+  TESTHOST_CHECK(g_bops->close(g_inode) == OK);
+  TESTHOST_CHECK(g_bops->unlink(g_inode) == OK);
+  TESTHOST_CHECK(unregister_blockdriver(FTL_PATH) == OK);
+}
+
+/****************************************************************************
+ * Name: test_powerfail
+ *
+ * Description:
+ *   Abandon the FTL without flushing or freeing anything, as if the power
+ *   had failed, and restore the power.
+ *
+ ****************************************************************************/
+
+static void test_powerfail(void)
+{
+  g_mtd.budget = 0;
+  (void)testhost_runwork();
+  (void)unregister_blockdriver(FTL_PATH);
+  g_mtd.budget = -1;
+}
+
+/****************************************************************************
+ * Name: test_write
+ ****************************************************************************/
+
+static void test_write(uint32_t start, uint32_t nsectors)
+{
+  uint32_t i;
+
+  g_lastgen++;
+  for (i = 0; i < nsectors; i++)
+    {
+      g_gen[start + i] = g_lastgen;
+      test_fill(&g_buffer[i * SECTORSIZE], start + i, g_lastgen);
+    }
+
+  TESTHOST_CHECK(g_bops->write(g_inode, g_buffer, start, nsectors) ==
+                 (ssize_t)nsectors);
+}
+
+/****************************************************************************
+ * Name: test_flush
+ ****************************************************************************/
+
+static void test_flush(void)
+{
+  TESTHOST_CHECK(g_bops->ioctl(g_inode, BIOC_FLUSH, 0) == OK);
+  memcpy(g_flushed, g_gen, sizeof(g_flushed));
+}
+
+/****************************************************************************
+ * Name: test_verify
+ *
+ * Description:
+ *   Read back every sector.  After a power failure (powerfail true) a
+ *   sector may hold either its last written or its last flushed contents.
+ *
+ ****************************************************************************/
+
+static void test_verify(FAR const char *when, bool powerfail)
+{
+  uint8_t buffer[SECTORSIZE];
+  int nbad = 0;
+  uint32_t i;
+
+  for (i = 0; i < g_nsectors; i++)
+    {
+      if (g_bops->read(g_inode, buffer, i, 1) != 1 ||
+          !(test_match(buffer, i, g_gen[i]) ||
+            (powerfail && test_match(buffer, i, g_flushed[i]))))
+        {
+          if (nbad++ == 0)
+            {
+              printf("Sector %lu is wrong %s\n", (unsigned long)i, when);
+            }
+        }
+      else if (powerfail)
+        {
+          /* From now on the sector holds what was read */
+
+          g_gen[i] = test_match(buffer, i, g_gen[i]) ? g_gen[i] :
+                     g_flushed[i];
+        }
+    }
+
+  TESTHOST_CHECK(nbad == 0);
+  memcpy(g_flushed, g_gen, sizeof(g_flushed));
+}
+
+/****************************************************************************
+ * Name: test_wa
+ *
+ * Description:
+ *   Return the write amplification in hundredths:  Pages written to the
+ *   FLASH for each sector written by the test.
+ *
+ ****************************************************************************/
+
+static uint32_t test_wa(FAR const char *what, uint32_t nsectors)
+{
+  uint32_t wa = (uint32_t)((uint64_t)g_mtd.nwritten * 100 / nsectors);
+
+  printf("%s: %lu sectors written, %lu pages written, %lu erase blocks "
+         "erased, write amplification %lu.%02lu\n", what,
+         (unsigned long)nsectors, (unsigned long)g_mtd.nwritten,
+         (unsigned long)g_mtd.nerased, (unsigned long)(wa / 100),
+         (unsigned long)(wa % 100));
+
+  g_mtd.nwritten = 0;
+  g_mtd.nerased  = 0;
+  return wa;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, char **argv)
+{
+  struct blkdiscard_s discard;
+  uint8_t buffer[SECTORSIZE];
+  uint32_t nwritten;
+  uint32_t nrewrite;
+  uint32_t npages;
+  uint32_t start;
+  uint32_t nsectors;
+  uint32_t erased;
+  uint32_t wa;
+  int i;
+  int j;
+
+  srand(1);
+
+  memset(g_ram, CONFIG_RAMMTD_ERASESTATE, RAMSIZE);
+  TESTHOST_CHECK(testhost_mtd_initialize(&g_mtd,
+                 rammtd_initialize(g_ram, RAMSIZE)) != NULL);
+
+  /* Mount the erased FLASH:  Nothing reads back */
+
+  test_mount();
+  printf("%lu sectors of %d bytes, %d pages per erase block\n",
+         (unsigned long)g_nsectors, SECTORSIZE, PAGESPER);
+
+  TESTHOST_CHECK(g_bops->read(g_inode, buffer, 0, 1) == 1);
+  TESTHOST_CHECK(test_match(buffer, 0, 0));
+  TESTHOST_CHECK(g_bops->write(g_inode, g_buffer, g_nsectors, 1) ==
+                 -EINVAL);
+
+  /* Fill the device sequentially.  Nothing has to be reclaimed while the
+   * first half is written.
+   */
+
+  g_mtd.nwritten = 0;
+  for (start = 0; start < g_nsectors; start += nsectors)
+    {
+      nsectors = g_nsectors - start < MAXWRITE ? g_nsectors - start :
+                 MAXWRITE;
+      test_write(start, nsectors);
+
+      if (start < g_nsectors / 2 && start + nsectors >= g_nsectors / 2)
+        {
+          test_flush();
+          (void)testhost_runwork();
+          wa = test_wa("Sequential", start + nsectors);
+          TESTHOST_CHECK(wa <= MAXWA_SEQUENTIAL);
+        }
+    }
+
+  test_flush();
+  (void)testhost_runwork();
+  test_verify("after the sequential fill", false);
+
+  /* Overwrite the full device randomly, many times its capacity.  The
+   * garbage collector must keep up and must not lose anything.
+   */
+
+  nwritten = 0;
+  nrewrite = 0;
+  for (i = 0; i < NRANDOM; i++)
+    {
+      nsectors  = 1 + rand() % MAXWRITE;
+      start     = rand() % (g_nsectors - nsectors + 1);
+      test_write(start, nsectors);
+      nwritten += nsectors;
+      nrewrite += ((start + nsectors - 1) / PAGESPER - start / PAGESPER + 1) *
+                  PAGESPER;
+
+      if ((i % WORKINTERVAL) == 0)
+        {
+          (void)testhost_runwork();
+        }
+    }
+
+  test_flush();
+  (void)testhost_runwork();
+  erased = g_mtd.nerased;
+  npages = g_mtd.nwritten;
+  wa = test_wa("Random", nwritten);
+  printf("Rewriting the erase blocks would have written %lu pages\n",
+         (unsigned long)nrewrite);
+
+  TESTHOST_CHECK(erased > 0);
+  TESTHOST_CHECK(wa <= MAXWA_RANDOM);
+  TESTHOST_CHECK((uint64_t)npages * 3 <= (uint64_t)nrewrite * 2);
+  test_verify("after the random writes", false);
+
+  /* Remount:  The map is rebuilt from the log */
+
+  test_unmount();
+  test_mount();
+  test_verify("after remounting", false);
+
+  /* Discarded sectors read as erased.  Their old contents may reappear
+   * after the next mount, so write them again afterwards.
+   */
+
+  discard.bd_startsector = g_nsectors / 2;
+  discard.bd_nsectors    = PAGESPER;
+  TESTHOST_CHECK(g_bops->ioctl(g_inode, BIOC_DISCARD,
+                               (unsigned long)((uintptr_t)&discard)) == OK);
+  for (i = 0; i < PAGESPER; i++)
+    {
+      g_gen[discard.bd_startsector + i] = 0;
+    }
+
+  test_verify("after discarding", false);
+
+  for (i = 0; i < PAGESPER; i += MAXWRITE)
+    {
+      test_write(discard.bd_startsector + i, MAXWRITE);
+    }
+
+  /* Lose power at every point of a sequence of writes and of the work
+   * that follows them.  Nothing that was flushed is lost and every
+   * sector holds either its flushed or its last written contents.  Then
+   * the log must remain usable.
+   */
+
+  test_unmount();
+  test_mount();
+  test_verify("before the power failures", false);
+
+  for (i = 0; i < NPOWERCUTS; i++)
+    {
+      /* Write each sector only once so that it cannot hold any other
+       * contents.
+       */
+
+      g_mtd.budget = i * 3;
+      start        = rand() % g_nsectors;
+      for (j = 0; j < NCUTWRITES; j++)
+        {
+          test_write((start + j) % g_nsectors, 1);
+        }
+
+      (void)testhost_runwork();
+      test_powerfail();
+      test_mount();
+      test_verify("after a power failure", true);
+
+      test_write(rand() % g_nsectors, 1);
+      test_flush();
+    }
+
+  test_unmount();
+  test_mount();
+  test_verify("after the power failures", false);
+  test_unmount();
+
+  return testhost_result("testftl");
+}
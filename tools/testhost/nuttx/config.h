@@ -0,0 +1,64 @@
+/****************************************************************************
+ * tools/testhost/nuttx/config.h
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/* The host tests build unmodified kernel sources against this minimal flat
+ * build configuration of the simulator.  The options of the code under
+ * test are given on the command line (see tools/Makefile.host).
+ */
+
+#ifndef __TOOLS_TESTHOST_NUTTX_CONFIG_H
+#define __TOOLS_TESTHOST_NUTTX_CONFIG_H
+
+#define CONFIG_ARCH "sim"
+#define CONFIG_ARCH_SIM 1
+#define CONFIG_HOST_X86_64 1
+#define CONFIG_BUILD_FLAT 1
+#define CONFIG_MM_REGIONS 1
+#define CONFIG_MAX_WDOGPARMS 4
+#define CONFIG_NFILE_DESCRIPTORS 8
+#define CONFIG_NFILE_STREAMS 0
+#define CONFIG_NSOCKET_DESCRIPTORS 0
+#define CONFIG_NAME_MAX 32
+#define CONFIG_PATH_MAX 64
+#define CONFIG_TASK_NAME_SIZE 0
+#define CONFIG_USEC_PER_TICK 10000
+#define CONFIG_DISABLE_POLL 1
+#define CONFIG_FS_WRITABLE 1
+#define CONFIG_MTD 1
+#define CONFIG_SCHED_WORKQUEUE 1
+#define CONFIG_SCHED_HPWORK 1
+#define CONFIG_SCHED_LPWORK 1
+
+#endif /* __TOOLS_TESTHOST_NUTTX_CONFIG_H */
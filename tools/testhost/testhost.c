@@ -0,0 +1,478 @@
+/****************************************************************************
+ * tools/testhost/testhost.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+#include <errno.h>
+
+#include <nuttx/semaphore.h>
+#include <nuttx/wqueue.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/mtd/mtd.h>
+
+#include "testhost.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define TESTHOST_NWORK   8
+#define TESTHOST_NINODES 4
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+int g_testhost_nfailed;
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static FAR struct work_s *g_work[TESTHOST_NWORK];
+static int g_nwork;
+
+static FAR struct inode *g_inodes[TESTHOST_NINODES];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: testhost_abort
+ *
+ * Description:
+ *   Something that cannot happen in a single threaded test happened (a
+ *   thread would have blocked forever, for example).
+ *
+ ****************************************************************************/
+
+static void testhost_abort(FAR const char *msg)
+{
+  printf("ERROR: %s\n", msg);
+  abort();
+}
+
+/****************************************************************************
+ * Name: testhost_findwork
+ ****************************************************************************/
+
+static int testhost_findwork(FAR struct work_s *work)
+{
+  int i;
+
+  for (i = 0; i < g_nwork; i++)
+    {
+      if (g_work[i] == work)
+        {
+          return i;
+        }
+    }
+
+  return -ENOENT;
+}
+
+/****************************************************************************
+ * Name: testhost_removework
+ ****************************************************************************/
+
+static void testhost_removework(int ndx)
+{
+  g_nwork--;
+  memmove(&g_work[ndx], &g_work[ndx + 1],
+          (g_nwork - ndx) * sizeof(FAR struct work_s *));
+}
+
+/****************************************************************************
+ * Name: testhost_mtd_erase, testhost_mtd_bread, testhost_mtd_bwrite,
+ *       testhost_mtd_read, testhost_mtd_write and testhost_mtd_ioctl
+ ****************************************************************************/
+
+static int testhost_mtd_erase(FAR struct mtd_dev_s *dev, off_t startblock,
+                              size_t nblocks)
+{
+  FAR struct testhost_mtd_s *priv = (FAR struct testhost_mtd_s *)dev;
+
+  if (priv->budget == 0)
+    {
+      return OK;
+    }
+
+  priv->nerased += nblocks;
+  return MTD_ERASE(priv->lower, startblock, nblocks);
+}
+
+static ssize_t testhost_mtd_bread(FAR struct mtd_dev_s *dev,
+                                  off_t startblock, size_t nblocks,
+                                  FAR uint8_t *buffer)
+{
+  FAR struct testhost_mtd_s *priv = (FAR struct testhost_mtd_s *)dev;
+
+  priv->nreads++;
+  priv->nbytesread += nblocks * priv->blocksize;
+  return MTD_BREAD(priv->lower, startblock, nblocks, buffer);
+}
+
+static ssize_t testhost_mtd_bwrite(FAR struct mtd_dev_s *dev,
+                                   off_t startblock, size_t nblocks,
+                                   FAR const uint8_t *buffer)
+{
+  FAR struct testhost_mtd_s *priv = (FAR struct testhost_mtd_s *)dev;
+  size_t nwrite = nblocks;
+  ssize_t ret;
+
+  if (priv->budget >= 0)
+    {
+      if (nwrite > (size_t)priv->budget)
+        {
+          nwrite = priv->budget;
+        }
+
+      priv->budget -= nwrite;
+      if (nwrite == 0)
+        {
+          return nblocks;
+        }
+    }
+
+  priv->nwritten += nwrite;
+  ret = MTD_BWRITE(priv->lower, startblock, nwrite, buffer);
+  return ret == (ssize_t)nwrite ? (ssize_t)nblocks : ret;
+}
+
+static ssize_t testhost_mtd_read(FAR struct mtd_dev_s *dev, off_t offset,
+                                 size_t nbytes, FAR uint8_t *buffer)
+{
+  FAR struct testhost_mtd_s *priv = (FAR struct testhost_mtd_s *)dev;
+
+  priv->nreads++;
+  priv->nbytesread += nbytes;
+  return MTD_READ(priv->lower, offset, nbytes, buffer);
+}
+
+#ifdef CONFIG_MTD_BYTE_WRITE
+static ssize_t testhost_mtd_write(FAR struct mtd_dev_s *dev, off_t offset,
+                                  size_t nbytes, FAR const uint8_t *buffer)
+{
+  FAR struct testhost_mtd_s *priv = (FAR struct testhost_mtd_s *)dev;
+
+  if (priv->budget == 0)
+    {
+      return nbytes;
+    }
+
+  if (priv->budget > 0)
+    {
+      priv->budget--;
+    }
+
+  priv->nwritten++;
+  return MTD_WRITE(priv->lower, offset, nbytes, buffer);
+}
+#endif
+
+static int testhost_mtd_ioctl(FAR struct mtd_dev_s *dev, int cmd,
+                              unsigned long arg)
+{
+  FAR struct testhost_mtd_s *priv = (FAR struct testhost_mtd_s *)dev;
+
+  return MTD_IOCTL(priv->lower, cmd, arg);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: zalloc
+ ****************************************************************************/
+
+FAR void *zalloc(size_t size)
+{
+  return calloc(1, size);
+}
+
+/****************************************************************************
+ * Name: nxsem_*
+ *
+ * Description:
+ *   Counting semaphores without waiting:  A wait on a semaphore that has
+ *   no count would block forever.
+ *
+ ****************************************************************************/
+
+int nxsem_init(FAR sem_t *sem, int pshared, unsigned int value)
+{
+  sem->semcount = (int16_t)value;
+  return OK;
+}
+
+int nxsem_destroy(FAR sem_t *sem)
+{
+  return OK;
+}
+
+int nxsem_setprotocol(FAR sem_t *sem, int protocol)
+{
+  return OK;
+}
+
+int nxsem_wait(FAR sem_t *sem)
+{
+  if (sem->semcount <= 0)
+    {
+      testhost_abort("nxsem_wait() would deadlock");
+    }
+
+  sem->semcount--;
+  return OK;
+}
+
+int nxsem_trywait(FAR sem_t *sem)
+{
+  if (sem->semcount <= 0)
+    {
+      return -EAGAIN;
+    }
+
+  sem->semcount--;
+  return OK;
+}
+
+int nxsem_post(FAR sem_t *sem)
+{
+  sem->semcount++;
+  return OK;
+}
+
+int nxsem_getvalue(FAR sem_t *sem, FAR int *sval)
+{
+  *sval = sem->semcount;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: work_queue and work_cancel
+ *
+ * Description:
+ *   Queued work is run by testhost_runwork().
+ *
+ ****************************************************************************/
+
+int work_queue(int qid, FAR struct work_s *work, worker_t worker,
+               FAR void *arg, clock_t delay)
+{
+  if (testhost_findwork(work) < 0)
+    {
+      if (g_nwork >= TESTHOST_NWORK)
+        {
+          testhost_abort("Too much work queued");
+        }
+
+      g_work[g_nwork++] = work;
+    }
+
+  work->worker = worker;
+  work->arg    = arg;
+  work->delay  = delay;
+  return OK;
+}
+
+int work_cancel(int qid, FAR struct work_s *work)
+{
+  int ndx = testhost_findwork(work);
+
+  if (ndx < 0)
+    {
+      return ndx;
+    }
+
+  testhost_removework(ndx);
+  work->worker = NULL;
+  return OK;
+}
+
+int testhost_runwork(void)
+{
+  FAR struct work_s *work;
+  worker_t worker;
+  int nrun = 0;
+
+  while (g_nwork > 0)
+    {
+      work   = g_work[0];
+      worker = work->worker;
+      testhost_removework(0);
+
+      /* Like the work queue threads, make the work available again before
+       * it runs so that it can requeue itself.
+       */
+
+      work->worker = NULL;
+      worker(work->arg);
+      nrun++;
+    }
+
+  return nrun;
+}
+
+/****************************************************************************
+ * Name: register_blockdriver and unregister_blockdriver
+ *
+ * Description:
+ *   There is no pseudo file system:  The inodes are only remembered so that
+ *   the test can find them with testhost_blockdriver().  Unregistering does
+ *   not call the unlink method; the test does that.
+ *
+ ****************************************************************************/
+
+int register_blockdriver(FAR const char *path,
+                         FAR const struct block_operations *bops,
+                         mode_t mode, FAR void *priv)
+{
+  FAR struct inode *inode;
+  int i;
+
+  if (testhost_blockdriver(path) != NULL)
+    {
+      return -EEXIST;
+    }
+
+  for (i = 0; i < TESTHOST_NINODES; i++)
+    {
+      if (g_inodes[i] == NULL)
+        {
+          inode = (FAR struct inode *)zalloc(FSNODE_SIZE(strlen(path)));
+          if (inode == NULL)
+            {
+              return -ENOMEM;
+            }
+
+          inode->u.i_bops  = bops;
+          inode->i_private = priv;
+          strcpy(inode->i_name, path);
+          g_inodes[i] = inode;
+          return OK;
+        }
+    }
+
+  return -ENOSPC;
+}
+
+int unregister_blockdriver(FAR const char *path)
+{
+  int i;
+
+  for (i = 0; i < TESTHOST_NINODES; i++)
+    {
+      if (g_inodes[i] != NULL && strcmp(g_inodes[i]->i_name, path) == 0)
+        {
+          free(g_inodes[i]);
+          g_inodes[i] = NULL;
+          return OK;
+        }
+    }
+
+  return -ENOENT;
+}
+
+FAR struct inode *testhost_blockdriver(FAR const char *path)
+{
+  int i;
+
+  for (i = 0; i < TESTHOST_NINODES; i++)
+    {
+      if (g_inodes[i] != NULL && strcmp(g_inodes[i]->i_name, path) == 0)
+        {
+          return g_inodes[i];
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: testhost_mtd_initialize
+ ****************************************************************************/
+
+FAR struct mtd_dev_s *testhost_mtd_initialize(FAR struct testhost_mtd_s *priv,
+                                              FAR struct mtd_dev_s *lower)
+{
+  struct mtd_geometry_s geo;
+
+  if (lower == NULL ||
+      MTD_IOCTL(lower, MTDIOC_GEOMETRY, (unsigned long)((uintptr_t)&geo)) < 0)
+    {
+      return NULL;
+    }
+
+  memset(priv, 0, sizeof(struct testhost_mtd_s));
+  priv->mtd.erase  = testhost_mtd_erase;
+  priv->mtd.bread  = testhost_mtd_bread;
+  priv->mtd.bwrite = testhost_mtd_bwrite;
+  priv->mtd.read   = testhost_mtd_read;
+#ifdef CONFIG_MTD_BYTE_WRITE
+  priv->mtd.write  = lower->write != NULL ? testhost_mtd_write : NULL;
+#endif
+  priv->mtd.ioctl  = testhost_mtd_ioctl;
+  priv->mtd.name   = "testhost";
+  priv->lower      = lower;
+  priv->blocksize  = geo.blocksize;
+  priv->budget     = -1;
+  return &priv->mtd;
+}
+
+/****************************************************************************
+ * Name: testhost_result
+ ****************************************************************************/
+
+int testhost_result(FAR const char *name)
+{
+  if (g_testhost_nfailed > 0)
+    {
+      printf("%s: %d checks FAILED\n", name, g_testhost_nfailed);
+      return EXIT_FAILURE;
+    }
+
+  printf("%s: PASSED\n", name);
+  return EXIT_SUCCESS;
+}
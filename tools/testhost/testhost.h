@@ -0,0 +1,146 @@
+/****************************************************************************
+ * tools/testhost/testhost.h
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#ifndef __TOOLS_TESTHOST_TESTHOST_H
+#define __TOOLS_TESTHOST_TESTHOST_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/mtd/mtd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Count and report a failed check, but keep going */
+
+#define TESTHOST_CHECK(c) \
+  do \
+    { \
+      if (!(c)) \
+        { \
+          printf("%s:%d: Check failed: %s\n", __FILE__, __LINE__, #c); \
+          g_testhost_nfailed++; \
+        } \
+    } \
+  while (0)
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* An MTD wrapper that counts the operations of the code under test on the
+ * lower MTD and that can lose power:  After budget blocks have been
+ * written, all further writes and erasures are silently dropped.
+ */
+
+struct testhost_mtd_s
+{
+  struct mtd_dev_s mtd;          /* Must be first */
+  FAR struct mtd_dev_s *lower;   /* The MTD that holds the data */
+  uint32_t blocksize;            /* Read/write block size of lower */
+  uint32_t nreads;               /* Read operations */
+  uint32_t nbytesread;           /* Bytes read */
+  uint32_t nwritten;             /* Blocks written */
+  uint32_t nerased;              /* Erase blocks erased */
+  long budget;                   /* Blocks until power fails, or -1 */
+};
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+/* The number of failed checks */
+
+extern int g_testhost_nfailed;
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: testhost_blockdriver
+ *
+ * Description:
+ *   Return the inode that a driver under test registered with
+ *   register_blockdriver(), or NULL if there is none at path.
+ *
+ ****************************************************************************/
+
+FAR struct inode *testhost_blockdriver(FAR const char *path);
+
+/****************************************************************************
+ * Name: testhost_mtd_initialize
+ *
+ * Description:
+ *   Initialize an MTD wrapper around lower and return its MTD interface.
+ *
+ ****************************************************************************/
+
+FAR struct mtd_dev_s *testhost_mtd_initialize(FAR struct testhost_mtd_s *priv,
+                                              FAR struct mtd_dev_s *lower);
+
+/****************************************************************************
+ * Name: testhost_runwork
+ *
+ * Description:
+ *   The host tests are single threaded:  Work queued with work_queue() is
+ *   not run until the test calls this function.  It runs all queued work,
+ *   including work queued by the work itself, regardless of its delay.
+ *   Returns the number of work items that were run.
+ *
+ ****************************************************************************/
+
+int testhost_runwork(void);
+
+/****************************************************************************
+ * Name: testhost_result
+ *
+ * Description:
+ *   Report the result of the test and return the exit status.
+ *
+ ****************************************************************************/
+
+int testhost_result(FAR const char *name);
+
+#endif /* __TOOLS_TESTHOST_TESTHOST_H */
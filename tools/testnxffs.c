@@ -0,0 +1,517 @@
+/****************************************************************************
+ * tools/testnxffs.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/stat.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <nuttx/kmalloc.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/mtd/mtd.h>
+
+#include "testhost/testhost.h"
+
+/* The test compares the inode index with the inodes on FLASH */
+
+#include "../fs/nxffs/nxffs.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The open benchmark:  Many small files on a large volume */
+
+#define BENCHSIZE      (16 * 1024 * 1024)
+#define BENCHFILES     500
+#define BENCHMAXLEN    1024
+
+/* The index coherence test:  A small volume that must be packed often */
+
+#define CHURNSIZE      (256 * 1024)
+#define CHURNFILES     40
+#define CHURNMAXLEN    4096
+#define CHURNOPS       4000
+#define CHECKINTERVAL  100    /* Operations between checks of all files */
+#define PACKINTERVAL   500    /* Operations between explicit packs */
+#define MOUNTINTERVAL  1000   /* Operations between remounts */
+
+#define MAXFILES       BENCHFILES
+#define MAXLEN         CHURNMAXLEN
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static uint8_t g_ram[BENCHSIZE];
+static struct testhost_mtd_s g_mtd;
+static struct inode g_mountpt;
+
+/* What the volume should hold:  The generation and length of the last
+ * write of each file.  Generation 0 means that the file does not exist.
+ */
+
+static uint32_t g_gen[MAXFILES];
+static size_t g_len[MAXFILES];
+static uint32_t g_lastgen;
+static int g_nfiles;
+static uint32_t g_npacks;
+
+static char g_buffer[MAXLEN];
+static char g_expected[MAXLEN];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: test_name and test_fill
+ ****************************************************************************/
+
+static FAR const char *test_name(int file)
+{
+  static char name[16];
+
+  snprintf(name, sizeof(name), "file%03d", file);
+  return name;
+}
+
+static void test_fill(FAR char *buffer, int file, uint32_t gen, size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      buffer[i] = (char)(file * 7 + gen * 13 + i);
+    }
+}
+
+/****************************************************************************
+ * Name: test_mount
+ *
+ * Description:
+ *   Mount the NXFFS volume on the MTD, releasing the buffers of the
+ *   previous mount.
+ *
+ ****************************************************************************/
+
+static void test_mount(FAR struct mtd_dev_s *mtd)
+{
+  int ret;
+
+  if (g_volume.cache != NULL)
+    {
+      g_npacks += g_volume.npacks;
+      kmm_free(g_volume.cache);
+      kmm_free(g_volume.pack);
+#if CONFIG_NXFFS_READAHEAD > 1
+      kmm_free(g_volume.rabuf);
+#endif
+      kmm_free(g_volume.index);
+    }
+
+  ret = nxffs_initialize(mtd);
+  TESTHOST_CHECK(ret == OK);
+  if (ret < 0)
+    {
+      exit(testhost_result("testnxffs"));
+    }
+
+  g_mountpt.i_private = &g_volume;
+}
+
+/****************************************************************************
+ * Name: test_create and test_unlink
+ ****************************************************************************/
+
+static int test_create(int file, size_t len)
+{
+  struct file filep;
+  ssize_t nwritten;
+  int ret;
+
+  memset(&filep, 0, sizeof(struct file));
+  filep.f_inode = &g_mountpt;
+
+  ret = nxffs_open(&filep, test_name(file), O_WRONLY | O_CREAT | O_TRUNC,
+                   0666);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  g_lastgen++;
+  test_fill(g_buffer, file, g_lastgen, len);
+  nwritten = nxffs_write(&filep, g_buffer, len);
+
+  ret = nxffs_close(&filep);
+  if (nwritten != (ssize_t)len || ret < 0)
+    {
+      return nwritten < 0 ? (int)nwritten : ret < 0 ? ret : -ENOSPC;
+    }
+
+  g_gen[file] = g_lastgen;
+  g_len[file] = len;
+  return OK;
+}
+
+static void test_unlink(int file)
+{
+  TESTHOST_CHECK(nxffs_unlink(&g_mountpt, test_name(file)) == OK);
+  g_gen[file] = 0;
+}
+
+/****************************************************************************
+ * Name: test_open
+ *
+ * Description:
+ *   Open a file for reading and close it again.
+ *
+ ****************************************************************************/
+
+static int test_open(int file)
+{
+  struct file filep;
+  int ret;
+
+  memset(&filep, 0, sizeof(struct file));
+  filep.f_inode = &g_mountpt;
+
+  ret = nxffs_open(&filep, test_name(file), O_RDONLY, 0);
+  if (ret == OK)
+    {
+      ret = nxffs_close(&filep);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: test_ixcompare
+ *
+ * Description:
+ *   Sort an index by hash and offset so that two indexes with the same
+ *   entries compare equal.
+ *
+ ****************************************************************************/
+
+static int test_ixcompare(FAR const void *a, FAR const void *b)
+{
+  FAR const struct nxffs_ixentry_s *ea = a;
+  FAR const struct nxffs_ixentry_s *eb = b;
+
+  if (ea->hash != eb->hash)
+    {
+      return ea->hash < eb->hash ? -1 : 1;
+    }
+
+  return ea->hoffset < eb->hoffset ? -1 : ea->hoffset > eb->hoffset;
+}
+
+/****************************************************************************
+ * Name: test_ixcheck
+ *
+ * Description:
+ *   If the inode index is valid, it must hold exactly the entries that a
+ *   scan of the inodes on FLASH finds.
+ *
+ ****************************************************************************/
+
+static void test_ixcheck(FAR const char *what)
+{
+  FAR struct nxffs_ixentry_s *index;
+  size_t size;
+  int nindex;
+  int nlive;
+  int i;
+
+  if (g_volume.ixstate != NXFFS_IXSTATE_VALID)
+    {
+      return;
+    }
+
+  nindex = g_volume.nindex;
+  size   = nindex * sizeof(struct nxffs_ixentry_s);
+  index  = malloc(size + 1);
+  memcpy(index, g_volume.index, size);
+
+  TESTHOST_CHECK(nxffs_ixbuild(&g_volume) == OK);
+  TESTHOST_CHECK(g_volume.nindex == nindex);
+
+  for (nlive = 0, i = 0; i < g_nfiles; i++)
+    {
+      nlive += g_gen[i] != 0;
+    }
+
+  TESTHOST_CHECK(nindex == nlive);
+
+  if (g_volume.nindex == nindex)
+    {
+      qsort(index, nindex, sizeof(struct nxffs_ixentry_s), test_ixcompare);
+      qsort(g_volume.index, nindex, sizeof(struct nxffs_ixentry_s),
+            test_ixcompare);
+
+      if (memcmp(index, g_volume.index, size) != 0)
+        {
+          printf("%s: The inode index differs from the inodes\n", what);
+          g_testhost_nfailed++;
+        }
+    }
+
+  free(index);
+}
+
+/****************************************************************************
+ * Name: test_verify
+ *
+ * Description:
+ *   Check the index and read back every file.  Removed files must not be
+ *   found.
+ *
+ ****************************************************************************/
+
+static void test_verify(FAR const char *what)
+{
+  struct file filep;
+  struct stat buf;
+  ssize_t nread;
+  int nbad = 0;
+  int ret;
+  int i;
+
+  test_ixcheck(what);
+
+  for (i = 0; i < g_nfiles; i++)
+    {
+      if (g_gen[i] == 0)
+        {
+          if (nxffs_stat(&g_mountpt, test_name(i), &buf) != -ENOENT)
+            {
+              nbad++;
+            }
+
+          continue;
+        }
+
+      memset(&filep, 0, sizeof(struct file));
+      filep.f_inode = &g_mountpt;
+
+      ret = nxffs_open(&filep, test_name(i), O_RDONLY, 0);
+      if (ret < 0)
+        {
+          nbad++;
+          continue;
+        }
+
+      test_fill(g_expected, i, g_gen[i], g_len[i]);
+      nread = nxffs_read(&filep, g_buffer, MAXLEN);
+      if (nread != (ssize_t)g_len[i] ||
+          memcmp(g_buffer, g_expected, g_len[i]) != 0)
+        {
+          nbad++;
+        }
+
+      TESTHOST_CHECK(nxffs_close(&filep) == OK);
+    }
+
+  if (nbad > 0)
+    {
+      printf("%s: %d of %d files are wrong\n", what, nbad, g_nfiles);
+      g_testhost_nfailed++;
+    }
+
+  /* Opening the files rebuilt an index that was invalid */
+
+  TESTHOST_CHECK(g_volume.ixstate == NXFFS_IXSTATE_VALID);
+  test_ixcheck(what);
+}
+
+/****************************************************************************
+ * Name: test_bench
+ *
+ * Description:
+ *   Open every file with the inode index and with the linear search of the
+ *   inodes, and report the FLASH reads of each.
+ *
+ ****************************************************************************/
+
+static void test_bench(void)
+{
+  uint32_t nreads[2];
+  uint32_t nbytes[2];
+  int pass;
+  int i;
+
+  for (pass = 0; pass < 2; pass++)
+    {
+      nxffs_ixreset(&g_volume, pass == 0 ? NXFFS_IXSTATE_INVALID :
+                    NXFFS_IXSTATE_DISABLED);
+
+      /* Build the index before counting, as the mount does */
+
+      if (pass == 0)
+        {
+          TESTHOST_CHECK(nxffs_ixbuild(&g_volume) == OK);
+        }
+
+      g_mtd.nreads     = 0;
+      g_mtd.nbytesread = 0;
+
+      for (i = 0; i < BENCHFILES; i++)
+        {
+          TESTHOST_CHECK(test_open(i) == OK);
+        }
+
+      nreads[pass] = g_mtd.nreads;
+      nbytes[pass] = g_mtd.nbytesread;
+    }
+
+  nxffs_ixreset(&g_volume, NXFFS_IXSTATE_INVALID);
+
+  printf("Open of %d files:  With the index %lu reads / %lu bytes, "
+         "linear search %lu reads / %lu bytes\n", BENCHFILES,
+         (unsigned long)nreads[0], (unsigned long)nbytes[0],
+         (unsigned long)nreads[1], (unsigned long)nbytes[1]);
+
+  TESTHOST_CHECK(nbytes[0] * 20 < nbytes[1]);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: main
+ ****************************************************************************/
+
+int main(int argc, char **argv)
+{
+  char what[32];
+  size_t len;
+  int file;
+  int ret;
+  int i;
+
+  srand(1);
+
+  /* Benchmark the open of many files on a large volume */
+
+  memset(g_ram, CONFIG_RAMMTD_ERASESTATE, BENCHSIZE);
+  test_mount(testhost_mtd_initialize(&g_mtd,
+             rammtd_initialize(g_ram, BENCHSIZE)));
+
+  g_nfiles = BENCHFILES;
+  for (i = 0; i < BENCHFILES; i++)
+    {
+      TESTHOST_CHECK(test_create(i, 1 + rand() % BENCHMAXLEN) == OK);
+    }
+
+  test_verify("Created");
+
+  g_mtd.nreads     = 0;
+  g_mtd.nbytesread = 0;
+  test_mount(&g_mtd.mtd);
+  printf("Mount of %d files:  %lu reads / %lu bytes\n", BENCHFILES,
+         (unsigned long)g_mtd.nreads, (unsigned long)g_mtd.nbytesread);
+
+  test_bench();
+  test_verify("Remounted");
+
+  /* Create, replace and remove files at random on a small volume.  The
+   * volume fills up and is packed by the writes.
+   */
+
+  memset(g_gen, 0, sizeof(g_gen));
+  memset(g_ram, CONFIG_RAMMTD_ERASESTATE, CHURNSIZE);
+  test_mount(testhost_mtd_initialize(&g_mtd,
+             rammtd_initialize(g_ram, CHURNSIZE)));
+
+  g_nfiles = CHURNFILES;
+  for (i = 1; i <= CHURNOPS; i++)
+    {
+      file = rand() % CHURNFILES;
+      if (g_gen[file] != 0 && rand() % 4 == 0)
+        {
+          test_unlink(file);
+        }
+      else
+        {
+          len = 1 + rand() % CHURNMAXLEN;
+          ret = test_create(file, len);
+          if (ret < 0)
+            {
+              printf("Operation %d: Failed to write %lu bytes to %s: %d\n",
+                     i, (unsigned long)len, test_name(file), ret);
+              g_testhost_nfailed++;
+              g_gen[file] = 0;
+            }
+        }
+
+      if ((i % MOUNTINTERVAL) == 0)
+        {
+          snprintf(what, sizeof(what), "Remount %d", i);
+          test_mount(&g_mtd.mtd);
+          test_verify(what);
+        }
+      else if ((i % PACKINTERVAL) == 0)
+        {
+          snprintf(what, sizeof(what), "Pack %d", i);
+          TESTHOST_CHECK(nxffs_pack(&g_volume) == OK);
+          test_verify(what);
+        }
+      else if ((i % CHECKINTERVAL) == 0)
+        {
+          snprintf(what, sizeof(what), "Operation %d", i);
+          test_verify(what);
+        }
+    }
+
+  g_npacks += g_volume.npacks;
+  printf("%d operations, %lu packs, %lu erase blocks erased\n", CHURNOPS,
+         (unsigned long)g_npacks, (unsigned long)g_mtd.nerased);
+
+  TESTHOST_CHECK(g_npacks > CHURNOPS / PACKINTERVAL);
+  return testhost_result("testnxffs");
+}
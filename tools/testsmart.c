@@ -0,0 +1,481 @@
+/****************************************************************************
+ * tools/testsmart.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
+#include <nuttx/fs/smart.h>
+#include <nuttx/mtd/mtd.h>
+
+#include "testhost/testhost.h"
+
+/* The test compares the sector maps of SMART devices, which are private to
+ * the driver.
+ */
+
+#include "../drivers/mtd/smart.c"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define RAMSIZE         (2 * 1024 * 1024)
+#define MAXSECTORS      (RAMSIZE / CONFIG_MTD_SMART_SECTOR_SIZE)
+
+#define NOPS            24000  /* Sector operations */
+#define COMPAREINTERVAL 3000   /* Operations between mount comparisons */
+#define USEDPERCENT     60     /* Allocated logical sectors */
+
+/* How the checkpoint of the copy that must be scanned is damaged */
+
+#define CORRUPT_MAP     0      /* A bit of the sector map */
+#define CORRUPT_HEADER  1      /* The magic number of the header */
+#define CORRUPT_LOG     2      /* An invalid log entry */
+#define CORRUPT_COUNTS  3      /* A bit of the free and released counts */
+#define NCORRUPT        4
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The device under test, a copy of it mounted with its checkpoint and a
+ * copy mounted with a full scan.
+ */
+
+static uint8_t g_ram[RAMSIZE];
+static uint8_t g_ckptram[RAMSIZE];
+static uint8_t g_scanram[RAMSIZE];
+
+static struct testhost_mtd_s g_mtd;
+static struct testhost_mtd_s g_ckptmtd;
+static struct testhost_mtd_s g_scanmtd;
+
+static FAR struct inode *g_inode;
+static FAR struct smart_struct_s *g_dev;
+static uint16_t g_availbytes;
+
+/* The generation of the last write of each logical sector, 0 if the sector
+ * is not allocated.
+ */
+
+static uint32_t g_gen[MAXSECTORS];
+static uint32_t g_lastgen;
+static uint8_t g_buffer[CONFIG_MTD_SMART_SECTOR_SIZE];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: test_fill
+ ****************************************************************************/
+
+static void test_fill(FAR uint8_t *buffer, uint16_t sector, uint32_t gen)
+{
+  int i;
+
+  for (i = 0; i < g_availbytes; i++)
+    {
+      buffer[i] = (uint8_t)(sector * 7 + gen * 13 + i);
+    }
+}
+
+/****************************************************************************
+ * Name: test_mount
+ ****************************************************************************/
+
+static FAR struct inode *test_mount(int minor, FAR struct mtd_dev_s *mtd)
+{
+  char path[16];
+
+  if (smart_initialize(minor, mtd, NULL) < 0)
+    {
+      return NULL;
+    }
+
+  snprintf(path, sizeof(path), "/dev/smart%d", minor);
+  return testhost_blockdriver(path);
+}
+
+/****************************************************************************
+ * Name: test_write, test_alloc and test_free
+ ****************************************************************************/
+
+static void test_write(uint16_t sector)
+{
+  struct smart_read_write_s req;
+
+  g_gen[sector] = ++g_lastgen;
+  test_fill(g_buffer, sector, g_lastgen);
+
+  req.logsector = sector;
+  req.offset    = 0;
+  req.count     = g_availbytes;
+  req.buffer    = g_buffer;
+
+  TESTHOST_CHECK(g_inode->u.i_bops->ioctl(g_inode, BIOC_WRITESECT,
+                 (unsigned long)((uintptr_t)&req)) >= 0);
+}
+
+static void test_alloc(void)
+{
+  int ret;
+
+  ret = g_inode->u.i_bops->ioctl(g_inode, BIOC_ALLOCSECT, 0xffff);
+  TESTHOST_CHECK(ret >= 0 && ret < MAXSECTORS && g_gen[ret] == 0);
+  if (ret >= 0 && ret < MAXSECTORS)
+    {
+      test_write(ret);
+    }
+}
+
+static void test_free(uint16_t sector)
+{
+  TESTHOST_CHECK(g_inode->u.i_bops->ioctl(g_inode, BIOC_FREESECT,
+                                          sector) == OK);
+  g_gen[sector] = 0;
+}
+
+/****************************************************************************
+ * Name: test_pick
+ *
+ * Description:
+ *   Return a random allocated logical sector.
+ *
+ ****************************************************************************/
+
+static uint16_t test_pick(void)
+{
+  uint16_t sector;
+
+  do
+    {
+      sector = SMART_FIRST_ALLOC_SECTOR +
+               rand() % (g_dev->totalsectors - SMART_FIRST_ALLOC_SECTOR);
+    }
+  while (g_gen[sector] == 0);
+
+  return sector;
+}
+
+/****************************************************************************
+ * Name: test_compare
+ *
+ * Description:
+ *   Compare the sector map and the sector counts of a mounted copy with
+ *   those of the device under test.
+ *
+ ****************************************************************************/
+
+static void test_compare(FAR const char *what,
+                         FAR struct smart_struct_s *dev)
+{
+  int nbad = 0;
+  int i;
+
+  TESTHOST_CHECK(dev->totalsectors == g_dev->totalsectors);
+  TESTHOST_CHECK(dev->neraseblocks == g_dev->neraseblocks);
+  TESTHOST_CHECK(dev->formatstatus == SMART_FMT_STAT_FORMATTED);
+  TESTHOST_CHECK(dev->freesectors == g_dev->freesectors);
+  TESTHOST_CHECK(dev->releasesectors == g_dev->releasesectors);
+
+  for (i = 0; i < g_dev->totalsectors; i++)
+    {
+      if (dev->sMap[i] != g_dev->sMap[i] && nbad++ == 0)
+        {
+          printf("%s: Logical sector %d maps to %d, not %d\n",
+                 what, i, dev->sMap[i], g_dev->sMap[i]);
+        }
+    }
+
+  for (i = 0; i < g_dev->neraseblocks; i++)
+    {
+      if ((dev->freecount[i] != g_dev->freecount[i] ||
+           dev->releasecount[i] != g_dev->releasecount[i]) && nbad++ == 0)
+        {
+          printf("%s: Erase block %d has %d/%d free/released sectors, "
+                 "not %d/%d\n", what, i, dev->freecount[i],
+                 dev->releasecount[i], g_dev->freecount[i],
+                 g_dev->releasecount[i]);
+        }
+    }
+
+  TESTHOST_CHECK(nbad == 0);
+}
+
+/****************************************************************************
+ * Name: test_verify
+ *
+ * Description:
+ *   Read every allocated logical sector of a mounted device.
+ *
+ ****************************************************************************/
+
+static void test_verify(FAR const char *what, FAR struct inode *inode)
+{
+  struct smart_read_write_s req;
+  uint8_t expected[CONFIG_MTD_SMART_SECTOR_SIZE];
+  int nbad = 0;
+  int i;
+
+  for (i = SMART_FIRST_ALLOC_SECTOR; i < g_dev->totalsectors; i++)
+    {
+      if (g_gen[i] == 0)
+        {
+          continue;
+        }
+
+      memset(g_buffer, 0, g_availbytes);
+      req.logsector = i;
+      req.offset    = 0;
+      req.count     = g_availbytes;
+      req.buffer    = g_buffer;
+
+      test_fill(expected, i, g_gen[i]);
+      if ((inode->u.i_bops->ioctl(inode, BIOC_READSECT,
+                                  (unsigned long)((uintptr_t)&req)) < 0 ||
+           memcmp(g_buffer, expected, g_availbytes) != 0) && nbad++ == 0)
+        {
+          printf("%s: Logical sector %d is wrong\n", what, i);
+        }
+    }
+
+  TESTHOST_CHECK(nbad == 0);
+}
+
+/****************************************************************************
+ * Name: test_corrupt
+ *
+ * Description:
+ *   Damage the checkpoint that the device under test uses in a copy of its
+ *   FLASH.
+ *
+ ****************************************************************************/
+
+static void test_corrupt(FAR uint8_t *ram, int how)
+{
+  off_t    offset;
+  uint32_t datalen;
+  uint16_t entry;
+
+  TESTHOST_CHECK(g_dev->ckptregion >= 0);
+  if (g_dev->ckptregion < 0)
+    {
+      return;
+    }
+
+  offset  = smart_ckpt_offset(g_dev, g_dev->ckptregion);
+  datalen = g_dev->totalsectors * sizeof(uint16_t) +
+            (g_dev->neraseblocks << 1);
+
+  switch (how)
+    {
+      case CORRUPT_MAP:
+        ram[offset + g_dev->geo.blocksize + rand() % (datalen / 2)] ^= 0x10;
+        break;
+
+      case CORRUPT_HEADER:
+        memset(&ram[offset], 0, sizeof(uint32_t));
+        break;
+
+      case CORRUPT_LOG:
+
+        /* Append an entry for an erase block that does not exist */
+
+        entry = SMART_CKPT_ENTRY(g_dev->neraseblocks + 1);
+        memcpy(&ram[offset + g_dev->ckptlogoff +
+                    g_dev->ckptnlog * sizeof(uint16_t)],
+               &entry, sizeof(uint16_t));
+        break;
+
+      case CORRUPT_COUNTS:
+        ram[offset + g_dev->geo.blocksize + datalen - 1 -
+            rand() % (g_dev->neraseblocks << 1)] ^= 0x01;
+        break;
+    }
+}
+
+/****************************************************************************
+ * Name: test_remount
+ *
+ * Description:
+ *   Mount one copy of the device under test with its checkpoint and one
+ *   with a damaged checkpoint, which must be scanned completely.  Both must
+ *   end up with the same sector map as the device under test.
+ *
+ ****************************************************************************/
+
+static void test_remount(int how)
+{
+  FAR struct inode *ckptinode;
+  FAR struct inode *scaninode;
+
+  memcpy(g_ckptram, g_ram, RAMSIZE);
+  memcpy(g_scanram, g_ram, RAMSIZE);
+  test_corrupt(g_scanram, how);
+
+  testhost_mtd_initialize(&g_ckptmtd,
+                          rammtd_initialize(g_ckptram, RAMSIZE));
+  testhost_mtd_initialize(&g_scanmtd,
+                          rammtd_initialize(g_scanram, RAMSIZE));
+
+  ckptinode = test_mount(1, &g_ckptmtd.mtd);
+  scaninode = test_mount(2, &g_scanmtd.mtd);
+
+  TESTHOST_CHECK(ckptinode != NULL && scaninode != NULL);
+  if (ckptinode == NULL || scaninode == NULL)
+    {
+      exit(testhost_result("testsmart"));
+    }
+
+  printf("Mount with the checkpoint (%d log entries): %lu reads, %lu bytes\n"
+         "Mount with a full scan: %lu reads, %lu bytes\n",
+         g_dev->ckptnlog, (unsigned long)g_ckptmtd.nreads,
+         (unsigned long)g_ckptmtd.nbytesread,
+         (unsigned long)g_scanmtd.nreads,
+         (unsigned long)g_scanmtd.nbytesread);
+
+  /* The full scan reads the header of every sector */
+
+  TESTHOST_CHECK(g_scanmtd.nreads >= g_dev->totalsectors);
+  TESTHOST_CHECK(g_ckptmtd.nreads < g_dev->totalsectors / 2);
+
+  test_compare("Checkpoint", (FAR struct smart_struct_s *)
+               ckptinode->i_private);
+  test_compare("Full scan", (FAR struct smart_struct_s *)
+               scaninode->i_private);
+  test_verify("Checkpoint", ckptinode);
+  test_verify("Full scan", scaninode);
+
+  /* The copies are not unmounted, only forgotten */
+
+  (void)unregister_blockdriver("/dev/smart1");
+  (void)unregister_blockdriver("/dev/smart2");
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, char **argv)
+{
+  struct smart_format_s fmt;
+  uint32_t nused;
+  int how = 0;
+  int i;
+
+  srand(1);
+
+  memset(g_ram, CONFIG_RAMMTD_ERASESTATE, RAMSIZE);
+  g_inode = test_mount(0, testhost_mtd_initialize(&g_mtd,
+                       rammtd_initialize(g_ram, RAMSIZE)));
+  TESTHOST_CHECK(g_inode != NULL);
+  if (g_inode == NULL)
+    {
+      return testhost_result("testsmart");
+    }
+
+  TESTHOST_CHECK(g_inode->u.i_bops->ioctl(g_inode, BIOC_LLFORMAT, 0) == OK);
+  TESTHOST_CHECK(g_inode->u.i_bops->ioctl(g_inode, BIOC_GETFORMAT,
+                 (unsigned long)((uintptr_t)&fmt)) == OK);
+
+  g_dev        = (FAR struct smart_struct_s *)g_inode->i_private;
+  g_availbytes = fmt.availbytes;
+  printf("%d sectors of %d bytes in %d erase blocks, "
+         "2 x %d erase blocks for checkpoints\n", fmt.nsectors,
+         fmt.sectorsize, g_dev->neraseblocks, g_dev->ckptblocks);
+
+  TESTHOST_CHECK(g_dev->ckptblocks > 0);
+  TESTHOST_CHECK(fmt.nsectors <= MAXSECTORS);
+
+  /* Allocate most of the device */
+
+  nused = (uint32_t)fmt.nsectors * USEDPERCENT / 100;
+  for (i = 0; i < nused; i++)
+    {
+      test_alloc();
+    }
+
+  /* Then rewrite, free and allocate sectors at random.  Rewriting makes the
+   * garbage collector move sectors between erase blocks.
+   */
+
+  for (i = 1; i <= NOPS; i++)
+    {
+      switch (rand() % 8)
+        {
+          case 0:
+            test_free(test_pick());
+            nused--;
+            break;
+
+          case 1:
+            if (nused < (uint32_t)fmt.nsectors * USEDPERCENT / 100)
+              {
+                test_alloc();
+                nused++;
+              }
+            break;
+
+          default:
+            test_write(test_pick());
+            break;
+        }
+
+      if ((i % COMPAREINTERVAL) == 0)
+        {
+          test_remount(how);
+          how = (how + 1) % NCORRUPT;
+        }
+    }
+
+  test_verify("Device", g_inode);
+  printf("%lu erase blocks erased, %lu checkpoints written\n",
+         (unsigned long)g_mtd.nerased, (unsigned long)g_dev->ckptseq);
+
+  return testhost_result("testsmart");
+}
@@ -0,0 +1,891 @@
+/****************************************************************************
+ * tools/testspiffs.c
+ *
+ *   Copyright (C) 2019 Gregory Nutt. All rights reserved.
+ *   Author: Gregory Nutt <gnutt@nuttx.org>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name NuttX nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/stat.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
+#include <nuttx/mtd/mtd.h>
+
+#include "testhost/testhost.h"
+
+/* The test compares the object index with the object index headers on
+ * FLASH.
+ */
+
+#include "../fs/spiffs/src/spiffs.h"
+#include "../fs/spiffs/src/spiffs_core.h"
+#include "../fs/spiffs/src/spiffs_index.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The benchmarks:  Many small files and one large file on a large volume */
+
+#define BENCHSIZE      (4 * 1024 * 1024)
+#define BENCHFILES     500
+#define BENCHMAXLEN    1024
+#define STREAMLEN      (64 * 1024)  /* Size of the file read sequentially */
+#define STREAMIO       16           /* Size of its reads and writes */
+
+/* The index coherence test:  A small volume that must be garbage collected
+ * often.
+ */
+
+#define CHURNSIZE      (256 * 1024)
+#define CHURNFILES     24
+#define CHURNMAXLEN    4096
+#define CHURNOPS       6000
+#define MAXCHUNK       300    /* Writes of more than a page are not cached */
+#define CHECKINTERVAL  100    /* Operations between checks of all files */
+#define IOCTLINTERVAL  500    /* Operations between checks and MTD ioctls */
+#define MOUNTINTERVAL  1000   /* Operations between remounts */
+#define REFORMATOP     3000   /* Operation after which the volume is erased */
+
+#define MAXFILES       BENCHFILES
+#define MAXLEN         STREAMLEN
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+extern const struct mountpt_operations spiffs_operations;
+
+static uint8_t g_ram[BENCHSIZE];
+static struct testhost_mtd_s g_mtd;
+static struct inode g_mtdinode;
+static struct inode g_mountpt;
+static FAR struct spiffs_s *g_fs;
+
+/* What the volume should hold:  The content and length of each file.  The
+ * content is NULL if the file does not exist.
+ */
+
+static FAR uint8_t *g_data[MAXFILES];
+static size_t g_len[MAXFILES];
+static int g_nfiles;
+static uint32_t g_gcsteps;
+
+static uint8_t g_buffer[MAXLEN];
+static uint8_t g_expected[MAXLEN];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: test_name and test_fill
+ ****************************************************************************/
+
+static FAR const char *test_name(int file)
+{
+  static char name[16];
+
+  snprintf(name, sizeof(name), "file%03d", file);
+  return name;
+}
+
+static void test_fill(FAR uint8_t *buffer, size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      buffer[i] = (uint8_t)rand();
+    }
+}
+
+/****************************************************************************
+ * Name: test_mount
+ *
+ * Description:
+ *   Mount the SPIFFS volume on the MTD, unmounting the previous volume.
+ *
+ ****************************************************************************/
+
+static void test_mount(FAR struct mtd_dev_s *mtd)
+{
+  FAR struct inode *mtdinode;
+  FAR void *handle;
+  int ret;
+
+  if (g_fs != NULL)
+    {
+      g_gcsteps += g_fs->gc_steps;
+      TESTHOST_CHECK(spiffs_operations.unbind(g_fs, &mtdinode, 0) == OK);
+    }
+
+  INODE_SET_MTD(&g_mtdinode);
+  g_mtdinode.u.i_mtd = mtd;
+
+  ret = spiffs_operations.bind(&g_mtdinode, NULL, &handle);
+  TESTHOST_CHECK(ret == OK);
+  if (ret < 0)
+    {
+      exit(testhost_result("testspiffs"));
+    }
+
+  g_fs = handle;
+  g_mountpt.i_private = g_fs;
+}
+
+/****************************************************************************
+ * Name: test_open
+ ****************************************************************************/
+
+static int test_open(FAR struct file *filep, FAR const char *name,
+                     int oflags)
+{
+  memset(filep, 0, sizeof(struct file));
+  filep->f_inode = &g_mountpt;
+
+  return spiffs_operations.open(filep, name, oflags, 0666);
+}
+
+/****************************************************************************
+ * Name: test_write
+ *
+ * Description:
+ *   Write part of the expected content of a file in writes of random size.
+ *   Most writes are smaller than a page and are cached.
+ *
+ ****************************************************************************/
+
+static int test_write(FAR struct file *filep, int file, size_t offset,
+                      size_t len)
+{
+  ssize_t nwritten;
+  size_t nbytes;
+
+  if (spiffs_operations.seek(filep, offset, SEEK_SET) != (off_t)offset)
+    {
+      return -EIO;
+    }
+
+  while (len > 0)
+    {
+      nbytes   = 1 + rand() % MAXCHUNK;
+      nbytes   = nbytes < len ? nbytes : len;
+      nwritten = spiffs_operations.write(filep,
+                                         (FAR char *)&g_data[file][offset],
+                                         nbytes);
+      if (nwritten != (ssize_t)nbytes)
+        {
+          return nwritten < 0 ? (int)nwritten : -ENOSPC;
+        }
+
+      offset += nbytes;
+      len    -= nbytes;
+
+      if (rand() % 16 == 0)
+        {
+          TESTHOST_CHECK(spiffs_operations.sync(filep) == OK);
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: test_readback
+ *
+ * Description:
+ *   Read a file through an open file and compare it with the expected
+ *   content.
+ *
+ ****************************************************************************/
+
+static bool test_readback(FAR struct file *filep, int file)
+{
+  ssize_t nread;
+
+  if (spiffs_operations.seek(filep, 0, SEEK_SET) != 0)
+    {
+      return false;
+    }
+
+  nread = spiffs_operations.read(filep, (FAR char *)g_buffer, MAXLEN);
+  return nread == (ssize_t)g_len[file] &&
+         memcmp(g_buffer, g_data[file], g_len[file]) == 0;
+}
+
+/****************************************************************************
+ * Name: test_create
+ *
+ * Description:
+ *   Create or truncate a file and write new content.
+ *
+ ****************************************************************************/
+
+static int test_create(int file, size_t len)
+{
+  struct file filep;
+  int ret;
+
+  ret = test_open(&filep, test_name(file), O_WRONLY | O_CREAT | O_TRUNC);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (g_data[file] == NULL)
+    {
+      g_data[file] = malloc(CHURNMAXLEN);
+    }
+
+  test_fill(g_data[file], len);
+  g_len[file] = len;
+
+  ret = test_write(&filep, file, 0, len);
+  if (ret == OK)
+    {
+      ret = spiffs_operations.close(&filep);
+    }
+  else
+    {
+      spiffs_operations.close(&filep);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: test_update
+ *
+ * Description:
+ *   Overwrite or extend part of an existing file.  Sometimes the file is
+ *   read back before it is closed, while some of the data is still cached.
+ *
+ ****************************************************************************/
+
+static int test_update(int file)
+{
+  struct file filep;
+  size_t offset;
+  size_t len;
+  int ret;
+
+  ret = test_open(&filep, test_name(file), O_RDWR);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  offset = rand() % (g_len[file] + 1);
+  if (offset >= CHURNMAXLEN)
+    {
+      offset = CHURNMAXLEN - 1;
+    }
+
+  len = 1 + rand() % (CHURNMAXLEN - offset);
+  test_fill(&g_data[file][offset], len);
+  if (offset + len > g_len[file])
+    {
+      g_len[file] = offset + len;
+    }
+
+  ret = test_write(&filep, file, offset, len);
+  if (ret == OK && rand() % 2 == 0 && !test_readback(&filep, file))
+    {
+      printf("%s: Wrong content before close\n", test_name(file));
+      g_testhost_nfailed++;
+    }
+
+  if (ret == OK)
+    {
+      ret = spiffs_operations.close(&filep);
+    }
+  else
+    {
+      spiffs_operations.close(&filep);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: test_unlink and test_rename
+ ****************************************************************************/
+
+static void test_unlink(int file)
+{
+  TESTHOST_CHECK(spiffs_operations.unlink(&g_mountpt,
+                                          test_name(file)) == OK);
+  free(g_data[file]);
+  g_data[file] = NULL;
+}
+
+static void test_rename(int file, int newfile)
+{
+  char oldname[16];
+
+  strcpy(oldname, test_name(file));
+  TESTHOST_CHECK(spiffs_operations.rename(&g_mountpt, oldname,
+                                          test_name(newfile)) == OK);
+
+  g_data[newfile] = g_data[file];
+  g_len[newfile]  = g_len[file];
+  g_data[file]    = NULL;
+}
+
+/****************************************************************************
+ * Name: test_ioctl
+ *
+ * Description:
+ *   Perform an ioctl on a file of the volume.  An empty file is created if
+ *   there is no file.
+ *
+ ****************************************************************************/
+
+static int test_ioctl(int cmd, unsigned long arg)
+{
+  struct file filep;
+  int file;
+  int ret;
+
+  for (file = 0; file < g_nfiles && g_data[file] == NULL; file++)
+    {
+    }
+
+  if (file == g_nfiles)
+    {
+      file = 0;
+      TESTHOST_CHECK(test_create(file, 0) == OK);
+    }
+
+  ret = test_open(&filep, test_name(file), O_RDONLY);
+  if (ret == OK)
+    {
+      ret = spiffs_operations.ioctl(&filep, cmd, arg);
+      TESTHOST_CHECK(spiffs_operations.close(&filep) == OK);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: test_ixbuild
+ *
+ * Description:
+ *   Rebuild the object index from the object lookup pages.
+ *
+ ****************************************************************************/
+
+static void test_ixbuild(void)
+{
+  int16_t pgndx;
+
+  spiffs_index_invalidate(g_fs);
+  TESTHOST_CHECK(spiffs_index_findname(g_fs, (FAR const uint8_t *)"",
+                                       &pgndx) == -ENOENT);
+}
+
+/****************************************************************************
+ * Name: test_ixcheck
+ *
+ * Description:
+ *   If the object index is valid, it must hold exactly the entries that a
+ *   scan of the object lookup pages finds.
+ *
+ ****************************************************************************/
+
+static void test_ixcheck(FAR const char *what)
+{
+  FAR struct spiffs_ixentry_s *index;
+  size_t size;
+  int nindex;
+  int nlive;
+  int i;
+
+  if (g_fs->ixstate != SPIFFS_IXSTATE_VALID)
+    {
+      return;
+    }
+
+  nindex = g_fs->nindex;
+  size   = nindex * sizeof(struct spiffs_ixentry_s);
+  index  = malloc(size + 1);
+  memcpy(index, g_fs->ixentries, size);
+
+  test_ixbuild();
+  TESTHOST_CHECK(g_fs->nindex == nindex);
+
+  for (nlive = 0, i = 0; i < g_nfiles; i++)
+    {
+      nlive += g_data[i] != NULL;
+    }
+
+  TESTHOST_CHECK(nindex == nlive);
+
+  /* Both are sorted by object ID */
+
+  if (g_fs->nindex == nindex && memcmp(index, g_fs->ixentries, size) != 0)
+    {
+      printf("%s: The object index differs from the FLASH\n", what);
+      g_testhost_nfailed++;
+    }
+
+  free(index);
+}
+
+/****************************************************************************
+ * Name: test_verify
+ *
+ * Description:
+ *   Check the index and read back every file.  Removed files must not be
+ *   found.
+ *
+ ****************************************************************************/
+
+static void test_verify(FAR const char *what)
+{
+  struct file filep;
+  struct stat buf;
+  int nbad = 0;
+  int i;
+
+  test_ixcheck(what);
+
+  for (i = 0; i < g_nfiles; i++)
+    {
+      if (g_data[i] == NULL)
+        {
+          if (spiffs_operations.stat(&g_mountpt, test_name(i),
+                                     &buf) != -ENOENT)
+            {
+              nbad++;
+            }
+
+          continue;
+        }
+
+      if (test_open(&filep, test_name(i), O_RDONLY) < 0)
+        {
+          nbad++;
+          continue;
+        }
+
+      if (!test_readback(&filep, i))
+        {
+          nbad++;
+        }
+
+      TESTHOST_CHECK(spiffs_operations.close(&filep) == OK);
+    }
+
+  if (nbad > 0)
+    {
+      printf("%s: %d of %d files are wrong\n", what, nbad, g_nfiles);
+      g_testhost_nfailed++;
+    }
+
+  /* Opening the files rebuilt an index that was invalid */
+
+  TESTHOST_CHECK(g_fs->ixstate == SPIFFS_IXSTATE_VALID);
+  test_ixcheck(what);
+}
+
+/****************************************************************************
+ * Name: test_bench
+ *
+ * Description:
+ *   Open every file with the object index and with the search of the
+ *   object lookup pages, and report the FLASH reads of each.
+ *
+ ****************************************************************************/
+
+static void test_bench(void)
+{
+  struct file filep;
+  uint32_t nreads[2];
+  uint32_t nbytes[2];
+  int order[BENCHFILES];
+  int pass;
+  int tmp;
+  int i;
+  int j;
+
+  /* Open the files in random order.  The search of the object lookup pages
+   * starts where the last search ended, so files opened in the order of
+   * their creation are always found at once.
+   */
+
+  for (i = 0; i < BENCHFILES; i++)
+    {
+      order[i] = i;
+    }
+
+  for (i = BENCHFILES - 1; i > 0; i--)
+    {
+      j        = rand() % (i + 1);
+      tmp      = order[i];
+      order[i] = order[j];
+      order[j] = tmp;
+    }
+
+  for (pass = 0; pass < 2; pass++)
+    {
+      /* Build the index before counting.  It is built once per mount. */
+
+      if (pass == 0)
+        {
+          test_ixbuild();
+        }
+      else
+        {
+          g_fs->ixstate = SPIFFS_IXSTATE_DISABLED;
+        }
+
+      g_mtd.nreads     = 0;
+      g_mtd.nbytesread = 0;
+
+      for (i = 0; i < BENCHFILES; i++)
+        {
+          TESTHOST_CHECK(test_open(&filep, test_name(order[i]),
+                                   O_RDONLY) == OK);
+          TESTHOST_CHECK(spiffs_operations.close(&filep) == OK);
+        }
+
+      nreads[pass] = g_mtd.nreads;
+      nbytes[pass] = g_mtd.nbytesread;
+    }
+
+  spiffs_index_invalidate(g_fs);
+
+  printf("Open of %d files:  With the index %lu reads / %lu bytes, "
+         "lookup search %lu reads / %lu bytes\n", BENCHFILES,
+         (unsigned long)nreads[0], (unsigned long)nbytes[0],
+         (unsigned long)nreads[1], (unsigned long)nbytes[1]);
+
+  TESTHOST_CHECK(nbytes[0] * 10 < nbytes[1]);
+}
+
+/****************************************************************************
+ * Name: test_stale
+ *
+ * Description:
+ *   Point an entry of the object index at the header of another object.
+ *   The file must still be found by searching the FLASH.
+ *
+ ****************************************************************************/
+
+static void test_stale(void)
+{
+  struct file filep;
+  int16_t pgndx;
+  int i;
+
+  test_ixbuild();
+  TESTHOST_CHECK(g_fs->nindex >= 2);
+
+  pgndx = g_fs->ixentries[0].pgndx;
+  g_fs->ixentries[0].pgndx = g_fs->ixentries[1].pgndx;
+  g_fs->ixentries[1].pgndx = pgndx;
+
+  for (i = 0; i < BENCHFILES; i++)
+    {
+      TESTHOST_CHECK(test_open(&filep, test_name(i), O_RDONLY) == OK);
+      TESTHOST_CHECK(test_readback(&filep, i));
+      TESTHOST_CHECK(spiffs_operations.close(&filep) == OK);
+    }
+}
+
+/****************************************************************************
+ * Name: test_stream
+ *
+ * Description:
+ *   Write a large file with small writes and with one write, and read it
+ *   with small reads with and without read-ahead.  Report the FLASH pages
+ *   written and the FLASH reads.
+ *
+ ****************************************************************************/
+
+static void test_stream(void)
+{
+  FAR uint8_t *rabuf;
+  struct file filep;
+  uint32_t nwritten[3];
+  uint32_t nreads[2];
+  size_t offset;
+  int pass;
+
+  test_fill(g_expected, STREAMLEN);
+
+  /* Write the file with small cached writes, with small writes that are
+   * each synchronized, and with one write.
+   */
+
+  for (pass = 0; pass < 3; pass++)
+    {
+      TESTHOST_CHECK(test_open(&filep, "stream",
+                               O_WRONLY | O_CREAT | O_TRUNC) == OK);
+      g_mtd.nwritten = 0;
+
+      if (pass < 2)
+        {
+          for (offset = 0; offset < STREAMLEN; offset += STREAMIO)
+            {
+              TESTHOST_CHECK(spiffs_operations.write(&filep,
+                             (FAR char *)&g_expected[offset], STREAMIO) ==
+                             STREAMIO);
+              if (pass == 1)
+                {
+                  TESTHOST_CHECK(spiffs_operations.sync(&filep) == OK);
+                }
+            }
+        }
+      else
+        {
+          TESTHOST_CHECK(spiffs_operations.write(&filep,
+                         (FAR char *)g_expected, STREAMLEN) == STREAMLEN);
+        }
+
+      TESTHOST_CHECK(spiffs_operations.close(&filep) == OK);
+      nwritten[pass] = g_mtd.nwritten;
+    }
+
+  printf("Write of %d bytes:  In %d byte writes %lu pages, synchronized "
+         "after each write %lu pages, in one write %lu pages\n", STREAMLEN,
+         STREAMIO, (unsigned long)nwritten[0], (unsigned long)nwritten[1],
+         (unsigned long)nwritten[2]);
+
+  TESTHOST_CHECK(nwritten[0] * 4 < nwritten[1]);
+  TESTHOST_CHECK(nwritten[0] < nwritten[2] * 3);
+
+  rabuf = g_fs->rabuf;
+  for (pass = 0; pass < 2; pass++)
+    {
+      g_fs->ranpages = 0;
+      g_fs->rabuf    = pass == 0 ? rabuf : NULL;
+
+      TESTHOST_CHECK(test_open(&filep, "stream", O_RDONLY) == OK);
+      g_mtd.nreads = 0;
+
+      for (offset = 0; offset < STREAMLEN; offset += STREAMIO)
+        {
+          TESTHOST_CHECK(spiffs_operations.read(&filep,
+                         (FAR char *)&g_buffer[offset], STREAMIO) ==
+                         STREAMIO);
+        }
+
+      nreads[pass] = g_mtd.nreads;
+      TESTHOST_CHECK(spiffs_operations.close(&filep) == OK);
+      TESTHOST_CHECK(memcmp(g_buffer, g_expected, STREAMLEN) == 0);
+    }
+
+  g_fs->rabuf = rabuf;
+
+  printf("Read of %d bytes in %d byte reads:  With read-ahead %lu reads, "
+         "without %lu reads\n", STREAMLEN, STREAMIO,
+         (unsigned long)nreads[0], (unsigned long)nreads[1]);
+
+  TESTHOST_CHECK(nreads[0] * 2 < nreads[1]);
+  TESTHOST_CHECK(spiffs_operations.unlink(&g_mountpt, "stream") == OK);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: main
+ ****************************************************************************/
+
+int main(int argc, char **argv)
+{
+  struct mtd_geometry_s geo;
+  char what[32];
+  size_t len;
+  int file;
+  int ret;
+  int i;
+
+  srand(1);
+
+  /* Benchmark the open of many files and the streaming of a large file on
+   * a large volume.
+   */
+
+  memset(g_ram, CONFIG_RAMMTD_ERASESTATE, BENCHSIZE);
+  test_mount(testhost_mtd_initialize(&g_mtd,
+             rammtd_initialize(g_ram, BENCHSIZE)));
+
+  g_nfiles = BENCHFILES;
+  for (i = 0; i < BENCHFILES; i++)
+    {
+      TESTHOST_CHECK(test_create(i, 1 + rand() % BENCHMAXLEN) == OK);
+    }
+
+  test_verify("Created");
+
+  g_mtd.nreads     = 0;
+  g_mtd.nbytesread = 0;
+  test_mount(&g_mtd.mtd);
+  printf("Mount of %d files:  %lu reads / %lu bytes\n", BENCHFILES,
+         (unsigned long)g_mtd.nreads, (unsigned long)g_mtd.nbytesread);
+
+  test_bench();
+  test_stale();
+  test_stream();
+  test_verify("Benchmarked");
+
+  for (i = 0; i < BENCHFILES; i++)
+    {
+      free(g_data[i]);
+      g_data[i] = NULL;
+    }
+
+  /* Create, update, rename and remove files at random on a small volume.
+   * The volume fills up and is garbage collected by the writes.
+   */
+
+  memset(g_ram, CONFIG_RAMMTD_ERASESTATE, CHURNSIZE);
+  test_mount(testhost_mtd_initialize(&g_mtd,
+             rammtd_initialize(g_ram, CHURNSIZE)));
+
+  g_nfiles = CHURNFILES;
+  for (i = 1; i <= CHURNOPS; i++)
+    {
+      file = rand() % CHURNFILES;
+      ret  = OK;
+
+      if (g_data[file] == NULL || rand() % 4 == 0)
+        {
+          len = rand() % CHURNMAXLEN;
+          ret = test_create(file, len);
+        }
+      else
+        {
+          switch (rand() % 4)
+            {
+              case 0:
+                test_unlink(file);
+                break;
+
+              case 1:
+                for (ret = 0; ret < CHURNFILES && g_data[ret] != NULL;
+                     ret++)
+                  {
+                  }
+
+                if (ret < CHURNFILES)
+                  {
+                    test_rename(file, ret);
+                  }
+
+                ret = OK;
+                break;
+
+              default:
+                ret = test_update(file);
+                break;
+            }
+        }
+
+      if (ret < 0)
+        {
+          printf("Operation %d: Failed to write %s: %d\n", i,
+                 test_name(file), ret);
+          g_testhost_nfailed++;
+        }
+
+      if (i == REFORMATOP)
+        {
+          /* Erase the volume.  The index must not return removed files. */
+
+          TESTHOST_CHECK(test_ioctl(FIOC_REFORMAT, 0) == OK);
+          TESTHOST_CHECK(g_fs->ixstate == SPIFFS_IXSTATE_INVALID);
+
+          for (file = 0; file < CHURNFILES; file++)
+            {
+              free(g_data[file]);
+              g_data[file] = NULL;
+            }
+
+          test_verify("Reformat");
+        }
+      else if ((i % MOUNTINTERVAL) == 0)
+        {
+          snprintf(what, sizeof(what), "Remount %d", i);
+          test_mount(&g_mtd.mtd);
+          test_verify(what);
+        }
+      else if ((i % IOCTLINTERVAL) == 0)
+        {
+          /* The consistency check and an ioctl of the MTD driver discard
+           * the index.
+           */
+
+          snprintf(what, sizeof(what), "Check %d", i);
+          test_verify(what);
+          TESTHOST_CHECK(test_ioctl(FIOC_INTEGRITY, 0) == OK);
+          TESTHOST_CHECK(g_fs->ixstate == SPIFFS_IXSTATE_INVALID);
+          test_verify(what);
+
+          snprintf(what, sizeof(what), "MTD ioctl %d", i);
+          TESTHOST_CHECK(test_ioctl(MTDIOC_GEOMETRY,
+                                    (unsigned long)(uintptr_t)&geo) == OK);
+          TESTHOST_CHECK(g_fs->ixstate == SPIFFS_IXSTATE_INVALID);
+          test_verify(what);
+        }
+      else if ((i % CHECKINTERVAL) == 0)
+        {
+          snprintf(what, sizeof(what), "Operation %d", i);
+          test_verify(what);
+        }
+    }
+
+  g_gcsteps += g_fs->gc_steps;
+  printf("%d operations, %lu blocks garbage collected, %lu erase blocks "
+         "erased\n", CHURNOPS, (unsigned long)g_gcsteps,
+         (unsigned long)g_mtd.nerased);
+
+  TESTHOST_CHECK(g_gcsteps > 0);
+  return testhost_result("testspiffs");
+}